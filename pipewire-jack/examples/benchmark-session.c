@@ -0,0 +1,267 @@
+/* PipeWire
+ *
+ * Copyright © 2020 Wim Taymans
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the next
+ * paragraph) shall be included in all copies or substantial portions of the
+ * Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+/* Times what a session manager does when it restores a session: list the
+ * ports of many clients, look all of them up by name and alias, query them
+ * with patterns and connect them, all from one client. Needs a running
+ * PipeWire daemon. */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <inttypes.h>
+#include <unistd.h>
+#include <time.h>
+
+#include <jack/jack.h>
+
+/* client-node accepts at most 64 ports in each direction, spread the
+ * N_CLIENTS * N_PORTS * 2 = 512 ports over several clients */
+#define N_CLIENTS	8
+#define N_PORTS		32
+#define N_LOOPS		20
+#define CLIENT_NAME	"benchmark-session"
+#define NAME_SIZE	256
+
+struct client {
+	jack_client_t *client;
+	/* names of the ports as the session client sees them */
+	char in_names[N_PORTS][NAME_SIZE];
+	char out_names[N_PORTS][NAME_SIZE];
+};
+
+static struct client clients[N_CLIENTS];
+
+static uint64_t get_time(void)
+{
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec * UINT64_C(1000000000) + ts.tv_nsec;
+}
+
+static void report(const char *what, uint64_t t1, uint64_t t2, uint32_t count)
+{
+	fprintf(stderr, "%-12s: elapsed %"PRIu64" us count %u = %"PRIu64" ns each\n",
+			what, (t2 - t1) / 1000, count, (t2 - t1) / count);
+}
+
+/* the inputs of client c are linked to the outputs of the client before it */
+static struct client *peer(uint32_t c)
+{
+	return &clients[(c + N_CLIENTS - 1) % N_CLIENTS];
+}
+
+/* wait until the session client knows the ports of all clients and store
+ * their names */
+static int collect_ports(jack_client_t *client)
+{
+	const char **ports = NULL;
+	uint32_t i, c, n, found;
+	int retry;
+
+	for (retry = 0; retry < 500; retry++) {
+		jack_free(ports);
+		ports = jack_get_ports(client, "^" CLIENT_NAME "-", NULL, 0);
+		for (n = 0; ports && ports[n]; n++);
+		if (n >= N_CLIENTS * N_PORTS * 2)
+			break;
+		usleep(10 * 1000);
+	}
+	for (found = 0, i = 0; ports && ports[i]; i++) {
+		jack_port_t *port = jack_port_by_name(client, ports[i]);
+		uint32_t idx;
+
+		if (port == NULL ||
+		    sscanf(ports[i], CLIENT_NAME "-%u", &c) != 1 || c >= N_CLIENTS)
+			continue;
+		if (sscanf(jack_port_short_name(port), "in_%u", &idx) == 1 && idx < N_PORTS)
+			snprintf(clients[c].in_names[idx], NAME_SIZE, "%s", ports[i]);
+		else if (sscanf(jack_port_short_name(port), "out_%u", &idx) == 1 && idx < N_PORTS)
+			snprintf(clients[c].out_names[idx], NAME_SIZE, "%s", ports[i]);
+		else
+			continue;
+		found++;
+	}
+	jack_free(ports);
+
+	if (found != N_CLIENTS * N_PORTS * 2) {
+		fprintf(stderr, "found %u of %u ports\n", found, N_CLIENTS * N_PORTS * 2);
+		return -1;
+	}
+	return 0;
+}
+
+static void bench_lookup(jack_client_t *client)
+{
+	char name[256];
+	uint64_t t1, t2;
+	uint32_t i, c, j, count = 0;
+
+	t1 = get_time();
+	for (j = 0; j < N_LOOPS; j++) {
+		for (c = 0; c < N_CLIENTS; c++) {
+			struct client *cl = &clients[c];
+			for (i = 0; i < N_PORTS; i++) {
+				if (jack_port_by_name(client, cl->out_names[i]) == NULL)
+					fprintf(stderr, "port %s not found\n", cl->out_names[i]);
+				if (jack_port_by_name(client, cl->in_names[i]) == NULL)
+					fprintf(stderr, "port %s not found\n", cl->in_names[i]);
+				count += 2;
+			}
+		}
+		/* the session client made aliases for its own inputs */
+		for (i = 0; i < N_PORTS; i++) {
+			snprintf(name, sizeof(name), CLIENT_NAME "-alias:in_%u", i);
+			if (jack_port_by_name(client, name) == NULL)
+				fprintf(stderr, "alias %s not found\n", name);
+			count++;
+		}
+	}
+	t2 = get_time();
+	report("by_name", t1, t2, count);
+}
+
+static void bench_get_ports(jack_client_t *client)
+{
+	char pattern[256];
+	const char **ports;
+	uint64_t t1, t2;
+	uint32_t i, c, j, count = 0;
+
+	t1 = get_time();
+	for (j = 0; j < N_LOOPS; j++) {
+		for (c = 0; c < N_CLIENTS; c++) {
+			for (i = 0; i < N_PORTS; i++) {
+				snprintf(pattern, sizeof(pattern), "^%s$", clients[c].in_names[i]);
+				ports = jack_get_ports(client, pattern, NULL, 0);
+				if (ports == NULL || ports[0] == NULL || ports[1] != NULL)
+					fprintf(stderr, "pattern %s does not match 1 port\n", pattern);
+				jack_free(ports);
+				count++;
+			}
+			snprintf(pattern, sizeof(pattern), "^" CLIENT_NAME "-%u[:/]", c);
+			ports = jack_get_ports(client, pattern, NULL, JackPortIsOutput);
+			jack_free(ports);
+			count++;
+		}
+		ports = jack_get_ports(client, NULL, JACK_DEFAULT_AUDIO_TYPE, 0);
+		jack_free(ports);
+		count++;
+	}
+	t2 = get_time();
+	report("get_ports", t1, t2, count);
+}
+
+static void bench_connect(jack_client_t *client)
+{
+	uint64_t t1, t2;
+	uint32_t i, c, count = N_CLIENTS * N_PORTS;
+	jack_port_t *port;
+
+	t1 = get_time();
+	for (c = 0; c < N_CLIENTS; c++)
+		for (i = 0; i < N_PORTS; i++)
+			if (jack_connect(client, peer(c)->out_names[i], clients[c].in_names[i]) != 0)
+				fprintf(stderr, "can't connect %s\n", clients[c].in_names[i]);
+	t2 = get_time();
+	report("connect", t1, t2, count);
+
+	t1 = get_time();
+	for (c = 0; c < N_CLIENTS; c++) {
+		for (i = 0; i < N_PORTS; i++) {
+			port = jack_port_by_name(client, peer(c)->out_names[i]);
+			if (port == NULL || !jack_port_connected_to(port, clients[c].in_names[i]))
+				fprintf(stderr, "%s not connected\n", clients[c].in_names[i]);
+		}
+	}
+	t2 = get_time();
+	report("connected_to", t1, t2, count);
+
+	t1 = get_time();
+	for (c = 0; c < N_CLIENTS; c++)
+		for (i = 0; i < N_PORTS; i++)
+			jack_disconnect(client, peer(c)->out_names[i], clients[c].in_names[i]);
+	t2 = get_time();
+	report("disconnect", t1, t2, count);
+}
+
+static int process(jack_nframes_t nframes, void *arg)
+{
+	return 0;
+}
+
+int main(int argc, char *argv[])
+{
+	jack_port_t *port;
+	char name[256];
+	uint64_t t1, t2;
+	uint32_t i, c;
+
+	for (c = 0; c < N_CLIENTS; c++) {
+		snprintf(name, sizeof(name), CLIENT_NAME "-%u", c);
+		clients[c].client = jack_client_open(name, JackNoStartServer, NULL);
+		if (clients[c].client == NULL) {
+			fprintf(stderr, "can't connect, skipping\n");
+			goto exit;
+		}
+		jack_set_process_callback(clients[c].client, process, NULL);
+	}
+
+	t1 = get_time();
+	for (c = 0; c < N_CLIENTS; c++) {
+		for (i = 0; i < N_PORTS; i++) {
+			snprintf(name, sizeof(name), "in_%u", i);
+			port = jack_port_register(clients[c].client, name,
+					JACK_DEFAULT_AUDIO_TYPE, JackPortIsInput, 0);
+			if (c == 0) {
+				snprintf(name, sizeof(name), CLIENT_NAME "-alias:in_%u", i);
+				jack_port_set_alias(port, name);
+			}
+			snprintf(name, sizeof(name), "out_%u", i);
+			jack_port_register(clients[c].client, name,
+					JACK_DEFAULT_AUDIO_TYPE, JackPortIsOutput, 0);
+		}
+	}
+	t2 = get_time();
+	report("register", t1, t2, N_CLIENTS * N_PORTS * 2);
+
+	for (c = 0; c < N_CLIENTS; c++)
+		jack_activate(clients[c].client);
+
+	/* a session manager does all of this from one client */
+	if (collect_ports(clients[0].client) == 0) {
+		bench_lookup(clients[0].client);
+		bench_get_ports(clients[0].client);
+		bench_connect(clients[0].client);
+	}
+
+	for (c = 0; c < N_CLIENTS; c++)
+		jack_deactivate(clients[c].client);
+exit:
+	for (c = 0; c < N_CLIENTS; c++) {
+		if (clients[c].client != NULL)
+			jack_client_close(clients[c].client);
+	}
+	return 0;
+}
@@ -37,6 +37,7 @@
 #include <spa/support/cpu.h>
 #include <spa/param/audio/format-utils.h>
 #include <spa/param/video/format-utils.h>
+#include <spa/param/latency-utils.h>
 #include <spa/debug/types.h>
 #include <spa/debug/pod.h>
 
@@ -46,6 +47,7 @@
 
 #include "extensions/client-node.h"
 #include "extensions/metadata.h"
+#include "mix-ops.h"
 
 #define JACK_DEFAULT_VIDEO_TYPE	"32 bit float RGBA video"
 
@@ -57,7 +59,7 @@
 
 #define MAX_BUFFER_FRAMES		8192
 
-#define MAX_ALIGN			16
+#define MAX_ALIGN			64
 #define MAX_OBJECTS			8192
 #define MAX_PORTS			1024
 #define MAX_BUFFERS			2
@@ -86,16 +88,22 @@ struct globals {
 static struct globals globals;
 
 #define OBJECT_CHUNK	8
-
-typedef void (*mix2_func) (float *dst, float *src1, float *src2, int n_samples);
-
-static mix2_func mix2;
+#define HASH_SIZE	256
 
 struct object {
 	struct spa_list link;
 
 	struct client *client;
 
+	/* buckets of the name or the ports of a link, and of the aliases */
+	struct spa_list hash_link;
+	struct spa_list alias1_link;
+	struct spa_list alias2_link;
+#define HASHED_NAME	(1<<0)
+#define HASHED_ALIAS1	(1<<1)
+#define HASHED_ALIAS2	(1<<2)
+	uint32_t hashed;
+
 #define INTERFACE_Port	0
 #define INTERFACE_Node	1
 #define INTERFACE_Link	2
@@ -123,6 +131,12 @@ struct object {
 			jack_latency_range_t capture_latency;
 			jack_latency_range_t playback_latency;
 			int32_t priority;
+
+			/* the latency of the ports of other clients */
+			struct pw_proxy *proxy;
+			struct spa_hook object_listener;
+			struct spa_latency_info latency[2];
+			bool have_latency[2];
 		} port;
 	};
 };
@@ -148,6 +162,101 @@ struct midi_event {
 	};
 };
 
+static inline uint8_t * midi_event_data (void* port_buffer,
+                      const struct midi_event* event)
+{
+        if (event->size <= MIDI_INLINE_MAX)
+                return (uint8_t *)event->inline_data;
+        else
+                return SPA_MEMBER(port_buffer, event->byte_offset, uint8_t);
+}
+
+/* A port buffer that reads or writes the sequence of the pipewire buffer in
+ * place. Input ports with one link read the events from the sequence of the
+ * peer and output ports build their sequence in the buffer they send, the
+ * jack_midi functions check the magic. */
+struct midi_seq {
+#define MIDI_SEQ_MAGIC 0x5e9df00d
+	struct midi_buffer buffer;
+	struct spa_pod_sequence *seq;
+	struct spa_pod_builder b;	/**< builds seq for output ports */
+	struct spa_pod_frame f;
+	unsigned int writing:1;
+	uint32_t last_time;
+
+	struct spa_pod_control *cursor;	/**< the last event that was read */
+	uint32_t cursor_index;
+};
+
+static void init_midi_buffer(struct midi_buffer *mb, uint32_t nframes)
+{
+	mb->magic = MIDI_BUFFER_MAGIC;
+	mb->buffer_size = MAX_BUFFER_FRAMES * sizeof(float);
+	mb->nframes = nframes;
+	mb->write_pos = 0;
+	mb->event_count = 0;
+	mb->lost_events = 0;
+}
+
+static inline uint32_t midi_seq_size(struct midi_seq *ms)
+{
+	/* the size in the pod is only updated when the builder pops */
+	return ms->writing ? ms->f.pod.size : SPA_POD_BODY_SIZE(ms->seq);
+}
+
+static void midi_seq_init_read(struct midi_seq *ms, struct spa_pod_sequence *seq,
+		uint32_t nframes)
+{
+	struct spa_pod_control *c;
+
+	init_midi_buffer(&ms->buffer, nframes);
+	ms->buffer.magic = MIDI_SEQ_MAGIC;
+	ms->seq = seq;
+	ms->writing = false;
+	ms->cursor = NULL;
+
+	SPA_POD_SEQUENCE_FOREACH(seq, c)
+		if (c->type == SPA_CONTROL_Midi)
+			ms->buffer.event_count++;
+}
+
+static void midi_seq_init_write(struct midi_seq *ms, void *data, uint32_t size,
+		uint32_t nframes)
+{
+	init_midi_buffer(&ms->buffer, nframes);
+	ms->buffer.magic = MIDI_SEQ_MAGIC;
+	spa_pod_builder_init(&ms->b, data, size);
+	spa_pod_builder_push_sequence(&ms->b, &ms->f, 0);
+	ms->seq = SPA_MEMBER(data, ms->f.offset, struct spa_pod_sequence);
+	ms->writing = true;
+	ms->last_time = 0;
+	ms->cursor = NULL;
+}
+
+/* events are mostly read in order, continue from the last one */
+static struct spa_pod_control *midi_seq_get(struct midi_seq *ms, uint32_t index)
+{
+	uint32_t size = midi_seq_size(ms);
+	struct spa_pod_control *c;
+
+	if (ms->cursor == NULL || index < ms->cursor_index) {
+		ms->cursor = spa_pod_control_first(&ms->seq->body);
+		ms->cursor_index = 0;
+	}
+	for (c = ms->cursor; spa_pod_control_is_inside(&ms->seq->body, size, c);
+	     c = spa_pod_control_next(c)) {
+		if (c->type != SPA_CONTROL_Midi)
+			continue;
+		if (ms->cursor_index == index) {
+			ms->cursor = c;
+			return c;
+		}
+		ms->cursor_index++;
+	}
+	ms->cursor = NULL;
+	return NULL;
+}
+
 struct buffer {
 	struct spa_list link;
 #define BUFFER_FLAG_OUT		(1<<0)
@@ -167,6 +276,7 @@ struct link {
 	struct pw_memmap *mem;
 	struct pw_node_activation *activation;
 	int signalfd;
+	unsigned int wakeup:1;
 };
 
 struct mix {
@@ -195,6 +305,9 @@ struct port {
 	struct spa_io_buffers io;
 	struct spa_list mix;
 
+	struct spa_latency_info latency[2];
+	bool have_latency;
+
 	bool zeroed;
 	float *emptyptr;
 	float empty[MAX_BUFFER_FRAMES + MAX_ALIGN];
@@ -209,6 +322,11 @@ struct context {
 	struct spa_list ports;
 	struct spa_list nodes;
 	struct spa_list links;
+
+	struct spa_list port_names[HASH_SIZE];
+	struct spa_list port_aliases1[HASH_SIZE];
+	struct spa_list port_aliases2[HASH_SIZE];
+	struct spa_list port_links[HASH_SIZE];
 };
 
 #define GET_DIRECTION(f)	((f) & JackPortIsInput ? SPA_DIRECTION_INPUT : SPA_DIRECTION_OUTPUT)
@@ -229,6 +347,8 @@ struct client {
 
 	struct pw_data_loop *loop;
 
+	struct mix_ops mix_ops;
+
 	struct pw_core *core;
 	struct spa_hook core_listener;
 	struct pw_mempool *pool;
@@ -303,12 +423,17 @@ struct client {
 	struct pw_node_activation *activation;
 	uint32_t xrun_count;
 
+	bool wakeup;			/* wait with pw_node_activation_wait() */
+	uint32_t wakeup_seq;
+	uint32_t wakeup_spin;
+
 	unsigned int started:1;
 	unsigned int active:1;
 	unsigned int destroyed:1;
 	unsigned int first:1;
 	unsigned int thread_entered:1;
 	unsigned int has_transport:1;
+	unsigned int can_wakeup:1;
 
 	jack_position_t jack_position;
 	jack_transport_state_t jack_state;
@@ -351,8 +476,68 @@ static struct object * alloc_object(struct client *c)
 	return o;
 }
 
+static inline uint32_t hash_string(const char *str)
+{
+	uint32_t hash = 2166136261u;
+
+	while (*str) {
+		hash ^= (uint8_t) *str++;
+		hash *= 16777619u;
+	}
+	return hash & (HASH_SIZE - 1);
+}
+
+static inline uint32_t hash_port_link(uint32_t src, uint32_t dst)
+{
+	uint32_t hash = (src * 2654435761u) ^ dst;
+	return (hash ^ (hash >> 16)) & (HASH_SIZE - 1);
+}
+
+static void unhash_object(struct client *c, struct object *o)
+{
+	if (o->hashed & HASHED_NAME)
+		spa_list_remove(&o->hash_link);
+	if (o->hashed & HASHED_ALIAS1)
+		spa_list_remove(&o->alias1_link);
+	if (o->hashed & HASHED_ALIAS2)
+		spa_list_remove(&o->alias2_link);
+	o->hashed = 0;
+}
+
+/* add the object to the lookup tables, call again after changing
+ * the name or the aliases of a port */
+static void hash_object(struct client *c, struct object *o)
+{
+	struct context *ctx = &c->context;
+
+	unhash_object(c, o);
+
+	switch (o->type) {
+	case INTERFACE_Port:
+		spa_list_append(&ctx->port_names[hash_string(o->port.name)], &o->hash_link);
+		o->hashed |= HASHED_NAME;
+		if (o->port.alias1[0] != '\0') {
+			spa_list_append(&ctx->port_aliases1[hash_string(o->port.alias1)],
+					&o->alias1_link);
+			o->hashed |= HASHED_ALIAS1;
+		}
+		if (o->port.alias2[0] != '\0') {
+			spa_list_append(&ctx->port_aliases2[hash_string(o->port.alias2)],
+					&o->alias2_link);
+			o->hashed |= HASHED_ALIAS2;
+		}
+		break;
+	case INTERFACE_Link:
+		spa_list_append(&ctx->port_links[hash_port_link(o->port_link.src, o->port_link.dst)],
+				&o->hash_link);
+		o->hashed |= HASHED_NAME;
+		break;
+	}
+}
+
 static void free_object(struct client *c, struct object *o)
 {
+	unhash_object(c, o);
         spa_list_remove(&o->link);
 	spa_list_append(&c->context.free_objects, &o->link);
 }
@@ -414,10 +599,16 @@ static struct port * alloc_port(struct client *c, enum spa_direction direction)
 	o->id = SPA_ID_INVALID;
 	o->port.node_id = c->node_id;
 	o->port.port_id = p->id;
+	o->port.alias1[0] = '\0';
+	o->port.alias2[0] = '\0';
+	o->port.proxy = NULL;
 	spa_list_append(&c->context.ports, &o->link);
 
 	p->valid = true;
 	p->zeroed = false;
+	p->latency[SPA_DIRECTION_INPUT] = SPA_LATENCY_INFO(SPA_DIRECTION_INPUT);
+	p->latency[SPA_DIRECTION_OUTPUT] = SPA_LATENCY_INFO(SPA_DIRECTION_OUTPUT);
+	p->have_latency = false;
 	p->client = c;
 	p->object = o;
 	spa_list_init(&p->mix);
@@ -443,22 +634,43 @@ static void free_port(struct client *c, struct port *p)
 	spa_list_append(&c->free_ports[p->direction], &p->link);
 }
 
-static struct object *find_port(struct client *c, const char *name)
+static struct object *find_port_by_name(struct client *c, const char *name)
 {
 	struct object *o;
 
-	spa_list_for_each(o, &c->context.ports, link) {
+	spa_list_for_each(o, &c->context.port_names[hash_string(name)], hash_link) {
 		if (!strcmp(o->port.name, name))
 			return o;
 	}
 	return NULL;
 }
 
+/* like jack, also find ports by their aliases */
+static struct object *find_port(struct client *c, const char *name)
+{
+	struct object *o;
+	uint32_t hash;
+
+	if ((o = find_port_by_name(c, name)) != NULL)
+		return o;
+
+	hash = hash_string(name);
+	spa_list_for_each(o, &c->context.port_aliases1[hash], alias1_link) {
+		if (!strcmp(o->port.alias1, name))
+			return o;
+	}
+	spa_list_for_each(o, &c->context.port_aliases2[hash], alias2_link) {
+		if (!strcmp(o->port.alias2, name))
+			return o;
+	}
+	return NULL;
+}
+
 static struct object *find_link(struct client *c, uint32_t src, uint32_t dst)
 {
 	struct object *l;
 
-	spa_list_for_each(l, &c->context.links, link) {
+	spa_list_for_each(l, &c->context.port_links[hash_port_link(src, dst)], hash_link) {
 		if (l->port_link.src == src &&
 		    l->port_link.dst == dst) {
 			return l;
@@ -481,42 +693,6 @@ static struct buffer *dequeue_buffer(struct mix *mix)
         return b;
 }
 
-#if defined (__SSE__)
-#include <xmmintrin.h>
-static void mix2_sse(float *dst, float *src1, float *src2, int n_samples)
-{
-	int n, unrolled;
-	__m128 in[2];
-
-	if (SPA_IS_ALIGNED(src1, 16) &&
-	    SPA_IS_ALIGNED(src2, 16) &&
-	    SPA_IS_ALIGNED(dst, 16))
-		unrolled = n_samples / 4;
-	else
-		unrolled = 0;
-
-	for (n = 0; unrolled--; n += 4) {
-		in[0] = _mm_load_ps(&src1[n]),
-		in[1] = _mm_load_ps(&src2[n]),
-		in[0] = _mm_add_ps(in[0], in[1]);
-		_mm_store_ps(&dst[n], in[0]);
-	}
-	for (; n < n_samples; n++) {
-		in[0] = _mm_load_ss(&src1[n]),
-		in[1] = _mm_load_ss(&src2[n]),
-		in[0] = _mm_add_ss(in[0], in[1]);
-		_mm_store_ss(&dst[n], in[0]);
-	}
-}
-#endif
-
-static void mix2_c(float *dst, float *src1, float *src2, int n_samples)
-{
-	int i;
-	for (i = 0; i < n_samples; i++)
-		dst[i] = src1[i] + src2[i];
-}
-
 SPA_EXPORT
 void jack_get_version(int *major_ptr, int *minor_ptr, int *micro_ptr, int *proto_ptr)
 {
@@ -649,50 +825,35 @@ static void reuse_buffer(struct client *c, struct mix *mix, uint32_t id)
 
 static void convert_from_midi(void *midi, void *buffer, size_t size)
 {
+	struct midi_buffer *mb = midi;
+	struct midi_event *ev = SPA_MEMBER(mb, sizeof(*mb), struct midi_event);
 	struct spa_pod_builder b = { 0, };
-	uint32_t i, count;
+	uint32_t i;
 	struct spa_pod_frame f;
-
-	count = jack_midi_get_event_count(midi);
+	uint8_t *data;
 
 	spa_pod_builder_init(&b, buffer, size);
 	spa_pod_builder_push_sequence(&b, &f, 0);
 
-	for (i = 0; i < count; i++) {
-		jack_midi_event_t ev;
-		jack_midi_event_get(&ev, midi, i);
-		spa_pod_builder_control(&b, ev.time, SPA_CONTROL_Midi);
-		spa_pod_builder_bytes(&b, ev.buffer, ev.size);
+	for (i = 0; i < mb->event_count; i++) {
+		if ((data = spa_pod_builder_control_bytes(&b, ev[i].time,
+				SPA_CONTROL_Midi, ev[i].size)) == NULL)
+			break;
+		memcpy(data, midi_event_data(midi, &ev[i]), ev[i].size);
 	}
         spa_pod_builder_pop(&b, &f);
 }
 
 static void convert_to_midi(struct spa_pod_sequence **seq, uint32_t n_seq, void *midi)
 {
-	struct spa_pod_control *c[n_seq];
+	struct spa_pod_control *c[n_seq], *next;
 	uint32_t i;
 
 	for (i = 0; i < n_seq; i++) {
 		c[i] = spa_pod_control_first(&seq[i]->body);
 	}
 
-	while (true) {
-		struct spa_pod_control *next = NULL;
-		uint32_t next_index = 0;
-
-		for (i = 0; i < n_seq; i++) {
-			if (!spa_pod_control_is_inside(&seq[i]->body,
-						SPA_POD_BODY_SIZE(seq[i]), c[i]))
-				continue;
-
-			if (next == NULL || c[i]->offset < next->offset) {
-				next = c[i];
-				next_index = i;
-			}
-		}
-		if (next == NULL)
-			break;
-
+	while ((next = spa_pod_sequence_merge_next(seq, c, n_seq)) != NULL) {
 		switch(next->type) {
 		case SPA_CONTROL_Midi:
 			jack_midi_event_write(midi,
@@ -701,7 +862,6 @@ static void convert_to_midi(struct spa_pod_sequence **seq, uint32_t n_seq, void
 					SPA_POD_BODY_SIZE(&next->value));
 			break;
 		}
-		c[next_index] = spa_pod_control_next(c[next_index]);
 	}
 }
 
@@ -754,9 +914,18 @@ static void process_tee(struct client *c)
 	struct port *p;
 
 	spa_list_for_each(p, &c->ports[SPA_DIRECTION_OUTPUT], link) {
+		struct midi_seq *ms = (struct midi_seq *) p->emptyptr;
+		void *ptr;
+
 		if (p->object->port.type_id != 1)
 			continue;
-		void *ptr = get_buffer_output(c, p, MAX_BUFFER_FRAMES, 1);
+		if (ms->buffer.magic == MIDI_SEQ_MAGIC) {
+			/* the client wrote its events in the buffer */
+			spa_pod_builder_pop(&ms->b, &ms->f);
+			init_midi_buffer(&ms->buffer, MAX_BUFFER_FRAMES);
+			continue;
+		}
+		ptr = get_buffer_output(c, p, MAX_BUFFER_FRAMES, 1);
 		if (ptr != NULL)
 			convert_from_midi(p->emptyptr, ptr, MAX_BUFFER_FRAMES * sizeof(float));
 	}
@@ -886,24 +1055,14 @@ static inline jack_transport_state_t position_to_jack(struct pw_node_activation
 	return state;
 }
 
-static inline uint32_t cycle_run(struct client *c)
+static inline uint32_t cycle_process(struct client *c)
 {
-	uint64_t cmd, nsec;
-	int fd = c->socket_source->fd;
+	uint64_t nsec;
 	uint32_t buffer_frames, sample_rate;
 	struct spa_io_position *pos = c->position;
 	struct pw_node_activation *activation = c->activation;
 	struct pw_node_activation *driver = c->driver_activation;
 
-	/* this is blocking if nothing ready */
-	if (read(fd, &cmd, sizeof(cmd)) != sizeof(cmd)) {
-		pw_log_warn(NAME" %p: read failed %m", c);
-		if (errno == EWOULDBLOCK)
-			return 0;
-	}
-	if (cmd > 1)
-		pw_log_warn(NAME" %p: missed %"PRIu64" wakeups", c, cmd - 1);
-
 	if (pos == NULL) {
 		pw_log_error(NAME" %p: missing position", c);
 		return 0;
@@ -954,10 +1113,50 @@ static inline uint32_t cycle_run(struct client *c)
 	return buffer_frames;
 }
 
+static inline uint32_t cycle_run(struct client *c)
+{
+	uint64_t cmd;
+	int fd = c->socket_source->fd;
+
+	/* this is blocking if nothing ready */
+	if (read(fd, &cmd, sizeof(cmd)) != sizeof(cmd)) {
+		pw_log_warn(NAME" %p: read failed %m", c);
+		if (errno == EWOULDBLOCK)
+			return 0;
+	}
+	if (cmd > 1)
+		pw_log_warn(NAME" %p: missed %"PRIu64" wakeups", c, cmd - 1);
+
+	if (c->can_wakeup)
+		c->wakeup_seq = ATOMIC_LOAD(c->activation->wakeup_seq);
+
+	return cycle_process(c);
+}
+
+/* spin and sleep on the futex in the activation until the next cycle,
+ * returns false when we need to wait on the eventfd instead */
+static inline bool cycle_wakeup_wait(struct client *c)
+{
+	if (!ATOMIC_LOAD(c->wakeup))
+		return false;
+	return pw_node_activation_wait(c->activation, &c->wakeup_seq,
+			&c->wakeup_spin, true) == 1;
+}
+
+static void stop_wakeup(struct client *c)
+{
+	ATOMIC_STORE(c->wakeup, false);
+	if (c->can_wakeup)
+		pw_node_activation_kick(c->activation);
+}
+
 static inline uint32_t cycle_wait(struct client *c)
 {
 	int res;
 
+	if (cycle_wakeup_wait(c))
+		return cycle_process(c);
+
 	res = pw_data_loop_wait(c->loop, -1);
 	if (res <= 0) {
 		pw_log_warn(NAME" %p: wait error %m", c);
@@ -998,7 +1197,8 @@ static inline void signal_sync(struct client *c)
 
 			pw_log_trace(NAME" %p: signal %p %p", c, l, state);
 
-			if (write(l->signalfd, &cmd, sizeof(cmd)) != sizeof(cmd))
+			if ((!l->wakeup || pw_node_activation_wakeup(l->activation)) &&
+			    write(l->signalfd, &cmd, sizeof(cmd)) != sizeof(cmd))
 				pw_log_warn(NAME" %p: write failed %m", c);
 		}
 	}
@@ -1055,6 +1255,17 @@ on_rtsocket_condition(void *data, int fd, uint32_t mask)
 		status = c->process_callback ? c->process_callback(buffer_frames, c->process_arg) : 0;
 
 		cycle_signal(c, status);
+
+		/* run the next cycles from here for as long as we are woken
+		 * up without the eventfd */
+		while (c->started && cycle_wakeup_wait(c)) {
+			buffer_frames = cycle_process(c);
+
+			status = c->process_callback ?
+				c->process_callback(buffer_frames, c->process_arg) : 0;
+
+			cycle_signal(c, status);
+		}
 	}
 }
 
@@ -1073,6 +1284,7 @@ static void clean_transport(struct client *c)
 	if (!c->has_transport)
 		return;
 
+	stop_wakeup(c);
 	pw_data_loop_stop(c->loop);
 
 	unhandle_socket(c);
@@ -1104,6 +1316,15 @@ static int client_node_transport(void *object,
 	pw_log_debug(NAME" %p: create client transport with fds %d %d for node %u",
 			c, readfd, writefd, c->node_id);
 
+	c->can_wakeup = size >= sizeof(struct pw_node_activation);
+	if (c->can_wakeup) {
+		SPA_FLAG_SET(c->activation->flags, PW_NODE_ACTIVATION_FLAG_WAKEUP);
+		c->wakeup_seq = ATOMIC_LOAD(c->activation->wakeup_seq);
+		c->wakeup_spin = sysconf(_SC_NPROCESSORS_ONLN) > 1 ?
+			PW_NODE_ACTIVATION_SPIN_MIN : 0;
+		c->wakeup = c->active;
+	}
+
 	close(writefd);
 	c->socket_source = pw_loop_add_io(c->loop->loop,
 					  readfd,
@@ -1198,6 +1419,8 @@ static int client_node_command(void *object, const struct spa_command *command)
 					  c->socket_source, SPA_IO_ERR | SPA_IO_HUP);
 
 			c->started = false;
+			if (c->can_wakeup)
+				pw_node_activation_kick(c->activation);
 		}
 		break;
 
@@ -1334,7 +1557,7 @@ static int param_buffers(struct client *c, struct port *p,
 								MAX_BUFFER_FRAMES * sizeof(float),
 								sizeof(float)),
 			SPA_PARAM_BUFFERS_stride,  SPA_POD_Int(4),
-			SPA_PARAM_BUFFERS_align,   SPA_POD_Int(16));
+			SPA_PARAM_BUFFERS_align,   SPA_POD_Int(MAX_ALIGN));
 		break;
 	case 2:
 		*param = spa_pod_builder_add_object(b,
@@ -1364,6 +1587,42 @@ static int param_io(struct client *c, struct port *p,
 	return 1;
 }
 
+static int param_latency(struct client *c, struct port *p,
+		struct spa_pod **param, struct spa_pod_builder *b)
+{
+	enum spa_direction direction = SPA_DIRECTION_REVERSE(p->direction);
+	jack_latency_range_t *range;
+	struct spa_latency_info info;
+
+	/* only the latency set by the application is reported */
+	if (!p->have_latency)
+		return 0;
+
+	range = direction == SPA_DIRECTION_INPUT ?
+		&p->object->port.capture_latency :
+		&p->object->port.playback_latency;
+
+	info = SPA_LATENCY_INFO(direction,
+			.min_rate = range->min,
+			.max_rate = range->max);
+	*param = spa_latency_build(b, SPA_PARAM_Latency, &info);
+	return 1;
+}
+
+static uint32_t port_get_params(struct client *c, struct port *p,
+		struct spa_pod **params, struct spa_pod_builder *b)
+{
+	uint32_t n_params = 4;
+
+	param_enum_format(c, p, &params[0], b);
+	param_format(c, p, &params[1], b);
+	param_buffers(c, p, &params[2], b);
+	param_io(c, p, &params[3], b);
+	n_params += param_latency(c, p, &params[4], b);
+
+	return n_params;
+}
+
 static int port_set_format(struct client *c, struct port *p,
 		uint32_t flags, const struct spa_pod *param)
 {
@@ -1414,6 +1673,31 @@ static int port_set_format(struct client *c, struct port *p,
 	return 0;
 }
 
+static void port_set_latency(struct client *c, struct port *p,
+		uint32_t flags, const struct spa_pod *param)
+{
+	struct spa_latency_info info;
+	jack_latency_callback_mode_t mode;
+
+	if (param == NULL || spa_latency_parse(param, &info) < 0)
+		return;
+	if (spa_latency_info_compare(&p->latency[info.direction], &info) == 0)
+		return;
+
+	pw_log_debug(NAME" %p: port %p %s latency quantum:%f-%f rate:%u-%u ns:%"PRIu64"-%"PRIu64,
+			c, p, info.direction == SPA_DIRECTION_INPUT ? "capture" : "playback",
+			info.min_quantum, info.max_quantum, info.min_rate, info.max_rate,
+			info.min_ns, info.max_ns);
+
+	p->latency[info.direction] = info;
+
+	if (c->latency_callback) {
+		mode = info.direction == SPA_DIRECTION_INPUT ?
+			JackCaptureLatency : JackPlaybackLatency;
+		c->latency_callback(mode, c->latency_arg);
+	}
+}
+
 static int client_node_port_set_param(void *object,
                                 enum spa_direction direction,
                                 uint32_t port_id,
@@ -1422,26 +1706,31 @@ static int client_node_port_set_param(void *object,
 {
 	struct client *c = (struct client *) object;
 	struct port *p = GET_PORT(c, direction, port_id);
-	struct spa_pod *params[4];
+	struct spa_pod *params[5];
+	uint32_t n_params;
 	uint8_t buffer[4096];
 	struct spa_pod_builder b = SPA_POD_BUILDER_INIT(buffer, sizeof(buffer));
 
 	pw_log_debug("port %p: %d.%d id:%d %p", p, direction, port_id, id, param);
 
-        if (id == SPA_PARAM_Format) {
+	switch (id) {
+	case SPA_PARAM_Format:
 		port_set_format(c, p, flags, param);
+		break;
+	case SPA_PARAM_Latency:
+		port_set_latency(c, p, flags, param);
+		break;
+	default:
+		break;
 	}
 
-	param_enum_format(c, p, &params[0], &b);
-	param_format(c, p, &params[1], &b);
-	param_buffers(c, p, &params[2], &b);
-	param_io(c, p, &params[3], &b);
+	n_params = port_get_params(c, p, params, &b);
 
 	return pw_client_node_port_update(c->node,
 					 direction,
 					 port_id,
 					 PW_CLIENT_NODE_PORT_UPDATE_PARAMS,
-					 4,
+					 n_params,
 					 (const struct spa_pod **) params,
 					 NULL);
 }
@@ -1450,12 +1739,7 @@ static void init_buffer(struct port *p, void *data, size_t maxframes)
 {
 	if (p->object->port.type_id == 1) {
 		struct midi_buffer *mb = data;
-		mb->magic = MIDI_BUFFER_MAGIC;
-		mb->buffer_size = MAX_BUFFER_FRAMES * sizeof(float);
-		mb->nframes = maxframes;
-		mb->write_pos = 0;
-		mb->event_count = 0;
-		mb->lost_events = 0;
+		init_midi_buffer(mb, maxframes);
 		pw_log_debug("port %p: init midi buffer %p size:%d", p, data, mb->buffer_size);
 	}
 	else
@@ -1705,6 +1989,7 @@ static int client_node_set_activation(void *object,
 		link->mem = mm;
 		link->activation = ptr;
 		link->signalfd = signalfd;
+		link->wakeup = size >= sizeof(struct pw_node_activation);
 	}
 	else {
 		link = find_activation(&c->links, node_id);
@@ -1807,6 +2092,29 @@ static const struct pw_metadata_events metadata_events = {
 	.property = metadata_property
 };
 
+static void port_param(void *object, int seq,
+		uint32_t id, uint32_t index, uint32_t next,
+		const struct spa_pod *param)
+{
+	struct object *o = object;
+	struct spa_latency_info info;
+
+	if (id != SPA_PARAM_Latency || param == NULL ||
+	    spa_latency_parse(param, &info) < 0)
+		return;
+
+	pw_log_debug(NAME" %p: port %d %s latency %f-%f", o->client, o->id,
+			info.direction == SPA_DIRECTION_INPUT ? "capture" : "playback",
+			info.min_quantum, info.max_quantum);
+	o->port.latency[info.direction] = info;
+	o->port.have_latency[info.direction] = true;
+}
+
+static const struct pw_port_events port_events = {
+	PW_VERSION_PORT_EVENTS,
+	.param = port_param,
+};
+
 static void registry_event_global(void *data, uint32_t id,
                                   uint32_t permissions, const char *type, uint32_t version,
                                   const struct spa_dict *props)
@@ -1882,7 +2190,7 @@ static void registry_event_global(void *data, uint32_t id,
 		o = NULL;
 		if (node_id == c->node_id) {
 			snprintf(full_name, sizeof(full_name), "%s:%s", c->name, str);
-			o = find_port(c, full_name);
+			o = find_port_by_name(c, full_name);
 			if (o != NULL)
 				pw_log_debug(NAME" %p: %s found our port %p", c, full_name, o);
 		}
@@ -1899,6 +2207,19 @@ static void registry_event_global(void *data, uint32_t id,
 			snprintf(o->port.name, sizeof(o->port.name), "%s:%s", ot->node.name, str);
 			o->port.port_id = SPA_ID_INVALID;
 			o->port.priority = ot->node.priority;
+			o->port.have_latency[0] = o->port.have_latency[1] = false;
+
+			/* follow the latency the graph computes for the port */
+			o->port.proxy = pw_registry_bind(c->registry,
+					id, type, PW_VERSION_PORT, 0);
+			if (o->port.proxy != NULL) {
+				uint32_t ids[1] = { SPA_PARAM_Latency };
+
+				pw_proxy_add_object_listener(o->port.proxy,
+						&o->port.object_listener, &port_events, o);
+				pw_port_subscribe_params((struct pw_port*)o->port.proxy,
+						ids, SPA_N_ELEMENTS(ids));
+			}
 		}
 
 		if ((str = spa_dict_lookup(props, PW_KEY_OBJECT_PATH)) != NULL)
@@ -1965,6 +2286,7 @@ static void registry_event_global(void *data, uint32_t id,
 
 	o->type = object_type;
 	o->id = id;
+	hash_object(c, o);
 
         size = pw_map_get_size(&c->context.globals);
         while (id > size)
@@ -2027,6 +2349,11 @@ static void registry_event_global_remove(void *object, uint32_t id)
 	}
 	pw_thread_loop_lock(c->context.loop);
 
+	if (o->type == INTERFACE_Port && o->port.proxy != NULL) {
+		pw_proxy_destroy(o->port.proxy);
+		o->port.proxy = NULL;
+	}
+
 	/* JACK clients expect the objects to hang around after
 	 * they are unregistered. We keep them in the map but reuse the
 	 * object when we can
@@ -2074,18 +2401,21 @@ jack_client_t * jack_client_open (const char *client_name,
 	spa_list_init(&client->context.nodes);
 	spa_list_init(&client->context.ports);
 	spa_list_init(&client->context.links);
+	for (i = 0; i < HASH_SIZE; i++) {
+		spa_list_init(&client->context.port_names[i]);
+		spa_list_init(&client->context.port_aliases1[i]);
+		spa_list_init(&client->context.port_aliases2[i]);
+		spa_list_init(&client->context.port_links[i]);
+	}
 
 	support = pw_context_get_support(client->context.context, &n_support);
 
-	mix2 = mix2_c;
 	cpu_iface = spa_support_find(support, n_support, SPA_TYPE_INTERFACE_CPU);
-	if (cpu_iface) {
-#if defined (__SSE__)
-		uint32_t flags = spa_cpu_get_flags(cpu_iface);
-		if (flags & SPA_CPU_FLAG_SSE)
-			mix2 = mix2_sse;
-#endif
-	}
+	client->mix_ops.fmt = SPA_AUDIO_FORMAT_F32;
+	client->mix_ops.n_channels = 1;
+	client->mix_ops.cpu_flags = cpu_iface ? spa_cpu_get_flags(cpu_iface) : 0;
+	if (mix_ops_init(&client->mix_ops) < 0)
+		goto init_failed;
 
 	client->loop = pw_data_loop_new(NULL);
 	if (client->loop == NULL)
@@ -2222,6 +2552,8 @@ int jack_client_close (jack_client_t *client)
 	pw_context_destroy(c->context.context);
 	pw_thread_loop_destroy(c->context.loop);
 
+	mix_ops_free(&c->mix_ops);
+
 	pw_log_debug(NAME" %p: free", client);
 	free(c);
 
@@ -2306,6 +2638,7 @@ static int do_activate(struct client *c)
 	int res;
 
 	pw_data_loop_start(c->loop);
+	ATOMIC_STORE(c->wakeup, c->can_wakeup);
 
 	pw_thread_loop_lock(c->context.loop);
 	pw_log_debug(NAME" %p: activate", c);
@@ -2356,6 +2689,7 @@ int jack_deactivate (jack_client_t *client)
 
 	pw_thread_loop_unlock(c->context.loop);
 
+	stop_wakeup(c);
 	pw_data_loop_stop(c->loop);
 
 	if (res < 0)
@@ -2781,8 +3115,9 @@ jack_port_t * jack_port_register (jack_client_t *client,
 	port_params[1] = SPA_PARAM_INFO(SPA_PARAM_Buffers, SPA_PARAM_INFO_READ);
 	port_params[2] = SPA_PARAM_INFO(SPA_PARAM_IO, SPA_PARAM_INFO_READ);
 	port_params[3] = SPA_PARAM_INFO(SPA_PARAM_Format, SPA_PARAM_INFO_WRITE);
+	port_params[4] = SPA_PARAM_INFO(SPA_PARAM_Latency, SPA_PARAM_INFO_READ);
 	port_info.params = port_params;
-	port_info.n_params = 4;
+	port_info.n_params = 5;
 
 	param_enum_format(c, p, &params[n_params++], &b);
 	param_buffers(c, p, &params[n_params++], &b);
@@ -2790,6 +3125,8 @@ jack_port_t * jack_port_register (jack_client_t *client,
 
 	pw_thread_loop_lock(c->context.loop);
 
+	hash_object(c, o);
+
 	pw_client_node_port_update(c->node,
 					 direction,
 					 p->id,
@@ -2846,8 +3183,8 @@ static inline void *get_buffer_input_float(struct client *c, struct port *p, jac
 	struct mix *mix;
 	struct buffer *b;
 	struct spa_io_buffers *io;
-	int layer = 0;
-	void *ptr = NULL;
+	const void *src[CONNECTION_NUM_FOR_PORT];
+	uint32_t n_src = 0;
 
 	spa_list_for_each(mix, &p->mix, port_link) {
 		pw_log_trace(NAME" %p: port %p mix %d.%d get buffer %d",
@@ -2858,15 +3195,18 @@ static inline void *get_buffer_input_float(struct client *c, struct port *p, jac
 
 		io->status = SPA_STATUS_NEED_DATA;
 		b = &mix->buffers[io->buffer_id];
-		if (layer++ == 0)
-			ptr = b->datas[0].data;
-		else  {
-			mix2(p->emptyptr, ptr, b->datas[0].data, frames);
-			ptr = p->emptyptr;
-			p->zeroed = false;
-		}
+		if (n_src < CONNECTION_NUM_FOR_PORT)
+			src[n_src++] = b->datas[0].data;
 	}
-	return ptr;
+	if (n_src == 0)
+		return NULL;
+	if (n_src == 1)
+		return (void*)src[0];
+
+	/* mix all inputs in one go instead of adding them one by one */
+	mix_ops_process(&c->mix_ops, p->emptyptr, src, n_src, frames);
+	p->zeroed = false;
+	return p->emptyptr;
 }
 
 static inline void *get_buffer_input_midi(struct client *c, struct port *p, jack_nframes_t frames)
@@ -2877,8 +3217,6 @@ static inline void *get_buffer_input_midi(struct client *c, struct port *p, jack
 	struct spa_pod_sequence *seq[CONNECTION_NUM_FOR_PORT];
 	uint32_t n_seq = 0;
 
-	jack_midi_clear_buffer(ptr);
-
 	spa_list_for_each(mix, &p->mix, port_link) {
 		struct spa_data *d;
 		void *pod;
@@ -2900,6 +3238,12 @@ static inline void *get_buffer_input_midi(struct client *c, struct port *p, jack
 
 		seq[n_seq++] = pod;
 	}
+	if (n_seq == 1) {
+		/* nothing to merge, read the events from the buffer */
+		midi_seq_init_read(ptr, seq[0], MAX_BUFFER_FRAMES);
+		return ptr;
+	}
+	init_midi_buffer(ptr, MAX_BUFFER_FRAMES);
 	convert_to_midi(seq, n_seq, ptr);
 
 	return ptr;
@@ -2918,7 +3262,17 @@ static inline void *get_buffer_output_float(struct client *c, struct port *p, ja
 
 static inline void *get_buffer_output_midi(struct client *c, struct port *p, jack_nframes_t frames)
 {
-	return p->emptyptr;
+	struct midi_seq *ms = (struct midi_seq *) p->emptyptr;
+	void *ptr;
+
+	/* the buffer of this cycle, process_tee() sends it */
+	if (ms->buffer.magic == MIDI_SEQ_MAGIC)
+		return ms;
+
+	if ((ptr = get_buffer_output(c, p, MAX_BUFFER_FRAMES, 1)) != NULL)
+		midi_seq_init_write(ms, ptr, MAX_BUFFER_FRAMES * sizeof(float),
+				MAX_BUFFER_FRAMES);
+	return ms;
 }
 
 SPA_EXPORT
@@ -3203,6 +3557,8 @@ int jack_port_set_alias (jack_port_t *port, const char *alias)
 	else
 		goto error;
 
+	hash_object(c, o);
+
 	p = GET_PORT(c, GET_DIRECTION(o->port.flags), o->port.port_id);
 
 	port_info = SPA_PORT_INFO_INIT();
@@ -3508,6 +3864,37 @@ SPA_EXPORT
 void jack_port_get_latency_range (jack_port_t *port, jack_latency_callback_mode_t mode, jack_latency_range_t *range)
 {
 	struct object *o = (struct object *) port;
+	struct client *c = o->client;
+	enum spa_direction direction;
+	jack_nframes_t nframes, rate;
+	struct port *p;
+
+	direction = mode == JackCaptureLatency ?
+		SPA_DIRECTION_INPUT : SPA_DIRECTION_OUTPUT;
+
+	if (o->port.port_id != SPA_ID_INVALID) {
+		p = GET_PORT(c, GET_DIRECTION(o->port.flags), o->port.port_id);
+
+		/* the latency of our own ports comes from the graph unless the
+		 * application set it */
+		if (direction == p->direction || !p->have_latency) {
+			nframes = jack_get_buffer_size((jack_client_t *) c);
+			rate = jack_get_sample_rate((jack_client_t *) c);
+			range->min = spa_latency_info_min_frames(&p->latency[direction],
+					nframes, rate);
+			range->max = spa_latency_info_max_frames(&p->latency[direction],
+					nframes, rate);
+			return;
+		}
+	} else if (o->port.have_latency[direction]) {
+		nframes = jack_get_buffer_size((jack_client_t *) c);
+		rate = jack_get_sample_rate((jack_client_t *) c);
+		range->min = spa_latency_info_min_frames(&o->port.latency[direction],
+				nframes, rate);
+		range->max = spa_latency_info_max_frames(&o->port.latency[direction],
+				nframes, rate);
+		return;
+	}
 	if (mode == JackCaptureLatency) {
 		*range = o->port.capture_latency;
 	} else {
@@ -3515,15 +3902,76 @@ void jack_port_get_latency_range (jack_port_t *port, jack_latency_callback_mode_
 	}
 }
 
+static int port_update_latency(struct client *c, struct port *p)
+{
+	struct spa_port_info port_info;
+	struct spa_param_info port_params[5];
+	struct spa_pod *params[5];
+	uint32_t n_params;
+	uint8_t buffer[4096];
+	struct spa_pod_builder b = SPA_POD_BUILDER_INIT(buffer, sizeof(buffer));
+
+	port_info = SPA_PORT_INFO_INIT();
+	port_info.change_mask |= SPA_PORT_CHANGE_MASK_PARAMS;
+	port_params[0] = SPA_PARAM_INFO(SPA_PARAM_EnumFormat, SPA_PARAM_INFO_READ);
+	port_params[1] = SPA_PARAM_INFO(SPA_PARAM_Buffers, SPA_PARAM_INFO_READ);
+	port_params[2] = SPA_PARAM_INFO(SPA_PARAM_IO, SPA_PARAM_INFO_READ);
+	port_params[3] = SPA_PARAM_INFO(SPA_PARAM_Format, SPA_PARAM_INFO_WRITE);
+	port_params[4] = SPA_PARAM_INFO(SPA_PARAM_Latency, SPA_PARAM_INFO_READ);
+	port_info.params = port_params;
+	port_info.n_params = 5;
+
+	n_params = port_get_params(c, p, params, &b);
+
+	return pw_client_node_port_update(c->node,
+					 p->direction,
+					 p->id,
+					 PW_CLIENT_NODE_PORT_UPDATE_PARAMS |
+					 PW_CLIENT_NODE_PORT_UPDATE_INFO,
+					 n_params,
+					 (const struct spa_pod **) params,
+					 &port_info);
+}
+
 SPA_EXPORT
 void jack_port_set_latency_range (jack_port_t *port, jack_latency_callback_mode_t mode, jack_latency_range_t *range)
 {
 	struct object *o = (struct object *) port;
-	if (mode == JackCaptureLatency) {
-		o->port.capture_latency = *range;
-	} else {
-		o->port.playback_latency = *range;
+	struct client *c = o->client;
+	enum spa_direction direction;
+	jack_latency_range_t *current;
+	struct port *p;
+
+	direction = mode == JackCaptureLatency ?
+		SPA_DIRECTION_INPUT : SPA_DIRECTION_OUTPUT;
+	current = mode == JackCaptureLatency ?
+		&o->port.capture_latency : &o->port.playback_latency;
+
+	if (o->port.port_id == SPA_ID_INVALID) {
+		*current = *range;
+		return;
 	}
+
+	p = GET_PORT(c, GET_DIRECTION(o->port.flags), o->port.port_id);
+
+	/* the latency in the direction of the port comes from the links */
+	if (direction == p->direction)
+		return;
+
+	if (p->have_latency &&
+	    current->min == range->min && current->max == range->max)
+		return;
+
+	pw_log_debug(NAME" %p: port %p %s latency %u-%u", c, p,
+			mode == JackCaptureLatency ? "capture" : "playback",
+			range->min, range->max);
+
+	*current = *range;
+	p->have_latency = true;
+
+	pw_thread_loop_lock(c->context.loop);
+	port_update_latency(c, p);
+	pw_thread_loop_unlock(c->context.loop);
 }
 
 SPA_EXPORT
@@ -3581,6 +4029,56 @@ static int port_compare_func(const void *v1, const void *v2)
 	return res;
 }
 
+/* the text that all names matching an anchored pattern start with, most
+ * patterns of session managers are a port name or a client name prefix */
+static size_t pattern_prefix(const char *pattern, char *prefix, size_t size, bool *exact)
+{
+	const char *p;
+	size_t len = 0;
+
+	*exact = false;
+	if (pattern[0] != '^' || strchr(pattern, '|') != NULL)
+		return 0;
+
+	for (p = pattern + 1; *p != '\0' && len + 1 < size; p++) {
+		if (strchr(".[]()*+?{}^$\\", *p) != NULL)
+			break;
+		prefix[len++] = *p;
+	}
+	if (len > 0 && (*p == '*' || *p == '?' || *p == '{'))
+		/* the last character is optional */
+		len--;
+	else if (p[0] == '$' && p[1] == '\0')
+		*exact = true;
+
+	prefix[len] = '\0';
+	return len;
+}
+
+static bool port_matches(struct client *c, struct object *o, uint32_t id,
+		unsigned long flags, regex_t *port_regex, regex_t *type_regex)
+{
+	pw_log_debug(NAME" %p: check port type:%d flags:%08lx name:%s", c,
+			o->port.type_id, o->port.flags, o->port.name);
+	if (o->port.type_id > 2)
+		return false;
+	if (!SPA_FLAG_IS_SET(o->port.flags, flags))
+		return false;
+	if (id != SPA_ID_INVALID && o->port.node_id != id)
+		return false;
+
+	if (port_regex &&
+	    regexec(port_regex, o->port.name, 0, NULL, 0) == REG_NOMATCH)
+		return false;
+	if (type_regex &&
+	    regexec(type_regex, type_to_string(o->port.type_id),
+				0, NULL, 0) == REG_NOMATCH)
+		return false;
+
+	pw_log_debug(NAME" %p: port %s prio:%d matches", c, o->port.name, o->port.priority);
+	return true;
+}
+
 SPA_EXPORT
 const char ** jack_get_ports (jack_client_t *client,
                               const char *port_name_pattern,
@@ -3593,17 +4091,25 @@ const char ** jack_get_ports (jack_client_t *client,
 	struct object *tmp[JACK_PORT_MAX];
 	const char *str;
 	uint32_t i, count, id;
-	regex_t port_regex, type_regex;
+	regex_t port_regex, type_regex, *pr = NULL, *tr = NULL;
+	char prefix[REAL_JACK_PORT_NAME_SIZE+1];
+	size_t prefix_len = 0;
+	bool exact = false;
 
 	if ((str = getenv("PIPEWIRE_NODE")) != NULL)
 		id = pw_properties_parse_int(str);
 	else
 		id = SPA_ID_INVALID;
 
-	if (port_name_pattern && port_name_pattern[0])
+	if (port_name_pattern && port_name_pattern[0]) {
 		regcomp(&port_regex, port_name_pattern, REG_EXTENDED | REG_NOSUB);
-	if (type_name_pattern && type_name_pattern[0])
+		pr = &port_regex;
+		prefix_len = pattern_prefix(port_name_pattern, prefix, sizeof(prefix), &exact);
+	}
+	if (type_name_pattern && type_name_pattern[0]) {
 		regcomp(&type_regex, type_name_pattern, REG_EXTENDED | REG_NOSUB);
+		tr = &type_regex;
+	}
 
 	pw_thread_loop_lock(c->context.loop);
 
@@ -3611,31 +4117,21 @@ const char ** jack_get_ports (jack_client_t *client,
 			port_name_pattern, type_name_pattern, flags);
 
 	count = 0;
-	spa_list_for_each(o, &c->context.ports, link) {
-		pw_log_debug(NAME" %p: check port type:%d flags:%08lx name:%s", c,
-				o->port.type_id, o->port.flags, o->port.name);
-		if (count == JACK_PORT_MAX)
-			break;
-		if (o->port.type_id > 2)
-			continue;
-		if (!SPA_FLAG_IS_SET(o->port.flags, flags))
-			continue;
-		if (id != SPA_ID_INVALID && o->port.node_id != id)
-			continue;
-
-		if (port_name_pattern && port_name_pattern[0]) {
-			if (regexec(&port_regex, o->port.name, 0, NULL, 0) == REG_NOMATCH)
-				continue;
-		}
-		if (type_name_pattern && type_name_pattern[0]) {
-			if (regexec(&type_regex, type_to_string(o->port.type_id),
-						0, NULL, 0) == REG_NOMATCH)
+	if (exact) {
+		/* only the port with the name can match */
+		if ((o = find_port_by_name(c, prefix)) != NULL &&
+		    port_matches(c, o, id, flags, pr, tr))
+			tmp[count++] = o;
+	} else {
+		spa_list_for_each(o, &c->context.ports, link) {
+			if (count == JACK_PORT_MAX)
+				break;
+			/* skip the ports that can't match before running the regex */
+			if (prefix_len > 0 && strncmp(o->port.name, prefix, prefix_len) != 0)
 				continue;
+			if (port_matches(c, o, id, flags, pr, tr))
+				tmp[count++] = o;
 		}
-
-		pw_log_debug(NAME" %p: port %s prio:%d matches (%d)",
-				c, o->port.name, o->port.priority, count);
-		tmp[count++] = o;
 	}
 	if (count > 0) {
 		qsort(tmp, count, sizeof(struct object *), port_compare_func);
@@ -4154,15 +4650,6 @@ void jack_set_thread_creator (jack_thread_creator_t creator)
 		globals.creator = creator;
 }
 
-static inline uint8_t * midi_event_data (void* port_buffer,
-                      const struct midi_event* event)
-{
-        if (event->size <= MIDI_INLINE_MAX)
-                return (uint8_t *)event->inline_data;
-        else
-                return SPA_MEMBER(port_buffer, event->byte_offset, uint8_t);
-}
-
 SPA_EXPORT
 uint32_t jack_midi_get_event_count(void* port_buffer)
 {
@@ -4177,6 +4664,20 @@ int jack_midi_event_get(jack_midi_event_t *event,
 {
 	struct midi_buffer *mb = port_buffer;
 	struct midi_event *ev = SPA_MEMBER(mb, sizeof(*mb), struct midi_event);
+
+	if (event_index >= mb->event_count)
+		return -ENODATA;
+
+	if (mb->magic == MIDI_SEQ_MAGIC) {
+		struct spa_pod_control *c;
+
+		if ((c = midi_seq_get(port_buffer, event_index)) == NULL)
+			return -ENODATA;
+		event->time = c->offset;
+		event->size = SPA_POD_BODY_SIZE(&c->value);
+		event->buffer = SPA_POD_BODY(&c->value);
+		return 0;
+	}
 	ev += event_index;
 	event->time = ev->time;
 	event->size = ev->size;
@@ -4188,6 +4689,12 @@ SPA_EXPORT
 void jack_midi_clear_buffer(void *port_buffer)
 {
 	struct midi_buffer *mb = port_buffer;
+	struct midi_seq *ms = port_buffer;
+
+	if (mb->magic == MIDI_SEQ_MAGIC && ms->writing) {
+		midi_seq_init_write(ms, ms->b.data, ms->b.size, mb->nframes);
+		return;
+	}
 	mb->event_count = 0;
 	mb->write_pos = 0;
 	mb->lost_events = 0;
@@ -4205,6 +4712,16 @@ size_t jack_midi_max_event_size(void* port_buffer)
 	struct midi_buffer *mb = port_buffer;
 	size_t buffer_size = mb->buffer_size;
 
+	if (mb->magic == MIDI_SEQ_MAGIC) {
+		struct midi_seq *ms = port_buffer;
+		uint32_t avail = ms->b.size - ms->b.state.offset;
+
+		if (!ms->writing || avail < sizeof(struct spa_pod_control))
+			return 0;
+		/* the data is padded to 8 bytes */
+		return SPA_ROUND_DOWN_N(avail - sizeof(struct spa_pod_control), 8);
+	}
+
         /* (event_count + 1) below accounts for jack_midi_port_internal_event_t
          * which would be needed to store the next event */
         size_t used_size = sizeof(struct midi_buffer)
@@ -4235,6 +4752,27 @@ jack_midi_data_t* jack_midi_event_reserve(void *port_buffer,
 		goto failed;
 	}
 
+	if (mb->magic == MIDI_SEQ_MAGIC) {
+		struct midi_seq *ms = port_buffer;
+		uint8_t *res;
+
+		if (mb->event_count > 0 && time < ms->last_time) {
+			pw_log_warn("midi %p: time:%d ev:%d", port_buffer, time, mb->event_count);
+			goto failed;
+		}
+		/* checking the size first keeps the builder from overflowing */
+		if (data_size <= 0 || jack_midi_max_event_size(port_buffer) < data_size) {
+			pw_log_warn("midi %p: data_size:%zd", port_buffer, data_size);
+			goto failed;
+		}
+		if ((res = spa_pod_builder_control_bytes(&ms->b, time,
+				SPA_CONTROL_Midi, data_size)) == NULL)
+			goto failed;
+		ms->last_time = time;
+		mb->event_count += 1;
+		return res;
+	}
+
 	if (mb->event_count > 0 && time < events[mb->event_count - 1].time) {
 		pw_log_warn("midi %p: time:%d ev:%d", port_buffer, time, mb->event_count);
 		goto failed;
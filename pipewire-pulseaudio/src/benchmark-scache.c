@@ -0,0 +1,257 @@
+/* PipeWire
+ * Copyright (C) 2020 Wim Taymans <wim.taymans@gmail.com>
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 51 Franklin St, Fifth Floor,
+ * Boston, MA 02110-1301, USA.
+ */
+
+/* Measures the time from pa_context_play_sample() until the first frames
+ * of the sample are queued in the graph and compares it with opening a
+ * new playback stream for each sound. Needs a running PipeWire daemon. */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdbool.h>
+#include <string.h>
+#include <inttypes.h>
+#include <math.h>
+#include <time.h>
+
+#include <spa/utils/defs.h>
+
+#include <pulse/pulseaudio.h>
+
+#define N_PLAYS		20
+#define SAMPLE_NAME	"benchmark-beep"
+#define SAMPLE_MSEC	50
+
+static const pa_sample_spec sample_spec = {
+	.format = PA_SAMPLE_S16NE,
+	.rate = 48000,
+	.channels = 2,
+};
+
+struct data {
+	pa_mainloop *loop;
+	pa_context *context;
+
+	int16_t *samples;
+	size_t size;
+
+	bool done;
+	int success;
+};
+
+static uint64_t get_time(void)
+{
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec * UINT64_C(1000000000) + ts.tv_nsec;
+}
+
+static void iterate_until_done(struct data *d)
+{
+	d->done = false;
+	while (!d->done) {
+		if (pa_mainloop_iterate(d->loop, 1, NULL) < 0)
+			break;
+	}
+}
+
+/* let the previous sound finish so that the player is idle again */
+static void iterate_for(struct data *d, uint64_t nsec)
+{
+	uint64_t end = get_time() + nsec;
+	while (get_time() < end) {
+		pa_mainloop_iterate(d->loop, 0, NULL);
+		pa_msleep(1);
+	}
+}
+
+static void context_state(pa_context *c, void *userdata)
+{
+	struct data *d = userdata;
+	switch (pa_context_get_state(c)) {
+	case PA_CONTEXT_READY:
+		d->success = 1;
+		d->done = true;
+		break;
+	case PA_CONTEXT_FAILED:
+	case PA_CONTEXT_TERMINATED:
+		d->success = 0;
+		d->done = true;
+		break;
+	default:
+		break;
+	}
+}
+
+static void upload_write(pa_stream *s, size_t nbytes, void *userdata)
+{
+	struct data *d = userdata;
+	pa_stream_write(s, d->samples, d->size, NULL, 0, PA_SEEK_RELATIVE);
+	pa_stream_finish_upload(s);
+}
+
+static void upload_state(pa_stream *s, void *userdata)
+{
+	struct data *d = userdata;
+	switch (pa_stream_get_state(s)) {
+	case PA_STREAM_TERMINATED:
+		d->success = 1;
+		d->done = true;
+		break;
+	case PA_STREAM_FAILED:
+		d->success = 0;
+		d->done = true;
+		break;
+	default:
+		break;
+	}
+}
+
+static int upload_sample(struct data *d)
+{
+	pa_stream *s;
+
+	s = pa_stream_new(d->context, SAMPLE_NAME, &sample_spec, NULL);
+	pa_stream_set_state_callback(s, upload_state, d);
+	pa_stream_set_write_callback(s, upload_write, d);
+	pa_stream_connect_upload(s, d->size);
+	iterate_until_done(d);
+	pa_stream_unref(s);
+
+	return d->success ? 0 : -1;
+}
+
+static void play_done(pa_context *c, int success, void *userdata)
+{
+	struct data *d = userdata;
+	d->success = success;
+	d->done = true;
+}
+
+static void bench_play_sample(struct data *d)
+{
+	uint64_t t1, t2, total = 0, min = UINT64_MAX, max = 0;
+	pa_operation *o;
+	int i;
+
+	for (i = 0; i < N_PLAYS; i++) {
+		t1 = get_time();
+		o = pa_context_play_sample(d->context, SAMPLE_NAME, NULL,
+				PA_VOLUME_NORM, play_done, d);
+		if (o == NULL) {
+			fprintf(stderr, "play_sample failed: %s\n",
+					pa_strerror(pa_context_errno(d->context)));
+			return;
+		}
+		iterate_until_done(d);
+		t2 = get_time();
+		pa_operation_unref(o);
+
+		if (i > 0) {
+			/* the first play creates the player */
+			total += t2 - t1;
+			min = SPA_MIN(min, t2 - t1);
+			max = SPA_MAX(max, t2 - t1);
+		} else {
+			fprintf(stderr, "play_sample first: %"PRIu64" us\n", (t2 - t1) / 1000);
+		}
+		iterate_for(d, (SAMPLE_MSEC + 100) * UINT64_C(1000000));
+	}
+	fprintf(stderr, "play_sample:  avg %"PRIu64" us min %"PRIu64" us max %"PRIu64" us\n",
+			total / (N_PLAYS - 1) / 1000, min / 1000, max / 1000);
+}
+
+static void stream_write(pa_stream *s, size_t nbytes, void *userdata)
+{
+	struct data *d = userdata;
+	pa_stream_write(s, d->samples, SPA_MIN(nbytes, d->size), NULL, 0, PA_SEEK_RELATIVE);
+	pa_stream_set_write_callback(s, NULL, NULL);
+	d->success = 1;
+	d->done = true;
+}
+
+static void bench_stream(struct data *d)
+{
+	uint64_t t1, t2, total = 0, min = UINT64_MAX, max = 0;
+	pa_stream *s;
+	int i;
+
+	for (i = 0; i < N_PLAYS; i++) {
+		t1 = get_time();
+		s = pa_stream_new(d->context, "benchmark-stream", &sample_spec, NULL);
+		pa_stream_set_write_callback(s, stream_write, d);
+		pa_stream_connect_playback(s, NULL, NULL, 0, NULL, NULL);
+		iterate_until_done(d);
+		t2 = get_time();
+
+		total += t2 - t1;
+		min = SPA_MIN(min, t2 - t1);
+		max = SPA_MAX(max, t2 - t1);
+
+		iterate_for(d, (SAMPLE_MSEC + 100) * UINT64_C(1000000));
+		pa_stream_disconnect(s);
+		pa_stream_unref(s);
+	}
+	fprintf(stderr, "new stream:   avg %"PRIu64" us min %"PRIu64" us max %"PRIu64" us\n",
+			total / N_PLAYS / 1000, min / 1000, max / 1000);
+}
+
+int main(int argc, char *argv[])
+{
+	struct data data = { 0, };
+	uint32_t i, n_frames;
+
+	n_frames = sample_spec.rate * SAMPLE_MSEC / 1000;
+	data.size = n_frames * pa_frame_size(&sample_spec);
+	data.samples = calloc(1, data.size);
+	for (i = 0; i < n_frames; i++) {
+		int16_t v = sin(2 * M_PI * 440 * i / sample_spec.rate) * 8000;
+		data.samples[i * 2] = data.samples[i * 2 + 1] = v;
+	}
+
+	data.loop = pa_mainloop_new();
+	data.context = pa_context_new(pa_mainloop_get_api(data.loop), "benchmark-scache");
+	pa_context_set_state_callback(data.context, context_state, &data);
+
+	if (pa_context_connect(data.context, NULL, 0, NULL) < 0) {
+		fprintf(stderr, "can't connect, skipping\n");
+		goto exit;
+	}
+	iterate_until_done(&data);
+	if (!data.success) {
+		fprintf(stderr, "can't connect, skipping\n");
+		goto exit;
+	}
+
+	if (upload_sample(&data) < 0) {
+		fprintf(stderr, "upload failed: %s\n",
+				pa_strerror(pa_context_errno(data.context)));
+		goto exit;
+	}
+
+	bench_play_sample(&data);
+	bench_stream(&data);
+
+	pa_context_disconnect(data.context);
+exit:
+	pa_context_unref(data.context);
+	pa_mainloop_free(data.loop);
+	free(data.samples);
+
+	return 0;
+}
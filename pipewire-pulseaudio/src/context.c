@@ -70,6 +70,8 @@ static void context_unlink(pa_context *c)
 	c->state_callback = NULL;
 	c->state_userdata = NULL;
 
+	pa_context_stop_players(c);
+
 	spa_list_for_each_safe(s, t, &c->streams, link) {
 		pa_stream_set_state(s, c->state == PA_CONTEXT_FAILED ?
 				PA_STREAM_FAILED : PA_STREAM_TERMINATED);
@@ -869,6 +871,9 @@ pa_context *pa_context_new_with_proplist(pa_mainloop_api *mainloop, const char *
 	spa_list_init(&c->streams);
 	spa_list_init(&c->operations);
 
+	spa_list_init(&c->samples);
+	spa_list_init(&c->players);
+
 	return c;
 }
 
@@ -884,6 +889,8 @@ static void context_free(pa_context *c)
 
 	context_unlink(c);
 
+	pa_context_free_samples(c);
+
 	pw_properties_free(c->props);
 	if (c->proplist)
 		pa_proplist_free(c->proplist);
@@ -310,6 +310,10 @@ struct pa_context {
 	struct spa_list streams;
 	struct spa_list operations;
 
+	struct spa_list samples;
+	struct spa_list players;
+	uint32_t sample_index;
+
 	int no_fail:1;
 	int disconnect:1;
 };
@@ -318,6 +322,28 @@ struct global *pa_context_find_global(pa_context *c, uint32_t id);
 struct global *pa_context_find_global_by_name(pa_context *c, uint32_t mask, const char *name);
 struct global *pa_context_find_linked(pa_context *c, uint32_t id);
 
+/* an uploaded sample, converted to interleaved F32 so that playing it needs
+ * no further conversion. The cache is per context and only this client reads
+ * it, so it lives in plain memory */
+struct sample {
+	struct spa_list link;
+	int refcount;
+
+	uint32_t index;
+	char *name;
+	pa_sample_spec sample_spec;
+	pa_channel_map channel_map;
+	pa_proplist *proplist;
+	size_t bytes;
+
+	float *data;
+	uint32_t n_frames;
+};
+
+struct sample *pa_context_find_sample(pa_context *c, const char *name, uint32_t idx);
+void pa_context_stop_players(pa_context *c);
+void pa_context_free_samples(pa_context *c);
+
 #define MAX_BUFFERS     64u
 #define MASK_BUFFERS    (MAX_BUFFERS-1)
 
@@ -399,6 +425,10 @@ struct pa_stream {
 	bool mute;
 	pa_operation *drain;
 	uint64_t queued;
+
+	void *upload_data;
+	size_t upload_length;
+	size_t upload_offset;
 };
 
 void pa_stream_set_state(pa_stream *s, pa_stream_state_t st);
@@ -2069,25 +2069,125 @@ pa_operation* pa_context_stat(pa_context *c, pa_stat_info_cb_t cb, void *userdat
 	return NULL;
 }
 
+struct sample_data {
+	pa_context *context;
+	pa_sample_info_cb_t cb;
+	void *userdata;
+	const char *name;
+	uint32_t index;
+};
+
+static void sample_callback(struct sample_data *d, struct sample *s)
+{
+	pa_sample_info i;
+
+	spa_zero(i);
+	i.index = s->index;
+	i.name = s->name;
+	pa_cvolume_set(&i.volume, s->sample_spec.channels, PA_VOLUME_NORM);
+	i.sample_spec = s->sample_spec;
+	i.channel_map = s->channel_map;
+	i.duration = pa_bytes_to_usec(s->bytes, &s->sample_spec);
+	i.bytes = s->bytes;
+	i.lazy = false;
+	i.filename = NULL;
+	i.proplist = s->proplist;
+	d->cb(d->context, &i, 0, d->userdata);
+}
+
+static void sample_info(pa_operation *o, void *userdata)
+{
+	struct sample_data *d = userdata;
+	struct sample *s;
+
+	if ((s = pa_context_find_sample(d->context, d->name, d->index)) != NULL) {
+		sample_callback(d, s);
+		d->cb(d->context, NULL, 1, d->userdata);
+	} else {
+		pa_context_set_error(d->context, PA_ERR_NOENTITY);
+		d->cb(d->context, NULL, -1, d->userdata);
+	}
+	pa_operation_done(o);
+}
+
 SPA_EXPORT
 pa_operation* pa_context_get_sample_info_by_name(pa_context *c, const char *name, pa_sample_info_cb_t cb, void *userdata)
 {
-	pw_log_warn("Not Implemented");
-	return NULL;
+	pa_operation *o;
+	struct sample_data *d;
+
+	pa_assert(c);
+	pa_assert(c->refcount >= 1);
+	pa_assert(cb);
+
+	PA_CHECK_VALIDITY_RETURN_NULL(c, name && *name, PA_ERR_INVALID);
+
+	o = pa_operation_new(c, NULL, sample_info, sizeof(struct sample_data) + strlen(name) + 1);
+	d = o->userdata;
+	d->context = c;
+	d->cb = cb;
+	d->userdata = userdata;
+	d->name = strcpy(SPA_MEMBER(d, sizeof(struct sample_data), char), name);
+	d->index = PA_INVALID_INDEX;
+	pa_operation_sync(o);
+
+	return o;
 }
 
 SPA_EXPORT
 pa_operation* pa_context_get_sample_info_by_index(pa_context *c, uint32_t idx, pa_sample_info_cb_t cb, void *userdata)
 {
-	pw_log_warn("Not Implemented");
-	return NULL;
+	pa_operation *o;
+	struct sample_data *d;
+
+	pa_assert(c);
+	pa_assert(c->refcount >= 1);
+	pa_assert(cb);
+
+	PA_CHECK_VALIDITY_RETURN_NULL(c, idx != PA_INVALID_INDEX, PA_ERR_INVALID);
+
+	o = pa_operation_new(c, NULL, sample_info, sizeof(struct sample_data));
+	d = o->userdata;
+	d->context = c;
+	d->cb = cb;
+	d->userdata = userdata;
+	d->name = NULL;
+	d->index = idx;
+	pa_operation_sync(o);
+
+	return o;
+}
+
+static void sample_info_list(pa_operation *o, void *userdata)
+{
+	struct sample_data *d = userdata;
+	pa_context *c = d->context;
+	struct sample *s;
+
+	spa_list_for_each(s, &c->samples, link)
+		sample_callback(d, s);
+	d->cb(c, NULL, 1, d->userdata);
+	pa_operation_done(o);
 }
 
 SPA_EXPORT
 pa_operation* pa_context_get_sample_info_list(pa_context *c, pa_sample_info_cb_t cb, void *userdata)
 {
-	pw_log_warn("Not Implemented");
-	return NULL;
+	pa_operation *o;
+	struct sample_data *d;
+
+	pa_assert(c);
+	pa_assert(c->refcount >= 1);
+	pa_assert(cb);
+
+	o = pa_operation_new(c, NULL, sample_info_list, sizeof(struct sample_data));
+	d = o->userdata;
+	d->context = c;
+	d->cb = cb;
+	d->userdata = userdata;
+	pa_operation_sync(o);
+
+	return o;
 }
 
 SPA_EXPORT
@@ -17,39 +17,672 @@
  * Boston, MA 02110-1301, USA.
  */
 
+#include <errno.h>
+
 #include <pipewire/log.h>
+#include <spa/param/props.h>
 
 #include <pulse/scache.h>
 
 #include "internal.h"
 
+#define MAX_SAMPLE_SIZE		(16*1024*1024)
+
+/* players that are not playing are kept connected and paused so that the
+ * next sample with the same format starts without negotiation */
+#define MAX_IDLE_PLAYERS	4
+#define PLAYER_LATENCY_USEC	(10 * PA_USEC_PER_MSEC)
+
+struct player {
+	struct spa_list link;
+	pa_context *context;
+
+	pa_stream *stream;
+	char *dev;
+
+	struct sample *sample;
+	uint32_t offset;
+	float volume;
+	float stream_volume;	/* the volume set on the stream */
+	bool draining;
+	bool exclusive;		/* has its own properties, not shared */
+
+	pa_operation *operation;
+	pa_defer_event *free_event;
+};
+
+static int16_t alaw_to_s16(uint8_t a)
+{
+	int16_t t, seg;
+
+	a ^= 0x55;
+	t = (a & 0x0f) << 4;
+	seg = (a & 0x70) >> 4;
+	switch (seg) {
+	case 0:
+		t += 8;
+		break;
+	case 1:
+		t += 0x108;
+		break;
+	default:
+		t += 0x108;
+		t <<= seg - 1;
+		break;
+	}
+	return (a & 0x80) ? t : -t;
+}
+
+static int16_t ulaw_to_s16(uint8_t u)
+{
+	int16_t t;
+
+	u = ~u;
+	t = ((u & 0x0f) << 3) + 0x84;
+	t <<= (u & 0x70) >> 4;
+	return (u & 0x80) ? (0x84 - t) : (t - 0x84);
+}
+
+static inline uint32_t read_uint(const uint8_t *p, uint32_t size, bool le)
+{
+	uint32_t i, v = 0;
+	for (i = 0; i < size; i++)
+		v |= (uint32_t)p[le ? i : size - 1 - i] << (8 * i);
+	return v;
+}
+
+static float read_f32(const uint8_t *p, pa_sample_format_t format)
+{
+	union { uint32_t i; float f; } v;
+
+	switch (format) {
+	case PA_SAMPLE_U8:
+		return (p[0] - 128) / 128.0f;
+	case PA_SAMPLE_ALAW:
+		return alaw_to_s16(p[0]) / 32768.0f;
+	case PA_SAMPLE_ULAW:
+		return ulaw_to_s16(p[0]) / 32768.0f;
+	case PA_SAMPLE_S16LE:
+	case PA_SAMPLE_S16BE:
+		return (int16_t)read_uint(p, 2, format == PA_SAMPLE_S16LE) / 32768.0f;
+	case PA_SAMPLE_S24LE:
+	case PA_SAMPLE_S24BE:
+		return (int32_t)(read_uint(p, 3, format == PA_SAMPLE_S24LE) << 8) / 2147483648.0f;
+	case PA_SAMPLE_S24_32LE:
+	case PA_SAMPLE_S24_32BE:
+		return (int32_t)(read_uint(p, 4, format == PA_SAMPLE_S24_32LE) << 8) / 2147483648.0f;
+	case PA_SAMPLE_S32LE:
+	case PA_SAMPLE_S32BE:
+		return (int32_t)read_uint(p, 4, format == PA_SAMPLE_S32LE) / 2147483648.0f;
+	case PA_SAMPLE_FLOAT32LE:
+	case PA_SAMPLE_FLOAT32BE:
+		v.i = read_uint(p, 4, format == PA_SAMPLE_FLOAT32LE);
+		return v.f;
+	default:
+		return 0.0f;
+	}
+}
+
+static struct sample *sample_new(pa_context *c, const char *name,
+		const pa_sample_spec *ss, const pa_channel_map *map, pa_proplist *p,
+		const void *data, size_t size)
+{
+	struct sample *s;
+	const uint8_t *src = data;
+	uint32_t i, n_samples, sample_size;
+	float *dst;
+
+	s = calloc(1, sizeof(struct sample));
+	if (s == NULL)
+		return NULL;
+
+	sample_size = pa_sample_size_of_format(ss->format);
+	n_samples = size / sample_size;
+
+	s->n_frames = n_samples / ss->channels;
+	s->data = malloc(n_samples * sizeof(float));
+	if (s->data == NULL) {
+		free(s);
+		return NULL;
+	}
+
+	/* convert once, playing the sample only copies */
+	dst = s->data;
+	for (i = 0; i < n_samples; i++, src += sample_size)
+		dst[i] = read_f32(src, ss->format);
+
+	s->refcount = 1;
+	s->index = c->sample_index++;
+	s->name = strdup(name);
+	s->sample_spec.format = PA_SAMPLE_FLOAT32NE;
+	s->sample_spec.rate = ss->rate;
+	s->sample_spec.channels = ss->channels;
+	if (pa_channel_map_valid(map))
+		s->channel_map = *map;
+	else
+		pa_channel_map_init_auto(&s->channel_map, ss->channels, PA_CHANNEL_MAP_DEFAULT);
+	s->proplist = pa_proplist_copy(p);
+	s->bytes = s->n_frames * pa_frame_size(&s->sample_spec);
+
+	pw_log_debug("context %p: sample %p '%s' %u frames", c, s, name, s->n_frames);
+
+	return s;
+}
+
+static struct sample *sample_ref(struct sample *s)
+{
+	s->refcount++;
+	return s;
+}
+
+static void sample_unref(struct sample *s)
+{
+	if (--s->refcount > 0)
+		return;
+
+	free(s->data);
+	pa_proplist_free(s->proplist);
+	free(s->name);
+	free(s);
+}
+
+struct sample *pa_context_find_sample(pa_context *c, const char *name, uint32_t idx)
+{
+	struct sample *s;
+
+	spa_list_for_each(s, &c->samples, link) {
+		if ((name && pa_streq(s->name, name)) ||
+		    (!name && s->index == idx))
+			return s;
+	}
+	return NULL;
+}
+
+void pa_context_free_samples(pa_context *c)
+{
+	struct sample *s;
+
+	spa_list_consume(s, &c->samples, link) {
+		spa_list_remove(&s->link);
+		sample_unref(s);
+	}
+}
+
+static void on_upload_ready(pa_operation *o, void *userdata)
+{
+	pa_stream *s = o->stream;
+
+	pa_stream_ref(s);
+	pa_operation_done(o);
+
+	pa_stream_set_state(s, PA_STREAM_READY);
+	if (s->state == PA_STREAM_READY && s->write_callback)
+		s->write_callback(s, s->upload_length, s->write_userdata);
+	pa_stream_unref(s);
+}
+
 SPA_EXPORT
 int pa_stream_connect_upload(pa_stream *s, size_t length)
 {
-	pw_log_warn("Not Implemented");
+	pa_operation *o;
+	pa_context *c = s->context;
+	size_t frame_size;
+
+	spa_assert(s);
+	spa_assert(s->refcount >= 1);
+
+	PA_CHECK_VALIDITY(c, s->state == PA_STREAM_UNCONNECTED, PA_ERR_BADSTATE);
+	PA_CHECK_VALIDITY(c, pa_sample_spec_valid(&s->sample_spec), PA_ERR_INVALID);
+
+	frame_size = pa_frame_size(&s->sample_spec);
+	PA_CHECK_VALIDITY(c, length > 0 && length % frame_size == 0, PA_ERR_INVALID);
+	PA_CHECK_VALIDITY(c, length <= MAX_SAMPLE_SIZE, PA_ERR_TOOLARGE);
+
+	pw_log_debug("stream %p: upload %zd", s, length);
+
+	s->upload_data = malloc(length);
+	if (s->upload_data == NULL)
+		PA_FAIL(c, PA_ERR_INTERNAL);
+	s->upload_length = length;
+	s->upload_offset = 0;
+	s->direction = PA_STREAM_UPLOAD;
+
+	pa_stream_set_state(s, PA_STREAM_CREATING);
+
+	o = pa_operation_new(c, s, on_upload_ready, 0);
+	pa_operation_sync(o);
+	pa_operation_unref(o);
+
 	return 0;
 }
 
+static void on_upload_finished(pa_operation *o, void *userdata)
+{
+	pa_stream_set_state(o->stream, PA_STREAM_TERMINATED);
+}
+
 SPA_EXPORT
 int pa_stream_finish_upload(pa_stream *s)
 {
-	pw_log_warn("Not Implemented");
+	pa_operation *o;
+	pa_context *c = s->context;
+	struct sample *sample, *old;
+	const char *name;
+
+	spa_assert(s);
+	spa_assert(s->refcount >= 1);
+
+	PA_CHECK_VALIDITY(c, s->direction == PA_STREAM_UPLOAD, PA_ERR_BADSTATE);
+	PA_CHECK_VALIDITY(c, s->state == PA_STREAM_READY, PA_ERR_BADSTATE);
+	PA_CHECK_VALIDITY(c, s->upload_offset > 0, PA_ERR_INVALID);
+
+	name = pa_proplist_gets(s->proplist, PA_PROP_MEDIA_NAME);
+	PA_CHECK_VALIDITY(c, name != NULL, PA_ERR_INVALID);
+
+	sample = sample_new(c, name, &s->sample_spec, &s->channel_map, s->proplist,
+			s->upload_data, s->upload_offset);
+	if (sample == NULL)
+		PA_FAIL(c, PA_ERR_INTERNAL);
+
+	/* a new upload with the same name replaces the old sample, players
+	 * still playing it keep their reference */
+	if ((old = pa_context_find_sample(c, name, PA_INVALID_INDEX)) != NULL) {
+		spa_list_remove(&old->link);
+		sample_unref(old);
+	}
+	spa_list_append(&c->samples, &sample->link);
+
+	free(s->upload_data);
+	s->upload_data = NULL;
+	s->upload_length = s->upload_offset = 0;
+	s->stream_index = sample->index;
+
+	o = pa_operation_new(c, s, on_upload_finished, 0);
+	pa_operation_sync(o);
+	pa_operation_unref(o);
+
 	return 0;
 }
 
+struct success_data {
+	pa_context_success_cb_t cb;
+	void *userdata;
+	int ret;
+};
+
+static void on_success(pa_operation *o, void *userdata)
+{
+	struct success_data *d = userdata;
+	pa_context *c = o->context;
+	pa_operation_done(o);
+	if (d->cb)
+		d->cb(c, d->ret, d->userdata);
+}
+
 SPA_EXPORT
 pa_operation* pa_context_remove_sample(pa_context *c, const char *name, pa_context_success_cb_t cb, void *userdata)
 {
-	pw_log_warn("Not Implemented");
+	pa_operation *o;
+	struct success_data *d;
+	struct sample *s;
+
+	pa_assert(c);
+	pa_assert(c->refcount >= 1);
+
+	PA_CHECK_VALIDITY_RETURN_NULL(c, c->state == PA_CONTEXT_READY, PA_ERR_BADSTATE);
+	PA_CHECK_VALIDITY_RETURN_NULL(c, name && *name, PA_ERR_INVALID);
+
+	s = pa_context_find_sample(c, name, PA_INVALID_INDEX);
+	PA_CHECK_VALIDITY_RETURN_NULL(c, s != NULL, PA_ERR_NOENTITY);
+
+	spa_list_remove(&s->link);
+	sample_unref(s);
+
+	o = pa_operation_new(c, NULL, on_success, sizeof(struct success_data));
+	d = o->userdata;
+	d->cb = cb;
+	d->userdata = userdata;
+	d->ret = 0;
+	pa_operation_sync(o);
+
+	return o;
+}
+
+struct play_sample_data {
+	pa_context_success_cb_t cb;
+	pa_context_play_sample_cb_t play_cb;
+	void *userdata;
+	uint32_t index;
+	int ret;
+};
+
+static void on_play_sample(pa_operation *o, void *userdata)
+{
+	struct play_sample_data *d = userdata;
+	pa_context *c = o->context;
+	pa_operation_done(o);
+	if (d->cb)
+		d->cb(c, d->ret == 0, d->userdata);
+	if (d->play_cb)
+		d->play_cb(c, d->index, d->userdata);
+}
+
+static void player_complete(struct player *p, int res)
+{
+	pa_operation *o = p->operation;
+	struct play_sample_data *d;
+
+	if (o == NULL)
+		return;
+
+	p->operation = NULL;
+	if (o->state == PA_OPERATION_RUNNING) {
+		d = o->userdata;
+		d->ret = res;
+		d->index = res == 0 ? pa_stream_get_index(p->stream) : PA_INVALID_INDEX;
+		if (res < 0 && p->context->state == PA_CONTEXT_READY)
+			pa_context_set_error(p->context, -res);
+		if (o->callback)
+			o->callback(o, o->userdata);
+	}
+	pa_operation_unref(o);
+}
+
+static void player_stop(struct player *p)
+{
+	if (p->sample) {
+		sample_unref(p->sample);
+		p->sample = NULL;
+	}
+	p->draining = false;
+}
+
+static void player_free(struct player *p)
+{
+	pw_log_debug("context %p: free player %p", p->context, p);
+
+	player_complete(p, -PA_ERR_KILLED);
+	player_stop(p);
+	spa_list_remove(&p->link);
+
+	if (p->free_event)
+		p->context->mainloop->defer_free(p->free_event);
+
+	pa_stream_set_state_callback(p->stream, NULL, NULL);
+	pa_stream_set_write_callback(p->stream, NULL, NULL);
+	if (p->stream->state == PA_STREAM_READY &&
+	    p->context->state == PA_CONTEXT_READY)
+		pa_stream_disconnect(p->stream);
+	pa_stream_unref(p->stream);
+
+	free(p->dev);
+	free(p);
+}
+
+static void player_free_deferred(pa_mainloop_api *a, pa_defer_event *e, void *userdata)
+{
+	player_free(userdata);
+}
+
+/* the stream callbacks run from inside the stream, it can only be
+ * disconnected and released from the mainloop */
+static void player_schedule_free(struct player *p)
+{
+	pa_mainloop_api *api = p->context->mainloop;
+
+	if (p->free_event == NULL)
+		p->free_event = api->defer_new(api, player_free_deferred, p);
+}
+
+static uint32_t count_idle_players(pa_context *c)
+{
+	struct player *p;
+	uint32_t count = 0;
+
+	spa_list_for_each(p, &c->players, link)
+		if (p->sample == NULL && p->free_event == NULL)
+			count++;
+	return count;
+}
+
+static void player_drained(pa_stream *s, int success, void *userdata)
+{
+	struct player *p = userdata;
+	pa_context *c = p->context;
+
+	pw_log_trace("player %p: drained", p);
+
+	player_stop(p);
+
+	if (p->exclusive || count_idle_players(c) > MAX_IDLE_PLAYERS) {
+		player_schedule_free(p);
+		return;
+	}
+	/* pause, the node stays linked for the next sample */
+	pw_stream_set_active(s->stream, false);
+}
+
+static void player_write(pa_stream *s, size_t nbytes, void *userdata)
+{
+	struct player *p = userdata;
+	struct sample *sample = p->sample;
+	uint32_t n_frames, channels, stride;
+	const float *src;
+	float *dst;
+	size_t size;
+
+	if (sample == NULL || p->draining)
+		return;
+
+	channels = sample->sample_spec.channels;
+	stride = channels * sizeof(float);
+
+	while (p->offset < sample->n_frames) {
+		size = (size_t)-1;
+		if (pa_stream_begin_write(s, (void**)&dst, &size) < 0 ||
+		    dst == NULL || size < stride)
+			break;
+
+		n_frames = SPA_MIN(size / stride, sample->n_frames - p->offset);
+		src = SPA_MEMBER(sample->data, p->offset * stride, float);
+
+		/* the graph reads the stream buffers from shared memory, this is
+		 * the only copy, the volume is applied by the converter */
+		memcpy(dst, src, n_frames * stride);
+		pa_stream_write(s, dst, n_frames * stride, NULL, 0, PA_SEEK_RELATIVE);
+		p->offset += n_frames;
+
+		/* the first frames are on their way */
+		player_complete(p, 0);
+	}
+
+	if (p->offset >= sample->n_frames) {
+		pa_operation *o;
+
+		p->draining = true;
+		if ((o = pa_stream_drain(s, player_drained, p)) != NULL)
+			pa_operation_unref(o);
+	}
+}
+
+/* the volume is a control on the stream, the converter in the graph applies
+ * it while it converts the samples anyway */
+static void player_update_volume(struct player *p)
+{
+	float volumes[SPA_AUDIO_MAX_CHANNELS];
+	uint32_t i, channels;
+
+	if (p->sample == NULL || p->stream->state != PA_STREAM_READY ||
+	    p->volume == p->stream_volume)
+		return;
+
+	channels = SPA_MIN(p->sample->sample_spec.channels, SPA_AUDIO_MAX_CHANNELS);
+	for (i = 0; i < channels; i++)
+		volumes[i] = p->volume;
+
+	pw_stream_set_control(p->stream->stream,
+			SPA_PROP_channelVolumes, channels, volumes, 0);
+	p->stream_volume = p->volume;
+}
+
+static void player_state(pa_stream *s, void *userdata)
+{
+	struct player *p = userdata;
+
+	switch (s->state) {
+	case PA_STREAM_READY:
+		player_update_volume(p);
+		break;
+	case PA_STREAM_FAILED:
+	case PA_STREAM_TERMINATED:
+		player_complete(p, -PA_ERR_KILLED);
+		player_schedule_free(p);
+		break;
+	default:
+		break;
+	}
+}
+
+static struct player *player_new(pa_context *c, struct sample *sample, const char *dev,
+		PA_CONST pa_proplist *proplist)
+{
+	struct player *p;
+	pa_buffer_attr attr;
+	pa_proplist *props;
+
+	p = calloc(1, sizeof(struct player));
+	if (p == NULL)
+		return NULL;
+
+	props = pa_proplist_copy(sample->proplist);
+	if (proplist) {
+		pa_proplist_update(props, PA_UPDATE_REPLACE, proplist);
+		p->exclusive = true;
+	}
+	if (!pa_proplist_contains(props, PA_PROP_MEDIA_ROLE))
+		pa_proplist_sets(props, PA_PROP_MEDIA_ROLE, "event");
+
+	p->context = c;
+	p->dev = dev ? strdup(dev) : NULL;
+	p->stream_volume = 1.0f;
+	p->stream = pa_stream_new_with_proplist(c, "sample player",
+			&sample->sample_spec, &sample->channel_map, props);
+	pa_proplist_free(props);
+	if (p->stream == NULL)
+		goto error;
+
+	pa_stream_set_state_callback(p->stream, player_state, p);
+	pa_stream_set_write_callback(p->stream, player_write, p);
+
+	attr.maxlength = (uint32_t) -1;
+	attr.tlength = pa_usec_to_bytes(2 * PLAYER_LATENCY_USEC, &sample->sample_spec);
+	attr.minreq = pa_usec_to_bytes(PLAYER_LATENCY_USEC, &sample->sample_spec);
+	attr.prebuf = (uint32_t) -1;
+	attr.fragsize = (uint32_t) -1;
+
+	spa_list_append(&c->players, &p->link);
+
+	if (pa_stream_connect_playback(p->stream, dev, &attr, 0, NULL, NULL) < 0) {
+		player_free(p);
+		return NULL;
+	}
+	pw_log_debug("context %p: new player %p", c, p);
+
+	return p;
+error:
+	free(p->dev);
+	free(p);
 	return NULL;
 }
 
+static struct player *find_player(pa_context *c, struct sample *sample, const char *dev)
+{
+	struct player *p;
+	const pa_sample_spec *ss;
+
+	spa_list_for_each(p, &c->players, link) {
+		if (p->sample != NULL || p->exclusive || p->free_event != NULL ||
+		    p->stream->state != PA_STREAM_READY)
+			continue;
+		if ((dev == NULL) != (p->dev == NULL) ||
+		    (dev && !pa_streq(dev, p->dev)))
+			continue;
+		ss = pa_stream_get_sample_spec(p->stream);
+		if (!pa_sample_spec_equal(ss, &sample->sample_spec) ||
+		    !pa_channel_map_equal(pa_stream_get_channel_map(p->stream), &sample->channel_map))
+			continue;
+		return p;
+	}
+	return NULL;
+}
+
+static pa_operation *play_sample(pa_context *c, const char *name, const char *dev,
+		pa_volume_t volume, PA_CONST pa_proplist *proplist, pa_context_success_cb_t cb,
+		pa_context_play_sample_cb_t play_cb, void *userdata)
+{
+	pa_operation *o;
+	struct play_sample_data *d;
+	struct sample *sample;
+	struct player *p;
+
+	pa_assert(c);
+	pa_assert(c->refcount >= 1);
+
+	PA_CHECK_VALIDITY_RETURN_NULL(c, c->state == PA_CONTEXT_READY, PA_ERR_BADSTATE);
+	PA_CHECK_VALIDITY_RETURN_NULL(c, name && *name, PA_ERR_INVALID);
+	PA_CHECK_VALIDITY_RETURN_NULL(c, !dev || *dev, PA_ERR_INVALID);
+	PA_CHECK_VALIDITY_RETURN_NULL(c, volume == PA_VOLUME_INVALID ||
+			PA_VOLUME_IS_VALID(volume), PA_ERR_INVALID);
+
+	sample = pa_context_find_sample(c, name, PA_INVALID_INDEX);
+	PA_CHECK_VALIDITY_RETURN_NULL(c, sample != NULL, PA_ERR_NOENTITY);
+
+	/* extra properties get a player of their own, the others share
+	 * the idle players with the same format */
+	if (proplist && pa_proplist_isempty(proplist))
+		proplist = NULL;
+
+	if ((proplist || (p = find_player(c, sample, dev)) == NULL) &&
+	    (p = player_new(c, sample, dev, proplist)) == NULL)
+		PA_FAIL_RETURN_NULL(c, PA_ERR_INTERNAL);
+
+	pw_log_debug("context %p: play '%s' with player %p", c, name, p);
+
+	p->sample = sample_ref(sample);
+	p->offset = 0;
+	p->volume = volume == PA_VOLUME_INVALID ? 1.0f : pa_sw_volume_to_linear(volume);
+	p->draining = false;
+
+	/* completed when the first frames are queued */
+	o = pa_operation_new(c, NULL, on_play_sample, sizeof(struct play_sample_data));
+	d = o->userdata;
+	d->cb = cb;
+	d->play_cb = play_cb;
+	d->userdata = userdata;
+	d->index = PA_INVALID_INDEX;
+	p->operation = pa_operation_ref(o);
+
+	if (p->stream->state == PA_STREAM_READY) {
+		player_update_volume(p);
+		pw_stream_set_active(p->stream->stream, true);
+	}
+
+	return o;
+}
+
+void pa_context_stop_players(pa_context *c)
+{
+	struct player *p;
+
+	spa_list_consume(p, &c->players, link)
+		player_free(p);
+}
+
 SPA_EXPORT
 pa_operation* pa_context_play_sample(pa_context *c, const char *name, const char *dev,
         pa_volume_t volume, pa_context_success_cb_t cb, void *userdata)
 {
-	pw_log_warn("Not Implemented");
-	return NULL;
+	return play_sample(c, name, dev, volume, NULL, cb, NULL, userdata);
 }
 
 SPA_EXPORT
@@ -57,6 +690,5 @@ pa_operation* pa_context_play_sample_with_proplist(pa_context *c, const char *na
         const char *dev, pa_volume_t volume, PA_CONST pa_proplist *proplist,
         pa_context_play_sample_cb_t cb, void *userdata)
 {
-	pw_log_warn("Not Implemented");
-	return NULL;
+	return play_sample(c, name, dev, volume, proplist, NULL, cb, userdata);
 }
@@ -663,7 +663,8 @@ static void stream_unlink(pa_stream *s)
 	}
 
 	spa_list_remove(&s->link);
-	pw_stream_set_active(s->stream, false);
+	if (s->stream)
+		pw_stream_set_active(s->stream, false);
 
 	s->context = NULL;
 	pa_stream_unref(s);
@@ -689,6 +690,7 @@ static void stream_free(pa_stream *s)
 	if (s->format)
 		pa_format_info_free(s->format);
 
+	free(s->upload_data);
 	free(s->device_name);
 	free(s);
 }
@@ -737,6 +739,9 @@ uint32_t pa_stream_get_index(PA_CONST pa_stream *s)
 	spa_assert(s);
 	spa_assert(s->refcount >= 1);
 
+	if (s->direction == PA_STREAM_UPLOAD)
+		return s->stream_index;
+
 	idx = pw_stream_get_node_id(s->stream);
 	pw_log_debug("stream %p: index %u", s, idx);
 	return idx;
@@ -1048,7 +1053,8 @@ int pa_stream_disconnect(pa_stream *s)
 	pa_stream_ref(s);
 
 	s->disconnecting = true;
-	pw_stream_disconnect(s->stream);
+	if (s->stream)
+		pw_stream_disconnect(s->stream);
 
 	o = pa_operation_new(c, s, on_disconnected, 0);
 	pa_operation_sync(o);
@@ -1120,7 +1126,12 @@ int pa_stream_begin_write(
 	PA_CHECK_VALIDITY(s->context, data, PA_ERR_INVALID);
 	PA_CHECK_VALIDITY(s->context, nbytes && *nbytes != 0, PA_ERR_INVALID);
 
-	if ((res = peek_buffer(s)) < 0) {
+	if (s->direction == PA_STREAM_UPLOAD) {
+		size_t max = s->upload_length - s->upload_offset;
+		*data = SPA_MEMBER(s->upload_data, s->upload_offset, void);
+		*nbytes = *nbytes != (size_t)-1 ? SPA_MIN(*nbytes, max) : max;
+	}
+	else if ((res = peek_buffer(s)) < 0) {
 		*data = NULL;
 		*nbytes = 0;
 	}
@@ -1189,7 +1200,22 @@ int pa_stream_write_ext_free(pa_stream *s,
 	PA_CHECK_VALIDITY(s->context, nbytes % pa_frame_size(&s->sample_spec) == 0, PA_ERR_INVALID);
 	PA_CHECK_VALIDITY(s->context, !free_cb || !s->buffer, PA_ERR_INVALID);
 
-	if (s->buffer == NULL) {
+	if (s->direction == PA_STREAM_UPLOAD) {
+		void *dst = SPA_MEMBER(s->upload_data, s->upload_offset, void);
+
+		PA_CHECK_VALIDITY(s->context,
+				nbytes <= s->upload_length - s->upload_offset, PA_ERR_TOOLARGE);
+
+		/* data from pa_stream_begin_write() is already in place */
+		if (data != dst)
+			memcpy(dst, data, nbytes);
+		s->upload_offset += nbytes;
+
+		if (free_cb)
+			free_cb(free_cb_data);
+		return 0;
+	}
+	else if (s->buffer == NULL) {
 		void *dst;
 		const void *src = data;
 		size_t towrite = nbytes, dsize;
@@ -1284,6 +1310,9 @@ size_t pa_stream_writable_size(PA_CONST pa_stream *s)
 	PA_CHECK_VALIDITY_RETURN_ANY(s->context, s->direction != PA_STREAM_RECORD,
 			PA_ERR_BADSTATE, (size_t) -1);
 
+	if (s->direction == PA_STREAM_UPLOAD)
+		return s->upload_length - s->upload_offset;
+
 	pw_log_trace("stream %p: %zd", s, s->dequeued_size);
 	return s->dequeued_size;
 }
@@ -68,6 +68,9 @@ struct spa_data {
 #define SPA_DATA_FLAG_READABLE	(1u<<0)	/**< data is readable */
 #define SPA_DATA_FLAG_WRITABLE	(1u<<1)	/**< data is writable */
 #define SPA_DATA_FLAG_DYNAMIC	(1u<<2)	/**< data pointer can be changed */
+#define SPA_DATA_FLAG_TARGET	(1u<<3)	/**< the consumer pointed the data at the
+					  *  memory where it wants the next data,
+					  *  the producer can write there directly */
 #define SPA_DATA_FLAG_READWRITE	(SPA_DATA_FLAG_READABLE|SPA_DATA_FLAG_WRITABLE)
 	uint32_t flags;			/**< data flags */
 	int64_t fd;			/**< optional fd for data */
@@ -225,6 +225,13 @@ struct spa_audio_info_dsp {
 
 #define SPA_AUDIO_INFO_DSP_INIT(...)		(struct spa_audio_info_dsp) { __VA_ARGS__ }
 
+/** Resampler methods, the value of SPA_PROP_resampleMethod */
+enum spa_audio_resample_method {
+	SPA_AUDIO_RESAMPLE_METHOD_NATIVE,	/**< windowed sinc filter bank */
+	SPA_AUDIO_RESAMPLE_METHOD_LINEAR,	/**< linear interpolation */
+	SPA_AUDIO_RESAMPLE_METHOD_CUBIC,	/**< cubic interpolation */
+};
+
 #ifdef __cplusplus
 }  /* extern "C" */
 #endif
@@ -133,6 +133,16 @@ static const struct spa_type_info spa_type_audio_channel[] = {
 	{ 0, 0, NULL, NULL },
 };
 
+#define SPA_TYPE_INFO_AudioResampleMethod		SPA_TYPE_INFO_ENUM_BASE "AudioResampleMethod"
+#define SPA_TYPE_INFO_AUDIO_RESAMPLE_METHOD_BASE	SPA_TYPE_INFO_AudioResampleMethod ":"
+
+static const struct spa_type_info spa_type_audio_resample_method[] = {
+	{ SPA_AUDIO_RESAMPLE_METHOD_NATIVE, SPA_TYPE_Int, SPA_TYPE_INFO_AUDIO_RESAMPLE_METHOD_BASE "native", NULL },
+	{ SPA_AUDIO_RESAMPLE_METHOD_LINEAR, SPA_TYPE_Int, SPA_TYPE_INFO_AUDIO_RESAMPLE_METHOD_BASE "linear", NULL },
+	{ SPA_AUDIO_RESAMPLE_METHOD_CUBIC, SPA_TYPE_Int, SPA_TYPE_INFO_AUDIO_RESAMPLE_METHOD_BASE "cubic", NULL },
+	{ 0, 0, NULL, NULL },
+};
+
 #ifdef __cplusplus
 }  /* extern "C" */
 #endif
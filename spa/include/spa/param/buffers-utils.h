@@ -0,0 +1,74 @@
+/* Simple Plugin API
+ *
+ * Copyright © 2020 Wim Taymans
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the next
+ * paragraph) shall be included in all copies or substantial portions of the
+ * Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+#ifndef SPA_PARAM_BUFFERS_UTILS_H
+#define SPA_PARAM_BUFFERS_UTILS_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <spa/pod/builder.h>
+#include <spa/pod/schema.h>
+#include <spa/param/param.h>
+
+/** a fixated SPA_TYPE_OBJECT_ParamBuffers */
+struct spa_buffers_info {
+	uint32_t buffers;
+	uint32_t blocks;
+	uint32_t size;
+	uint32_t stride;
+	uint32_t align;
+};
+
+#define SPA_BUFFERS_INFO_SCHEMA(F)								\
+	F(SPA_PARAM_BUFFERS_buffers,	Int,	buffers,	0)				\
+	F(SPA_PARAM_BUFFERS_blocks,	Int,	blocks,		SPA_POD_SCHEMA_OPTIONAL)	\
+	F(SPA_PARAM_BUFFERS_size,	Int,	size,		0)				\
+	F(SPA_PARAM_BUFFERS_stride,	Int,	stride,		SPA_POD_SCHEMA_OPTIONAL)	\
+	F(SPA_PARAM_BUFFERS_align,	Int,	align,		SPA_POD_SCHEMA_OPTIONAL)
+
+/* the optional fields keep the value they have in info when they are
+ * not in the param */
+static inline int
+spa_buffers_parse(const struct spa_pod *buffers, struct spa_buffers_info *info)
+{
+	return SPA_POD_SCHEMA_PARSE(buffers, SPA_TYPE_OBJECT_ParamBuffers, info,
+			SPA_BUFFERS_INFO_SCHEMA);
+}
+
+static inline struct spa_pod *
+spa_buffers_build(struct spa_pod_builder *builder, uint32_t id, const struct spa_buffers_info *info)
+{
+	struct spa_pod_frame f;
+	spa_pod_builder_push_object(builder, &f, SPA_TYPE_OBJECT_ParamBuffers, id);
+	SPA_POD_SCHEMA_BUILD(builder, info, SPA_BUFFERS_INFO_SCHEMA);
+	return (struct spa_pod*)spa_pod_builder_pop(builder, &f);
+}
+
+#ifdef __cplusplus
+}  /* extern "C" */
+#endif
+
+#endif /* SPA_PARAM_BUFFERS_UTILS_H */
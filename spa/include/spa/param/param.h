@@ -47,6 +47,7 @@ enum spa_param_type {
 	SPA_PARAM_PortConfig,		/**< port configuration as SPA_TYPE_OBJECT_ParamPortConfig */
 	SPA_PARAM_EnumRoute,		/**< routing enumeration as SPA_TYPE_OBJECT_ParamRoute */
 	SPA_PARAM_Route,		/**< routing configuration as SPA_TYPE_OBJECT_ParamRoute */
+	SPA_PARAM_Latency,		/**< latency reporting as SPA_TYPE_OBJECT_ParamLatency */
 };
 
 /** information about a parameter */
@@ -131,6 +132,22 @@ enum spa_param_route {
 						  *  (Id enum spa_param_route_availability) */
 };
 
+/** properties for SPA_TYPE_OBJECT_ParamLatency
+ *
+ * The latency is the sum of the quantum, rate and ns parts. The
+ * INPUT direction is the capture latency, from the sources to the port,
+ * the OUTPUT direction is the playback latency, from the port to the sinks. */
+enum spa_param_latency {
+	SPA_PARAM_LATENCY_START,
+	SPA_PARAM_LATENCY_direction,		/**< direction, input/output (Id enum spa_direction) */
+	SPA_PARAM_LATENCY_minQuantum,		/**< min latency relative to quantum (Float) */
+	SPA_PARAM_LATENCY_maxQuantum,		/**< max latency relative to quantum (Float) */
+	SPA_PARAM_LATENCY_minRate,		/**< min latency in samples (Int) */
+	SPA_PARAM_LATENCY_maxRate,		/**< max latency in samples (Int) */
+	SPA_PARAM_LATENCY_minNs,		/**< min latency in nanoseconds (Long) */
+	SPA_PARAM_LATENCY_maxNs,		/**< max latency in nanoseconds (Long) */
+};
+
 
 #ifdef __cplusplus
 }  /* extern "C" */
@@ -31,40 +31,57 @@ extern "C" {
 
 #include <spa/pod/parser.h>
 #include <spa/pod/builder.h>
+#include <spa/pod/schema.h>
 #include <spa/param/video/format.h>
 #include <spa/param/format-utils.h>
 
+#define SPA_VIDEO_INFO_RAW_SCHEMA(F)										\
+	F(SPA_FORMAT_VIDEO_format,		Id,		format,			0)			\
+	F(SPA_FORMAT_VIDEO_size,		Rectangle,	size,			0)			\
+	F(SPA_FORMAT_VIDEO_framerate,		Fraction,	framerate,		0)			\
+	F(SPA_FORMAT_VIDEO_modifier,		Long,		modifier,		SPA_POD_SCHEMA_OPTIONAL)	\
+	F(SPA_FORMAT_VIDEO_maxFramerate,	Fraction,	max_framerate,		SPA_POD_SCHEMA_OPTIONAL)	\
+	F(SPA_FORMAT_VIDEO_views,		Int,		views,			SPA_POD_SCHEMA_OPTIONAL)	\
+	F(SPA_FORMAT_VIDEO_interlaceMode,	Id,		interlace_mode,		SPA_POD_SCHEMA_OPTIONAL)	\
+	F(SPA_FORMAT_VIDEO_pixelAspectRatio,	Fraction,	pixel_aspect_ratio,	SPA_POD_SCHEMA_OPTIONAL)	\
+	F(SPA_FORMAT_VIDEO_multiviewMode,	Id,		multiview_mode,		SPA_POD_SCHEMA_OPTIONAL)	\
+	F(SPA_FORMAT_VIDEO_multiviewFlags,	Id,		multiview_flags,	SPA_POD_SCHEMA_OPTIONAL)	\
+	F(SPA_FORMAT_VIDEO_chromaSite,		Id,		chroma_site,		SPA_POD_SCHEMA_OPTIONAL)	\
+	F(SPA_FORMAT_VIDEO_colorRange,		Id,		color_range,		SPA_POD_SCHEMA_OPTIONAL)	\
+	F(SPA_FORMAT_VIDEO_colorMatrix,		Id,		color_matrix,		SPA_POD_SCHEMA_OPTIONAL)	\
+	F(SPA_FORMAT_VIDEO_transferFunction,	Id,		transfer_function,	SPA_POD_SCHEMA_OPTIONAL)	\
+	F(SPA_FORMAT_VIDEO_colorPrimaries,	Id,		color_primaries,	SPA_POD_SCHEMA_OPTIONAL)
+
+#define SPA_VIDEO_INFO_DSP_SCHEMA(F)										\
+	F(SPA_FORMAT_VIDEO_format,		Id,		format,			0)			\
+	F(SPA_FORMAT_VIDEO_modifier,		Long,		modifier,		SPA_POD_SCHEMA_OPTIONAL)
+
+#define SPA_VIDEO_INFO_H264_SCHEMA(F)										\
+	F(SPA_FORMAT_VIDEO_size,		Rectangle,	size,			SPA_POD_SCHEMA_OPTIONAL)	\
+	F(SPA_FORMAT_VIDEO_framerate,		Fraction,	framerate,		SPA_POD_SCHEMA_OPTIONAL)	\
+	F(SPA_FORMAT_VIDEO_maxFramerate,	Fraction,	max_framerate,		SPA_POD_SCHEMA_OPTIONAL)	\
+	F(SPA_FORMAT_VIDEO_H264_streamFormat,	Id,		stream_format,		SPA_POD_SCHEMA_OPTIONAL)	\
+	F(SPA_FORMAT_VIDEO_H264_alignment,	Id,		alignment,		SPA_POD_SCHEMA_OPTIONAL)
+
+#define SPA_VIDEO_INFO_MJPG_SCHEMA(F)										\
+	F(SPA_FORMAT_VIDEO_size,		Rectangle,	size,			SPA_POD_SCHEMA_OPTIONAL)	\
+	F(SPA_FORMAT_VIDEO_framerate,		Fraction,	framerate,		SPA_POD_SCHEMA_OPTIONAL)	\
+	F(SPA_FORMAT_VIDEO_maxFramerate,	Fraction,	max_framerate,		SPA_POD_SCHEMA_OPTIONAL)
+
 static inline int
 spa_format_video_raw_parse(const struct spa_pod *format,
 			   struct spa_video_info_raw *info)
 {
-	return spa_pod_parse_object(format,
-		SPA_TYPE_OBJECT_Format, NULL,
-		SPA_FORMAT_VIDEO_format,		SPA_POD_Id(&info->format),
-		SPA_FORMAT_VIDEO_modifier,		SPA_POD_OPT_Long(&info->modifier),
-		SPA_FORMAT_VIDEO_size,			SPA_POD_Rectangle(&info->size),
-		SPA_FORMAT_VIDEO_framerate,		SPA_POD_Fraction(&info->framerate),
-		SPA_FORMAT_VIDEO_maxFramerate,		SPA_POD_OPT_Fraction(&info->max_framerate),
-		SPA_FORMAT_VIDEO_views,			SPA_POD_OPT_Int(&info->views),
-		SPA_FORMAT_VIDEO_interlaceMode,		SPA_POD_OPT_Id(&info->interlace_mode),
-		SPA_FORMAT_VIDEO_pixelAspectRatio,	SPA_POD_OPT_Fraction(&info->pixel_aspect_ratio),
-		SPA_FORMAT_VIDEO_multiviewMode,		SPA_POD_OPT_Id(&info->multiview_mode),
-		SPA_FORMAT_VIDEO_multiviewFlags,	SPA_POD_OPT_Id(&info->multiview_flags),
-		SPA_FORMAT_VIDEO_chromaSite,		SPA_POD_OPT_Id(&info->chroma_site),
-		SPA_FORMAT_VIDEO_colorRange,		SPA_POD_OPT_Id(&info->color_range),
-		SPA_FORMAT_VIDEO_colorMatrix,		SPA_POD_OPT_Id(&info->color_matrix),
-		SPA_FORMAT_VIDEO_transferFunction,	SPA_POD_OPT_Id(&info->transfer_function),
-		SPA_FORMAT_VIDEO_colorPrimaries,	SPA_POD_OPT_Id(&info->color_primaries));
+	return SPA_POD_SCHEMA_PARSE(format, SPA_TYPE_OBJECT_Format, info,
+			SPA_VIDEO_INFO_RAW_SCHEMA);
 }
 
 static inline int
 spa_format_video_dsp_parse(const struct spa_pod *format,
 			   struct spa_video_info_dsp *info)
 {
-	return spa_pod_parse_object(format,
-		SPA_TYPE_OBJECT_Format, NULL,
-		SPA_FORMAT_VIDEO_format,		SPA_POD_Id(&info->format),
-		SPA_FORMAT_VIDEO_modifier,		SPA_POD_OPT_Long(&info->modifier));
+	return SPA_POD_SCHEMA_PARSE(format, SPA_TYPE_OBJECT_Format, info,
+			SPA_VIDEO_INFO_DSP_SCHEMA);
 }
 
 static inline struct spa_pod *
@@ -73,49 +90,9 @@ spa_format_video_raw_build(struct spa_pod_builder *builder, uint32_t id,
 {
 	struct spa_pod_frame f;
 	spa_pod_builder_push_object(builder, &f, SPA_TYPE_OBJECT_Format, id);
-	spa_pod_builder_add(builder,
-			SPA_FORMAT_mediaType,		SPA_POD_Id(SPA_MEDIA_TYPE_video),
-			SPA_FORMAT_mediaSubtype,	SPA_POD_Id(SPA_MEDIA_SUBTYPE_raw),
-			SPA_FORMAT_VIDEO_format,	SPA_POD_Id(info->format),
-			SPA_FORMAT_VIDEO_size,		SPA_POD_Rectangle(&info->size),
-			SPA_FORMAT_VIDEO_framerate,	SPA_POD_Fraction(&info->framerate),
-			0);
-	if (info->modifier != 0)
-		spa_pod_builder_add(builder,
-			SPA_FORMAT_VIDEO_modifier,	SPA_POD_Long(info->modifier), 0);
-	if (info->max_framerate.denom != 0)
-		spa_pod_builder_add(builder,
-			SPA_FORMAT_VIDEO_maxFramerate,	SPA_POD_Fraction(info->max_framerate), 0);
-	if (info->views != 0)
-		spa_pod_builder_add(builder,
-			SPA_FORMAT_VIDEO_views,		SPA_POD_Int(info->views), 0);
-	if (info->interlace_mode != 0)
-		spa_pod_builder_add(builder,
-			SPA_FORMAT_VIDEO_interlaceMode,	SPA_POD_Id(info->interlace_mode), 0);
-	if (info->pixel_aspect_ratio.denom != 0)
-		spa_pod_builder_add(builder,
-			SPA_FORMAT_VIDEO_pixelAspectRatio,SPA_POD_Fraction(info->pixel_aspect_ratio), 0);
-	if (info->multiview_mode != 0)
-		spa_pod_builder_add(builder,
-			SPA_FORMAT_VIDEO_multiviewMode,	SPA_POD_Id(info->multiview_mode), 0);
-	if (info->multiview_flags != 0)
-		spa_pod_builder_add(builder,
-			SPA_FORMAT_VIDEO_multiviewFlags,SPA_POD_Id(info->multiview_flags), 0);
-	if (info->chroma_site != 0)
-		spa_pod_builder_add(builder,
-			SPA_FORMAT_VIDEO_chromaSite,	SPA_POD_Id(info->chroma_site), 0);
-	if (info->color_range != 0)
-		spa_pod_builder_add(builder,
-			SPA_FORMAT_VIDEO_colorRange,	SPA_POD_Id(info->color_range), 0);
-	if (info->color_matrix != 0)
-		spa_pod_builder_add(builder,
-			SPA_FORMAT_VIDEO_colorMatrix,	SPA_POD_Id(info->color_matrix), 0);
-	if (info->transfer_function != 0)
-		spa_pod_builder_add(builder,
-			SPA_FORMAT_VIDEO_transferFunction,SPA_POD_Id(info->transfer_function), 0);
-	if (info->color_primaries != 0)
-		spa_pod_builder_add(builder,
-			SPA_FORMAT_VIDEO_colorPrimaries,SPA_POD_Id(info->color_primaries), 0);
+	SPA_POD_SCHEMA_BUILD_PROP(builder, SPA_FORMAT_mediaType, SPA_POD_INIT_Id(SPA_MEDIA_TYPE_video));
+	SPA_POD_SCHEMA_BUILD_PROP(builder, SPA_FORMAT_mediaSubtype, SPA_POD_INIT_Id(SPA_MEDIA_SUBTYPE_raw));
+	SPA_POD_SCHEMA_BUILD(builder, info, SPA_VIDEO_INFO_RAW_SCHEMA);
 	return (struct spa_pod*)spa_pod_builder_pop(builder, &f);
 }
 
@@ -125,14 +102,9 @@ spa_format_video_dsp_build(struct spa_pod_builder *builder, uint32_t id,
 {
 	struct spa_pod_frame f;
 	spa_pod_builder_push_object(builder, &f, SPA_TYPE_OBJECT_Format, id);
-	spa_pod_builder_add(builder,
-			SPA_FORMAT_mediaType,		SPA_POD_Id(SPA_MEDIA_TYPE_video),
-			SPA_FORMAT_mediaSubtype,	SPA_POD_Id(SPA_MEDIA_SUBTYPE_dsp),
-			SPA_FORMAT_VIDEO_format,	SPA_POD_Id(info->format),
-			0);
-	if (info->modifier)
-		spa_pod_builder_add(builder,
-			SPA_FORMAT_VIDEO_modifier,	SPA_POD_Long(info->modifier), 0);
+	SPA_POD_SCHEMA_BUILD_PROP(builder, SPA_FORMAT_mediaType, SPA_POD_INIT_Id(SPA_MEDIA_TYPE_video));
+	SPA_POD_SCHEMA_BUILD_PROP(builder, SPA_FORMAT_mediaSubtype, SPA_POD_INIT_Id(SPA_MEDIA_SUBTYPE_dsp));
+	SPA_POD_SCHEMA_BUILD(builder, info, SPA_VIDEO_INFO_DSP_SCHEMA);
 	return (struct spa_pod*)spa_pod_builder_pop(builder, &f);
 }
 
@@ -140,24 +112,16 @@ static inline int
 spa_format_video_h264_parse(const struct spa_pod *format,
 			    struct spa_video_info_h264 *info)
 {
-	return spa_pod_parse_object(format,
-			SPA_TYPE_OBJECT_Format, NULL,
-			SPA_FORMAT_VIDEO_size,			SPA_POD_OPT_Rectangle(&info->size),
-			SPA_FORMAT_VIDEO_framerate,		SPA_POD_OPT_Fraction(&info->framerate),
-			SPA_FORMAT_VIDEO_maxFramerate,		SPA_POD_OPT_Fraction(&info->max_framerate),
-			SPA_FORMAT_VIDEO_H264_streamFormat,	SPA_POD_OPT_Id(&info->stream_format),
-			SPA_FORMAT_VIDEO_H264_alignment,	SPA_POD_OPT_Id(&info->alignment));
+	return SPA_POD_SCHEMA_PARSE(format, SPA_TYPE_OBJECT_Format, info,
+			SPA_VIDEO_INFO_H264_SCHEMA);
 }
 
 static inline int
 spa_format_video_mjpg_parse(const struct spa_pod *format,
 			    struct spa_video_info_mjpg *info)
 {
-	return spa_pod_parse_object(format,
-			SPA_TYPE_OBJECT_Format, NULL,
-			SPA_FORMAT_VIDEO_size,		SPA_POD_OPT_Rectangle(&info->size),
-			SPA_FORMAT_VIDEO_framerate,	SPA_POD_OPT_Fraction(&info->framerate),
-			SPA_FORMAT_VIDEO_maxFramerate,	SPA_POD_OPT_Fraction(&info->max_framerate));
+	return SPA_POD_SCHEMA_PARSE(format, SPA_TYPE_OBJECT_Format, info,
+			SPA_VIDEO_INFO_MJPG_SCHEMA);
 }
 
 #ifdef __cplusplus
@@ -148,6 +148,27 @@ static inline int spa_pod_builder_raw(struct spa_pod_builder *builder, const voi
 	return res;
 }
 
+/** Reserve size bytes in the builder and return a pointer to them so that
+ * they can be written in place. Returns NULL when there is no space. */
+static inline void *spa_pod_builder_reserve(struct spa_pod_builder *builder, uint32_t size)
+{
+	int res = 0;
+	struct spa_pod_frame *f;
+	uint32_t offset = builder->state.offset;
+
+	if (offset + size > builder->size) {
+		res = -ENOSPC;
+		spa_callbacks_call_res(&builder->callbacks, struct spa_pod_builder_callbacks, res,
+				overflow, 0, offset + size);
+	}
+	builder->state.offset += size;
+
+	for (f = builder->state.frame; f ; f = f->parent)
+		f->pod.size += size;
+
+	return res == 0 ? SPA_MEMBER(builder->data, offset, void) : NULL;
+}
+
 static inline int spa_pod_builder_pad(struct spa_pod_builder *builder, uint32_t size)
 {
 	uint64_t zeroes = 0;
@@ -438,6 +459,28 @@ spa_pod_builder_control(struct spa_pod_builder *builder, uint32_t offset, uint32
 	return spa_pod_builder_raw(builder, &p, sizeof(p));
 }
 
+/** Add a control with a bytes value of size to a sequence with one write
+ * and return a pointer to the body of the value, where the caller copies
+ * the data afterwards. The padding is cleared by zeroing the last word of
+ * the body, which overwrites anything that was written there before.
+ * Returns NULL when there is no space. */
+static inline void *
+spa_pod_builder_control_bytes(struct spa_pod_builder *builder, uint32_t offset,
+		uint32_t type, uint32_t size)
+{
+	const struct spa_pod_control c = { offset, type, SPA_POD_INIT(size, SPA_TYPE_Bytes) };
+	uint32_t padded = SPA_ROUND_UP_N(size, 8);
+	uint8_t *p;
+
+	if ((p = (uint8_t *) spa_pod_builder_reserve(builder, sizeof(c) + padded)) == NULL)
+		return NULL;
+
+	memcpy(p, &c, sizeof(c));
+	if (padded > 0)
+		*SPA_MEMBER(p, sizeof(c) + padded - 8, uint64_t) = 0;
+	return p + sizeof(c);
+}
+
 static inline uint32_t spa_choice_from_id(char id)
 {
 	switch (id) {
@@ -29,6 +29,7 @@
 #include <string.h>
 
 #include <spa/param/props.h>
+#include <spa/param/format.h>
 #include <spa/pod/iter.h>
 #include <spa/pod/builder.h>
 #include <spa/pod/compare.h>
@@ -86,6 +87,111 @@ static inline int spa_pod_choice_fix_default(struct spa_pod_choice *choice)
 	return 0;
 }
 
+/* Enum choices with more value pairs than this are intersected by
+ * sorting the filter values and doing a binary search for each value
+ * instead of comparing all pairs. Below this, the sort costs more than
+ * it saves. */
+#define SPA_POD_FILTER_SORT_MIN_DEFAULT	128
+#ifndef SPA_POD_FILTER_SORT_MIN
+#define SPA_POD_FILTER_SORT_MIN		SPA_POD_FILTER_SORT_MIN_DEFAULT
+#endif
+#define SPA_POD_FILTER_SORT_MAX		256
+
+/* a total order with the same equal values as spa_pod_compare_value() for
+ * the types that can be sorted, returns -ENOTSUP for the other types */
+static inline int spa_pod_filter_order_value(uint32_t type, const void *r1, const void *r2)
+{
+	switch (type) {
+	case SPA_TYPE_Bool:
+	case SPA_TYPE_Id:
+	{
+		uint32_t v1 = *(uint32_t *) r1, v2 = *(uint32_t *) r2;
+		return v1 < v2 ? -1 : v1 > v2 ? 1 : 0;
+	}
+	case SPA_TYPE_Int:
+	{
+		int32_t v1 = *(int32_t *) r1, v2 = *(int32_t *) r2;
+		return v1 < v2 ? -1 : v1 > v2 ? 1 : 0;
+	}
+	case SPA_TYPE_Rectangle:
+	{
+		const struct spa_rectangle *rec1 = (struct spa_rectangle *) r1,
+		    *rec2 = (struct spa_rectangle *) r2;
+		if (rec1->width != rec2->width)
+			return rec1->width < rec2->width ? -1 : 1;
+		if (rec1->height != rec2->height)
+			return rec1->height < rec2->height ? -1 : 1;
+		return 0;
+	}
+	case SPA_TYPE_Fraction:
+		/* only an order when the denominators are not 0, checked
+		 * when collecting the values */
+		return spa_pod_compare_value(type, r1, r2, sizeof(struct spa_fraction));
+	default:
+		return -ENOTSUP;
+	}
+}
+
+/* collect and sort the n values of size in vals, returns false when
+ * the values can't be sorted */
+static inline bool spa_pod_filter_sort_values(uint32_t type, uint32_t size,
+		const void *values, uint32_t n, const void **vals)
+{
+	uint32_t i, j, gap;
+	const void *t;
+
+	switch (type) {
+	case SPA_TYPE_Bool:
+	case SPA_TYPE_Id:
+	case SPA_TYPE_Int:
+	case SPA_TYPE_Rectangle:
+		break;
+	case SPA_TYPE_Fraction:
+		for (i = 0; i < n; i++) {
+			const struct spa_fraction *f = SPA_MEMBER(values, i * size, struct spa_fraction);
+			if (f->denom == 0)
+				return false;
+		}
+		break;
+	default:
+		return false;
+	}
+
+	for (i = 0; i < n; i++)
+		vals[i] = SPA_MEMBER(values, i * size, void);
+
+	/* shell sort, qsort can't pass the type to the compare function */
+	for (gap = n / 2; gap > 0; gap /= 2) {
+		for (i = gap; i < n; i++) {
+			t = vals[i];
+			for (j = i; j >= gap && spa_pod_filter_order_value(type, vals[j - gap], t) > 0; j -= gap)
+				vals[j] = vals[j - gap];
+			vals[j] = t;
+		}
+	}
+	return true;
+}
+
+/* number of values in the sorted vals that are equal to val */
+static inline uint32_t spa_pod_filter_count_value(uint32_t type,
+		const void **vals, uint32_t n, const void *val)
+{
+	uint32_t lo = 0, hi = n, count = 0;
+
+	while (lo < hi) {
+		uint32_t mid = (lo + hi) / 2;
+		if (spa_pod_filter_order_value(type, vals[mid], val) < 0)
+			lo = mid + 1;
+		else
+			hi = mid;
+	}
+	while (lo < n && spa_pod_filter_order_value(type, vals[lo], val) == 0) {
+		count++;
+		lo++;
+	}
+	return count;
+}
+
 static inline int
 spa_pod_filter_prop(struct spa_pod_builder *b,
 	    const struct spa_pod_prop *p1,
@@ -137,13 +243,30 @@ spa_pod_filter_prop(struct spa_pod_builder *b,
 	    (p1c == SPA_CHOICE_Enum && p2c == SPA_CHOICE_None) ||
 	    (p1c == SPA_CHOICE_Enum && p2c == SPA_CHOICE_Enum)) {
 		int n_copied = 0;
-		/* copy all equal values but don't copy the default value again */
-		for (j = 0, a1 = alt1; j < nalt1; j++, a1 = SPA_MEMBER(a1, size, void)) {
-			for (k = 0, a2 = alt2; k < nalt2; k++, a2 = SPA_MEMBER(a2,size,void)) {
-				if (spa_pod_compare_value(type, a1, a2, size) == 0) {
-					if (p1c == SPA_CHOICE_Enum || j > 0)
-						spa_pod_builder_raw(b, a1, size);
-					n_copied++;
+		const void *sorted[SPA_POD_FILTER_SORT_MAX];
+
+		if (p1c == SPA_CHOICE_Enum && nalt1 * nalt2 > SPA_POD_FILTER_SORT_MIN &&
+		    nalt2 <= SPA_POD_FILTER_SORT_MAX &&
+		    spa_pod_filter_sort_values(type, size, alt2, nalt2, sorted)) {
+			/* copy the values in their order once for each equal value */
+			for (j = 0, a1 = alt1; j < nalt1; j++, a1 = SPA_MEMBER(a1, size, void)) {
+				k = spa_pod_filter_count_value(type, sorted, nalt2, a1);
+				n_copied += k;
+				while (k--)
+					spa_pod_builder_raw(b, a1, size);
+			}
+		} else {
+			/* copy all equal values but don't copy the default value again */
+			for (j = 0, a1 = alt1; j < nalt1; j++, a1 = SPA_MEMBER(a1, size, void)) {
+				for (k = 0, a2 = alt2; k < nalt2; k++, a2 = SPA_MEMBER(a2,size,void)) {
+					if (spa_pod_compare_value(type, a1, a2, size) == 0) {
+						if (p1c == SPA_CHOICE_Enum || j > 0)
+							spa_pod_builder_raw(b, a1, size);
+						n_copied++;
+						/* a single value is only checked for a match */
+						if (p1c == SPA_CHOICE_None)
+							break;
+					}
 				}
 			}
 		}
@@ -249,6 +372,37 @@ spa_pod_filter_prop(struct spa_pod_builder *b,
 	return 0;
 }
 
+/* Formats with a different fixed media type or subtype can't intersect,
+ * check that before doing the work of filtering all the properties. */
+static inline bool spa_pod_filter_format_compatible(const struct spa_pod_object *o1,
+		const struct spa_pod_object *o2)
+{
+	static const uint32_t keys[] = { SPA_FORMAT_mediaType, SPA_FORMAT_mediaSubtype };
+	const struct spa_pod_prop *p1 = NULL, *p2 = NULL;
+	const struct spa_pod *v1, *v2;
+	uint32_t i, n1, n2, c1, c2;
+
+	if (o1->body.type != SPA_TYPE_OBJECT_Format ||
+	    o2->body.type != SPA_TYPE_OBJECT_Format)
+		return true;
+
+	for (i = 0; i < SPA_N_ELEMENTS(keys); i++) {
+		if ((p1 = spa_pod_object_find_prop(o1, p1, keys[i])) == NULL ||
+		    (p2 = spa_pod_object_find_prop(o2, p2, keys[i])) == NULL)
+			continue;
+
+		v1 = spa_pod_get_values(&p1->value, &n1, &c1);
+		v2 = spa_pod_get_values(&p2->value, &n2, &c2);
+		if (c1 != SPA_CHOICE_None || c2 != SPA_CHOICE_None ||
+		    !spa_pod_is_id(v1) || !spa_pod_is_id(v2))
+			continue;
+
+		if (SPA_POD_VALUE(struct spa_pod_id, v1) != SPA_POD_VALUE(struct spa_pod_id, v2))
+			return false;
+	}
+	return true;
+}
+
 static inline int spa_pod_filter_part(struct spa_pod_builder *b,
 	       const struct spa_pod *pod, uint32_t pod_size,
 	       const struct spa_pod *filter, uint32_t filter_size)
@@ -272,6 +426,8 @@ static inline int spa_pod_filter_part(struct spa_pod_builder *b,
 
 				if (SPA_POD_TYPE(pf) != SPA_POD_TYPE(pp))
 					return -EINVAL;
+				if (!spa_pod_filter_format_compatible(op, of))
+					return -EINVAL;
 
 				spa_pod_builder_push_object(b, &f, op->body.type, op->body.id);
 				p2 = NULL;
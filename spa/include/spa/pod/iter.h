@@ -85,6 +85,35 @@ static inline struct spa_pod_control *spa_pod_control_next(const struct spa_pod_
 	return SPA_MEMBER(iter, SPA_ROUND_UP_N(SPA_POD_CONTROL_SIZE(iter), 8), struct spa_pod_control);
 }
 
+/**
+ * Merge sequences in time order. ctrl contains the next control of each of
+ * the n_seq sequences, start with spa_pod_control_first(). Returns the
+ * control with the lowest offset and moves ctrl of its sequence to the next
+ * control, or NULL when all controls were returned. Controls with the same
+ * offset are returned in the order of the sequences.
+ */
+static inline struct spa_pod_control *
+spa_pod_sequence_merge_next(struct spa_pod_sequence * const *seq,
+		struct spa_pod_control **ctrl, uint32_t n_seq)
+{
+	struct spa_pod_control *next = NULL;
+	uint32_t i, next_index = 0;
+
+	for (i = 0; i < n_seq; i++) {
+		if (!spa_pod_control_is_inside(&seq[i]->body,
+				SPA_POD_BODY_SIZE(seq[i]), ctrl[i]))
+			continue;
+
+		if (next == NULL || ctrl[i]->offset < next->offset) {
+			next = ctrl[i];
+			next_index = i;
+		}
+	}
+	if (next != NULL)
+		ctrl[next_index] = spa_pod_control_next(next);
+	return next;
+}
+
 #define SPA_POD_ARRAY_BODY_FOREACH(body, _size, iter)							\
 	for ((iter) = (__typeof__(iter))SPA_MEMBER((body), sizeof(struct spa_pod_array_body), void);	\
 	     (iter) < (__typeof__(iter))SPA_MEMBER((body), (_size), void);				\
@@ -0,0 +1,224 @@
+/* Simple Plugin API
+ *
+ * Copyright © 2020 Wim Taymans
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the next
+ * paragraph) shall be included in all copies or substantial portions of the
+ * Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+#ifndef SPA_POD_SCHEMA_H
+#define SPA_POD_SCHEMA_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <errno.h>
+
+#include <spa/pod/iter.h>
+#include <spa/pod/builder.h>
+
+/**
+ * Parsers and builders for objects with a fixed layout.
+ *
+ * The layout of the object is described with a schema macro that
+ * invokes its argument for each field with the key, the type, the
+ * struct member and the flags of the field:
+ *
+ *   #define MY_INFO_SCHEMA(F)					\
+ *	F(SPA_FORMAT_AUDIO_format,	Id,	format,	0)		\
+ *	F(SPA_FORMAT_AUDIO_rate,	Int,	rate,	SPA_POD_SCHEMA_OPTIONAL)
+ *
+ * SPA_POD_SCHEMA_PARSE() and SPA_POD_SCHEMA_BUILD() expand the schema
+ * to a switch on the property key and a sequence of typed property
+ * writes so that no format string or varargs are involved.
+ *
+ * The types are Bool, Id, Int, Long, Float, Double, Rectangle, Fraction
+ * and Pod. Other types can be added by defining SPA_POD_SCHEMA_GET_<type>,
+ * SPA_POD_SCHEMA_BUILD_<type> and SPA_POD_SCHEMA_IS_SET_<type>.
+ *
+ * The members are plain identifiers and a schema has at most 64 fields.
+ */
+
+/** the field can be missing when parsing and is not written
+ * when it is not set (0) when building */
+#define SPA_POD_SCHEMA_OPTIONAL		(1<<0)
+
+static inline const struct spa_pod *spa_pod_schema_value(const struct spa_pod *pod)
+{
+	if (spa_pod_is_choice(pod) && SPA_POD_CHOICE_TYPE(pod) == SPA_CHOICE_None)
+		return SPA_POD_CHOICE_CHILD(pod);
+	return pod;
+}
+
+#define SPA_POD_SCHEMA_GET_VALUE(pod,is,type,dst)					\
+	(is(pod) ? ((dst) = SPA_POD_VALUE(type, pod), 0) : -EINVAL)
+#define SPA_POD_SCHEMA_GET_SCALAR(pod,is,type,dst)					\
+	(is(pod) ? ((dst) = (__typeof__(dst)) SPA_POD_VALUE(type, pod), 0) : -EINVAL)
+
+#define SPA_POD_SCHEMA_GET_Bool(pod,info,member)					\
+	(spa_pod_is_bool(pod) ?								\
+		((info)->member = SPA_POD_VALUE(struct spa_pod_bool, pod) ? true : false, 0) : \
+		-EINVAL)
+#define SPA_POD_SCHEMA_GET_Id(pod,info,member)						\
+	SPA_POD_SCHEMA_GET_SCALAR(pod, spa_pod_is_id, struct spa_pod_id, (info)->member)
+#define SPA_POD_SCHEMA_GET_Int(pod,info,member)						\
+	SPA_POD_SCHEMA_GET_SCALAR(pod, spa_pod_is_int, struct spa_pod_int, (info)->member)
+#define SPA_POD_SCHEMA_GET_Long(pod,info,member)					\
+	SPA_POD_SCHEMA_GET_SCALAR(pod, spa_pod_is_long, struct spa_pod_long, (info)->member)
+#define SPA_POD_SCHEMA_GET_Float(pod,info,member)					\
+	SPA_POD_SCHEMA_GET_SCALAR(pod, spa_pod_is_float, struct spa_pod_float, (info)->member)
+#define SPA_POD_SCHEMA_GET_Double(pod,info,member)					\
+	SPA_POD_SCHEMA_GET_SCALAR(pod, spa_pod_is_double, struct spa_pod_double, (info)->member)
+#define SPA_POD_SCHEMA_GET_Rectangle(pod,info,member)					\
+	SPA_POD_SCHEMA_GET_VALUE(pod, spa_pod_is_rectangle, struct spa_pod_rectangle, (info)->member)
+#define SPA_POD_SCHEMA_GET_Fraction(pod,info,member)					\
+	SPA_POD_SCHEMA_GET_VALUE(pod, spa_pod_is_fraction, struct spa_pod_fraction, (info)->member)
+#define SPA_POD_SCHEMA_GET_Pod(pod,info,member)						\
+	((info)->member = (pod), 0)
+
+/** write the property header and the value with one write */
+#define SPA_POD_SCHEMA_BUILD_PROP(b,_key,_value)					\
+({											\
+	const struct {									\
+		uint32_t key;								\
+		uint32_t flags;								\
+		__typeof__(_value) value;						\
+	} _p = { _key, 0, _value };							\
+	spa_pod_builder_raw(b, &_p, sizeof(_p));					\
+})
+
+#define SPA_POD_SCHEMA_BUILD_Bool(b,key,info,member)					\
+	SPA_POD_SCHEMA_BUILD_PROP(b, key, SPA_POD_INIT_Bool((info)->member))
+#define SPA_POD_SCHEMA_BUILD_Id(b,key,info,member)					\
+	SPA_POD_SCHEMA_BUILD_PROP(b, key, SPA_POD_INIT_Id((info)->member))
+#define SPA_POD_SCHEMA_BUILD_Int(b,key,info,member)					\
+	SPA_POD_SCHEMA_BUILD_PROP(b, key, SPA_POD_INIT_Int((info)->member))
+#define SPA_POD_SCHEMA_BUILD_Long(b,key,info,member)					\
+	SPA_POD_SCHEMA_BUILD_PROP(b, key, SPA_POD_INIT_Long((info)->member))
+#define SPA_POD_SCHEMA_BUILD_Float(b,key,info,member)					\
+	SPA_POD_SCHEMA_BUILD_PROP(b, key, SPA_POD_INIT_Float((info)->member))
+#define SPA_POD_SCHEMA_BUILD_Double(b,key,info,member)					\
+	SPA_POD_SCHEMA_BUILD_PROP(b, key, SPA_POD_INIT_Double((info)->member))
+#define SPA_POD_SCHEMA_BUILD_Rectangle(b,key,info,member)				\
+	SPA_POD_SCHEMA_BUILD_PROP(b, key, SPA_POD_INIT_Rectangle((info)->member))
+#define SPA_POD_SCHEMA_BUILD_Fraction(b,key,info,member)				\
+	SPA_POD_SCHEMA_BUILD_PROP(b, key, SPA_POD_INIT_Fraction((info)->member))
+#define SPA_POD_SCHEMA_BUILD_Pod(b,key,info,member)					\
+({											\
+	spa_pod_builder_prop(b, key, 0);						\
+	spa_pod_builder_primitive(b, (info)->member);					\
+})
+
+#define SPA_POD_SCHEMA_IS_SET_Bool(info,member)		((info)->member)
+#define SPA_POD_SCHEMA_IS_SET_Id(info,member)		((info)->member != 0)
+#define SPA_POD_SCHEMA_IS_SET_Int(info,member)		((info)->member != 0)
+#define SPA_POD_SCHEMA_IS_SET_Long(info,member)		((info)->member != 0)
+#define SPA_POD_SCHEMA_IS_SET_Float(info,member)	((info)->member != 0.0f)
+#define SPA_POD_SCHEMA_IS_SET_Double(info,member)	((info)->member != 0.0)
+#define SPA_POD_SCHEMA_IS_SET_Rectangle(info,member)	((info)->member.width != 0 || (info)->member.height != 0)
+#define SPA_POD_SCHEMA_IS_SET_Fraction(info,member)	((info)->member.denom != 0)
+#define SPA_POD_SCHEMA_IS_SET_Pod(info,member)		((info)->member != NULL)
+
+#define SPA_POD_SCHEMA_IS_OPTIONAL(flags)	(((flags) & SPA_POD_SCHEMA_OPTIONAL) != 0)
+
+#define SPA_POD_SCHEMA_COUNT_REQUIRED(key,type,member,flags)				\
+	+ (SPA_POD_SCHEMA_IS_OPTIONAL(flags) ? 0 : 1)
+
+#define SPA_POD_SCHEMA_FIELD_INDEX(key,type,member,flags)				\
+	_spa_pod_schema_##member,
+
+#define SPA_POD_SCHEMA_FIELD_BIT(member)	(1ULL << _spa_pod_schema_##member)
+
+/* a key that is repeated takes the last value but is counted once */
+#define SPA_POD_SCHEMA_PARSE_FIELD(key,type,member,flags)				\
+	case key:									\
+		if (SPA_POD_SCHEMA_GET_##type(_v, _info, member) >= 0) {		\
+			if (_seen & SPA_POD_SCHEMA_FIELD_BIT(member))			\
+				break;							\
+			_seen |= SPA_POD_SCHEMA_FIELD_BIT(member);			\
+			_count++;							\
+			if (!SPA_POD_SCHEMA_IS_OPTIONAL(flags))				\
+				_required--;						\
+		} else if (!SPA_POD_SCHEMA_IS_OPTIONAL(flags))				\
+			_res = -EPROTO;							\
+		break;
+
+#define SPA_POD_SCHEMA_BUILD_FIELD(key,type,member,flags)				\
+	if (!SPA_POD_SCHEMA_IS_OPTIONAL(flags) ||					\
+	    SPA_POD_SCHEMA_IS_SET_##type(_info, member))				\
+		SPA_POD_SCHEMA_BUILD_##type(_b, key, _info, member);
+
+/**
+ * Parse the object pod of type into info with schema in one pass over
+ * the properties. Unknown properties are skipped, like with
+ * spa_pod_parse_object() a choice of type None is taken as its value.
+ *
+ * Returns the number of parsed fields or, like spa_pod_parse_object(),
+ * -EINVAL when pod is not an object, -EPROTO when the object or a
+ * required field has the wrong type and -ESRCH when a required field
+ * is missing.
+ */
+#define SPA_POD_SCHEMA_PARSE(pod,type,info,schema)					\
+({											\
+	const struct spa_pod *_pod = (pod);						\
+	__typeof__(info) _info = (info);						\
+	const struct spa_pod_prop *_prop;						\
+	enum { schema(SPA_POD_SCHEMA_FIELD_INDEX) };					\
+	uint64_t _seen = 0;								\
+	int _res = 0, _count = 0, _required = 0 schema(SPA_POD_SCHEMA_COUNT_REQUIRED);	\
+	if (_pod == NULL)								\
+		_res = -EPIPE;								\
+	else if (!spa_pod_is_object(_pod))						\
+		_res = -EINVAL;								\
+	else if (SPA_POD_OBJECT_TYPE(_pod) != (type))					\
+		_res = -EPROTO;								\
+	else {										\
+		SPA_POD_OBJECT_FOREACH((const struct spa_pod_object*)_pod, _prop) {	\
+			const struct spa_pod *_v = spa_pod_schema_value(&_prop->value);	\
+			switch (_prop->key) {						\
+			schema(SPA_POD_SCHEMA_PARSE_FIELD)				\
+			default:							\
+				break;							\
+			}								\
+			if (_res < 0)							\
+				break;							\
+		}									\
+		if (_res == 0)								\
+			_res = _required > 0 ? -ESRCH : _count;				\
+	}										\
+	_res;										\
+})
+
+/**
+ * Add the properties of info with schema to the object that is being
+ * built in b. Each property is written with a single builder write.
+ */
+#define SPA_POD_SCHEMA_BUILD(b,info,schema)						\
+({											\
+	struct spa_pod_builder *_b = (b);						\
+	__typeof__(info) _info = (info);						\
+	schema(SPA_POD_SCHEMA_BUILD_FIELD)						\
+})
+
+#ifdef __cplusplus
+}  /* extern "C" */
+#endif
+
+#endif /* SPA_POD_SCHEMA_H */
@@ -40,6 +40,17 @@ struct spa_dict_item {
 
 #define SPA_DICT_ITEM_INIT(key,value) (struct spa_dict_item) { key, value }
 
+/** An open addressing hash index on the items of a dictionary. The
+ * hash of the key of each item is kept so that only keys with the
+ * same hash are compared. The index is kept next to the dictionary by
+ * its owner and is used with spa_dict_hash_lookup_item(). */
+struct spa_dict_hash {
+	uint32_t size;			/**< number of slots, a power of 2 and at
+					  *  least twice the number of items */
+	uint32_t *slots;		/**< item index + 1 or 0 when empty */
+	uint32_t *hashes;		/**< hash of the key of each item */
+};
+
 struct spa_dict {
 #define SPA_DICT_FLAG_SORTED	(1<<0)		/**< items are sorted */
 	uint32_t flags;
@@ -69,6 +80,59 @@ static inline void spa_dict_qsort(struct spa_dict *dict)
 	SPA_FLAG_SET(dict->flags, SPA_DICT_FLAG_SORTED);
 }
 
+/** FNV-1a hash of a key */
+static inline uint32_t spa_dict_hash_key(const char *key)
+{
+	uint32_t h = 2166136261u;
+	while (*key) {
+		h ^= (uint8_t) *key++;
+		h *= 16777619u;
+	}
+	return h;
+}
+
+/** Add item \a index with key hash \a h to \a hash */
+static inline void spa_dict_hash_insert(struct spa_dict_hash *hash, uint32_t index, uint32_t h)
+{
+	uint32_t i, mask = hash->size - 1;
+
+	for (i = h & mask; hash->slots[i] != 0; i = (i + 1) & mask);
+	hash->slots[i] = index + 1;
+	hash->hashes[index] = h;
+}
+
+/** Index the items of \a dict in \a hash. The slots and hashes of \a hash
+ * should be allocated by the caller. The index needs to be updated or
+ * made again when the items of \a dict are changed or moved. */
+static inline void spa_dict_hash_index(const struct spa_dict *dict, struct spa_dict_hash *hash)
+{
+	uint32_t i;
+
+	memset(hash->slots, 0, hash->size * sizeof(uint32_t));
+	for (i = 0; i < dict->n_items; i++)
+		spa_dict_hash_insert(hash, i, spa_dict_hash_key(dict->items[i].key));
+}
+
+/** Find \a key in \a dict with the index \a hash on its items */
+static inline const struct spa_dict_item *spa_dict_hash_lookup_item(const struct spa_dict *dict,
+		const struct spa_dict_hash *hash, const char *key)
+{
+	uint32_t i, idx, mask, h;
+
+	if (dict->n_items == 0)
+		return NULL;
+
+	mask = hash->size - 1;
+	h = spa_dict_hash_key(key);
+	for (i = h & mask; (idx = hash->slots[i]) != 0; i = (i + 1) & mask) {
+		idx--;
+		if (idx < dict->n_items && hash->hashes[idx] == h &&
+		    strcmp(dict->items[idx].key, key) == 0)
+			return &dict->items[idx];
+	}
+	return NULL;
+}
+
 static inline const struct spa_dict_item *spa_dict_lookup_item(const struct spa_dict *dict,
 							       const char *key)
 {
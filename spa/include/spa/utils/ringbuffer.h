@@ -166,6 +166,54 @@ static inline void spa_ringbuffer_write_update(struct spa_ringbuffer *rbuf, int3
 	__atomic_store_n(&rbuf->writeindex, index, __ATOMIC_RELEASE);
 }
 
+/**
+ * Get the read index, available bytes and a pointer to the data to read
+ * in \a buffer.
+ *
+ * When \a buffer is mapped twice after each other (see PW_MEMMAP_FLAG_TWICE),
+ * all available bytes can be accessed linearly from \a data, without
+ * splitting the access at the end of \a buffer.
+ *
+ * \param rbuf a spa_ringbuffer
+ * \param buffer memory to read from
+ * \param size the size of \a buffer
+ * \param index the value of readindex
+ * \param data pointer to the data at \a index
+ * \return number of available bytes to read, see spa_ringbuffer_get_read_index()
+ */
+static inline int32_t
+spa_ringbuffer_get_read_area(struct spa_ringbuffer *rbuf,
+			     const void *buffer, uint32_t size,
+			     uint32_t *index, const void **data)
+{
+	int32_t avail = spa_ringbuffer_get_read_index(rbuf, index);
+	*data = SPA_MEMBER(buffer, *index % size, const void);
+	return avail;
+}
+
+/**
+ * Get the write index, the fill level and a pointer to the memory to write
+ * in \a buffer.
+ *
+ * When \a buffer is mapped twice after each other, \a size minus the fill
+ * level bytes can be written linearly to \a data.
+ *
+ * \param rbuf a spa_ringbuffer
+ * \param buffer memory to write to
+ * \param size the size of \a buffer
+ * \param index the value of writeindex
+ * \param data pointer to the memory at \a index
+ * \return the fill level of \a rbuf, see spa_ringbuffer_get_write_index()
+ */
+static inline int32_t
+spa_ringbuffer_get_write_area(struct spa_ringbuffer *rbuf,
+			      void *buffer, uint32_t size,
+			      uint32_t *index, void **data)
+{
+	int32_t filled = spa_ringbuffer_get_write_index(rbuf, index);
+	*data = SPA_MEMBER(buffer, *index % size, void);
+	return filled;
+}
 
 #ifdef __cplusplus
 }  /* extern "C" */
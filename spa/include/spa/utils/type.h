@@ -86,6 +86,7 @@ enum {
 	SPA_TYPE_OBJECT_ParamProfile,
 	SPA_TYPE_OBJECT_ParamPortConfig,
 	SPA_TYPE_OBJECT_ParamRoute,
+	SPA_TYPE_OBJECT_ParamLatency,
 	SPA_TYPE_OBJECT_LAST,			/**< not part of ABI */
 
 	/* vendor extensions */
@@ -251,18 +251,25 @@ static int impl_node_send_command(void *object, const struct spa_command *comman
 	return 0;
 }
 
-static const struct spa_dict_item node_info_items[] = {
-	{ SPA_KEY_DEVICE_API, "alsa" },
-	{ SPA_KEY_MEDIA_CLASS, "Audio/Source" },
-	{ SPA_KEY_NODE_DRIVER, "true" },
-};
-
 static void emit_node_info(struct state *this, bool full)
 {
 	if (full)
 		this->info.change_mask = this->info_all;
 	if (this->info.change_mask) {
-		this->info.props = &SPA_DICT_INIT_ARRAY(node_info_items);
+		uint32_t n_items = 0;
+
+		this->info_items[n_items++] = SPA_DICT_ITEM_INIT(SPA_KEY_DEVICE_API, "alsa");
+		this->info_items[n_items++] = SPA_DICT_ITEM_INIT(SPA_KEY_MEDIA_CLASS, "Audio/Source");
+		this->info_items[n_items++] = SPA_DICT_ITEM_INIT(SPA_KEY_NODE_DRIVER, "true");
+		/* the buffer needs to hold 2 quantums, without a format the
+		 * key is removed again */
+		if (this->have_format)
+			snprintf(this->max_latency, sizeof(this->max_latency), "%lu/%d",
+					this->buffer_frames / 2, this->rate);
+		this->info_items[n_items++] = SPA_DICT_ITEM_INIT(SPA_KEY_NODE_MAX_LATENCY,
+				this->have_format ? this->max_latency : NULL);
+		this->info_props = SPA_DICT_INIT(this->info_items, n_items);
+		this->info.props = &this->info_props;
 		spa_node_emit_info(&this->hooks, &this->info);
 		this->info.change_mask = 0;
 	}
@@ -436,6 +443,16 @@ impl_node_port_enum_params(void *object, int seq,
 		}
 		break;
 
+	case SPA_PARAM_Latency:
+		switch (result.index) {
+		case 0:
+			param = spa_latency_build(&b, id, &this->latency);
+			break;
+		default:
+			return 0;
+		}
+		break;
+
 	default:
 		return -ENOENT;
 	}
@@ -458,6 +475,7 @@ static int clear_buffers(struct state *this)
 		spa_list_init(&this->ready);
 		this->n_buffers = 0;
 	}
+	this->zero_copy = false;
 	return 0;
 }
 
@@ -476,6 +494,9 @@ static int port_set_format(void *object,
 		clear_buffers(this);
 		spa_alsa_close(this);
 		this->have_format = false;
+
+		this->info.change_mask |= SPA_NODE_CHANGE_MASK_PROPS;
+		emit_node_info(this, false);
 	} else {
 		struct spa_audio_info info = { 0 };
 
@@ -494,6 +515,9 @@ static int port_set_format(void *object,
 
 		this->current_format = info;
 		this->have_format = true;
+
+		this->info.change_mask |= SPA_NODE_CHANGE_MASK_PROPS;
+		emit_node_info(this, false);
 	}
 
 	this->port_info.change_mask |= SPA_PORT_CHANGE_MASK_RATE;
@@ -529,6 +553,11 @@ impl_node_port_set_param(void *object,
 		res = port_set_format(this, direction, port_id, flags, param);
 		break;
 
+	case SPA_PARAM_Latency:
+		/* we are the start of the graph, nothing to pass on */
+		res = 0;
+		break;
+
 	default:
 		res = -ENOENT;
 		break;
@@ -560,6 +589,7 @@ impl_node_port_use_buffers(void *object,
 		if ((res = clear_buffers(this)) < 0)
 			return res;
 	}
+	this->zero_copy = n_buffers > 0;
 	for (i = 0; i < n_buffers; i++) {
 		struct buffer *b = &this->buffers[i];
 		struct spa_data *d = buffers[i]->datas;
@@ -574,6 +604,7 @@ impl_node_port_use_buffers(void *object,
 			spa_log_error(this->log, NAME " %p: need mapped memory", this);
 			return -EINVAL;
 		}
+		spa_alsa_init_buffer(this, b);
 		spa_list_append(&this->free, &b->link);
 	}
 	this->n_buffers = n_buffers;
@@ -733,6 +764,7 @@ impl_init(const struct spa_handle_factory *factory,
 	this->log = spa_support_find(support, n_support, SPA_TYPE_INTERFACE_Log);
 	this->data_system = spa_support_find(support, n_support, SPA_TYPE_INTERFACE_DataSystem);
 	this->data_loop = spa_support_find(support, n_support, SPA_TYPE_INTERFACE_DataLoop);
+	this->main_loop = spa_support_find(support, n_support, SPA_TYPE_INTERFACE_Loop);
 
 	if (this->data_loop == NULL) {
 		spa_log_error(this->log, NAME" %p: a data loop is needed", this);
@@ -771,8 +803,11 @@ impl_init(const struct spa_handle_factory *factory,
 	this->port_params[2] = SPA_PARAM_INFO(SPA_PARAM_IO, SPA_PARAM_INFO_READ);
 	this->port_params[3] = SPA_PARAM_INFO(SPA_PARAM_Format, SPA_PARAM_INFO_WRITE);
 	this->port_params[4] = SPA_PARAM_INFO(SPA_PARAM_Buffers, 0);
+	this->port_params[5] = SPA_PARAM_INFO(SPA_PARAM_Latency, SPA_PARAM_INFO_READ);
 	this->port_info.params = this->port_params;
-	this->port_info.n_params = 5;
+	this->port_info.n_params = 6;
+
+	this->latency = SPA_LATENCY_INFO(SPA_DIRECTION_INPUT);
 
 	spa_list_init(&this->free);
 	spa_list_init(&this->ready);
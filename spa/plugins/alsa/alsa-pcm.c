@@ -604,6 +604,42 @@ static int alsa_recover(struct state *state, int err)
 	return 0;
 }
 
+static int do_update_latency(struct spa_loop *loop, bool async, uint32_t seq,
+		const void *data, size_t size, void *user_data)
+{
+	struct state *state = user_data;
+	const uint32_t *extra = data;
+	uint32_t i;
+
+	spa_log_debug(state->log, NAME" %p: latency %u", state, *extra);
+
+	state->latency.min_rate = state->latency.max_rate = *extra;
+
+	for (i = 0; i < state->port_info.n_params; i++) {
+		if (state->port_params[i].id == SPA_PARAM_Latency)
+			state->port_params[i].flags ^= SPA_PARAM_INFO_SERIAL;
+	}
+	state->port_info.change_mask |= SPA_PORT_CHANGE_MASK_PARAMS;
+	spa_node_emit_port_info(&state->hooks,
+			state->stream == SND_PCM_STREAM_PLAYBACK ?
+				SPA_DIRECTION_INPUT : SPA_DIRECTION_OUTPUT,
+			0, &state->port_info);
+	state->port_info.change_mask = 0;
+
+	return 0;
+}
+
+/* called from the data thread, the port info is updated from the main loop */
+static void update_latency(struct state *state, uint32_t extra)
+{
+	if (state->rate_match_latency == extra || state->main_loop == NULL)
+		return;
+
+	state->rate_match_latency = extra;
+	spa_loop_invoke(state->main_loop, do_update_latency,
+			SPA_ID_INVALID, &extra, sizeof(extra), false, state);
+}
+
 static int get_status(struct state *state, snd_pcm_uframes_t *delay, snd_pcm_uframes_t *target)
 {
 	snd_pcm_sframes_t avail;
@@ -627,12 +663,14 @@ static int get_status(struct state *state, snd_pcm_uframes_t *delay, snd_pcm_ufr
 		/* We try to compensate for the latency introduced by rate matching
 		 * by moving a little closer to the device read/write pointers.
 		 * Don't try to get closer than 48 samples but instead increase the
-		 * reported latency on the port (TODO). */
+		 * reported latency on the port. */
 		if (*target <= state->delay + 48)
 			state->delay = SPA_MAX(0, (int)(*target - 48 - state->delay));
 		*target -= state->delay;
+		update_latency(state, state->rate_match->delay - state->delay);
 	} else {
 		state->delay = state->read_size = 0;
+		update_latency(state, 0);
 	}
 
 	if (state->stream == SND_PCM_STREAM_PLAYBACK) {
@@ -714,6 +752,96 @@ static int update_time(struct state *state, uint64_t nsec, snd_pcm_sframes_t del
 	return 0;
 }
 
+/* Buffers in our own process with dynamic data can be pointed straight
+ * into the mmap ring. The peer then renders into the ring or reads from
+ * it and the extra copy is avoided. Call with zero_copy set before the
+ * first buffer. */
+void spa_alsa_init_buffer(struct state *state, struct buffer *b)
+{
+	struct spa_data *d = b->buf->datas;
+
+	b->data = d[0].data;
+	b->maxsize = d[0].maxsize;
+
+	if (b->buf->n_datas == 1 &&
+	    d[0].type == SPA_DATA_MemPtr &&
+	    SPA_FLAG_IS_SET(d[0].flags, SPA_DATA_FLAG_DYNAMIC))
+		SPA_FLAG_SET(b->flags, BUFFER_FLAG_DYNAMIC);
+	else
+		state->zero_copy = false;
+}
+
+/* Point the buffers with all of flags set back at their own memory. */
+static void restore_buffers(struct state *state, uint32_t flags)
+{
+	uint32_t i;
+
+	flags |= BUFFER_FLAG_DYNAMIC;
+
+	for (i = 0; i < state->n_buffers; i++) {
+		struct buffer *b = &state->buffers[i];
+		struct spa_data *d = b->buf->datas;
+
+		if (!SPA_FLAG_IS_SET(b->flags, flags))
+			continue;
+
+		d[0].data = b->data;
+		d[0].maxsize = b->maxsize;
+		SPA_FLAG_CLEAR(d[0].flags, SPA_DATA_FLAG_TARGET);
+	}
+}
+
+/* Point the buffers that the producer can use for the next cycle at the
+ * ring and mark them with SPA_DATA_FLAG_TARGET. A producer that knows the
+ * flag writes to the data pointer and leaves it there, spa_alsa_write()
+ * then finds the samples in place. A producer that writes elsewhere
+ * updates the data pointer and we copy as usual.
+ *
+ * Only the dequeued buffers are touched, a partially written buffer on
+ * the ready list keeps its data pointer and, when it was rendered in
+ * place, its remaining samples sit at the current ring position. */
+static void prepare_buffers(struct state *state)
+{
+	const snd_pcm_channel_area_t *my_areas;
+	snd_pcm_uframes_t offset, frames;
+	uint32_t i, maxsize;
+	void *data;
+
+	if (!spa_list_is_empty(&state->ready)) {
+		restore_buffers(state, BUFFER_FLAG_OUT);
+		return;
+	}
+
+	frames = state->buffer_frames;
+	if (snd_pcm_mmap_begin(state->hndl, &my_areas, &offset, &frames) < 0) {
+		restore_buffers(state, BUFFER_FLAG_OUT);
+		return;
+	}
+	/* we only want to know where the free part of the ring is, the samples
+	 * are committed by spa_alsa_write() when they are there */
+	snd_pcm_mmap_commit(state->hndl, offset, 0);
+
+	if (frames < state->threshold * 2) {
+		/* not enough contiguous room, render in the buffer memory */
+		restore_buffers(state, BUFFER_FLAG_OUT);
+		return;
+	}
+	data = SPA_MEMBER(my_areas[0].addr, offset * state->frame_size, void);
+	maxsize = frames * state->frame_size;
+
+	for (i = 0; i < state->n_buffers; i++) {
+		struct buffer *b = &state->buffers[i];
+		struct spa_data *d = b->buf->datas;
+
+		if (!SPA_FLAG_IS_SET(b->flags, BUFFER_FLAG_OUT))
+			continue;
+
+		d[0].data = data;
+		d[0].maxsize = SPA_MIN(maxsize, b->maxsize);
+		SPA_FLAG_SET(d[0].flags, SPA_DATA_FLAG_TARGET);
+	}
+}
+
 int spa_alsa_write(struct state *state, snd_pcm_uframes_t silence)
 {
 	snd_pcm_t *hndl = state->hndl;
@@ -797,9 +925,18 @@ again:
 		l0 = SPA_MIN(n_bytes, maxsize - offs);
 		l1 = n_bytes - l0;
 
-		spa_memcpy(dst, src + offs, l0);
-		if (l1 > 0)
-			spa_memcpy(dst + l0, src, l1);
+		if (src + offs == dst) {
+			/* rendered in place */
+		} else if (SPA_FLAG_IS_SET(b->flags, BUFFER_FLAG_DYNAMIC) && src != b->data) {
+			/* the ring moved after a resync */
+			memmove(dst, src + offs, l0);
+			if (l1 > 0)
+				memmove(dst + l0, src, l1);
+		} else {
+			spa_memcpy(dst, src + offs, l0);
+			if (l1 > 0)
+				spa_memcpy(dst + l0, src, l1);
+		}
 
 		state->ready_offset += n_bytes;
 
@@ -844,6 +981,9 @@ again:
 
 	state->sample_count += total_written;
 
+	if (state->zero_copy)
+		prepare_buffers(state);
+
 	if (!state->alsa_started && total_written > 0) {
 		spa_log_trace(state->log, NAME" %p: snd_pcm_start %lu", state, written);
 		if ((res = snd_pcm_start(hndl)) < 0) {
@@ -885,6 +1025,7 @@ push_frames(struct state *state,
 		}
 
 		d = b->buf->datas;
+		d[0].data = b->data;
 
 		avail = d[0].maxsize / state->frame_size;
 		total_frames = SPA_MIN(avail, frames);
@@ -896,9 +1037,17 @@ push_frames(struct state *state,
 			l1 = n_bytes - l0;
 
 			src = SPA_MEMBER(my_areas[0].addr, offset * state->frame_size, uint8_t);
-			spa_memcpy(d[0].data, src, l0);
-			if (l1 > 0)
-				spa_memcpy(SPA_MEMBER(d[0].data, l0, void), my_areas[0].addr, l1);
+			/* let the consumer read from the ring when the frames are
+			 * contiguous and the hardware can't come back to them
+			 * during this cycle */
+			if (SPA_FLAG_IS_SET(b->flags, BUFFER_FLAG_DYNAMIC) && l1 == 0 &&
+			    state->buffer_frames >= state->threshold * 4) {
+				d[0].data = src;
+			} else {
+				spa_memcpy(d[0].data, src, l0);
+				if (l1 > 0)
+					spa_memcpy(SPA_MEMBER(d[0].data, l0, void), my_areas[0].addr, l1);
+			}
 		} else {
 			memset(d[0].data, 0, n_bytes);
 		}
@@ -1258,6 +1407,8 @@ static int do_remove_source(struct spa_loop *loop,
 	struct itimerspec ts;
 
 	spa_loop_remove_source(state->data_loop, &state->source);
+	/* the ring goes away, don't leave anyone pointing into it */
+	restore_buffers(state, 0);
 	ts.it_value.tv_sec = 0;
 	ts.it_value.tv_nsec = 0;
 	ts.it_interval.tv_sec = 0;
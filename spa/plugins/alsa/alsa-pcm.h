@@ -43,6 +43,7 @@ extern "C" {
 #include <spa/node/utils.h>
 #include <spa/node/io.h>
 #include <spa/param/param.h>
+#include <spa/param/latency-utils.h>
 #include <spa/param/audio/format-utils.h>
 
 #define MIN_LATENCY	16
@@ -63,10 +64,14 @@ struct props {
 
 struct buffer {
 	uint32_t id;
-#define BUFFER_FLAG_OUT	(1<<0)
+#define BUFFER_FLAG_OUT		(1<<0)
+#define BUFFER_FLAG_DYNAMIC	(1<<1)	/* in-process memory, the data can point into
+					 * the mmap ring */
 	uint32_t flags;
 	struct spa_buffer *buf;
 	struct spa_meta_header *h;
+	void *data;			/* the memory of the buffer */
+	uint32_t maxsize;
 	struct spa_list link;
 };
 
@@ -82,6 +87,7 @@ struct state {
 	struct spa_log *log;
 	struct spa_system *data_system;
 	struct spa_loop *data_loop;
+	struct spa_loop *main_loop;
 
 	snd_pcm_stream_t stream;
 	snd_output_t *output;
@@ -91,6 +97,9 @@ struct state {
 
 	uint64_t info_all;
 	struct spa_node_info info;
+	struct spa_dict_item info_items[4];
+	struct spa_dict info_props;
+	char max_latency[64];
 	struct spa_param_info params[8];
 	struct props props;
 
@@ -114,6 +123,8 @@ struct state {
 	uint64_t port_info_all;
 	struct spa_port_info port_info;
 	struct spa_param_info port_params[8];
+	struct spa_latency_info latency;	/**< latency that is not in the clock delay */
+	uint32_t rate_match_latency;		/**< uncompensated rate match delay, data thread */
 	struct spa_io_buffers *io;
 	struct spa_io_clock *clock;
 	struct spa_io_position *position;
@@ -141,6 +152,7 @@ struct state {
 	unsigned int alsa_recovering:1;
 	unsigned int slaved:1;
 	unsigned int matching:1;
+	unsigned int zero_copy:1;
 
 	int64_t sample_count;
 
@@ -169,6 +181,8 @@ int spa_alsa_reslave(struct state *state);
 int spa_alsa_pause(struct state *state);
 int spa_alsa_close(struct state *state);
 
+void spa_alsa_init_buffer(struct state *state, struct buffer *b);
+
 int spa_alsa_write(struct state *state, snd_pcm_uframes_t silence);
 int spa_alsa_read(struct state *state, snd_pcm_uframes_t silence);
 
@@ -0,0 +1,308 @@
+/* Spa ALSA
+ *
+ * Copyright © 2020 Wim Taymans
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the next
+ * paragraph) shall be included in all copies or substantial portions of the
+ * Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+#include <string.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "alsa-pcm.c"
+
+/* the device is replaced by a ring in memory. Only the calls that
+ * spa_alsa_write() makes are implemented. */
+#define RING_FRAMES	1024
+#define N_CHANNELS	2
+#define FRAME_SIZE	(N_CHANNELS * sizeof(float))
+#define THRESHOLD	128
+#define N_BUFFERS	2
+
+static struct {
+	uint8_t data[RING_FRAMES * FRAME_SIZE];
+	snd_pcm_channel_area_t area;
+	snd_pcm_uframes_t appl;		/* frames written */
+	snd_pcm_uframes_t hw;		/* frames played */
+	bool begun;
+} ring;
+
+int snd_pcm_mmap_begin(snd_pcm_t *pcm, const snd_pcm_channel_area_t **areas,
+		snd_pcm_uframes_t *offset, snd_pcm_uframes_t *frames)
+{
+	snd_pcm_uframes_t avail, contiguous;
+
+	/* every begin is followed by a commit */
+	spa_assert(!ring.begun);
+	ring.begun = true;
+
+	*offset = ring.appl % RING_FRAMES;
+	avail = RING_FRAMES - (ring.appl - ring.hw);
+	contiguous = RING_FRAMES - *offset;
+	*frames = SPA_MIN(*frames, SPA_MIN(avail, contiguous));
+	*areas = &ring.area;
+	return 0;
+}
+
+snd_pcm_sframes_t snd_pcm_mmap_commit(snd_pcm_t *pcm,
+		snd_pcm_uframes_t offset, snd_pcm_uframes_t frames)
+{
+	spa_assert(ring.begun);
+	spa_assert(offset == ring.appl % RING_FRAMES);
+	ring.begun = false;
+	ring.appl += frames;
+	return frames;
+}
+
+int snd_pcm_start(snd_pcm_t *pcm)
+{
+	return 0;
+}
+
+struct data {
+	struct state state;
+	struct spa_io_buffers io;
+	struct spa_buffer buffers[N_BUFFERS];
+	struct spa_data datas[N_BUFFERS];
+	struct spa_chunk chunks[N_BUFFERS];
+	float mem[N_BUFFERS][RING_FRAMES * N_CHANNELS];
+};
+
+static void init_data(struct data *d)
+{
+	struct state *state = &d->state;
+	uint32_t i;
+
+	spa_zero(ring);
+	ring.area.addr = ring.data;
+	ring.area.step = FRAME_SIZE * 8;
+
+	spa_zero(*d);
+	state->hndl = (snd_pcm_t *) &ring;
+	state->stream = SND_PCM_STREAM_PLAYBACK;
+	state->channels = N_CHANNELS;
+	state->frame_size = FRAME_SIZE;
+	state->buffer_frames = RING_FRAMES;
+	state->threshold = THRESHOLD;
+	state->alsa_started = true;
+	state->io = &d->io;
+	spa_list_init(&state->ready);
+
+	/* like use_buffers on the sink */
+	state->zero_copy = true;
+	for (i = 0; i < N_BUFFERS; i++) {
+		struct buffer *b = &state->buffers[i];
+
+		d->datas[i].type = SPA_DATA_MemPtr;
+		d->datas[i].flags = SPA_DATA_FLAG_READWRITE | SPA_DATA_FLAG_DYNAMIC;
+		d->datas[i].data = d->mem[i];
+		d->datas[i].maxsize = sizeof(d->mem[i]);
+		d->datas[i].chunk = &d->chunks[i];
+		d->buffers[i].n_datas = 1;
+		d->buffers[i].datas = &d->datas[i];
+
+		b->id = i;
+		b->flags = BUFFER_FLAG_OUT;
+		b->buf = &d->buffers[i];
+		spa_alsa_init_buffer(state, b);
+	}
+	state->n_buffers = N_BUFFERS;
+	spa_assert(state->zero_copy);
+}
+
+/* what fmtconvert does: write where the sink wants the samples, or in the
+ * memory of the buffer */
+static void render(struct data *d, uint32_t id, uint32_t n_frames, float value)
+{
+	struct spa_data *sd = &d->datas[id];
+	float *dst;
+	uint32_t i;
+
+	if (!SPA_FLAG_IS_SET(sd->flags, SPA_DATA_FLAG_TARGET))
+		sd->data = d->mem[id];
+
+	spa_assert(n_frames * FRAME_SIZE <= sd->maxsize);
+	dst = sd->data;
+	for (i = 0; i < n_frames * N_CHANNELS; i++)
+		dst[i] = value;
+
+	sd->chunk->offset = 0;
+	sd->chunk->size = n_frames * FRAME_SIZE;
+	sd->chunk->stride = FRAME_SIZE;
+}
+
+/* what the sink does in process */
+static void queue(struct data *d, uint32_t id)
+{
+	struct buffer *b = &d->state.buffers[id];
+
+	spa_assert(SPA_FLAG_IS_SET(b->flags, BUFFER_FLAG_OUT));
+	spa_list_append(&d->state.ready, &b->link);
+	SPA_FLAG_CLEAR(b->flags, BUFFER_FLAG_OUT);
+	spa_assert(spa_alsa_write(&d->state, 0) == 0);
+	spa_assert(!ring.begun);
+}
+
+static bool ring_has(snd_pcm_uframes_t pos, uint32_t n_frames, float value)
+{
+	float *p = SPA_MEMBER(ring.data, (pos % RING_FRAMES) * FRAME_SIZE, float);
+	uint32_t i;
+
+	for (i = 0; i < n_frames * N_CHANNELS; i++)
+		if (p[i] != value)
+			return false;
+	return true;
+}
+
+static bool mem_is_zero(struct data *d, uint32_t id)
+{
+	uint32_t i;
+
+	for (i = 0; i < SPA_N_ELEMENTS(d->mem[id]); i++)
+		if (d->mem[id][i] != 0.0f)
+			return false;
+	return true;
+}
+
+static bool points_at_ring(struct data *d, uint32_t id, snd_pcm_uframes_t pos)
+{
+	return d->datas[id].data == SPA_MEMBER(ring.data, (pos % RING_FRAMES) * FRAME_SIZE, void) &&
+		SPA_FLAG_IS_SET(d->datas[id].flags, SPA_DATA_FLAG_TARGET);
+}
+
+static bool points_at_mem(struct data *d, uint32_t id)
+{
+	return d->datas[id].data == d->mem[id] &&
+		d->datas[id].maxsize == sizeof(d->mem[id]) &&
+		!SPA_FLAG_IS_SET(d->datas[id].flags, SPA_DATA_FLAG_TARGET);
+}
+
+/* samples rendered in the ring are committed without a copy */
+static void test_in_place(void)
+{
+	struct data d;
+	uint32_t i;
+
+	init_data(&d);
+
+	/* a write without samples hands out the ring */
+	spa_assert(spa_alsa_write(&d.state, 0) == 0);
+	spa_assert(!ring.begun);
+	spa_assert(ring.appl == 0);
+	for (i = 0; i < N_BUFFERS; i++)
+		spa_assert(points_at_ring(&d, i, 0));
+
+	for (i = 0; i < 4; i++) {
+		uint32_t id = i % N_BUFFERS;
+		snd_pcm_uframes_t pos = ring.appl;
+
+		render(&d, id, THRESHOLD, i + 1.0f);
+		queue(&d, id);
+
+		spa_assert(ring.appl == pos + THRESHOLD);
+		spa_assert(ring_has(pos, THRESHOLD, i + 1.0f));
+		spa_assert(mem_is_zero(&d, id));
+		/* the buffer is reused and points at the next free part */
+		spa_assert(points_at_ring(&d, id, ring.appl));
+
+		/* the device plays what we wrote */
+		ring.hw = ring.appl;
+	}
+}
+
+/* the ring moved after the buffer was handed out */
+static void test_moved(void)
+{
+	struct data d;
+
+	init_data(&d);
+	spa_assert(spa_alsa_write(&d.state, 0) == 0);
+	spa_assert(points_at_ring(&d, 0, 0));
+
+	render(&d, 0, THRESHOLD, 1.0f);
+	/* like a resync that skips some frames */
+	ring.appl = ring.hw = 16;
+	queue(&d, 0);
+
+	spa_assert(ring.appl == 16 + THRESHOLD);
+	spa_assert(ring_has(16, THRESHOLD, 1.0f));
+	spa_assert(mem_is_zero(&d, 0));
+}
+
+/* a producer that doesn't know about the target writes in its own memory */
+static void test_copy(void)
+{
+	struct data d;
+
+	init_data(&d);
+	spa_assert(spa_alsa_write(&d.state, 0) == 0);
+
+	SPA_FLAG_CLEAR(d.datas[0].flags, SPA_DATA_FLAG_TARGET);
+	render(&d, 0, THRESHOLD, 1.0f);
+	queue(&d, 0);
+
+	spa_assert(ring.appl == THRESHOLD);
+	spa_assert(ring_has(0, THRESHOLD, 1.0f));
+	spa_assert(!mem_is_zero(&d, 0));
+}
+
+/* without enough contiguous room the buffers get their memory back */
+static void test_no_room(void)
+{
+	struct data d;
+	uint32_t i;
+
+	init_data(&d);
+	spa_assert(spa_alsa_write(&d.state, 0) == 0);
+
+	/* the device is behind, after this buffer the ring is almost full */
+	ring.appl = RING_FRAMES - 2 * THRESHOLD;
+	render(&d, 0, THRESHOLD, 1.0f);
+	queue(&d, 0);
+
+	spa_assert(ring.appl == RING_FRAMES - THRESHOLD);
+	spa_assert(ring_has(RING_FRAMES - 2 * THRESHOLD, THRESHOLD, 1.0f));
+	for (i = 0; i < N_BUFFERS; i++)
+		spa_assert(points_at_mem(&d, i));
+}
+
+/* nothing points into the ring when the device stops */
+static void test_restore(void)
+{
+	struct data d;
+	uint32_t i;
+
+	init_data(&d);
+	spa_assert(spa_alsa_write(&d.state, 0) == 0);
+
+	restore_buffers(&d.state, 0);
+	for (i = 0; i < N_BUFFERS; i++)
+		spa_assert(points_at_mem(&d, i));
+}
+
+int main(int argc, char *argv[])
+{
+	test_in_place();
+	test_moved();
+	test_copy();
+	test_no_room();
+	test_restore();
+	return 0;
+}
@@ -36,6 +36,8 @@
 #include <spa/pod/parser.h>
 #include <spa/pod/filter.h>
 #include <spa/param/param.h>
+#include <spa/param/buffers-utils.h>
+#include <spa/param/latency-utils.h>
 #include <spa/param/audio/format-utils.h>
 #include <spa/debug/format.h>
 #include <spa/debug/pod.h>
@@ -59,6 +61,7 @@ struct impl {
 	struct spa_node *slave;
 	struct spa_hook slave_listener;
 	uint32_t slave_flags;
+	uint32_t slave_latency_flags;
 	struct spa_audio_info slave_current_format;
 
 	struct spa_handle *hnd_convert;
@@ -245,6 +248,7 @@ static int negotiate_buffers(struct impl *this)
 	int res;
 	bool slave_alloc, conv_alloc;
 	uint32_t i, size, buffers, blocks, align, flags;
+	struct spa_buffers_info info = { .blocks = 1, .align = 16, };
 	uint32_t *aligns;
 	struct spa_data *datas;
 	uint32_t slave_flags, conv_flags;
@@ -291,14 +295,14 @@ static int negotiate_buffers(struct impl *this)
 			slave_alloc = false;
 	}
 
-	if ((res = spa_pod_parse_object(param,
-			SPA_TYPE_OBJECT_ParamBuffers, NULL,
-			SPA_PARAM_BUFFERS_buffers, SPA_POD_Int(&buffers),
-			SPA_PARAM_BUFFERS_blocks,  SPA_POD_Int(&blocks),
-			SPA_PARAM_BUFFERS_size,    SPA_POD_Int(&size),
-			SPA_PARAM_BUFFERS_align,   SPA_POD_Int(&align))) < 0)
+	if ((res = spa_buffers_parse(param, &info)) < 0)
 		return res;
 
+	buffers = info.buffers;
+	blocks = info.blocks;
+	size = info.size;
+	align = info.align;
+
 	spa_log_debug(this->log, "%p: buffers %d, blocks %d, size %d, align %d %d:%d",
 			this, buffers, blocks, size, align, slave_alloc, conv_alloc);
 
@@ -620,6 +624,19 @@ static void slave_port_info(void *data,
 		case SPA_PARAM_Format:
 			idx = 3;
 			break;
+		case SPA_PARAM_Latency:
+			/* the latency of our ports is the one of the slave, let
+			 * the converter ports emit their info again so that the
+			 * new latency is read */
+			if (this->slave_latency_flags != info->params[i].flags &&
+			    this->use_converter && !this->add_listener) {
+				struct spa_hook l;
+				spa_zero(l);
+				spa_node_add_listener(this->convert, &l, &convert_node_events, this);
+				spa_hook_remove(&l);
+			}
+			this->slave_latency_flags = info->params[i].flags;
+			break;
 		}
 		if (idx != SPA_ID_INVALID) {
 			this->params[idx] = info->params[i];
@@ -764,6 +781,52 @@ impl_node_remove_port(void *object, enum spa_direction direction, uint32_t port_
 	return spa_node_remove_port(this->target, direction, port_id);
 }
 
+static int port_enum_latency(struct impl *this, int seq,
+			   uint32_t start, uint32_t num,
+			   const struct spa_pod *filter)
+{
+	struct spa_pod *param;
+	struct spa_pod_builder b = { 0 };
+	uint8_t buffer[1024];
+	struct spa_result_node_params result;
+	uint32_t count = 0;
+	int res;
+
+	result.id = SPA_PARAM_Latency;
+	result.next = start;
+
+	while (count < num) {
+		struct spa_latency_info info;
+
+		result.index = result.next;
+
+		spa_pod_builder_init(&b, buffer, sizeof(buffer));
+		if ((res = spa_node_port_enum_params_sync(this->slave,
+				this->direction, 0,
+				SPA_PARAM_Latency, &result.next, NULL, &param, &b)) != 1)
+			return res;
+
+		/* the resampler sits between our port and the slave, add its
+		 * delay to the latency towards the slave */
+		if (this->io_rate_match.delay > 0 &&
+		    spa_latency_parse(param, &info) >= 0 &&
+		    info.direction == SPA_DIRECTION_REVERSE(this->direction)) {
+			info.min_rate += this->io_rate_match.delay;
+			info.max_rate += this->io_rate_match.delay;
+
+			spa_pod_builder_init(&b, buffer, sizeof(buffer));
+			param = spa_latency_build(&b, SPA_PARAM_Latency, &info);
+		}
+
+		if (spa_pod_filter(&b, &result.param, param, filter) < 0)
+			continue;
+
+		spa_node_emit_result(&this->hooks, seq, 0, SPA_RESULT_TYPE_NODE_PARAMS, &result);
+		count++;
+	}
+	return 0;
+}
+
 static int
 impl_node_port_enum_params(void *object, int seq,
 			   enum spa_direction direction, uint32_t port_id,
@@ -780,6 +843,10 @@ impl_node_port_enum_params(void *object, int seq,
 
 	spa_log_debug(this->log, NAME" %p: %d %u", this, seq, id);
 
+	/* the latency is the one of the slave plus the resampler delay */
+	if (id == SPA_PARAM_Latency && this->use_converter)
+		return port_enum_latency(this, seq, start, num, filter);
+
 	return spa_node_port_enum_params(this->target, seq, direction, port_id, id,
 			start, num, filter);
 }
@@ -797,6 +864,14 @@ impl_node_port_set_param(void *object,
 
 	spa_log_debug(this->log, " %d %d %d %d", port_id, id, direction, this->direction);
 
+	if (id == SPA_PARAM_Latency && this->use_converter) {
+		/* the monitor ports don't tell the slave anything */
+		if (direction != this->direction)
+			return 0;
+		return spa_node_port_set_param(this->slave, direction, 0,
+				id, flags, param);
+	}
+
 	if (direction != this->direction)
 		port_id++;
 
@@ -38,10 +38,13 @@
 #include <spa/node/utils.h>
 #include <spa/param/audio/format-utils.h>
 #include <spa/param/param.h>
+#include <spa/param/buffers-utils.h>
 #include <spa/pod/filter.h>
 #include <spa/debug/pod.h>
 #include <spa/debug/types.h>
 
+#include "fused.h"
+
 #define NAME "audioconvert"
 
 struct buffer {
@@ -108,9 +111,14 @@ struct impl {
 	bool have_fmt_listener[2];
 
 	struct spa_hook listener[2];
+	uint32_t props_flags[2];
+
+	struct fused fused;
+	uint8_t scratch[2][FUSED_SCRATCH_SIZE + FUSED_ALIGN];
 
 	unsigned int started:1;
 	unsigned int add_listener:1;
+	unsigned int collect_params:1;
 };
 
 #define IS_MONITOR_PORT(this,dir,port_id) (dir == SPA_DIRECTION_OUTPUT && port_id > 0 &&	\
@@ -299,6 +307,7 @@ static int negotiate_link_buffers(struct impl *this, struct link *link)
 	int res;
 	bool in_alloc, out_alloc;
 	uint32_t i, size, buffers, blocks, align, flags;
+	struct spa_buffers_info info = { .blocks = 1, .align = 16, };
 	uint32_t *aligns;
 	struct spa_data *datas;
 
@@ -338,14 +347,14 @@ static int negotiate_link_buffers(struct impl *this, struct link *link)
 			in_alloc = false;
 	}
 
-	if (spa_pod_parse_object(param,
-		SPA_TYPE_OBJECT_ParamBuffers, NULL,
-		SPA_PARAM_BUFFERS_buffers, SPA_POD_Int(&buffers),
-		SPA_PARAM_BUFFERS_blocks,  SPA_POD_Int(&blocks),
-		SPA_PARAM_BUFFERS_size,    SPA_POD_Int(&size),
-		SPA_PARAM_BUFFERS_align,   SPA_POD_Int(&align)) < 0)
+	if (spa_buffers_parse(param, &info) < 0)
 		return -EINVAL;
 
+	buffers = info.buffers;
+	blocks = info.blocks;
+	size = info.size;
+	align = info.align;
+
 	spa_log_debug(this->log, "%p: buffers %d, blocks %d, size %d, align %d %d:%d",
 			this, buffers, blocks, size, align, out_alloc, in_alloc);
 
@@ -420,6 +429,36 @@ static int setup_buffers(struct impl *this, enum spa_direction direction)
 	return 0;
 }
 
+/* Props has the props of channelmix and the props of resample */
+static struct spa_pod *build_props(struct impl *this, struct spa_pod_builder *b, uint32_t id)
+{
+	struct spa_node *nodes[2] = { this->channelmix, this->resample };
+	struct spa_pod_frame f;
+	uint32_t i;
+
+	this->collect_params = true;
+	spa_pod_builder_push_object(b, &f, SPA_TYPE_OBJECT_Props, id);
+	for (i = 0; i < SPA_N_ELEMENTS(nodes); i++) {
+		uint8_t buffer[1024];
+		struct spa_pod_builder pb = SPA_POD_BUILDER_INIT(buffer, sizeof(buffer));
+		struct spa_pod *param;
+		struct spa_pod_prop *prop;
+		uint32_t index = 0;
+
+		if (spa_node_enum_params_sync(nodes[i], id, &index, NULL, &param, &pb) != 1 ||
+		    !spa_pod_is_object(param))
+			continue;
+
+		SPA_POD_OBJECT_FOREACH((struct spa_pod_object *) param, prop) {
+			spa_pod_builder_prop(b, prop->key, prop->flags);
+			spa_pod_builder_raw_padded(b, &prop->value, SPA_POD_SIZE(&prop->value));
+		}
+	}
+	this->collect_params = false;
+
+	return spa_pod_builder_pop(b, &f);
+}
+
 static int impl_node_enum_params(void *object, int seq,
 				 uint32_t id, uint32_t start, uint32_t num,
 				 const struct spa_pod *filter)
@@ -477,7 +516,14 @@ static int impl_node_enum_params(void *object, int seq,
 		return spa_node_enum_params(this->channelmix, seq, id, start, num, filter);
 
 	case SPA_PARAM_Props:
-		return spa_node_enum_params(this->channelmix, seq, id, start, num, filter);
+		switch (result.index) {
+		case 0:
+			param = build_props(this, &b, id);
+			break;
+		default:
+			return 0;
+		}
+		break;
 
 	default:
 		return -ENOENT;
@@ -519,6 +565,10 @@ static int impl_node_set_io(void *object, uint32_t id, void *data, size_t size)
 static void on_node_result(void *data, int seq, int res, uint32_t type, const void *result)
 {
 	struct impl *this = data;
+
+	if (this->collect_params)
+		return;
+
 	spa_log_trace(this->log, "%p: result %d %d", this, seq, res);
 	spa_node_emit_result(&this->hooks, seq, res, type, result);
 }
@@ -562,26 +612,45 @@ static struct spa_node_events fmt_output_events = {
 	.result = on_node_result,
 };
 
+/* our Props are made of the Props of channelmix and resample, change our
+ * serial when the serial of one of them changes */
+static void sub_props_info(struct impl *this, uint32_t sub,
+		const struct spa_param_info *info)
+{
+	if (info->flags == this->props_flags[sub])
+		return;
+	this->props_flags[sub] = info->flags;
+	this->params[3].flags ^= SPA_PARAM_INFO_SERIAL;
+	this->info.change_mask |= SPA_NODE_CHANGE_MASK_PARAMS;
+}
+
 static void on_channelmix_info(void *data, const struct spa_node_info *info)
 {
 	struct impl *this = data;
 	uint32_t i;
 
 	for (i = 0; i < info->n_params; i++) {
-		uint32_t idx = SPA_ID_INVALID;
-
 		switch (info->params[i].id) {
 		case SPA_PARAM_PropInfo:
-			idx = 2;
+			this->params[2] = info->params[i];
+			this->info.change_mask |= SPA_NODE_CHANGE_MASK_PARAMS;
 			break;
 		case SPA_PARAM_Props:
-			idx = 3;
+			sub_props_info(this, 0, &info->params[i]);
 			break;
 		}
-		if (idx != SPA_ID_INVALID) {
-			this->params[idx] = info->params[i];
-			this->info.change_mask |= SPA_NODE_CHANGE_MASK_PARAMS;
-		}
+	}
+	emit_node_info(this, false);
+}
+
+static void on_resample_info(void *data, const struct spa_node_info *info)
+{
+	struct impl *this = data;
+	uint32_t i;
+
+	for (i = 0; i < info->n_params; i++) {
+		if (info->params[i].id == SPA_PARAM_Props)
+			sub_props_info(this, 1, &info->params[i]);
 	}
 	emit_node_info(this, false);
 }
@@ -594,6 +663,7 @@ static struct spa_node_events channelmix_events = {
 
 static struct spa_node_events resample_events = {
 	SPA_VERSION_NODE_EVENTS,
+	.info = on_resample_info,
 	.result = on_node_result,
 };
 
@@ -754,7 +824,9 @@ static int impl_node_set_param(void *object, uint32_t id, uint32_t flags,
 	}
 	case SPA_PARAM_Props:
 	{
-		res = spa_node_set_param(this->channelmix, id, flags, param);
+		if ((res = spa_node_set_param(this->channelmix, id, flags, param)) < 0)
+			break;
+		res = spa_node_set_param(this->resample, id, flags, param);
 		break;
 	}
 	default:
@@ -1054,8 +1126,10 @@ static int impl_node_process(void *object)
 			r = spa_node_process(this->nodes[i]);
 			spa_log_trace_fp(this->log, NAME " %p: process %d %d: %s",
 					this, i, r, r < 0 ? spa_strerror(r) : "ok");
-			if (r < 0)
+			if (r < 0) {
+				fused_clear(&this->fused);
 				return r;
+			}
 
 			if (r & SPA_STATUS_HAVE_DATA)
 				ready++;
@@ -1065,6 +1139,9 @@ static int impl_node_process(void *object)
 			if (i == this->n_nodes-1)
 				res |= r & SPA_STATUS_HAVE_DATA;
 		}
+		/* run the conversions the nodes added to the pipeline */
+		fused_run(&this->fused);
+
 		if (res & SPA_STATUS_HAVE_DATA)
 			break;
 		if (ready == 0)
@@ -1164,6 +1241,8 @@ impl_init(const struct spa_handle_factory *factory,
 	struct impl *this;
 	size_t size;
 	void *iface;
+	struct spa_handle *handles[6];
+	uint32_t i;
 
 	spa_return_val_if_fail(factory != NULL, -EINVAL);
 	spa_return_val_if_fail(handle != NULL, -EINVAL);
@@ -1235,6 +1314,13 @@ impl_init(const struct spa_handle_factory *factory,
 				this->hnd_splitter,
 				info, support, n_support);
 
+	handles[0] = this->hnd_merger;
+	handles[1] = this->hnd_convert_in;
+	handles[2] = this->hnd_channelmix;
+	handles[3] = this->hnd_resample;
+	handles[4] = this->hnd_convert_out;
+	handles[5] = this->hnd_splitter;
+
 	spa_handle_get_interface(this->hnd_merger, SPA_TYPE_INTERFACE_Node, &iface);
 	this->merger = iface;
 	spa_handle_get_interface(this->hnd_convert_in, SPA_TYPE_INTERFACE_Node, &iface);
@@ -1248,6 +1334,14 @@ impl_init(const struct spa_handle_factory *factory,
 	spa_handle_get_interface(this->hnd_splitter, SPA_TYPE_INTERFACE_Node, &iface);
 	this->splitter = iface;
 
+	fused_init(&this->fused,
+			SPA_PTR_ALIGN(this->scratch[0], FUSED_ALIGN, void),
+			SPA_PTR_ALIGN(this->scratch[1], FUSED_ALIGN, void));
+	for (i = 0; i < SPA_N_ELEMENTS(handles); i++) {
+		if (spa_handle_get_interface(handles[i], FUSED_INTERFACE, &iface) == 0)
+			*(struct fused **)iface = &this->fused;
+	}
+
 	reconfigure_mode(this, SPA_PARAM_PORT_CONFIG_MODE_convert, SPA_DIRECTION_OUTPUT, false, NULL);
 	reconfigure_mode(this, SPA_PARAM_PORT_CONFIG_MODE_convert, SPA_DIRECTION_INPUT, false, NULL);
 
@@ -44,13 +44,13 @@ struct stats {
 
 #define MAX_COUNT 1000
 
-static uint8_t samp_in[MAX_SAMPLES * MAX_CHANNELS * 4];
-static uint8_t samp_out[MAX_SAMPLES * MAX_CHANNELS * 4];
+static uint8_t samp_in[MAX_SAMPLES * MAX_CHANNELS * 4] SPA_ALIGNED(64);
+static uint8_t samp_out[MAX_SAMPLES * MAX_CHANNELS * 4] SPA_ALIGNED(64);
 
 static const int sample_sizes[] = { 0, 1, 128, 513, 4096 };
 static const int channel_counts[] = { 1, 2, 4, 6, 8, 11 };
 
-#define MAX_RESULTS	SPA_N_ELEMENTS(sample_sizes) * SPA_N_ELEMENTS(channel_counts) * 60
+#define MAX_RESULTS	SPA_N_ELEMENTS(sample_sizes) * SPA_N_ELEMENTS(channel_counts) * 80
 
 static uint32_t n_results = 0;
 static struct stats results[MAX_RESULTS];
@@ -127,6 +127,13 @@ static void test_f32_s16(void)
 	run_test("test_f32d_s16", "c", false, true, conv_f32d_to_s16_c);
 #if defined (HAVE_SSE2)
 	run_test("test_f32d_s16", "sse2", false, true, conv_f32d_to_s16_sse2);
+#endif
+#if defined (HAVE_AVX2)
+	run_test("test_f32d_s16", "avx2", false, true, conv_f32d_to_s16_avx2);
+#endif
+#if defined (HAVE_NEON)
+	run_test("test_f32d_s16", "neon", false, true, conv_f32d_to_s16_neon);
+	run_test1("test_f32d_s16_2", "neon", false, true, conv_f32d_to_s16_2_neon, 2, 4096);
 #endif
 	run_test("test_f32_s16d", "c", true, false, conv_f32_to_s16d_c);
 }
@@ -138,6 +145,15 @@ static void test_s16_f32(void)
 	run_test("test_s16_f32d", "c", true, false, conv_s16_to_f32d_c);
 #if defined (HAVE_SSE2)
 	run_test("test_s16_f32d", "sse2", true, false, conv_s16_to_f32d_sse2);
+	run_test1("test_s16_f32d_2", "sse2", true, false, conv_s16_to_f32d_2_sse2, 2, 4096);
+#endif
+#if defined (HAVE_AVX2)
+	run_test("test_s16_f32d", "avx2", true, false, conv_s16_to_f32d_avx2);
+	run_test1("test_s16_f32d_2", "avx2", true, false, conv_s16_to_f32d_2_avx2, 2, 4096);
+#endif
+#if defined (HAVE_NEON)
+	run_test("test_s16_f32d", "neon", true, false, conv_s16_to_f32d_neon);
+	run_test1("test_s16_f32d_2", "neon", true, false, conv_s16_to_f32d_2_neon, 2, 4096);
 #endif
 }
 
@@ -147,6 +163,12 @@ static void test_f32_s32(void)
 	run_test("test_f32d_s32", "c", false, true, conv_f32d_to_s32_c);
 #if defined (HAVE_SSE2)
 	run_test("test_f32d_s32", "sse2", false, true, conv_f32d_to_s32_sse2);
+#endif
+#if defined (HAVE_AVX2)
+	run_test("test_f32d_s32", "avx2", false, true, conv_f32d_to_s32_avx2);
+#endif
+#if defined (HAVE_NEON)
+	run_test("test_f32d_s32", "neon", false, true, conv_f32d_to_s32_neon);
 #endif
 	run_test("test_f32_s32d", "c", true, false, conv_f32_to_s32d_c);
 }
@@ -156,6 +178,15 @@ static void test_s32_f32(void)
 	run_test("test_s32_f32", "c", true, true, conv_s32_to_f32_c);
 	run_test("test_s32d_f32", "c", false, true, conv_s32d_to_f32_c);
 	run_test("test_s32_f32d", "c", true, false, conv_s32_to_f32d_c);
+#if defined (HAVE_SSE2)
+	run_test("test_s32_f32d", "sse2", true, false, conv_s32_to_f32d_sse2);
+#endif
+#if defined (HAVE_AVX2)
+	run_test("test_s32_f32d", "avx2", true, false, conv_s32_to_f32d_avx2);
+#endif
+#if defined (HAVE_NEON)
+	run_test("test_s32_f32d", "neon", true, false, conv_s32_to_f32d_neon);
+#endif
 }
 
 static void test_f32_s24(void)
@@ -31,6 +31,7 @@
 
 #include "resample.h"
 #include "resample-native.h"
+#include "resample-interp.h"
 
 #define MAX_SAMPLES	4096
 #define MAX_CHANNELS	11
@@ -55,7 +56,7 @@ static const int in_rates[] = { 44100, 44100, 48000, 96000, 22050, 96000 };
 static const int out_rates[] = { 44100, 48000, 44100, 48000, 48000, 44100 };
 
 
-#define MAX_RESAMPLER	5
+#define MAX_RESAMPLER	7
 #define MAX_SIZES	SPA_N_ELEMENTS(sample_sizes)
 #define MAX_RATES	SPA_N_ELEMENTS(in_rates)
 #define MAX_RESULTS	MAX_RESAMPLER * MAX_SIZES * MAX_RATES
@@ -110,6 +111,114 @@ static void run_test(const char *name, const char *impl, struct resample *r)
 		run_test1(name, impl, r, sample_sizes[i]);
 }
 
+static void run_quality1(const char *name, uint32_t quality, struct resample *r)
+{
+	uint32_t i, j;
+	const void *ip[MAX_CHANNELS];
+	void *op[MAX_CHANNELS];
+	struct timespec ts;
+	uint64_t t1, t2, n_out = 0;
+	uint32_t in_len, out_len;
+
+	for (j = 0; j < r->channels; j++) {
+		ip[j] = &samp_in[j * MAX_SAMPLES];
+		op[j] = &samp_out[j * MAX_SAMPLES];
+	}
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	t1 = SPA_TIMESPEC_TO_NSEC(&ts);
+
+	for (i = 0; i < MAX_COUNT; i++) {
+		out_len = 1024;
+		in_len = resample_in_len(r, out_len);
+		resample_process(r, ip, &in_len, op, &out_len);
+		n_out += out_len;
+	}
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	t2 = SPA_TIMESPEC_TO_NSEC(&ts);
+
+	fprintf(stderr, "quality %-8s %2d \t%d->%d: %.2f ns/sample, delay %d\n",
+			name, quality, r->i_rate, r->o_rate,
+			(double)(t2 - t1) / SPA_MAX(n_out, 1u), resample_delay(r));
+}
+
+#define MAX_INSTANCES	64
+
+static void run_init_test(uint32_t options)
+{
+	static struct resample r[MAX_INSTANCES];
+	struct native_filter *filters[MAX_INSTANCES];
+	struct timespec ts;
+	uint64_t t1, t2;
+	uint32_t i, j, n_filters = 0;
+	size_t mem = 0;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	t1 = SPA_TIMESPEC_TO_NSEC(&ts);
+
+	for (i = 0; i < MAX_INSTANCES; i++) {
+		spa_zero(r[i]);
+		r[i].options = options;
+		r[i].quality = RESAMPLE_DEFAULT_QUALITY;
+		r[i].channels = 2;
+		r[i].i_rate = in_rates[i % MAX_RATES];
+		r[i].o_rate = out_rates[i % MAX_RATES];
+		impl_native_init(&r[i]);
+	}
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	t2 = SPA_TIMESPEC_TO_NSEC(&ts);
+
+	for (i = 0; i < MAX_INSTANCES; i++) {
+		struct native_data *d = r[i].data;
+
+		for (j = 0; j < n_filters; j++)
+			if (filters[j] == d->shared)
+				break;
+		if (j == n_filters) {
+			filters[n_filters++] = d->shared;
+			mem += d->shared->size;
+		}
+	}
+	for (i = 0; i < MAX_INSTANCES; i++)
+		resample_free(&r[i]);
+
+	fprintf(stderr, "init %-8s \t%d instances: %"PRIu64" ns/instance, %u filters, %zd bytes\n",
+			SPA_FLAG_IS_SET(options, RESAMPLE_OPTION_NO_CACHE) ? "uncached" : "cached",
+			MAX_INSTANCES, (t2 - t1) / MAX_INSTANCES, n_filters, mem);
+}
+
+static void run_quality_test(void)
+{
+	struct resample r;
+	uint32_t q;
+
+	for (q = 0; q <= 10; q++) {
+		spa_zero(r);
+		r.channels = 2;
+		r.quality = q;
+		r.i_rate = 44100;
+		r.o_rate = 48000;
+		impl_native_init(&r);
+		run_quality1("native", q, &r);
+		resample_free(&r);
+	}
+	spa_zero(r);
+	r.channels = 2;
+	r.i_rate = 44100;
+	r.o_rate = 48000;
+	impl_interp_init(&r, false);
+	run_quality1("linear", 0, &r);
+	resample_free(&r);
+
+	spa_zero(r);
+	r.channels = 2;
+	r.i_rate = 44100;
+	r.o_rate = 48000;
+	impl_interp_init(&r, true);
+	run_quality1("cubic", 0, &r);
+	resample_free(&r);
+}
+
 static int compare_func(const void *_a, const void *_b)
 {
 	const struct stats *a = _a, *b = _b;
@@ -131,6 +240,7 @@ int main(int argc, char *argv[])
 	for (i = 0; i < SPA_N_ELEMENTS(in_rates); i++) {
 		spa_zero(r);
 		r.channels = 2;
+		r.quality = RESAMPLE_DEFAULT_QUALITY;
 		r.cpu_flags = 0;
 		r.i_rate = in_rates[i];
 		r.o_rate = out_rates[i];
@@ -142,6 +252,7 @@ int main(int argc, char *argv[])
 	for (i = 0; i < SPA_N_ELEMENTS(in_rates); i++) {
 		spa_zero(r);
 		r.channels = 2;
+		r.quality = RESAMPLE_DEFAULT_QUALITY;
 		r.cpu_flags = SPA_CPU_FLAG_SSE;
 		r.i_rate = in_rates[i];
 		r.o_rate = out_rates[i];
@@ -154,6 +265,7 @@ int main(int argc, char *argv[])
 	for (i = 0; i < SPA_N_ELEMENTS(in_rates); i++) {
 		spa_zero(r);
 		r.channels = 2;
+		r.quality = RESAMPLE_DEFAULT_QUALITY;
 		r.cpu_flags = SPA_CPU_FLAG_SSSE3 | SPA_CPU_FLAG_SLOW_UNALIGNED;
 		r.i_rate = in_rates[i];
 		r.o_rate = out_rates[i];
@@ -166,6 +278,7 @@ int main(int argc, char *argv[])
 	for (i = 0; i < SPA_N_ELEMENTS(in_rates); i++) {
 		spa_zero(r);
 		r.channels = 2;
+		r.quality = RESAMPLE_DEFAULT_QUALITY;
 		r.cpu_flags = SPA_CPU_FLAG_AVX | SPA_CPU_FLAG_FMA3;
 		r.i_rate = in_rates[i];
 		r.o_rate = out_rates[i];
@@ -175,6 +288,25 @@ int main(int argc, char *argv[])
 	}
 #endif
 
+	for (i = 0; i < SPA_N_ELEMENTS(in_rates); i++) {
+		spa_zero(r);
+		r.channels = 2;
+		r.i_rate = in_rates[i];
+		r.o_rate = out_rates[i];
+		impl_interp_init(&r, false);
+		run_test("linear", "c", &r);
+		resample_free(&r);
+	}
+	for (i = 0; i < SPA_N_ELEMENTS(in_rates); i++) {
+		spa_zero(r);
+		r.channels = 2;
+		r.i_rate = in_rates[i];
+		r.o_rate = out_rates[i];
+		impl_interp_init(&r, true);
+		run_test("cubic", "c", &r);
+		resample_free(&r);
+	}
+
 	qsort(results, n_results, sizeof(struct stats), compare_func);
 
 	for (i = 0; i < n_results; i++) {
@@ -183,5 +315,11 @@ int main(int argc, char *argv[])
 				s->perf, s->name, s->impl, s->in_rate, s->out_rate,
 				s->n_samples, s->n_channels);
 	}
+
+	run_quality_test();
+
+	run_init_test(RESAMPLE_OPTION_NO_CACHE);
+	run_init_test(0);
+
 	return 0;
 }
@@ -0,0 +1,162 @@
+/* Spa
+ *
+ * Copyright © 2020 Wim Taymans
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the next
+ * paragraph) shall be included in all copies or substantial portions of the
+ * Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+
+#include "channelmix-ops.h"
+
+#include <immintrin.h>
+
+void channelmix_copy_avx(struct channelmix *mix, uint32_t n_dst, void * SPA_RESTRICT dst[n_dst],
+		uint32_t n_src, const void * SPA_RESTRICT src[n_src], uint32_t n_samples)
+{
+	uint32_t i, n, unrolled;
+	float **d = (float **)dst;
+	const float **s = (const float **)src;
+
+	if (mix->zero) {
+		for (i = 0; i < n_dst; i++)
+			memset(d[i], 0, n_samples * sizeof(float));
+	}
+	else if (mix->norm) {
+		for (i = 0; i < n_dst; i++)
+			spa_memcpy(d[i], s[i], n_samples * sizeof(float));
+	}
+	else {
+		for (i = 0; i < n_dst; i++) {
+			float *di = d[i];
+			const float *si = s[i];
+			__m256 t[4];
+			const __m256 vol = _mm256_set1_ps(mix->matrix[i][i]);
+
+			if (SPA_IS_ALIGNED(di, 32) &&
+			    SPA_IS_ALIGNED(si, 32))
+				unrolled = n_samples & ~31;
+			else
+				unrolled = 0;
+
+			for(n = 0; n < unrolled; n += 32) {
+				t[0] = _mm256_load_ps(&si[n]);
+				t[1] = _mm256_load_ps(&si[n+8]);
+				t[2] = _mm256_load_ps(&si[n+16]);
+				t[3] = _mm256_load_ps(&si[n+24]);
+				_mm256_store_ps(&di[n], _mm256_mul_ps(t[0], vol));
+				_mm256_store_ps(&di[n+8], _mm256_mul_ps(t[1], vol));
+				_mm256_store_ps(&di[n+16], _mm256_mul_ps(t[2], vol));
+				_mm256_store_ps(&di[n+24], _mm256_mul_ps(t[3], vol));
+			}
+			for(; n < n_samples; n++)
+				_mm_store_ss(&di[n], _mm_mul_ss(_mm_load_ss(&si[n]),
+							_mm256_castps256_ps128(vol)));
+		}
+	}
+}
+
+void
+channelmix_f32_n_m_avx(struct channelmix *mix, uint32_t n_dst, void * SPA_RESTRICT dst[n_dst],
+		uint32_t n_src, const void * SPA_RESTRICT src[n_src], uint32_t n_samples)
+{
+	uint32_t i, j, n, unrolled;
+	float **d = (float **) dst;
+	const float **s = (const float **) src;
+	bool aligned = true;
+
+	for (j = 0; j < n_src; j++)
+		aligned &= SPA_IS_ALIGNED(s[j], 32);
+	for (i = 0; i < n_dst; i++)
+		aligned &= SPA_IS_ALIGNED(d[i], 32);
+
+	unrolled = aligned ? n_samples & ~7 : 0;
+
+	for (i = 0; i < n_dst; i++) {
+		float *di = d[i];
+		const float *mi = mix->matrix[i];
+
+		for (n = 0; n < unrolled; n += 8) {
+			__m256 sum = _mm256_setzero_ps();
+			for (j = 0; j < n_src; j++)
+				sum = _mm256_fmadd_ps(_mm256_load_ps(&s[j][n]),
+						_mm256_set1_ps(mi[j]), sum);
+			_mm256_store_ps(&di[n], sum);
+		}
+		for (; n < n_samples; n++) {
+			float sum = 0.0f;
+			for (j = 0; j < n_src; j++)
+				sum += s[j][n] * mi[j];
+			di[n] = sum;
+		}
+	}
+}
+
+/* FL+FR+FC+LFE+SL+SR -> FL+FR */
+void
+channelmix_f32_5p1_2_avx(struct channelmix *mix, uint32_t n_dst, void * SPA_RESTRICT dst[n_dst],
+		uint32_t n_src, const void * SPA_RESTRICT src[n_src], uint32_t n_samples)
+{
+	uint32_t n, unrolled;
+	float **d = (float **) dst;
+	const float **s = (const float **) src;
+	const __m256 v0 = _mm256_set1_ps(mix->matrix[0][0]);
+	const __m256 v1 = _mm256_set1_ps(mix->matrix[1][1]);
+	const __m256 clev = _mm256_set1_ps(mix->matrix[2][0]);
+	const __m256 llev = _mm256_set1_ps(mix->matrix[3][0]);
+	const __m256 slev0 = _mm256_set1_ps(mix->matrix[4][0]);
+	const __m256 slev1 = _mm256_set1_ps(mix->matrix[4][1]);
+	__m256 ctr, out[2];
+	const float *sFL = s[0], *sFR = s[1], *sFC = s[2], *sLFE = s[3], *sSL = s[4], *sSR = s[5];
+	float *dFL = d[0], *dFR = d[1];
+
+	if (SPA_IS_ALIGNED(sFL, 32) &&
+	    SPA_IS_ALIGNED(sFR, 32) &&
+	    SPA_IS_ALIGNED(sFC, 32) &&
+	    SPA_IS_ALIGNED(sLFE, 32) &&
+	    SPA_IS_ALIGNED(sSL, 32) &&
+	    SPA_IS_ALIGNED(sSR, 32) &&
+	    SPA_IS_ALIGNED(dFL, 32) &&
+	    SPA_IS_ALIGNED(dFR, 32))
+		unrolled = n_samples & ~7;
+	else
+		unrolled = 0;
+
+	if (mix->zero) {
+		memset(dFL, 0, n_samples * sizeof(float));
+		memset(dFR, 0, n_samples * sizeof(float));
+		return;
+	}
+
+	for(n = 0; n < unrolled; n += 8) {
+		ctr = _mm256_mul_ps(_mm256_load_ps(&sFC[n]), clev);
+		ctr = _mm256_fmadd_ps(_mm256_load_ps(&sLFE[n]), llev, ctr);
+		out[0] = _mm256_fmadd_ps(_mm256_load_ps(&sFL[n]), v0, ctr);
+		out[1] = _mm256_fmadd_ps(_mm256_load_ps(&sFR[n]), v1, ctr);
+		out[0] = _mm256_fmadd_ps(_mm256_load_ps(&sSL[n]), slev0, out[0]);
+		out[1] = _mm256_fmadd_ps(_mm256_load_ps(&sSR[n]), slev1, out[1]);
+		_mm256_store_ps(&dFL[n], out[0]);
+		_mm256_store_ps(&dFR[n], out[1]);
+	}
+	for(; n < n_samples; n++) {
+		const float c = mix->matrix[2][0] * sFC[n] + mix->matrix[3][0] * sLFE[n];
+		dFL[n] = sFL[n] * mix->matrix[0][0] + c + mix->matrix[4][0] * sSL[n];
+		dFR[n] = sFR[n] * mix->matrix[1][1] + c + mix->matrix[4][1] * sSR[n];
+	}
+}
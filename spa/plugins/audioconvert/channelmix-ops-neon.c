@@ -0,0 +1,128 @@
+/* Spa
+ *
+ * Copyright © 2020 Wim Taymans
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the next
+ * paragraph) shall be included in all copies or substantial portions of the
+ * Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+
+#include "channelmix-ops.h"
+
+#include <arm_neon.h>
+
+void channelmix_copy_neon(struct channelmix *mix, uint32_t n_dst, void * SPA_RESTRICT dst[n_dst],
+		uint32_t n_src, const void * SPA_RESTRICT src[n_src], uint32_t n_samples)
+{
+	uint32_t i, n, unrolled = n_samples & ~7;
+	float **d = (float **)dst;
+	const float **s = (const float **)src;
+
+	if (mix->zero) {
+		for (i = 0; i < n_dst; i++)
+			memset(d[i], 0, n_samples * sizeof(float));
+	}
+	else if (mix->norm) {
+		for (i = 0; i < n_dst; i++)
+			spa_memcpy(d[i], s[i], n_samples * sizeof(float));
+	}
+	else {
+		for (i = 0; i < n_dst; i++) {
+			float *di = d[i];
+			const float *si = s[i];
+			const float vol = mix->matrix[i][i];
+			const float32x4_t v = vdupq_n_f32(vol);
+
+			for(n = 0; n < unrolled; n += 8) {
+				vst1q_f32(&di[n], vmulq_f32(vld1q_f32(&si[n]), v));
+				vst1q_f32(&di[n+4], vmulq_f32(vld1q_f32(&si[n+4]), v));
+			}
+			for(; n < n_samples; n++)
+				di[n] = si[n] * vol;
+		}
+	}
+}
+
+void
+channelmix_f32_n_m_neon(struct channelmix *mix, uint32_t n_dst, void * SPA_RESTRICT dst[n_dst],
+		uint32_t n_src, const void * SPA_RESTRICT src[n_src], uint32_t n_samples)
+{
+	uint32_t i, j, n, unrolled = n_samples & ~3;
+	float **d = (float **) dst;
+	const float **s = (const float **) src;
+
+	for (i = 0; i < n_dst; i++) {
+		float *di = d[i];
+		const float *mi = mix->matrix[i];
+
+		for (n = 0; n < unrolled; n += 4) {
+			float32x4_t sum = vdupq_n_f32(0.0f);
+			for (j = 0; j < n_src; j++)
+				sum = vmlaq_f32(sum, vld1q_f32(&s[j][n]), vdupq_n_f32(mi[j]));
+			vst1q_f32(&di[n], sum);
+		}
+		for (; n < n_samples; n++) {
+			float sum = 0.0f;
+			for (j = 0; j < n_src; j++)
+				sum += s[j][n] * mi[j];
+			di[n] = sum;
+		}
+	}
+}
+
+/* FL+FR+FC+LFE+SL+SR -> FL+FR */
+void
+channelmix_f32_5p1_2_neon(struct channelmix *mix, uint32_t n_dst, void * SPA_RESTRICT dst[n_dst],
+		uint32_t n_src, const void * SPA_RESTRICT src[n_src], uint32_t n_samples)
+{
+	uint32_t n, unrolled = n_samples & ~3;
+	float **d = (float **) dst;
+	const float **s = (const float **) src;
+	const float32x4_t v0 = vdupq_n_f32(mix->matrix[0][0]);
+	const float32x4_t v1 = vdupq_n_f32(mix->matrix[1][1]);
+	const float32x4_t clev = vdupq_n_f32(mix->matrix[2][0]);
+	const float32x4_t llev = vdupq_n_f32(mix->matrix[3][0]);
+	const float32x4_t slev0 = vdupq_n_f32(mix->matrix[4][0]);
+	const float32x4_t slev1 = vdupq_n_f32(mix->matrix[4][1]);
+	float32x4_t ctr, out[2];
+	const float *sFL = s[0], *sFR = s[1], *sFC = s[2], *sLFE = s[3], *sSL = s[4], *sSR = s[5];
+	float *dFL = d[0], *dFR = d[1];
+
+	if (mix->zero) {
+		memset(dFL, 0, n_samples * sizeof(float));
+		memset(dFR, 0, n_samples * sizeof(float));
+		return;
+	}
+
+	for(n = 0; n < unrolled; n += 4) {
+		ctr = vmulq_f32(vld1q_f32(&sFC[n]), clev);
+		ctr = vmlaq_f32(ctr, vld1q_f32(&sLFE[n]), llev);
+		out[0] = vmlaq_f32(ctr, vld1q_f32(&sFL[n]), v0);
+		out[1] = vmlaq_f32(ctr, vld1q_f32(&sFR[n]), v1);
+		out[0] = vmlaq_f32(out[0], vld1q_f32(&sSL[n]), slev0);
+		out[1] = vmlaq_f32(out[1], vld1q_f32(&sSR[n]), slev1);
+		vst1q_f32(&dFL[n], out[0]);
+		vst1q_f32(&dFR[n], out[1]);
+	}
+	for(; n < n_samples; n++) {
+		const float c = mix->matrix[2][0] * sFC[n] + mix->matrix[3][0] * sLFE[n];
+		dFL[n] = sFL[n] * mix->matrix[0][0] + c + mix->matrix[4][0] * sSL[n];
+		dFR[n] = sFR[n] * mix->matrix[1][1] + c + mix->matrix[4][1] * sSR[n];
+	}
+}
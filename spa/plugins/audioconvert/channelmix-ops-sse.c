@@ -77,8 +77,14 @@ channelmix_f32_2_4_sse(struct channelmix *mix, uint32_t n_dst, void * SPA_RESTRI
 	uint32_t i, n, unrolled;
 	float **d = (float **)dst;
 	const float **s = (const float **)src;
-	const __m128 v0 = _mm_set1_ps(mix->matrix[0][0]);
-	const __m128 v1 = _mm_set1_ps(mix->matrix[1][1]);
+	const float m0 = mix->matrix[0][0];
+	const float m1 = mix->matrix[1][1];
+	const float m2 = mix->matrix[2][0];
+	const float m3 = mix->matrix[3][1];
+	const __m128 v0 = _mm_set1_ps(m0);
+	const __m128 v1 = _mm_set1_ps(m1);
+	const __m128 v2 = _mm_set1_ps(m2);
+	const __m128 v3 = _mm_set1_ps(m3);
 	__m128 in;
 	const float *sFL = s[0], *sFR = s[1];
 	float *dFL = d[0], *dFR = d[1], *dRL = d[2], *dRR = d[3];
@@ -115,7 +121,7 @@ channelmix_f32_2_4_sse(struct channelmix *mix, uint32_t n_dst, void * SPA_RESTRI
 			_mm_store_ss(&dRR[n], in);
 		}
 	}
-	else {
+	else if (m0 == m2 && m1 == m3) {
 		for(n = 0; n < unrolled; n += 4) {
 			in = _mm_mul_ps(_mm_load_ps(&sFL[n]), v0);
 			_mm_store_ps(&dFL[n], in);
@@ -133,6 +139,24 @@ channelmix_f32_2_4_sse(struct channelmix *mix, uint32_t n_dst, void * SPA_RESTRI
 			_mm_store_ss(&dRR[n], in);
 		}
 	}
+	else {
+		for(n = 0; n < unrolled; n += 4) {
+			in = _mm_load_ps(&sFL[n]);
+			_mm_store_ps(&dFL[n], _mm_mul_ps(in, v0));
+			_mm_store_ps(&dRL[n], _mm_mul_ps(in, v2));
+			in = _mm_load_ps(&sFR[n]);
+			_mm_store_ps(&dFR[n], _mm_mul_ps(in, v1));
+			_mm_store_ps(&dRR[n], _mm_mul_ps(in, v3));
+		}
+		for(; n < n_samples; n++) {
+			in = _mm_load_ss(&sFL[n]);
+			_mm_store_ss(&dFL[n], _mm_mul_ss(in, v0));
+			_mm_store_ss(&dRL[n], _mm_mul_ss(in, v2));
+			in = _mm_load_ss(&sFR[n]);
+			_mm_store_ss(&dFR[n], _mm_mul_ss(in, v1));
+			_mm_store_ss(&dRR[n], _mm_mul_ss(in, v3));
+		}
+	}
 }
 
 /* FL+FR+FC+LFE+SL+SR -> FL+FR */
@@ -313,10 +337,12 @@ channelmix_f32_5p1_4_sse(struct channelmix *mix, uint32_t n_dst, void * SPA_REST
 	uint32_t i, n, unrolled;
 	float **d = (float **) dst;
 	const float **s = (const float **) src;
-	const __m128 clev = _mm_set1_ps(mix->matrix[2][2]);
-	const __m128 llev = _mm_set1_ps(mix->matrix[3][3]);
+	const __m128 clev = _mm_set1_ps(mix->matrix[0][2]);
+	const __m128 llev = _mm_set1_ps(mix->matrix[0][3]);
 	const __m128 v0 = _mm_set1_ps(mix->matrix[0][0]);
 	const __m128 v1 = _mm_set1_ps(mix->matrix[1][1]);
+	const __m128 v4 = _mm_set1_ps(mix->matrix[2][4]);
+	const __m128 v5 = _mm_set1_ps(mix->matrix[3][5]);
 	__m128 ctr;
 	const float *sFL = s[0], *sFR = s[1], *sFC = s[2], *sLFE = s[3], *sSL = s[4], *sSR = s[5];
 	float *dFL = d[0], *dFR = d[1], *dRL = d[2], *dRR = d[3];
@@ -361,18 +387,18 @@ channelmix_f32_5p1_4_sse(struct channelmix *mix, uint32_t n_dst, void * SPA_REST
 		for(n = 0; n < unrolled; n += 4) {
 			ctr = _mm_mul_ps(_mm_load_ps(&sFC[n]), clev);
 			ctr = _mm_add_ps(ctr, _mm_mul_ps(_mm_load_ps(&sLFE[n]), llev));
-			_mm_store_ps(&dFL[n], _mm_mul_ps(_mm_add_ps(_mm_load_ps(&sFL[n]), ctr), v0));
-			_mm_store_ps(&dFR[n], _mm_mul_ps(_mm_add_ps(_mm_load_ps(&sFR[n]), ctr), v1));
-			_mm_store_ps(&dRL[n], _mm_mul_ps(_mm_load_ps(&sSL[n]), v0));
-			_mm_store_ps(&dRR[n], _mm_mul_ps(_mm_load_ps(&sSR[n]), v1));
+			_mm_store_ps(&dFL[n], _mm_add_ps(_mm_mul_ps(_mm_load_ps(&sFL[n]), v0), ctr));
+			_mm_store_ps(&dFR[n], _mm_add_ps(_mm_mul_ps(_mm_load_ps(&sFR[n]), v1), ctr));
+			_mm_store_ps(&dRL[n], _mm_mul_ps(_mm_load_ps(&sSL[n]), v4));
+			_mm_store_ps(&dRR[n], _mm_mul_ps(_mm_load_ps(&sSR[n]), v5));
 		}
 		for(; n < n_samples; n++) {
 			ctr = _mm_mul_ss(_mm_load_ss(&sFC[n]), clev);
 			ctr = _mm_add_ss(ctr, _mm_mul_ss(_mm_load_ss(&sLFE[n]), llev));
-			_mm_store_ss(&dFL[n], _mm_mul_ss(_mm_add_ss(_mm_load_ss(&sFL[n]), ctr), v0));
-			_mm_store_ss(&dFR[n], _mm_mul_ss(_mm_add_ss(_mm_load_ss(&sFR[n]), ctr), v1));
-			_mm_store_ss(&dRL[n], _mm_mul_ss(_mm_load_ss(&sSL[n]), v0));
-			_mm_store_ss(&dRR[n], _mm_mul_ss(_mm_load_ss(&sSR[n]), v1));
+			_mm_store_ss(&dFL[n], _mm_add_ss(_mm_mul_ss(_mm_load_ss(&sFL[n]), v0), ctr));
+			_mm_store_ss(&dFR[n], _mm_add_ss(_mm_mul_ss(_mm_load_ss(&sFR[n]), v1), ctr));
+			_mm_store_ss(&dRL[n], _mm_mul_ss(_mm_load_ss(&sSL[n]), v4));
+			_mm_store_ss(&dRR[n], _mm_mul_ss(_mm_load_ss(&sSR[n]), v5));
 		}
 	}
 }
@@ -101,3 +101,15 @@ DEFINE_FUNCTION(f32_5p1_3p1, sse);
 DEFINE_FUNCTION(f32_5p1_4, sse);
 DEFINE_FUNCTION(f32_7p1_4, sse);
 #endif
+
+#if defined (HAVE_AVX) && defined(HAVE_FMA)
+DEFINE_FUNCTION(copy, avx);
+DEFINE_FUNCTION(f32_n_m, avx);
+DEFINE_FUNCTION(f32_5p1_2, avx);
+#endif
+
+#if defined (HAVE_NEON)
+DEFINE_FUNCTION(copy, neon);
+DEFINE_FUNCTION(f32_n_m, neon);
+DEFINE_FUNCTION(f32_5p1_2, neon);
+#endif
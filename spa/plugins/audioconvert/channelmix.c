@@ -40,6 +40,7 @@
 #include <spa/debug/types.h>
 
 #include "channelmix-ops.h"
+#include "fused.h"
 
 #define NAME "channelmix"
 
@@ -123,6 +124,7 @@ struct impl {
 	struct port out_port;
 
 	struct channelmix mix;
+	struct fused *fused;
 	unsigned int started:1;
 	unsigned int is_passthrough:1;
 	uint32_t cpu_flags;
@@ -840,6 +842,13 @@ static int impl_node_port_reuse_buffer(void *object, uint32_t port_id, uint32_t
 	return 0;
 }
 
+static void channelmix_process_stage(void *data, uint32_t n_dst, void * SPA_RESTRICT dst[],
+		uint32_t n_src, const void * SPA_RESTRICT src[], uint32_t n_samples)
+{
+	struct channelmix *mix = data;
+	channelmix_process(mix, n_dst, dst, n_src, src, n_samples);
+}
+
 static int impl_node_process(void *object)
 {
 	struct impl *this = object;
@@ -901,7 +910,11 @@ static int impl_node_process(void *object)
 			db->datas[i].chunk->size = n_samples * outport->stride;
 		}
 
-		if (!is_passthrough)
+		if (!is_passthrough &&
+		    (this->fused == NULL ||
+		     fused_add(this->fused, channelmix_process_stage, &this->mix,
+			     n_dst_datas, dst_datas, outport->stride,
+			     n_src_datas, src_datas, inport->stride, n_samples) < 0))
 			channelmix_process(&this->mix, n_dst_datas, dst_datas,
 				    n_src_datas, src_datas, n_samples);
 	}
@@ -944,6 +957,8 @@ static int impl_get_interface(struct spa_handle *handle, const char *type, void
 
 	if (strcmp(type, SPA_TYPE_INTERFACE_Node) == 0)
 		*interface = &this->node;
+	else if (strcmp(type, FUSED_INTERFACE) == 0)
+		*interface = &this->fused;
 	else
 		return -ENOENT;
 
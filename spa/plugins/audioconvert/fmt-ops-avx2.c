@@ -0,0 +1,627 @@
+/* Spa
+ *
+ * Copyright © 2020 Wim Taymans
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the next
+ * paragraph) shall be included in all copies or substantial portions of the
+ * Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+
+#include "fmt-ops.h"
+
+#include <immintrin.h>
+
+static void
+conv_s16_to_f32d_1s_avx2(void *data, void * SPA_RESTRICT dst[], const void * SPA_RESTRICT src,
+		uint32_t n_channels, uint32_t n_samples)
+{
+	const int16_t *s = src;
+	float **d = (float **) dst;
+	float *d0 = d[0];
+	uint32_t n, unrolled;
+	__m128i in;
+	__m256 out, factor = _mm256_set1_ps(1.0f / S16_SCALE);
+	__m128 t, f1 = _mm_set1_ps(1.0f / S16_SCALE);
+
+	if (SPA_IS_ALIGNED(d0, 32))
+		unrolled = n_samples & ~7;
+	else
+		unrolled = 0;
+
+	for(n = 0; n < unrolled; n += 8) {
+		in = _mm_setr_epi16(s[0*n_channels],
+				    s[1*n_channels],
+				    s[2*n_channels],
+				    s[3*n_channels],
+				    s[4*n_channels],
+				    s[5*n_channels],
+				    s[6*n_channels],
+				    s[7*n_channels]);
+		out = _mm256_cvtepi32_ps(_mm256_cvtepi16_epi32(in));
+		out = _mm256_mul_ps(out, factor);
+		_mm256_store_ps(&d0[n], out);
+		s += 8*n_channels;
+	}
+	for(; n < n_samples; n++) {
+		t = _mm_cvtsi32_ss(f1, s[0]);
+		t = _mm_mul_ss(t, f1);
+		_mm_store_ss(&d0[n], t);
+		s += n_channels;
+	}
+}
+
+void
+conv_s16_to_f32d_avx2(struct convert *conv, void * SPA_RESTRICT dst[], const void * SPA_RESTRICT src[],
+		uint32_t n_samples)
+{
+	const int16_t *s = src[0];
+	uint32_t i = 0, n_channels = conv->n_channels;
+
+	for(; i < n_channels; i++)
+		conv_s16_to_f32d_1s_avx2(conv, &dst[i], &s[i], n_channels, n_samples);
+}
+
+void
+conv_s16_to_f32d_2_avx2(struct convert *conv, void * SPA_RESTRICT dst[], const void * SPA_RESTRICT src[],
+		uint32_t n_samples)
+{
+	const int16_t *s = src[0];
+	float **d = (float **) dst;
+	float *d0 = d[0], *d1 = d[1];
+	uint32_t n, unrolled;
+	__m256i in, t[2];
+	__m256 out[2], factor = _mm256_set1_ps(1.0f / S16_SCALE);
+	__m128 o[2], f1 = _mm_set1_ps(1.0f / S16_SCALE);
+
+	if (SPA_IS_ALIGNED(s, 32) &&
+	    SPA_IS_ALIGNED(d0, 32) &&
+	    SPA_IS_ALIGNED(d1, 32))
+		unrolled = n_samples & ~7;
+	else
+		unrolled = 0;
+
+	for(n = 0; n < unrolled; n += 8) {
+		in = _mm256_load_si256((__m256i*)s);
+
+		/* each 32 bit lane holds one frame, left in the low half */
+		t[0] = _mm256_slli_epi32(in, 16);
+		t[0] = _mm256_srai_epi32(t[0], 16);
+		t[1] = _mm256_srai_epi32(in, 16);
+
+		out[0] = _mm256_cvtepi32_ps(t[0]);
+		out[1] = _mm256_cvtepi32_ps(t[1]);
+		out[0] = _mm256_mul_ps(out[0], factor);
+		out[1] = _mm256_mul_ps(out[1], factor);
+
+		_mm256_store_ps(&d0[n], out[0]);
+		_mm256_store_ps(&d1[n], out[1]);
+
+		s += 16;
+	}
+	for(; n < n_samples; n++) {
+		o[0] = _mm_cvtsi32_ss(f1, s[0]);
+		o[1] = _mm_cvtsi32_ss(f1, s[1]);
+		o[0] = _mm_mul_ss(o[0], f1);
+		o[1] = _mm_mul_ss(o[1], f1);
+		_mm_store_ss(&d0[n], o[0]);
+		_mm_store_ss(&d1[n], o[1]);
+		s += 2;
+	}
+}
+
+/* transpose the 4x4 block of 32 bit values in each 128 bit lane */
+#define TRANSPOSE_4x8(in, out)						\
+({									\
+	__m256i _t0 = _mm256_unpacklo_epi32(in[0], in[1]);		\
+	__m256i _t1 = _mm256_unpackhi_epi32(in[0], in[1]);		\
+	__m256i _t2 = _mm256_unpacklo_epi32(in[2], in[3]);		\
+	__m256i _t3 = _mm256_unpackhi_epi32(in[2], in[3]);		\
+	out[0] = _mm256_unpacklo_epi64(_t0, _t2);			\
+	out[1] = _mm256_unpackhi_epi64(_t0, _t2);			\
+	out[2] = _mm256_unpacklo_epi64(_t1, _t3);			\
+	out[3] = _mm256_unpackhi_epi64(_t1, _t3);			\
+})
+
+static void
+conv_s32_to_f32d_1s_avx2(void *data, void * SPA_RESTRICT dst[], const void * SPA_RESTRICT src,
+		uint32_t n_channels, uint32_t n_samples)
+{
+	const int32_t *s = src;
+	float **d = (float **) dst;
+	float *d0 = d[0];
+	uint32_t n, unrolled;
+	__m256i in;
+	__m256 out, factor = _mm256_set1_ps(1.0f / S24_SCALE);
+	__m128 t, f1 = _mm_set1_ps(1.0f / S24_SCALE);
+
+	if (SPA_IS_ALIGNED(d0, 32))
+		unrolled = n_samples & ~7;
+	else
+		unrolled = 0;
+
+	for(n = 0; n < unrolled; n += 8) {
+		in = _mm256_setr_epi32(s[0*n_channels],
+				       s[1*n_channels],
+				       s[2*n_channels],
+				       s[3*n_channels],
+				       s[4*n_channels],
+				       s[5*n_channels],
+				       s[6*n_channels],
+				       s[7*n_channels]);
+		in = _mm256_srai_epi32(in, 8);
+		out = _mm256_cvtepi32_ps(in);
+		out = _mm256_mul_ps(out, factor);
+		_mm256_store_ps(&d0[n], out);
+		s += 8*n_channels;
+	}
+	for(; n < n_samples; n++) {
+		t = _mm_cvtsi32_ss(f1, s[0] >> 8);
+		t = _mm_mul_ss(t, f1);
+		_mm_store_ss(&d0[n], t);
+		s += n_channels;
+	}
+}
+
+static void
+conv_s32_to_f32d_4s_avx2(void *data, void * SPA_RESTRICT dst[], const void * SPA_RESTRICT src,
+		uint32_t n_channels, uint32_t n_samples)
+{
+	const int32_t *s = src;
+	float **d = (float **) dst;
+	float *d0 = d[0], *d1 = d[1], *d2 = d[2], *d3 = d[3];
+	uint32_t n, unrolled;
+	__m256i in[4], t[4];
+	__m256 out[4], factor = _mm256_set1_ps(1.0f / S24_SCALE);
+	__m128 f1 = _mm_set1_ps(1.0f / S24_SCALE), v;
+
+	if (SPA_IS_ALIGNED(d0, 32) &&
+	    SPA_IS_ALIGNED(d1, 32) &&
+	    SPA_IS_ALIGNED(d2, 32) &&
+	    SPA_IS_ALIGNED(d3, 32))
+		unrolled = n_samples & ~7;
+	else
+		unrolled = 0;
+
+	for(n = 0; n < unrolled; n += 8) {
+		/* frame k in the low half, frame k + 4 in the high half */
+		in[0] = _mm256_loadu2_m128i((__m128i*)(s + 4*n_channels), (__m128i*)(s + 0*n_channels));
+		in[1] = _mm256_loadu2_m128i((__m128i*)(s + 5*n_channels), (__m128i*)(s + 1*n_channels));
+		in[2] = _mm256_loadu2_m128i((__m128i*)(s + 6*n_channels), (__m128i*)(s + 2*n_channels));
+		in[3] = _mm256_loadu2_m128i((__m128i*)(s + 7*n_channels), (__m128i*)(s + 3*n_channels));
+
+		TRANSPOSE_4x8(in, t);
+
+		out[0] = _mm256_cvtepi32_ps(_mm256_srai_epi32(t[0], 8));
+		out[1] = _mm256_cvtepi32_ps(_mm256_srai_epi32(t[1], 8));
+		out[2] = _mm256_cvtepi32_ps(_mm256_srai_epi32(t[2], 8));
+		out[3] = _mm256_cvtepi32_ps(_mm256_srai_epi32(t[3], 8));
+
+		_mm256_store_ps(&d0[n], _mm256_mul_ps(out[0], factor));
+		_mm256_store_ps(&d1[n], _mm256_mul_ps(out[1], factor));
+		_mm256_store_ps(&d2[n], _mm256_mul_ps(out[2], factor));
+		_mm256_store_ps(&d3[n], _mm256_mul_ps(out[3], factor));
+
+		s += 8*n_channels;
+	}
+	for(; n < n_samples; n++) {
+		v = _mm_cvtepi32_ps(_mm_srai_epi32(_mm_loadu_si128((__m128i*)s), 8));
+		v = _mm_mul_ps(v, f1);
+		_mm_store_ss(&d0[n], v);
+		_mm_store_ss(&d1[n], _mm_shuffle_ps(v, v, _MM_SHUFFLE(1, 1, 1, 1)));
+		_mm_store_ss(&d2[n], _mm_shuffle_ps(v, v, _MM_SHUFFLE(2, 2, 2, 2)));
+		_mm_store_ss(&d3[n], _mm_shuffle_ps(v, v, _MM_SHUFFLE(3, 3, 3, 3)));
+		s += n_channels;
+	}
+}
+
+void
+conv_s32_to_f32d_avx2(struct convert *conv, void * SPA_RESTRICT dst[], const void * SPA_RESTRICT src[],
+		uint32_t n_samples)
+{
+	const int32_t *s = src[0];
+	uint32_t i = 0, n_channels = conv->n_channels;
+
+	for(; i + 3 < n_channels; i += 4)
+		conv_s32_to_f32d_4s_avx2(conv, &dst[i], &s[i], n_channels, n_samples);
+	for(; i < n_channels; i++)
+		conv_s32_to_f32d_1s_avx2(conv, &dst[i], &s[i], n_channels, n_samples);
+}
+
+static void
+conv_f32d_to_s32_1s_avx2(void *data, void * SPA_RESTRICT dst, const void * SPA_RESTRICT src[],
+		uint32_t n_channels, uint32_t n_samples)
+{
+	const float **s = (const float **) src;
+	const float *s0 = s[0];
+	int32_t *d = dst;
+	uint32_t n, unrolled;
+	__m256 in;
+	__m256i out;
+	__m128i o[2];
+	__m256 scale = _mm256_set1_ps(S32_SCALE);
+	__m256 int_min = _mm256_set1_ps(S32_MIN);
+	__m128 t;
+
+	if (SPA_IS_ALIGNED(s0, 32))
+		unrolled = n_samples & ~7;
+	else
+		unrolled = 0;
+
+	for(n = 0; n < unrolled; n += 8) {
+		in = _mm256_mul_ps(_mm256_load_ps(&s0[n]), scale);
+		in = _mm256_min_ps(in, int_min);
+		out = _mm256_cvtps_epi32(in);
+		o[0] = _mm256_castsi256_si128(out);
+		o[1] = _mm256_extracti128_si256(out, 1);
+
+		d[0*n_channels] = _mm_cvtsi128_si32(o[0]);
+		d[1*n_channels] = _mm_extract_epi32(o[0], 1);
+		d[2*n_channels] = _mm_extract_epi32(o[0], 2);
+		d[3*n_channels] = _mm_extract_epi32(o[0], 3);
+		d[4*n_channels] = _mm_cvtsi128_si32(o[1]);
+		d[5*n_channels] = _mm_extract_epi32(o[1], 1);
+		d[6*n_channels] = _mm_extract_epi32(o[1], 2);
+		d[7*n_channels] = _mm_extract_epi32(o[1], 3);
+		d += 8*n_channels;
+	}
+	for(; n < n_samples; n++) {
+		t = _mm_load_ss(&s0[n]);
+		t = _mm_mul_ss(t, _mm256_castps256_ps128(scale));
+		t = _mm_min_ss(t, _mm256_castps256_ps128(int_min));
+		*d = _mm_cvtss_si32(t);
+		d += n_channels;
+	}
+}
+
+static void
+conv_f32d_to_s32_2s_avx2(void *data, void * SPA_RESTRICT dst, const void * SPA_RESTRICT src[],
+		uint32_t n_channels, uint32_t n_samples)
+{
+	const float **s = (const float **) src;
+	const float *s0 = s[0], *s1 = s[1];
+	int32_t *d = dst;
+	uint32_t n, unrolled;
+	__m256 in[2];
+	__m256i out[2], t[2];
+	__m128i o[4];
+	__m256 scale = _mm256_set1_ps(S32_SCALE);
+	__m256 int_min = _mm256_set1_ps(S32_MIN);
+	__m128 v[2];
+
+	if (SPA_IS_ALIGNED(s0, 32) &&
+	    SPA_IS_ALIGNED(s1, 32))
+		unrolled = n_samples & ~7;
+	else
+		unrolled = 0;
+
+	for(n = 0; n < unrolled; n += 8) {
+		in[0] = _mm256_mul_ps(_mm256_load_ps(&s0[n]), scale);
+		in[1] = _mm256_mul_ps(_mm256_load_ps(&s1[n]), scale);
+
+		out[0] = _mm256_cvtps_epi32(_mm256_min_ps(in[0], int_min));
+		out[1] = _mm256_cvtps_epi32(_mm256_min_ps(in[1], int_min));
+
+		/* frames 0,1 and 4,5 / frames 2,3 and 6,7 */
+		t[0] = _mm256_unpacklo_epi32(out[0], out[1]);
+		t[1] = _mm256_unpackhi_epi32(out[0], out[1]);
+
+		o[0] = _mm256_castsi256_si128(t[0]);
+		o[1] = _mm256_castsi256_si128(t[1]);
+		o[2] = _mm256_extracti128_si256(t[0], 1);
+		o[3] = _mm256_extracti128_si256(t[1], 1);
+
+		_mm_storel_pd((double*)(d + 0*n_channels), (__m128d)o[0]);
+		_mm_storeh_pd((double*)(d + 1*n_channels), (__m128d)o[0]);
+		_mm_storel_pd((double*)(d + 2*n_channels), (__m128d)o[1]);
+		_mm_storeh_pd((double*)(d + 3*n_channels), (__m128d)o[1]);
+		_mm_storel_pd((double*)(d + 4*n_channels), (__m128d)o[2]);
+		_mm_storeh_pd((double*)(d + 5*n_channels), (__m128d)o[2]);
+		_mm_storel_pd((double*)(d + 6*n_channels), (__m128d)o[3]);
+		_mm_storeh_pd((double*)(d + 7*n_channels), (__m128d)o[3]);
+		d += 8*n_channels;
+	}
+	for(; n < n_samples; n++) {
+		v[0] = _mm_load_ss(&s0[n]);
+		v[1] = _mm_load_ss(&s1[n]);
+
+		v[0] = _mm_unpacklo_ps(v[0], v[1]);
+
+		v[0] = _mm_mul_ps(v[0], _mm256_castps256_ps128(scale));
+		v[0] = _mm_min_ps(v[0], _mm256_castps256_ps128(int_min));
+		_mm_storel_epi64((__m128i*)d, _mm_cvtps_epi32(v[0]));
+		d += n_channels;
+	}
+}
+
+static void
+conv_f32d_to_s32_4s_avx2(void *data, void * SPA_RESTRICT dst, const void * SPA_RESTRICT src[],
+		uint32_t n_channels, uint32_t n_samples)
+{
+	const float **s = (const float **) src;
+	const float *s0 = s[0], *s1 = s[1], *s2 = s[2], *s3 = s[3];
+	int32_t *d = dst;
+	uint32_t n, unrolled;
+	__m256 in[4];
+	__m256i out[4], t[4];
+	__m256 scale = _mm256_set1_ps(S32_SCALE);
+	__m256 int_min = _mm256_set1_ps(S32_MIN);
+	__m128 v[4];
+
+	if (SPA_IS_ALIGNED(s0, 32) &&
+	    SPA_IS_ALIGNED(s1, 32) &&
+	    SPA_IS_ALIGNED(s2, 32) &&
+	    SPA_IS_ALIGNED(s3, 32))
+		unrolled = n_samples & ~7;
+	else
+		unrolled = 0;
+
+	for(n = 0; n < unrolled; n += 8) {
+		in[0] = _mm256_mul_ps(_mm256_load_ps(&s0[n]), scale);
+		in[1] = _mm256_mul_ps(_mm256_load_ps(&s1[n]), scale);
+		in[2] = _mm256_mul_ps(_mm256_load_ps(&s2[n]), scale);
+		in[3] = _mm256_mul_ps(_mm256_load_ps(&s3[n]), scale);
+
+		t[0] = _mm256_cvtps_epi32(_mm256_min_ps(in[0], int_min));
+		t[1] = _mm256_cvtps_epi32(_mm256_min_ps(in[1], int_min));
+		t[2] = _mm256_cvtps_epi32(_mm256_min_ps(in[2], int_min));
+		t[3] = _mm256_cvtps_epi32(_mm256_min_ps(in[3], int_min));
+
+		TRANSPOSE_4x8(t, out);
+
+		_mm_storeu_si128((__m128i*)(d + 0*n_channels), _mm256_castsi256_si128(out[0]));
+		_mm_storeu_si128((__m128i*)(d + 1*n_channels), _mm256_castsi256_si128(out[1]));
+		_mm_storeu_si128((__m128i*)(d + 2*n_channels), _mm256_castsi256_si128(out[2]));
+		_mm_storeu_si128((__m128i*)(d + 3*n_channels), _mm256_castsi256_si128(out[3]));
+		_mm_storeu_si128((__m128i*)(d + 4*n_channels), _mm256_extracti128_si256(out[0], 1));
+		_mm_storeu_si128((__m128i*)(d + 5*n_channels), _mm256_extracti128_si256(out[1], 1));
+		_mm_storeu_si128((__m128i*)(d + 6*n_channels), _mm256_extracti128_si256(out[2], 1));
+		_mm_storeu_si128((__m128i*)(d + 7*n_channels), _mm256_extracti128_si256(out[3], 1));
+		d += 8*n_channels;
+	}
+	for(; n < n_samples; n++) {
+		v[0] = _mm_load_ss(&s0[n]);
+		v[1] = _mm_load_ss(&s1[n]);
+		v[2] = _mm_load_ss(&s2[n]);
+		v[3] = _mm_load_ss(&s3[n]);
+
+		v[0] = _mm_unpacklo_ps(v[0], v[2]);
+		v[1] = _mm_unpacklo_ps(v[1], v[3]);
+		v[0] = _mm_unpacklo_ps(v[0], v[1]);
+
+		v[0] = _mm_mul_ps(v[0], _mm256_castps256_ps128(scale));
+		v[0] = _mm_min_ps(v[0], _mm256_castps256_ps128(int_min));
+		_mm_storeu_si128((__m128i*)d, _mm_cvtps_epi32(v[0]));
+		d += n_channels;
+	}
+}
+
+void
+conv_f32d_to_s32_avx2(struct convert *conv, void * SPA_RESTRICT dst[], const void * SPA_RESTRICT src[],
+		uint32_t n_samples)
+{
+	int32_t *d = dst[0];
+	uint32_t i = 0, n_channels = conv->n_channels;
+
+	for(; i + 3 < n_channels; i += 4)
+		conv_f32d_to_s32_4s_avx2(conv, &d[i], &src[i], n_channels, n_samples);
+	for(; i + 1 < n_channels; i += 2)
+		conv_f32d_to_s32_2s_avx2(conv, &d[i], &src[i], n_channels, n_samples);
+	for(; i < n_channels; i++)
+		conv_f32d_to_s32_1s_avx2(conv, &d[i], &src[i], n_channels, n_samples);
+}
+
+static void
+conv_f32d_to_s16_1s_avx2(void *data, void * SPA_RESTRICT dst, const void * SPA_RESTRICT src[],
+		uint32_t n_channels, uint32_t n_samples)
+{
+	const float **s = (const float **) src;
+	const float *s0 = s[0];
+	int16_t *d = dst;
+	uint32_t n, unrolled;
+	__m256 in;
+	__m256i t;
+	__m128i out;
+	__m256 int_max = _mm256_set1_ps(S16_MAX_F);
+	__m256 int_min = _mm256_set1_ps(-S16_MAX_F);
+	__m128 v;
+
+	if (SPA_IS_ALIGNED(s0, 32))
+		unrolled = n_samples & ~7;
+	else
+		unrolled = 0;
+
+	for(n = 0; n < unrolled; n += 8) {
+		in = _mm256_mul_ps(_mm256_load_ps(&s0[n]), int_max);
+		t = _mm256_cvtps_epi32(in);
+		/* packs saturates */
+		out = _mm_packs_epi32(_mm256_castsi256_si128(t),
+				_mm256_extracti128_si256(t, 1));
+
+		d[0*n_channels] = _mm_extract_epi16(out, 0);
+		d[1*n_channels] = _mm_extract_epi16(out, 1);
+		d[2*n_channels] = _mm_extract_epi16(out, 2);
+		d[3*n_channels] = _mm_extract_epi16(out, 3);
+		d[4*n_channels] = _mm_extract_epi16(out, 4);
+		d[5*n_channels] = _mm_extract_epi16(out, 5);
+		d[6*n_channels] = _mm_extract_epi16(out, 6);
+		d[7*n_channels] = _mm_extract_epi16(out, 7);
+		d += 8*n_channels;
+	}
+	for(; n < n_samples; n++) {
+		v = _mm_mul_ss(_mm_load_ss(&s0[n]), _mm256_castps256_ps128(int_max));
+		v = _mm_min_ss(_mm256_castps256_ps128(int_max),
+				_mm_max_ss(v, _mm256_castps256_ps128(int_min)));
+		*d = _mm_cvtss_si32(v);
+		d += n_channels;
+	}
+}
+
+static void
+conv_f32d_to_s16_2s_avx2(void *data, void * SPA_RESTRICT dst, const void * SPA_RESTRICT src[],
+		uint32_t n_channels, uint32_t n_samples)
+{
+	const float **s = (const float **) src;
+	const float *s0 = s[0], *s1 = s[1];
+	int16_t *d = dst;
+	uint32_t n, unrolled;
+	__m256 in[2];
+	__m256i t[2];
+	__m128i out[2];
+	__m256 int_max = _mm256_set1_ps(S16_MAX_F);
+	__m256 int_min = _mm256_set1_ps(-S16_MAX_F);
+	__m128 v[2];
+
+	if (SPA_IS_ALIGNED(s0, 32) &&
+	    SPA_IS_ALIGNED(s1, 32))
+		unrolled = n_samples & ~7;
+	else
+		unrolled = 0;
+
+	for(n = 0; n < unrolled; n += 8) {
+		in[0] = _mm256_mul_ps(_mm256_load_ps(&s0[n]), int_max);
+		in[1] = _mm256_mul_ps(_mm256_load_ps(&s1[n]), int_max);
+
+		t[0] = _mm256_cvtps_epi32(in[0]);
+		t[1] = _mm256_cvtps_epi32(in[1]);
+
+		/* one frame per 32 bits, frames 0-3 in the low half and
+		 * 4-7 in the high half */
+		t[0] = _mm256_packs_epi32(t[0], t[0]);
+		t[1] = _mm256_packs_epi32(t[1], t[1]);
+		t[0] = _mm256_unpacklo_epi16(t[0], t[1]);
+
+		out[0] = _mm256_castsi256_si128(t[0]);
+		out[1] = _mm256_extracti128_si256(t[0], 1);
+
+		*((int32_t*)(d + 0*n_channels)) = _mm_cvtsi128_si32(out[0]);
+		*((int32_t*)(d + 1*n_channels)) = _mm_extract_epi32(out[0], 1);
+		*((int32_t*)(d + 2*n_channels)) = _mm_extract_epi32(out[0], 2);
+		*((int32_t*)(d + 3*n_channels)) = _mm_extract_epi32(out[0], 3);
+		*((int32_t*)(d + 4*n_channels)) = _mm_cvtsi128_si32(out[1]);
+		*((int32_t*)(d + 5*n_channels)) = _mm_extract_epi32(out[1], 1);
+		*((int32_t*)(d + 6*n_channels)) = _mm_extract_epi32(out[1], 2);
+		*((int32_t*)(d + 7*n_channels)) = _mm_extract_epi32(out[1], 3);
+		d += 8*n_channels;
+	}
+	for(; n < n_samples; n++) {
+		v[0] = _mm_mul_ss(_mm_load_ss(&s0[n]), _mm256_castps256_ps128(int_max));
+		v[1] = _mm_mul_ss(_mm_load_ss(&s1[n]), _mm256_castps256_ps128(int_max));
+		v[0] = _mm_min_ss(_mm256_castps256_ps128(int_max),
+				_mm_max_ss(v[0], _mm256_castps256_ps128(int_min)));
+		v[1] = _mm_min_ss(_mm256_castps256_ps128(int_max),
+				_mm_max_ss(v[1], _mm256_castps256_ps128(int_min)));
+		d[0] = _mm_cvtss_si32(v[0]);
+		d[1] = _mm_cvtss_si32(v[1]);
+		d += n_channels;
+	}
+}
+
+static void
+conv_f32d_to_s16_4s_avx2(void *data, void * SPA_RESTRICT dst, const void * SPA_RESTRICT src[],
+		uint32_t n_channels, uint32_t n_samples)
+{
+	const float **s = (const float **) src;
+	const float *s0 = s[0], *s1 = s[1], *s2 = s[2], *s3 = s[3];
+	int16_t *d = dst;
+	uint32_t n, unrolled;
+	__m256 in[4];
+	__m256i t[4];
+	__m128i out[4];
+	__m256 int_max = _mm256_set1_ps(S16_MAX_F);
+	__m256 int_min = _mm256_set1_ps(-S16_MAX_F);
+	__m128 v[4];
+
+	if (SPA_IS_ALIGNED(s0, 32) &&
+	    SPA_IS_ALIGNED(s1, 32) &&
+	    SPA_IS_ALIGNED(s2, 32) &&
+	    SPA_IS_ALIGNED(s3, 32))
+		unrolled = n_samples & ~7;
+	else
+		unrolled = 0;
+
+	for(n = 0; n < unrolled; n += 8) {
+		in[0] = _mm256_mul_ps(_mm256_load_ps(&s0[n]), int_max);
+		in[1] = _mm256_mul_ps(_mm256_load_ps(&s1[n]), int_max);
+		in[2] = _mm256_mul_ps(_mm256_load_ps(&s2[n]), int_max);
+		in[3] = _mm256_mul_ps(_mm256_load_ps(&s3[n]), int_max);
+
+		t[0] = _mm256_cvtps_epi32(in[0]);
+		t[1] = _mm256_cvtps_epi32(in[1]);
+		t[2] = _mm256_cvtps_epi32(in[2]);
+		t[3] = _mm256_cvtps_epi32(in[3]);
+
+		/* same as the sse2 version, once for each 128 bit lane */
+		t[0] = _mm256_packs_epi32(t[0], t[2]);
+		t[1] = _mm256_packs_epi32(t[1], t[3]);
+
+		t[2] = _mm256_unpacklo_epi16(t[0], t[1]);
+		t[3] = _mm256_unpackhi_epi16(t[0], t[1]);
+		t[0] = _mm256_unpacklo_epi32(t[2], t[3]);
+		t[1] = _mm256_unpackhi_epi32(t[2], t[3]);
+
+		out[0] = _mm256_castsi256_si128(t[0]);
+		out[1] = _mm256_castsi256_si128(t[1]);
+		out[2] = _mm256_extracti128_si256(t[0], 1);
+		out[3] = _mm256_extracti128_si256(t[1], 1);
+
+		_mm_storel_pi((__m64*)(d + 0*n_channels), (__m128)out[0]);
+		_mm_storeh_pi((__m64*)(d + 1*n_channels), (__m128)out[0]);
+		_mm_storel_pi((__m64*)(d + 2*n_channels), (__m128)out[1]);
+		_mm_storeh_pi((__m64*)(d + 3*n_channels), (__m128)out[1]);
+		_mm_storel_pi((__m64*)(d + 4*n_channels), (__m128)out[2]);
+		_mm_storeh_pi((__m64*)(d + 5*n_channels), (__m128)out[2]);
+		_mm_storel_pi((__m64*)(d + 6*n_channels), (__m128)out[3]);
+		_mm_storeh_pi((__m64*)(d + 7*n_channels), (__m128)out[3]);
+
+		d += 8*n_channels;
+	}
+	for(; n < n_samples; n++) {
+		v[0] = _mm_load_ss(&s0[n]);
+		v[1] = _mm_load_ss(&s1[n]);
+		v[2] = _mm_load_ss(&s2[n]);
+		v[3] = _mm_load_ss(&s3[n]);
+
+		v[0] = _mm_unpacklo_ps(v[0], v[2]);
+		v[1] = _mm_unpacklo_ps(v[1], v[3]);
+		v[0] = _mm_unpacklo_ps(v[0], v[1]);
+
+		v[0] = _mm_mul_ps(v[0], _mm256_castps256_ps128(int_max));
+		v[0] = _mm_min_ps(_mm256_castps256_ps128(int_max),
+				_mm_max_ps(v[0], _mm256_castps256_ps128(int_min)));
+		out[0] = _mm_cvtps_epi32(v[0]);
+		out[0] = _mm_packs_epi32(out[0], out[0]);
+		_mm_storel_epi64((__m128i*)d, out[0]);
+		d += n_channels;
+	}
+}
+
+void
+conv_f32d_to_s16_avx2(struct convert *conv, void * SPA_RESTRICT dst[], const void * SPA_RESTRICT src[],
+		uint32_t n_samples)
+{
+	int16_t *d = dst[0];
+	uint32_t i = 0, n_channels = conv->n_channels;
+
+	for(; i + 3 < n_channels; i += 4)
+		conv_f32d_to_s16_4s_avx2(conv, &d[i], &src[i], n_channels, n_samples);
+	for(; i + 1 < n_channels; i += 2)
+		conv_f32d_to_s16_2s_avx2(conv, &d[i], &src[i], n_channels, n_samples);
+	for(; i < n_channels; i++)
+		conv_f32d_to_s16_1s_avx2(conv, &d[i], &src[i], n_channels, n_samples);
+}
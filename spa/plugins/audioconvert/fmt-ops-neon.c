@@ -0,0 +1,245 @@
+/* Spa
+ *
+ * Copyright © 2020 Wim Taymans
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the next
+ * paragraph) shall be included in all copies or substantial portions of the
+ * Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+
+#include "fmt-ops.h"
+
+#include <arm_neon.h>
+
+void
+conv_s16_to_f32d_2_neon(struct convert *conv, void * SPA_RESTRICT dst[], const void * SPA_RESTRICT src[],
+		uint32_t n_samples)
+{
+	const int16_t *s = src[0];
+	float **d = (float **) dst;
+	float *d0 = d[0], *d1 = d[1];
+	uint32_t n, unrolled = n_samples & ~7;
+	int16x8x2_t in;
+	float32x4_t out[4], factor = vdupq_n_f32(1.0f / S16_SCALE);
+
+	for(n = 0; n < unrolled; n += 8) {
+		in = vld2q_s16(s);
+
+		out[0] = vcvtq_f32_s32(vmovl_s16(vget_low_s16(in.val[0])));
+		out[1] = vcvtq_f32_s32(vmovl_s16(vget_high_s16(in.val[0])));
+		out[2] = vcvtq_f32_s32(vmovl_s16(vget_low_s16(in.val[1])));
+		out[3] = vcvtq_f32_s32(vmovl_s16(vget_high_s16(in.val[1])));
+
+		vst1q_f32(&d0[n + 0], vmulq_f32(out[0], factor));
+		vst1q_f32(&d0[n + 4], vmulq_f32(out[1], factor));
+		vst1q_f32(&d1[n + 0], vmulq_f32(out[2], factor));
+		vst1q_f32(&d1[n + 4], vmulq_f32(out[3], factor));
+
+		s += 16;
+	}
+	for(; n < n_samples; n++) {
+		d0[n] = S16_TO_F32(s[0]);
+		d1[n] = S16_TO_F32(s[1]);
+		s += 2;
+	}
+}
+
+static void
+conv_s16_to_f32d_1s_neon(void *data, void * SPA_RESTRICT dst[], const void * SPA_RESTRICT src,
+		uint32_t n_channels, uint32_t n_samples)
+{
+	const int16_t *s = src;
+	float **d = (float **) dst;
+	float *d0 = d[0];
+	uint32_t n, unrolled = n_samples & ~3;
+	int16x4_t in = vdup_n_s16(0);
+	float32x4_t out, factor = vdupq_n_f32(1.0f / S16_SCALE);
+
+	for(n = 0; n < unrolled; n += 4) {
+		in = vld1_lane_s16(&s[0*n_channels], in, 0);
+		in = vld1_lane_s16(&s[1*n_channels], in, 1);
+		in = vld1_lane_s16(&s[2*n_channels], in, 2);
+		in = vld1_lane_s16(&s[3*n_channels], in, 3);
+		out = vcvtq_f32_s32(vmovl_s16(in));
+		vst1q_f32(&d0[n], vmulq_f32(out, factor));
+		s += 4*n_channels;
+	}
+	for(; n < n_samples; n++) {
+		d0[n] = S16_TO_F32(s[0]);
+		s += n_channels;
+	}
+}
+
+void
+conv_s16_to_f32d_neon(struct convert *conv, void * SPA_RESTRICT dst[], const void * SPA_RESTRICT src[],
+		uint32_t n_samples)
+{
+	const int16_t *s = src[0];
+	uint32_t i = 0, n_channels = conv->n_channels;
+
+	for(; i < n_channels; i++)
+		conv_s16_to_f32d_1s_neon(conv, &dst[i], &s[i], n_channels, n_samples);
+}
+
+static void
+conv_s32_to_f32d_1s_neon(void *data, void * SPA_RESTRICT dst[], const void * SPA_RESTRICT src,
+		uint32_t n_channels, uint32_t n_samples)
+{
+	const int32_t *s = src;
+	float **d = (float **) dst;
+	float *d0 = d[0];
+	uint32_t n, unrolled = n_samples & ~3;
+	int32x4_t in = vdupq_n_s32(0);
+	float32x4_t out, factor = vdupq_n_f32(1.0f / S24_SCALE);
+
+	for(n = 0; n < unrolled; n += 4) {
+		in = vld1q_lane_s32(&s[0*n_channels], in, 0);
+		in = vld1q_lane_s32(&s[1*n_channels], in, 1);
+		in = vld1q_lane_s32(&s[2*n_channels], in, 2);
+		in = vld1q_lane_s32(&s[3*n_channels], in, 3);
+		out = vcvtq_f32_s32(vshrq_n_s32(in, 8));
+		vst1q_f32(&d0[n], vmulq_f32(out, factor));
+		s += 4*n_channels;
+	}
+	for(; n < n_samples; n++) {
+		d0[n] = S32_TO_F32(s[0]);
+		s += n_channels;
+	}
+}
+
+void
+conv_s32_to_f32d_neon(struct convert *conv, void * SPA_RESTRICT dst[], const void * SPA_RESTRICT src[],
+		uint32_t n_samples)
+{
+	const int32_t *s = src[0];
+	uint32_t i = 0, n_channels = conv->n_channels;
+
+	for(; i < n_channels; i++)
+		conv_s32_to_f32d_1s_neon(conv, &dst[i], &s[i], n_channels, n_samples);
+}
+
+void
+conv_f32d_to_s16_2_neon(struct convert *conv, void * SPA_RESTRICT dst[], const void * SPA_RESTRICT src[],
+		uint32_t n_samples)
+{
+	const float **s = (const float **) src;
+	const float *s0 = s[0], *s1 = s[1];
+	int16_t *d = dst[0];
+	uint32_t n, unrolled = n_samples & ~3;
+	float32x4_t in[2];
+	int16x4x2_t out;
+	float32x4_t int_max = vdupq_n_f32(S16_MAX_F);
+	float32x4_t one = vdupq_n_f32(1.0f), min_one = vdupq_n_f32(-1.0f);
+
+	for(n = 0; n < unrolled; n += 4) {
+		in[0] = vminq_f32(vmaxq_f32(vld1q_f32(&s0[n]), min_one), one);
+		in[1] = vminq_f32(vmaxq_f32(vld1q_f32(&s1[n]), min_one), one);
+
+		out.val[0] = vmovn_s32(vcvtq_s32_f32(vmulq_f32(in[0], int_max)));
+		out.val[1] = vmovn_s32(vcvtq_s32_f32(vmulq_f32(in[1], int_max)));
+
+		vst2_s16(d, out);
+		d += 8;
+	}
+	for(; n < n_samples; n++) {
+		d[0] = F32_TO_S16(s0[n]);
+		d[1] = F32_TO_S16(s1[n]);
+		d += 2;
+	}
+}
+
+static void
+conv_f32d_to_s16_1s_neon(void *data, void * SPA_RESTRICT dst, const void * SPA_RESTRICT src[],
+		uint32_t n_channels, uint32_t n_samples)
+{
+	const float **s = (const float **) src;
+	const float *s0 = s[0];
+	int16_t *d = dst;
+	uint32_t n, unrolled = n_samples & ~3;
+	float32x4_t in;
+	int16x4_t out;
+	float32x4_t int_max = vdupq_n_f32(S16_MAX_F);
+	float32x4_t one = vdupq_n_f32(1.0f), min_one = vdupq_n_f32(-1.0f);
+
+	for(n = 0; n < unrolled; n += 4) {
+		in = vminq_f32(vmaxq_f32(vld1q_f32(&s0[n]), min_one), one);
+		out = vmovn_s32(vcvtq_s32_f32(vmulq_f32(in, int_max)));
+
+		vst1_lane_s16(&d[0*n_channels], out, 0);
+		vst1_lane_s16(&d[1*n_channels], out, 1);
+		vst1_lane_s16(&d[2*n_channels], out, 2);
+		vst1_lane_s16(&d[3*n_channels], out, 3);
+		d += 4*n_channels;
+	}
+	for(; n < n_samples; n++) {
+		*d = F32_TO_S16(s0[n]);
+		d += n_channels;
+	}
+}
+
+void
+conv_f32d_to_s16_neon(struct convert *conv, void * SPA_RESTRICT dst[], const void * SPA_RESTRICT src[],
+		uint32_t n_samples)
+{
+	int16_t *d = dst[0];
+	uint32_t i = 0, n_channels = conv->n_channels;
+
+	for(; i < n_channels; i++)
+		conv_f32d_to_s16_1s_neon(conv, &d[i], &src[i], n_channels, n_samples);
+}
+
+static void
+conv_f32d_to_s32_1s_neon(void *data, void * SPA_RESTRICT dst, const void * SPA_RESTRICT src[],
+		uint32_t n_channels, uint32_t n_samples)
+{
+	const float **s = (const float **) src;
+	const float *s0 = s[0];
+	int32_t *d = dst;
+	uint32_t n, unrolled = n_samples & ~3;
+	float32x4_t in;
+	int32x4_t out;
+	float32x4_t int_max = vdupq_n_f32(S24_MAX_F);
+	float32x4_t one = vdupq_n_f32(1.0f), min_one = vdupq_n_f32(-1.0f);
+
+	for(n = 0; n < unrolled; n += 4) {
+		in = vminq_f32(vmaxq_f32(vld1q_f32(&s0[n]), min_one), one);
+		out = vshlq_n_s32(vcvtq_s32_f32(vmulq_f32(in, int_max)), 8);
+
+		vst1q_lane_s32(&d[0*n_channels], out, 0);
+		vst1q_lane_s32(&d[1*n_channels], out, 1);
+		vst1q_lane_s32(&d[2*n_channels], out, 2);
+		vst1q_lane_s32(&d[3*n_channels], out, 3);
+		d += 4*n_channels;
+	}
+	for(; n < n_samples; n++) {
+		*d = F32_TO_S32(s0[n]);
+		d += n_channels;
+	}
+}
+
+void
+conv_f32d_to_s32_neon(struct convert *conv, void * SPA_RESTRICT dst[], const void * SPA_RESTRICT src[],
+		uint32_t n_samples)
+{
+	int32_t *d = dst[0];
+	uint32_t i = 0, n_channels = conv->n_channels;
+
+	for(; i < n_channels; i++)
+		conv_f32d_to_s32_1s_neon(conv, &d[i], &src[i], n_channels, n_samples);
+}
@@ -100,6 +100,14 @@ int convert_init(struct convert *conv);
 #define convert_process(conv,...)	(conv)->process(conv, __VA_ARGS__)
 #define convert_free(conv)		(conv)->free(conv)
 
+/* convert_process with the signature of a fused pipeline stage */
+static inline void convert_process_stage(void *data, uint32_t n_dst, void * SPA_RESTRICT dst[],
+		uint32_t n_src, const void * SPA_RESTRICT src[], uint32_t n_samples)
+{
+	struct convert *conv = data;
+	convert_process(conv, dst, src, n_samples);
+}
+
 #define DEFINE_FUNCTION(name,arch) \
 void conv_##name##_##arch(struct convert *conv, void * SPA_RESTRICT dst[],	\
 		const void * SPA_RESTRICT src[], uint32_t n_samples)		\
@@ -174,5 +182,19 @@ DEFINE_FUNCTION(s24_to_f32d, ssse3);
 #endif
 #if defined(HAVE_SSE41)
 DEFINE_FUNCTION(s24_to_f32d, sse41);
-
+#endif
+#if defined(HAVE_AVX2)
+DEFINE_FUNCTION(s16_to_f32d_2, avx2);
+DEFINE_FUNCTION(s16_to_f32d, avx2);
+DEFINE_FUNCTION(s32_to_f32d, avx2);
+DEFINE_FUNCTION(f32d_to_s32, avx2);
+DEFINE_FUNCTION(f32d_to_s16, avx2);
+#endif
+#if defined(HAVE_NEON)
+DEFINE_FUNCTION(s16_to_f32d_2, neon);
+DEFINE_FUNCTION(s16_to_f32d, neon);
+DEFINE_FUNCTION(s32_to_f32d, neon);
+DEFINE_FUNCTION(f32d_to_s16_2, neon);
+DEFINE_FUNCTION(f32d_to_s16, neon);
+DEFINE_FUNCTION(f32d_to_s32, neon);
 #endif
@@ -42,6 +42,7 @@
 #include <spa/debug/format.h>
 
 #include "fmt-ops.h"
+#include "fused.h"
 
 #define NAME "fmtconvert"
 
@@ -124,6 +125,7 @@ struct impl {
 
 	uint32_t cpu_flags;
 	struct convert conv;
+	struct fused *fused;
 	unsigned int started:1;
 	unsigned int is_passthrough:1;
 };
@@ -877,15 +879,26 @@ static int impl_node_process(void *object)
 			this->is_passthrough);
 
 	for (i = 0; i < n_dst_datas; i++) {
-		dst_datas[i] = this->is_passthrough ?
-			(void*)src_datas[i] :
-			outbuf->datas[this->remap[i]];
-		outb->datas[this->remap[i]].data = dst_datas[i];
+		struct spa_data *dd = &outb->datas[this->remap[i]];
+
+		if (this->is_passthrough)
+			dst_datas[i] = (void*)src_datas[i];
+		else if (SPA_FLAG_IS_SET(dd->flags, SPA_DATA_FLAG_DYNAMIC | SPA_DATA_FLAG_TARGET) &&
+		    dd->data != NULL)
+			/* the consumer pointed us at where it wants the samples */
+			dst_datas[i] = dd->data;
+		else
+			dst_datas[i] = outbuf->datas[this->remap[i]];
+		dd->data = dst_datas[i];
 		outb->datas[i].chunk->offset = 0;
 		outb->datas[i].chunk->size = n_samples * outport->stride;
 	}
 
-	if (!this->is_passthrough)
+	if (!this->is_passthrough &&
+	    (this->fused == NULL ||
+	     fused_add(this->fused, convert_process_stage, &this->conv,
+		     n_dst_datas, dst_datas, outport->stride,
+		     n_src_datas, src_datas, inport->stride, n_samples) < 0))
 		convert_process(&this->conv, dst_datas, src_datas, n_samples);
 
 	inio->status = SPA_STATUS_NEED_DATA;
@@ -927,6 +940,8 @@ static int impl_get_interface(struct spa_handle *handle, const char *type, void
 
 	if (strcmp(type, SPA_TYPE_INTERFACE_Node) == 0)
 		*interface = &this->node;
+	else if (strcmp(type, FUSED_INTERFACE) == 0)
+		*interface = &this->fused;
 	else
 		return -ENOENT;
 
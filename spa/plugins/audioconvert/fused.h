@@ -0,0 +1,287 @@
+/* Spa
+ *
+ * Copyright © 2020 Wim Taymans
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the next
+ * paragraph) shall be included in all copies or substantial portions of the
+ * Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+#ifndef FUSED_H
+#define FUSED_H
+
+#include <errno.h>
+#include <stdbool.h>
+#include <string.h>
+
+#include <spa/utils/defs.h>
+#include <spa/utils/type.h>
+#include <spa/param/audio/raw.h>
+
+/* Fused execution of the audioconvert pipeline.
+ *
+ * The sub-nodes of audioconvert do their buffer handshake in process as
+ * usual but, when they have a pipeline, they add their kernel to it as a
+ * stage instead of running it over the whole quantum. audioconvert runs the
+ * stages over small tiles so that the samples between two stages stay in the
+ * scratch memory of the pipeline, which fits in the cache, and never go
+ * through the buffers of the links. Identity stages don't add a stage.
+ *
+ * The resampler needs its input before it knows how much of it it will
+ * consume, it pulls its input tile by tile from the pending stages with
+ * fused_pull().
+ */
+
+#define FUSED_INTERFACE		SPA_TYPE_INFO_INTERFACE_BASE "AudioConvert:Fused"
+
+#define FUSED_MAX_STAGES	4
+#define FUSED_MAX_PLANES	SPA_AUDIO_MAX_CHANNELS
+#define FUSED_SCRATCH_SIZE	(8 * 1024)
+#define FUSED_ALIGN		64
+#define FUSED_TILE_ALIGN	16
+
+struct fused_stage {
+	void (*process) (void *data, uint32_t n_dst, void * SPA_RESTRICT dst[],
+			uint32_t n_src, const void * SPA_RESTRICT src[], uint32_t n_samples);
+	void *data;
+	uint32_t n_samples;
+	uint32_t n_src;
+	uint32_t src_stride;		/**< bytes between samples in a src plane */
+	uint32_t n_dst;
+	uint32_t dst_stride;		/**< bytes between samples in a dst plane */
+	const void *src[FUSED_MAX_PLANES];
+	void *dst[FUSED_MAX_PLANES];
+
+	unsigned int from_scratch:1;	/**< src is the scratch output of the previous stage */
+	uint32_t map[FUSED_MAX_PLANES];	/**< scratch plane of each src plane */
+};
+
+struct fused {
+	uint32_t n_stages;
+	struct fused_stage stages[FUSED_MAX_STAGES];
+	void *scratch[2];		/**< FUSED_SCRATCH_SIZE each, FUSED_ALIGN aligned */
+
+	uint32_t tile;
+	unsigned int prepared:1;
+};
+
+static inline void fused_init(struct fused *f, void *scratch0, void *scratch1)
+{
+	spa_zero(*f);
+	f->scratch[0] = scratch0;
+	f->scratch[1] = scratch1;
+}
+
+static inline void fused_clear(struct fused *f)
+{
+	f->n_stages = 0;
+	f->prepared = false;
+}
+
+static inline int fused_add(struct fused *f,
+		void (*process) (void *data, uint32_t n_dst, void * SPA_RESTRICT dst[],
+			uint32_t n_src, const void * SPA_RESTRICT src[], uint32_t n_samples),
+		void *data, uint32_t n_dst, void *dst[], uint32_t dst_stride,
+		uint32_t n_src, const void *src[], uint32_t src_stride, uint32_t n_samples)
+{
+	struct fused_stage *s;
+
+	if (f->n_stages >= FUSED_MAX_STAGES ||
+	    n_dst > FUSED_MAX_PLANES || n_src > FUSED_MAX_PLANES)
+		return -ENOSPC;
+
+	s = &f->stages[f->n_stages++];
+	s->process = process;
+	s->data = data;
+	s->n_samples = n_samples;
+	s->n_dst = n_dst;
+	s->dst_stride = dst_stride;
+	memcpy(s->dst, dst, n_dst * sizeof(void*));
+	s->n_src = n_src;
+	s->src_stride = src_stride;
+	memcpy(s->src, src, n_src * sizeof(void*));
+	s->from_scratch = false;
+	f->prepared = false;
+	return 0;
+}
+
+/* find the dst plane for each src plane, every dst plane must be read
+ * exactly once so that none of the output is lost in the scratch memory */
+static inline bool fused_map(void * const dst[], uint32_t n_dst,
+		const void * const src[], uint32_t n_src, uint32_t map[])
+{
+	bool used[FUSED_MAX_PLANES] = { false, };
+	uint32_t i, j;
+
+	if (n_dst != n_src)
+		return false;
+	for (i = 0; i < n_src; i++) {
+		for (j = 0; j < n_dst; j++)
+			if (!used[j] && dst[j] == src[i])
+				break;
+		if (j == n_dst)
+			return false;
+		used[j] = true;
+		map[i] = j;
+	}
+	return true;
+}
+
+static inline void fused_prepare(struct fused *f)
+{
+	uint32_t i, max = 1;
+
+	if (f->prepared)
+		return;
+
+	for (i = 0; i < f->n_stages; i++) {
+		struct fused_stage *s = &f->stages[i];
+		max = SPA_MAX(max, s->n_dst * s->dst_stride);
+	}
+	f->tile = SPA_ROUND_DOWN_N(FUSED_SCRATCH_SIZE / max, FUSED_TILE_ALIGN);
+
+	for (i = 1; i < f->n_stages; i++) {
+		struct fused_stage *p = &f->stages[i-1];
+		struct fused_stage *s = &f->stages[i];
+
+		s->from_scratch = f->tile > 0 &&
+			p->n_samples == s->n_samples &&
+			p->dst_stride == s->src_stride &&
+			fused_map(p->dst, p->n_dst, s->src, s->n_src, s->map);
+	}
+	f->prepared = true;
+}
+
+/* run stages first to last-1 on the samples [offset, offset + n_samples), n_samples
+ * is at most one tile. The output of the last stage goes to scratch when out is not
+ * NULL and map gives the plane of each out pointer. */
+static inline void fused_run_tile(struct fused *f, uint32_t first, uint32_t last,
+		uint32_t offset, uint32_t n_samples, const void *out[], uint32_t n_out,
+		const uint32_t *map)
+{
+	const void *src[FUSED_MAX_PLANES];
+	void *dst[FUSED_MAX_PLANES];
+	uint32_t i, j;
+
+	for (i = first; i < last; i++) {
+		struct fused_stage *s = &f->stages[i];
+		bool to_scratch = i + 1 < last || out != NULL;
+		void *scratch = f->scratch[(i - first) & 1];
+
+		if (i == first) {
+			for (j = 0; j < s->n_src; j++)
+				src[j] = SPA_MEMBER(s->src[j], offset * s->src_stride, void);
+		} else {
+			void *prev = f->scratch[(i - 1 - first) & 1];
+			for (j = 0; j < s->n_src; j++)
+				src[j] = SPA_MEMBER(prev, s->map[j] * f->tile * s->src_stride, void);
+		}
+		for (j = 0; j < s->n_dst; j++) {
+			if (to_scratch)
+				dst[j] = SPA_MEMBER(scratch, j * f->tile * s->dst_stride, void);
+			else
+				dst[j] = SPA_MEMBER(s->dst[j], offset * s->dst_stride, void);
+		}
+		s->process(s->data, s->n_dst, dst, s->n_src, src, n_samples);
+	}
+	if (out != NULL) {
+		for (j = 0; j < n_out; j++)
+			out[j] = dst[map[j]];
+	}
+}
+
+/* run the groups of stages, that read each other from scratch, between first
+ * and last-1 on the samples [offset, offset + n_samples), tile by tile */
+static inline void fused_run_groups(struct fused *f, uint32_t first, uint32_t last,
+		uint32_t offset, uint32_t n_samples)
+{
+	uint32_t end, i, n, g;
+
+	for (; first < last; first = g) {
+		for (g = first + 1; g < last; g++)
+			if (!f->stages[g].from_scratch)
+				break;
+
+		end = f->stages[first].n_samples;
+		if (offset >= end)
+			continue;
+		end = offset + SPA_MIN(n_samples, end - offset);
+		for (i = offset; i < end; i += n) {
+			n = SPA_MIN(end - i, f->tile ? f->tile : end - i);
+			fused_run_tile(f, first, g, i, n, NULL, 0, NULL);
+		}
+	}
+}
+
+/* run all pending stages and clear the pipeline */
+static inline void fused_run(struct fused *f)
+{
+	if (f->n_stages == 0)
+		return;
+	fused_prepare(f);
+	fused_run_groups(f, 0, f->n_stages, 0, UINT32_MAX);
+	fused_clear(f);
+}
+
+/* the number of samples fused_pull() can produce in scratch at once */
+static inline uint32_t fused_tile(struct fused *f)
+{
+	fused_prepare(f);
+	return f->tile ? f->tile : UINT32_MAX;
+}
+
+/* check if the last pending stage produces the buffer planes src */
+static inline bool fused_produces(struct fused *f, const void *src[], uint32_t n_src,
+		uint32_t stride, uint32_t map[])
+{
+	struct fused_stage *s;
+
+	if (f->n_stages == 0 || n_src > FUSED_MAX_PLANES)
+		return false;
+	s = &f->stages[f->n_stages - 1];
+	return s->dst_stride == stride &&
+		fused_map(s->dst, s->n_dst, src, n_src, map);
+}
+
+/* Get the samples [offset, offset + n_samples) of the buffer planes src,
+ * which the pending stages produce, see fused_produces(). n_samples is at most
+ * one tile. out is filled with pointers to the samples in the scratch memory. */
+static inline void fused_pull(struct fused *f, const void *src[], uint32_t n_src,
+		uint32_t stride, uint32_t offset, uint32_t n_samples, const void *out[])
+{
+	uint32_t map[FUSED_MAX_PLANES];
+	uint32_t i, first;
+
+	fused_prepare(f);
+
+	if (f->tile > 0 && offset + n_samples <= f->stages[f->n_stages - 1].n_samples &&
+	    fused_produces(f, src, n_src, stride, map)) {
+		for (first = f->n_stages - 1; first > 0; first--)
+			if (!f->stages[first].from_scratch)
+				break;
+		/* the groups before the last one write to the links */
+		fused_run_groups(f, 0, first, offset, n_samples);
+		fused_run_tile(f, first, f->n_stages, offset, n_samples, out, n_src, map);
+		return;
+	}
+	fused_run_groups(f, 0, f->n_stages, offset, n_samples);
+	for (i = 0; i < n_src; i++)
+		out[i] = SPA_MEMBER(src[i], offset * stride, void);
+}
+
+#endif /* FUSED_H */
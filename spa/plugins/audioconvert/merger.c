@@ -45,6 +45,7 @@
 #include <spa/debug/pod.h>
 
 #include "fmt-ops.h"
+#include "fused.h"
 
 #define NAME "merger"
 
@@ -110,6 +111,7 @@ struct impl {
 	struct port out_ports[MAX_PORTS + 1];
 
 	struct convert conv;
+	struct fused *fused;
 	uint32_t cpu_flags;
 	unsigned int is_passthrough:1;
 	unsigned int started:1;
@@ -1009,7 +1011,11 @@ static int impl_node_process(void *object)
 		spa_log_trace_fp(this->log, NAME " %p %p %d", this, dst_datas[i],
 				n_samples * outport->stride);
 	}
-	if (!this->is_passthrough)
+	if (!this->is_passthrough &&
+	    (this->fused == NULL ||
+	     fused_add(this->fused, convert_process_stage, &this->conv,
+		     n_dst_datas, dst_datas, outport->stride,
+		     n_src_datas, src_datas, GET_IN_PORT(this, 0)->stride, n_samples) < 0))
 		convert_process(&this->conv, dst_datas, src_datas, n_samples);
 
 	return res | SPA_STATUS_HAVE_DATA;
@@ -1044,6 +1050,8 @@ static int impl_get_interface(struct spa_handle *handle, const char *type, void
 
 	if (strcmp(type, SPA_TYPE_INTERFACE_Node) == 0)
 		*interface = &this->node;
+	else if (strcmp(type, FUSED_INTERFACE) == 0)
+		*interface = &this->fused;
 	else
 		return -ENOENT;
 
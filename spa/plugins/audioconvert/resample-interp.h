@@ -0,0 +1,181 @@
+/* Spa
+ *
+ * Copyright © 2020 Wim Taymans
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the next
+ * paragraph) shall be included in all copies or substantial portions of the
+ * Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+#include <math.h>
+#include <errno.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "resample.h"
+
+/* Cheap linear and cubic (Catmull-Rom) interpolating resamplers with very
+ * low delay. They don't filter so they alias when downsampling. */
+
+#define INTERP_MAX_HIST	3
+
+struct interp_data {
+	uint32_t n_half;		/* 1 for linear, 2 for cubic */
+	uint32_t n_hist;		/* 2 * n_half - 1 samples of history */
+	double step;			/* input samples per output sample */
+	double pos;			/* position of the next output sample
+					 * relative to the start of the history */
+	float hist[][INTERP_MAX_HIST];	/* history of each channel */
+};
+
+static void impl_interp_free(struct resample *r)
+{
+	free(r->data);
+	r->data = NULL;
+}
+
+static void impl_interp_update_rate(struct resample *r, double rate)
+{
+	struct interp_data *d = r->data;
+	d->step = ((double)r->i_rate / rate) / (double)r->o_rate;
+}
+
+static uint32_t impl_interp_in_len(struct resample *r, uint32_t out_len)
+{
+	struct interp_data *d = r->data;
+	int64_t last;
+
+	if (out_len == 0)
+		return 0;
+
+	last = (int64_t)(d->pos + (out_len - 1) * d->step);
+	last += d->n_half + 1 - d->n_hist;
+
+	return SPA_MAX(last, 0);
+}
+
+static inline float interp_linear(const float *y, float x)
+{
+	return y[0] + (y[1] - y[0]) * x;
+}
+
+static inline float interp_cubic(const float *y, float x)
+{
+	float a = -0.5f * y[0] + 1.5f * y[1] - 1.5f * y[2] + 0.5f * y[3];
+	float b = y[0] - 2.5f * y[1] + 2.0f * y[2] - 0.5f * y[3];
+	float c = -0.5f * y[0] + 0.5f * y[2];
+	return ((a * x + b) * x + c) * x + y[1];
+}
+
+static void impl_interp_process(struct resample *r,
+		const void * SPA_RESTRICT src[], uint32_t *in_len,
+		void * SPA_RESTRICT dst[], uint32_t *out_len)
+{
+	struct interp_data *d = r->data;
+	uint32_t c, i, o, n_taps = 2 * d->n_half, n_hist = d->n_hist;
+	uint32_t ilen = *in_len, olen = *out_len, avail = n_hist + ilen;
+	int64_t consumed;
+	double pos = d->pos;
+
+	o = 0;
+	for (c = 0; c < r->channels; c++) {
+		const float *s = src[c];
+		float *dp = dst[c], *h = d->hist[c];
+
+		pos = d->pos;
+		for (o = 0; o < olen; o++) {
+			uint32_t j = (uint32_t)pos - (d->n_half - 1);
+			float x = pos - floor(pos), y[4];
+			const float *ip;
+
+			if (j + n_taps > avail)
+				break;
+
+			if (j >= n_hist) {
+				ip = &s[j - n_hist];
+			} else {
+				/* taps overlap the history */
+				for (i = 0; i < n_taps; i++)
+					y[i] = j + i < n_hist ? h[j + i] : s[j + i - n_hist];
+				ip = y;
+			}
+			dp[o] = n_taps == 2 ? interp_linear(ip, x) : interp_cubic(ip, x);
+			pos += d->step;
+		}
+	}
+
+	/* everything before the first tap of the next output sample can go */
+	consumed = (int64_t)pos - (d->n_half - 1);
+	consumed = SPA_CLAMP(consumed, 0, (int64_t)ilen);
+
+	for (c = 0; c < r->channels; c++) {
+		const float *s = src[c];
+		float *h = d->hist[c], tmp[INTERP_MAX_HIST];
+
+		for (i = 0; i < n_hist; i++) {
+			uint32_t j = consumed + i;
+			tmp[i] = j < n_hist ? h[j] : s[j - n_hist];
+		}
+		memcpy(h, tmp, n_hist * sizeof(float));
+	}
+	d->pos = pos - consumed;
+
+	*in_len = consumed;
+	*out_len = o;
+}
+
+static void impl_interp_reset(struct resample *r)
+{
+	struct interp_data *d = r->data;
+	memset(d->hist, 0, r->channels * sizeof(d->hist[0]));
+	d->pos = d->n_half - 1;
+}
+
+static uint32_t impl_interp_delay(struct resample *r)
+{
+	struct interp_data *d = r->data;
+	return d->n_half;
+}
+
+static int impl_interp_init(struct resample *r, bool cubic)
+{
+	struct interp_data *d;
+
+	r->free = impl_interp_free;
+	r->update_rate = impl_interp_update_rate;
+	r->in_len = impl_interp_in_len;
+	r->process = impl_interp_process;
+	r->reset = impl_interp_reset;
+	r->delay = impl_interp_delay;
+
+	d = r->data = calloc(1, sizeof(struct interp_data) +
+			r->channels * sizeof(d->hist[0]));
+	if (d == NULL)
+		return -errno;
+
+	d->n_half = cubic ? 2 : 1;
+	d->n_hist = 2 * d->n_half - 1;
+
+	spa_log_debug(r->log, "interp %p: in:%d out:%d %s", r, r->i_rate, r->o_rate,
+			cubic ? "cubic" : "linear");
+
+	impl_interp_reset(r);
+	impl_interp_update_rate(r, 1.0);
+
+	return 0;
+}
@@ -25,9 +25,31 @@
 #include <math.h>
 
 #include <spa/utils/defs.h>
+#include <spa/utils/list.h>
+#include <spa/support/log.h>
 
 #include "resample.h"
 
+/* filter banks are immutable once built and shared between all resamplers
+ * with the same rates, quality and number of phases */
+struct native_filter {
+	struct spa_list link;
+	int ref;
+	uint32_t in_rate;
+	uint32_t out_rate;
+	uint32_t n_taps;
+	uint32_t n_phases;
+	uint32_t stride;
+	double cutoff;
+	size_t size;
+	float *taps;
+};
+
+struct native_filter *native_filter_get(uint32_t in_rate, uint32_t out_rate,
+		uint32_t n_taps, uint32_t n_phases, uint32_t stride, double cutoff,
+		bool cached, struct spa_log *log);
+void native_filter_unref(struct native_filter *f);
+
 typedef void (*resample_func_t)(struct resample *r,
         const void * SPA_RESTRICT src[], uint32_t *in_len,
         void * SPA_RESTRICT dst[], uint32_t offs, uint32_t *out_len);
@@ -46,7 +68,8 @@ struct native_data {
 	uint32_t hist;
 	float **history;
 	resample_func_t func;
-	float *filter;
+	struct native_filter *shared;
+	const float *filter;
 	float *hist_mem;
 };
 
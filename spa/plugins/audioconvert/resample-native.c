@@ -0,0 +1,131 @@
+/* Spa
+ *
+ * Copyright © 2019 Wim Taymans
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the next
+ * paragraph) shall be included in all copies or substantial portions of the
+ * Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+#include <stdlib.h>
+#include <pthread.h>
+
+#include "resample-native-impl.h"
+
+static inline double sinc(double x)
+{
+	if (x < 1e-6) return 1.0;
+	x *= M_PI;
+	return sin(x) / x;
+}
+
+static inline double blackman(double x, double n_taps)
+{
+	double w = 2.0 * x * M_PI / n_taps + M_PI;
+	return 0.3635819 - 0.4891775 * cos(w) +
+		0.1365995 * cos(2 * w) - 0.0106411 * cos(3 * w);
+}
+
+static int build_filter(float *taps, uint32_t stride, uint32_t n_taps, uint32_t n_phases, double cutoff)
+{
+	uint32_t i, j, n_taps12 = n_taps/2;
+
+	for (i = 0; i <= n_phases; i++) {
+		double t = (double) i / (double) n_phases;
+		for (j = 0; j < n_taps12; j++, t += 1.0) {
+			/* exploit symmetry in filter taps */
+			taps[(n_phases - i) * stride + n_taps12 + j] =
+				taps[i * stride + (n_taps12 - j - 1)] =
+					cutoff * sinc(t * cutoff) * blackman(t, n_taps);
+		}
+	}
+	return 0;
+}
+
+static struct {
+	pthread_mutex_t lock;
+	struct spa_list filters;
+} native_filter_cache = {
+	PTHREAD_MUTEX_INITIALIZER,
+	{ &native_filter_cache.filters, &native_filter_cache.filters },
+};
+
+static struct native_filter *native_filter_new(uint32_t in_rate, uint32_t out_rate,
+		uint32_t n_taps, uint32_t n_phases, uint32_t stride, double cutoff)
+{
+	struct native_filter *f;
+	size_t size = stride * sizeof(float) * (n_phases + 1);
+
+	f = malloc(sizeof(struct native_filter) + size + 64);
+	if (f == NULL)
+		return NULL;
+
+	spa_list_init(&f->link);
+	f->ref = 1;
+	f->in_rate = in_rate;
+	f->out_rate = out_rate;
+	f->n_taps = n_taps;
+	f->n_phases = n_phases;
+	f->stride = stride;
+	f->cutoff = cutoff;
+	f->size = size;
+	f->taps = SPA_MEMBER_ALIGN(f, sizeof(struct native_filter), 64, float);
+
+	build_filter(f->taps, stride, n_taps, n_phases, cutoff);
+
+	return f;
+}
+
+struct native_filter *native_filter_get(uint32_t in_rate, uint32_t out_rate,
+		uint32_t n_taps, uint32_t n_phases, uint32_t stride, double cutoff,
+		bool cached, struct spa_log *log)
+{
+	struct native_filter *f;
+
+	if (!cached)
+		return native_filter_new(in_rate, out_rate, n_taps, n_phases, stride, cutoff);
+
+	pthread_mutex_lock(&native_filter_cache.lock);
+	spa_list_for_each(f, &native_filter_cache.filters, link) {
+		if (f->in_rate == in_rate && f->out_rate == out_rate &&
+		    f->n_taps == n_taps && f->n_phases == n_phases &&
+		    f->stride == stride && f->cutoff == cutoff) {
+			f->ref++;
+			goto done;
+		}
+	}
+	f = native_filter_new(in_rate, out_rate, n_taps, n_phases, stride, cutoff);
+	if (f != NULL)
+		spa_list_append(&native_filter_cache.filters, &f->link);
+done:
+	if (f != NULL)
+		spa_log_debug(log, "native filter %p: in:%d out:%d n_taps:%d n_phases:%d ref:%d",
+				f, in_rate, out_rate, n_taps, n_phases, f->ref);
+	pthread_mutex_unlock(&native_filter_cache.lock);
+	return f;
+}
+
+void native_filter_unref(struct native_filter *f)
+{
+	pthread_mutex_lock(&native_filter_cache.lock);
+	if (--f->ref == 0) {
+		spa_list_remove(&f->link);
+		free(f);
+	}
+	pthread_mutex_unlock(&native_filter_cache.lock);
+}
@@ -29,8 +29,6 @@ struct quality {
 	double cutoff;
 };
 
-#define DEFAULT_QUALITY	4
-
 static const struct quality blackman_qualities[] = {
 	{ 8, 0.5, },
 	{ 16, 0.6, },
@@ -45,39 +43,15 @@ static const struct quality blackman_qualities[] = {
 	{ 160, 0.960, }
 };
 
-static inline double sinc(double x)
-{
-	if (x < 1e-6) return 1.0;
-	x *= M_PI;
-	return sin(x) / x;
-}
-
-static inline double blackman(double x, double n_taps)
-{
-	double w = 2.0 * x * M_PI / n_taps + M_PI;
-	return 0.3635819 - 0.4891775 * cos(w) +
-		0.1365995 * cos(2 * w) - 0.0106411 * cos(3 * w);
-}
-
-static int build_filter(float *taps, uint32_t stride, uint32_t n_taps, uint32_t n_phases, double cutoff)
-{
-	uint32_t i, j, n_taps12 = n_taps/2;
-
-	for (i = 0; i <= n_phases; i++) {
-		double t = (double) i / (double) n_phases;
-		for (j = 0; j < n_taps12; j++, t += 1.0) {
-			/* exploit symmetry in filter taps */
-			taps[(n_phases - i) * stride + n_taps12 + j] =
-				taps[i * stride + (n_taps12 - j - 1)] =
-					cutoff * sinc(t * cutoff) * blackman(t, n_taps);
-		}
-	}
-	return 0;
-}
-
 static void impl_native_free(struct resample *r)
 {
-	free(r->data);
+	struct native_data *d = r->data;
+
+	if (d == NULL)
+		return;
+	if (d->shared)
+		native_filter_unref(d->shared);
+	free(d);
 	r->data = NULL;
 }
 
@@ -195,9 +169,16 @@ static void impl_native_process(struct resample *r,
 
 	if (in >= hist) {
 		/* we are past the history and can now work on the new
-		 * input data */
-		in = *in_len;
-		data->func(r, src, &in, dst, out, out_len);
+		 * input data, skip the refill samples the history already
+		 * stepped over */
+		uint32_t skip = in - hist;
+		const void *ss[r->channels];
+
+		for (c = 0; c < r->channels; c++)
+			ss[c] = &s[c][skip];
+		in = *in_len - skip;
+		data->func(r, ss, &in, dst, out, out_len);
+		in += skip;
 		spa_log_trace_fp(r->log, "native %p: in:%d/%d out %d/%d",
 				r, *in_len, in, *out_len, out);
 
@@ -256,10 +237,11 @@ static uint32_t impl_native_delay (struct resample *r)
 static int impl_native_init(struct resample *r)
 {
 	struct native_data *d;
-	const struct quality *q = &blackman_qualities[DEFAULT_QUALITY];
+	const struct quality *q;
 	double scale;
-	uint32_t c, n_taps, n_phases, filter_size, in_rate, out_rate, gcd, filter_stride;
+	uint32_t c, n_taps, n_phases, in_rate, out_rate, gcd, filter_stride;
 	uint32_t history_stride, history_size, oversample;
+	struct native_filter *f;
 
 	r->free = impl_native_free;
 	r->update_rate = impl_native_update_rate;
@@ -268,6 +250,9 @@ static int impl_native_init(struct resample *r)
 	r->reset = impl_native_reset;
 	r->delay = impl_native_delay;
 
+	r->quality = SPA_MIN(r->quality, SPA_N_ELEMENTS(blackman_qualities) - 1);
+	q = &blackman_qualities[r->quality];
+
 	gcd = calc_gcd(r->i_rate, r->o_rate);
 
 	in_rate = r->i_rate / gcd;
@@ -283,37 +268,41 @@ static int impl_native_init(struct resample *r)
 	oversample = (255 + n_phases) / n_phases;
 	n_phases *= oversample;
 
-	filter_stride = SPA_ROUND_UP_N(n_taps * sizeof(float), 64);
-	filter_size = filter_stride * (n_phases + 1);
+	filter_stride = SPA_ROUND_UP_N(n_taps * sizeof(float), 64) / sizeof(float);
 	history_stride = SPA_ROUND_UP_N(2 * n_taps * sizeof(float), 64);
 	history_size = r->channels * history_stride;
 
+	f = native_filter_get(in_rate, out_rate, n_taps, n_phases, filter_stride, scale,
+			!SPA_FLAG_IS_SET(r->options, RESAMPLE_OPTION_NO_CACHE), r->log);
+	if (f == NULL)
+		return -errno;
+
 	d = malloc(sizeof(struct native_data) +
-			filter_size +
 			history_size +
 			(r->channels * sizeof(float*)) +
 			64);
 
-	if (d == NULL)
+	if (d == NULL) {
+		native_filter_unref(f);
 		return -errno;
+	}
 
 	r->data = d;
 	d->n_taps = n_taps;
 	d->n_phases = n_phases;
 	d->in_rate = in_rate;
 	d->out_rate = out_rate;
-	d->filter = SPA_MEMBER_ALIGN(d, sizeof(struct native_data), 64, float);
-	d->hist_mem = SPA_MEMBER_ALIGN(d->filter, filter_size, 64, float);
+	d->shared = f;
+	d->filter = f->taps;
+	d->hist_mem = SPA_MEMBER_ALIGN(d, sizeof(struct native_data), 64, float);
 	d->history = SPA_MEMBER(d->hist_mem, history_size, float*);
-	d->filter_stride = filter_stride / sizeof(float);
+	d->filter_stride = filter_stride;
 	d->filter_stride_os = d->filter_stride * oversample;
 	for (c = 0; c < r->channels; c++)
 		d->history[c] = SPA_MEMBER(d->hist_mem, c * history_stride, float);
 
-	build_filter(d->filter, d->filter_stride, n_taps, n_phases, scale);
-
-	spa_log_debug(r->log, "native %p: in:%d out:%d n_taps:%d n_phases:%d",
-			r, in_rate, out_rate, n_taps, n_phases);
+	spa_log_debug(r->log, "native %p: in:%d out:%d quality:%d n_taps:%d n_phases:%d filter:%p",
+			r, in_rate, out_rate, r->quality, n_taps, n_phases, f);
 
 	impl_native_reset(r);
 	impl_native_update_rate(r, 1.0);
@@ -28,6 +28,7 @@
 
 #include <spa/support/plugin.h>
 #include <spa/support/log.h>
+#include <spa/support/loop.h>
 #include <spa/utils/list.h>
 #include <spa/utils/names.h>
 #include <spa/node/node.h>
@@ -42,6 +43,8 @@
 
 #include "resample-peaks.h"
 #include "resample-native.h"
+#include "resample-interp.h"
+#include "fused.h"
 
 #define NAME "resample"
 
@@ -50,6 +53,7 @@
 
 #define MAX_SAMPLES	8192
 #define MAX_BUFFERS	32
+#define MAX_DATAS	32
 
 struct impl;
 
@@ -69,6 +73,7 @@ struct buffer {
 	struct spa_list link;
 	struct spa_buffer *outbuf;
 	struct spa_meta_header *h;
+	void *datas[MAX_DATAS];
 };
 
 struct port {
@@ -100,12 +105,14 @@ struct impl {
 
 	struct spa_log *log;
 	struct spa_cpu *cpu;
+	struct spa_loop *data_loop;
 
 	struct spa_io_position *io_position;
 	struct spa_io_rate_match *io_rate_match;
 
 	uint64_t info_all;
 	struct spa_node_info info;
+	struct spa_param_info params[1];
 	struct props props;
 
 	struct spa_hook_list hooks;
@@ -117,17 +124,60 @@ struct impl {
 #define MODE_MERGE	1
 #define MODE_CONVERT	2
 	int mode;
+	uint32_t method;		/* enum spa_audio_resample_method */
 	unsigned int started:1;
 	unsigned int peaks:1;
+	unsigned int is_passthrough:1;
+	unsigned int passthrough:1;
+	unsigned int static_out:1;	/* output buffers can't take the input data pointer */
 
 	struct resample resample;
+	struct fused *fused;
 };
 
+static uint32_t method_from_name(const char *str)
+{
+	if (strcmp(str, "linear") == 0)
+		return SPA_AUDIO_RESAMPLE_METHOD_LINEAR;
+	else if (strcmp(str, "cubic") == 0)
+		return SPA_AUDIO_RESAMPLE_METHOD_CUBIC;
+	else
+		return SPA_AUDIO_RESAMPLE_METHOD_NATIVE;
+}
+
 #define CHECK_PORT(this,d,id)		(id == 0)
 #define GET_IN_PORT(this,id)		(&this->in_port)
 #define GET_OUT_PORT(this,id)		(&this->out_port)
 #define GET_PORT(this,d,id)		(d == SPA_DIRECTION_INPUT ? GET_IN_PORT(this,id) : GET_OUT_PORT(this,id))
 
+static void emit_node_info(struct impl *this, bool full)
+{
+	if (full)
+		this->info.change_mask = this->info_all;
+
+	if (this->info.change_mask) {
+		spa_node_emit_info(&this->hooks, &this->info);
+		this->info.change_mask = 0;
+	}
+}
+
+static void emit_props_changed(struct impl *this)
+{
+	this->info.change_mask |= SPA_NODE_CHANGE_MASK_PARAMS;
+	this->params[0].flags ^= SPA_PARAM_INFO_SERIAL;
+	emit_node_info(this, false);
+}
+
+static int init_resample(struct impl *this, struct resample *r, uint32_t method)
+{
+	if (this->peaks)
+		return impl_peaks_init(r);
+	else if (method != SPA_AUDIO_RESAMPLE_METHOD_NATIVE)
+		return impl_interp_init(r, method == SPA_AUDIO_RESAMPLE_METHOD_CUBIC);
+	else
+		return impl_native_init(r);
+}
+
 static int setup_convert(struct impl *this,
 		enum spa_direction direction,
 		const struct spa_audio_info *info)
@@ -162,10 +212,17 @@ static int setup_convert(struct impl *this,
 	this->resample.o_rate = dst_info->info.raw.rate;
 	this->resample.log = this->log;
 
-	if (this->peaks)
-		err = impl_peaks_init(&this->resample);
-	else
-		err = impl_native_init(&this->resample);
+	err = init_resample(this, &this->resample, this->method);
+
+	this->is_passthrough = !this->peaks &&
+		this->resample.i_rate == this->resample.o_rate;
+	this->passthrough = false;
+
+	/* publish the delay now so that it can be reported as latency
+	 * before the first cycle */
+	if (err >= 0 && this->io_rate_match)
+		this->io_rate_match->delay = this->is_passthrough ?
+			0 : resample_delay(&this->resample);
 
 	return err;
 }
@@ -174,7 +231,87 @@ static int impl_node_enum_params(void *object, int seq,
 				 uint32_t id, uint32_t start, uint32_t num,
 				 const struct spa_pod *filter)
 {
-	return -ENOTSUP;
+	struct impl *this = object;
+	struct spa_pod *param;
+	struct spa_pod_builder b = { 0 };
+	uint8_t buffer[1024];
+	struct spa_result_node_params result;
+	uint32_t count = 0;
+
+	spa_return_val_if_fail(this != NULL, -EINVAL);
+	spa_return_val_if_fail(num != 0, -EINVAL);
+
+	result.id = id;
+	result.next = start;
+      next:
+	result.index = result.next++;
+
+	spa_pod_builder_init(&b, buffer, sizeof(buffer));
+
+	switch (id) {
+	case SPA_PARAM_Props:
+		switch (result.index) {
+		case 0:
+			param = spa_pod_builder_add_object(&b,
+				SPA_TYPE_OBJECT_Props, id,
+				SPA_PROP_rate,			SPA_POD_Double(this->props.rate),
+				SPA_PROP_quality,		SPA_POD_Int(this->resample.quality),
+				SPA_PROP_resampleMethod,	SPA_POD_Id(this->method));
+			break;
+		default:
+			return 0;
+		}
+		break;
+	default:
+		return -ENOENT;
+	}
+
+	if (spa_pod_filter(&b, &result.param, param, filter) < 0)
+		goto next;
+
+	spa_node_emit_result(&this->hooks, seq, 0, SPA_RESULT_TYPE_NODE_PARAMS, &result);
+
+	if (++count != num)
+		goto next;
+
+	return 0;
+}
+
+static int do_swap_resample(struct spa_loop *loop,
+		bool async, uint32_t seq, const void *data, size_t size, void *user_data)
+{
+	struct impl *this = user_data;
+	struct resample *r = *(struct resample **)data, tmp;
+
+	tmp = this->resample;
+	this->resample = *r;
+	*r = tmp;
+	return 0;
+}
+
+/* Make a new resampler with the current rates and swap it with the one
+ * used by the data loop. The old one is freed after the swap. */
+static int reinit_resample(struct impl *this, uint32_t quality, uint32_t method)
+{
+	struct resample r, *rp = &r;
+	int res;
+
+	r = this->resample;
+	r.quality = quality;
+	r.data = NULL;
+	if ((res = init_resample(this, &r, method)) < 0)
+		return res;
+	resample_update_rate(&r, this->props.rate);
+
+	if (this->started && this->data_loop)
+		spa_loop_invoke(this->data_loop, do_swap_resample, 0,
+				&rp, sizeof(rp), true, this);
+	else
+		do_swap_resample(NULL, false, 0, &rp, sizeof(rp), this);
+
+	this->method = method;
+	resample_free(&r);
+	return 0;
 }
 
 static int apply_props(struct impl *this, const struct spa_pod *param)
@@ -182,6 +319,10 @@ static int apply_props(struct impl *this, const struct spa_pod *param)
 	struct spa_pod_prop *prop;
 	struct spa_pod_object *obj = (struct spa_pod_object *) param;
 	struct props *p = &this->props;
+	struct port *inport = GET_IN_PORT(this, 0), *outport = GET_OUT_PORT(this, 0);
+	int res;
+	int32_t value;
+	uint32_t id, quality = this->resample.quality, method = this->method;
 
 	SPA_POD_OBJECT_FOREACH(obj, prop) {
 		switch (prop->key) {
@@ -190,10 +331,33 @@ static int apply_props(struct impl *this, const struct spa_pod *param)
 				resample_update_rate(&this->resample, p->rate);
 			}
 			break;
+		case SPA_PROP_quality:
+			/* clamp here so that setting an out of range quality
+			 * again is not a change */
+			if (spa_pod_get_int(&prop->value, &value) == 0 && value >= 0)
+				quality = SPA_MIN((uint32_t)value, RESAMPLE_MAX_QUALITY);
+			break;
+		case SPA_PROP_resampleMethod:
+			if (spa_pod_get_id(&prop->value, &id) == 0 &&
+			    id <= SPA_AUDIO_RESAMPLE_METHOD_CUBIC)
+				method = id;
+			break;
 		default:
 			break;
 		}
 	}
+	if (quality != this->resample.quality || method != this->method) {
+		spa_log_debug(this->log, NAME " %p: method:%d quality:%d", this,
+				method, quality);
+		if (inport->have_format && outport->have_format) {
+			if ((res = reinit_resample(this, quality, method)) < 0)
+				return res;
+		} else {
+			this->resample.quality = quality;
+			this->method = method;
+		}
+		emit_props_changed(this);
+	}
 	return 0;
 }
 
@@ -207,7 +371,7 @@ static int impl_node_set_param(void *object, uint32_t id, uint32_t flags,
 
 	switch (id) {
 	case SPA_PARAM_Props:
-		apply_props(this, param);
+		res = apply_props(this, param);
 		break;
 	default:
 		return -ENOTSUP;
@@ -256,17 +420,6 @@ static int impl_node_send_command(void *object, const struct spa_command *comman
 	return 0;
 }
 
-static void emit_node_info(struct impl *this, bool full)
-{
-	if (full)
-		this->info.change_mask = this->info_all;
-
-	if (this->info.change_mask) {
-		spa_node_emit_info(&this->hooks, &this->info);
-		this->info.change_mask = 0;
-	}
-}
-
 static void emit_port_info(struct impl *this, struct port *port, bool full)
 {
 	if (full)
@@ -592,10 +745,19 @@ impl_node_port_use_buffers(void *object,
 
 	clear_buffers(this, port);
 
+	if (n_buffers > MAX_BUFFERS)
+		return -ENOSPC;
+
+	if (direction == SPA_DIRECTION_OUTPUT)
+		this->static_out = false;
+
 	for (i = 0; i < n_buffers; i++) {
 		struct buffer *b;
 		struct spa_data *d = buffers[i]->datas;
 
+		if (buffers[i]->n_datas > MAX_DATAS)
+			return -ENOSPC;
+
 		b = &port->buffers[i];
 		b->id = i;
 		b->flags = 0;
@@ -614,6 +776,10 @@ impl_node_port_use_buffers(void *object,
 					      buffers[i]);
 				return -EINVAL;
 			}
+			b->datas[j] = d[j].data;
+			if (direction == SPA_DIRECTION_OUTPUT &&
+			    !SPA_FLAG_IS_SET(d[j].flags, SPA_DATA_FLAG_DYNAMIC))
+				this->static_out = true;
 		}
 
 		if (direction == SPA_DIRECTION_OUTPUT)
@@ -700,6 +866,43 @@ static int impl_node_port_reuse_buffer(void *object, uint32_t port_id, uint32_t
 	return 0;
 }
 
+/* the input is still to be made by the stages of the fused pipeline,
+ * pull it tile by tile and resample each tile while it is in the cache */
+static void process_fused(struct impl *this, const void *base[], uint32_t offset,
+		bool flush_in, uint32_t *in_len, void *dst_datas[], uint32_t *out_len)
+{
+	struct fused *f = this->fused;
+	uint32_t i, n_in, n_out, in_done = 0, out_done = 0, tile;
+	uint32_t channels = this->resample.channels;
+	const void *src[channels];
+	void *dst[channels];
+
+	tile = fused_tile(f);
+
+	while (in_done < *in_len && out_done < *out_len) {
+		n_in = SPA_MIN(tile, *in_len - in_done);
+		n_out = *out_len - out_done;
+
+		fused_pull(f, base, channels, sizeof(float), offset + in_done, n_in, src);
+		for (i = 0; i < channels; i++)
+			dst[i] = SPA_MEMBER(dst_datas[i], out_done * sizeof(float), void);
+
+		resample_process(&this->resample, src, &n_in, dst, &n_out);
+
+		in_done += n_in;
+		out_done += n_out;
+		if (n_in == 0 && n_out == 0)
+			break;
+	}
+	/* the input we keep for the next cycle must be in the buffer */
+	if (in_done < *in_len && !flush_in)
+		fused_run_groups(f, 0, f->n_stages, offset + in_done, *in_len - in_done);
+	fused_clear(f);
+
+	*in_len = in_done;
+	*out_len = out_done;
+}
+
 static int impl_node_process(void *object)
 {
 	struct impl *this = object;
@@ -709,10 +912,12 @@ static int impl_node_process(void *object)
 	struct spa_buffer *sb, *db;
 	uint32_t i, size, in_len, out_len, pin_len, pout_len, maxsize, max;
 	int res = 0;
-	const void **src_datas;
+	const void **src_datas, **base_datas;
 	void **dst_datas;
+	uint32_t map[FUSED_MAX_PLANES];
 	bool flush_out = false;
 	bool flush_in = false;
+	bool passthrough;
 
 	spa_return_val_if_fail(this != NULL, -EINVAL);
 
@@ -771,14 +976,45 @@ static int impl_node_process(void *object)
 		break;
 	}
 
+	passthrough = this->is_passthrough && !this->static_out &&
+		inport->offset == 0 && outport->offset == 0;
+
 	if (this->io_rate_match) {
 		if (SPA_FLAG_IS_SET(this->io_rate_match->flags, SPA_IO_RATE_MATCH_FLAG_ACTIVE)) {
 			resample_update_rate(&this->resample, this->io_rate_match->rate);
+			passthrough = false;
 		} else {
 			resample_update_rate(&this->resample, 1.0);
 		}
 	}
 
+	if (passthrough != this->passthrough) {
+		spa_log_debug(this->log, NAME " %p: passthrough %d", this, passthrough);
+		/* start from a clean history when we start resampling again */
+		if (!passthrough)
+			resample_reset(&this->resample);
+		this->passthrough = passthrough;
+	}
+
+	if (passthrough) {
+		/* identical rates, hand the input memory to the output buffer */
+		for (i = 0; i < db->n_datas; i++) {
+			db->datas[i].data = sb->datas[i].data;
+			db->datas[i].chunk->size = size;
+			db->datas[i].chunk->offset = 0;
+		}
+		inio->status = SPA_STATUS_NEED_DATA;
+		outio->status = SPA_STATUS_HAVE_DATA;
+		outio->buffer_id = dbuf->id;
+		dequeue_buffer(this, dbuf);
+
+		if (this->io_rate_match) {
+			this->io_rate_match->delay = 0;
+			this->io_rate_match->size = max;
+		}
+		return SPA_STATUS_HAVE_DATA | SPA_STATUS_NEED_DATA;
+	}
+
 	in_len = (size - inport->offset) / sizeof(float);
 	out_len = (maxsize - outport->offset) / sizeof(float);
 
@@ -786,14 +1022,24 @@ static int impl_node_process(void *object)
 	pout_len = out_len;
 
 	src_datas = alloca(sizeof(void*) * this->resample.channels);
+	base_datas = alloca(sizeof(void*) * this->resample.channels);
 	dst_datas = alloca(sizeof(void*) * this->resample.channels);
 
-	for (i = 0; i < sb->n_datas; i++)
+	for (i = 0; i < sb->n_datas; i++) {
+		base_datas[i] = sb->datas[i].data;
 		src_datas[i] = SPA_MEMBER(sb->datas[i].data, inport->offset, void);
-	for (i = 0; i < db->n_datas; i++)
-		dst_datas[i] = SPA_MEMBER(db->datas[i].data, outport->offset, void);
+	}
+	for (i = 0; i < db->n_datas; i++) {
+		db->datas[i].data = dbuf->datas[i];
+		dst_datas[i] = SPA_MEMBER(dbuf->datas[i], outport->offset, void);
+	}
 
-	resample_process(&this->resample, src_datas, &in_len, dst_datas, &out_len);
+	if (this->fused &&
+	    fused_produces(this->fused, base_datas, sb->n_datas, sizeof(float), map))
+		process_fused(this, base_datas, inport->offset / sizeof(float), flush_in,
+				&in_len, dst_datas, &out_len);
+	else
+		resample_process(&this->resample, src_datas, &in_len, dst_datas, &out_len);
 
 	spa_log_trace_fp(this->log, NAME " %p: in %d/%d %zd %d out %d/%d %zd %d max:%d",
 			this, pin_len, in_len, size / sizeof(float), inport->offset,
@@ -865,6 +1111,8 @@ static int impl_get_interface(struct spa_handle *handle, const char *type, void
 
 	if (strcmp(type, SPA_TYPE_INTERFACE_Node) == 0)
 		*interface = &this->node;
+	else if (strcmp(type, FUSED_INTERFACE) == 0)
+		*interface = &this->fused;
 	else
 		return -ENOENT;
 
@@ -912,13 +1160,20 @@ impl_init(const struct spa_handle_factory *factory,
 
 	this->log = spa_support_find(support, n_support, SPA_TYPE_INTERFACE_Log);
 	this->cpu = spa_support_find(support, n_support, SPA_TYPE_INTERFACE_CPU);
+	this->data_loop = spa_support_find(support, n_support, SPA_TYPE_INTERFACE_DataLoop);
 
 	if (this->cpu)
 		this->resample.cpu_flags = spa_cpu_get_flags(this->cpu);
 
+	this->resample.quality = RESAMPLE_DEFAULT_QUALITY;
+
 	if (info != NULL) {
 		if ((str = spa_dict_lookup(info, "resample.peaks")) != NULL)
 			this->peaks = atoi(str);
+		if ((str = spa_dict_lookup(info, "resample.quality")) != NULL)
+			this->resample.quality = SPA_CLAMP(atoi(str), 0, RESAMPLE_MAX_QUALITY);
+		if ((str = spa_dict_lookup(info, "resample.method")) != NULL)
+			this->method = method_from_name(str);
 		if ((str = spa_dict_lookup(info, "factory.mode")) != NULL) {
 			if (strcmp(str, "split") == 0)
 				this->mode = MODE_SPLIT;
@@ -928,7 +1183,8 @@ impl_init(const struct spa_handle_factory *factory,
 				this->mode = MODE_CONVERT;
 		}
 	}
-	spa_log_debug(this->log, "mode:%d", this->mode);
+	spa_log_debug(this->log, "mode:%d method:%d quality:%d", this->mode,
+			this->method, this->resample.quality);
 
 	this->node.iface = SPA_INTERFACE_INIT(
 			SPA_TYPE_INTERFACE_Node,
@@ -938,8 +1194,12 @@ impl_init(const struct spa_handle_factory *factory,
 	spa_hook_list_init(&this->hooks);
 
 	this->info = SPA_NODE_INFO_INIT();
-	this->info_all = SPA_NODE_CHANGE_MASK_FLAGS;
+	this->info_all = SPA_NODE_CHANGE_MASK_FLAGS |
+			SPA_NODE_CHANGE_MASK_PARAMS;
 	this->info.flags = SPA_NODE_FLAG_RT;
+	this->params[0] = SPA_PARAM_INFO(SPA_PARAM_Props, SPA_PARAM_INFO_READWRITE);
+	this->info.params = this->params;
+	this->info.n_params = 1;
 
 	port = GET_OUT_PORT(this, 0);
 	port->direction = SPA_DIRECTION_OUTPUT;
@@ -29,6 +29,13 @@
 #include <spa/support/log.h>
 
 struct resample {
+#define RESAMPLE_OPTION_NO_CACHE	(1<<0)	/**< don't share the filter with other
+						  *  resamplers */
+	uint32_t options;
+#define RESAMPLE_DEFAULT_QUALITY	4
+#define RESAMPLE_MAX_QUALITY		10
+	uint32_t quality;		/**< quality of the native resampler,
+					  *  0 (fast) to 10 (best) */
 	uint32_t cpu_flags;
 	uint32_t channels;
 	uint32_t i_rate;
@@ -43,6 +43,7 @@
 #include <spa/debug/pod.h>
 
 #include "fmt-ops.h"
+#include "fused.h"
 
 #define NAME "splitter"
 
@@ -111,6 +112,7 @@ struct impl {
 
 	uint32_t cpu_flags;
 	struct convert conv;
+	struct fused *fused;
 	unsigned int is_passthrough:1;
 	unsigned int started:1;
 
@@ -936,7 +938,11 @@ static int impl_node_process(void *object)
 			n_src_datas, n_dst_datas, n_samples, maxsize, inport->stride,
 			this->is_passthrough);
 
-	if (!this->is_passthrough)
+	if (!this->is_passthrough &&
+	    (this->fused == NULL ||
+	     fused_add(this->fused, convert_process_stage, &this->conv,
+		     n_dst_datas, dst_datas, GET_OUT_PORT(this, 0)->stride,
+		     n_src_datas, src_datas, inport->stride, n_samples) < 0))
 		convert_process(&this->conv, dst_datas, src_datas, n_samples);
 
 	inio->status = SPA_STATUS_NEED_DATA;
@@ -974,6 +980,8 @@ static int impl_get_interface(struct spa_handle *handle, const char *type, void
 
 	if (strcmp(type, SPA_TYPE_INTERFACE_Node) == 0)
 		*interface = &this->node;
+	else if (strcmp(type, FUSED_INTERFACE) == 0)
+		*interface = &this->fused;
 	else
 		return -ENOENT;
 
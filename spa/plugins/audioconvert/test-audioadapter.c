@@ -34,7 +34,9 @@
 #include <spa/param/param.h>
 #include <spa/param/audio/format.h>
 #include <spa/param/audio/format-utils.h>
+#include <spa/param/latency-utils.h>
 #include <spa/node/node.h>
+#include <spa/node/utils.h>
 #include <spa/debug/mem.h>
 #include <spa/support/log-impl.h>
 
@@ -232,6 +234,36 @@ static int test_split_setup(struct context *ctx)
 	return 0;
 }
 
+static int test_latency(struct context *ctx)
+{
+	struct spa_pod_builder b = { 0 };
+	uint8_t buffer[1024];
+	struct spa_pod *param;
+	struct spa_latency_info info;
+	uint32_t index = 0;
+	int res;
+
+	/* the slave reports 256 samples, the resampler from 44100 to 48000
+	 * is between the slave and our ports and adds its delay */
+	res = spa_node_send_command(ctx->adapter_node,
+			&SPA_NODE_COMMAND_INIT(SPA_NODE_COMMAND_Start));
+
+	spa_pod_builder_init(&b, buffer, sizeof(buffer));
+	res = spa_node_port_enum_params_sync(ctx->adapter_node,
+			SPA_DIRECTION_OUTPUT, 0, SPA_PARAM_Latency,
+			&index, NULL, &param, &b);
+	spa_assert(res == 1);
+
+	res = spa_latency_parse(param, &info);
+	spa_assert(res >= 0);
+	spa_log_debug(&logger.log, "latency %d %u-%u", info.direction,
+			info.min_rate, info.max_rate);
+	spa_assert(info.direction == SPA_DIRECTION_INPUT);
+	spa_assert(info.min_rate > 256);
+	spa_assert(info.min_rate == info.max_rate);
+
+	return 0;
+}
 
 int main(int argc, char *argv[])
 {
@@ -243,6 +275,7 @@ int main(int argc, char *argv[])
 
 	test_init_state(&ctx);
 	test_split_setup(&ctx);
+	test_latency(&ctx);
 
 	clean_context(&ctx);
 
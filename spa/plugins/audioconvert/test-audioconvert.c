@@ -34,7 +34,9 @@
 #include <spa/param/param.h>
 #include <spa/param/audio/format.h>
 #include <spa/param/audio/format-utils.h>
+#include <spa/param/props.h>
 #include <spa/node/node.h>
+#include <spa/node/utils.h>
 #include <spa/debug/mem.h>
 #include <spa/support/log-impl.h>
 
@@ -509,6 +511,105 @@ static int test_set_in_format2(struct context *ctx)
 	return 0;
 }
 
+struct props_data {
+	uint32_t flags;
+	uint32_t n_changes;
+};
+
+static void props_info_check(void *data, const struct spa_node_info *info)
+{
+	struct props_data *d = data;
+	uint32_t i;
+
+	for (i = 0; i < info->n_params; i++) {
+		if (info->params[i].id != SPA_PARAM_Props)
+			continue;
+		if (info->params[i].flags != d->flags)
+			d->n_changes++;
+		d->flags = info->params[i].flags;
+	}
+}
+
+static void set_props(struct context *ctx, int32_t quality, uint32_t method)
+{
+	struct spa_pod_builder b = { 0 };
+	uint8_t buffer[1024];
+	struct spa_pod *param;
+	int res;
+
+	spa_pod_builder_init(&b, buffer, sizeof(buffer));
+	param = spa_pod_builder_add_object(&b,
+		SPA_TYPE_OBJECT_Props, SPA_PARAM_Props,
+		SPA_PROP_quality,		SPA_POD_Int(quality),
+		SPA_PROP_resampleMethod,	SPA_POD_Id(method));
+
+	res = spa_node_set_param(ctx->convert_node, SPA_PARAM_Props, 0, param);
+	spa_assert(res == 0);
+}
+
+static void check_props(struct context *ctx, int32_t quality, uint32_t method)
+{
+	struct spa_pod_builder b = { 0 };
+	uint8_t buffer[1024];
+	struct spa_pod *param;
+	uint32_t index = 0, id;
+	int32_t q;
+	float volume;
+	int res;
+
+	spa_pod_builder_init(&b, buffer, sizeof(buffer));
+	res = spa_node_enum_params_sync(ctx->convert_node, SPA_PARAM_Props,
+			&index, NULL, &param, &b);
+	spa_assert(res == 1);
+
+	/* the props of channelmix and resample are in one object */
+	res = spa_pod_parse_object(param,
+		SPA_TYPE_OBJECT_Props, NULL,
+		SPA_PROP_volume,		SPA_POD_Float(&volume),
+		SPA_PROP_quality,		SPA_POD_Int(&q),
+		SPA_PROP_resampleMethod,	SPA_POD_Id(&id));
+	spa_assert(res == 3);
+	spa_assert(q == quality);
+	spa_assert(id == method);
+}
+
+static int test_set_props(struct context *ctx)
+{
+	struct spa_hook listener;
+	static const struct spa_node_events props_events = {
+		SPA_VERSION_NODE_EVENTS,
+		.info = props_info_check,
+	};
+	struct props_data data = { 0, };
+
+	spa_zero(listener);
+	spa_node_add_listener(ctx->convert_node,
+			&listener, &props_events, &data);
+	data.n_changes = 0;
+
+	/* switch the resampler at runtime */
+	set_props(ctx, 0, SPA_AUDIO_RESAMPLE_METHOD_CUBIC);
+	check_props(ctx, 0, SPA_AUDIO_RESAMPLE_METHOD_CUBIC);
+	spa_assert(data.n_changes == 1);
+
+	set_props(ctx, 4, SPA_AUDIO_RESAMPLE_METHOD_NATIVE);
+	check_props(ctx, 4, SPA_AUDIO_RESAMPLE_METHOD_NATIVE);
+	spa_assert(data.n_changes == 2);
+
+	/* an out of range quality is clamped, setting it again is not a change */
+	set_props(ctx, 20, SPA_AUDIO_RESAMPLE_METHOD_NATIVE);
+	check_props(ctx, 10, SPA_AUDIO_RESAMPLE_METHOD_NATIVE);
+	spa_assert(data.n_changes == 3);
+
+	set_props(ctx, 20, SPA_AUDIO_RESAMPLE_METHOD_NATIVE);
+	check_props(ctx, 10, SPA_AUDIO_RESAMPLE_METHOD_NATIVE);
+	spa_assert(data.n_changes == 3);
+
+	spa_hook_remove(&listener);
+
+	return 0;
+}
+
 int main(int argc, char *argv[])
 {
 	struct context ctx;
@@ -529,6 +630,7 @@ int main(int argc, char *argv[])
 	test_convert_setup2(&ctx);
 	test_set_in_format2(&ctx);
 	test_set_out_format(&ctx);
+	test_set_props(&ctx);
 
 	clean_context(&ctx);
 
@@ -35,6 +35,8 @@
 SPA_LOG_IMPL(logger);
 
 #include "channelmix-ops.c"
+#include "test-helper.h"
+
 static void dump_matrix(struct channelmix *mix)
 {
 	uint32_t i, j;
@@ -118,6 +120,128 @@ static void test_7p1_N(void)
 	test_mix(8, _M(FL)|_M(FR)|_M(LFE)|_M(FC)|_M(SL)|_M(SR)|_M(RL)|_M(RR), 2, _M(FL)|_M(FR), (float[]) { 0.5, 0.5 });
 }
 
+#define N_SIMD_CHANNELS	11
+#define N_SIMD_SAMPLES	(257 + 16)
+
+static float simd_src[N_SIMD_CHANNELS][N_SIMD_SAMPLES] SPA_ALIGNED(64);
+static float simd_dst_c[N_SIMD_CHANNELS][N_SIMD_SAMPLES] SPA_ALIGNED(64);
+static float simd_dst[N_SIMD_CHANNELS][N_SIMD_SAMPLES] SPA_ALIGNED(64);
+
+static void run_simd(struct channelmix *mix, struct channelmix *ref)
+{
+	static const uint32_t n_samples[] = { 1, 3, 4, 7, 8, 15, 16, 17,
+		31, 32, 33, 63, 64, 65, 255, 256, 257 };
+	static const uint32_t offsets[] = { 0, 1, 3 };
+	const void *s[N_SIMD_CHANNELS];
+	void *d[N_SIMD_CHANNELS];
+	uint32_t i, j, k, c, n;
+
+	for (i = 0; i < SPA_N_ELEMENTS(n_samples); i++) {
+		for (j = 0; j < SPA_N_ELEMENTS(offsets); j++) {
+			for (k = 0; k < SPA_N_ELEMENTS(offsets); k++) {
+				for (c = 0; c < mix->src_chan; c++)
+					s[c] = &simd_src[c][offsets[j]];
+
+				spa_zero(simd_dst_c);
+				for (c = 0; c < mix->dst_chan; c++)
+					d[c] = &simd_dst_c[c][offsets[k]];
+				channelmix_process(ref, mix->dst_chan, d, mix->src_chan, s, n_samples[i]);
+
+				spa_zero(simd_dst);
+				for (c = 0; c < mix->dst_chan; c++)
+					d[c] = &simd_dst[c][offsets[k]];
+				channelmix_process(mix, mix->dst_chan, d, mix->src_chan, s, n_samples[i]);
+
+				/* compare everything to also catch writes past the end */
+				for (c = 0; c < N_SIMD_CHANNELS; c++)
+					for (n = 0; n < N_SIMD_SAMPLES; n++)
+						spa_assert(fabsf(simd_dst_c[c][n] - simd_dst[c][n]) < 1e-5f);
+			}
+		}
+	}
+}
+
+static void test_simd_mix(uint32_t cpu_flags, uint32_t src_chan, uint64_t src_mask,
+		uint32_t dst_chan, uint64_t dst_mask)
+{
+	float volumes[SPA_AUDIO_MAX_CHANNELS];
+	struct channelmix mix, ref;
+	uint32_t i;
+
+	spa_zero(ref);
+	ref.src_chan = src_chan;
+	ref.dst_chan = dst_chan;
+	ref.src_mask = src_mask;
+	ref.dst_mask = dst_mask;
+	ref.log = &logger.log;
+	mix = ref;
+	mix.cpu_flags = cpu_flags;
+
+	spa_assert(channelmix_init(&ref) == 0);
+	spa_assert(channelmix_init(&mix) == 0);
+
+	if (mix.process == ref.process) {
+		spa_log_debug(&logger.log, "no SIMD for %d->%d", src_chan, dst_chan);
+		return;
+	}
+	spa_log_debug(&logger.log, "compare %d->%d %08x", src_chan, dst_chan, mix.cpu_flags);
+
+	/* unity volume */
+	for (i = 0; i < src_chan; i++)
+		volumes[i] = 1.0f;
+	channelmix_set_volume(&ref, 1.0f, false, src_chan, volumes);
+	channelmix_set_volume(&mix, 1.0f, false, src_chan, volumes);
+	run_simd(&mix, &ref);
+
+	/* different volume per channel */
+	for (i = 0; i < src_chan; i++)
+		volumes[i] = 0.1f + i * 0.2f;
+	channelmix_set_volume(&ref, 0.8f, false, src_chan, volumes);
+	channelmix_set_volume(&mix, 0.8f, false, src_chan, volumes);
+	run_simd(&mix, &ref);
+
+	/* everything zero */
+	channelmix_set_volume(&ref, 1.0f, true, src_chan, volumes);
+	channelmix_set_volume(&mix, 1.0f, true, src_chan, volumes);
+	run_simd(&mix, &ref);
+
+	channelmix_free(&ref);
+	channelmix_free(&mix);
+}
+
+static void test_simd(void)
+{
+	static const uint32_t flags[] = {
+		SPA_CPU_FLAG_SSE,
+		SPA_CPU_FLAG_SSE | SPA_CPU_FLAG_AVX | SPA_CPU_FLAG_FMA3,
+		SPA_CPU_FLAG_NEON,
+	};
+	uint32_t i, j, cpu_flags = get_cpu_flags();
+
+	for (i = 0; i < N_SIMD_CHANNELS; i++)
+		for (j = 0; j < N_SIMD_SAMPLES; j++)
+			simd_src[i][j] = random_float(-1.0f, 1.0f);
+
+	for (i = 0; i < SPA_N_ELEMENTS(flags); i++) {
+		uint32_t f = flags[i];
+
+		/* get_cpu_flags() only has the bits of this architecture */
+		if ((f & cpu_flags) != f)
+			continue;
+
+		test_simd_mix(f, 2, _M(FL)|_M(FR), 2, _M(FL)|_M(FR));
+		test_simd_mix(f, 6, MASK_5_1, 6, MASK_5_1);
+		test_simd_mix(f, 11, 0, 11, 0);
+		test_simd_mix(f, 2, _M(FL)|_M(FR), 4, _M(FL)|_M(FR)|_M(RL)|_M(RR));
+		test_simd_mix(f, 6, _M(FL)|_M(FR)|_M(LFE)|_M(FC)|_M(SL)|_M(SR), 2, _M(FL)|_M(FR));
+		test_simd_mix(f, 6, _M(FL)|_M(FR)|_M(LFE)|_M(FC)|_M(SL)|_M(SR), 4, _M(FL)|_M(FR)|_M(RL)|_M(RR));
+		test_simd_mix(f, 6, _M(FL)|_M(FR)|_M(LFE)|_M(FC)|_M(SL)|_M(SR), 4, _M(FL)|_M(FR)|_M(LFE)|_M(FC));
+		test_simd_mix(f, 3, _M(FL)|_M(FR)|_M(FC), 5, _M(FL)|_M(FR)|_M(FC)|_M(SL)|_M(SR));
+		test_simd_mix(f, 5, _M(FL)|_M(FR)|_M(FC)|_M(SL)|_M(SR), 3, _M(FL)|_M(FR)|_M(FC));
+		test_simd_mix(f, 11, 0, 7, 0);
+	}
+}
+
 int main(int argc, char *argv[])
 {
 	logger.log.level = SPA_LOG_LEVEL_TRACE;
@@ -128,6 +252,7 @@ int main(int argc, char *argv[])
 	test_4_N();
 	test_5p1_N();
 	test_7p1_N();
+	test_simd();
 
 	return 0;
 }
@@ -32,6 +32,7 @@
 #include <spa/debug/mem.h>
 
 #include "fmt-ops.c"
+#include "test-helper.h"
 
 #define N_SAMPLES	253
 #define N_CHANNELS	11
@@ -260,6 +261,145 @@ static void test_s24_32_f32(void)
 			false, false, conv_s24_32d_to_f32d_c);
 }
 
+#define N_SIMD_SAMPLES	(257 + 16)
+
+static uint8_t simd_in[N_CHANNELS * N_SIMD_SAMPLES * 4] SPA_ALIGNED(64);
+static uint8_t simd_out_c[N_CHANNELS * N_SIMD_SAMPLES * 4] SPA_ALIGNED(64);
+static uint8_t simd_out[N_CHANNELS * N_SIMD_SAMPLES * 4] SPA_ALIGNED(64);
+
+static uint32_t format_size(uint32_t fmt)
+{
+	switch (fmt) {
+	case SPA_AUDIO_FORMAT_U8:
+	case SPA_AUDIO_FORMAT_U8P:
+		return 1;
+	case SPA_AUDIO_FORMAT_S16:
+	case SPA_AUDIO_FORMAT_S16P:
+		return 2;
+	case SPA_AUDIO_FORMAT_S24:
+	case SPA_AUDIO_FORMAT_S24P:
+		return 3;
+	default:
+		return 4;
+	}
+}
+
+static void setup_ptrs(uint32_t fmt, uint8_t *mem, uint32_t n_channels,
+		uint32_t offset, void *ptrs[])
+{
+	uint32_t i, size = format_size(fmt);
+
+	if (SPA_AUDIO_FORMAT_IS_PLANAR(fmt)) {
+		for (i = 0; i < n_channels; i++)
+			ptrs[i] = &mem[i * N_SIMD_SAMPLES * 4 + offset * size];
+	} else {
+		ptrs[0] = &mem[offset * size];
+	}
+}
+
+/* the SIMD versions round the float to int conversions and scale s32
+ * with 2^31, the C versions truncate and scale with 2^31 - 256. Allow
+ * one step of difference for s16 and two for s32 */
+static void compare_samples(uint32_t fmt, const void *a, const void *b, size_t size)
+{
+	size_t i;
+
+	switch (fmt) {
+	case SPA_AUDIO_FORMAT_F32:
+	case SPA_AUDIO_FORMAT_F32P:
+		for (i = 0; i < size / sizeof(float); i++)
+			spa_assert(fabsf(((float*)a)[i] - ((float*)b)[i]) < 1e-6f);
+		break;
+	case SPA_AUDIO_FORMAT_S16:
+	case SPA_AUDIO_FORMAT_S16P:
+		for (i = 0; i < size / sizeof(int16_t); i++)
+			spa_assert(abs(((int16_t*)a)[i] - ((int16_t*)b)[i]) <= 1);
+		break;
+	case SPA_AUDIO_FORMAT_S32:
+	case SPA_AUDIO_FORMAT_S32P:
+		for (i = 0; i < size / sizeof(int32_t); i++)
+			spa_assert(llabs((int64_t)((int32_t*)a)[i] - ((int32_t*)b)[i]) <= 512);
+		break;
+	default:
+		spa_assert(memcmp(a, b, size) == 0);
+		break;
+	}
+}
+
+static void compare_simd(const struct conv_info *info, const struct conv_info *ref,
+		uint32_t n_channels)
+{
+	static const uint32_t n_samples[] = { 1, 3, 4, 7, 8, 15, 16, 17,
+		31, 32, 33, 63, 64, 65, 255, 256, 257 };
+	static const uint32_t offsets[] = { 0, 1, 3 };
+	const void *ip[N_CHANNELS];
+	void *op[N_CHANNELS];
+	uint32_t i, j, k;
+	struct convert conv;
+
+	spa_zero(conv);
+	conv.src_fmt = info->src_fmt;
+	conv.dst_fmt = info->dst_fmt;
+	conv.n_channels = n_channels;
+
+	for (i = 0; i < SPA_N_ELEMENTS(n_samples); i++) {
+		for (j = 0; j < SPA_N_ELEMENTS(offsets); j++) {
+			for (k = 0; k < SPA_N_ELEMENTS(offsets); k++) {
+				setup_ptrs(info->src_fmt, simd_in, n_channels, offsets[j], (void**)ip);
+
+				spa_zero(simd_out_c);
+				setup_ptrs(info->dst_fmt, simd_out_c, n_channels, offsets[k], op);
+				ref->process(&conv, op, ip, n_samples[i]);
+
+				spa_zero(simd_out);
+				setup_ptrs(info->dst_fmt, simd_out, n_channels, offsets[k], op);
+				info->process(&conv, op, ip, n_samples[i]);
+
+				/* compare everything to also catch writes past the end */
+				compare_samples(info->dst_fmt, simd_out_c, simd_out, sizeof(simd_out));
+			}
+		}
+	}
+}
+
+static void test_simd(void)
+{
+	static const uint32_t channels[] = { 1, 2, 3, 4, 5, 6, 8, 11 };
+	uint32_t cpu_flags = get_cpu_flags();
+	const struct conv_info *ref;
+	size_t i, j;
+
+	for (i = 0; i < SPA_N_ELEMENTS(conv_table); i++) {
+		const struct conv_info *info = &conv_table[i];
+
+		if (info->cpu_flags == 0)
+			continue;
+		if (!MATCH_CPU_FLAGS(info->cpu_flags, cpu_flags)) {
+			fprintf(stderr, "skip %d->%d %08x: not supported by the CPU\n",
+					info->src_fmt, info->dst_fmt, info->cpu_flags);
+			continue;
+		}
+		fprintf(stderr, "test %d->%d %08x\n", info->src_fmt, info->dst_fmt,
+				info->cpu_flags);
+
+		if (info->src_fmt == SPA_AUDIO_FORMAT_F32 || info->src_fmt == SPA_AUDIO_FORMAT_F32P) {
+			for (j = 0; j < sizeof(simd_in) / sizeof(float); j++)
+				((float*)simd_in)[j] = random_float(-1.2f, 1.2f);
+		} else {
+			for (j = 0; j < sizeof(simd_in); j++)
+				simd_in[j] = rand();
+		}
+
+		for (j = 0; j < SPA_N_ELEMENTS(channels); j++) {
+			if (!MATCH_CHAN(info->n_channels, channels[j]))
+				continue;
+			ref = find_conv_info(info->src_fmt, info->dst_fmt, channels[j], 0);
+			spa_assert(ref != NULL);
+			compare_simd(info, ref, channels[j]);
+		}
+	}
+}
+
 int main(int argc, char *argv[])
 {
 
@@ -273,5 +413,6 @@ int main(int argc, char *argv[])
 	test_s24_f32();
 	test_f32_s24_32();
 	test_s24_32_f32();
+	test_simd();
 	return 0;
 }
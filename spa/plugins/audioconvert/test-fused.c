@@ -0,0 +1,259 @@
+/* Spa
+ *
+ * Copyright © 2020 Wim Taymans
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the next
+ * paragraph) shall be included in all copies or substantial portions of the
+ * Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+#include <string.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <math.h>
+
+#include <spa/utils/defs.h>
+
+#include "fused.h"
+#include "test-helper.h"
+
+#define N_SAMPLES	4000
+#define N_CHANNELS	6
+#define POISON		12345.0f
+
+static uint8_t scratch[2][FUSED_SCRATCH_SIZE + FUSED_ALIGN];
+
+static float in[N_SAMPLES * 2];
+static float mid1[2][N_SAMPLES];
+static float mid2[N_CHANNELS][N_SAMPLES];
+static float out[N_SAMPLES * N_CHANNELS];
+static float ref[N_SAMPLES * N_CHANNELS];
+
+/* interleaved stereo to 2 planes */
+static void deinterleave(void *data, uint32_t n_dst, void * SPA_RESTRICT dst[],
+		uint32_t n_src, const void * SPA_RESTRICT src[], uint32_t n_samples)
+{
+	const float *s = src[0];
+	float **d = (float **) dst;
+	uint32_t i;
+
+	for (i = 0; i < n_samples; i++) {
+		d[0][i] = s[2*i];
+		d[1][i] = s[2*i+1] * 0.5f;
+	}
+}
+
+/* 2 planes to N_CHANNELS planes */
+static void upmix(void *data, uint32_t n_dst, void * SPA_RESTRICT dst[],
+		uint32_t n_src, const void * SPA_RESTRICT src[], uint32_t n_samples)
+{
+	const float **s = (const float **) src;
+	float **d = (float **) dst;
+	uint32_t i, c;
+
+	for (c = 0; c < n_dst; c++)
+		for (i = 0; i < n_samples; i++)
+			d[c][i] = s[c & 1][i] + c;
+}
+
+/* N_CHANNELS planes to interleaved */
+static void interleave(void *data, uint32_t n_dst, void * SPA_RESTRICT dst[],
+		uint32_t n_src, const void * SPA_RESTRICT src[], uint32_t n_samples)
+{
+	const float **s = (const float **) src;
+	float *d = dst[0];
+	uint32_t i, c;
+
+	for (i = 0; i < n_samples; i++)
+		for (c = 0; c < n_src; c++)
+			d[i * n_src + c] = s[c][i] * 2.0f;
+}
+
+static void poison(float *data, uint32_t n)
+{
+	uint32_t i;
+	for (i = 0; i < n; i++)
+		data[i] = POISON;
+}
+
+static bool is_poisoned(const float *data, uint32_t n)
+{
+	uint32_t i;
+	for (i = 0; i < n; i++)
+		if (data[i] != POISON)
+			return false;
+	return true;
+}
+
+static void init_fused(struct fused *f)
+{
+	fused_init(f, SPA_PTR_ALIGN(scratch[0], FUSED_ALIGN, void),
+			SPA_PTR_ALIGN(scratch[1], FUSED_ALIGN, void));
+}
+
+/* what the stages make of sample i of channel c, the second stage reads the
+ * planes of the first stage swapped */
+static float expected(uint32_t c, uint32_t i)
+{
+	return (c & 1 ? in[2*i] : in[2*i+1] * 0.5f) + c;
+}
+
+static void add_stages(struct fused *f, uint32_t n_samples, bool with_last)
+{
+	const void *src[N_CHANNELS];
+	void *dst[N_CHANNELS];
+	uint32_t c;
+
+	src[0] = in;
+	dst[0] = mid1[0];
+	dst[1] = mid1[1];
+	spa_assert(fused_add(f, deinterleave, NULL, 2, dst, sizeof(float),
+				1, src, 2 * sizeof(float), n_samples) == 0);
+	/* read the planes in another order than they are written */
+	src[0] = mid1[1];
+	src[1] = mid1[0];
+	for (c = 0; c < N_CHANNELS; c++)
+		dst[c] = mid2[c];
+	spa_assert(fused_add(f, upmix, NULL, N_CHANNELS, dst, sizeof(float),
+				2, src, sizeof(float), n_samples) == 0);
+	if (!with_last)
+		return;
+	for (c = 0; c < N_CHANNELS; c++)
+		src[c] = mid2[c];
+	dst[0] = out;
+	spa_assert(fused_add(f, interleave, NULL, 1, dst, N_CHANNELS * sizeof(float),
+				N_CHANNELS, src, sizeof(float), n_samples) == 0);
+}
+
+static void test_run(void)
+{
+	static const uint32_t sizes[] = { 1, 15, 16, 17, 255, 1024, N_SAMPLES };
+	struct fused f;
+	uint32_t i, j;
+
+	for (i = 0; i < N_SAMPLES * 2; i++)
+		in[i] = random_float(-1.0f, 1.0f);
+
+	init_fused(&f);
+
+	for (i = 0; i < SPA_N_ELEMENTS(sizes); i++) {
+		uint32_t n_samples = sizes[i];
+
+		for (j = 0; j < n_samples * N_CHANNELS; j++)
+			ref[j] = expected(j % N_CHANNELS, j / N_CHANNELS) * 2.0f;
+
+		poison(&mid1[0][0], 2 * N_SAMPLES);
+		poison(&mid2[0][0], N_CHANNELS * N_SAMPLES);
+		poison(out, N_SAMPLES * N_CHANNELS);
+
+		add_stages(&f, n_samples, true);
+		fused_run(&f);
+		spa_assert(f.n_stages == 0);
+
+		spa_assert(memcmp(out, ref, n_samples * N_CHANNELS * sizeof(float)) == 0);
+		spa_assert(is_poisoned(&out[n_samples * N_CHANNELS],
+					(N_SAMPLES - n_samples) * N_CHANNELS));
+		/* the samples between the stages stayed in scratch */
+		spa_assert(is_poisoned(&mid1[0][0], 2 * N_SAMPLES));
+		spa_assert(is_poisoned(&mid2[0][0], N_CHANNELS * N_SAMPLES));
+	}
+}
+
+static void test_mismatch(void)
+{
+	const void *src[1];
+	void *dst[2];
+	struct fused f;
+	uint32_t i;
+
+	init_fused(&f);
+
+	poison(&mid1[0][0], 2 * N_SAMPLES);
+	poison(&mid2[0][0], N_CHANNELS * N_SAMPLES);
+
+	src[0] = in;
+	dst[0] = mid1[0];
+	dst[1] = mid1[1];
+	spa_assert(fused_add(&f, deinterleave, NULL, 2, dst, sizeof(float),
+				1, src, 2 * sizeof(float), N_SAMPLES) == 0);
+	/* a stage that reads only one of the planes can't take them from scratch */
+	src[0] = mid1[0];
+	dst[0] = mid2[0];
+	spa_assert(fused_add(&f, upmix, NULL, 1, dst, sizeof(float),
+				1, src, sizeof(float), N_SAMPLES) == 0);
+	fused_run(&f);
+
+	for (i = 0; i < N_SAMPLES; i++) {
+		spa_assert(mid1[1][i] == in[2*i+1] * 0.5f);
+		spa_assert(mid2[0][i] == in[2*i]);
+	}
+}
+
+static void test_pull(void)
+{
+	const void *src[N_CHANNELS], *tile[N_CHANNELS];
+	uint32_t map[N_CHANNELS];
+	struct fused f;
+	uint32_t i, c, n, n_tile, pos, stop = N_SAMPLES / 3;
+
+	init_fused(&f);
+
+	poison(&mid1[0][0], 2 * N_SAMPLES);
+	poison(&mid2[0][0], N_CHANNELS * N_SAMPLES);
+
+	add_stages(&f, N_SAMPLES, false);
+
+	for (c = 0; c < N_CHANNELS; c++)
+		src[c] = mid2[N_CHANNELS - 1 - c];
+	spa_assert(fused_produces(&f, src, N_CHANNELS, sizeof(float), map));
+
+	n_tile = fused_tile(&f);
+	spa_assert(n_tile > 0 && n_tile < N_SAMPLES);
+
+	/* pull up to stop, like the resampler does when its output is full */
+	for (pos = 0; pos < stop; pos += n) {
+		n = SPA_MIN(n_tile, stop - pos);
+		fused_pull(&f, src, N_CHANNELS, sizeof(float), pos, n, tile);
+		for (c = 0; c < N_CHANNELS; c++) {
+			uint32_t ch = N_CHANNELS - 1 - c;
+			const float *t = tile[c];
+			for (i = 0; i < n; i++)
+				spa_assert(t[i] == expected(ch, pos + i));
+		}
+	}
+	spa_assert(is_poisoned(&mid2[0][0], N_CHANNELS * N_SAMPLES));
+
+	/* the rest goes to the buffers */
+	fused_run_groups(&f, 0, f.n_stages, stop, N_SAMPLES - stop);
+	fused_clear(&f);
+
+	for (c = 0; c < N_CHANNELS; c++) {
+		spa_assert(is_poisoned(&mid2[c][0], stop));
+		for (i = stop; i < N_SAMPLES; i++)
+			spa_assert(mid2[c][i] == expected(c, i));
+	}
+}
+
+int main(int argc, char *argv[])
+{
+	test_run();
+	test_mismatch();
+	test_pull();
+
+	return 0;
+}
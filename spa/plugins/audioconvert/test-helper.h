@@ -0,0 +1,66 @@
+/* Spa
+ *
+ * Copyright © 2020 Wim Taymans
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the next
+ * paragraph) shall be included in all copies or substantial portions of the
+ * Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+#ifndef TEST_HELPER_H
+#define TEST_HELPER_H
+
+#include <stdlib.h>
+
+#include <spa/support/cpu.h>
+
+/* the features of the CPU the test runs on, the tests only compare the
+ * SIMD functions that this CPU can execute */
+static inline uint32_t get_cpu_flags(void)
+{
+	uint32_t flags = 0;
+#if defined(__i386__) || defined(__x86_64__)
+	__builtin_cpu_init();
+	if (__builtin_cpu_supports("sse"))
+		flags |= SPA_CPU_FLAG_SSE;
+	if (__builtin_cpu_supports("sse2"))
+		flags |= SPA_CPU_FLAG_SSE2;
+	if (__builtin_cpu_supports("ssse3"))
+		flags |= SPA_CPU_FLAG_SSSE3;
+	if (__builtin_cpu_supports("sse4.1"))
+		flags |= SPA_CPU_FLAG_SSE41;
+	if (__builtin_cpu_supports("avx"))
+		flags |= SPA_CPU_FLAG_AVX;
+	if (__builtin_cpu_supports("avx2"))
+		flags |= SPA_CPU_FLAG_AVX2;
+	if (__builtin_cpu_supports("fma"))
+		flags |= SPA_CPU_FLAG_FMA3;
+	if (__builtin_cpu_supports("avx512f"))
+		flags |= SPA_CPU_FLAG_AVX512;
+#elif defined(__aarch64__)
+	flags |= SPA_CPU_FLAG_NEON;
+#endif
+	return flags;
+}
+
+static inline float random_float(float min, float max)
+{
+	return min + (max - min) * (rand() / (float)RAND_MAX);
+}
+
+#endif /* TEST_HELPER_H */
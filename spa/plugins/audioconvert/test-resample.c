@@ -36,6 +36,9 @@ SPA_LOG_IMPL(logger);
 
 #include "resample.h"
 #include "resample-native.h"
+#include "resample-interp.h"
+#include "resample-peaks.h"
+#include "test-helper.h"
 
 #define N_SAMPLES	253
 #define N_CHANNELS	11
@@ -69,6 +72,7 @@ static void test_native(void)
 
 	spa_zero(r);
 	r.log = &logger.log;
+	r.quality = RESAMPLE_DEFAULT_QUALITY;
 	r.channels = 1;
 	r.i_rate = 44100;
 	r.o_rate = 44100;
@@ -78,6 +82,7 @@ static void test_native(void)
 
 	spa_zero(r);
 	r.log = &logger.log;
+	r.quality = RESAMPLE_DEFAULT_QUALITY;
 	r.channels = 1;
 	r.i_rate = 44100;
 	r.o_rate = 48000;
@@ -120,6 +125,7 @@ static void test_in_len(void)
 
 	spa_zero(r);
 	r.log = &logger.log;
+	r.quality = RESAMPLE_DEFAULT_QUALITY;
 	r.channels = 1;
 	r.i_rate = 32000;
 	r.o_rate = 48000;
@@ -129,6 +135,7 @@ static void test_in_len(void)
 
 	spa_zero(r);
 	r.log = &logger.log;
+	r.quality = RESAMPLE_DEFAULT_QUALITY;
 	r.channels = 1;
 	r.i_rate = 44100;
 	r.o_rate = 48000;
@@ -138,6 +145,7 @@ static void test_in_len(void)
 
 	spa_zero(r);
 	r.log = &logger.log;
+	r.quality = RESAMPLE_DEFAULT_QUALITY;
 	r.channels = 1;
 	r.i_rate = 48000;
 	r.o_rate = 44100;
@@ -146,12 +154,229 @@ static void test_in_len(void)
 	pull_blocks(&r, 1024);
 }
 
+static void pull_dc(struct resample *r, uint32_t size)
+{
+	uint32_t i, j;
+	float in[size * 2];
+	float out[size];
+	const void *src[1];
+	void *dst[1];
+	uint32_t in_len, out_len;
+
+	for (j = 0; j < size * 2; j++)
+		in[j] = 1.0f;
+
+	src[0] = in;
+	dst[0] = out;
+
+	for (i = 0; i < 100; i++) {
+		out_len = size;
+		in_len = resample_in_len(r, out_len);
+		spa_assert(in_len <= size * 2);
+
+		resample_process(r, src, &in_len, dst, &out_len);
+		spa_assert(out_len == size);
+
+		/* skip the samples that still see the initial zero history */
+		for (j = i == 0 ? 2 * resample_delay(r) + 1 : 0; j < out_len; j++)
+			spa_assert(fabsf(out[j] - 1.0f) < 0.0001f);
+	}
+}
+
+static void test_interp(void)
+{
+	static const uint32_t rates[][2] = {
+		{ 44100, 48000 }, { 48000, 44100 }, { 32000, 48000 }, { 48000, 48000 },
+	};
+	struct resample r;
+	uint32_t i;
+
+	for (i = 0; i < SPA_N_ELEMENTS(rates); i++) {
+		spa_zero(r);
+		r.log = &logger.log;
+		r.channels = 1;
+		r.i_rate = rates[i][0];
+		r.o_rate = rates[i][1];
+		impl_interp_init(&r, false);
+		pull_dc(&r, 1024);
+		resample_free(&r);
+
+		spa_zero(r);
+		r.log = &logger.log;
+		r.channels = 1;
+		r.i_rate = rates[i][0];
+		r.o_rate = rates[i][1];
+		impl_interp_init(&r, true);
+		pull_dc(&r, 1024);
+		resample_free(&r);
+	}
+}
+
+#define N_SIMD_SAMPLES	(1024 + 16)
+
+static float simd_in[N_CHANNELS][N_SIMD_SAMPLES] SPA_ALIGNED(64);
+static float simd_out_c[N_CHANNELS][N_SIMD_SAMPLES] SPA_ALIGNED(64);
+static float simd_out[N_CHANNELS][N_SIMD_SAMPLES] SPA_ALIGNED(64);
+
+static void compare_simd(uint32_t cpu_flags, bool peaks, uint32_t channels,
+		uint32_t i_rate, uint32_t o_rate, double rate)
+{
+	static const uint32_t sizes[] = { 1, 3, 4, 7, 8, 15, 16, 17, 63, 64, 65, 256, 1000 };
+	struct resample r, ref;
+	const void *src[N_CHANNELS];
+	void *dst[N_CHANNELS];
+	uint32_t i, c, n, in_len, out_len, in_len_c, out_len_c, offset;
+
+	spa_zero(ref);
+	ref.log = &logger.log;
+	ref.quality = RESAMPLE_DEFAULT_QUALITY;
+	ref.channels = channels;
+	ref.i_rate = i_rate;
+	ref.o_rate = o_rate;
+	r = ref;
+	r.cpu_flags = cpu_flags;
+
+	if (peaks) {
+		impl_peaks_init(&ref);
+		impl_peaks_init(&r);
+	} else {
+		impl_native_init(&ref);
+		impl_native_init(&r);
+	}
+	resample_update_rate(&ref, rate);
+	resample_update_rate(&r, rate);
+
+	for (i = 0; i < SPA_N_ELEMENTS(sizes) * 4; i++) {
+		/* alternate aligned and unaligned buffers */
+		offset = i % 4;
+		out_len = sizes[i % SPA_N_ELEMENTS(sizes)];
+		in_len = peaks ? out_len : resample_in_len(&ref, out_len);
+		in_len = SPA_MIN(in_len, N_SIMD_SAMPLES - offset);
+
+		for (c = 0; c < channels; c++) {
+			for (n = 0; n < N_SIMD_SAMPLES; n++)
+				simd_in[c][n] = random_float(-1.0f, 1.0f);
+			src[c] = &simd_in[c][offset];
+		}
+
+		spa_zero(simd_out_c);
+		for (c = 0; c < channels; c++)
+			dst[c] = &simd_out_c[c][offset];
+		in_len_c = in_len;
+		out_len_c = out_len;
+		resample_process(&ref, src, &in_len_c, dst, &out_len_c);
+
+		spa_zero(simd_out);
+		for (c = 0; c < channels; c++)
+			dst[c] = &simd_out[c][offset];
+		resample_process(&r, src, &in_len, dst, &out_len);
+
+		spa_assert(in_len == in_len_c);
+		spa_assert(out_len == out_len_c);
+		for (c = 0; c < N_CHANNELS; c++)
+			for (n = 0; n < N_SIMD_SAMPLES; n++)
+				spa_assert(fabsf(simd_out_c[c][n] - simd_out[c][n]) < 1e-5f);
+	}
+	resample_free(&ref);
+	resample_free(&r);
+}
+
+static void test_simd(void)
+{
+	static const uint32_t flags[] = {
+		SPA_CPU_FLAG_SSE,
+		SPA_CPU_FLAG_SSE | SPA_CPU_FLAG_SSSE3 | SPA_CPU_FLAG_SLOW_UNALIGNED,
+		SPA_CPU_FLAG_SSE | SPA_CPU_FLAG_AVX | SPA_CPU_FLAG_FMA3,
+	};
+	static const uint32_t rates[][2] = {
+		{ 44100, 48000 }, { 48000, 44100 }, { 32000, 48000 }, { 48000, 16000 },
+	};
+	uint32_t i, j, cpu_flags = get_cpu_flags();
+
+	for (i = 0; i < SPA_N_ELEMENTS(flags); i++) {
+		uint32_t f = flags[i];
+
+		/* get_cpu_flags() only has the bits of this architecture */
+		if ((f & ~SPA_CPU_FLAG_SLOW_UNALIGNED & cpu_flags) !=
+		    (f & ~SPA_CPU_FLAG_SLOW_UNALIGNED))
+			continue;
+
+		fprintf(stderr, "test resample %08x\n", f);
+		for (j = 0; j < SPA_N_ELEMENTS(rates); j++) {
+			compare_simd(f, false, 1, rates[j][0], rates[j][1], 1.0);
+			compare_simd(f, false, 2, rates[j][0], rates[j][1], 1.0);
+			compare_simd(f, false, N_CHANNELS, rates[j][0], rates[j][1], 1.0);
+			compare_simd(f, false, 2, rates[j][0], rates[j][1], 1.01);
+		}
+		compare_simd(f, true, 2, 48000, 48000, 1.0);
+		compare_simd(f, true, N_CHANNELS, 48000, 48000, 1.0);
+	}
+}
+
+#define N_CHUNK_SAMPLES	8192
+
+static float chunk_in[N_CHUNK_SAMPLES];
+static float chunk_out[2][N_CHUNK_SAMPLES * 4];
+
+static uint32_t feed_chunks(uint32_t i_rate, uint32_t o_rate, uint32_t chunk, float *out)
+{
+	struct resample r;
+	const void *src[1];
+	void *dst[1];
+	uint32_t in_len, out_len, pos = 0, total = 0;
+
+	spa_zero(r);
+	r.log = &logger.log;
+	r.quality = RESAMPLE_DEFAULT_QUALITY;
+	r.channels = 1;
+	r.i_rate = i_rate;
+	r.o_rate = o_rate;
+	impl_native_init(&r);
+
+	while (pos < N_CHUNK_SAMPLES) {
+		in_len = SPA_MIN(chunk, N_CHUNK_SAMPLES - pos);
+		out_len = N_CHUNK_SAMPLES * 4 - total;
+		src[0] = &chunk_in[pos];
+		dst[0] = &out[total];
+		resample_process(&r, src, &in_len, dst, &out_len);
+		pos += in_len;
+		total += out_len;
+	}
+	resample_free(&r);
+	return total;
+}
+
+static void test_chunks(void)
+{
+	static const uint32_t rates[][2] = {
+		{ 44100, 48000 }, { 48000, 44100 }, { 96000, 44100 }, { 48000, 8000 },
+	};
+	static const uint32_t chunks[] = { 17, 100, 336, 1023 };
+	uint32_t i, j, n, n_ref;
+
+	for (i = 0; i < N_CHUNK_SAMPLES; i++)
+		chunk_in[i] = random_float(-1.0f, 1.0f);
+
+	/* the output must not depend on how the input is split up */
+	for (i = 0; i < SPA_N_ELEMENTS(rates); i++) {
+		n_ref = feed_chunks(rates[i][0], rates[i][1], N_CHUNK_SAMPLES, chunk_out[0]);
+		for (j = 0; j < SPA_N_ELEMENTS(chunks); j++) {
+			n = feed_chunks(rates[i][0], rates[i][1], chunks[j], chunk_out[1]);
+			spa_assert(n == n_ref);
+			spa_assert(memcmp(chunk_out[0], chunk_out[1], n * sizeof(float)) == 0);
+		}
+	}
+}
+
 int main(int argc, char *argv[])
 {
 	logger.log.level = SPA_LOG_LEVEL_TRACE;
 
 	test_native();
 	test_in_len();
+	test_interp();
+	test_simd();
+	test_chunks();
 
 	return 0;
 }
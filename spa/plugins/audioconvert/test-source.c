@@ -36,6 +36,7 @@
 #include <spa/node/utils.h>
 #include <spa/param/audio/format-utils.h>
 #include <spa/param/param.h>
+#include <spa/param/latency-utils.h>
 #include <spa/pod/filter.h>
 #include <spa/debug/types.h>
 
@@ -43,6 +44,7 @@
 
 #define DEFAULT_RATE		44100
 #define DEFAULT_CHANNELS	2
+#define DEFAULT_LATENCY		256
 
 #define MAX_SAMPLES	8192
 #define MAX_BUFFERS	32
@@ -81,6 +83,7 @@ struct port {
 	struct spa_param_info params[8];
 
 	struct spa_io_buffers *io;
+	struct spa_io_rate_match *rate_match;
 
 	struct spa_audio_info format;
 	uint32_t stride;
@@ -381,7 +384,7 @@ static int port_enum_formats(void *object,
 			SPA_FORMAT_mediaType,      SPA_POD_Id(SPA_MEDIA_TYPE_audio),
 			SPA_FORMAT_mediaSubtype,   SPA_POD_Id(SPA_MEDIA_SUBTYPE_raw),
 			SPA_FORMAT_AUDIO_format,   SPA_POD_Id(SPA_AUDIO_FORMAT_S16),
-			SPA_FORMAT_AUDIO_rate,     SPA_POD_CHOICE_RANGE_Int(DEFAULT_RATE, 1, INT32_MAX),
+			SPA_FORMAT_AUDIO_rate,     SPA_POD_Int(DEFAULT_RATE),
 			SPA_FORMAT_AUDIO_channels, SPA_POD_CHOICE_RANGE_Int(DEFAULT_CHANNELS, 1, INT32_MAX));
 		break;
 	case 1:
@@ -390,7 +393,7 @@ static int port_enum_formats(void *object,
 			SPA_FORMAT_mediaType,      SPA_POD_Id(SPA_MEDIA_TYPE_audio),
 			SPA_FORMAT_mediaSubtype,   SPA_POD_Id(SPA_MEDIA_SUBTYPE_raw),
 			SPA_FORMAT_AUDIO_format,   SPA_POD_Id(SPA_AUDIO_FORMAT_S32),
-			SPA_FORMAT_AUDIO_rate,     SPA_POD_CHOICE_RANGE_Int(DEFAULT_RATE, 1, INT32_MAX),
+			SPA_FORMAT_AUDIO_rate,     SPA_POD_Int(DEFAULT_RATE),
 			SPA_FORMAT_AUDIO_channels, SPA_POD_CHOICE_RANGE_Int(DEFAULT_CHANNELS, 1, INT32_MAX));
 		break;
 	default:
@@ -493,6 +496,21 @@ impl_node_port_enum_params(void *object, int seq,
 			return 0;
 		}
 		break;
+
+	case SPA_PARAM_Latency:
+		switch (result.index) {
+		case 0:
+		{
+			struct spa_latency_info info = SPA_LATENCY_INFO(SPA_DIRECTION_INPUT,
+					.min_rate = DEFAULT_LATENCY,
+					.max_rate = DEFAULT_LATENCY);
+			param = spa_latency_build(&b, id, &info);
+			break;
+		}
+		default:
+			return 0;
+		}
+		break;
 	default:
 		return -ENOENT;
 	}
@@ -700,6 +718,9 @@ impl_node_port_set_io(void *object,
 	case SPA_IO_Buffers:
 		port->io = data;
 		break;
+	case SPA_IO_RateMatch:
+		port->rate_match = data;
+		break;
 	default:
 		return -ENOENT;
 	}
@@ -870,8 +891,9 @@ impl_init(const struct spa_handle_factory *factory,
 	port->params[2] = SPA_PARAM_INFO(SPA_PARAM_IO, SPA_PARAM_INFO_READ);
 	port->params[3] = SPA_PARAM_INFO(SPA_PARAM_Format, SPA_PARAM_INFO_WRITE);
 	port->params[4] = SPA_PARAM_INFO(SPA_PARAM_Buffers, 0);
+	port->params[5] = SPA_PARAM_INFO(SPA_PARAM_Latency, SPA_PARAM_INFO_READ);
 	port->info.params = port->params;
-	port->info.n_params = 5;
+	port->info.n_params = 6;
 	spa_list_init(&port->queue);
 
 	return 0;
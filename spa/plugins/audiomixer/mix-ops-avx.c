@@ -109,7 +109,7 @@ static inline void mix_2(float * dst, const float * SPA_RESTRICT src, uint32_t n
 		_mm256_store_ps(&dst[n + 8], in1[1]);
 	}
 	for (; n < n_samples; n++) {
-		__m128 in1[0], in2[0];
+		__m128 in1[1], in2[1];
 		in1[0] = _mm_load_ss(&dst[n]),
 		in2[0] = _mm_load_ss(&src[n]),
 		in1[0] = _mm_add_ss(in1[0], in2[0]);
@@ -133,3 +133,51 @@ mix_f32_avx(struct mix_ops *ops, void * SPA_RESTRICT dst, const void * SPA_RESTR
 	for (; i < n_src; i++)
 		mix_2(dst, src[i], n_samples);
 }
+
+static inline void mix_2_f64(double * dst, const double * SPA_RESTRICT src, uint32_t n_samples)
+{
+	uint32_t n, unrolled;
+
+	if (SPA_IS_ALIGNED(src, 32) &&
+	    SPA_IS_ALIGNED(dst, 32))
+		unrolled = n_samples & ~7;
+	else
+		unrolled = 0;
+
+	for (n = 0; n < unrolled; n += 8) {
+		__m256d in1[2], in2[2];
+
+		in1[0] = _mm256_load_pd(&dst[n + 0]);
+		in1[1] = _mm256_load_pd(&dst[n + 4]);
+		in2[0] = _mm256_load_pd(&src[n + 0]);
+		in2[1] = _mm256_load_pd(&src[n + 4]);
+
+		in1[0] = _mm256_add_pd(in1[0], in2[0]);
+		in1[1] = _mm256_add_pd(in1[1], in2[1]);
+
+		_mm256_store_pd(&dst[n + 0], in1[0]);
+		_mm256_store_pd(&dst[n + 4], in1[1]);
+	}
+	for (; n < n_samples; n++) {
+		__m128d in1, in2;
+		in1 = _mm_load_sd(&dst[n]),
+		in2 = _mm_load_sd(&src[n]),
+		in1 = _mm_add_sd(in1, in2);
+		_mm_store_sd(&dst[n], in1);
+	}
+}
+
+void
+mix_f64_avx(struct mix_ops *ops, void * SPA_RESTRICT dst, const void * SPA_RESTRICT src[],
+		uint32_t n_src, uint32_t n_samples)
+{
+	uint32_t i;
+
+	if (n_src == 0)
+		memset(dst, 0, n_samples * sizeof(double));
+	else if (dst != src[0])
+		memcpy(dst, src[0], n_samples * sizeof(double));
+
+	for (i = 1; i < n_src; i++)
+		mix_2_f64(dst, src[i], n_samples);
+}
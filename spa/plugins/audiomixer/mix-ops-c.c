@@ -42,7 +42,12 @@ mix_f32_c(struct mix_ops *ops, void * SPA_RESTRICT dst, const void * SPA_RESTRIC
 	else if (dst != src[0])
 		memcpy(dst, src[0], n_samples * sizeof(float));
 
-	for (i = 1; i < n_src; i++) {
+	for (i = 1; i + 2 < n_src; i += 3) {
+		const float *s0 = src[i], *s1 = src[i + 1], *s2 = src[i + 2];
+		for (n = 0; n < n_samples; n++)
+			d[n] += s0[n] + s1[n] + s2[n];
+	}
+	for (; i < n_src; i++) {
 		const float *s = src[i];
 		for (n = 0; n < n_samples; n++)
 			d[n] += s[n];
@@ -0,0 +1,150 @@
+/* Spa
+ *
+ * Copyright © 2020 Wim Taymans
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the next
+ * paragraph) shall be included in all copies or substantial portions of the
+ * Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+
+#include <string.h>
+#include <stdio.h>
+#include <math.h>
+
+#include <spa/utils/defs.h>
+
+#include "mix-ops.h"
+
+#include <arm_neon.h>
+
+static inline void mix_4(float * dst,
+		const float * SPA_RESTRICT src0,
+		const float * SPA_RESTRICT src1,
+		const float * SPA_RESTRICT src2,
+		uint32_t n_samples)
+{
+	uint32_t n, unrolled = n_samples & ~7;
+
+	for (n = 0; n < unrolled; n += 8) {
+		float32x4_t in1[4], in2[4];
+
+		in1[0] = vld1q_f32(&dst[n + 0]);
+		in2[0] = vld1q_f32(&dst[n + 4]);
+		in1[1] = vld1q_f32(&src0[n + 0]);
+		in2[1] = vld1q_f32(&src0[n + 4]);
+		in1[2] = vld1q_f32(&src1[n + 0]);
+		in2[2] = vld1q_f32(&src1[n + 4]);
+		in1[3] = vld1q_f32(&src2[n + 0]);
+		in2[3] = vld1q_f32(&src2[n + 4]);
+
+		in1[0] = vaddq_f32(in1[0], in1[1]);
+		in2[0] = vaddq_f32(in2[0], in2[1]);
+		in1[2] = vaddq_f32(in1[2], in1[3]);
+		in2[2] = vaddq_f32(in2[2], in2[3]);
+
+		vst1q_f32(&dst[n + 0], vaddq_f32(in1[0], in1[2]));
+		vst1q_f32(&dst[n + 4], vaddq_f32(in2[0], in2[2]));
+	}
+	for (; n < n_samples; n++)
+		dst[n] += src0[n] + src1[n] + src2[n];
+}
+
+static inline void mix_2(float * dst, const float * SPA_RESTRICT src, uint32_t n_samples)
+{
+	uint32_t n, unrolled = n_samples & ~15;
+
+	for (n = 0; n < unrolled; n += 16) {
+		float32x4_t in1[4], in2[4];
+
+		in1[0] = vld1q_f32(&dst[n + 0]);
+		in1[1] = vld1q_f32(&dst[n + 4]);
+		in1[2] = vld1q_f32(&dst[n + 8]);
+		in1[3] = vld1q_f32(&dst[n + 12]);
+		in2[0] = vld1q_f32(&src[n + 0]);
+		in2[1] = vld1q_f32(&src[n + 4]);
+		in2[2] = vld1q_f32(&src[n + 8]);
+		in2[3] = vld1q_f32(&src[n + 12]);
+
+		vst1q_f32(&dst[n + 0], vaddq_f32(in1[0], in2[0]));
+		vst1q_f32(&dst[n + 4], vaddq_f32(in1[1], in2[1]));
+		vst1q_f32(&dst[n + 8], vaddq_f32(in1[2], in2[2]));
+		vst1q_f32(&dst[n + 12], vaddq_f32(in1[3], in2[3]));
+	}
+	for (; n < n_samples; n++)
+		dst[n] += src[n];
+}
+
+void
+mix_f32_neon(struct mix_ops *ops, void * SPA_RESTRICT dst, const void * SPA_RESTRICT src[],
+		uint32_t n_src, uint32_t n_samples)
+{
+	uint32_t i;
+
+	if (n_src == 0)
+		memset(dst, 0, n_samples * sizeof(float));
+	else if (dst != src[0])
+		memcpy(dst, src[0], n_samples * sizeof(float));
+
+	for (i = 1; i + 2 < n_src; i += 3)
+		mix_4(dst, src[i], src[i + 1], src[i + 2], n_samples);
+	for (; i < n_src; i++)
+		mix_2(dst, src[i], n_samples);
+}
+
+#if defined(__aarch64__)
+static inline void mix_2_f64(double * dst, const double * SPA_RESTRICT src, uint32_t n_samples)
+{
+	uint32_t n, unrolled = n_samples & ~7;
+
+	for (n = 0; n < unrolled; n += 8) {
+		float64x2_t in1[4], in2[4];
+
+		in1[0] = vld1q_f64(&dst[n + 0]);
+		in1[1] = vld1q_f64(&dst[n + 2]);
+		in1[2] = vld1q_f64(&dst[n + 4]);
+		in1[3] = vld1q_f64(&dst[n + 6]);
+		in2[0] = vld1q_f64(&src[n + 0]);
+		in2[1] = vld1q_f64(&src[n + 2]);
+		in2[2] = vld1q_f64(&src[n + 4]);
+		in2[3] = vld1q_f64(&src[n + 6]);
+
+		vst1q_f64(&dst[n + 0], vaddq_f64(in1[0], in2[0]));
+		vst1q_f64(&dst[n + 2], vaddq_f64(in1[1], in2[1]));
+		vst1q_f64(&dst[n + 4], vaddq_f64(in1[2], in2[2]));
+		vst1q_f64(&dst[n + 6], vaddq_f64(in1[3], in2[3]));
+	}
+	for (; n < n_samples; n++)
+		dst[n] += src[n];
+}
+
+void
+mix_f64_neon(struct mix_ops *ops, void * SPA_RESTRICT dst, const void * SPA_RESTRICT src[],
+		uint32_t n_src, uint32_t n_samples)
+{
+	uint32_t i;
+
+	if (n_src == 0)
+		memset(dst, 0, n_samples * sizeof(double));
+	else if (dst != src[0])
+		memcpy(dst, src[0], n_samples * sizeof(double));
+
+	for (i = 1; i < n_src; i++)
+		mix_2_f64(dst, src[i], n_samples);
+}
+#endif
@@ -46,6 +46,14 @@ struct mix_info {
 static struct mix_info mix_table[] =
 {
 	/* f32 */
+#if defined(HAVE_NEON)
+	{ SPA_AUDIO_FORMAT_F32, 1, SPA_CPU_FLAG_NEON, 4, mix_f32_neon },
+	{ SPA_AUDIO_FORMAT_F32P, 1, SPA_CPU_FLAG_NEON, 4, mix_f32_neon },
+#endif
+#if defined(HAVE_AVX512)
+	{ SPA_AUDIO_FORMAT_F32, 1, SPA_CPU_FLAG_AVX512, 4, mix_f32_avx512 },
+	{ SPA_AUDIO_FORMAT_F32P, 1, SPA_CPU_FLAG_AVX512, 4, mix_f32_avx512 },
+#endif
 #if defined(HAVE_AVX)
 	{ SPA_AUDIO_FORMAT_F32, 1, SPA_CPU_FLAG_AVX, 4, mix_f32_avx },
 	{ SPA_AUDIO_FORMAT_F32P, 1, SPA_CPU_FLAG_AVX, 4, mix_f32_avx },
@@ -57,6 +65,18 @@ static struct mix_info mix_table[] =
 	{ SPA_AUDIO_FORMAT_F32, 1, 0, 4, mix_f32_c },
 	{ SPA_AUDIO_FORMAT_F32P, 1, 0, 4, mix_f32_c },
 
+#if defined(HAVE_NEON) && defined(__aarch64__)
+	{ SPA_AUDIO_FORMAT_F64, 1, SPA_CPU_FLAG_NEON, 8, mix_f64_neon },
+	{ SPA_AUDIO_FORMAT_F64P, 1, SPA_CPU_FLAG_NEON, 8, mix_f64_neon },
+#endif
+#if defined(HAVE_AVX512)
+	{ SPA_AUDIO_FORMAT_F64, 1, SPA_CPU_FLAG_AVX512, 8, mix_f64_avx512 },
+	{ SPA_AUDIO_FORMAT_F64P, 1, SPA_CPU_FLAG_AVX512, 8, mix_f64_avx512 },
+#endif
+#if defined(HAVE_AVX)
+	{ SPA_AUDIO_FORMAT_F64, 1, SPA_CPU_FLAG_AVX, 8, mix_f64_avx },
+	{ SPA_AUDIO_FORMAT_F64P, 1, SPA_CPU_FLAG_AVX, 8, mix_f64_avx },
+#endif
 #if defined (HAVE_SSE2)
 	{ SPA_AUDIO_FORMAT_F64, 1, SPA_CPU_FLAG_SSE2, 8, mix_f64_sse2 },
 	{ SPA_AUDIO_FORMAT_F64P, 1, SPA_CPU_FLAG_SSE2, 8, mix_f64_sse2 },
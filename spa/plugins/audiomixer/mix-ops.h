@@ -61,4 +61,15 @@ DEFINE_FUNCTION(f64, sse2);
 #endif
 #if defined(HAVE_AVX)
 DEFINE_FUNCTION(f32, avx);
+DEFINE_FUNCTION(f64, avx);
+#endif
+#if defined(HAVE_AVX512)
+DEFINE_FUNCTION(f32, avx512);
+DEFINE_FUNCTION(f64, avx512);
+#endif
+#if defined(HAVE_NEON)
+DEFINE_FUNCTION(f32, neon);
+#if defined(__aarch64__)
+DEFINE_FUNCTION(f64, neon);
+#endif
 #endif
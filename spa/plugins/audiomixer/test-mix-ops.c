@@ -0,0 +1,159 @@
+/* Spa
+ *
+ * Copyright © 2020 Wim Taymans
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the next
+ * paragraph) shall be included in all copies or substantial portions of the
+ * Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+#include <string.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <math.h>
+
+#include <spa/support/cpu.h>
+#include <spa/utils/defs.h>
+
+#include "mix-ops.c"
+
+/* compares the SIMD mixers that this CPU can run with the C version */
+
+#define N_SRC		8
+#define N_SAMPLES	(257 + 16)
+
+static double samp_in[N_SRC][N_SAMPLES] SPA_ALIGNED(64);
+static double samp_out_c[N_SAMPLES] SPA_ALIGNED(64);
+static double samp_out[N_SAMPLES] SPA_ALIGNED(64);
+
+static uint32_t get_cpu_flags(void)
+{
+	uint32_t flags = 0;
+#if defined(__i386__) || defined(__x86_64__)
+	__builtin_cpu_init();
+	if (__builtin_cpu_supports("sse"))
+		flags |= SPA_CPU_FLAG_SSE;
+	if (__builtin_cpu_supports("sse2"))
+		flags |= SPA_CPU_FLAG_SSE2;
+	if (__builtin_cpu_supports("avx"))
+		flags |= SPA_CPU_FLAG_AVX;
+	if (__builtin_cpu_supports("avx512f"))
+		flags |= SPA_CPU_FLAG_AVX512;
+#elif defined(__aarch64__)
+	flags |= SPA_CPU_FLAG_NEON;
+#endif
+	return flags;
+}
+
+static void fill_input(uint32_t fmt)
+{
+	uint32_t i, n;
+
+	for (i = 0; i < N_SRC; i++) {
+		for (n = 0; n < N_SAMPLES; n++) {
+			double v = rand() / (double)RAND_MAX * 2.0 - 1.0;
+			if (fmt == SPA_AUDIO_FORMAT_F32 || fmt == SPA_AUDIO_FORMAT_F32P)
+				((float*)samp_in[i])[n] = v;
+			else
+				samp_in[i][n] = v;
+		}
+	}
+}
+
+static void compare_output(uint32_t stride)
+{
+	uint32_t n;
+
+	/* compare everything to also catch writes past the end */
+	for (n = 0; n < N_SAMPLES; n++) {
+		if (stride == 4)
+			spa_assert(fabsf(((float*)samp_out_c)[n] - ((float*)samp_out)[n]) < 1e-5f);
+		else
+			spa_assert(fabs(samp_out_c[n] - samp_out[n]) < 1e-12);
+	}
+}
+
+static void compare_mix(const struct mix_info *info, const struct mix_info *ref)
+{
+	static const uint32_t n_samples[] = { 1, 3, 4, 7, 8, 15, 16, 17,
+		31, 32, 33, 63, 64, 65, 255, 256, 257 };
+	struct mix_ops ops;
+	const void *src[N_SRC];
+	uint32_t i, j, k, n_src, offset;
+	uint8_t *out_c = (uint8_t*)samp_out_c, *out = (uint8_t*)samp_out;
+
+	spa_zero(ops);
+	ops.fmt = info->fmt;
+	ops.n_channels = info->n_channels;
+
+	for (n_src = 0; n_src <= N_SRC; n_src++) {
+		for (i = 0; i < SPA_N_ELEMENTS(n_samples); i++) {
+			for (j = 0; j < 4; j++) {
+				/* misalign the output and every other source */
+				offset = j * info->stride;
+				for (k = 0; k < n_src; k++)
+					src[k] = (uint8_t*)samp_in[k] + (k & 1 ? offset : 0);
+
+				spa_zero(samp_out_c);
+				ref->process(&ops, out_c + offset, src, n_src, n_samples[i]);
+				spa_zero(samp_out);
+				info->process(&ops, out + offset, src, n_src, n_samples[i]);
+				compare_output(info->stride);
+			}
+
+			if (n_src == 0)
+				continue;
+
+			/* mix in place into the first source */
+			memcpy(samp_out_c, samp_in[0], sizeof(samp_out_c));
+			memcpy(samp_out, samp_in[0], sizeof(samp_out));
+			src[0] = samp_out_c;
+			ref->process(&ops, samp_out_c, src, n_src, n_samples[i]);
+			src[0] = samp_out;
+			info->process(&ops, samp_out, src, n_src, n_samples[i]);
+			compare_output(info->stride);
+		}
+	}
+}
+
+int main(int argc, char *argv[])
+{
+	uint32_t cpu_flags = get_cpu_flags();
+	const struct mix_info *ref;
+	size_t i;
+
+	for (i = 0; i < SPA_N_ELEMENTS(mix_table); i++) {
+		const struct mix_info *info = &mix_table[i];
+
+		if (info->cpu_flags == 0)
+			continue;
+		if (!MATCH_CPU_FLAGS(info->cpu_flags, cpu_flags)) {
+			fprintf(stderr, "skip %d %08x: not supported by the CPU\n",
+					info->fmt, info->cpu_flags);
+			continue;
+		}
+		fprintf(stderr, "test %d %08x\n", info->fmt, info->cpu_flags);
+
+		ref = find_mix_info(info->fmt, info->n_channels, 0);
+		spa_assert(ref != NULL);
+
+		fill_input(info->fmt);
+		compare_mix(info, ref);
+	}
+	return 0;
+}
@@ -642,32 +642,20 @@ static int impl_node_process(void *object)
 
 	/* prepare to write into output */
 	spa_pod_builder_init(&builder, d->data, d->maxsize);
-	spa_pod_builder_push_sequence(&builder, &f, 0);
-
-	/* merge sort all sequences into output buffer */
-	while (true) {
-		struct spa_pod_control *next = NULL;
-		uint32_t next_index = 0;
-
-		for (i = 0; i < n_seq; i++) {
-			if (!spa_pod_control_is_inside(&seq[i]->body,
-					SPA_POD_BODY_SIZE(seq[i]), ctrl[i]))
-				continue;
-
-			if (next == NULL || ctrl[i]->offset < next->offset) {
-				next = ctrl[i];
-				next_index = i;
-			}
-		}
-		if (next == NULL)
-			break;
 
-		spa_pod_builder_control(&builder, next->offset, next->type);
-		spa_pod_builder_primitive(&builder, &next->value);
-
-		ctrl[next_index] = spa_pod_control_next(ctrl[next_index]);
+	if (n_seq == 1) {
+		/* nothing to merge, copy the sequence as is */
+		spa_pod_builder_raw(&builder, seq[0], SPA_POD_SIZE(seq[0]));
+	} else {
+		struct spa_pod_control *next;
+
+		spa_pod_builder_push_sequence(&builder, &f, 0);
+		/* merge sort all sequences into output buffer, the controls
+		 * are copied with their value in one go */
+		while ((next = spa_pod_sequence_merge_next(seq, ctrl, n_seq)) != NULL)
+			spa_pod_builder_raw_padded(&builder, next, SPA_POD_CONTROL_SIZE(next));
+		spa_pod_builder_pop(&builder, &f);
 	}
-	spa_pod_builder_pop(&builder, &f);
 
 	d->chunk->offset = 0;
 	d->chunk->size = builder.state.offset;
@@ -29,6 +29,10 @@
 #include <stdlib.h>
 #include <stdio.h>
 #include <pthread.h>
+#ifdef __linux__
+#include <linux/futex.h>
+#include <sys/syscall.h>
+#endif
 
 #include <spa/support/loop.h>
 #include <spa/support/system.h>
@@ -38,23 +42,33 @@
 #include <spa/utils/names.h>
 #include <spa/utils/result.h>
 #include <spa/utils/type.h>
-#include <spa/utils/ringbuffer.h>
 
 #define NAME "loop"
 
 #define DATAS_SIZE (4096 * 8)
+#define ITEM_ALIGN 8
 
 /** \cond */
 
+/* completion of a blocking invoke, lives on the stack of the caller */
+struct invoke_done {
+	uint32_t state;			/* futex word, 1 when done */
+	int res;
+};
+
 struct invoke_item {
-	size_t item_size;
+#define ITEM_FREE	0
+#define ITEM_READY	1
+#define ITEM_SKIP	2		/* padding until the end of the queue */
+	uint32_t state;
+	uint32_t item_size;		/* size in the queue, including padding */
+	struct invoke_item *next;	/* overflow list */
 	spa_invoke_func_t func;
 	uint32_t seq;
 	void *data;
 	size_t size;
-	bool block;
+	struct invoke_done *done;
 	void *user_data;
-	int res;
 };
 
 static int loop_signal_event(void *object, struct spa_source *source);
@@ -76,10 +90,18 @@ struct impl {
 	pthread_t thread;
 
 	struct spa_source *wakeup;
-	int ack_fd;
-
-	struct spa_ringbuffer buffer;
-	uint8_t buffer_data[DATAS_SIZE];
+	uint32_t wakeup_pending;
+	bool flushing;
+
+	/* multi producer, single consumer queue. Producers reserve space by
+	 * moving write_index, fill the item and then mark it ready. The loop
+	 * consumes ready items in order and clears their memory before
+	 * moving read_index. */
+	uint32_t write_index;
+	uint32_t read_index;
+	/* items that did not fit in the queue, pushed in reverse order */
+	struct invoke_item *overflow;
+	uint8_t buffer_data[DATAS_SIZE] SPA_ALIGNED(ITEM_ALIGN);
 };
 
 struct source_impl {
@@ -120,30 +142,139 @@ static int loop_remove_source(void *object, struct spa_source *source)
 	return spa_system_pollfd_del(impl->system, impl->poll_fd, source->fd);
 }
 
-static void flush_items(struct impl *impl, bool async)
+static inline void futex_wait(uint32_t *addr, uint32_t val)
+{
+#ifdef __linux__
+	syscall(SYS_futex, addr, FUTEX_WAIT_PRIVATE, val, NULL, NULL, 0);
+#else
+	sched_yield();
+#endif
+}
+
+static inline void futex_wake(uint32_t *addr, int n)
+{
+#ifdef __linux__
+	syscall(SYS_futex, addr, FUTEX_WAKE_PRIVATE, n, NULL, NULL, 0);
+#endif
+}
+
+static inline void invoke_item_run(struct impl *impl, struct invoke_item *item)
 {
-	uint32_t index;
 	int res;
 
-	while (spa_ringbuffer_get_read_index(&impl->buffer, &index) > 0) {
+	res = item->func ? item->func(&impl->loop,
+			true, item->seq, item->data, item->size,
+		   item->user_data) : 0;
+
+	if (item->done) {
+		struct invoke_done *done = item->done;
+		done->res = res;
+		__atomic_store_n(&done->state, 1, __ATOMIC_RELEASE);
+		futex_wake(&done->state, 1);
+	}
+}
+
+static bool flush_overflow(struct impl *impl)
+{
+	struct invoke_item *item, *next, *list = NULL;
+
+	item = __atomic_exchange_n(&impl->overflow, NULL, __ATOMIC_ACQUIRE);
+	if (item == NULL)
+		return false;
+
+	/* the list is in reverse order */
+	for (; item; item = next) {
+		next = item->next;
+		item->next = list;
+		list = item;
+	}
+	for (item = list; item; item = next) {
+		next = item->next;
+		invoke_item_run(impl, item);
+		free(item);
+	}
+	return true;
+}
+
+static void flush_items(struct impl *impl)
+{
+	if (impl->flushing)
+		return;
+	impl->flushing = true;
+
+	while (true) {
+		uint32_t index = impl->read_index, state, size;
 		struct invoke_item *item;
-		bool block;
 
 		item = SPA_MEMBER(impl->buffer_data, index & (DATAS_SIZE - 1), struct invoke_item);
-		block = item->block;
+		state = __atomic_load_n(&item->state, __ATOMIC_ACQUIRE);
+
+		if (state == ITEM_FREE) {
+			/* overflow items are only run when the queue is empty so
+			 * that items of one thread are run in order */
+			if (index != __atomic_load_n(&impl->write_index, __ATOMIC_ACQUIRE))
+				break;
+			if (!flush_overflow(impl))
+				break;
+			continue;
+		}
+		if (state == ITEM_READY)
+			invoke_item_run(impl, item);
+
+		/* clear the memory so that a new item is never seen as ready
+		 * before it is written */
+		size = item->item_size;
+		memset(item, 0, size);
+		__atomic_store_n(&impl->read_index, index + size, __ATOMIC_RELEASE);
+	}
+	impl->flushing = false;
+}
+
+static struct invoke_item *reserve_item(struct impl *impl, size_t size)
+{
+	uint32_t index, filled, offset, l0, need, total;
+	struct invoke_item *item;
 
-		item->res = item->func ? item->func(&impl->loop,
-				true, item->seq, item->data, item->size,
-			   item->user_data) : 0;
+	if (sizeof(struct invoke_item) + size > DATAS_SIZE / 4)
+		return NULL;
 
-		spa_ringbuffer_read_update(&impl->buffer, index + item->item_size);
+	need = SPA_ROUND_UP_N(sizeof(struct invoke_item) + size, ITEM_ALIGN);
 
-		if (block && async) {
-			if ((res = spa_system_eventfd_write(impl->system, impl->ack_fd, 1)) < 0)
-				spa_log_warn(impl->log, NAME " %p: failed to write event fd: %s",
-						impl, spa_strerror(res));
+	index = __atomic_load_n(&impl->write_index, __ATOMIC_RELAXED);
+	while (true) {
+		filled = index - __atomic_load_n(&impl->read_index, __ATOMIC_ACQUIRE);
+		if (SPA_UNLIKELY((int32_t)filled < 0)) {
+			/* the loop consumed past our stale index */
+			index = __atomic_load_n(&impl->write_index, __ATOMIC_RELAXED);
+			continue;
 		}
+		offset = index & (DATAS_SIZE - 1);
+		l0 = DATAS_SIZE - offset;
+		/* items are contiguous, skip the end of the queue if needed */
+		total = need <= l0 ? need : l0 + need;
+		if (filled + total > DATAS_SIZE)
+			return NULL;
+		if (__atomic_compare_exchange_n(&impl->write_index, &index, index + total,
+				true, __ATOMIC_ACQUIRE, __ATOMIC_RELAXED))
+			break;
 	}
+
+	if (total != need) {
+		item = SPA_MEMBER(impl->buffer_data, offset, struct invoke_item);
+		item->item_size = l0;
+		__atomic_store_n(&item->state, ITEM_SKIP, __ATOMIC_RELEASE);
+		offset = 0;
+	}
+	item = SPA_MEMBER(impl->buffer_data, offset, struct invoke_item);
+	item->item_size = need;
+	return item;
+}
+
+static inline void wakeup_loop(struct impl *impl)
+{
+	/* only the first item after the loop woke up needs to signal */
+	if (!__atomic_exchange_n(&impl->wakeup_pending, true, __ATOMIC_ACQ_REL))
+		loop_signal_event(impl, impl->wakeup);
 }
 
 static int
@@ -158,65 +289,55 @@ loop_invoke(void *object,
 	struct impl *impl = object;
 	bool in_thread = pthread_equal(impl->thread, pthread_self());
 	struct invoke_item *item;
+	struct invoke_done done = { 0, };
+	bool overflow = false;
 	int res;
 
 	if (in_thread) {
-		flush_items(impl, false);
+		flush_items(impl);
 		res = func ? func(&impl->loop, false, seq, data, size, user_data) : 0;
 	} else {
-		int32_t filled;
-		uint32_t avail, idx, offset, l0;
-
-		filled = spa_ringbuffer_get_write_index(&impl->buffer, &idx);
-		if (filled < 0 || filled > DATAS_SIZE) {
-			spa_log_warn(impl->log, NAME " %p: queue xrun %d", impl, filled);
-			return -EPIPE;
+		/* don't overtake items that are in the overflow list */
+		if (__atomic_load_n(&impl->overflow, __ATOMIC_RELAXED) == NULL)
+			item = reserve_item(impl, size);
+		else
+			item = NULL;
+
+		if (item == NULL) {
+			item = malloc(sizeof(struct invoke_item) + size);
+			if (item == NULL)
+				return -errno;
+			overflow = true;
 		}
-		avail = DATAS_SIZE - filled;
-		if (avail < sizeof(struct invoke_item)) {
-			spa_log_warn(impl->log, NAME " %p: queue full %d", impl, avail);
-			return -EPIPE;
-		}
-		offset = idx & (DATAS_SIZE - 1);
-
-		l0 = DATAS_SIZE - offset;
-
-		item = SPA_MEMBER(impl->buffer_data, offset, struct invoke_item);
 		item->func = func;
 		item->seq = seq;
+		item->data = SPA_MEMBER(item, sizeof(struct invoke_item), void);
 		item->size = size;
-		item->block = block;
+		item->done = block ? &done : NULL;
 		item->user_data = user_data;
+		memcpy(item->data, data, size);
 
-		spa_log_trace(impl->log, NAME " %p: add item %p filled:%d", impl, item, filled);
+		spa_log_trace(impl->log, NAME " %p: add item %p overflow:%d", impl, item, overflow);
 
-		if (l0 > sizeof(struct invoke_item) + size) {
-			item->data = SPA_MEMBER(item, sizeof(struct invoke_item), void);
-			item->item_size = sizeof(struct invoke_item) + size;
-			if (l0 < sizeof(struct invoke_item) + item->item_size)
-				item->item_size = l0;
+		if (overflow) {
+			item->next = __atomic_load_n(&impl->overflow, __ATOMIC_RELAXED);
+			while (!__atomic_compare_exchange_n(&impl->overflow, &item->next, item,
+						true, __ATOMIC_RELEASE, __ATOMIC_RELAXED));
 		} else {
-			item->data = impl->buffer_data;
-			item->item_size = l0 + size;
+			__atomic_store_n(&item->state, ITEM_READY, __ATOMIC_RELEASE);
 		}
-		memcpy(item->data, data, size);
 
-		spa_ringbuffer_write_update(&impl->buffer, idx + item->item_size);
-
-		loop_signal_event(impl, impl->wakeup);
+		wakeup_loop(impl);
 
 		if (block) {
-			uint64_t count = 1;
-
 			spa_loop_control_hook_before(&impl->hooks_list);
 
-			if ((res = spa_system_eventfd_read(impl->system, impl->ack_fd, &count)) < 0)
-				spa_log_warn(impl->log, NAME " %p: failed to read event fd: %s",
-						impl, spa_strerror(res));
+			while (__atomic_load_n(&done.state, __ATOMIC_ACQUIRE) == 0)
+				futex_wait(&done.state, 0);
 
 			spa_loop_control_hook_after(&impl->hooks_list);
 
-			res = item->res;
+			res = done.res;
 		}
 		else {
 			if (seq != SPA_ID_INVALID)
@@ -231,7 +352,8 @@ loop_invoke(void *object,
 static void wakeup_func(void *data, uint64_t count)
 {
 	struct impl *impl = data;
-	flush_items(impl, true);
+	__atomic_exchange_n(&impl->wakeup_pending, false, __ATOMIC_ACQ_REL);
+	flush_items(impl);
 }
 
 static int loop_get_fd(void *object)
@@ -699,7 +821,11 @@ static int impl_clear(struct spa_handle *handle)
 
 	process_destroy(impl);
 
-	spa_system_close(impl->system, impl->ack_fd);
+	while (impl->overflow) {
+		struct invoke_item *item = impl->overflow;
+		impl->overflow = item->next;
+		free(item);
+	}
 	spa_system_close(impl->system, impl->poll_fd);
 
 	return 0;
@@ -762,7 +888,9 @@ impl_init(const struct spa_handle_factory *factory,
 	spa_list_init(&impl->destroy_list);
 	spa_hook_list_init(&impl->hooks_list);
 
-	spa_ringbuffer_init(&impl->buffer);
+	impl->write_index = impl->read_index = 0;
+	impl->overflow = NULL;
+	memset(impl->buffer_data, 0, sizeof(impl->buffer_data));
 
 	impl->wakeup = loop_add_event(impl, wakeup_func, impl);
 	if (impl->wakeup == NULL) {
@@ -770,20 +898,11 @@ impl_init(const struct spa_handle_factory *factory,
 		spa_log_error(impl->log, NAME " %p: can't create wakeup event: %m", impl);
 		goto error_exit_free_poll;
 	}
-	if ((res = spa_system_eventfd_create(impl->system,
-			SPA_FD_EVENT_SEMAPHORE | SPA_FD_CLOEXEC)) < 0) {
-		spa_log_error(impl->log, NAME " %p: can't create ack event: %s",
-				impl, spa_strerror(res));
-		goto error_exit_free_wakeup;
-	}
-	impl->ack_fd = res;
 
 	spa_log_debug(impl->log, NAME " %p: initialized", impl);
 
 	return 0;
 
-error_exit_free_wakeup:
-	loop_destroy_source(impl, impl->wakeup);
 error_exit_free_poll:
 	spa_system_close(impl->system, impl->poll_fd);
 error_exit:
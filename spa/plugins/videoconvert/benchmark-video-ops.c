@@ -0,0 +1,210 @@
+/* Spa
+ *
+ * Copyright © 2020 Wim Taymans
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the next
+ * paragraph) shall be included in all copies or substantial portions of the
+ * Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+#include <string.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include <errno.h>
+#include <time.h>
+
+#include <spa/support/cpu.h>
+
+#include "video-ops.c"
+
+struct stats {
+	uint32_t width;
+	uint32_t height;
+	uint64_t perf;
+	const char *name;
+	const char *impl;
+};
+
+#define MAX_WIDTH	3840
+#define MAX_HEIGHT	2160
+#define MAX_SIZE	(MAX_WIDTH * MAX_HEIGHT * 4 + 4096)
+
+#define MAX_COUNT	20
+
+static uint8_t frame_in[MAX_SIZE] SPA_ALIGNED(64);
+static uint8_t frame_out[MAX_SIZE] SPA_ALIGNED(64);
+
+static const uint32_t frame_sizes[][2] = { { 1920, 1080 }, { 3840, 2160 } };
+
+#define MAX_RESULTS	SPA_N_ELEMENTS(frame_sizes) * 256
+
+static uint32_t n_results = 0;
+static struct stats results[MAX_RESULTS];
+
+static void make_frame(struct video_frame *frame, uint8_t *data,
+		uint32_t format, uint32_t width, uint32_t height)
+{
+	uint32_t i, offsets[VIDEO_MAX_PLANES];
+
+	video_layout(format, width, height, 0, offsets, frame->stride);
+	for (i = 0; i < VIDEO_MAX_PLANES; i++)
+		frame->data[i] = data + offsets[i];
+}
+
+static void run_test1(const char *name, const char *impl, uint32_t cpu_flags,
+		uint32_t src_fmt, uint32_t src_width, uint32_t src_height,
+		uint32_t dst_fmt, uint32_t dst_width, uint32_t dst_height)
+{
+	int i;
+	struct timespec ts;
+	uint64_t count, t1, t2;
+	struct convert conv;
+	struct video_frame src, dst;
+
+	spa_zero(conv);
+	conv.src_fmt = src_fmt;
+	conv.dst_fmt = dst_fmt;
+	conv.src_width = src_width;
+	conv.src_height = src_height;
+	conv.dst_width = dst_width;
+	conv.dst_height = dst_height;
+	conv.matrix = SPA_VIDEO_COLOR_MATRIX_BT709;
+	conv.n_slices = 1;
+	conv.cpu_flags = cpu_flags;
+	if (convert_init(&conv) < 0)
+		return;
+
+	make_frame(&src, frame_in, src_fmt, src_width, src_height);
+	make_frame(&dst, frame_out, dst_fmt, dst_width, dst_height);
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	t1 = SPA_TIMESPEC_TO_NSEC(&ts);
+
+	count = 0;
+	for (i = 0; i < MAX_COUNT; i++) {
+		convert_process(&conv, &dst, &src);
+		count++;
+	}
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	t2 = SPA_TIMESPEC_TO_NSEC(&ts);
+
+	convert_free(&conv);
+
+	spa_assert(n_results < MAX_RESULTS);
+
+	results[n_results++] = (struct stats) {
+		.width = dst_width,
+		.height = dst_height,
+		.perf = count * (uint64_t)SPA_NSEC_PER_SEC / (t2 - t1),
+		.name = name,
+		.impl = impl
+	};
+}
+
+static void run_test(const char *name, uint32_t src_fmt, uint32_t dst_fmt)
+{
+	size_t i;
+
+	for (i = 0; i < SPA_N_ELEMENTS(frame_sizes); i++) {
+		uint32_t w = frame_sizes[i][0], h = frame_sizes[i][1];
+
+		run_test1(name, "c", 0, src_fmt, w, h, dst_fmt, w, h);
+#if defined (HAVE_SSE2)
+		run_test1(name, "sse2", SPA_CPU_FLAG_SSE2, src_fmt, w, h, dst_fmt, w, h);
+#endif
+#if defined (HAVE_AVX2)
+		run_test1(name, "avx2", SPA_CPU_FLAG_SSE2 | SPA_CPU_FLAG_AVX2,
+				src_fmt, w, h, dst_fmt, w, h);
+#endif
+	}
+}
+
+static void run_scale(const char *name, uint32_t format, uint32_t src_width, uint32_t src_height,
+		uint32_t dst_width, uint32_t dst_height)
+{
+	run_test1(name, "c", 0, format, src_width, src_height, format, dst_width, dst_height);
+#if defined (HAVE_SSE2)
+	run_test1(name, "sse2", SPA_CPU_FLAG_SSE2,
+			format, src_width, src_height, format, dst_width, dst_height);
+#endif
+#if defined (HAVE_AVX2)
+	run_test1(name, "avx2", SPA_CPU_FLAG_SSE2 | SPA_CPU_FLAG_AVX2,
+			format, src_width, src_height, format, dst_width, dst_height);
+#endif
+}
+
+static void test_packed_420(void)
+{
+	run_test("test_yuy2_i420", SPA_VIDEO_FORMAT_YUY2, SPA_VIDEO_FORMAT_I420);
+	run_test("test_uyvy_nv12", SPA_VIDEO_FORMAT_UYVY, SPA_VIDEO_FORMAT_NV12);
+	run_test("test_i420_yuy2", SPA_VIDEO_FORMAT_I420, SPA_VIDEO_FORMAT_YUY2);
+	run_test("test_nv12_uyvy", SPA_VIDEO_FORMAT_NV12, SPA_VIDEO_FORMAT_UYVY);
+	run_test("test_i420_nv12", SPA_VIDEO_FORMAT_I420, SPA_VIDEO_FORMAT_NV12);
+	run_test("test_nv12_i420", SPA_VIDEO_FORMAT_NV12, SPA_VIDEO_FORMAT_I420);
+	run_test("test_yuy2_uyvy", SPA_VIDEO_FORMAT_YUY2, SPA_VIDEO_FORMAT_UYVY);
+}
+
+static void test_yuv_rgb(void)
+{
+	run_test("test_i420_rgbx", SPA_VIDEO_FORMAT_I420, SPA_VIDEO_FORMAT_RGBx);
+	run_test("test_nv12_bgrx", SPA_VIDEO_FORMAT_NV12, SPA_VIDEO_FORMAT_BGRx);
+	run_test("test_yuy2_bgrx", SPA_VIDEO_FORMAT_YUY2, SPA_VIDEO_FORMAT_BGRx);
+	run_test("test_rgbx_i420", SPA_VIDEO_FORMAT_RGBx, SPA_VIDEO_FORMAT_I420);
+	run_test("test_bgrx_nv12", SPA_VIDEO_FORMAT_BGRx, SPA_VIDEO_FORMAT_NV12);
+	run_test("test_rgbx_yuy2", SPA_VIDEO_FORMAT_RGBx, SPA_VIDEO_FORMAT_YUY2);
+	run_test("test_rgbx_bgrx", SPA_VIDEO_FORMAT_RGBx, SPA_VIDEO_FORMAT_BGRx);
+}
+
+static void test_scale(void)
+{
+	run_scale("test_scale_i420_down", SPA_VIDEO_FORMAT_I420, 3840, 2160, 1920, 1080);
+	run_scale("test_scale_i420_up", SPA_VIDEO_FORMAT_I420, 1280, 720, 1920, 1080);
+	run_scale("test_scale_i420_up", SPA_VIDEO_FORMAT_I420, 1920, 1080, 3840, 2160);
+	run_scale("test_scale_yuy2_down", SPA_VIDEO_FORMAT_YUY2, 1920, 1080, 1280, 720);
+	run_scale("test_scale_rgbx_down", SPA_VIDEO_FORMAT_RGBx, 3840, 2160, 1920, 1080);
+}
+
+static int compare_func(const void *_a, const void *_b)
+{
+	const struct stats *a = _a, *b = _b;
+	int diff;
+	if ((diff = strcmp(a->name, b->name)) != 0) return diff;
+	if ((diff = a->width - b->width) != 0) return diff;
+	if ((diff = a->height - b->height) != 0) return diff;
+	if ((diff = b->perf - a->perf) != 0) return diff;
+	return 0;
+}
+
+int main(int argc, char *argv[])
+{
+	uint32_t i;
+
+	test_packed_420();
+	test_yuv_rgb();
+	test_scale();
+
+	qsort(results, n_results, sizeof(struct stats), compare_func);
+
+	for (i = 0; i < n_results; i++) {
+		struct stats *s = &results[i];
+		fprintf(stderr, "%-12."PRIu64" \t%-32.32s %s \t frames/sec %dx%d\n",
+				s->perf, s->name, s->impl, s->width, s->height);
+	}
+	return 0;
+}
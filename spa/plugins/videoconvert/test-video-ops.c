@@ -0,0 +1,311 @@
+/* Spa
+ *
+ * Copyright © 2020 Wim Taymans
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the next
+ * paragraph) shall be included in all copies or substantial portions of the
+ * Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+#include <string.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include <errno.h>
+#include <time.h>
+
+#include <spa/support/cpu.h>
+
+#include "video-ops.c"
+
+#define MAX_WIDTH	640
+#define MAX_HEIGHT	64
+#define MAX_SIZE	(MAX_WIDTH * MAX_HEIGHT * 4 + 1024)
+
+static uint8_t frame_in[MAX_SIZE];
+static uint8_t frame_ref[MAX_SIZE];
+static uint8_t frame_out[MAX_SIZE];
+
+static const uint32_t formats[] = {
+	SPA_VIDEO_FORMAT_YUY2,
+	SPA_VIDEO_FORMAT_UYVY,
+	SPA_VIDEO_FORMAT_I420,
+	SPA_VIDEO_FORMAT_NV12,
+	SPA_VIDEO_FORMAT_RGBx,
+	SPA_VIDEO_FORMAT_BGRx,
+};
+
+static const uint32_t cpu_flags[] = {
+#if defined (HAVE_SSE2)
+	SPA_CPU_FLAG_SSE2,
+#endif
+#if defined (HAVE_AVX2)
+	SPA_CPU_FLAG_SSE2 | SPA_CPU_FLAG_AVX2,
+#endif
+};
+
+static uint32_t make_frame(struct video_frame *frame, uint8_t *data,
+		uint32_t format, uint32_t width, uint32_t height)
+{
+	uint32_t i, size, offsets[VIDEO_MAX_PLANES];
+
+	size = video_layout(format, width, height, 0, offsets, frame->stride);
+	spa_assert(size > 0 && size <= MAX_SIZE);
+	for (i = 0; i < VIDEO_MAX_PLANES; i++)
+		frame->data[i] = data + offsets[i];
+	return size;
+}
+
+static void fill_random(uint8_t *data, uint32_t size)
+{
+	uint32_t i, seed = 0x1234567;
+	for (i = 0; i < size; i++) {
+		seed = seed * 1103515245 + 12345;
+		data[i] = seed >> 16;
+	}
+}
+
+static uint32_t run_convert(uint8_t *out, uint32_t src_fmt, uint32_t src_width, uint32_t src_height,
+		uint32_t dst_fmt, uint32_t dst_width, uint32_t dst_height,
+		uint32_t scale, uint32_t n_slices, uint32_t flags)
+{
+	struct convert conv;
+	struct video_frame src, dst;
+	uint32_t size;
+
+	spa_zero(conv);
+	conv.src_fmt = src_fmt;
+	conv.dst_fmt = dst_fmt;
+	conv.src_width = src_width;
+	conv.src_height = src_height;
+	conv.dst_width = dst_width;
+	conv.dst_height = dst_height;
+	conv.matrix = SPA_VIDEO_COLOR_MATRIX_BT601;
+	conv.scale = scale;
+	conv.n_slices = n_slices;
+	conv.cpu_flags = flags;
+	spa_assert(convert_init(&conv) == 0);
+
+	make_frame(&src, frame_in, src_fmt, src_width, src_height);
+	size = make_frame(&dst, out, dst_fmt, dst_width, dst_height);
+	memset(out, 0, size);
+
+	convert_process(&conv, &dst, &src);
+	convert_free(&conv);
+
+	return size;
+}
+
+static void test_simd(uint32_t width, uint32_t height)
+{
+	size_t i, j, k;
+	uint32_t size;
+
+	fill_random(frame_in, sizeof(frame_in));
+
+	for (i = 0; i < SPA_N_ELEMENTS(formats); i++) {
+		for (j = 0; j < SPA_N_ELEMENTS(formats); j++) {
+			size = run_convert(frame_ref, formats[i], width, height,
+					formats[j], width, height, VIDEO_SCALE_AUTO, 1, 0);
+			for (k = 0; k < SPA_N_ELEMENTS(cpu_flags); k++) {
+				run_convert(frame_out, formats[i], width, height,
+					formats[j], width, height, VIDEO_SCALE_AUTO, 1, cpu_flags[k]);
+				spa_assert(memcmp(frame_ref, frame_out, size) == 0);
+			}
+		}
+	}
+}
+
+static void test_slices(void)
+{
+	size_t i, j;
+	uint32_t size, n_slices;
+
+	fill_random(frame_in, sizeof(frame_in));
+
+	for (i = 0; i < SPA_N_ELEMENTS(formats); i++) {
+		for (j = 0; j < SPA_N_ELEMENTS(formats); j++) {
+			size = run_convert(frame_ref, formats[i], 320, 61,
+					formats[j], 203, 47, VIDEO_SCALE_AUTO, 1, 0);
+			for (n_slices = 2; n_slices <= 5; n_slices++) {
+				run_convert(frame_out, formats[i], 320, 61,
+						formats[j], 203, 47, VIDEO_SCALE_AUTO, n_slices, 0);
+				spa_assert(memcmp(frame_ref, frame_out, size) == 0);
+			}
+		}
+	}
+}
+
+static void test_scale_simd(void)
+{
+	static const uint32_t sizes[][4] = {
+		{ 640, 48, 320, 24 },
+		{ 320, 24, 640, 48 },
+		{ 333, 31, 201, 57 },
+	};
+	size_t i, j, k;
+	uint32_t size;
+
+	fill_random(frame_in, sizeof(frame_in));
+
+	for (i = 0; i < SPA_N_ELEMENTS(sizes); i++) {
+		for (j = 0; j < SPA_N_ELEMENTS(formats); j++) {
+			size = run_convert(frame_ref, formats[j], sizes[i][0], sizes[i][1],
+					SPA_VIDEO_FORMAT_I420, sizes[i][2], sizes[i][3],
+					VIDEO_SCALE_BILINEAR, 1, 0);
+			for (k = 0; k < SPA_N_ELEMENTS(cpu_flags); k++) {
+				run_convert(frame_out, formats[j], sizes[i][0], sizes[i][1],
+					SPA_VIDEO_FORMAT_I420, sizes[i][2], sizes[i][3],
+					VIDEO_SCALE_BILINEAR, 1, cpu_flags[k]);
+				spa_assert(memcmp(frame_ref, frame_out, size) == 0);
+			}
+		}
+	}
+}
+
+static void fill_color(uint32_t format, uint32_t width, uint32_t height,
+		uint8_t y, uint8_t u, uint8_t v)
+{
+	struct video_frame f;
+	uint32_t i, j;
+
+	make_frame(&f, frame_in, format, width, height);
+
+	for (i = 0; i < height; i++) {
+		uint8_t *p0 = SPA_MEMBER(f.data[0], i * f.stride[0], uint8_t);
+		uint8_t *p1 = SPA_MEMBER(f.data[1], (i / 2) * f.stride[1], uint8_t);
+		uint8_t *p2 = SPA_MEMBER(f.data[2], (i / 2) * f.stride[2], uint8_t);
+
+		for (j = 0; j < width; j++) {
+			switch (format) {
+			case SPA_VIDEO_FORMAT_I420:
+				p0[j] = y;
+				p1[j / 2] = u;
+				p2[j / 2] = v;
+				break;
+			case SPA_VIDEO_FORMAT_NV12:
+				p0[j] = y;
+				p1[(j / 2) * 2] = u;
+				p1[(j / 2) * 2 + 1] = v;
+				break;
+			case SPA_VIDEO_FORMAT_YUY2:
+				p0[j * 2] = y;
+				p0[(j / 2) * 4 + 1] = u;
+				p0[(j / 2) * 4 + 3] = v;
+				break;
+			}
+		}
+	}
+}
+
+static void check_rgbx(uint32_t width, uint32_t height, uint8_t r, uint8_t g, uint8_t b)
+{
+	struct video_frame f;
+	uint32_t i, j;
+
+	make_frame(&f, frame_out, SPA_VIDEO_FORMAT_RGBx, width, height);
+
+	for (i = 0; i < height; i++) {
+		uint8_t *p = SPA_MEMBER(f.data[0], i * f.stride[0], uint8_t);
+		for (j = 0; j < width; j++) {
+			spa_assert(p[j * 4 + 0] == r);
+			spa_assert(p[j * 4 + 1] == g);
+			spa_assert(p[j * 4 + 2] == b);
+		}
+	}
+}
+
+static void test_colors(void)
+{
+	static const uint32_t yuv[] = {
+		SPA_VIDEO_FORMAT_I420,
+		SPA_VIDEO_FORMAT_NV12,
+		SPA_VIDEO_FORMAT_YUY2,
+	};
+	size_t i, k;
+
+	for (i = 0; i < SPA_N_ELEMENTS(yuv); i++) {
+		for (k = 0; k <= SPA_N_ELEMENTS(cpu_flags); k++) {
+			uint32_t flags = k == 0 ? 0 : cpu_flags[k - 1];
+
+			fill_color(yuv[i], 67, 9, 235, 128, 128);
+			run_convert(frame_out, yuv[i], 67, 9,
+					SPA_VIDEO_FORMAT_RGBx, 67, 9, VIDEO_SCALE_AUTO, 1, flags);
+			check_rgbx(67, 9, 255, 255, 255);
+
+			fill_color(yuv[i], 67, 9, 16, 128, 128);
+			run_convert(frame_out, yuv[i], 67, 9,
+					SPA_VIDEO_FORMAT_RGBx, 67, 9, VIDEO_SCALE_AUTO, 1, flags);
+			check_rgbx(67, 9, 0, 0, 0);
+
+			/* scaling a flat frame keeps the color */
+			fill_color(yuv[i], 67, 9, 126, 128, 128);
+			run_convert(frame_out, yuv[i], 67, 9,
+					SPA_VIDEO_FORMAT_RGBx, 131, 21, VIDEO_SCALE_BILINEAR, 1, flags);
+			check_rgbx(131, 21, 128, 128, 128);
+			run_convert(frame_out, yuv[i], 67, 9,
+					SPA_VIDEO_FORMAT_RGBx, 31, 5, VIDEO_SCALE_AREA, 1, flags);
+			check_rgbx(31, 5, 128, 128, 128);
+		}
+	}
+}
+
+static void test_roundtrip(void)
+{
+	struct video_frame f;
+	uint32_t i, j, width = 64, height = 16;
+	uint8_t *in, *out;
+
+	/* a gray ramp survives RGB -> I420 -> RGB within rounding */
+	make_frame(&f, frame_in, SPA_VIDEO_FORMAT_RGBx, width, height);
+	for (i = 0; i < height; i++) {
+		in = SPA_MEMBER(f.data[0], i * f.stride[0], uint8_t);
+		for (j = 0; j < width; j++) {
+			in[j * 4 + 0] = in[j * 4 + 1] = in[j * 4 + 2] = j * 4;
+			in[j * 4 + 3] = 0xff;
+		}
+	}
+	run_convert(frame_ref, SPA_VIDEO_FORMAT_RGBx, width, height,
+			SPA_VIDEO_FORMAT_I420, width, height, VIDEO_SCALE_AUTO, 1, 0);
+	memcpy(frame_in, frame_ref, sizeof(frame_ref));
+	run_convert(frame_out, SPA_VIDEO_FORMAT_I420, width, height,
+			SPA_VIDEO_FORMAT_RGBx, width, height, VIDEO_SCALE_AUTO, 1, 0);
+
+	make_frame(&f, frame_out, SPA_VIDEO_FORMAT_RGBx, width, height);
+	for (i = 0; i < height; i++) {
+		out = SPA_MEMBER(f.data[0], i * f.stride[0], uint8_t);
+		for (j = 0; j < width; j++) {
+			spa_assert(abs((int)out[j * 4 + 0] - (int)(j * 4)) <= 2);
+			spa_assert(abs((int)out[j * 4 + 1] - (int)(j * 4)) <= 2);
+			spa_assert(abs((int)out[j * 4 + 2] - (int)(j * 4)) <= 2);
+		}
+	}
+}
+
+int main(int argc, char *argv[])
+{
+	test_simd(7, 3);
+	test_simd(64, 16);
+	test_simd(253, 37);
+	test_slices();
+	test_scale_simd();
+	test_colors();
+	test_roundtrip();
+
+	return 0;
+}
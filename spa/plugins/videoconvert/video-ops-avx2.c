@@ -0,0 +1,242 @@
+/* Spa
+ *
+ * Copyright © 2020 Wim Taymans
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the next
+ * paragraph) shall be included in all copies or substantial portions of the
+ * Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+#include <string.h>
+
+#include "video-ops.h"
+
+#include <immintrin.h>
+
+static inline void
+packed_to_420_avx2(struct convert *conv, void * SPA_RESTRICT dst[],
+		const void * SPA_RESTRICT src[], uint32_t width, bool uyvy, bool nv12)
+{
+	const uint8_t *s0 = src[0], *s1 = src[1];
+	uint8_t *y0 = dst[0], *y1 = dst[1], *u = dst[2], *v = nv12 ? NULL : dst[3];
+	uint32_t n, unrolled = width & ~31;
+	__m256i mask = _mm256_set1_epi16(0x00ff);
+	__m256i a0, a1, b0, b1, c0, c1, uv;
+
+#define LUMA(x)		(uyvy ? _mm256_srli_epi16(x, 8) : _mm256_and_si256(x, mask))
+#define CHROMA(x)	(uyvy ? _mm256_and_si256(x, mask) : _mm256_srli_epi16(x, 8))
+/* packus works per 128 bit lane, put the quadwords back in order */
+#define PACK(a,b)	_mm256_permute4x64_epi64(_mm256_packus_epi16(a, b), _MM_SHUFFLE(3, 1, 2, 0))
+	for (n = 0; n < unrolled; n += 32) {
+		a0 = _mm256_loadu_si256((__m256i*)(s0 + 2*n));
+		a1 = _mm256_loadu_si256((__m256i*)(s0 + 2*n + 32));
+		b0 = _mm256_loadu_si256((__m256i*)(s1 + 2*n));
+		b1 = _mm256_loadu_si256((__m256i*)(s1 + 2*n + 32));
+
+		_mm256_storeu_si256((__m256i*)(y0 + n), PACK(LUMA(a0), LUMA(a1)));
+		_mm256_storeu_si256((__m256i*)(y1 + n), PACK(LUMA(b0), LUMA(b1)));
+
+		c0 = PACK(CHROMA(a0), CHROMA(a1));
+		c1 = PACK(CHROMA(b0), CHROMA(b1));
+		uv = _mm256_avg_epu8(c0, c1);
+
+		if (nv12) {
+			_mm256_storeu_si256((__m256i*)(u + n), uv);
+		} else {
+			uv = PACK(_mm256_and_si256(uv, mask), _mm256_srli_epi16(uv, 8));
+			_mm_storeu_si128((__m128i*)(u + n/2), _mm256_castsi256_si128(uv));
+			_mm_storeu_si128((__m128i*)(v + n/2), _mm256_extracti128_si256(uv, 1));
+		}
+	}
+#undef LUMA
+#undef CHROMA
+#undef PACK
+	if (n < width) {
+		const void *s[2] = { s0 + 2*n, s1 + 2*n };
+		void *d[4] = { y0 + n, y1 + n, u + (nv12 ? n : n/2), nv12 ? NULL : v + n/2 };
+		if (uyvy)
+			nv12 ? conv_uyvy_to_nv12_c(conv, d, s, width - n) :
+				conv_uyvy_to_i420_c(conv, d, s, width - n);
+		else
+			nv12 ? conv_yuy2_to_nv12_c(conv, d, s, width - n) :
+				conv_yuy2_to_i420_c(conv, d, s, width - n);
+	}
+}
+
+DEFINE_FUNCTION(yuy2_to_i420, avx2)
+{
+	packed_to_420_avx2(conv, dst, src, width, false, false);
+}
+
+DEFINE_FUNCTION(uyvy_to_i420, avx2)
+{
+	packed_to_420_avx2(conv, dst, src, width, true, false);
+}
+
+DEFINE_FUNCTION(yuy2_to_nv12, avx2)
+{
+	packed_to_420_avx2(conv, dst, src, width, false, true);
+}
+
+DEFINE_FUNCTION(uyvy_to_nv12, avx2)
+{
+	packed_to_420_avx2(conv, dst, src, width, true, true);
+}
+
+static inline void
+yuv420_to_rgb_avx2(struct convert *conv, void * SPA_RESTRICT dst[],
+		const void * SPA_RESTRICT src[], uint32_t width, bool nv12, bool bgr)
+{
+	const uint8_t *y = src[0], *u = src[1], *v = nv12 ? NULL : src[2];
+	uint8_t *d = dst[0];
+	uint32_t n, unrolled = width & ~15;
+	__m128i zero = _mm_setzero_si128(), mask = _mm_set1_epi16(0x00ff), cu, cv;
+	__m256i y_bu = _mm256_set1_epi32((uint16_t)conv->to_rgb.y | ((uint32_t)(uint16_t)conv->to_rgb.bu << 16));
+	__m256i y_gu = _mm256_set1_epi32((uint16_t)conv->to_rgb.y | ((uint32_t)(uint16_t)conv->to_rgb.gu << 16));
+	__m256i y_rv = _mm256_set1_epi32((uint16_t)conv->to_rgb.y | ((uint32_t)(uint16_t)conv->to_rgb.rv << 16));
+	__m256i gv_round = _mm256_set1_epi32((uint16_t)conv->to_rgb.gv | (1u << (YUV_SHIFT - 1 + 16)));
+	__m256i round = _mm256_set1_epi32(1 << (YUV_SHIFT - 1));
+	__m256i one = _mm256_set1_epi16(1), ff = _mm256_set1_epi8(-1);
+	__m256i y_off = _mm256_set1_epi16(16), c_off = _mm256_set1_epi16(128);
+	__m256i yy, uu, vv, yu, yv, v1, r[2], g[2], b[2], t0, t1, lo, hi;
+	uint32_t i;
+
+	for (n = 0; n < unrolled; n += 16) {
+		if (nv12) {
+			__m128i uv = _mm_loadu_si128((__m128i*)(u + n));
+			cu = _mm_and_si128(uv, mask);
+			cv = _mm_srli_epi16(uv, 8);
+		} else {
+			cu = _mm_unpacklo_epi8(_mm_loadl_epi64((__m128i*)(u + n/2)), zero);
+			cv = _mm_unpacklo_epi8(_mm_loadl_epi64((__m128i*)(v + n/2)), zero);
+		}
+		yy = _mm256_cvtepu8_epi16(_mm_loadu_si128((__m128i*)(y + n)));
+		uu = _mm256_set_m128i(_mm_unpackhi_epi16(cu, cu), _mm_unpacklo_epi16(cu, cu));
+		vv = _mm256_set_m128i(_mm_unpackhi_epi16(cv, cv), _mm_unpacklo_epi16(cv, cv));
+
+		yy = _mm256_sub_epi16(yy, y_off);
+		uu = _mm256_sub_epi16(uu, c_off);
+		vv = _mm256_sub_epi16(vv, c_off);
+
+		/* unpack and pack both work per lane so the pixels stay in order */
+		for (i = 0; i < 2; i++) {
+			if (i == 0) {
+				yu = _mm256_unpacklo_epi16(yy, uu);
+				yv = _mm256_unpacklo_epi16(yy, vv);
+				v1 = _mm256_unpacklo_epi16(vv, one);
+			} else {
+				yu = _mm256_unpackhi_epi16(yy, uu);
+				yv = _mm256_unpackhi_epi16(yy, vv);
+				v1 = _mm256_unpackhi_epi16(vv, one);
+			}
+			b[i] = _mm256_srai_epi32(_mm256_add_epi32(
+					_mm256_madd_epi16(yu, y_bu), round), YUV_SHIFT);
+			g[i] = _mm256_srai_epi32(_mm256_add_epi32(_mm256_madd_epi16(yu, y_gu),
+					_mm256_madd_epi16(v1, gv_round)), YUV_SHIFT);
+			r[i] = _mm256_srai_epi32(_mm256_add_epi32(
+					_mm256_madd_epi16(yv, y_rv), round), YUV_SHIFT);
+		}
+		r[0] = _mm256_packs_epi32(r[0], r[1]);
+		g[0] = _mm256_packs_epi32(g[0], g[1]);
+		b[0] = _mm256_packs_epi32(b[0], b[1]);
+		if (bgr) {
+			t0 = r[0];
+			r[0] = b[0];
+			b[0] = t0;
+		}
+		r[0] = _mm256_packus_epi16(r[0], r[0]);
+		g[0] = _mm256_packus_epi16(g[0], g[0]);
+		b[0] = _mm256_packus_epi16(b[0], b[0]);
+
+		t0 = _mm256_unpacklo_epi8(r[0], g[0]);
+		t1 = _mm256_unpacklo_epi8(b[0], ff);
+		lo = _mm256_unpacklo_epi16(t0, t1);
+		hi = _mm256_unpackhi_epi16(t0, t1);
+		_mm256_storeu_si256((__m256i*)(d + 4*n), _mm256_permute2x128_si256(lo, hi, 0x20));
+		_mm256_storeu_si256((__m256i*)(d + 4*n + 32), _mm256_permute2x128_si256(lo, hi, 0x31));
+	}
+	if (n < width) {
+		const void *s[3] = { y + n, u + (nv12 ? n : n/2), nv12 ? NULL : v + n/2 };
+		void *dd[1] = { d + 4*n };
+		if (nv12)
+			bgr ? conv_nv12_to_bgrx_c(conv, dd, s, width - n) :
+				conv_nv12_to_rgbx_c(conv, dd, s, width - n);
+		else
+			bgr ? conv_i420_to_bgrx_c(conv, dd, s, width - n) :
+				conv_i420_to_rgbx_c(conv, dd, s, width - n);
+	}
+}
+
+DEFINE_FUNCTION(i420_to_rgbx, avx2)
+{
+	yuv420_to_rgb_avx2(conv, dst, src, width, false, false);
+}
+
+DEFINE_FUNCTION(i420_to_bgrx, avx2)
+{
+	yuv420_to_rgb_avx2(conv, dst, src, width, false, true);
+}
+
+DEFINE_FUNCTION(nv12_to_rgbx, avx2)
+{
+	yuv420_to_rgb_avx2(conv, dst, src, width, true, false);
+}
+
+DEFINE_FUNCTION(nv12_to_bgrx, avx2)
+{
+	yuv420_to_rgb_avx2(conv, dst, src, width, true, true);
+}
+
+DEFINE_FUNCTION(swap_rb, avx2)
+{
+	const uint8_t *s = src[0];
+	uint8_t *d = dst[0];
+	uint32_t n, unrolled = width & ~7;
+	__m256i shuf = _mm256_setr_epi8(
+			2, 1, 0, 3, 6, 5, 4, 7, 10, 9, 8, 11, 14, 13, 12, 15,
+			2, 1, 0, 3, 6, 5, 4, 7, 10, 9, 8, 11, 14, 13, 12, 15);
+
+	for (n = 0; n < unrolled; n += 8) {
+		__m256i p = _mm256_loadu_si256((__m256i*)(s + 4*n));
+		_mm256_storeu_si256((__m256i*)(d + 4*n), _mm256_shuffle_epi8(p, shuf));
+	}
+	if (n < width) {
+		const void *ss[1] = { s + 4*n };
+		void *dd[1] = { d + 4*n };
+		conv_swap_rb_c(conv, dd, ss, width - n);
+	}
+}
+
+DEFINE_VSCALE(bilinear, avx2)
+{
+	const uint8_t *s0 = src[0], *s1 = src[1];
+	uint32_t n, n_bytes = width * 4, unrolled = n_bytes & ~15;
+	__m256i w0 = _mm256_set1_epi16(weights[0]), w1 = _mm256_set1_epi16(weights[1]);
+	__m256i round = _mm256_set1_epi16(128), a, b;
+
+	for (n = 0; n < unrolled; n += 16) {
+		a = _mm256_cvtepu8_epi16(_mm_loadu_si128((__m128i*)(s0 + n)));
+		b = _mm256_cvtepu8_epi16(_mm_loadu_si128((__m128i*)(s1 + n)));
+		a = _mm256_srli_epi16(_mm256_add_epi16(_mm256_add_epi16(
+				_mm256_mullo_epi16(a, w0), _mm256_mullo_epi16(b, w1)), round), 8);
+		_mm_storeu_si128((__m128i*)(dst + n), _mm_packus_epi16(
+				_mm256_castsi256_si128(a), _mm256_extracti128_si256(a, 1)));
+	}
+	for (; n < n_bytes; n++)
+		dst[n] = (s0[n] * weights[0] + s1[n] * weights[1] + 128) >> 8;
+}
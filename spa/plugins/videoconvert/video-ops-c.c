@@ -0,0 +1,656 @@
+/* Spa
+ *
+ * Copyright © 2020 Wim Taymans
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the next
+ * paragraph) shall be included in all copies or substantial portions of the
+ * Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+#include <string.h>
+
+#include "video-ops.h"
+
+/* byte offsets in a YUY2/UYVY macropixel and an RGBx/BGRx pixel */
+#define Y_OFFS(uyvy)	((uyvy) ? 1 : 0)
+#define C_OFFS(uyvy)	((uyvy) ? 0 : 1)
+#define R_OFFS(bgr)	((bgr) ? 2 : 0)
+#define B_OFFS(bgr)	((bgr) ? 0 : 2)
+
+static inline void
+packed_to_420(void * SPA_RESTRICT dst[], const void * SPA_RESTRICT src[],
+		uint32_t width, bool uyvy, bool nv12)
+{
+	const uint8_t *s0 = src[0], *s1 = src[1];
+	uint8_t *y0 = dst[0], *y1 = dst[1], *u = dst[2];
+	uint8_t *v = nv12 ? u + 1 : dst[3];
+	uint32_t i, n = width / 2, cs = nv12 ? 2 : 1;
+	uint32_t yo = Y_OFFS(uyvy), co = C_OFFS(uyvy);
+
+	for (i = 0; i < n; i++) {
+		y0[2*i+0] = s0[4*i+yo];
+		y0[2*i+1] = s0[4*i+yo+2];
+		y1[2*i+0] = s1[4*i+yo];
+		y1[2*i+1] = s1[4*i+yo+2];
+		u[cs*i] = avg_u8(s0[4*i+co], s1[4*i+co]);
+		v[cs*i] = avg_u8(s0[4*i+co+2], s1[4*i+co+2]);
+	}
+	if (width & 1) {
+		y0[2*i] = s0[4*i+yo];
+		y1[2*i] = s1[4*i+yo];
+		u[cs*i] = avg_u8(s0[4*i+co], s1[4*i+co]);
+		v[cs*i] = avg_u8(s0[4*i+co+2], s1[4*i+co+2]);
+	}
+}
+
+DEFINE_FUNCTION(yuy2_to_i420, c)
+{
+	packed_to_420(dst, src, width, false, false);
+}
+
+DEFINE_FUNCTION(uyvy_to_i420, c)
+{
+	packed_to_420(dst, src, width, true, false);
+}
+
+DEFINE_FUNCTION(yuy2_to_nv12, c)
+{
+	packed_to_420(dst, src, width, false, true);
+}
+
+DEFINE_FUNCTION(uyvy_to_nv12, c)
+{
+	packed_to_420(dst, src, width, true, true);
+}
+
+static inline void
+yuv420_to_packed(void * SPA_RESTRICT dst[], const void * SPA_RESTRICT src[],
+		uint32_t width, bool nv12, bool uyvy)
+{
+	const uint8_t *y = src[0], *u = src[1];
+	const uint8_t *v = nv12 ? u + 1 : src[2];
+	uint8_t *d = dst[0];
+	uint32_t i, n = width / 2, cs = nv12 ? 2 : 1;
+	uint32_t yo = Y_OFFS(uyvy), co = C_OFFS(uyvy);
+
+	for (i = 0; i < n; i++) {
+		d[4*i+yo] = y[2*i+0];
+		d[4*i+yo+2] = y[2*i+1];
+		d[4*i+co] = u[cs*i];
+		d[4*i+co+2] = v[cs*i];
+	}
+	if (width & 1) {
+		d[4*i+yo] = d[4*i+yo+2] = y[2*i];
+		d[4*i+co] = u[cs*i];
+		d[4*i+co+2] = v[cs*i];
+	}
+}
+
+DEFINE_FUNCTION(i420_to_yuy2, c)
+{
+	yuv420_to_packed(dst, src, width, false, false);
+}
+
+DEFINE_FUNCTION(i420_to_uyvy, c)
+{
+	yuv420_to_packed(dst, src, width, false, true);
+}
+
+DEFINE_FUNCTION(nv12_to_yuy2, c)
+{
+	yuv420_to_packed(dst, src, width, true, false);
+}
+
+DEFINE_FUNCTION(nv12_to_uyvy, c)
+{
+	yuv420_to_packed(dst, src, width, true, true);
+}
+
+DEFINE_FUNCTION(i420_to_nv12, c)
+{
+	const uint8_t *u = src[2], *v = src[3];
+	uint8_t *uv = dst[2];
+	uint32_t i, n = (width + 1) / 2;
+
+	memcpy(dst[0], src[0], width);
+	memcpy(dst[1], src[1], width);
+	for (i = 0; i < n; i++) {
+		uv[2*i+0] = u[i];
+		uv[2*i+1] = v[i];
+	}
+}
+
+DEFINE_FUNCTION(nv12_to_i420, c)
+{
+	const uint8_t *uv = src[2];
+	uint8_t *u = dst[2], *v = dst[3];
+	uint32_t i, n = (width + 1) / 2;
+
+	memcpy(dst[0], src[0], width);
+	memcpy(dst[1], src[1], width);
+	for (i = 0; i < n; i++) {
+		u[i] = uv[2*i+0];
+		v[i] = uv[2*i+1];
+	}
+}
+
+static inline void
+yuv420_to_rgb(struct convert *conv, void * SPA_RESTRICT dst[], const void * SPA_RESTRICT src[],
+		uint32_t width, bool nv12, bool bgr)
+{
+	const uint8_t *y = src[0], *u = src[1];
+	const uint8_t *v = nv12 ? u + 1 : src[2];
+	uint8_t *d = dst[0];
+	uint32_t i, cs = nv12 ? 2 : 1, ro = R_OFFS(bgr), bo = B_OFFS(bgr);
+
+	for (i = 0; i < width; i++) {
+		uint32_t c = (i >> 1) * cs;
+		yuv_to_rgb(conv, y[i], u[c], v[c], &d[ro], &d[1], &d[bo]);
+		d[3] = 0xff;
+		d += 4;
+	}
+}
+
+DEFINE_FUNCTION(i420_to_rgbx, c)
+{
+	yuv420_to_rgb(conv, dst, src, width, false, false);
+}
+
+DEFINE_FUNCTION(i420_to_bgrx, c)
+{
+	yuv420_to_rgb(conv, dst, src, width, false, true);
+}
+
+DEFINE_FUNCTION(nv12_to_rgbx, c)
+{
+	yuv420_to_rgb(conv, dst, src, width, true, false);
+}
+
+DEFINE_FUNCTION(nv12_to_bgrx, c)
+{
+	yuv420_to_rgb(conv, dst, src, width, true, true);
+}
+
+static inline void
+packed_to_rgb(struct convert *conv, void * SPA_RESTRICT dst[], const void * SPA_RESTRICT src[],
+		uint32_t width, bool uyvy, bool bgr)
+{
+	const uint8_t *s = src[0];
+	uint8_t *d = dst[0];
+	uint32_t i, yo = Y_OFFS(uyvy), co = C_OFFS(uyvy);
+	uint32_t ro = R_OFFS(bgr), bo = B_OFFS(bgr);
+
+	for (i = 0; i < width; i++) {
+		const uint8_t *p = &s[(i >> 1) * 4];
+		yuv_to_rgb(conv, p[yo + (i & 1) * 2], p[co], p[co+2], &d[ro], &d[1], &d[bo]);
+		d[3] = 0xff;
+		d += 4;
+	}
+}
+
+DEFINE_FUNCTION(yuy2_to_rgbx, c)
+{
+	packed_to_rgb(conv, dst, src, width, false, false);
+}
+
+DEFINE_FUNCTION(yuy2_to_bgrx, c)
+{
+	packed_to_rgb(conv, dst, src, width, false, true);
+}
+
+DEFINE_FUNCTION(uyvy_to_rgbx, c)
+{
+	packed_to_rgb(conv, dst, src, width, true, false);
+}
+
+DEFINE_FUNCTION(uyvy_to_bgrx, c)
+{
+	packed_to_rgb(conv, dst, src, width, true, true);
+}
+
+static inline void
+rgb_to_420(struct convert *conv, void * SPA_RESTRICT dst[], const void * SPA_RESTRICT src[],
+		uint32_t width, bool bgr, bool nv12)
+{
+	const uint8_t *s0 = src[0], *s1 = src[1];
+	uint8_t *y0 = dst[0], *y1 = dst[1], *u = dst[2];
+	uint8_t *v = nv12 ? u + 1 : dst[3];
+	uint32_t i, n = (width + 1) / 2, cs = nv12 ? 2 : 1;
+	uint32_t ro = R_OFFS(bgr), bo = B_OFFS(bgr);
+
+	for (i = 0; i < n; i++) {
+		const uint8_t *p00 = &s0[8*i], *p10 = &s1[8*i];
+		const uint8_t *p01 = p00 + 4, *p11 = p10 + 4;
+		uint8_t r, g, b;
+
+		if (2*i+1 == width) {
+			p01 = p00;
+			p11 = p10;
+		} else {
+			y0[2*i+1] = rgb_to_y(conv, p01[ro], p01[1], p01[bo]);
+			y1[2*i+1] = rgb_to_y(conv, p11[ro], p11[1], p11[bo]);
+		}
+		y0[2*i] = rgb_to_y(conv, p00[ro], p00[1], p00[bo]);
+		y1[2*i] = rgb_to_y(conv, p10[ro], p10[1], p10[bo]);
+
+		r = avg_u8(avg_u8(p00[ro], p10[ro]), avg_u8(p01[ro], p11[ro]));
+		g = avg_u8(avg_u8(p00[1], p10[1]), avg_u8(p01[1], p11[1]));
+		b = avg_u8(avg_u8(p00[bo], p10[bo]), avg_u8(p01[bo], p11[bo]));
+		u[cs*i] = rgb_to_u(conv, r, g, b);
+		v[cs*i] = rgb_to_v(conv, r, g, b);
+	}
+}
+
+DEFINE_FUNCTION(rgbx_to_i420, c)
+{
+	rgb_to_420(conv, dst, src, width, false, false);
+}
+
+DEFINE_FUNCTION(bgrx_to_i420, c)
+{
+	rgb_to_420(conv, dst, src, width, true, false);
+}
+
+DEFINE_FUNCTION(rgbx_to_nv12, c)
+{
+	rgb_to_420(conv, dst, src, width, false, true);
+}
+
+DEFINE_FUNCTION(bgrx_to_nv12, c)
+{
+	rgb_to_420(conv, dst, src, width, true, true);
+}
+
+static inline void
+rgb_to_packed(struct convert *conv, void * SPA_RESTRICT dst[], const void * SPA_RESTRICT src[],
+		uint32_t width, bool bgr, bool uyvy)
+{
+	const uint8_t *s = src[0];
+	uint8_t *d = dst[0];
+	uint32_t i, n = (width + 1) / 2;
+	uint32_t ro = R_OFFS(bgr), bo = B_OFFS(bgr);
+	uint32_t yo = Y_OFFS(uyvy), co = C_OFFS(uyvy);
+
+	for (i = 0; i < n; i++) {
+		const uint8_t *p0 = &s[8*i];
+		const uint8_t *p1 = 2*i+1 == width ? p0 : p0 + 4;
+		uint8_t r, g, b;
+
+		d[yo] = rgb_to_y(conv, p0[ro], p0[1], p0[bo]);
+		d[yo+2] = rgb_to_y(conv, p1[ro], p1[1], p1[bo]);
+		r = avg_u8(p0[ro], p1[ro]);
+		g = avg_u8(p0[1], p1[1]);
+		b = avg_u8(p0[bo], p1[bo]);
+		d[co] = rgb_to_u(conv, r, g, b);
+		d[co+2] = rgb_to_v(conv, r, g, b);
+		d += 4;
+	}
+}
+
+DEFINE_FUNCTION(rgbx_to_yuy2, c)
+{
+	rgb_to_packed(conv, dst, src, width, false, false);
+}
+
+DEFINE_FUNCTION(bgrx_to_yuy2, c)
+{
+	rgb_to_packed(conv, dst, src, width, true, false);
+}
+
+DEFINE_FUNCTION(rgbx_to_uyvy, c)
+{
+	rgb_to_packed(conv, dst, src, width, false, true);
+}
+
+DEFINE_FUNCTION(bgrx_to_uyvy, c)
+{
+	rgb_to_packed(conv, dst, src, width, true, true);
+}
+
+DEFINE_FUNCTION(swap16, c)
+{
+	const uint8_t *s = src[0];
+	uint8_t *d = dst[0];
+	uint32_t i, n = ((width + 1) / 2) * 2;
+
+	for (i = 0; i < n; i++) {
+		uint8_t t = s[2*i];
+		d[2*i] = s[2*i+1];
+		d[2*i+1] = t;
+	}
+}
+
+DEFINE_FUNCTION(swap_rb, c)
+{
+	const uint8_t *s = src[0];
+	uint8_t *d = dst[0];
+	uint32_t i;
+
+	for (i = 0; i < width; i++) {
+		uint8_t t = s[4*i];
+		d[4*i+0] = s[4*i+2];
+		d[4*i+1] = s[4*i+1];
+		d[4*i+2] = t;
+		d[4*i+3] = s[4*i+3];
+	}
+}
+
+DEFINE_HSCALE(bilinear, c)
+{
+	uint32_t i;
+
+	for (i = 0; i < width; i++) {
+		const uint8_t *s = &src[offsets[i] * 4];
+		uint32_t w0 = weights[2*i], w1 = weights[2*i+1];
+
+		dst[4*i+0] = (s[0] * w0 + s[4] * w1 + 128) >> 8;
+		dst[4*i+1] = (s[1] * w0 + s[5] * w1 + 128) >> 8;
+		dst[4*i+2] = (s[2] * w0 + s[6] * w1 + 128) >> 8;
+		dst[4*i+3] = (s[3] * w0 + s[7] * w1 + 128) >> 8;
+	}
+}
+
+DEFINE_HSCALE(ntap, c)
+{
+	uint32_t i, j;
+
+	for (i = 0; i < width; i++) {
+		const uint8_t *s = &src[offsets[i] * 4];
+		const uint16_t *w = &weights[i * n_taps];
+		uint32_t a0 = 128, a1 = 128, a2 = 128, a3 = 128;
+
+		for (j = 0; j < n_taps; j++) {
+			a0 += s[4*j+0] * w[j];
+			a1 += s[4*j+1] * w[j];
+			a2 += s[4*j+2] * w[j];
+			a3 += s[4*j+3] * w[j];
+		}
+		dst[4*i+0] = a0 >> 8;
+		dst[4*i+1] = a1 >> 8;
+		dst[4*i+2] = a2 >> 8;
+		dst[4*i+3] = a3 >> 8;
+	}
+}
+
+DEFINE_VSCALE(bilinear, c)
+{
+	const uint8_t *s0 = src[0], *s1 = src[1];
+	uint32_t i, n = width * 4, w0 = weights[0], w1 = weights[1];
+
+	for (i = 0; i < n; i++)
+		dst[i] = (s0[i] * w0 + s1[i] * w1 + 128) >> 8;
+}
+
+DEFINE_VSCALE(ntap, c)
+{
+	uint32_t i, j, n = width * 4;
+
+	for (i = 0; i < n; i++) {
+		uint32_t acc = 128;
+		for (j = 0; j < n_taps; j++)
+			acc += src[j][i] * weights[j];
+		dst[i] = acc >> 8;
+	}
+}
+
+/* Chroma is co-sited with the even luma samples horizontally and, for
+ * 4:2:0, sits between two luma lines vertically (MPEG-2). Unpacking
+ * interpolates the missing samples, packing filters with [1 2 1]. */
+static inline uint8_t interp_u8(const uint8_t *c, uint32_t stride, uint32_t i, uint32_t n)
+{
+	return i + 1 < n ? avg_u8(c[i * stride], c[(i + 1) * stride]) : c[i * stride];
+}
+
+static inline void
+unpack_packed(uint8_t * SPA_RESTRICT dst, const struct video_frame *src,
+		uint32_t y, uint32_t width, bool uyvy)
+{
+	const uint8_t *s = SPA_MEMBER(src->data[0], y * src->stride[0], uint8_t);
+	uint32_t i, n = (width + 1) / 2, yo = Y_OFFS(uyvy), co = C_OFFS(uyvy);
+
+	for (i = 0; i < width; i++) {
+		uint32_t k = i >> 1;
+		dst[0] = s[4*k + yo + (i & 1) * 2];
+		if (i & 1) {
+			dst[1] = interp_u8(&s[co], 4, k, n);
+			dst[2] = interp_u8(&s[co+2], 4, k, n);
+		} else {
+			dst[1] = s[4*k + co];
+			dst[2] = s[4*k + co + 2];
+		}
+		dst[3] = 0xff;
+		dst += 4;
+	}
+}
+
+DEFINE_UNPACK(yuy2, c)
+{
+	unpack_packed(dst, src, y, width, false);
+}
+
+DEFINE_UNPACK(uyvy, c)
+{
+	unpack_packed(dst, src, y, width, true);
+}
+
+static inline void
+unpack_420(uint8_t * SPA_RESTRICT dst, const struct video_frame *src,
+		uint32_t y, uint32_t width, uint32_t height, bool nv12)
+{
+	const uint8_t *sy = SPA_MEMBER(src->data[0], y * src->stride[0], uint8_t);
+	const uint8_t *u0, *u1, *v0, *v1;
+	uint32_t i, k = y / 2, k2, n = (width + 1) / 2, cs = nv12 ? 2 : 1;
+	uint8_t cu[2], cv[2];
+
+	/* the other chroma line that is closest to this luma line */
+	if (y & 1)
+		k2 = SPA_MIN(k + 1, (height + 1) / 2 - 1);
+	else
+		k2 = k > 0 ? k - 1 : 0;
+
+	u0 = SPA_MEMBER(src->data[1], k * src->stride[1], uint8_t);
+	u1 = SPA_MEMBER(src->data[1], k2 * src->stride[1], uint8_t);
+	if (nv12) {
+		v0 = u0 + 1;
+		v1 = u1 + 1;
+	} else {
+		v0 = SPA_MEMBER(src->data[2], k * src->stride[2], uint8_t);
+		v1 = SPA_MEMBER(src->data[2], k2 * src->stride[2], uint8_t);
+	}
+
+	cu[1] = (3 * u0[0] + u1[0] + 2) >> 2;
+	cv[1] = (3 * v0[0] + v1[0] + 2) >> 2;
+	for (i = 0; i < n; i++) {
+		uint32_t j = SPA_MIN(i + 1, n - 1) * cs;
+
+		cu[0] = cu[1];
+		cv[0] = cv[1];
+		cu[1] = (3 * u0[j] + u1[j] + 2) >> 2;
+		cv[1] = (3 * v0[j] + v1[j] + 2) >> 2;
+
+		dst[0] = sy[2*i];
+		dst[1] = cu[0];
+		dst[2] = cv[0];
+		dst[3] = 0xff;
+		if (2*i+1 < width) {
+			dst[4] = sy[2*i+1];
+			dst[5] = avg_u8(cu[0], cu[1]);
+			dst[6] = avg_u8(cv[0], cv[1]);
+			dst[7] = 0xff;
+		}
+		dst += 8;
+	}
+}
+
+DEFINE_UNPACK(i420, c)
+{
+	unpack_420(dst, src, y, width, height, false);
+}
+
+DEFINE_UNPACK(nv12, c)
+{
+	unpack_420(dst, src, y, width, height, true);
+}
+
+static inline void
+unpack_rgb(uint8_t * SPA_RESTRICT dst, const struct video_frame *src,
+		uint32_t y, uint32_t width, bool bgr)
+{
+	const uint8_t *s = SPA_MEMBER(src->data[0], y * src->stride[0], uint8_t);
+	uint32_t i, ro = R_OFFS(bgr), bo = B_OFFS(bgr);
+
+	for (i = 0; i < width; i++) {
+		dst[0] = s[ro];
+		dst[1] = s[1];
+		dst[2] = s[bo];
+		dst[3] = 0xff;
+		dst += 4;
+		s += 4;
+	}
+}
+
+DEFINE_UNPACK(rgbx, c)
+{
+	unpack_rgb(dst, src, y, width, false);
+}
+
+DEFINE_UNPACK(bgrx, c)
+{
+	unpack_rgb(dst, src, y, width, true);
+}
+
+static inline uint8_t filter_121(const uint8_t *s, uint32_t i, uint32_t width)
+{
+	uint32_t l = i > 0 ? i - 1 : i, r = i + 1 < width ? i + 1 : i;
+	return (s[4*l] + 2 * s[4*i] + s[4*r] + 2) >> 2;
+}
+
+static inline void
+pack_packed(struct video_frame *dst, uint32_t y, const uint8_t * SPA_RESTRICT src,
+		uint32_t width, bool uyvy)
+{
+	uint8_t *d = SPA_MEMBER(dst->data[0], y * dst->stride[0], uint8_t);
+	uint32_t i, n = (width + 1) / 2, yo = Y_OFFS(uyvy), co = C_OFFS(uyvy);
+
+	for (i = 0; i < n; i++) {
+		d[yo] = src[8*i];
+		d[yo+2] = 2*i+1 < width ? src[8*i+4] : src[8*i];
+		d[co] = filter_121(&src[1], 2*i, width);
+		d[co+2] = filter_121(&src[2], 2*i, width);
+		d += 4;
+	}
+}
+
+DEFINE_PACK(yuy2, c)
+{
+	pack_packed(dst, y, src[0], width, false);
+}
+
+DEFINE_PACK(uyvy, c)
+{
+	pack_packed(dst, y, src[0], width, true);
+}
+
+static inline void
+pack_420(struct convert *conv, struct video_frame *dst, uint32_t y,
+		const uint8_t * SPA_RESTRICT src[2], uint32_t width, bool nv12)
+{
+	const uint8_t *s0 = src[0], *s1 = src[1];
+	uint8_t *y0, *u, *v;
+	uint32_t i, n = (width + 1) / 2, k = y / 2, cs = nv12 ? 2 : 1;
+
+	y0 = SPA_MEMBER(dst->data[0], y * dst->stride[0], uint8_t);
+	for (i = 0; i < width; i++)
+		y0[i] = s0[4*i];
+	if (y + 1 < conv->dst_height) {
+		uint8_t *y1 = y0 + dst->stride[0];
+		for (i = 0; i < width; i++)
+			y1[i] = s1[4*i];
+	}
+
+	u = SPA_MEMBER(dst->data[1], k * dst->stride[1], uint8_t);
+	v = nv12 ? u + 1 : SPA_MEMBER(dst->data[2], k * dst->stride[2], uint8_t);
+	for (i = 0; i < n; i++) {
+		uint32_t c = 2*i, l = c > 0 ? c - 1 : c, r = c + 1 < width ? c + 1 : c;
+
+		u[cs*i] = (s0[4*l+1] + s1[4*l+1] + 2 * (s0[4*c+1] + s1[4*c+1]) +
+				s0[4*r+1] + s1[4*r+1] + 4) >> 3;
+		v[cs*i] = (s0[4*l+2] + s1[4*l+2] + 2 * (s0[4*c+2] + s1[4*c+2]) +
+				s0[4*r+2] + s1[4*r+2] + 4) >> 3;
+	}
+}
+
+DEFINE_PACK(i420, c)
+{
+	pack_420(conv, dst, y, src, width, false);
+}
+
+DEFINE_PACK(nv12, c)
+{
+	pack_420(conv, dst, y, src, width, true);
+}
+
+static inline void
+pack_rgb(struct video_frame *dst, uint32_t y, const uint8_t * SPA_RESTRICT src,
+		uint32_t width, bool bgr)
+{
+	uint8_t *d = SPA_MEMBER(dst->data[0], y * dst->stride[0], uint8_t);
+	uint32_t i, ro = R_OFFS(bgr), bo = B_OFFS(bgr);
+
+	for (i = 0; i < width; i++) {
+		d[ro] = src[0];
+		d[1] = src[1];
+		d[bo] = src[2];
+		d[3] = 0xff;
+		d += 4;
+		src += 4;
+	}
+}
+
+DEFINE_PACK(rgbx, c)
+{
+	pack_rgb(dst, y, src[0], width, false);
+}
+
+DEFINE_PACK(bgrx, c)
+{
+	pack_rgb(dst, y, src[0], width, true);
+}
+
+void matrix_yuv_to_rgb_c(struct convert *conv, uint8_t * SPA_RESTRICT row, uint32_t width)
+{
+	uint32_t i;
+
+	for (i = 0; i < width; i++) {
+		yuv_to_rgb(conv, row[0], row[1], row[2], &row[0], &row[1], &row[2]);
+		row += 4;
+	}
+}
+
+void matrix_rgb_to_yuv_c(struct convert *conv, uint8_t * SPA_RESTRICT row, uint32_t width)
+{
+	uint32_t i;
+
+	for (i = 0; i < width; i++) {
+		uint8_t r = row[0], g = row[1], b = row[2];
+		row[0] = rgb_to_y(conv, r, g, b);
+		row[1] = rgb_to_u(conv, r, g, b);
+		row[2] = rgb_to_v(conv, r, g, b);
+		row += 4;
+	}
+}
@@ -0,0 +1,572 @@
+/* Spa
+ *
+ * Copyright © 2020 Wim Taymans
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the next
+ * paragraph) shall be included in all copies or substantial portions of the
+ * Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+#include <string.h>
+
+#include "video-ops.h"
+
+#include <emmintrin.h>
+
+static inline void
+packed_to_420_sse2(struct convert *conv, void * SPA_RESTRICT dst[],
+		const void * SPA_RESTRICT src[], uint32_t width, bool uyvy, bool nv12)
+{
+	const uint8_t *s0 = src[0], *s1 = src[1];
+	uint8_t *y0 = dst[0], *y1 = dst[1], *u = dst[2], *v = nv12 ? NULL : dst[3];
+	uint32_t n, unrolled = width & ~15;
+	__m128i mask = _mm_set1_epi16(0x00ff);
+	__m128i a0, a1, b0, b1, c0, c1, uv;
+
+#define LUMA(x)		(uyvy ? _mm_srli_epi16(x, 8) : _mm_and_si128(x, mask))
+#define CHROMA(x)	(uyvy ? _mm_and_si128(x, mask) : _mm_srli_epi16(x, 8))
+	for (n = 0; n < unrolled; n += 16) {
+		a0 = _mm_loadu_si128((__m128i*)(s0 + 2*n));
+		a1 = _mm_loadu_si128((__m128i*)(s0 + 2*n + 16));
+		b0 = _mm_loadu_si128((__m128i*)(s1 + 2*n));
+		b1 = _mm_loadu_si128((__m128i*)(s1 + 2*n + 16));
+
+		_mm_storeu_si128((__m128i*)(y0 + n), _mm_packus_epi16(LUMA(a0), LUMA(a1)));
+		_mm_storeu_si128((__m128i*)(y1 + n), _mm_packus_epi16(LUMA(b0), LUMA(b1)));
+
+		c0 = _mm_packus_epi16(CHROMA(a0), CHROMA(a1));
+		c1 = _mm_packus_epi16(CHROMA(b0), CHROMA(b1));
+		uv = _mm_avg_epu8(c0, c1);
+
+		if (nv12) {
+			_mm_storeu_si128((__m128i*)(u + n), uv);
+		} else {
+			c0 = _mm_and_si128(uv, mask);
+			c1 = _mm_srli_epi16(uv, 8);
+			_mm_storel_epi64((__m128i*)(u + n/2), _mm_packus_epi16(c0, c0));
+			_mm_storel_epi64((__m128i*)(v + n/2), _mm_packus_epi16(c1, c1));
+		}
+	}
+#undef LUMA
+#undef CHROMA
+	if (n < width) {
+		const void *s[2] = { s0 + 2*n, s1 + 2*n };
+		void *d[4] = { y0 + n, y1 + n, u + (nv12 ? n : n/2), nv12 ? NULL : v + n/2 };
+		if (uyvy)
+			nv12 ? conv_uyvy_to_nv12_c(conv, d, s, width - n) :
+				conv_uyvy_to_i420_c(conv, d, s, width - n);
+		else
+			nv12 ? conv_yuy2_to_nv12_c(conv, d, s, width - n) :
+				conv_yuy2_to_i420_c(conv, d, s, width - n);
+	}
+}
+
+DEFINE_FUNCTION(yuy2_to_i420, sse2)
+{
+	packed_to_420_sse2(conv, dst, src, width, false, false);
+}
+
+DEFINE_FUNCTION(uyvy_to_i420, sse2)
+{
+	packed_to_420_sse2(conv, dst, src, width, true, false);
+}
+
+DEFINE_FUNCTION(yuy2_to_nv12, sse2)
+{
+	packed_to_420_sse2(conv, dst, src, width, false, true);
+}
+
+DEFINE_FUNCTION(uyvy_to_nv12, sse2)
+{
+	packed_to_420_sse2(conv, dst, src, width, true, true);
+}
+
+static inline void
+yuv420_to_packed_sse2(struct convert *conv, void * SPA_RESTRICT dst[],
+		const void * SPA_RESTRICT src[], uint32_t width, bool nv12, bool uyvy)
+{
+	const uint8_t *y = src[0], *u = src[1], *v = nv12 ? NULL : src[2];
+	uint8_t *d = dst[0];
+	uint32_t n, unrolled = width & ~15;
+	__m128i yy, uv;
+
+	for (n = 0; n < unrolled; n += 16) {
+		yy = _mm_loadu_si128((__m128i*)(y + n));
+		if (nv12)
+			uv = _mm_loadu_si128((__m128i*)(u + n));
+		else
+			uv = _mm_unpacklo_epi8(
+					_mm_loadl_epi64((__m128i*)(u + n/2)),
+					_mm_loadl_epi64((__m128i*)(v + n/2)));
+		if (uyvy) {
+			_mm_storeu_si128((__m128i*)(d + 2*n), _mm_unpacklo_epi8(uv, yy));
+			_mm_storeu_si128((__m128i*)(d + 2*n + 16), _mm_unpackhi_epi8(uv, yy));
+		} else {
+			_mm_storeu_si128((__m128i*)(d + 2*n), _mm_unpacklo_epi8(yy, uv));
+			_mm_storeu_si128((__m128i*)(d + 2*n + 16), _mm_unpackhi_epi8(yy, uv));
+		}
+	}
+	if (n < width) {
+		const void *s[3] = { y + n, u + (nv12 ? n : n/2), nv12 ? NULL : v + n/2 };
+		void *dd[1] = { d + 2*n };
+		if (nv12)
+			uyvy ? conv_nv12_to_uyvy_c(conv, dd, s, width - n) :
+				conv_nv12_to_yuy2_c(conv, dd, s, width - n);
+		else
+			uyvy ? conv_i420_to_uyvy_c(conv, dd, s, width - n) :
+				conv_i420_to_yuy2_c(conv, dd, s, width - n);
+	}
+}
+
+DEFINE_FUNCTION(i420_to_yuy2, sse2)
+{
+	yuv420_to_packed_sse2(conv, dst, src, width, false, false);
+}
+
+DEFINE_FUNCTION(i420_to_uyvy, sse2)
+{
+	yuv420_to_packed_sse2(conv, dst, src, width, false, true);
+}
+
+DEFINE_FUNCTION(nv12_to_yuy2, sse2)
+{
+	yuv420_to_packed_sse2(conv, dst, src, width, true, false);
+}
+
+DEFINE_FUNCTION(nv12_to_uyvy, sse2)
+{
+	yuv420_to_packed_sse2(conv, dst, src, width, true, true);
+}
+
+DEFINE_FUNCTION(i420_to_nv12, sse2)
+{
+	const uint8_t *u = src[2], *v = src[3];
+	uint8_t *uv = dst[2];
+	uint32_t n, n_chroma = (width + 1) / 2, unrolled = n_chroma & ~15;
+	__m128i cu, cv;
+
+	memcpy(dst[0], src[0], width);
+	memcpy(dst[1], src[1], width);
+
+	for (n = 0; n < unrolled; n += 16) {
+		cu = _mm_loadu_si128((__m128i*)(u + n));
+		cv = _mm_loadu_si128((__m128i*)(v + n));
+		_mm_storeu_si128((__m128i*)(uv + 2*n), _mm_unpacklo_epi8(cu, cv));
+		_mm_storeu_si128((__m128i*)(uv + 2*n + 16), _mm_unpackhi_epi8(cu, cv));
+	}
+	for (; n < n_chroma; n++) {
+		uv[2*n+0] = u[n];
+		uv[2*n+1] = v[n];
+	}
+}
+
+DEFINE_FUNCTION(nv12_to_i420, sse2)
+{
+	const uint8_t *uv = src[2];
+	uint8_t *u = dst[2], *v = dst[3];
+	uint32_t n, n_chroma = (width + 1) / 2, unrolled = n_chroma & ~15;
+	__m128i mask = _mm_set1_epi16(0x00ff), c0, c1;
+
+	memcpy(dst[0], src[0], width);
+	memcpy(dst[1], src[1], width);
+
+	for (n = 0; n < unrolled; n += 16) {
+		c0 = _mm_loadu_si128((__m128i*)(uv + 2*n));
+		c1 = _mm_loadu_si128((__m128i*)(uv + 2*n + 16));
+		_mm_storeu_si128((__m128i*)(u + n), _mm_packus_epi16(
+					_mm_and_si128(c0, mask), _mm_and_si128(c1, mask)));
+		_mm_storeu_si128((__m128i*)(v + n), _mm_packus_epi16(
+					_mm_srli_epi16(c0, 8), _mm_srli_epi16(c1, 8)));
+	}
+	for (; n < n_chroma; n++) {
+		u[n] = uv[2*n+0];
+		v[n] = uv[2*n+1];
+	}
+}
+
+struct yuv_coefs {
+	__m128i y_bu, y_gu, y_rv, gv_round, round, one;
+	__m128i y_off, c_off;
+};
+
+static inline void init_yuv_coefs(struct convert *conv, struct yuv_coefs *c)
+{
+	c->y_bu = _mm_set1_epi32((uint16_t)conv->to_rgb.y | ((uint32_t)(uint16_t)conv->to_rgb.bu << 16));
+	c->y_gu = _mm_set1_epi32((uint16_t)conv->to_rgb.y | ((uint32_t)(uint16_t)conv->to_rgb.gu << 16));
+	c->y_rv = _mm_set1_epi32((uint16_t)conv->to_rgb.y | ((uint32_t)(uint16_t)conv->to_rgb.rv << 16));
+	c->gv_round = _mm_set1_epi32((uint16_t)conv->to_rgb.gv | (1u << (YUV_SHIFT - 1 + 16)));
+	c->round = _mm_set1_epi32(1 << (YUV_SHIFT - 1));
+	c->one = _mm_set1_epi16(1);
+	c->y_off = _mm_set1_epi16(16);
+	c->c_off = _mm_set1_epi16(128);
+}
+
+/* 4 pixels of R, G and B as 32 bits from Y, U and V as 16 bits */
+static inline void yuv_to_rgb_4(const struct yuv_coefs *c,
+		__m128i y, __m128i u, __m128i v, __m128i *r, __m128i *g, __m128i *b)
+{
+	__m128i yu = _mm_unpacklo_epi16(y, u);
+	__m128i yv = _mm_unpacklo_epi16(y, v);
+	__m128i v1 = _mm_unpacklo_epi16(v, c->one);
+
+	*b = _mm_srai_epi32(_mm_add_epi32(_mm_madd_epi16(yu, c->y_bu), c->round), YUV_SHIFT);
+	*g = _mm_srai_epi32(_mm_add_epi32(_mm_madd_epi16(yu, c->y_gu),
+				_mm_madd_epi16(v1, c->gv_round)), YUV_SHIFT);
+	*r = _mm_srai_epi32(_mm_add_epi32(_mm_madd_epi16(yv, c->y_rv), c->round), YUV_SHIFT);
+}
+
+/* 8 pixels of R, G and B as 16 bits from Y, U and V as 16 bits */
+static inline void yuv_to_rgb_8(const struct yuv_coefs *c,
+		__m128i y, __m128i u, __m128i v, __m128i *r, __m128i *g, __m128i *b)
+{
+	__m128i r0, g0, b0, r1, g1, b1;
+
+	y = _mm_sub_epi16(y, c->y_off);
+	u = _mm_sub_epi16(u, c->c_off);
+	v = _mm_sub_epi16(v, c->c_off);
+
+	yuv_to_rgb_4(c, y, u, v, &r0, &g0, &b0);
+	yuv_to_rgb_4(c, _mm_unpackhi_epi64(y, y), _mm_unpackhi_epi64(u, u),
+			_mm_unpackhi_epi64(v, v), &r1, &g1, &b1);
+
+	*r = _mm_packs_epi32(r0, r1);
+	*g = _mm_packs_epi32(g0, g1);
+	*b = _mm_packs_epi32(b0, b1);
+}
+
+/* store 16 pixels of R, G and B bytes as RGBx or BGRx */
+static inline void store_rgbx_16(uint8_t *d, __m128i r, __m128i g, __m128i b, bool bgr)
+{
+	__m128i ff = _mm_set1_epi8(-1), t0, t1, t2, t3;
+
+	if (bgr) {
+		__m128i t = r;
+		r = b;
+		b = t;
+	}
+	t0 = _mm_unpacklo_epi8(r, g);
+	t1 = _mm_unpacklo_epi8(b, ff);
+	t2 = _mm_unpackhi_epi8(r, g);
+	t3 = _mm_unpackhi_epi8(b, ff);
+	_mm_storeu_si128((__m128i*)(d +  0), _mm_unpacklo_epi16(t0, t1));
+	_mm_storeu_si128((__m128i*)(d + 16), _mm_unpackhi_epi16(t0, t1));
+	_mm_storeu_si128((__m128i*)(d + 32), _mm_unpacklo_epi16(t2, t3));
+	_mm_storeu_si128((__m128i*)(d + 48), _mm_unpackhi_epi16(t2, t3));
+}
+
+static inline void
+yuv420_to_rgb_sse2(struct convert *conv, void * SPA_RESTRICT dst[],
+		const void * SPA_RESTRICT src[], uint32_t width, bool nv12, bool bgr)
+{
+	const uint8_t *y = src[0], *u = src[1], *v = nv12 ? NULL : src[2];
+	uint8_t *d = dst[0];
+	uint32_t n, unrolled = width & ~15;
+	__m128i zero = _mm_setzero_si128(), mask = _mm_set1_epi16(0x00ff);
+	__m128i yy, cu, cv, r0, g0, b0, r1, g1, b1;
+	struct yuv_coefs c;
+
+	init_yuv_coefs(conv, &c);
+
+	for (n = 0; n < unrolled; n += 16) {
+		yy = _mm_loadu_si128((__m128i*)(y + n));
+		if (nv12) {
+			__m128i uv = _mm_loadu_si128((__m128i*)(u + n));
+			cu = _mm_and_si128(uv, mask);
+			cv = _mm_srli_epi16(uv, 8);
+		} else {
+			cu = _mm_unpacklo_epi8(_mm_loadl_epi64((__m128i*)(u + n/2)), zero);
+			cv = _mm_unpacklo_epi8(_mm_loadl_epi64((__m128i*)(v + n/2)), zero);
+		}
+		yuv_to_rgb_8(&c, _mm_unpacklo_epi8(yy, zero),
+				_mm_unpacklo_epi16(cu, cu), _mm_unpacklo_epi16(cv, cv),
+				&r0, &g0, &b0);
+		yuv_to_rgb_8(&c, _mm_unpackhi_epi8(yy, zero),
+				_mm_unpackhi_epi16(cu, cu), _mm_unpackhi_epi16(cv, cv),
+				&r1, &g1, &b1);
+		store_rgbx_16(d + 4*n, _mm_packus_epi16(r0, r1),
+				_mm_packus_epi16(g0, g1), _mm_packus_epi16(b0, b1), bgr);
+	}
+	if (n < width) {
+		const void *s[3] = { y + n, u + (nv12 ? n : n/2), nv12 ? NULL : v + n/2 };
+		void *dd[1] = { d + 4*n };
+		if (nv12)
+			bgr ? conv_nv12_to_bgrx_c(conv, dd, s, width - n) :
+				conv_nv12_to_rgbx_c(conv, dd, s, width - n);
+		else
+			bgr ? conv_i420_to_bgrx_c(conv, dd, s, width - n) :
+				conv_i420_to_rgbx_c(conv, dd, s, width - n);
+	}
+}
+
+DEFINE_FUNCTION(i420_to_rgbx, sse2)
+{
+	yuv420_to_rgb_sse2(conv, dst, src, width, false, false);
+}
+
+DEFINE_FUNCTION(i420_to_bgrx, sse2)
+{
+	yuv420_to_rgb_sse2(conv, dst, src, width, false, true);
+}
+
+DEFINE_FUNCTION(nv12_to_rgbx, sse2)
+{
+	yuv420_to_rgb_sse2(conv, dst, src, width, true, false);
+}
+
+DEFINE_FUNCTION(nv12_to_bgrx, sse2)
+{
+	yuv420_to_rgb_sse2(conv, dst, src, width, true, true);
+}
+
+static inline void
+packed_to_rgb_sse2(struct convert *conv, void * SPA_RESTRICT dst[],
+		const void * SPA_RESTRICT src[], uint32_t width, bool uyvy, bool bgr)
+{
+	const uint8_t *s = src[0];
+	uint8_t *d = dst[0];
+	uint32_t n, unrolled = width & ~15;
+	__m128i mask = _mm_set1_epi16(0x00ff), lo = _mm_set1_epi32(0xffff);
+	__m128i p, yy, cc, cu, cv, r[2], g[2], b[2];
+	uint32_t i;
+	struct yuv_coefs c;
+
+	init_yuv_coefs(conv, &c);
+
+	for (n = 0; n < unrolled; n += 16) {
+		for (i = 0; i < 2; i++) {
+			p = _mm_loadu_si128((__m128i*)(s + 2*n + 16*i));
+			yy = uyvy ? _mm_srli_epi16(p, 8) : _mm_and_si128(p, mask);
+			cc = uyvy ? _mm_and_si128(p, mask) : _mm_srli_epi16(p, 8);
+			cu = _mm_and_si128(cc, lo);
+			cv = _mm_srli_epi32(cc, 16);
+			cu = _mm_or_si128(cu, _mm_slli_epi32(cu, 16));
+			cv = _mm_or_si128(cv, _mm_slli_epi32(cv, 16));
+			yuv_to_rgb_8(&c, yy, cu, cv, &r[i], &g[i], &b[i]);
+		}
+		store_rgbx_16(d + 4*n, _mm_packus_epi16(r[0], r[1]),
+				_mm_packus_epi16(g[0], g[1]), _mm_packus_epi16(b[0], b[1]), bgr);
+	}
+	if (n < width) {
+		const void *ss[1] = { s + 2*n };
+		void *dd[1] = { d + 4*n };
+		if (uyvy)
+			bgr ? conv_uyvy_to_bgrx_c(conv, dd, ss, width - n) :
+				conv_uyvy_to_rgbx_c(conv, dd, ss, width - n);
+		else
+			bgr ? conv_yuy2_to_bgrx_c(conv, dd, ss, width - n) :
+				conv_yuy2_to_rgbx_c(conv, dd, ss, width - n);
+	}
+}
+
+DEFINE_FUNCTION(yuy2_to_rgbx, sse2)
+{
+	packed_to_rgb_sse2(conv, dst, src, width, false, false);
+}
+
+DEFINE_FUNCTION(yuy2_to_bgrx, sse2)
+{
+	packed_to_rgb_sse2(conv, dst, src, width, false, true);
+}
+
+DEFINE_FUNCTION(uyvy_to_rgbx, sse2)
+{
+	packed_to_rgb_sse2(conv, dst, src, width, true, false);
+}
+
+DEFINE_FUNCTION(uyvy_to_bgrx, sse2)
+{
+	packed_to_rgb_sse2(conv, dst, src, width, true, true);
+}
+
+/* split 8 RGBx/BGRx pixels into 16 bit R, G and B */
+static inline void split_rgb_8(__m128i p0, __m128i p1, bool bgr,
+		__m128i *r, __m128i *g, __m128i *b)
+{
+	__m128i mask = _mm_set1_epi32(0xff);
+	__m128i c0 = _mm_packs_epi32(_mm_and_si128(p0, mask), _mm_and_si128(p1, mask));
+	__m128i c2 = _mm_packs_epi32(_mm_and_si128(_mm_srli_epi32(p0, 16), mask),
+			_mm_and_si128(_mm_srli_epi32(p1, 16), mask));
+
+	*g = _mm_packs_epi32(_mm_and_si128(_mm_srli_epi32(p0, 8), mask),
+			_mm_and_si128(_mm_srli_epi32(p1, 8), mask));
+	*r = bgr ? c2 : c0;
+	*b = bgr ? c0 : c2;
+}
+
+static inline void
+rgb_to_420_sse2(struct convert *conv, void * SPA_RESTRICT dst[],
+		const void * SPA_RESTRICT src[], uint32_t width, bool bgr, bool nv12)
+{
+	const uint8_t *s0 = src[0], *s1 = src[1];
+	uint8_t *y0 = dst[0], *y1 = dst[1], *u = dst[2], *v = nv12 ? NULL : dst[3];
+	uint32_t n, unrolled = width & ~7;
+	__m128i yr = _mm_set1_epi16(conv->to_yuv.yr);
+	__m128i yg = _mm_set1_epi16(conv->to_yuv.yg);
+	__m128i yb = _mm_set1_epi16(conv->to_yuv.yb);
+	__m128i ur = _mm_set1_epi16(conv->to_yuv.ur);
+	__m128i ug = _mm_set1_epi16(conv->to_yuv.ug);
+	__m128i ub = _mm_set1_epi16(conv->to_yuv.ub);
+	__m128i vr = _mm_set1_epi16(conv->to_yuv.vr);
+	__m128i vg = _mm_set1_epi16(conv->to_yuv.vg);
+	__m128i vb = _mm_set1_epi16(conv->to_yuv.vb);
+	__m128i round = _mm_set1_epi16(1 << (RGB_SHIFT - 1));
+	__m128i y_off = _mm_set1_epi16(16), c_off = _mm_set1_epi16(128);
+	__m128i a0, a1, b0, b1, r, g, b, t0, t1, cy, cu, cv;
+
+#define CALC_Y(r,g,b)								\
+	_mm_add_epi16(_mm_srli_epi16(_mm_add_epi16(_mm_add_epi16(		\
+		_mm_mullo_epi16(r, yr), _mm_mullo_epi16(g, yg)),		\
+		_mm_add_epi16(_mm_mullo_epi16(b, yb), round)), RGB_SHIFT), y_off)
+#define CALC_C(r,g,b,cr,cg,cb)							\
+	_mm_add_epi16(_mm_srai_epi16(_mm_add_epi16(_mm_add_epi16(		\
+		_mm_mullo_epi16(r, cr), _mm_mullo_epi16(g, cg)),		\
+		_mm_add_epi16(_mm_mullo_epi16(b, cb), round)), RGB_SHIFT), c_off)
+
+	for (n = 0; n < unrolled; n += 8) {
+		a0 = _mm_loadu_si128((__m128i*)(s0 + 4*n));
+		a1 = _mm_loadu_si128((__m128i*)(s0 + 4*n + 16));
+		b0 = _mm_loadu_si128((__m128i*)(s1 + 4*n));
+		b1 = _mm_loadu_si128((__m128i*)(s1 + 4*n + 16));
+
+		split_rgb_8(a0, a1, bgr, &r, &g, &b);
+		cy = CALC_Y(r, g, b);
+		_mm_storel_epi64((__m128i*)(y0 + n), _mm_packus_epi16(cy, cy));
+
+		split_rgb_8(b0, b1, bgr, &r, &g, &b);
+		cy = CALC_Y(r, g, b);
+		_mm_storel_epi64((__m128i*)(y1 + n), _mm_packus_epi16(cy, cy));
+
+		/* average 2x2 blocks, vertically and then horizontally */
+		t0 = _mm_avg_epu8(a0, b0);
+		t1 = _mm_avg_epu8(a1, b1);
+		t0 = _mm_avg_epu8(t0, _mm_srli_epi64(t0, 32));
+		t1 = _mm_avg_epu8(t1, _mm_srli_epi64(t1, 32));
+		t0 = _mm_shuffle_epi32(t0, _MM_SHUFFLE(3, 1, 2, 0));
+		t1 = _mm_shuffle_epi32(t1, _MM_SHUFFLE(3, 1, 2, 0));
+
+		split_rgb_8(_mm_unpacklo_epi64(t0, t1), _mm_setzero_si128(), bgr, &r, &g, &b);
+		cu = CALC_C(r, g, b, ur, ug, ub);
+		cv = CALC_C(r, g, b, vr, vg, vb);
+		cu = _mm_packus_epi16(cu, cu);
+		cv = _mm_packus_epi16(cv, cv);
+
+		if (nv12) {
+			_mm_storel_epi64((__m128i*)(u + n), _mm_unpacklo_epi8(cu, cv));
+		} else {
+			uint32_t tu = _mm_cvtsi128_si32(cu), tv = _mm_cvtsi128_si32(cv);
+			memcpy(u + n/2, &tu, 4);
+			memcpy(v + n/2, &tv, 4);
+		}
+	}
+#undef CALC_Y
+#undef CALC_C
+	if (n < width) {
+		const void *s[2] = { s0 + 4*n, s1 + 4*n };
+		void *d[4] = { y0 + n, y1 + n, u + (nv12 ? n : n/2), nv12 ? NULL : v + n/2 };
+		if (nv12)
+			bgr ? conv_bgrx_to_nv12_c(conv, d, s, width - n) :
+				conv_rgbx_to_nv12_c(conv, d, s, width - n);
+		else
+			bgr ? conv_bgrx_to_i420_c(conv, d, s, width - n) :
+				conv_rgbx_to_i420_c(conv, d, s, width - n);
+	}
+}
+
+DEFINE_FUNCTION(rgbx_to_i420, sse2)
+{
+	rgb_to_420_sse2(conv, dst, src, width, false, false);
+}
+
+DEFINE_FUNCTION(bgrx_to_i420, sse2)
+{
+	rgb_to_420_sse2(conv, dst, src, width, true, false);
+}
+
+DEFINE_FUNCTION(rgbx_to_nv12, sse2)
+{
+	rgb_to_420_sse2(conv, dst, src, width, false, true);
+}
+
+DEFINE_FUNCTION(bgrx_to_nv12, sse2)
+{
+	rgb_to_420_sse2(conv, dst, src, width, true, true);
+}
+
+DEFINE_FUNCTION(swap16, sse2)
+{
+	const uint8_t *s = src[0];
+	uint8_t *d = dst[0];
+	uint32_t n, n_bytes = ((width + 1) / 2) * 4, unrolled = n_bytes & ~15;
+	__m128i p;
+
+	for (n = 0; n < unrolled; n += 16) {
+		p = _mm_loadu_si128((__m128i*)(s + n));
+		p = _mm_or_si128(_mm_slli_epi16(p, 8), _mm_srli_epi16(p, 8));
+		_mm_storeu_si128((__m128i*)(d + n), p);
+	}
+	for (; n < n_bytes; n += 2) {
+		uint8_t t = s[n];
+		d[n] = s[n+1];
+		d[n+1] = t;
+	}
+}
+
+DEFINE_FUNCTION(swap_rb, sse2)
+{
+	const uint8_t *s = src[0];
+	uint8_t *d = dst[0];
+	uint32_t n, unrolled = width & ~3;
+	__m128i ga = _mm_set1_epi32(0xff00ff00), mask = _mm_set1_epi32(0xff), p;
+
+	for (n = 0; n < unrolled; n += 4) {
+		p = _mm_loadu_si128((__m128i*)(s + 4*n));
+		p = _mm_or_si128(_mm_and_si128(p, ga),
+			_mm_or_si128(_mm_slli_epi32(_mm_and_si128(p, mask), 16),
+				_mm_and_si128(_mm_srli_epi32(p, 16), mask)));
+		_mm_storeu_si128((__m128i*)(d + 4*n), p);
+	}
+	if (n < width) {
+		const void *ss[1] = { s + 4*n };
+		void *dd[1] = { d + 4*n };
+		conv_swap_rb_c(conv, dd, ss, width - n);
+	}
+}
+
+DEFINE_VSCALE(bilinear, sse2)
+{
+	const uint8_t *s0 = src[0], *s1 = src[1];
+	uint32_t n, n_bytes = width * 4, unrolled = n_bytes & ~15;
+	__m128i w0 = _mm_set1_epi16(weights[0]), w1 = _mm_set1_epi16(weights[1]);
+	__m128i round = _mm_set1_epi16(128), zero = _mm_setzero_si128();
+	__m128i a, b, lo, hi;
+
+	for (n = 0; n < unrolled; n += 16) {
+		a = _mm_loadu_si128((__m128i*)(s0 + n));
+		b = _mm_loadu_si128((__m128i*)(s1 + n));
+		lo = _mm_add_epi16(_mm_add_epi16(
+				_mm_mullo_epi16(_mm_unpacklo_epi8(a, zero), w0),
+				_mm_mullo_epi16(_mm_unpacklo_epi8(b, zero), w1)), round);
+		hi = _mm_add_epi16(_mm_add_epi16(
+				_mm_mullo_epi16(_mm_unpackhi_epi8(a, zero), w0),
+				_mm_mullo_epi16(_mm_unpackhi_epi8(b, zero), w1)), round);
+		_mm_storeu_si128((__m128i*)(dst + n), _mm_packus_epi16(
+				_mm_srli_epi16(lo, 8), _mm_srli_epi16(hi, 8)));
+	}
+	for (; n < n_bytes; n++)
+		dst[n] = (s0[n] * weights[0] + s1[n] * weights[1] + 128) >> 8;
+}
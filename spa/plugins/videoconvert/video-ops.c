@@ -0,0 +1,642 @@
+/* Spa
+ *
+ * Copyright © 2020 Wim Taymans
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the next
+ * paragraph) shall be included in all copies or substantial portions of the
+ * Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+#include <errno.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+
+#include <spa/support/cpu.h>
+#include <spa/utils/defs.h>
+
+#include "video-ops.h"
+
+#define CONV_PAIR	(1 << 0)	/* processes two lines at a time */
+
+typedef void (*convert_func_t) (struct convert *conv, void * SPA_RESTRICT dst[],
+		const void * SPA_RESTRICT src[], uint32_t width);
+typedef void (*hscale_func_t) (struct convert *conv, uint8_t * SPA_RESTRICT dst,
+		const uint8_t * SPA_RESTRICT src, const uint32_t *offsets,
+		const uint16_t *weights, uint32_t n_taps, uint32_t width);
+typedef void (*vscale_func_t) (struct convert *conv, uint8_t * SPA_RESTRICT dst,
+		const uint8_t * SPA_RESTRICT src[], const uint16_t *weights,
+		uint32_t n_taps, uint32_t width);
+typedef void (*unpack_func_t) (struct convert *conv, uint8_t * SPA_RESTRICT dst,
+		const struct video_frame *src, uint32_t y, uint32_t width, uint32_t height);
+typedef void (*pack_func_t) (struct convert *conv, struct video_frame *dst,
+		uint32_t y, const uint8_t * SPA_RESTRICT src[2], uint32_t width);
+typedef void (*matrix_func_t) (struct convert *conv, uint8_t * SPA_RESTRICT row,
+		uint32_t width);
+
+struct format_info {
+	uint32_t format;
+	uint32_t n_planes;
+	uint32_t v_sub;
+	unsigned int is_rgb:1;
+	unpack_func_t unpack;
+	pack_func_t pack;
+};
+
+static const struct format_info format_table[] =
+{
+	{ SPA_VIDEO_FORMAT_YUY2, 1, 1, 0, unpack_yuy2_c, pack_yuy2_c },
+	{ SPA_VIDEO_FORMAT_UYVY, 1, 1, 0, unpack_uyvy_c, pack_uyvy_c },
+	{ SPA_VIDEO_FORMAT_I420, 3, 2, 0, unpack_i420_c, pack_i420_c },
+	{ SPA_VIDEO_FORMAT_NV12, 2, 2, 0, unpack_nv12_c, pack_nv12_c },
+	{ SPA_VIDEO_FORMAT_RGBx, 1, 1, 1, unpack_rgbx_c, pack_rgbx_c },
+	{ SPA_VIDEO_FORMAT_BGRx, 1, 1, 1, unpack_bgrx_c, pack_bgrx_c },
+};
+
+static const struct format_info *find_format_info(uint32_t format)
+{
+	size_t i;
+	for (i = 0; i < SPA_N_ELEMENTS(format_table); i++) {
+		if (format_table[i].format == format)
+			return &format_table[i];
+	}
+	return NULL;
+}
+
+struct conv_info {
+	uint32_t src_fmt;
+	uint32_t dst_fmt;
+	uint32_t flags;
+	uint32_t cpu_flags;
+
+	convert_func_t process;
+};
+
+static struct conv_info conv_table[] =
+{
+	/* packed 4:2:2 to 4:2:0 */
+#if defined (HAVE_AVX2)
+	{ SPA_VIDEO_FORMAT_YUY2, SPA_VIDEO_FORMAT_I420, CONV_PAIR, SPA_CPU_FLAG_AVX2, conv_yuy2_to_i420_avx2 },
+	{ SPA_VIDEO_FORMAT_UYVY, SPA_VIDEO_FORMAT_I420, CONV_PAIR, SPA_CPU_FLAG_AVX2, conv_uyvy_to_i420_avx2 },
+	{ SPA_VIDEO_FORMAT_YUY2, SPA_VIDEO_FORMAT_NV12, CONV_PAIR, SPA_CPU_FLAG_AVX2, conv_yuy2_to_nv12_avx2 },
+	{ SPA_VIDEO_FORMAT_UYVY, SPA_VIDEO_FORMAT_NV12, CONV_PAIR, SPA_CPU_FLAG_AVX2, conv_uyvy_to_nv12_avx2 },
+#endif
+#if defined (HAVE_SSE2)
+	{ SPA_VIDEO_FORMAT_YUY2, SPA_VIDEO_FORMAT_I420, CONV_PAIR, SPA_CPU_FLAG_SSE2, conv_yuy2_to_i420_sse2 },
+	{ SPA_VIDEO_FORMAT_UYVY, SPA_VIDEO_FORMAT_I420, CONV_PAIR, SPA_CPU_FLAG_SSE2, conv_uyvy_to_i420_sse2 },
+	{ SPA_VIDEO_FORMAT_YUY2, SPA_VIDEO_FORMAT_NV12, CONV_PAIR, SPA_CPU_FLAG_SSE2, conv_yuy2_to_nv12_sse2 },
+	{ SPA_VIDEO_FORMAT_UYVY, SPA_VIDEO_FORMAT_NV12, CONV_PAIR, SPA_CPU_FLAG_SSE2, conv_uyvy_to_nv12_sse2 },
+#endif
+	{ SPA_VIDEO_FORMAT_YUY2, SPA_VIDEO_FORMAT_I420, CONV_PAIR, 0, conv_yuy2_to_i420_c },
+	{ SPA_VIDEO_FORMAT_UYVY, SPA_VIDEO_FORMAT_I420, CONV_PAIR, 0, conv_uyvy_to_i420_c },
+	{ SPA_VIDEO_FORMAT_YUY2, SPA_VIDEO_FORMAT_NV12, CONV_PAIR, 0, conv_yuy2_to_nv12_c },
+	{ SPA_VIDEO_FORMAT_UYVY, SPA_VIDEO_FORMAT_NV12, CONV_PAIR, 0, conv_uyvy_to_nv12_c },
+
+	/* 4:2:0 to packed 4:2:2 */
+#if defined (HAVE_SSE2)
+	{ SPA_VIDEO_FORMAT_I420, SPA_VIDEO_FORMAT_YUY2, 0, SPA_CPU_FLAG_SSE2, conv_i420_to_yuy2_sse2 },
+	{ SPA_VIDEO_FORMAT_I420, SPA_VIDEO_FORMAT_UYVY, 0, SPA_CPU_FLAG_SSE2, conv_i420_to_uyvy_sse2 },
+	{ SPA_VIDEO_FORMAT_NV12, SPA_VIDEO_FORMAT_YUY2, 0, SPA_CPU_FLAG_SSE2, conv_nv12_to_yuy2_sse2 },
+	{ SPA_VIDEO_FORMAT_NV12, SPA_VIDEO_FORMAT_UYVY, 0, SPA_CPU_FLAG_SSE2, conv_nv12_to_uyvy_sse2 },
+#endif
+	{ SPA_VIDEO_FORMAT_I420, SPA_VIDEO_FORMAT_YUY2, 0, 0, conv_i420_to_yuy2_c },
+	{ SPA_VIDEO_FORMAT_I420, SPA_VIDEO_FORMAT_UYVY, 0, 0, conv_i420_to_uyvy_c },
+	{ SPA_VIDEO_FORMAT_NV12, SPA_VIDEO_FORMAT_YUY2, 0, 0, conv_nv12_to_yuy2_c },
+	{ SPA_VIDEO_FORMAT_NV12, SPA_VIDEO_FORMAT_UYVY, 0, 0, conv_nv12_to_uyvy_c },
+
+	/* 4:2:0 planar <-> semi-planar */
+#if defined (HAVE_SSE2)
+	{ SPA_VIDEO_FORMAT_I420, SPA_VIDEO_FORMAT_NV12, CONV_PAIR, SPA_CPU_FLAG_SSE2, conv_i420_to_nv12_sse2 },
+	{ SPA_VIDEO_FORMAT_NV12, SPA_VIDEO_FORMAT_I420, CONV_PAIR, SPA_CPU_FLAG_SSE2, conv_nv12_to_i420_sse2 },
+#endif
+	{ SPA_VIDEO_FORMAT_I420, SPA_VIDEO_FORMAT_NV12, CONV_PAIR, 0, conv_i420_to_nv12_c },
+	{ SPA_VIDEO_FORMAT_NV12, SPA_VIDEO_FORMAT_I420, CONV_PAIR, 0, conv_nv12_to_i420_c },
+
+	/* YUV to RGB */
+#if defined (HAVE_AVX2)
+	{ SPA_VIDEO_FORMAT_I420, SPA_VIDEO_FORMAT_RGBx, 0, SPA_CPU_FLAG_AVX2, conv_i420_to_rgbx_avx2 },
+	{ SPA_VIDEO_FORMAT_I420, SPA_VIDEO_FORMAT_BGRx, 0, SPA_CPU_FLAG_AVX2, conv_i420_to_bgrx_avx2 },
+	{ SPA_VIDEO_FORMAT_NV12, SPA_VIDEO_FORMAT_RGBx, 0, SPA_CPU_FLAG_AVX2, conv_nv12_to_rgbx_avx2 },
+	{ SPA_VIDEO_FORMAT_NV12, SPA_VIDEO_FORMAT_BGRx, 0, SPA_CPU_FLAG_AVX2, conv_nv12_to_bgrx_avx2 },
+#endif
+#if defined (HAVE_SSE2)
+	{ SPA_VIDEO_FORMAT_I420, SPA_VIDEO_FORMAT_RGBx, 0, SPA_CPU_FLAG_SSE2, conv_i420_to_rgbx_sse2 },
+	{ SPA_VIDEO_FORMAT_I420, SPA_VIDEO_FORMAT_BGRx, 0, SPA_CPU_FLAG_SSE2, conv_i420_to_bgrx_sse2 },
+	{ SPA_VIDEO_FORMAT_NV12, SPA_VIDEO_FORMAT_RGBx, 0, SPA_CPU_FLAG_SSE2, conv_nv12_to_rgbx_sse2 },
+	{ SPA_VIDEO_FORMAT_NV12, SPA_VIDEO_FORMAT_BGRx, 0, SPA_CPU_FLAG_SSE2, conv_nv12_to_bgrx_sse2 },
+	{ SPA_VIDEO_FORMAT_YUY2, SPA_VIDEO_FORMAT_RGBx, 0, SPA_CPU_FLAG_SSE2, conv_yuy2_to_rgbx_sse2 },
+	{ SPA_VIDEO_FORMAT_YUY2, SPA_VIDEO_FORMAT_BGRx, 0, SPA_CPU_FLAG_SSE2, conv_yuy2_to_bgrx_sse2 },
+	{ SPA_VIDEO_FORMAT_UYVY, SPA_VIDEO_FORMAT_RGBx, 0, SPA_CPU_FLAG_SSE2, conv_uyvy_to_rgbx_sse2 },
+	{ SPA_VIDEO_FORMAT_UYVY, SPA_VIDEO_FORMAT_BGRx, 0, SPA_CPU_FLAG_SSE2, conv_uyvy_to_bgrx_sse2 },
+#endif
+	{ SPA_VIDEO_FORMAT_I420, SPA_VIDEO_FORMAT_RGBx, 0, 0, conv_i420_to_rgbx_c },
+	{ SPA_VIDEO_FORMAT_I420, SPA_VIDEO_FORMAT_BGRx, 0, 0, conv_i420_to_bgrx_c },
+	{ SPA_VIDEO_FORMAT_NV12, SPA_VIDEO_FORMAT_RGBx, 0, 0, conv_nv12_to_rgbx_c },
+	{ SPA_VIDEO_FORMAT_NV12, SPA_VIDEO_FORMAT_BGRx, 0, 0, conv_nv12_to_bgrx_c },
+	{ SPA_VIDEO_FORMAT_YUY2, SPA_VIDEO_FORMAT_RGBx, 0, 0, conv_yuy2_to_rgbx_c },
+	{ SPA_VIDEO_FORMAT_YUY2, SPA_VIDEO_FORMAT_BGRx, 0, 0, conv_yuy2_to_bgrx_c },
+	{ SPA_VIDEO_FORMAT_UYVY, SPA_VIDEO_FORMAT_RGBx, 0, 0, conv_uyvy_to_rgbx_c },
+	{ SPA_VIDEO_FORMAT_UYVY, SPA_VIDEO_FORMAT_BGRx, 0, 0, conv_uyvy_to_bgrx_c },
+
+	/* RGB to YUV */
+#if defined (HAVE_SSE2)
+	{ SPA_VIDEO_FORMAT_RGBx, SPA_VIDEO_FORMAT_I420, CONV_PAIR, SPA_CPU_FLAG_SSE2, conv_rgbx_to_i420_sse2 },
+	{ SPA_VIDEO_FORMAT_BGRx, SPA_VIDEO_FORMAT_I420, CONV_PAIR, SPA_CPU_FLAG_SSE2, conv_bgrx_to_i420_sse2 },
+	{ SPA_VIDEO_FORMAT_RGBx, SPA_VIDEO_FORMAT_NV12, CONV_PAIR, SPA_CPU_FLAG_SSE2, conv_rgbx_to_nv12_sse2 },
+	{ SPA_VIDEO_FORMAT_BGRx, SPA_VIDEO_FORMAT_NV12, CONV_PAIR, SPA_CPU_FLAG_SSE2, conv_bgrx_to_nv12_sse2 },
+#endif
+	{ SPA_VIDEO_FORMAT_RGBx, SPA_VIDEO_FORMAT_I420, CONV_PAIR, 0, conv_rgbx_to_i420_c },
+	{ SPA_VIDEO_FORMAT_BGRx, SPA_VIDEO_FORMAT_I420, CONV_PAIR, 0, conv_bgrx_to_i420_c },
+	{ SPA_VIDEO_FORMAT_RGBx, SPA_VIDEO_FORMAT_NV12, CONV_PAIR, 0, conv_rgbx_to_nv12_c },
+	{ SPA_VIDEO_FORMAT_BGRx, SPA_VIDEO_FORMAT_NV12, CONV_PAIR, 0, conv_bgrx_to_nv12_c },
+	{ SPA_VIDEO_FORMAT_RGBx, SPA_VIDEO_FORMAT_YUY2, 0, 0, conv_rgbx_to_yuy2_c },
+	{ SPA_VIDEO_FORMAT_BGRx, SPA_VIDEO_FORMAT_YUY2, 0, 0, conv_bgrx_to_yuy2_c },
+	{ SPA_VIDEO_FORMAT_RGBx, SPA_VIDEO_FORMAT_UYVY, 0, 0, conv_rgbx_to_uyvy_c },
+	{ SPA_VIDEO_FORMAT_BGRx, SPA_VIDEO_FORMAT_UYVY, 0, 0, conv_bgrx_to_uyvy_c },
+
+	/* swizzle */
+#if defined (HAVE_AVX2)
+	{ SPA_VIDEO_FORMAT_RGBx, SPA_VIDEO_FORMAT_BGRx, 0, SPA_CPU_FLAG_AVX2, conv_swap_rb_avx2 },
+	{ SPA_VIDEO_FORMAT_BGRx, SPA_VIDEO_FORMAT_RGBx, 0, SPA_CPU_FLAG_AVX2, conv_swap_rb_avx2 },
+#endif
+#if defined (HAVE_SSE2)
+	{ SPA_VIDEO_FORMAT_YUY2, SPA_VIDEO_FORMAT_UYVY, 0, SPA_CPU_FLAG_SSE2, conv_swap16_sse2 },
+	{ SPA_VIDEO_FORMAT_UYVY, SPA_VIDEO_FORMAT_YUY2, 0, SPA_CPU_FLAG_SSE2, conv_swap16_sse2 },
+	{ SPA_VIDEO_FORMAT_RGBx, SPA_VIDEO_FORMAT_BGRx, 0, SPA_CPU_FLAG_SSE2, conv_swap_rb_sse2 },
+	{ SPA_VIDEO_FORMAT_BGRx, SPA_VIDEO_FORMAT_RGBx, 0, SPA_CPU_FLAG_SSE2, conv_swap_rb_sse2 },
+#endif
+	{ SPA_VIDEO_FORMAT_YUY2, SPA_VIDEO_FORMAT_UYVY, 0, 0, conv_swap16_c },
+	{ SPA_VIDEO_FORMAT_UYVY, SPA_VIDEO_FORMAT_YUY2, 0, 0, conv_swap16_c },
+	{ SPA_VIDEO_FORMAT_RGBx, SPA_VIDEO_FORMAT_BGRx, 0, 0, conv_swap_rb_c },
+	{ SPA_VIDEO_FORMAT_BGRx, SPA_VIDEO_FORMAT_RGBx, 0, 0, conv_swap_rb_c },
+};
+
+#define MATCH_CPU_FLAGS(a,b)	((a) == 0 || ((a) & (b)) == a)
+
+static const struct conv_info *find_conv_info(uint32_t src_fmt, uint32_t dst_fmt,
+		uint32_t cpu_flags)
+{
+	size_t i;
+
+	for (i = 0; i < SPA_N_ELEMENTS(conv_table); i++) {
+		if (conv_table[i].src_fmt == src_fmt &&
+		    conv_table[i].dst_fmt == dst_fmt &&
+		    MATCH_CPU_FLAGS(conv_table[i].cpu_flags, cpu_flags))
+			return &conv_table[i];
+	}
+	return NULL;
+}
+
+struct scaler {
+	uint32_t n_taps;		/* 0 when not scaling */
+	uint32_t *offsets;
+	uint16_t *weights;
+};
+
+struct slice {
+	uint8_t *tmp;			/* unpacked source row */
+	uint8_t *ring;			/* horizontally scaled source rows */
+	uint32_t *ring_row;		/* source row in each ring slot */
+	uint8_t *out[2];		/* vertically scaled rows */
+};
+
+struct impl {
+	const struct format_info *src_info;
+	const struct format_info *dst_info;
+
+	convert_func_t func;
+	uint32_t flags;
+
+	struct scaler h;
+	struct scaler v;
+	hscale_func_t hscale;
+	vscale_func_t vscale;
+	matrix_func_t matrix;
+	uint32_t ring_size;
+	uint32_t rows_per_slice;
+
+	struct slice slices[];
+};
+
+static inline size_t row_bytes(const struct format_info *info, uint32_t plane, uint32_t width)
+{
+	switch (info->format) {
+	case SPA_VIDEO_FORMAT_YUY2:
+	case SPA_VIDEO_FORMAT_UYVY:
+		return ((width + 1) / 2) * 4;
+	case SPA_VIDEO_FORMAT_I420:
+		return plane == 0 ? width : (width + 1) / 2;
+	case SPA_VIDEO_FORMAT_NV12:
+		return plane == 0 ? width : ((width + 1) / 2) * 2;
+	default:
+		return width * 4;
+	}
+}
+
+uint32_t video_layout(uint32_t format, uint32_t width, uint32_t height, int32_t stride,
+		uint32_t offsets[VIDEO_MAX_PLANES], int32_t strides[VIDEO_MAX_PLANES])
+{
+	const struct format_info *info;
+	uint32_t i, size, ch = (height + 1) / 2;
+
+	if ((info = find_format_info(format)) == NULL)
+		return 0;
+
+	if (stride <= 0)
+		stride = SPA_ROUND_UP_N(row_bytes(info, 0, width), 4);
+
+	for (i = 0; i < VIDEO_MAX_PLANES; i++) {
+		offsets[i] = 0;
+		strides[i] = 0;
+	}
+	strides[0] = stride;
+	size = stride * height;
+
+	switch (format) {
+	case SPA_VIDEO_FORMAT_I420:
+		strides[1] = strides[2] = SPA_ROUND_UP_N(SPA_ROUND_UP_N(stride, 2) / 2, 4);
+		offsets[1] = size;
+		offsets[2] = offsets[1] + strides[1] * ch;
+		size = offsets[2] + strides[2] * ch;
+		break;
+	case SPA_VIDEO_FORMAT_NV12:
+		strides[1] = stride;
+		offsets[1] = size;
+		size = offsets[1] + strides[1] * ch;
+		break;
+	default:
+		break;
+	}
+	return size;
+}
+
+void convert_slice(struct convert *conv, uint32_t slice, uint32_t *start, uint32_t *end)
+{
+	struct impl *impl = conv->data;
+
+	*start = SPA_MIN(slice * impl->rows_per_slice, conv->dst_height);
+	*end = SPA_MIN(*start + impl->rows_per_slice, conv->dst_height);
+}
+
+static inline void *get_row(const struct video_frame *frame, uint32_t plane, uint32_t y)
+{
+	return SPA_MEMBER(frame->data[plane], y * frame->stride[plane], void);
+}
+
+static inline void get_rows(const struct format_info *info, const struct video_frame *frame,
+		uint32_t y0, uint32_t y1, bool pair, void *rows[])
+{
+	uint32_t i, n = 0;
+
+	rows[n++] = get_row(frame, 0, y0);
+	if (pair)
+		rows[n++] = get_row(frame, 0, y1);
+	for (i = 1; i < info->n_planes; i++)
+		rows[n++] = get_row(frame, i, y0 / info->v_sub);
+}
+
+static void impl_process_copy(struct convert *conv, uint32_t slice,
+		struct video_frame *dst, const struct video_frame *src)
+{
+	struct impl *impl = conv->data;
+	const struct format_info *info = impl->dst_info;
+	uint32_t i, y, start, end;
+
+	convert_slice(conv, slice, &start, &end);
+
+	for (i = 0; i < info->n_planes; i++) {
+		uint32_t sub = i == 0 ? 1 : info->v_sub;
+		size_t n = row_bytes(info, i, conv->dst_width);
+
+		for (y = start / sub; y < (end + sub - 1) / sub; y++)
+			memcpy(get_row(dst, i, y), get_row(src, i, y), n);
+	}
+}
+
+static void impl_process_fast(struct convert *conv, uint32_t slice,
+		struct video_frame *dst, const struct video_frame *src)
+{
+	struct impl *impl = conv->data;
+	bool pair = SPA_FLAG_IS_SET(impl->flags, CONV_PAIR);
+	uint32_t y, start, end, step = pair ? 2 : 1;
+	const void *s[VIDEO_MAX_PLANES + 1];
+	void *d[VIDEO_MAX_PLANES + 1];
+
+	convert_slice(conv, slice, &start, &end);
+
+	for (y = start; y < end; y += step) {
+		/* for odd heights, the last line is converted twice */
+		uint32_t y1 = SPA_MIN(y + 1, conv->dst_height - 1);
+
+		get_rows(impl->src_info, src, y, y1, pair, (void**)s);
+		get_rows(impl->dst_info, dst, y, y1, pair, d);
+		impl->func(conv, d, s, conv->dst_width);
+	}
+}
+
+static inline uint8_t *scaled_row(struct convert *conv, struct impl *impl,
+		struct slice *sl, const struct video_frame *src, uint32_t row)
+{
+	uint32_t slot = row % impl->ring_size;
+	uint8_t *p = sl->ring + slot * conv->dst_width * 4;
+
+	if (sl->ring_row[slot] == row)
+		return p;
+
+	if (impl->h.n_taps == 0) {
+		impl->src_info->unpack(conv, p, src, row, conv->src_width, conv->src_height);
+	} else {
+		impl->src_info->unpack(conv, sl->tmp, src, row, conv->src_width, conv->src_height);
+		impl->hscale(conv, p, sl->tmp, impl->h.offsets, impl->h.weights,
+				impl->h.n_taps, conv->dst_width);
+	}
+	if (impl->matrix)
+		impl->matrix(conv, p, conv->dst_width);
+
+	sl->ring_row[slot] = row;
+	return p;
+}
+
+static void impl_process_generic(struct convert *conv, uint32_t slice,
+		struct video_frame *dst, const struct video_frame *src)
+{
+	struct impl *impl = conv->data;
+	struct slice *sl = &impl->slices[slice];
+	uint32_t i, j, y, start, end, v_sub = impl->dst_info->v_sub;
+	const uint8_t *rows[2], *taps[impl->v.n_taps + 1];
+
+	convert_slice(conv, slice, &start, &end);
+
+	for (i = 0; i < impl->ring_size; i++)
+		sl->ring_row[i] = SPA_ID_INVALID;
+
+	for (y = start; y < end; y += v_sub) {
+		for (i = 0; i < v_sub; i++) {
+			uint32_t oy = SPA_MIN(y + i, conv->dst_height - 1);
+
+			if (impl->v.n_taps == 0) {
+				rows[i] = scaled_row(conv, impl, sl, src, oy);
+			} else {
+				uint32_t offs = impl->v.offsets[oy];
+				for (j = 0; j < impl->v.n_taps; j++)
+					taps[j] = scaled_row(conv, impl, sl, src, offs + j);
+				impl->vscale(conv, sl->out[i], taps,
+						&impl->v.weights[oy * impl->v.n_taps],
+						impl->v.n_taps, conv->dst_width);
+				rows[i] = sl->out[i];
+			}
+		}
+		if (v_sub == 1)
+			rows[1] = rows[0];
+		impl->dst_info->pack(conv, dst, y, rows, conv->dst_width);
+	}
+}
+
+static uint32_t scaler_taps(uint32_t src_len, uint32_t dst_len, uint32_t method)
+{
+	uint32_t n_taps;
+
+	if (src_len == dst_len)
+		return 0;
+	if (method == VIDEO_SCALE_AUTO)
+		method = src_len > dst_len ? VIDEO_SCALE_AREA : VIDEO_SCALE_BILINEAR;
+	if (method == VIDEO_SCALE_AREA)
+		n_taps = (src_len + dst_len - 1) / dst_len + 1;
+	else
+		n_taps = 2;
+	return SPA_MIN(n_taps, src_len);
+}
+
+static void scaler_build(struct scaler *s, uint32_t src_len, uint32_t dst_len, uint32_t method)
+{
+	double scale = (double)src_len / dst_len;
+	uint32_t i, j, n_taps = s->n_taps;
+
+	if (method == VIDEO_SCALE_AUTO)
+		method = src_len > dst_len ? VIDEO_SCALE_AREA : VIDEO_SCALE_BILINEAR;
+
+	for (i = 0; i < dst_len; i++) {
+		double w[n_taps], start, end;
+		uint16_t *q = &s->weights[i * n_taps];
+		uint32_t first, offs, sum, max;
+
+		for (j = 0; j < n_taps; j++)
+			w[j] = 0.0;
+
+		if (method == VIDEO_SCALE_AREA) {
+			start = i * scale;
+			end = SPA_MIN((i + 1) * scale, (double)src_len);
+			first = (uint32_t)floor(start);
+		} else {
+			start = SPA_CLAMP((i + 0.5) * scale - 0.5, 0.0, src_len - 1.0);
+			first = (uint32_t)floor(start);
+			end = 0.0;
+		}
+		offs = SPA_MIN(first, src_len - n_taps);
+
+		if (method == VIDEO_SCALE_AREA) {
+			for (j = first; j < src_len && j < end; j++) {
+				double cov = SPA_MIN(end, j + 1.0) - SPA_MAX(start, (double)j);
+				if (cov > 0.0)
+					w[j - offs] = cov / (end - start);
+			}
+		} else {
+			double frac = start - first;
+			w[first - offs] = 1.0 - frac;
+			if (first + 1 < src_len)
+				w[first + 1 - offs] = frac;
+		}
+
+		/* quantize, keeping the sum of the weights exact */
+		for (j = 0, sum = 0, max = 0; j < n_taps; j++) {
+			q[j] = (uint16_t)lrint(w[j] * 256.0);
+			sum += q[j];
+			if (q[j] > q[max])
+				max = j;
+		}
+		q[max] += 256 - sum;
+		s->offsets[i] = offs;
+	}
+}
+
+static void impl_convert_free(struct convert *conv)
+{
+	conv->process = NULL;
+	free(conv->data);
+	conv->data = NULL;
+}
+
+static const struct {
+	uint32_t matrix;
+	int16_t y, rv, gu, gv, bu;
+	int16_t yr, yg, yb, ur, ug, ub, vr, vg, vb;
+} matrices[] = {
+	{ SPA_VIDEO_COLOR_MATRIX_BT601, 9539, 13075, -3209, -6660, 16525,
+		66, 129, 25, -38, -74, 112, 112, -94, -18 },
+	{ SPA_VIDEO_COLOR_MATRIX_BT709, 9539, 14686, -1747, -4366, 17305,
+		47, 157, 16, -26, -87, 112, 112, -102, -10 },
+};
+
+static void setup_matrix(struct convert *conv)
+{
+	uint32_t i = conv->matrix == SPA_VIDEO_COLOR_MATRIX_BT709 ? 1 : 0;
+
+	conv->to_rgb.y = matrices[i].y;
+	conv->to_rgb.rv = matrices[i].rv;
+	conv->to_rgb.gu = matrices[i].gu;
+	conv->to_rgb.gv = matrices[i].gv;
+	conv->to_rgb.bu = matrices[i].bu;
+	conv->to_yuv.yr = matrices[i].yr;
+	conv->to_yuv.yg = matrices[i].yg;
+	conv->to_yuv.yb = matrices[i].yb;
+	conv->to_yuv.ur = matrices[i].ur;
+	conv->to_yuv.ug = matrices[i].ug;
+	conv->to_yuv.ub = matrices[i].ub;
+	conv->to_yuv.vr = matrices[i].vr;
+	conv->to_yuv.vg = matrices[i].vg;
+	conv->to_yuv.vb = matrices[i].vb;
+}
+
+#define ALIGN_SIZE(s)	SPA_ROUND_UP_N(s, 64)
+
+int convert_init(struct convert *conv)
+{
+	const struct format_info *src_info, *dst_info;
+	const struct conv_info *info = NULL;
+	struct impl *impl;
+	uint32_t i, h_taps, v_taps, ring_size, rows, cpu_flags = conv->cpu_flags;
+	size_t size, tables, slice_size;
+	uint8_t *p;
+	bool scale;
+
+	src_info = find_format_info(conv->src_fmt);
+	dst_info = find_format_info(conv->dst_fmt);
+	if (src_info == NULL || dst_info == NULL)
+		return -ENOTSUP;
+	if (conv->src_width == 0 || conv->src_height == 0 ||
+	    conv->dst_width == 0 || conv->dst_height == 0)
+		return -EINVAL;
+
+	setup_matrix(conv);
+
+	scale = conv->src_width != conv->dst_width ||
+		conv->src_height != conv->dst_height;
+
+	conv->is_passthrough = !scale && conv->src_fmt == conv->dst_fmt;
+	if (!scale && !conv->is_passthrough)
+		info = find_conv_info(conv->src_fmt, conv->dst_fmt, conv->cpu_flags);
+
+	/* slices start on an even row so that they don't share chroma rows */
+	conv->n_slices = SPA_CLAMP(conv->n_slices, 1u, (conv->dst_height + 1) / 2);
+	rows = (conv->dst_height + conv->n_slices - 1) / conv->n_slices;
+	rows = SPA_ROUND_UP_N(rows, 2);
+	conv->n_slices = (conv->dst_height + rows - 1) / rows;
+
+	h_taps = scaler_taps(conv->src_width, conv->dst_width, conv->scale);
+	v_taps = scaler_taps(conv->src_height, conv->dst_height, conv->scale);
+	ring_size = SPA_MAX(v_taps, 2u);
+
+	size = ALIGN_SIZE(sizeof(struct impl) + conv->n_slices * sizeof(struct slice));
+	tables = 0;
+	slice_size = 0;
+	if (!conv->is_passthrough && info == NULL) {
+		tables = ALIGN_SIZE(conv->dst_width * (sizeof(uint32_t) + h_taps * sizeof(uint16_t))) +
+			ALIGN_SIZE(conv->dst_height * (sizeof(uint32_t) + v_taps * sizeof(uint16_t)));
+		slice_size = ALIGN_SIZE(conv->src_width * 4) +
+			ALIGN_SIZE(ring_size * conv->dst_width * 4) +
+			ALIGN_SIZE(ring_size * sizeof(uint32_t)) +
+			2 * ALIGN_SIZE(conv->dst_width * 4);
+	}
+
+	if ((impl = calloc(1, size + tables + conv->n_slices * slice_size + 64)) == NULL)
+		return -errno;
+
+	impl->src_info = src_info;
+	impl->dst_info = dst_info;
+	impl->rows_per_slice = rows;
+
+	conv->data = impl;
+	conv->free = impl_convert_free;
+
+	if (conv->is_passthrough) {
+		conv->cpu_flags = 0;
+		conv->process = impl_process_copy;
+	} else if (info != NULL) {
+		conv->cpu_flags = info->cpu_flags;
+		impl->func = info->process;
+		impl->flags = info->flags;
+		conv->process = impl_process_fast;
+	} else {
+		p = SPA_PTR_ALIGN(SPA_MEMBER(impl, size, void), 64, uint8_t);
+
+		impl->h.n_taps = h_taps;
+		impl->h.offsets = (uint32_t*)p;
+		impl->h.weights = (uint16_t*)(p + conv->dst_width * sizeof(uint32_t));
+		p += ALIGN_SIZE(conv->dst_width * (sizeof(uint32_t) + h_taps * sizeof(uint16_t)));
+		impl->v.n_taps = v_taps;
+		impl->v.offsets = (uint32_t*)p;
+		impl->v.weights = (uint16_t*)(p + conv->dst_height * sizeof(uint32_t));
+		p += ALIGN_SIZE(conv->dst_height * (sizeof(uint32_t) + v_taps * sizeof(uint16_t)));
+
+		if (h_taps > 0)
+			scaler_build(&impl->h, conv->src_width, conv->dst_width, conv->scale);
+		if (v_taps > 0)
+			scaler_build(&impl->v, conv->src_height, conv->dst_height, conv->scale);
+
+		impl->ring_size = ring_size;
+		for (i = 0; i < conv->n_slices; i++) {
+			struct slice *sl = &impl->slices[i];
+			sl->tmp = p;
+			p += ALIGN_SIZE(conv->src_width * 4);
+			sl->ring = p;
+			p += ALIGN_SIZE(ring_size * conv->dst_width * 4);
+			sl->ring_row = (uint32_t*)p;
+			p += ALIGN_SIZE(ring_size * sizeof(uint32_t));
+			sl->out[0] = p;
+			p += ALIGN_SIZE(conv->dst_width * 4);
+			sl->out[1] = p;
+			p += ALIGN_SIZE(conv->dst_width * 4);
+		}
+
+		impl->hscale = h_taps == 2 ? hscale_bilinear_c : hscale_ntap_c;
+		impl->vscale = vscale_ntap_c;
+		conv->cpu_flags = 0;
+		if (v_taps == 2) {
+			impl->vscale = vscale_bilinear_c;
+#if defined (HAVE_AVX2)
+			if (cpu_flags & SPA_CPU_FLAG_AVX2) {
+				impl->vscale = vscale_bilinear_avx2;
+				conv->cpu_flags = SPA_CPU_FLAG_AVX2;
+			} else
+#endif
+#if defined (HAVE_SSE2)
+			if (cpu_flags & SPA_CPU_FLAG_SSE2) {
+				impl->vscale = vscale_bilinear_sse2;
+				conv->cpu_flags = SPA_CPU_FLAG_SSE2;
+			}
+#endif
+		}
+		if (src_info->is_rgb && !dst_info->is_rgb)
+			impl->matrix = matrix_rgb_to_yuv_c;
+		else if (!src_info->is_rgb && dst_info->is_rgb)
+			impl->matrix = matrix_yuv_to_rgb_c;
+
+		conv->process = impl_process_generic;
+	}
+	return 0;
+}
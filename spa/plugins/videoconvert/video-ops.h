@@ -0,0 +1,257 @@
+/* Spa
+ *
+ * Copyright © 2020 Wim Taymans
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the next
+ * paragraph) shall be included in all copies or substantial portions of the
+ * Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+#include <stdbool.h>
+
+#include <spa/utils/defs.h>
+#include <spa/param/video/raw.h>
+
+#define VIDEO_MAX_PLANES	4
+
+/* YUV <-> RGB in BT.601/BT.709 limited range. YUV to RGB uses 13 bit
+ * coefficients, RGB to YUV 8 bit ones. The SIMD versions produce exactly
+ * the same results as the C code. */
+#define YUV_SHIFT	13
+#define RGB_SHIFT	8
+
+enum video_scale {
+	VIDEO_SCALE_AUTO,	/* area when downscaling, bilinear otherwise */
+	VIDEO_SCALE_BILINEAR,
+	VIDEO_SCALE_AREA,
+};
+
+struct video_frame {
+	void *data[VIDEO_MAX_PLANES];
+	int32_t stride[VIDEO_MAX_PLANES];
+};
+
+struct convert {
+	uint32_t src_fmt;
+	uint32_t dst_fmt;
+	uint32_t src_width;
+	uint32_t src_height;
+	uint32_t dst_width;
+	uint32_t dst_height;
+	uint32_t matrix;
+	uint32_t scale;
+	uint32_t n_slices;
+	uint32_t cpu_flags;
+
+	unsigned int is_passthrough:1;
+
+	struct {
+		int16_t y, rv, gu, gv, bu;
+	} to_rgb;
+	struct {
+		int16_t yr, yg, yb;
+		int16_t ur, ug, ub;
+		int16_t vr, vg, vb;
+	} to_yuv;
+
+	void (*process) (struct convert *conv, uint32_t slice,
+			struct video_frame *dst, const struct video_frame *src);
+	void (*free) (struct convert *conv);
+
+	void *data;
+};
+
+int convert_init(struct convert *conv);
+
+/** the rows [start, end) of the destination that make up slice.
+ * Slices can be processed concurrently from different threads. */
+void convert_slice(struct convert *conv, uint32_t slice, uint32_t *start, uint32_t *end);
+
+/** the size and plane layout of a frame of format with the given stride
+ * of the first plane, or a default stride when 0. */
+uint32_t video_layout(uint32_t format, uint32_t width, uint32_t height, int32_t stride,
+		uint32_t offsets[VIDEO_MAX_PLANES], int32_t strides[VIDEO_MAX_PLANES]);
+
+#define convert_process_slice(conv,...)	(conv)->process(conv, __VA_ARGS__)
+#define convert_free(conv)		(conv)->free(conv)
+
+static inline void convert_process(struct convert *conv,
+		struct video_frame *dst, const struct video_frame *src)
+{
+	uint32_t i;
+	for (i = 0; i < conv->n_slices; i++)
+		convert_process_slice(conv, i, dst, src);
+}
+
+static inline uint8_t clamp_u8(int32_t v)
+{
+	return v < 0 ? 0 : v > 255 ? 255 : v;
+}
+
+static inline uint8_t avg_u8(uint8_t a, uint8_t b)
+{
+	return (a + b + 1) >> 1;
+}
+
+static inline void yuv_to_rgb(const struct convert *conv, int32_t y, int32_t u, int32_t v,
+		uint8_t *r, uint8_t *g, uint8_t *b)
+{
+	y = (y - 16) * conv->to_rgb.y + (1 << (YUV_SHIFT - 1));
+	u -= 128;
+	v -= 128;
+	*r = clamp_u8((y + v * conv->to_rgb.rv) >> YUV_SHIFT);
+	*g = clamp_u8((y + u * conv->to_rgb.gu + v * conv->to_rgb.gv) >> YUV_SHIFT);
+	*b = clamp_u8((y + u * conv->to_rgb.bu) >> YUV_SHIFT);
+}
+
+static inline uint8_t rgb_to_y(const struct convert *conv, int32_t r, int32_t g, int32_t b)
+{
+	return ((r * conv->to_yuv.yr + g * conv->to_yuv.yg + b * conv->to_yuv.yb +
+			(1 << (RGB_SHIFT - 1))) >> RGB_SHIFT) + 16;
+}
+
+static inline uint8_t rgb_to_u(const struct convert *conv, int32_t r, int32_t g, int32_t b)
+{
+	return ((r * conv->to_yuv.ur + g * conv->to_yuv.ug + b * conv->to_yuv.ub +
+			(1 << (RGB_SHIFT - 1))) >> RGB_SHIFT) + 128;
+}
+
+static inline uint8_t rgb_to_v(const struct convert *conv, int32_t r, int32_t g, int32_t b)
+{
+	return ((r * conv->to_yuv.vr + g * conv->to_yuv.vg + b * conv->to_yuv.vb +
+			(1 << (RGB_SHIFT - 1))) >> RGB_SHIFT) + 128;
+}
+
+/* Line functions get the row pointers of each plane in src and dst. For
+ * 4:2:0 formats the chroma rows are shared by two lines:
+ *
+ *  line: YUY2/UYVY/RGBx/BGRx { row }, I420 { Y, U, V }, NV12 { Y, UV }
+ *  pair: YUY2/UYVY/RGBx/BGRx { row0, row1 }, I420 { Y0, Y1, U, V }, NV12 { Y0, Y1, UV }
+ */
+#define DEFINE_FUNCTION(name,arch) \
+void conv_##name##_##arch(struct convert *conv, void * SPA_RESTRICT dst[],	\
+		const void * SPA_RESTRICT src[], uint32_t width)
+
+/* scaler kernels on rows of 4 byte pixels */
+#define DEFINE_HSCALE(name,arch) \
+void hscale_##name##_##arch(struct convert *conv, uint8_t * SPA_RESTRICT dst,	\
+		const uint8_t * SPA_RESTRICT src, const uint32_t *offsets,	\
+		const uint16_t *weights, uint32_t n_taps, uint32_t width)
+#define DEFINE_VSCALE(name,arch) \
+void vscale_##name##_##arch(struct convert *conv, uint8_t * SPA_RESTRICT dst,	\
+		const uint8_t * SPA_RESTRICT src[], const uint16_t *weights,	\
+		uint32_t n_taps, uint32_t width)
+
+/* unpack a row to and pack rows from 4:4:4 with 4 bytes per pixel,
+ * YUVx or RGBx. pack gets two rows for 4:2:0 formats. */
+#define DEFINE_UNPACK(name,arch) \
+void unpack_##name##_##arch(struct convert *conv, uint8_t * SPA_RESTRICT dst,	\
+		const struct video_frame *src, uint32_t y, uint32_t width, uint32_t height)
+#define DEFINE_PACK(name,arch) \
+void pack_##name##_##arch(struct convert *conv, struct video_frame *dst,	\
+		uint32_t y, const uint8_t * SPA_RESTRICT src[2], uint32_t width)
+
+DEFINE_FUNCTION(yuy2_to_i420, c);
+DEFINE_FUNCTION(uyvy_to_i420, c);
+DEFINE_FUNCTION(yuy2_to_nv12, c);
+DEFINE_FUNCTION(uyvy_to_nv12, c);
+DEFINE_FUNCTION(i420_to_yuy2, c);
+DEFINE_FUNCTION(i420_to_uyvy, c);
+DEFINE_FUNCTION(nv12_to_yuy2, c);
+DEFINE_FUNCTION(nv12_to_uyvy, c);
+DEFINE_FUNCTION(i420_to_nv12, c);
+DEFINE_FUNCTION(nv12_to_i420, c);
+DEFINE_FUNCTION(i420_to_rgbx, c);
+DEFINE_FUNCTION(i420_to_bgrx, c);
+DEFINE_FUNCTION(nv12_to_rgbx, c);
+DEFINE_FUNCTION(nv12_to_bgrx, c);
+DEFINE_FUNCTION(yuy2_to_rgbx, c);
+DEFINE_FUNCTION(yuy2_to_bgrx, c);
+DEFINE_FUNCTION(uyvy_to_rgbx, c);
+DEFINE_FUNCTION(uyvy_to_bgrx, c);
+DEFINE_FUNCTION(rgbx_to_i420, c);
+DEFINE_FUNCTION(bgrx_to_i420, c);
+DEFINE_FUNCTION(rgbx_to_nv12, c);
+DEFINE_FUNCTION(bgrx_to_nv12, c);
+DEFINE_FUNCTION(rgbx_to_yuy2, c);
+DEFINE_FUNCTION(bgrx_to_yuy2, c);
+DEFINE_FUNCTION(rgbx_to_uyvy, c);
+DEFINE_FUNCTION(bgrx_to_uyvy, c);
+DEFINE_FUNCTION(swap16, c);
+DEFINE_FUNCTION(swap_rb, c);
+
+DEFINE_HSCALE(bilinear, c);
+DEFINE_HSCALE(ntap, c);
+DEFINE_VSCALE(bilinear, c);
+DEFINE_VSCALE(ntap, c);
+
+DEFINE_UNPACK(yuy2, c);
+DEFINE_UNPACK(uyvy, c);
+DEFINE_UNPACK(i420, c);
+DEFINE_UNPACK(nv12, c);
+DEFINE_UNPACK(rgbx, c);
+DEFINE_UNPACK(bgrx, c);
+DEFINE_PACK(yuy2, c);
+DEFINE_PACK(uyvy, c);
+DEFINE_PACK(i420, c);
+DEFINE_PACK(nv12, c);
+DEFINE_PACK(rgbx, c);
+DEFINE_PACK(bgrx, c);
+
+void matrix_yuv_to_rgb_c(struct convert *conv, uint8_t * SPA_RESTRICT row, uint32_t width);
+void matrix_rgb_to_yuv_c(struct convert *conv, uint8_t * SPA_RESTRICT row, uint32_t width);
+
+#if defined(HAVE_SSE2)
+DEFINE_FUNCTION(yuy2_to_i420, sse2);
+DEFINE_FUNCTION(uyvy_to_i420, sse2);
+DEFINE_FUNCTION(yuy2_to_nv12, sse2);
+DEFINE_FUNCTION(uyvy_to_nv12, sse2);
+DEFINE_FUNCTION(i420_to_yuy2, sse2);
+DEFINE_FUNCTION(i420_to_uyvy, sse2);
+DEFINE_FUNCTION(nv12_to_yuy2, sse2);
+DEFINE_FUNCTION(nv12_to_uyvy, sse2);
+DEFINE_FUNCTION(i420_to_nv12, sse2);
+DEFINE_FUNCTION(nv12_to_i420, sse2);
+DEFINE_FUNCTION(i420_to_rgbx, sse2);
+DEFINE_FUNCTION(i420_to_bgrx, sse2);
+DEFINE_FUNCTION(nv12_to_rgbx, sse2);
+DEFINE_FUNCTION(nv12_to_bgrx, sse2);
+DEFINE_FUNCTION(yuy2_to_rgbx, sse2);
+DEFINE_FUNCTION(yuy2_to_bgrx, sse2);
+DEFINE_FUNCTION(uyvy_to_rgbx, sse2);
+DEFINE_FUNCTION(uyvy_to_bgrx, sse2);
+DEFINE_FUNCTION(rgbx_to_i420, sse2);
+DEFINE_FUNCTION(bgrx_to_i420, sse2);
+DEFINE_FUNCTION(rgbx_to_nv12, sse2);
+DEFINE_FUNCTION(bgrx_to_nv12, sse2);
+DEFINE_FUNCTION(swap16, sse2);
+DEFINE_FUNCTION(swap_rb, sse2);
+DEFINE_VSCALE(bilinear, sse2);
+#endif
+#if defined(HAVE_AVX2)
+DEFINE_FUNCTION(yuy2_to_i420, avx2);
+DEFINE_FUNCTION(uyvy_to_i420, avx2);
+DEFINE_FUNCTION(yuy2_to_nv12, avx2);
+DEFINE_FUNCTION(uyvy_to_nv12, avx2);
+DEFINE_FUNCTION(i420_to_rgbx, avx2);
+DEFINE_FUNCTION(i420_to_bgrx, avx2);
+DEFINE_FUNCTION(nv12_to_rgbx, avx2);
+DEFINE_FUNCTION(nv12_to_bgrx, avx2);
+DEFINE_FUNCTION(swap_rb, avx2);
+DEFINE_VSCALE(bilinear, avx2);
+#endif
@@ -34,6 +34,8 @@
 #include <spa/buffer/alloc.h>
 #include <spa/pod/parser.h>
 #include <spa/pod/filter.h>
+#include <spa/param/buffers-utils.h>
+#include <spa/param/video/format-utils.h>
 #include <spa/debug/format.h>
 #include <spa/debug/pod.h>
 
@@ -58,7 +60,7 @@ struct impl {
 
 	struct spa_handle *hnd_convert;
 	struct spa_node *convert;
-
+	struct spa_hook convert_listener;
 	uint32_t convert_flags;
 
 	uint32_t n_buffers;
@@ -137,7 +139,6 @@ next:
 	return 0;
 }
 
-#if 0
 static int link_io(struct impl *this)
 {
 	int res;
@@ -145,7 +146,7 @@ static int link_io(struct impl *this)
 	if (!this->use_converter)
 		return 0;
 
-	spa_log_warn(this->log, NAME " %p: controls", this);
+	spa_log_debug(this->log, NAME " %p: controls", this);
 
 	spa_zero(this->io_rate_match);
 	this->io_rate_match.rate = 1.0;
@@ -185,7 +186,6 @@ static int link_io(struct impl *this)
 	}
 	return 0;
 }
-#endif
 
 static void emit_node_info(struct impl *this, bool full)
 {
@@ -351,7 +351,7 @@ static int slave_ready(void *data, int status)
 
 	spa_log_trace(this->log, NAME " %p: ready %d", this, status);
 
-	if (this->direction == SPA_DIRECTION_OUTPUT)
+	if (this->direction == SPA_DIRECTION_OUTPUT && this->use_converter)
 		status = spa_node_process(this->convert);
 
 	return spa_node_call_ready(&this->callbacks, status);
@@ -513,36 +513,35 @@ static int debug_params(struct impl *this, struct spa_node *node,
 
 static int negotiate_format(struct impl *this)
 {
-	uint32_t state;
-	struct spa_pod *format;
+	uint32_t state, cstate;
+	struct spa_pod *format, *filter;
 	uint8_t buffer[4096];
 	struct spa_pod_builder b = { 0 };
 	int res;
 
-	spa_pod_builder_init(&b, buffer, sizeof(buffer));
-
 	spa_log_debug(this->log, NAME "%p: negiotiate", this);
 
+	/* the slave can list formats we can't convert, like MJPG, take the
+	 * first one the converter accepts */
 	state = 0;
-	format = NULL;
-	if ((res = spa_node_port_enum_params_sync(this->slave,
-				this->direction, 0,
-				SPA_PARAM_EnumFormat, &state,
-				format, &format, &b)) < 0) {
-		debug_params(this, this->slave, this->direction, 0,
-				SPA_PARAM_EnumFormat, format, "slave format", res);
-		return -ENOTSUP;
-	}
+	while (true) {
+		spa_pod_builder_init(&b, buffer, sizeof(buffer));
 
-	state = 0;
-	if ((res = spa_node_port_enum_params_sync(this->convert,
-				SPA_DIRECTION_REVERSE(this->direction), 0,
-				SPA_PARAM_EnumFormat, &state,
-				format, &format, &b)) != 1) {
-		debug_params(this, this->convert,
-				SPA_DIRECTION_REVERSE(this->direction), 0,
-				SPA_PARAM_EnumFormat, format, "convert format", res);
-		return -ENOTSUP;
+		if ((res = spa_node_port_enum_params_sync(this->slave,
+					this->direction, 0,
+					SPA_PARAM_EnumFormat, &state,
+					NULL, &filter, &b)) != 1) {
+			debug_params(this, this->slave, this->direction, 0,
+					SPA_PARAM_EnumFormat, NULL, "slave format", res);
+			return -ENOTSUP;
+		}
+
+		cstate = 0;
+		if ((res = spa_node_port_enum_params_sync(this->convert,
+					SPA_DIRECTION_REVERSE(this->direction), 0,
+					SPA_PARAM_EnumFormat, &cstate,
+					filter, &format, &b)) == 1)
+			break;
 	}
 
 	spa_pod_fixate(format);
@@ -573,6 +572,7 @@ static int negotiate_buffers(struct impl *this)
 	int res, i;
 	bool slave_alloc, conv_alloc;
 	int32_t size, buffers, blocks, align, flags;
+	struct spa_buffers_info info = { .blocks = 1, .align = 16, };
 	uint32_t *aligns;
 	struct spa_data *datas;
 	uint32_t slave_flags, conv_flags;
@@ -619,14 +619,14 @@ static int negotiate_buffers(struct impl *this)
 			slave_alloc = false;
 	}
 
-	if ((res = spa_pod_parse_object(param,
-			SPA_TYPE_OBJECT_ParamBuffers, NULL,
-			SPA_PARAM_BUFFERS_buffers, SPA_POD_Int(&buffers),
-			SPA_PARAM_BUFFERS_blocks,  SPA_POD_Int(&blocks),
-			SPA_PARAM_BUFFERS_size,    SPA_POD_Int(&size),
-			SPA_PARAM_BUFFERS_align,   SPA_POD_Int(&align))) < 0)
+	if ((res = spa_buffers_parse(param, &info)) < 0)
 		return res;
 
+	buffers = info.buffers;
+	blocks = info.blocks;
+	size = info.size;
+	align = info.align;
+
 	spa_log_debug(this->log, "%p: buffers %d, blocks %d, size %d, align %d %d:%d",
 			this, buffers, blocks, size, align, slave_alloc, conv_alloc);
 
@@ -829,6 +829,11 @@ static int impl_clear(struct spa_handle *handle)
 	spa_hook_remove(&this->slave_listener);
 	spa_node_set_callbacks(this->slave, NULL, NULL);
 
+	if (this->use_converter) {
+		spa_hook_remove(&this->convert_listener);
+		spa_handle_clear(this->hnd_convert);
+	}
+
 	if (this->buffers)
 		free(this->buffers);
 	this->buffers = NULL;
@@ -838,15 +843,60 @@ static int impl_clear(struct spa_handle *handle)
 
 extern const struct spa_handle_factory spa_videoconvert_factory;
 
+/* only put the converter in front of slaves that have a raw format it
+ * understands, others, like MJPG cameras, are passed through */
+static bool can_convert(struct impl *this)
+{
+	uint32_t state = 0, media_type, media_subtype, format;
+	uint8_t buffer[4096];
+	struct spa_pod_builder b = { 0 };
+	struct spa_pod *param;
+	const struct spa_pod_prop *prop;
+	const struct spa_pod *val;
+	uint32_t i, n_vals, choice;
+
+	while (true) {
+		spa_pod_builder_init(&b, buffer, sizeof(buffer));
+		if (spa_node_port_enum_params_sync(this->slave,
+				this->direction, 0,
+				SPA_PARAM_EnumFormat, &state,
+				NULL, &param, &b) != 1)
+			return false;
+
+		if (spa_format_parse(param, &media_type, &media_subtype) < 0 ||
+		    media_type != SPA_MEDIA_TYPE_video ||
+		    media_subtype != SPA_MEDIA_SUBTYPE_raw)
+			continue;
+
+		if ((prop = spa_pod_find_prop(param, NULL, SPA_FORMAT_VIDEO_format)) == NULL)
+			continue;
+
+		val = spa_pod_get_values(&prop->value, &n_vals, &choice);
+		if (val->type != SPA_TYPE_Id)
+			continue;
+
+		for (i = 0; i < n_vals; i++) {
+			format = ((uint32_t*)SPA_POD_BODY(val))[i];
+			switch (format) {
+			case SPA_VIDEO_FORMAT_YUY2:
+			case SPA_VIDEO_FORMAT_UYVY:
+			case SPA_VIDEO_FORMAT_I420:
+			case SPA_VIDEO_FORMAT_NV12:
+			case SPA_VIDEO_FORMAT_RGBx:
+			case SPA_VIDEO_FORMAT_BGRx:
+				return true;
+			}
+		}
+	}
+}
+
 static size_t
 impl_get_size(const struct spa_handle_factory *factory,
 	      const struct spa_dict *params)
 {
 	size_t size = 0;
 
-#if 0
 	size += spa_handle_factory_get_size(&spa_videoconvert_factory, params);
-#endif
 	size += sizeof(struct impl);
 
 	return size;
@@ -860,9 +910,7 @@ impl_init(const struct spa_handle_factory *factory,
 	  uint32_t n_support)
 {
 	struct impl *this;
-#if 0
 	void *iface;
-#endif
 	const char *str;
 
 	spa_return_val_if_fail(factory != NULL, -EINVAL);
@@ -892,27 +940,25 @@ impl_init(const struct spa_handle_factory *factory,
 			&impl_node, this);
 	spa_hook_list_init(&this->hooks);
 
-#if 0
-	this->hnd_convert = SPA_MEMBER(this, sizeof(struct impl), struct spa_handle);
-	spa_handle_factory_init(&spa_videooconvert_factory,
-				this->hnd_convert,
-				info, support, n_support);
-
-	spa_handle_get_interface(this->hnd_convert, SPA_TYPE_INTERFACE_Node, &iface);
-	this->convert = iface;
-	this->target = this->convert;
-	spa_node_add_listener(this->convert,
-			&this->convert_listener, &target_node_events, this);
-
-	this->use_converter = true;
-	link_io(this);
-
-#else
-	this->target = this->slave;
-	spa_node_add_listener(this->target,
-			&this->target_listener, &target_node_events, this);
-
-#endif
+	if (can_convert(this)) {
+		this->hnd_convert = SPA_MEMBER(this, sizeof(struct impl), struct spa_handle);
+		spa_handle_factory_init(&spa_videoconvert_factory,
+					this->hnd_convert,
+					info, support, n_support);
+
+		spa_handle_get_interface(this->hnd_convert, SPA_TYPE_INTERFACE_Node, &iface);
+		this->convert = iface;
+		this->target = this->convert;
+		spa_node_add_listener(this->convert,
+				&this->convert_listener, &target_node_events, this);
+
+		this->use_converter = true;
+		link_io(this);
+	} else {
+		this->target = this->slave;
+		spa_node_add_listener(this->target,
+				&this->target_listener, &target_node_events, this);
+	}
 
 	this->info_all = SPA_NODE_CHANGE_MASK_PARAMS;
 	this->info = SPA_NODE_INFO_INIT();
@@ -0,0 +1,1026 @@
+/* Spa
+ *
+ * Copyright © 2020 Wim Taymans
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the next
+ * paragraph) shall be included in all copies or substantial portions of the
+ * Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+#include <errno.h>
+#include <string.h>
+#include <stdio.h>
+#include <limits.h>
+
+#include <spa/support/plugin.h>
+#include <spa/support/log.h>
+#include <spa/support/cpu.h>
+#include <spa/utils/list.h>
+#include <spa/utils/names.h>
+#include <spa/node/node.h>
+#include <spa/node/io.h>
+#include <spa/node/utils.h>
+#include <spa/param/video/format-utils.h>
+#include <spa/param/param.h>
+#include <spa/pod/filter.h>
+#include <spa/debug/types.h>
+#include <spa/debug/format.h>
+
+#include "video-ops.h"
+
+#define NAME "videoconvert"
+
+#define DEFAULT_WIDTH	640
+#define DEFAULT_HEIGHT	480
+#define DEFAULT_RATE	25
+
+#define MAX_BUFFERS	32
+#define MAX_ALIGN	16
+#define MAX_DATAS	VIDEO_MAX_PLANES
+
+struct buffer {
+	uint32_t id;
+#define BUFFER_FLAG_OUT		(1 << 0)
+	uint32_t flags;
+	struct spa_list link;
+	struct spa_buffer *outbuf;
+	struct spa_meta_header *h;
+};
+
+struct port {
+	uint32_t direction;
+	uint32_t id;
+
+	struct spa_io_buffers *io;
+
+	uint64_t info_all;
+	struct spa_port_info info;
+	struct spa_param_info params[8];
+
+	struct spa_video_info format;
+	uint32_t offsets[VIDEO_MAX_PLANES];
+	int32_t strides[VIDEO_MAX_PLANES];
+	uint32_t size;
+	unsigned int have_format:1;
+
+	struct buffer buffers[MAX_BUFFERS];
+	uint32_t n_buffers;
+
+	struct spa_list queue;
+};
+
+struct impl {
+	struct spa_handle handle;
+	struct spa_node node;
+
+	struct spa_log *log;
+	struct spa_cpu *cpu;
+
+	struct spa_io_position *io_position;
+
+	uint64_t info_all;
+	struct spa_node_info info;
+	struct spa_param_info params[8];
+
+	struct spa_hook_list hooks;
+
+	struct port ports[2][1];
+
+	uint32_t cpu_flags;
+	struct convert conv;
+	unsigned int started:1;
+	unsigned int is_passthrough:1;
+	unsigned int static_out:1;	/* output buffers can't take the input data pointer */
+};
+
+#define CHECK_PORT(this,d,id)		(id == 0)
+#define GET_PORT(this,d,id)		(&this->ports[d][id])
+#define GET_IN_PORT(this,id)		GET_PORT(this,SPA_DIRECTION_INPUT,id)
+#define GET_OUT_PORT(this,id)		GET_PORT(this,SPA_DIRECTION_OUTPUT,id)
+
+static bool is_supported(uint32_t format)
+{
+	switch (format) {
+	case SPA_VIDEO_FORMAT_YUY2:
+	case SPA_VIDEO_FORMAT_UYVY:
+	case SPA_VIDEO_FORMAT_I420:
+	case SPA_VIDEO_FORMAT_NV12:
+	case SPA_VIDEO_FORMAT_RGBx:
+	case SPA_VIDEO_FORMAT_BGRx:
+		return true;
+	default:
+		return false;
+	}
+}
+
+static bool is_rgb(uint32_t format)
+{
+	return format == SPA_VIDEO_FORMAT_RGBx || format == SPA_VIDEO_FORMAT_BGRx;
+}
+
+static uint32_t get_n_planes(uint32_t format)
+{
+	switch (format) {
+	case SPA_VIDEO_FORMAT_I420:
+		return 3;
+	case SPA_VIDEO_FORMAT_NV12:
+		return 2;
+	default:
+		return 1;
+	}
+}
+
+static uint32_t get_matrix(const struct spa_video_info_raw *info)
+{
+	switch (info->color_matrix) {
+	case SPA_VIDEO_COLOR_MATRIX_BT601:
+	case SPA_VIDEO_COLOR_MATRIX_BT709:
+		return info->color_matrix;
+	default:
+		/* the usual guess, HD content is BT.709 */
+		return info->size.height >= 720 ?
+			SPA_VIDEO_COLOR_MATRIX_BT709 : SPA_VIDEO_COLOR_MATRIX_BT601;
+	}
+}
+
+static int setup_convert(struct impl *this)
+{
+	struct spa_video_info_raw *in, *out;
+	struct port *inport, *outport;
+	int res;
+
+	inport = GET_IN_PORT(this, 0);
+	outport = GET_OUT_PORT(this, 0);
+
+	if (!inport->have_format || !outport->have_format)
+		return -EIO;
+
+	in = &inport->format.info.raw;
+	out = &outport->format.info.raw;
+
+	spa_log_info(this->log, NAME " %p: %s/%dx%d->%s/%dx%d", this,
+			spa_debug_type_find_name(spa_type_video_format, in->format),
+			in->size.width, in->size.height,
+			spa_debug_type_find_name(spa_type_video_format, out->format),
+			out->size.width, out->size.height);
+
+	if (this->conv.process)
+		convert_free(&this->conv);
+
+	spa_zero(this->conv);
+	this->conv.src_fmt = in->format;
+	this->conv.dst_fmt = out->format;
+	this->conv.src_width = in->size.width;
+	this->conv.src_height = in->size.height;
+	this->conv.dst_width = out->size.width;
+	this->conv.dst_height = out->size.height;
+	this->conv.matrix = get_matrix(is_rgb(in->format) ? out : in);
+	this->conv.scale = VIDEO_SCALE_AUTO;
+	this->conv.n_slices = 1;
+	this->conv.cpu_flags = this->cpu_flags;
+
+	if ((res = convert_init(&this->conv)) < 0)
+		return res;
+
+	spa_log_info(this->log, NAME " %p: got converter features %08x:%08x", this,
+			this->cpu_flags, this->conv.cpu_flags);
+
+	this->is_passthrough = this->conv.is_passthrough;
+
+	return 0;
+}
+
+static int impl_node_enum_params(void *object, int seq,
+				 uint32_t id, uint32_t start, uint32_t num,
+				 const struct spa_pod *filter)
+{
+	return -ENOTSUP;
+}
+
+static int impl_node_set_param(void *object, uint32_t id, uint32_t flags,
+			       const struct spa_pod *param)
+{
+	return -ENOTSUP;
+}
+
+static int impl_node_set_io(void *object, uint32_t id, void *data, size_t size)
+{
+	struct impl *this = object;
+
+	spa_return_val_if_fail(this != NULL, -EINVAL);
+
+	spa_log_debug(this->log, NAME " %p: io %d %p/%zd", this, id, data, size);
+
+	switch (id) {
+	case SPA_IO_Position:
+		this->io_position = data;
+		break;
+	default:
+		return -ENOENT;
+	}
+	return 0;
+}
+
+static int impl_node_send_command(void *object, const struct spa_command *command)
+{
+	struct impl *this = object;
+
+	spa_return_val_if_fail(this != NULL, -EINVAL);
+	spa_return_val_if_fail(command != NULL, -EINVAL);
+
+	switch (SPA_NODE_COMMAND_ID(command)) {
+	case SPA_NODE_COMMAND_Start:
+		this->started = true;
+		break;
+	case SPA_NODE_COMMAND_Pause:
+		this->started = false;
+		break;
+	default:
+		return -ENOTSUP;
+	}
+	return 0;
+}
+
+static void emit_info(struct impl *this, bool full)
+{
+	if (full)
+		this->info.change_mask = this->info_all;
+	if (this->info.change_mask) {
+		spa_node_emit_info(&this->hooks, &this->info);
+		this->info.change_mask = 0;
+	}
+}
+
+static void emit_port_info(struct impl *this, struct port *port, bool full)
+{
+	if (full)
+		port->info.change_mask = port->info_all;
+	if (port->info.change_mask) {
+		spa_node_emit_port_info(&this->hooks,
+				port->direction, port->id, &port->info);
+		port->info.change_mask = 0;
+	}
+}
+
+static int
+impl_node_add_listener(void *object,
+		struct spa_hook *listener,
+		const struct spa_node_events *events,
+		void *data)
+{
+	struct impl *this = object;
+	struct spa_hook_list save;
+
+	spa_return_val_if_fail(this != NULL, -EINVAL);
+
+	spa_hook_list_isolate(&this->hooks, &save, listener, events, data);
+
+	emit_info(this, true);
+	emit_port_info(this, GET_IN_PORT(this, 0), true);
+	emit_port_info(this, GET_OUT_PORT(this, 0), true);
+
+	spa_hook_list_join(&this->hooks, &save);
+
+	return 0;
+}
+
+static int
+impl_node_set_callbacks(void *object,
+			const struct spa_node_callbacks *callbacks,
+			void *user_data)
+{
+	return 0;
+}
+
+static int impl_node_add_port(void *object, enum spa_direction direction, uint32_t port_id,
+		const struct spa_dict *props)
+{
+        return -ENOTSUP;
+}
+
+static int
+impl_node_remove_port(void *object, enum spa_direction direction, uint32_t port_id)
+{
+        return -ENOTSUP;
+}
+
+static int port_enum_formats(void *object,
+			     enum spa_direction direction, uint32_t port_id,
+			     uint32_t index,
+			     struct spa_pod **param,
+			     struct spa_pod_builder *builder)
+{
+	struct impl *this = object;
+	struct port *port, *other;
+
+	port = GET_PORT(this, direction, port_id);
+	other = GET_PORT(this, SPA_DIRECTION_REVERSE(direction), 0);
+
+	spa_log_debug(this->log, NAME " %p: enum %p %d %d", this, other, port->have_format, other->have_format);
+	switch (index) {
+	case 0:
+		if (port->have_format) {
+			*param = spa_format_video_raw_build(builder,
+					SPA_PARAM_EnumFormat, &port->format.info.raw);
+		}
+		else {
+			struct spa_video_info_raw info;
+
+			if (other->have_format) {
+				info = other->format.info.raw;
+			} else {
+				spa_zero(info);
+				info.format = SPA_VIDEO_FORMAT_I420;
+				info.size = SPA_RECTANGLE(DEFAULT_WIDTH, DEFAULT_HEIGHT);
+				info.framerate = SPA_FRACTION(DEFAULT_RATE, 1);
+			}
+
+			/* we don't convert the framerate, the default is what we get */
+			*param = spa_pod_builder_add_object(builder,
+				SPA_TYPE_OBJECT_Format, SPA_PARAM_EnumFormat,
+				SPA_FORMAT_mediaType,       SPA_POD_Id(SPA_MEDIA_TYPE_video),
+				SPA_FORMAT_mediaSubtype,    SPA_POD_Id(SPA_MEDIA_SUBTYPE_raw),
+				SPA_FORMAT_VIDEO_format,    SPA_POD_CHOICE_ENUM_Id(7,
+								info.format,
+								SPA_VIDEO_FORMAT_I420,
+								SPA_VIDEO_FORMAT_NV12,
+								SPA_VIDEO_FORMAT_YUY2,
+								SPA_VIDEO_FORMAT_UYVY,
+								SPA_VIDEO_FORMAT_RGBx,
+								SPA_VIDEO_FORMAT_BGRx),
+				SPA_FORMAT_VIDEO_size,      SPA_POD_CHOICE_RANGE_Rectangle(
+								&info.size,
+								&SPA_RECTANGLE(1, 1),
+								&SPA_RECTANGLE(INT32_MAX, INT32_MAX)),
+				SPA_FORMAT_VIDEO_framerate, SPA_POD_CHOICE_RANGE_Fraction(
+								&info.framerate,
+								&SPA_FRACTION(0, 1),
+								&SPA_FRACTION(INT32_MAX, 1)));
+		}
+		break;
+	default:
+		return 0;
+	}
+	return 1;
+}
+
+static int
+impl_node_port_enum_params(void *object, int seq,
+			   enum spa_direction direction, uint32_t port_id,
+			   uint32_t id, uint32_t start, uint32_t num,
+			   const struct spa_pod *filter)
+{
+	struct impl *this = object;
+	struct port *port;
+	struct spa_pod *param;
+	struct spa_pod_builder b = { 0 };
+	uint8_t buffer[1024];
+	struct spa_result_node_params result;
+	uint32_t count = 0;
+	int res;
+
+	spa_return_val_if_fail(this != NULL, -EINVAL);
+	spa_return_val_if_fail(num != 0, -EINVAL);
+
+	spa_return_val_if_fail(CHECK_PORT(this, direction, port_id), -EINVAL);
+
+	port = GET_PORT(this, direction, port_id);
+
+	spa_log_debug(this->log, "%p: enum params port %d.%d %d %u",
+			this, direction, port_id, seq, id);
+
+	result.id = id;
+	result.next = start;
+      next:
+	result.index = result.next++;
+
+	spa_pod_builder_init(&b, buffer, sizeof(buffer));
+
+	switch (id) {
+	case SPA_PARAM_EnumFormat:
+		if ((res = port_enum_formats(this, direction, port_id,
+						result.index, &param, &b)) <= 0)
+			return res;
+		break;
+
+	case SPA_PARAM_Format:
+		if (!port->have_format)
+			return -EIO;
+		if (result.index > 0)
+			return 0;
+
+		param = spa_format_video_raw_build(&b, id, &port->format.info.raw);
+		break;
+
+	case SPA_PARAM_Buffers:
+		if (!port->have_format)
+			return -EIO;
+		if (result.index > 0)
+			return 0;
+
+		/* the peer can use a larger stride, we look at the chunk stride */
+		param = spa_pod_builder_add_object(&b,
+			SPA_TYPE_OBJECT_ParamBuffers, id,
+			SPA_PARAM_BUFFERS_buffers, SPA_POD_CHOICE_RANGE_Int(2, 1, MAX_BUFFERS),
+			SPA_PARAM_BUFFERS_blocks,  SPA_POD_Int(1),
+			SPA_PARAM_BUFFERS_size,    SPA_POD_CHOICE_RANGE_Int(
+							port->size, port->size, INT32_MAX),
+			SPA_PARAM_BUFFERS_stride,  SPA_POD_CHOICE_RANGE_Int(
+							port->strides[0], port->strides[0], INT32_MAX),
+			SPA_PARAM_BUFFERS_align,   SPA_POD_Int(16));
+		break;
+
+	case SPA_PARAM_Meta:
+		switch (result.index) {
+		case 0:
+			param = spa_pod_builder_add_object(&b,
+				SPA_TYPE_OBJECT_ParamMeta, id,
+				SPA_PARAM_META_type, SPA_POD_Id(SPA_META_Header),
+				SPA_PARAM_META_size, SPA_POD_Int(sizeof(struct spa_meta_header)));
+			break;
+		default:
+			return 0;
+		}
+		break;
+
+	case SPA_PARAM_IO:
+		switch (result.index) {
+		case 0:
+			param = spa_pod_builder_add_object(&b,
+				SPA_TYPE_OBJECT_ParamIO, id,
+				SPA_PARAM_IO_id,   SPA_POD_Id(SPA_IO_Buffers),
+				SPA_PARAM_IO_size, SPA_POD_Int(sizeof(struct spa_io_buffers)));
+			break;
+		default:
+			return 0;
+		}
+		break;
+
+	default:
+		return -ENOENT;
+	}
+
+	if (spa_pod_filter(&b, &result.param, param, filter) < 0)
+		goto next;
+
+	spa_node_emit_result(&this->hooks, seq, 0, SPA_RESULT_TYPE_NODE_PARAMS, &result);
+
+	if (++count != num)
+		goto next;
+
+	return 0;
+}
+
+static int clear_buffers(struct impl *this, struct port *port)
+{
+	if (port->n_buffers > 0) {
+		spa_log_debug(this->log, NAME " %p: clear buffers %p", this, port);
+		port->n_buffers = 0;
+		spa_list_init(&port->queue);
+	}
+	return 0;
+}
+
+static int port_set_format(void *object,
+			   enum spa_direction direction,
+			   uint32_t port_id,
+			   uint32_t flags,
+			   const struct spa_pod *format)
+{
+	struct impl *this = object;
+	struct port *port, *other;
+	int res = 0;
+
+	port = GET_PORT(this, direction, port_id);
+	other = GET_PORT(this, SPA_DIRECTION_REVERSE(direction), port_id);
+
+	if (format == NULL) {
+		if (port->have_format) {
+			port->have_format = false;
+			clear_buffers(this, port);
+			if (this->conv.process)
+				convert_free(&this->conv);
+			this->conv.process = NULL;
+		}
+	} else {
+		struct spa_video_info info = { 0 };
+
+		if ((res = spa_format_parse(format, &info.media_type, &info.media_subtype)) < 0)
+			return res;
+
+		if (info.media_type != SPA_MEDIA_TYPE_video ||
+		    info.media_subtype != SPA_MEDIA_SUBTYPE_raw)
+			return -EINVAL;
+
+		if (spa_format_video_raw_parse(format, &info.info.raw) < 0)
+			return -EINVAL;
+
+		if (!is_supported(info.info.raw.format) ||
+		    info.info.raw.size.width == 0 || info.info.raw.size.height == 0)
+			return -ENOTSUP;
+
+		port->size = video_layout(info.info.raw.format,
+				info.info.raw.size.width, info.info.raw.size.height,
+				0, port->offsets, port->strides);
+		port->have_format = true;
+		port->format = info;
+
+		if (other->have_format && port->have_format)
+			if ((res = setup_convert(this)) < 0)
+				return res;
+
+		spa_log_debug(this->log, NAME " %p: set format on port %d:%d res:%d size:%d",
+				this, direction, port_id, res, port->size);
+	}
+	if (port->have_format) {
+		port->params[3] = SPA_PARAM_INFO(SPA_PARAM_Format, SPA_PARAM_INFO_READWRITE);
+		port->params[4] = SPA_PARAM_INFO(SPA_PARAM_Buffers, SPA_PARAM_INFO_READ);
+	} else {
+		port->params[3] = SPA_PARAM_INFO(SPA_PARAM_Format, SPA_PARAM_INFO_WRITE);
+		port->params[4] = SPA_PARAM_INFO(SPA_PARAM_Buffers, 0);
+	}
+	port->info.change_mask |= SPA_PORT_CHANGE_MASK_PARAMS;
+	emit_port_info(this, port, false);
+
+	return 0;
+}
+
+static int
+impl_node_port_set_param(void *object,
+			 enum spa_direction direction, uint32_t port_id,
+			 uint32_t id, uint32_t flags,
+			 const struct spa_pod *param)
+{
+	struct impl *this = object;
+
+	spa_return_val_if_fail(object != NULL, -EINVAL);
+	spa_return_val_if_fail(CHECK_PORT(object, direction, port_id), -EINVAL);
+
+	spa_log_debug(this->log, NAME " %p: set param %u on port %d:%d %p",
+				this, id, direction, port_id, param);
+
+	switch (id) {
+	case SPA_PARAM_Format:
+		return port_set_format(object, direction, port_id, flags, param);
+	default:
+		return -ENOENT;
+	}
+}
+
+static int
+impl_node_port_use_buffers(void *object,
+			   enum spa_direction direction,
+			   uint32_t port_id,
+			   uint32_t flags,
+			   struct spa_buffer **buffers,
+			   uint32_t n_buffers)
+{
+	struct impl *this = object;
+	struct port *port;
+	uint32_t i, j;
+
+	spa_return_val_if_fail(this != NULL, -EINVAL);
+
+	spa_return_val_if_fail(CHECK_PORT(this, direction, port_id), -EINVAL);
+
+	port = GET_PORT(this, direction, port_id);
+
+	spa_return_val_if_fail(port->have_format, -EIO);
+	spa_return_val_if_fail(n_buffers <= MAX_BUFFERS, -ENOSPC);
+
+	spa_log_debug(this->log, NAME " %p: use buffers %d on port %d", this, n_buffers, port_id);
+
+	clear_buffers(this, port);
+
+	if (direction == SPA_DIRECTION_OUTPUT)
+		this->static_out = false;
+
+	for (i = 0; i < n_buffers; i++) {
+		struct buffer *b;
+		uint32_t n_datas = buffers[i]->n_datas;
+		struct spa_data *d = buffers[i]->datas;
+
+		b = &port->buffers[i];
+		b->id = i;
+		b->flags = 0;
+		b->outbuf = buffers[i];
+		b->h = spa_buffer_find_meta_data(buffers[i], SPA_META_Header, sizeof(*b->h));
+
+		if (n_datas == 0 || n_datas > MAX_DATAS) {
+			spa_log_error(this->log, NAME " %p: invalid blocks %d on buffer %d", this,
+				      n_datas, i);
+			return -EINVAL;
+		}
+		for (j = 0; j < n_datas; j++) {
+			if (d[j].data == NULL &&
+			    !SPA_FLAG_IS_SET(d[j].flags, SPA_DATA_FLAG_DYNAMIC)) {
+				spa_log_error(this->log, NAME " %p: invalid memory %d on buffer %d",
+						this, j, i);
+				return -EINVAL;
+			}
+			if (!SPA_IS_ALIGNED(d[j].data, MAX_ALIGN)) {
+				spa_log_warn(this->log, NAME " %p: memory %d on buffer %d not aligned",
+						this, j, i);
+			}
+			if (direction == SPA_DIRECTION_OUTPUT &&
+			    !SPA_FLAG_IS_SET(d[j].flags, SPA_DATA_FLAG_DYNAMIC))
+				this->static_out = true;
+		}
+
+		if (direction == SPA_DIRECTION_OUTPUT)
+			spa_list_append(&port->queue, &b->link);
+		else
+			SPA_FLAG_SET(b->flags, BUFFER_FLAG_OUT);
+	}
+	port->n_buffers = n_buffers;
+
+	return 0;
+}
+
+static int
+impl_node_port_set_io(void *object,
+		      enum spa_direction direction, uint32_t port_id,
+		      uint32_t id, void *data, size_t size)
+{
+	struct impl *this = object;
+	struct port *port;
+
+	spa_return_val_if_fail(this != NULL, -EINVAL);
+	spa_return_val_if_fail(CHECK_PORT(this, direction, port_id), -EINVAL);
+
+	port = GET_PORT(this, direction, port_id);
+
+	spa_log_debug(this->log, NAME " %p: port %d:%d update io %d %p",
+			this, direction, port_id, id, data);
+
+	switch (id) {
+	case SPA_IO_Buffers:
+		port->io = data;
+		break;
+	default:
+		return -ENOENT;
+	}
+	return 0;
+}
+
+static void recycle_buffer(struct impl *this, struct port *port, uint32_t id)
+{
+	struct buffer *b = &port->buffers[id];
+
+	if (SPA_FLAG_IS_SET(b->flags, BUFFER_FLAG_OUT)) {
+		spa_list_append(&port->queue, &b->link);
+		SPA_FLAG_CLEAR(b->flags, BUFFER_FLAG_OUT);
+		spa_log_trace_fp(this->log, NAME " %p: recycle buffer %d", this, id);
+	}
+}
+
+static inline struct buffer *dequeue_buffer(struct impl *this, struct port *port)
+{
+	struct buffer *b;
+
+	if (spa_list_is_empty(&port->queue))
+		return NULL;
+	b = spa_list_first(&port->queue, struct buffer, link);
+	spa_list_remove(&b->link);
+	SPA_FLAG_SET(b->flags, BUFFER_FLAG_OUT);
+	return b;
+}
+
+static int impl_node_port_reuse_buffer(void *object, uint32_t port_id, uint32_t buffer_id)
+{
+	struct impl *this = object;
+	struct port *port;
+
+	spa_return_val_if_fail(this != NULL, -EINVAL);
+	spa_return_val_if_fail(CHECK_PORT(this, SPA_DIRECTION_OUTPUT, port_id), -EINVAL);
+
+	port = GET_OUT_PORT(this, port_id);
+
+	recycle_buffer(this, port, buffer_id);
+
+	return 0;
+}
+
+/* the size of a plane with the stride of the port, from the layout that
+ * video_layout() made for it */
+static uint32_t plane_size(struct port *port, uint32_t plane, uint32_t n_planes)
+{
+	uint32_t end = plane + 1 < n_planes ? port->offsets[plane + 1] : port->size;
+	return end - port->offsets[plane];
+}
+
+/* map the planes of buf, either one per data or all in the first data
+ * with the stride of the chunk. The peer can use a larger stride than ours
+ * but not a smaller one, see the Buffers param. */
+static int get_frame(struct impl *this, struct port *port, struct spa_buffer *buf,
+		struct video_frame *frame, bool input)
+{
+	const struct spa_video_info_raw *info = &port->format.info.raw;
+	struct spa_data *d = buf->datas;
+	uint32_t i, n_planes, offs, size, maxsize, offsets[VIDEO_MAX_PLANES];
+	int32_t stride, strides[VIDEO_MAX_PLANES];
+
+	spa_zero(*frame);
+
+	n_planes = get_n_planes(info->format);
+
+	if (buf->n_datas == 1) {
+		stride = input ? d[0].chunk->stride : 0;
+		if (stride != 0 && stride < port->strides[0])
+			return -EINVAL;
+		offs = input ? SPA_MIN(d[0].chunk->offset, d[0].maxsize) : 0;
+		maxsize = input ? SPA_MIN(d[0].chunk->size, d[0].maxsize - offs) : d[0].maxsize;
+		size = video_layout(info->format, info->size.width, info->size.height,
+				stride, offsets, strides);
+		if (d[0].data == NULL || size == 0 || size > maxsize)
+			return -EINVAL;
+		for (i = 0; i < VIDEO_MAX_PLANES; i++) {
+			frame->data[i] = SPA_MEMBER(d[0].data, offs + offsets[i], void);
+			frame->stride[i] = strides[i];
+		}
+		if (!input) {
+			d[0].chunk->offset = 0;
+			d[0].chunk->size = size;
+			d[0].chunk->stride = strides[0];
+		}
+	} else {
+		if (buf->n_datas < n_planes)
+			return -EINVAL;
+		for (i = 0; i < n_planes; i++) {
+			uint64_t psize;
+
+			if (d[i].data == NULL)
+				return -EINVAL;
+
+			stride = input ? d[i].chunk->stride : 0;
+			if (stride == 0)
+				stride = port->strides[i];
+			else if (stride < port->strides[i])
+				return -EINVAL;
+
+			/* the same number of rows, with the stride of the data */
+			psize = (uint64_t)plane_size(port, i, n_planes) / port->strides[i] * stride;
+
+			offs = input ? SPA_MIN(d[i].chunk->offset, d[i].maxsize) : 0;
+			maxsize = input ? SPA_MIN(d[i].chunk->size, d[i].maxsize - offs) : d[i].maxsize;
+			if (psize > maxsize)
+				return -EINVAL;
+
+			frame->data[i] = SPA_MEMBER(d[i].data, offs, void);
+			frame->stride[i] = stride;
+			if (!input) {
+				d[i].chunk->offset = 0;
+				d[i].chunk->size = psize;
+				d[i].chunk->stride = stride;
+			}
+		}
+	}
+	return 0;
+}
+
+static int impl_node_process(void *object)
+{
+	struct impl *this = object;
+	struct port *inport, *outport;
+	struct spa_io_buffers *inio, *outio;
+	struct buffer *inbuf, *outbuf;
+	struct spa_buffer *inb, *outb;
+	struct video_frame src, dst;
+	uint32_t i;
+	int res = 0;
+
+	spa_return_val_if_fail(this != NULL, -EINVAL);
+
+	outport = GET_OUT_PORT(this, 0);
+	inport = GET_IN_PORT(this, 0);
+
+	outio = outport->io;
+	inio = inport->io;
+
+	spa_log_trace_fp(this->log, NAME " %p: io %p %p", this, inio, outio);
+
+	spa_return_val_if_fail(outio != NULL, -EIO);
+	spa_return_val_if_fail(inio != NULL, -EIO);
+
+	spa_log_trace_fp(this->log, NAME " %p: status %p %d %d -> %p %d %d", this,
+			inio, inio->status, inio->buffer_id,
+			outio, outio->status, outio->buffer_id);
+
+	if (outio->status == SPA_STATUS_HAVE_DATA)
+		return inio->status | outio->status;
+
+	if (outio->buffer_id < outport->n_buffers) {
+		recycle_buffer(this, outport, outio->buffer_id);
+		outio->buffer_id = SPA_ID_INVALID;
+	}
+	if (inio->status != SPA_STATUS_HAVE_DATA)
+		return SPA_STATUS_NEED_DATA;
+	if (inio->buffer_id >= inport->n_buffers)
+		return inio->status = -EINVAL;
+
+	if ((outbuf = dequeue_buffer(this, outport)) == NULL)
+		return outio->status = -EPIPE;
+
+	inbuf = &inport->buffers[inio->buffer_id];
+	inb = inbuf->outbuf;
+	outb = outbuf->outbuf;
+
+	if (inbuf->h && outbuf->h)
+		*outbuf->h = *inbuf->h;
+
+	if (this->is_passthrough && !this->static_out && inb->n_datas == outb->n_datas) {
+		for (i = 0; i < outb->n_datas; i++) {
+			outb->datas[i].data = inb->datas[i].data;
+			*outb->datas[i].chunk = *inb->datas[i].chunk;
+		}
+	} else if (get_frame(this, inport, inb, &src, true) < 0 ||
+	    get_frame(this, outport, outb, &dst, false) < 0) {
+		spa_log_warn(this->log, NAME " %p: invalid buffer %d -> %d", this,
+				inbuf->id, outbuf->id);
+		recycle_buffer(this, outport, outbuf->id);
+		inio->status = SPA_STATUS_NEED_DATA;
+		return SPA_STATUS_NEED_DATA;
+	} else {
+		convert_process(&this->conv, &dst, &src);
+	}
+
+	inio->status = SPA_STATUS_NEED_DATA;
+	res |= SPA_STATUS_NEED_DATA;
+
+	outio->status = SPA_STATUS_HAVE_DATA;
+	outio->buffer_id = outbuf->id;
+	res |= SPA_STATUS_HAVE_DATA;
+
+	return res;
+}
+
+static const struct spa_node_methods impl_node = {
+	SPA_VERSION_NODE_METHODS,
+	.add_listener = impl_node_add_listener,
+	.set_callbacks = impl_node_set_callbacks,
+	.enum_params = impl_node_enum_params,
+	.set_param = impl_node_set_param,
+	.set_io = impl_node_set_io,
+	.send_command = impl_node_send_command,
+	.add_port = impl_node_add_port,
+	.remove_port = impl_node_remove_port,
+	.port_enum_params = impl_node_port_enum_params,
+	.port_set_param = impl_node_port_set_param,
+	.port_use_buffers = impl_node_port_use_buffers,
+	.port_set_io = impl_node_port_set_io,
+	.port_reuse_buffer = impl_node_port_reuse_buffer,
+	.process = impl_node_process,
+};
+
+static int impl_get_interface(struct spa_handle *handle, const char *type, void **interface)
+{
+	struct impl *this;
+
+	spa_return_val_if_fail(handle != NULL, -EINVAL);
+	spa_return_val_if_fail(interface != NULL, -EINVAL);
+
+	this = (struct impl *) handle;
+
+	if (strcmp(type, SPA_TYPE_INTERFACE_Node) == 0)
+		*interface = &this->node;
+	else
+		return -ENOENT;
+
+	return 0;
+}
+
+static int impl_clear(struct spa_handle *handle)
+{
+	struct impl *this;
+
+	spa_return_val_if_fail(handle != NULL, -EINVAL);
+
+	this = (struct impl *) handle;
+
+	if (this->conv.process)
+		convert_free(&this->conv);
+	this->conv.process = NULL;
+
+	return 0;
+}
+
+static int init_port(struct impl *this, enum spa_direction direction, uint32_t port_id)
+{
+	struct port *port;
+
+	port = GET_PORT(this, direction, port_id);
+	port->direction = direction;
+	port->id = port_id;
+
+	spa_list_init(&port->queue);
+	port->info_all = SPA_PORT_CHANGE_MASK_FLAGS;
+	port->info = SPA_PORT_INFO_INIT();
+	port->info.flags = SPA_PORT_FLAG_NO_REF |
+		SPA_PORT_FLAG_DYNAMIC_DATA;
+	port->params[0] = SPA_PARAM_INFO(SPA_PARAM_EnumFormat, SPA_PARAM_INFO_READ);
+	port->params[1] = SPA_PARAM_INFO(SPA_PARAM_Meta, SPA_PARAM_INFO_READ);
+	port->params[2] = SPA_PARAM_INFO(SPA_PARAM_IO, SPA_PARAM_INFO_READ);
+	port->params[3] = SPA_PARAM_INFO(SPA_PARAM_Format, SPA_PARAM_INFO_WRITE);
+	port->params[4] = SPA_PARAM_INFO(SPA_PARAM_Buffers, 0);
+	port->info.params = port->params;
+	port->info.n_params = 5;
+	port->have_format = false;
+
+	return 0;
+}
+
+static size_t
+impl_get_size(const struct spa_handle_factory *factory,
+	      const struct spa_dict *params)
+{
+	return sizeof(struct impl);
+}
+
+static int
+impl_init(const struct spa_handle_factory *factory,
+	  struct spa_handle *handle,
+	  const struct spa_dict *info,
+	  const struct spa_support *support,
+	  uint32_t n_support)
+{
+	struct impl *this;
+
+	spa_return_val_if_fail(factory != NULL, -EINVAL);
+	spa_return_val_if_fail(handle != NULL, -EINVAL);
+
+	handle->get_interface = impl_get_interface;
+	handle->clear = impl_clear;
+
+	this = (struct impl *) handle;
+
+	this->log = spa_support_find(support, n_support, SPA_TYPE_INTERFACE_Log);
+	this->cpu = spa_support_find(support, n_support, SPA_TYPE_INTERFACE_CPU);
+
+	if (this->cpu)
+		this->cpu_flags = spa_cpu_get_flags(this->cpu);
+
+	this->node.iface = SPA_INTERFACE_INIT(
+			SPA_TYPE_INTERFACE_Node,
+			SPA_VERSION_NODE,
+			&impl_node, this);
+	spa_hook_list_init(&this->hooks);
+
+	this->info_all = SPA_PORT_CHANGE_MASK_FLAGS;
+	this->info = SPA_NODE_INFO_INIT();
+	this->info.flags = SPA_NODE_FLAG_RT;
+	this->info.params = this->params;
+	this->info.n_params = 0;
+
+	init_port(this, SPA_DIRECTION_OUTPUT, 0);
+	init_port(this, SPA_DIRECTION_INPUT, 0);
+
+	return 0;
+}
+
+static const struct spa_interface_info impl_interfaces[] = {
+	{SPA_TYPE_INTERFACE_Node,},
+};
+
+static int
+impl_enum_interface_info(const struct spa_handle_factory *factory,
+			 const struct spa_interface_info **info,
+			 uint32_t *index)
+{
+	spa_return_val_if_fail(factory != NULL, -EINVAL);
+	spa_return_val_if_fail(info != NULL, -EINVAL);
+	spa_return_val_if_fail(index != NULL, -EINVAL);
+
+	switch (*index) {
+	case 0:
+		*info = &impl_interfaces[*index];
+		break;
+	default:
+		return 0;
+	}
+	(*index)++;
+	return 1;
+}
+
+const struct spa_handle_factory spa_videoconvert_factory = {
+	SPA_VERSION_HANDLE_FACTORY,
+	SPA_NAME_VIDEO_CONVERT,
+	NULL,
+	impl_get_size,
+	impl_init,
+	impl_enum_interface_info,
+};
@@ -66,52 +66,75 @@ static void gen_dict(struct spa_dict *dict, uint32_t n_items)
 	dict->flags = 0;
 }
 
-static void test_query(const struct spa_dict *dict)
+static void test_query(const struct spa_dict *dict, const struct spa_dict_hash *hash)
 {
+	const struct spa_dict_item *item;
 	uint32_t i, idx;
-	const char *str;
 
 	for (i = 0; i < MAX_COUNT; i++) {
 		idx = random() % dict->n_items;
-		str = spa_dict_lookup(dict, dict->items[idx].key);
-		assert(strcmp(str, dict->items[idx].value) == 0);
+		if (hash)
+			item = spa_dict_hash_lookup_item(dict, hash, dict->items[idx].key);
+		else
+			item = spa_dict_lookup_item(dict, dict->items[idx].key);
+		assert(strcmp(item->value, dict->items[idx].value) == 0);
 	}
 }
 
-static void test_lookup(struct spa_dict *dict)
+static uint64_t get_time(void)
 {
 	struct timespec ts;
-	uint64_t t1, t2, t3, t4;
-
 	clock_gettime(CLOCK_MONOTONIC, &ts);
-	t1 = SPA_TIMESPEC_TO_NSEC(&ts);
+	return SPA_TIMESPEC_TO_NSEC(&ts);
+}
 
-	test_query(dict);
+static uint64_t run_query(struct spa_dict *dict, const struct spa_dict_hash *hash,
+		const char *mode, uint64_t base)
+{
+	uint64_t t1, t2;
 
-	clock_gettime(CLOCK_MONOTONIC, &ts);
-	t2 = SPA_TIMESPEC_TO_NSEC(&ts);
+	t1 = get_time();
+	test_query(dict, hash);
+	t2 = get_time();
 
-	fprintf(stderr, "%d elapsed %"PRIu64" count %u = %"PRIu64"/sec\n", dict->n_items,
+	fprintf(stderr, "%d %s elapsed %"PRIu64" count %u = %"PRIu64"/sec", dict->n_items, mode,
 			t2 - t1, MAX_COUNT, MAX_COUNT * (uint64_t)SPA_NSEC_PER_SEC / (t2 - t1));
+	if (base)
+		fprintf(stderr, " %f speedup", (double)base / (t2 - t1));
+	fprintf(stderr, "\n");
 
-	spa_dict_qsort(dict);
+	return t2 - t1;
+}
 
-	clock_gettime(CLOCK_MONOTONIC, &ts);
-	t3 = SPA_TIMESPEC_TO_NSEC(&ts);
+static void test_lookup(struct spa_dict *dict)
+{
+	struct spa_dict_hash hash;
+	uint64_t t1, t2, linear;
 
-	fprintf(stderr, "%d sort elapsed %"PRIu64"\n", dict->n_items, t3 - t2);
+	linear = run_query(dict, NULL, "linear", 0);
 
-	clock_gettime(CLOCK_MONOTONIC, &ts);
-	t3 = SPA_TIMESPEC_TO_NSEC(&ts);
+	spa_zero(hash);
+	for (hash.size = 16; hash.size < dict->n_items * 2; hash.size <<= 1);
+	hash.slots = calloc(hash.size, sizeof(uint32_t));
+	hash.hashes = calloc(dict->n_items, sizeof(uint32_t));
+	assert(hash.slots != NULL && hash.hashes != NULL);
 
-	test_query(dict);
+	t1 = get_time();
+	spa_dict_hash_index(dict, &hash);
+	t2 = get_time();
+	fprintf(stderr, "%d hash elapsed %"PRIu64"\n", dict->n_items, t2 - t1);
 
-	clock_gettime(CLOCK_MONOTONIC, &ts);
-	t4 = SPA_TIMESPEC_TO_NSEC(&ts);
+	run_query(dict, &hash, "hashed", linear);
+
+	t1 = get_time();
+	spa_dict_qsort(dict);
+	t2 = get_time();
+	fprintf(stderr, "%d sort elapsed %"PRIu64"\n", dict->n_items, t2 - t1);
+
+	run_query(dict, NULL, "sorted", linear);
 
-	fprintf(stderr, "%d elapsed %"PRIu64" count %u = %"PRIu64"/sec %f speedup\n", dict->n_items,
-			t4 - t3, MAX_COUNT, MAX_COUNT * (uint64_t)SPA_NSEC_PER_SEC / (t4 - t3),
-			(double)(t2 - t1) / (t4 - t2));
+	free(hash.slots);
+	free(hash.hashes);
 }
 
 int main(int argc, char *argv[])
@@ -123,7 +146,7 @@ int main(int argc, char *argv[])
 
 	/* warmup */
 	gen_dict(&dict, 1000);
-	test_query(&dict);
+	test_query(&dict, NULL);
 
 	gen_dict(&dict, 10);
 	test_lookup(&dict);
@@ -0,0 +1,283 @@
+/* Spa
+ *
+ * Copyright © 2020 Wim Taymans
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the next
+ * paragraph) shall be included in all copies or substantial portions of the
+ * Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+#include <stdio.h>
+#include <stdint.h>
+#include <errno.h>
+#include <time.h>
+
+/* the filter sorts the enums with more value pairs than this, make it a
+ * variable so that the pairwise and the sorted path can be compared */
+static uint32_t sort_min;
+#define SPA_POD_FILTER_SORT_MIN sort_min
+
+#include <spa/pod/builder.h>
+#include <spa/pod/filter.h>
+#include <spa/param/video/format-utils.h>
+
+#define MAX_COUNT 200000
+
+/* a 4K capable camera that enumerates all its sizes and framerates, like
+ * the v4l2 source does for devices with discrete frame sizes */
+static const uint32_t camera_formats[] = {
+	SPA_VIDEO_FORMAT_YUY2,
+	SPA_VIDEO_FORMAT_NV12,
+	SPA_VIDEO_FORMAT_UYVY,
+	SPA_VIDEO_FORMAT_RGB,
+};
+static const uint32_t camera_subtypes[] = {
+	SPA_MEDIA_SUBTYPE_raw,
+	SPA_MEDIA_SUBTYPE_mjpg,
+	SPA_MEDIA_SUBTYPE_h264,
+};
+static const struct spa_rectangle camera_sizes[] = {
+	{ 160, 120 }, { 176, 144 }, { 320, 180 }, { 320, 240 },
+	{ 352, 288 }, { 424, 240 }, { 480, 270 }, { 640, 360 },
+	{ 640, 480 }, { 800, 448 }, { 800, 600 }, { 848, 480 },
+	{ 960, 540 }, { 1024, 576 }, { 1024, 768 }, { 1280, 720 },
+	{ 1280, 960 }, { 1600, 896 }, { 1600, 1200 }, { 1920, 1080 },
+	{ 2048, 1536 }, { 2560, 1440 }, { 2592, 1944 }, { 3840, 2160 },
+};
+static const struct spa_fraction camera_rates[] = {
+	{ 60, 1 }, { 50, 1 }, { 30, 1 }, { 25, 1 },
+	{ 24, 1 }, { 20, 1 }, { 15, 1 }, { 10, 1 },
+	{ 15, 2 }, { 5, 1 },
+};
+
+/* a consumer that only handles some raw formats and the usual sizes */
+static const uint32_t consumer_formats[] = {
+	SPA_VIDEO_FORMAT_I420,
+	SPA_VIDEO_FORMAT_NV12,
+	SPA_VIDEO_FORMAT_YUY2,
+};
+static const struct spa_rectangle consumer_sizes[] = {
+	{ 320, 240 }, { 640, 360 }, { 640, 480 }, { 800, 600 },
+	{ 960, 540 }, { 1024, 768 }, { 1280, 720 }, { 1920, 1080 },
+};
+static const struct spa_fraction consumer_rates[] = {
+	{ 60, 1 }, { 30, 1 }, { 25, 1 }, { 15, 1 },
+};
+
+/* a sink that accepts the common packed and planar formats */
+static const uint32_t sink_formats[] = {
+	SPA_VIDEO_FORMAT_I420, SPA_VIDEO_FORMAT_YV12, SPA_VIDEO_FORMAT_YUY2,
+	SPA_VIDEO_FORMAT_UYVY, SPA_VIDEO_FORMAT_NV12, SPA_VIDEO_FORMAT_NV21,
+	SPA_VIDEO_FORMAT_RGBx, SPA_VIDEO_FORMAT_BGRx, SPA_VIDEO_FORMAT_xRGB,
+	SPA_VIDEO_FORMAT_xBGR, SPA_VIDEO_FORMAT_RGBA, SPA_VIDEO_FORMAT_BGRA,
+	SPA_VIDEO_FORMAT_RGB, SPA_VIDEO_FORMAT_BGR, SPA_VIDEO_FORMAT_Y42B,
+	SPA_VIDEO_FORMAT_Y444,
+};
+
+static struct spa_pod *build_camera_format(struct spa_pod_builder *b, uint32_t subtype, uint32_t format)
+{
+	struct spa_pod_frame f[2];
+	uint32_t i;
+
+	spa_pod_builder_push_object(b, &f[0], SPA_TYPE_OBJECT_Format, SPA_PARAM_EnumFormat);
+	spa_pod_builder_add(b,
+			SPA_FORMAT_mediaType,		SPA_POD_Id(SPA_MEDIA_TYPE_video),
+			SPA_FORMAT_mediaSubtype,	SPA_POD_Id(subtype), 0);
+	if (subtype == SPA_MEDIA_SUBTYPE_raw)
+		spa_pod_builder_add(b,
+				SPA_FORMAT_VIDEO_format,	SPA_POD_Id(format), 0);
+
+	spa_pod_builder_prop(b, SPA_FORMAT_VIDEO_size, 0);
+	spa_pod_builder_push_choice(b, &f[1], SPA_CHOICE_Enum, 0);
+	spa_pod_builder_rectangle(b, 640, 480);
+	for (i = 0; i < SPA_N_ELEMENTS(camera_sizes); i++)
+		spa_pod_builder_rectangle(b, camera_sizes[i].width, camera_sizes[i].height);
+	spa_pod_builder_pop(b, &f[1]);
+
+	spa_pod_builder_prop(b, SPA_FORMAT_VIDEO_framerate, 0);
+	spa_pod_builder_push_choice(b, &f[1], SPA_CHOICE_Enum, 0);
+	spa_pod_builder_fraction(b, 30, 1);
+	for (i = 0; i < SPA_N_ELEMENTS(camera_rates); i++)
+		spa_pod_builder_fraction(b, camera_rates[i].num, camera_rates[i].denom);
+	spa_pod_builder_pop(b, &f[1]);
+
+	return spa_pod_builder_pop(b, &f[0]);
+}
+
+static struct spa_pod *build_consumer_filter(struct spa_pod_builder *b)
+{
+	struct spa_pod_frame f[2];
+	uint32_t i;
+
+	spa_pod_builder_push_object(b, &f[0], SPA_TYPE_OBJECT_Format, SPA_PARAM_EnumFormat);
+	spa_pod_builder_add(b,
+			SPA_FORMAT_mediaType,		SPA_POD_Id(SPA_MEDIA_TYPE_video),
+			SPA_FORMAT_mediaSubtype,	SPA_POD_Id(SPA_MEDIA_SUBTYPE_raw), 0);
+
+	spa_pod_builder_prop(b, SPA_FORMAT_VIDEO_format, 0);
+	spa_pod_builder_push_choice(b, &f[1], SPA_CHOICE_Enum, 0);
+	spa_pod_builder_id(b, consumer_formats[0]);
+	for (i = 0; i < SPA_N_ELEMENTS(consumer_formats); i++)
+		spa_pod_builder_id(b, consumer_formats[i]);
+	spa_pod_builder_pop(b, &f[1]);
+
+	spa_pod_builder_prop(b, SPA_FORMAT_VIDEO_size, 0);
+	spa_pod_builder_push_choice(b, &f[1], SPA_CHOICE_Enum, 0);
+	spa_pod_builder_rectangle(b, 1280, 720);
+	for (i = 0; i < SPA_N_ELEMENTS(consumer_sizes); i++)
+		spa_pod_builder_rectangle(b, consumer_sizes[i].width, consumer_sizes[i].height);
+	spa_pod_builder_pop(b, &f[1]);
+
+	spa_pod_builder_prop(b, SPA_FORMAT_VIDEO_framerate, 0);
+	spa_pod_builder_push_choice(b, &f[1], SPA_CHOICE_Enum, 0);
+	spa_pod_builder_fraction(b, 30, 1);
+	for (i = 0; i < SPA_N_ELEMENTS(consumer_rates); i++)
+		spa_pod_builder_fraction(b, consumer_rates[i].num, consumer_rates[i].denom);
+	spa_pod_builder_pop(b, &f[1]);
+
+	return spa_pod_builder_pop(b, &f[0]);
+}
+
+/* a converter that can produce all raw formats */
+static struct spa_pod *build_convert_format(struct spa_pod_builder *b)
+{
+	struct spa_pod_frame f[2];
+	uint32_t i;
+
+	spa_pod_builder_push_object(b, &f[0], SPA_TYPE_OBJECT_Format, SPA_PARAM_EnumFormat);
+	spa_pod_builder_add(b,
+			SPA_FORMAT_mediaType,		SPA_POD_Id(SPA_MEDIA_TYPE_video),
+			SPA_FORMAT_mediaSubtype,	SPA_POD_Id(SPA_MEDIA_SUBTYPE_raw), 0);
+
+	spa_pod_builder_prop(b, SPA_FORMAT_VIDEO_format, 0);
+	spa_pod_builder_push_choice(b, &f[1], SPA_CHOICE_Enum, 0);
+	spa_pod_builder_id(b, SPA_VIDEO_FORMAT_RGBA_F32);
+	for (i = SPA_VIDEO_FORMAT_I420; i <= SPA_VIDEO_FORMAT_RGBA_F32; i++)
+		spa_pod_builder_id(b, i);
+	spa_pod_builder_pop(b, &f[1]);
+
+	return spa_pod_builder_pop(b, &f[0]);
+}
+
+static struct spa_pod *build_sink_filter(struct spa_pod_builder *b)
+{
+	struct spa_pod_frame f[2];
+	uint32_t i;
+
+	spa_pod_builder_push_object(b, &f[0], SPA_TYPE_OBJECT_Format, SPA_PARAM_EnumFormat);
+	spa_pod_builder_add(b,
+			SPA_FORMAT_mediaType,		SPA_POD_Id(SPA_MEDIA_TYPE_video),
+			SPA_FORMAT_mediaSubtype,	SPA_POD_Id(SPA_MEDIA_SUBTYPE_raw), 0);
+
+	spa_pod_builder_prop(b, SPA_FORMAT_VIDEO_format, 0);
+	spa_pod_builder_push_choice(b, &f[1], SPA_CHOICE_Enum, 0);
+	spa_pod_builder_id(b, sink_formats[0]);
+	for (i = 0; i < SPA_N_ELEMENTS(sink_formats); i++)
+		spa_pod_builder_id(b, sink_formats[i]);
+	spa_pod_builder_pop(b, &f[1]);
+
+	return spa_pod_builder_pop(b, &f[0]);
+}
+
+static uint64_t get_time(void)
+{
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return SPA_TIMESPEC_TO_NSEC(&ts);
+}
+
+/* filter all formats with the filter, like when enumerating the formats
+ * of a link */
+static uint64_t run_filter(const char *name, struct spa_pod **formats, uint32_t n_formats,
+		const struct spa_pod *filter, uint32_t n_expected, const char *mode, uint64_t base)
+{
+	uint8_t buffer[4096];
+	struct spa_pod_builder b;
+	struct spa_pod *result;
+	uint64_t t1, t2;
+	uint32_t i, count, n_results;
+
+	t1 = get_time();
+	for (count = 0; count < MAX_COUNT; count++) {
+		n_results = 0;
+		for (i = 0; i < n_formats; i++) {
+			spa_pod_builder_init(&b, buffer, sizeof(buffer));
+			if (spa_pod_filter(&b, &result, formats[i], filter) == 0)
+				n_results++;
+		}
+		spa_assert(n_results == n_expected);
+	}
+	t2 = get_time();
+
+	fprintf(stderr, "%s %s elapsed %"PRIu64" count %u = %"PRIu64"/sec", name, mode,
+			t2 - t1, MAX_COUNT, MAX_COUNT * (uint64_t)SPA_NSEC_PER_SEC / (t2 - t1));
+	if (base)
+		fprintf(stderr, " %f speedup", (double)base / (t2 - t1));
+	fprintf(stderr, "\n");
+
+	return t2 - t1;
+}
+
+static void test_filter(const char *name, struct spa_pod **formats, uint32_t n_formats,
+		const struct spa_pod *filter, uint32_t n_expected)
+{
+	uint64_t pairwise;
+
+	sort_min = UINT32_MAX;
+	pairwise = run_filter(name, formats, n_formats, filter, n_expected, "pairwise", 0);
+
+	sort_min = SPA_POD_FILTER_SORT_MIN_DEFAULT;
+	run_filter(name, formats, n_formats, filter, n_expected, "sorted", pairwise);
+}
+
+int main(int argc, char *argv[])
+{
+	uint8_t buffer[8192], fbuffer[1024];
+	struct spa_pod_builder b;
+	struct spa_pod *formats[SPA_N_ELEMENTS(camera_formats) + SPA_N_ELEMENTS(camera_subtypes)];
+	struct spa_pod *filter;
+	uint32_t i, j, n_formats = 0;
+
+	spa_pod_builder_init(&b, buffer, sizeof(buffer));
+	for (i = 0; i < SPA_N_ELEMENTS(camera_subtypes); i++) {
+		if (camera_subtypes[i] == SPA_MEDIA_SUBTYPE_raw) {
+			for (j = 0; j < SPA_N_ELEMENTS(camera_formats); j++)
+				formats[n_formats++] = build_camera_format(&b,
+						camera_subtypes[i], camera_formats[j]);
+		} else {
+			formats[n_formats++] = build_camera_format(&b, camera_subtypes[i], 0);
+		}
+	}
+	spa_pod_builder_init(&b, fbuffer, sizeof(fbuffer));
+	filter = build_consumer_filter(&b);
+
+	/* warmup */
+	sort_min = UINT32_MAX;
+	run_filter("warmup", formats, n_formats, filter, 2, "pairwise", 0);
+
+	test_filter("camera", formats, n_formats, filter, 2);
+
+	spa_pod_builder_init(&b, buffer, sizeof(buffer));
+	formats[0] = build_convert_format(&b);
+	spa_pod_builder_init(&b, fbuffer, sizeof(fbuffer));
+	filter = build_sink_filter(&b);
+
+	test_filter("convert", formats, 1, filter, 1);
+
+	return 0;
+}
@@ -32,6 +32,7 @@
 #include <spa/pod/pod.h>
 #include <spa/pod/builder.h>
 #include <spa/pod/parser.h>
+#include <spa/pod/schema.h>
 #include <spa/param/video/format-utils.h>
 #include <spa/debug/pod.h>
 
@@ -284,11 +285,171 @@ static void test_parser()
 			t2 - t1, count, count * (uint64_t)SPA_NSEC_PER_SEC / (t2 - t1));
 }
 
+struct video_vals {
+	uint32_t media_type;
+	uint32_t media_subtype;
+	uint32_t format;
+	struct spa_rectangle size;
+	struct spa_fraction framerate;
+};
+
+#define VIDEO_VALS_SCHEMA(F)						\
+	F(SPA_FORMAT_mediaType,		Id,		media_type,	0)	\
+	F(SPA_FORMAT_mediaSubtype,	Id,		media_subtype,	0)	\
+	F(SPA_FORMAT_VIDEO_format,	Id,		format,		0)	\
+	F(SPA_FORMAT_VIDEO_size,	Rectangle,	size,		0)	\
+	F(SPA_FORMAT_VIDEO_framerate,	Fraction,	framerate,	0)
+
+static void test_schema_parser()
+{
+	uint8_t buffer[1024];
+	struct spa_pod_builder b = { NULL, };
+	struct timespec ts;
+	uint64_t t1, t2;
+	uint64_t count = 0;
+	struct spa_pod *fmt;
+
+	spa_pod_builder_init(&b, buffer, sizeof(buffer));
+
+	fmt = spa_pod_builder_add_object(&b,
+			SPA_TYPE_OBJECT_Format, 0,
+			SPA_FORMAT_mediaType,	    SPA_POD_Id(SPA_MEDIA_TYPE_video),
+			SPA_FORMAT_mediaSubtype,    SPA_POD_Id(SPA_MEDIA_SUBTYPE_raw),
+			SPA_FORMAT_VIDEO_format,    SPA_POD_CHOICE_ENUM_Id(3,
+							SPA_VIDEO_FORMAT_I420,
+							SPA_VIDEO_FORMAT_I420,
+							SPA_VIDEO_FORMAT_YUY2),
+			SPA_FORMAT_VIDEO_size,      SPA_POD_CHOICE_RANGE_Rectangle(
+							&SPA_RECTANGLE(320, 240),
+							&SPA_RECTANGLE(1, 1),
+							&SPA_RECTANGLE(INT32_MAX, INT32_MAX)),
+			SPA_FORMAT_VIDEO_framerate, SPA_POD_CHOICE_RANGE_Fraction(
+							&SPA_FRACTION(25,1),
+							&SPA_FRACTION(0,1),
+							&SPA_FRACTION(INT32_MAX,1)));
+
+	spa_pod_fixate(fmt);
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	t1 = SPA_TIMESPEC_TO_NSEC(&ts);
+
+	fprintf(stderr, "test_schema_parser() : ");
+	for (count = 0; count < MAX_COUNT; count++) {
+		struct video_vals vals;
+
+		spa_zero(vals);
+
+		spa_assert(SPA_POD_SCHEMA_PARSE(fmt, SPA_TYPE_OBJECT_Format,
+					&vals, VIDEO_VALS_SCHEMA) == 5);
+
+		spa_assert(vals.media_type == SPA_MEDIA_TYPE_video);
+		spa_assert(vals.media_subtype == SPA_MEDIA_SUBTYPE_raw);
+		spa_assert(vals.format == SPA_VIDEO_FORMAT_I420);
+		spa_assert(vals.size.width == 320 && vals.size.height == 240);
+		spa_assert(vals.framerate.num == 25 && vals.framerate.denom == 1);
+
+		clock_gettime(CLOCK_MONOTONIC, &ts);
+		t2 = SPA_TIMESPEC_TO_NSEC(&ts);
+		if (t2 - t1 > 1 * SPA_NSEC_PER_SEC)
+			break;
+	}
+	fprintf(stderr, "elapsed %"PRIu64" count %"PRIu64" = %"PRIu64"/sec\n",
+			t2 - t1, count, count * (uint64_t)SPA_NSEC_PER_SEC / (t2 - t1));
+}
+
+static void test_format_builder()
+{
+	uint8_t buffer[1024];
+	struct spa_pod_builder b = { NULL, };
+	struct timespec ts;
+	uint64_t t1, t2;
+	uint64_t count = 0;
+	struct spa_video_info_raw info;
+
+	spa_zero(info);
+	info.format = SPA_VIDEO_FORMAT_I420;
+	info.size = SPA_RECTANGLE(320, 240);
+	info.framerate = SPA_FRACTION(25, 1);
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	t1 = SPA_TIMESPEC_TO_NSEC(&ts);
+
+	fprintf(stderr, "test_format_builder() : ");
+	for (count = 0; count < MAX_COUNT; count++) {
+		spa_pod_builder_init(&b, buffer, sizeof(buffer));
+
+		spa_pod_builder_add_object(&b,
+				SPA_TYPE_OBJECT_Format, 0,
+				SPA_FORMAT_mediaType,	    SPA_POD_Id(SPA_MEDIA_TYPE_video),
+				SPA_FORMAT_mediaSubtype,    SPA_POD_Id(SPA_MEDIA_SUBTYPE_raw),
+				SPA_FORMAT_VIDEO_format,    SPA_POD_Id(info.format),
+				SPA_FORMAT_VIDEO_size,      SPA_POD_Rectangle(&info.size),
+				SPA_FORMAT_VIDEO_framerate, SPA_POD_Fraction(&info.framerate));
+
+		clock_gettime(CLOCK_MONOTONIC, &ts);
+		t2 = SPA_TIMESPEC_TO_NSEC(&ts);
+		if (t2 - t1 > 1 * SPA_NSEC_PER_SEC)
+			break;
+	}
+	fprintf(stderr, "elapsed %"PRIu64" count %"PRIu64" = %"PRIu64"/sec\n",
+			t2 - t1, count, count * (uint64_t)SPA_NSEC_PER_SEC / (t2 - t1));
+}
+
+static void test_schema_builder()
+{
+	uint8_t buffer[1024], buffer2[1024];
+	struct spa_pod_builder b = { NULL, };
+	struct timespec ts;
+	uint64_t t1, t2;
+	uint64_t count = 0;
+	struct spa_video_info_raw info;
+	struct spa_pod *fmt, *fmt2;
+
+	spa_zero(info);
+	info.format = SPA_VIDEO_FORMAT_I420;
+	info.size = SPA_RECTANGLE(320, 240);
+	info.framerate = SPA_FRACTION(25, 1);
+
+	/* both paths make the same pod */
+	spa_pod_builder_init(&b, buffer2, sizeof(buffer2));
+	fmt2 = spa_pod_builder_add_object(&b,
+			SPA_TYPE_OBJECT_Format, 0,
+			SPA_FORMAT_mediaType,	    SPA_POD_Id(SPA_MEDIA_TYPE_video),
+			SPA_FORMAT_mediaSubtype,    SPA_POD_Id(SPA_MEDIA_SUBTYPE_raw),
+			SPA_FORMAT_VIDEO_format,    SPA_POD_Id(info.format),
+			SPA_FORMAT_VIDEO_size,      SPA_POD_Rectangle(&info.size),
+			SPA_FORMAT_VIDEO_framerate, SPA_POD_Fraction(&info.framerate));
+	spa_pod_builder_init(&b, buffer, sizeof(buffer));
+	fmt = spa_format_video_raw_build(&b, 0, &info);
+	spa_assert(SPA_POD_SIZE(fmt) == SPA_POD_SIZE(fmt2));
+	spa_assert(memcmp(fmt, fmt2, SPA_POD_SIZE(fmt)) == 0);
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	t1 = SPA_TIMESPEC_TO_NSEC(&ts);
+
+	fprintf(stderr, "test_schema_builder() : ");
+	for (count = 0; count < MAX_COUNT; count++) {
+		spa_pod_builder_init(&b, buffer, sizeof(buffer));
+
+		spa_format_video_raw_build(&b, 0, &info);
+
+		clock_gettime(CLOCK_MONOTONIC, &ts);
+		t2 = SPA_TIMESPEC_TO_NSEC(&ts);
+		if (t2 - t1 > 1 * SPA_NSEC_PER_SEC)
+			break;
+	}
+	fprintf(stderr, "elapsed %"PRIu64" count %"PRIu64" = %"PRIu64"/sec\n",
+			t2 - t1, count, count * (uint64_t)SPA_NSEC_PER_SEC / (t2 - t1));
+}
+
 int main(int argc, char *argv[])
 {
 	test_builder();
 	test_builder2();
+	test_format_builder();
+	test_schema_builder();
 	test_parse();
 	test_parser();
+	test_schema_parser();
 	return 0;
 }
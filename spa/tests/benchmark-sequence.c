@@ -0,0 +1,158 @@
+/* Spa
+ *
+ * Copyright © 2020 Wim Taymans
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the next
+ * paragraph) shall be included in all copies or substantial portions of the
+ * Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+#include <stdio.h>
+#include <errno.h>
+#include <time.h>
+
+#include <spa/pod/builder.h>
+#include <spa/pod/iter.h>
+#include <spa/control/control.h>
+
+#define MAX_COUNT 10000000
+#define N_EVENTS 64
+#define N_SEQ 4
+#define BUFFER_SIZE 8192
+
+/* the midi events of one cycle of a busy controller */
+static const uint8_t event[] = { 0x90, 0x3c, 0x7f };
+
+static uint64_t get_time(void)
+{
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return SPA_TIMESPEC_TO_NSEC(&ts);
+}
+
+static void print_result(const char *name, uint64_t t1, uint64_t t2, uint64_t count)
+{
+	fprintf(stderr, "%s: elapsed %"PRIu64" count %"PRIu64" = %"PRIu64" events/sec\n",
+			name, t2 - t1, count, count * N_EVENTS * (uint64_t)SPA_NSEC_PER_SEC / (t2 - t1));
+}
+
+static struct spa_pod_sequence *build_sequence(void *buffer, uint32_t size, uint32_t phase)
+{
+	struct spa_pod_builder b;
+	struct spa_pod_frame f;
+	uint32_t i;
+
+	spa_pod_builder_init(&b, buffer, size);
+	spa_pod_builder_push_sequence(&b, &f, 0);
+	for (i = 0; i < N_EVENTS; i++) {
+		spa_pod_builder_control(&b, i * 16 + phase, SPA_CONTROL_Midi);
+		spa_pod_builder_bytes(&b, event, sizeof(event));
+	}
+	return spa_pod_builder_pop(&b, &f);
+}
+
+/* what the midi sources did before, a control and then a copy of the bytes */
+static void test_build(void)
+{
+	uint8_t buffer[BUFFER_SIZE];
+	uint64_t t1, t2, count;
+
+	t1 = get_time();
+	for (count = 0; count < MAX_COUNT; count++) {
+		build_sequence(buffer, sizeof(buffer), 0);
+
+		t2 = get_time();
+		if (t2 - t1 > 1 * SPA_NSEC_PER_SEC)
+			break;
+	}
+	print_result("test_build()", t1, t2, count);
+}
+
+/* write the bytes in place, like the JACK layer copies its midi events */
+static void test_build_in_place(void)
+{
+	uint8_t buffer[BUFFER_SIZE];
+	struct spa_pod_builder b;
+	struct spa_pod_frame f;
+	uint64_t t1, t2, count;
+	uint32_t i;
+	uint8_t *data;
+
+	t1 = get_time();
+	for (count = 0; count < MAX_COUNT; count++) {
+		spa_pod_builder_init(&b, buffer, sizeof(buffer));
+		spa_pod_builder_push_sequence(&b, &f, 0);
+		for (i = 0; i < N_EVENTS; i++) {
+			data = spa_pod_builder_control_bytes(&b, i * 16, SPA_CONTROL_Midi, sizeof(event));
+			memcpy(data, event, sizeof(event));
+		}
+		spa_pod_builder_pop(&b, &f);
+
+		t2 = get_time();
+		if (t2 - t1 > 1 * SPA_NSEC_PER_SEC)
+			break;
+	}
+	print_result("test_build_in_place()", t1, t2, count);
+}
+
+/* merge the sequences of n_seq ports into one, like the control mixer */
+static void test_merge(uint32_t n_seq)
+{
+	uint8_t in[N_SEQ][BUFFER_SIZE], out[BUFFER_SIZE * N_SEQ];
+	struct spa_pod_sequence *seq[N_SEQ];
+	struct spa_pod_control *ctrl[N_SEQ], *c;
+	struct spa_pod_builder b;
+	struct spa_pod_frame f;
+	uint64_t t1, t2, count;
+	uint32_t i, n_events;
+	char name[64];
+
+	for (i = 0; i < n_seq; i++)
+		seq[i] = build_sequence(in[i], sizeof(in[i]), i);
+
+	t1 = get_time();
+	for (count = 0; count < MAX_COUNT; count++) {
+		for (i = 0; i < n_seq; i++)
+			ctrl[i] = spa_pod_control_first(&seq[i]->body);
+
+		spa_pod_builder_init(&b, out, sizeof(out));
+		spa_pod_builder_push_sequence(&b, &f, 0);
+		n_events = 0;
+		while ((c = spa_pod_sequence_merge_next(seq, ctrl, n_seq)) != NULL) {
+			spa_pod_builder_raw_padded(&b, c, SPA_POD_CONTROL_SIZE(c));
+			n_events++;
+		}
+		spa_pod_builder_pop(&b, &f);
+		spa_assert(n_events == n_seq * N_EVENTS);
+
+		t2 = get_time();
+		if (t2 - t1 > 1 * SPA_NSEC_PER_SEC)
+			break;
+	}
+	snprintf(name, sizeof(name), "test_merge(%u)", n_seq);
+	print_result(name, t1, t2, count * n_seq);
+}
+
+int main(int argc, char *argv[])
+{
+	test_build();
+	test_build_in_place();
+	test_merge(1);
+	test_merge(N_SEQ);
+	return 0;
+}
@@ -0,0 +1,229 @@
+/* Spa
+ *
+ * Copyright © 2020 Wim Taymans
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the next
+ * paragraph) shall be included in all copies or substantial portions of the
+ * Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+#include <string.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <pthread.h>
+#include <errno.h>
+#include <time.h>
+#include <dlfcn.h>
+#include <limits.h>
+#include <inttypes.h>
+
+#include <spa/support/plugin.h>
+#include <spa/support/loop.h>
+#include <spa/support/system.h>
+#include <spa/utils/names.h>
+#include <spa/utils/result.h>
+#include <spa/utils/type.h>
+
+#define N_THREADS	4
+#define N_ITEMS		200000
+#define BLOCK_EVERY	1000
+#define LARGE_EVERY	5000
+#define LARGE_SIZE	12000
+
+struct msg {
+	uint32_t thread;
+	uint32_t count;
+	uint8_t data[LARGE_SIZE];
+};
+
+static struct spa_loop *loop;
+static struct spa_loop_control *control;
+static uint32_t counts[N_THREADS];
+static uint32_t n_blocked;
+static bool running = true;
+
+static struct spa_handle *load_handle(const char *lib, const char *name,
+		const struct spa_support *support, uint32_t n_support)
+{
+	spa_handle_factory_enum_func_t enum_func;
+	const struct spa_handle_factory *factory;
+	struct spa_handle *handle;
+	uint32_t i;
+	void *hnd;
+	int res;
+
+	if ((hnd = dlopen(lib, RTLD_NOW)) == NULL) {
+		fprintf(stderr, "can't load %s: %s\n", lib, dlerror());
+		exit(EXIT_FAILURE);
+	}
+	if ((enum_func = dlsym(hnd, SPA_HANDLE_FACTORY_ENUM_FUNC_NAME)) == NULL) {
+		fprintf(stderr, "can't find enum function\n");
+		exit(EXIT_FAILURE);
+	}
+	for (i = 0; enum_func(&factory, &i) > 0;) {
+		if (strcmp(factory->name, name))
+			continue;
+
+		handle = calloc(1, spa_handle_factory_get_size(factory, NULL));
+		if ((res = spa_handle_factory_init(factory, handle, NULL, support, n_support)) < 0) {
+			fprintf(stderr, "can't make %s: %s\n", name, spa_strerror(res));
+			exit(EXIT_FAILURE);
+		}
+		return handle;
+	}
+	fprintf(stderr, "can't find %s\n", name);
+	exit(EXIT_FAILURE);
+}
+
+static void *get_interface(struct spa_handle *handle, const char *type)
+{
+	void *iface;
+	int res;
+
+	if ((res = spa_handle_get_interface(handle, type, &iface)) < 0) {
+		fprintf(stderr, "can't get %s: %s\n", type, spa_strerror(res));
+		exit(EXIT_FAILURE);
+	}
+	return iface;
+}
+
+static int do_item(struct spa_loop *loop, bool async, uint32_t seq,
+		const void *data, size_t size, void *user_data)
+{
+	const struct msg *m = data;
+	size_t i;
+
+	if (m->count != counts[m->thread]) {
+		fprintf(stderr, "thread %u: got item %u, expected %u\n",
+				m->thread, m->count, counts[m->thread]);
+		exit(EXIT_FAILURE);
+	}
+	for (i = offsetof(struct msg, data); i < size; i++) {
+		if (m->data[i - offsetof(struct msg, data)] != (uint8_t)(m->count + i)) {
+			fprintf(stderr, "thread %u: item %u corrupted\n", m->thread, m->count);
+			exit(EXIT_FAILURE);
+		}
+	}
+	counts[m->thread]++;
+	return m->count;
+}
+
+static void *producer_start(void *arg)
+{
+	uint32_t thread = SPA_PTR_TO_UINT32(arg), count;
+	static struct msg msgs[N_THREADS];
+	struct msg *m = &msgs[thread];
+	size_t i, size;
+	int res;
+
+	m->thread = thread;
+
+	for (count = 0; count < N_ITEMS; count++) {
+		bool block = (count % BLOCK_EVERY) == BLOCK_EVERY - 1;
+
+		m->count = count;
+		size = offsetof(struct msg, data) + (count % 8) * 8;
+		if ((count % LARGE_EVERY) == 0)
+			size = sizeof(struct msg);
+
+		for (i = offsetof(struct msg, data); i < size; i++)
+			m->data[i - offsetof(struct msg, data)] = (uint8_t)(count + i);
+
+		res = spa_loop_invoke(loop, do_item, 0, m, size, block, NULL);
+		if (res < 0) {
+			fprintf(stderr, "thread %u: invoke failed: %s\n", thread, spa_strerror(res));
+			exit(EXIT_FAILURE);
+		}
+		if (block) {
+			if (res != (int)count) {
+				fprintf(stderr, "thread %u: block result %d != %u\n", thread, res, count);
+				exit(EXIT_FAILURE);
+			}
+			__atomic_add_fetch(&n_blocked, 1, __ATOMIC_SEQ_CST);
+		}
+	}
+	return NULL;
+}
+
+static int do_stop(struct spa_loop *loop, bool async, uint32_t seq,
+		const void *data, size_t size, void *user_data)
+{
+	running = false;
+	return 0;
+}
+
+static void *loop_start(void *arg)
+{
+	spa_loop_control_enter(control);
+	while (running)
+		spa_loop_control_iterate(control, -1);
+	spa_loop_control_leave(control);
+	return NULL;
+}
+
+int main(int argc, char *argv[])
+{
+	struct spa_support support[1];
+	struct spa_handle *handle;
+	struct spa_system *system;
+	pthread_t loop_thread, threads[N_THREADS];
+	struct timespec ts1, ts2;
+	const char *dir;
+	char lib[PATH_MAX];
+	uint32_t i;
+
+	if ((dir = getenv("SPA_PLUGIN_DIR")) == NULL) {
+		fprintf(stderr, "SPA_PLUGIN_DIR not set\n");
+		return EXIT_FAILURE;
+	}
+	snprintf(lib, sizeof(lib), "%s/support/libspa-support.so", dir);
+
+	handle = load_handle(lib, SPA_NAME_SUPPORT_SYSTEM, NULL, 0);
+	system = get_interface(handle, SPA_TYPE_INTERFACE_System);
+	support[0] = SPA_SUPPORT_INIT(SPA_TYPE_INTERFACE_System, system);
+
+	handle = load_handle(lib, SPA_NAME_SUPPORT_LOOP, support, 1);
+	loop = get_interface(handle, SPA_TYPE_INTERFACE_Loop);
+	control = get_interface(handle, SPA_TYPE_INTERFACE_LoopControl);
+
+	printf("starting loop invoke stress test, %d threads, %d items\n", N_THREADS, N_ITEMS);
+
+	pthread_create(&loop_thread, NULL, loop_start, NULL);
+
+	clock_gettime(CLOCK_MONOTONIC, &ts1);
+	for (i = 0; i < N_THREADS; i++)
+		pthread_create(&threads[i], NULL, producer_start, SPA_UINT32_TO_PTR(i));
+	for (i = 0; i < N_THREADS; i++)
+		pthread_join(threads[i], NULL);
+
+	spa_loop_invoke(loop, do_stop, 0, NULL, 0, true, NULL);
+	clock_gettime(CLOCK_MONOTONIC, &ts2);
+
+	pthread_join(loop_thread, NULL);
+
+	for (i = 0; i < N_THREADS; i++) {
+		if (counts[i] != N_ITEMS) {
+			fprintf(stderr, "thread %u: %u items, expected %u\n", i, counts[i], N_ITEMS);
+			return EXIT_FAILURE;
+		}
+	}
+	printf("%d items, %u blocking, elapsed %"PRIu64" usec\n", N_THREADS * N_ITEMS, n_blocked,
+			(uint64_t)(SPA_TIMESPEC_TO_NSEC(&ts2) - SPA_TIMESPEC_TO_NSEC(&ts1)) / 1000);
+
+	return 0;
+}
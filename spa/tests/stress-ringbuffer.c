@@ -4,6 +4,9 @@
 #include <sched.h>
 #include <errno.h>
 #include <semaphore.h>
+#include <time.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
 
 #include <spa/utils/ringbuffer.h>
 
@@ -100,6 +103,146 @@ static void *writer_start(void *arg)
 	return NULL;
 }
 
+#define BENCH_BYTES (256u * 1024 * 1024)
+
+static uint64_t get_time(void)
+{
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return SPA_TIMESPEC_TO_NSEC(&ts);
+}
+
+/* map a memfd twice after each other, like PW_MEMMAP_FLAG_TWICE */
+static void *map_twice(uint32_t size)
+{
+	void *base = MAP_FAILED;
+#ifdef SYS_memfd_create
+	int fd;
+
+	if (size % sysconf(_SC_PAGESIZE) != 0)
+		return NULL;
+	if ((fd = syscall(SYS_memfd_create, "stress-ringbuffer", 0)) < 0)
+		return NULL;
+	if (ftruncate(fd, size) < 0)
+		goto exit;
+	base = mmap(NULL, size * 2, PROT_NONE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+	if (base == MAP_FAILED)
+		goto exit;
+	if (mmap(base, size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_FIXED, fd, 0) == MAP_FAILED ||
+	    mmap(SPA_MEMBER(base, size, void), size, PROT_READ | PROT_WRITE,
+		    MAP_SHARED | MAP_FIXED, fd, 0) == MAP_FAILED) {
+		munmap(base, size * 2);
+		base = MAP_FAILED;
+	}
+exit:
+	close(fd);
+#endif
+	return base == MAP_FAILED ? NULL : base;
+}
+
+static void __attribute__((noinline)) produce(uint32_t *data, uint32_t n_ints)
+{
+	uint32_t i;
+	for (i = 0; i < n_ints; i++)
+		data[i] = i;
+}
+
+static uint32_t __attribute__((noinline)) consume(const uint32_t *data, uint32_t n_ints)
+{
+	uint32_t i, sum = 0;
+	for (i = 0; i < n_ints; i++)
+		sum += data[i];
+	return sum;
+}
+
+/* write and read chunks of len bytes in a single thread and return the sum of
+ * the data so that nothing is optimized away */
+static uint32_t bench_run(void *buffer, int mode, uint32_t len, uint64_t *nsec)
+{
+	struct spa_ringbuffer r;
+	uint32_t i, index, sum = 0, n_ints = len / sizeof(uint32_t);
+	uint32_t src[1024], dst[1024];
+	uint64_t t;
+	const void *rptr;
+	void *wptr;
+
+	spa_ringbuffer_init(&r);
+	t = get_time();
+	for (i = 0; i < BENCH_BYTES / len; i++) {
+		switch (mode) {
+		case 0:
+			produce(src, n_ints);
+			spa_ringbuffer_get_write_index(&r, &index);
+			spa_ringbuffer_write_data(&r, buffer, size, index % size, src, len);
+			spa_ringbuffer_write_update(&r, index + len);
+
+			spa_ringbuffer_get_read_index(&r, &index);
+			spa_ringbuffer_read_data(&r, buffer, size, index % size, dst, len);
+			spa_ringbuffer_read_update(&r, index + len);
+			sum += consume(dst, n_ints);
+			break;
+		case 1:
+			produce(src, n_ints);
+			spa_ringbuffer_get_write_index(&r, &index);
+			/* a single copy, the mapping continues after the end */
+			memcpy(SPA_MEMBER(buffer, index % size, void), src, len);
+			spa_ringbuffer_write_update(&r, index + len);
+
+			spa_ringbuffer_get_read_index(&r, &index);
+			memcpy(dst, SPA_MEMBER(buffer, index % size, void), len);
+			spa_ringbuffer_read_update(&r, index + len);
+			sum += consume(dst, n_ints);
+			break;
+		case 2:
+			/* produce and consume in place */
+			spa_ringbuffer_get_write_area(&r, buffer, size, &index, &wptr);
+			produce(wptr, n_ints);
+			spa_ringbuffer_write_update(&r, index + len);
+
+			spa_ringbuffer_get_read_area(&r, buffer, size, &index, &rptr);
+			sum += consume(rptr, n_ints);
+			spa_ringbuffer_read_update(&r, index + len);
+			break;
+		}
+	}
+	*nsec = get_time() - t;
+	return sum;
+}
+
+static void bench(void)
+{
+	static const char *names[] = { "split copy", "twice copy", "twice in place" };
+	static uint32_t lens[] = { sizeof(int) * ARRAY_SIZE, 1020, 4092 };
+	void *buffer, *twice;
+	uint32_t i, m, sum;
+	uint64_t nsec;
+
+	/* use the same memory for all modes, the split copy only uses the
+	 * first mapping */
+	if ((twice = map_twice(size)) == NULL)
+		printf("can't map memory twice, only measuring split copy\n");
+	buffer = twice ? twice : malloc(size);
+
+	/* fault in the pages before measuring */
+	memset(buffer, 0, twice ? size * 2 : size);
+
+	for (i = 0; i < SPA_N_ELEMENTS(lens); i++) {
+		if (lens[i] > size)
+			continue;
+		for (m = 0; m < SPA_N_ELEMENTS(names); m++) {
+			if (m > 0 && twice == NULL)
+				break;
+			sum = bench_run(buffer, m, lens[i], &nsec);
+			printf("%-16s len %5u: %8.1f MB/s (%08x)\n", names[m], lens[i],
+					BENCH_BYTES / (nsec / 1e9) / (1024 * 1024), sum);
+		}
+	}
+	if (twice)
+		munmap(twice, size * 2);
+	else
+		free(buffer);
+}
+
 #define exit_error(msg) \
 do { perror(msg); exit(EXIT_FAILURE); } while (0)
 
@@ -119,6 +262,8 @@ int main(int argc, char *argv[])
 	printf("buffer size (bytes): %d\n", size);
 	printf("array size (bytes): %zd\n", sizeof(int) * ARRAY_SIZE);
 
+	bench();
+
 	spa_ringbuffer_init(&rb);
 	data = malloc(size);
 
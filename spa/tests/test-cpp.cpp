@@ -38,8 +38,10 @@
 #include <spa/node/event.h>
 #include <spa/node/io.h>
 #include <spa/node/node.h>
+#include <spa/param/buffers-utils.h>
 #include <spa/param/format.h>
 #include <spa/param/format-utils.h>
+#include <spa/param/latency-utils.h>
 #include <spa/param/param.h>
 #include <spa/param/props.h>
 #include <spa/param/audio/format.h>
@@ -61,6 +63,7 @@
 #include <spa/pod/iter.h>
 #include <spa/pod/parser.h>
 #include <spa/pod/pod.h>
+#include <spa/pod/schema.h>
 #include <spa/pod/vararg.h>
 #include <spa/support/cpu.h>
 #include <spa/support/dbus.h>
@@ -27,10 +27,16 @@
 #include <spa/pod/event.h>
 #include <spa/pod/iter.h>
 #include <spa/pod/parser.h>
+#include <spa/pod/filter.h>
+#include <spa/pod/schema.h>
 #include <spa/pod/vararg.h>
 #include <spa/debug/pod.h>
 #include <spa/param/format.h>
 #include <spa/param/video/raw.h>
+#include <spa/param/audio/format-utils.h>
+#include <spa/param/video/format-utils.h>
+#include <spa/param/buffers-utils.h>
+#include <spa/param/latency-utils.h>
 
 static void test_abi(void)
 {
@@ -1524,6 +1530,313 @@ static void test_overflow(void)
 	spa_debug_pod(0, NULL, pod);
 }
 
+static void test_schema(void)
+{
+	uint8_t buffer[1024];
+	struct spa_pod_builder b = { 0 };
+	struct spa_pod *pod;
+	struct spa_video_info_raw vinfo, vinfo2;
+	struct spa_audio_info_raw ainfo, ainfo2;
+	struct spa_buffers_info binfo, binfo2;
+	int64_t modifier = 0;
+	uint32_t format = 0;
+
+	/* the schema builder makes the same pod as the varargs builder */
+	spa_zero(vinfo);
+	vinfo.format = SPA_VIDEO_FORMAT_RGBA;
+	vinfo.size = SPA_RECTANGLE(640, 480);
+	vinfo.framerate = SPA_FRACTION(30, 1);
+	vinfo.modifier = 42;
+	vinfo.max_framerate = SPA_FRACTION(60, 1);
+
+	spa_pod_builder_init(&b, buffer, sizeof(buffer));
+	pod = spa_format_video_raw_build(&b, SPA_PARAM_Format, &vinfo);
+	spa_assert(pod != NULL);
+	spa_assert(spa_pod_parse_object(pod,
+			SPA_TYPE_OBJECT_Format, NULL,
+			SPA_FORMAT_VIDEO_format,	SPA_POD_Id(&format),
+			SPA_FORMAT_VIDEO_modifier,	SPA_POD_Long(&modifier)) == 2);
+	spa_assert(format == SPA_VIDEO_FORMAT_RGBA);
+	spa_assert(modifier == 42);
+
+	/* unset optional fields are not written */
+	spa_assert(spa_pod_find_prop(pod, NULL, SPA_FORMAT_VIDEO_views) == NULL);
+
+	spa_zero(vinfo2);
+	spa_assert(spa_format_video_raw_parse(pod, &vinfo2) == 5);
+	spa_assert(memcmp(&vinfo, &vinfo2, sizeof(vinfo)) == 0);
+
+	/* missing required field */
+	spa_pod_builder_init(&b, buffer, sizeof(buffer));
+	pod = spa_pod_builder_add_object(&b,
+			SPA_TYPE_OBJECT_Format, SPA_PARAM_Format,
+			SPA_FORMAT_VIDEO_format,	SPA_POD_Id(SPA_VIDEO_FORMAT_RGBA),
+			SPA_FORMAT_VIDEO_size,		SPA_POD_Rectangle(&SPA_RECTANGLE(640, 480)));
+	spa_assert(spa_format_video_raw_parse(pod, &vinfo2) == -ESRCH);
+
+	/* wrong type of required and optional field, wrong object */
+	spa_pod_builder_init(&b, buffer, sizeof(buffer));
+	pod = spa_pod_builder_add_object(&b,
+			SPA_TYPE_OBJECT_Format, SPA_PARAM_Format,
+			SPA_FORMAT_VIDEO_format,	SPA_POD_Int(SPA_VIDEO_FORMAT_RGBA));
+	spa_assert(spa_format_video_dsp_parse(pod, &(struct spa_video_info_dsp) { 0 }) == -EPROTO);
+	spa_assert(spa_buffers_parse(pod, &binfo) == -EPROTO);
+
+	spa_pod_builder_init(&b, buffer, sizeof(buffer));
+	pod = spa_pod_builder_add_object(&b,
+			SPA_TYPE_OBJECT_Format, SPA_PARAM_Format,
+			SPA_FORMAT_VIDEO_format,	SPA_POD_Id(SPA_VIDEO_FORMAT_RGBA),
+			SPA_FORMAT_VIDEO_modifier,	SPA_POD_Int(1));
+	spa_assert(spa_format_video_dsp_parse(pod, &(struct spa_video_info_dsp) { 0 }) == 1);
+
+	/* fixated choices and custom types */
+	spa_zero(ainfo);
+	ainfo.format = SPA_AUDIO_FORMAT_F32P;
+	ainfo.rate = 48000;
+	ainfo.channels = 2;
+	ainfo.position[0] = SPA_AUDIO_CHANNEL_FL;
+	ainfo.position[1] = SPA_AUDIO_CHANNEL_FR;
+
+	spa_pod_builder_init(&b, buffer, sizeof(buffer));
+	pod = spa_format_audio_raw_build(&b, SPA_PARAM_Format, &ainfo);
+	spa_zero(ainfo2);
+	spa_assert(spa_format_audio_raw_parse(pod, &ainfo2) == 4);
+	spa_assert(memcmp(&ainfo, &ainfo2, sizeof(ainfo)) == 0);
+
+	ainfo.flags = SPA_AUDIO_FLAG_UNPOSITIONED;
+	spa_zero(ainfo.position);
+	spa_pod_builder_init(&b, buffer, sizeof(buffer));
+	pod = spa_format_audio_raw_build(&b, SPA_PARAM_Format, &ainfo);
+	spa_assert(spa_pod_find_prop(pod, NULL, SPA_FORMAT_AUDIO_position) == NULL);
+	spa_assert(spa_format_audio_raw_parse(pod, &ainfo2) == 3);
+	spa_assert(SPA_FLAG_IS_SET(ainfo2.flags, SPA_AUDIO_FLAG_UNPOSITIONED));
+
+	spa_pod_builder_init(&b, buffer, sizeof(buffer));
+	pod = spa_pod_builder_add_object(&b,
+			SPA_TYPE_OBJECT_ParamBuffers, SPA_PARAM_Buffers,
+			SPA_PARAM_BUFFERS_buffers, SPA_POD_CHOICE_RANGE_Int(4, 2, 16),
+			SPA_PARAM_BUFFERS_size,    SPA_POD_Int(4096),
+			SPA_PARAM_BUFFERS_align,   SPA_POD_Int(16));
+	spa_assert(spa_buffers_parse(pod, &binfo) == -EPROTO);
+	spa_pod_fixate(pod);
+	binfo = (struct spa_buffers_info) { .blocks = 1 };
+	spa_assert(spa_buffers_parse(pod, &binfo) == 3);
+	spa_assert(binfo.buffers == 4);
+	spa_assert(binfo.blocks == 1);
+	spa_assert(binfo.size == 4096);
+	spa_assert(binfo.stride == 0);
+	spa_assert(binfo.align == 16);
+
+	spa_pod_builder_init(&b, buffer, sizeof(buffer));
+	pod = spa_buffers_build(&b, SPA_PARAM_Buffers, &binfo);
+	spa_zero(binfo2);
+	spa_assert(spa_buffers_parse(pod, &binfo2) == 4);
+	spa_assert(memcmp(&binfo, &binfo2, sizeof(binfo)) == 0);
+
+	/* a repeated required key doesn't make up for a missing one */
+	spa_pod_builder_init(&b, buffer, sizeof(buffer));
+	pod = spa_pod_builder_add_object(&b,
+			SPA_TYPE_OBJECT_ParamBuffers, SPA_PARAM_Buffers,
+			SPA_PARAM_BUFFERS_buffers, SPA_POD_Int(4),
+			SPA_PARAM_BUFFERS_buffers, SPA_POD_Int(8));
+	spa_assert(spa_buffers_parse(pod, &binfo) == -ESRCH);
+
+	/* the last value is used, the optional fields keep their value */
+	spa_pod_builder_init(&b, buffer, sizeof(buffer));
+	pod = spa_pod_builder_add_object(&b,
+			SPA_TYPE_OBJECT_ParamBuffers, SPA_PARAM_Buffers,
+			SPA_PARAM_BUFFERS_buffers, SPA_POD_Int(4),
+			SPA_PARAM_BUFFERS_size,    SPA_POD_Int(1024),
+			SPA_PARAM_BUFFERS_buffers, SPA_POD_Int(8));
+	binfo = (struct spa_buffers_info) { .blocks = 1, .align = 16 };
+	spa_assert(spa_buffers_parse(pod, &binfo) == 2);
+	spa_assert(binfo.buffers == 8);
+	spa_assert(binfo.blocks == 1);
+	spa_assert(binfo.size == 1024);
+	spa_assert(binfo.align == 16);
+}
+
+static void test_filter(void)
+{
+	uint8_t buffer[4096], fbuffer[4096], rbuffer[4096];
+	struct spa_pod_builder b;
+	struct spa_pod_frame f[2];
+	struct spa_pod *pod, *filter, *result;
+	const struct spa_pod_prop *prop;
+	const struct spa_rectangle *sizes;
+	struct spa_rectangle s1[48], s2[24], expect[48 * 24];
+	uint32_t i, j, n_expect = 0, n_vals, choice;
+
+	/* unsorted values with duplicates, large enough to be sorted */
+	for (i = 0; i < SPA_N_ELEMENTS(s1); i++)
+		s1[i] = SPA_RECTANGLE(((i * 7) % 20 + 1) * 16, ((i * 5) % 12 + 1) * 9);
+	for (i = 0; i < SPA_N_ELEMENTS(s2); i++)
+		s2[i] = SPA_RECTANGLE(((i * 3) % 16 + 1) * 16, ((i * 11) % 12 + 1) * 9);
+
+	/* the first value is the default, the other values are copied once
+	 * for each equal value in the filter */
+	for (i = 1; i < SPA_N_ELEMENTS(s1); i++)
+		for (j = 1; j < SPA_N_ELEMENTS(s2); j++)
+			if (s1[i].width == s2[j].width && s1[i].height == s2[j].height)
+				expect[n_expect++] = s1[i];
+	spa_assert(n_expect > 0);
+
+	spa_pod_builder_init(&b, buffer, sizeof(buffer));
+	spa_pod_builder_push_object(&b, &f[0], SPA_TYPE_OBJECT_Format, SPA_PARAM_EnumFormat);
+	spa_pod_builder_add(&b,
+			SPA_FORMAT_mediaType,		SPA_POD_Id(SPA_MEDIA_TYPE_video),
+			SPA_FORMAT_mediaSubtype,	SPA_POD_Id(SPA_MEDIA_SUBTYPE_raw), 0);
+	spa_pod_builder_prop(&b, SPA_FORMAT_VIDEO_size, 0);
+	spa_pod_builder_push_choice(&b, &f[1], SPA_CHOICE_Enum, 0);
+	for (i = 0; i < SPA_N_ELEMENTS(s1); i++)
+		spa_pod_builder_rectangle(&b, s1[i].width, s1[i].height);
+	spa_pod_builder_pop(&b, &f[1]);
+	pod = spa_pod_builder_pop(&b, &f[0]);
+
+	spa_pod_builder_init(&b, fbuffer, sizeof(fbuffer));
+	spa_pod_builder_push_object(&b, &f[0], SPA_TYPE_OBJECT_Format, SPA_PARAM_EnumFormat);
+	spa_pod_builder_add(&b,
+			SPA_FORMAT_mediaType,		SPA_POD_Id(SPA_MEDIA_TYPE_video),
+			SPA_FORMAT_mediaSubtype,	SPA_POD_Id(SPA_MEDIA_SUBTYPE_raw), 0);
+	spa_pod_builder_prop(&b, SPA_FORMAT_VIDEO_size, 0);
+	spa_pod_builder_push_choice(&b, &f[1], SPA_CHOICE_Enum, 0);
+	for (i = 0; i < SPA_N_ELEMENTS(s2); i++)
+		spa_pod_builder_rectangle(&b, s2[i].width, s2[i].height);
+	spa_pod_builder_pop(&b, &f[1]);
+	filter = spa_pod_builder_pop(&b, &f[0]);
+
+	spa_pod_builder_init(&b, rbuffer, sizeof(rbuffer));
+	spa_assert(spa_pod_filter(&b, &result, pod, filter) == 0);
+	prop = spa_pod_find_prop(result, NULL, SPA_FORMAT_VIDEO_size);
+	spa_assert(prop != NULL);
+	sizes = SPA_POD_BODY(spa_pod_get_values(&prop->value, &n_vals, &choice));
+	spa_assert(choice == SPA_CHOICE_Enum);
+	spa_assert(n_vals == n_expect + 1);
+	spa_assert(memcmp(&sizes[1], expect, n_expect * sizeof(expect[0])) == 0);
+
+	/* formats with another fixed subtype are rejected */
+	spa_pod_builder_init(&b, fbuffer, sizeof(fbuffer));
+	filter = spa_pod_builder_add_object(&b,
+			SPA_TYPE_OBJECT_Format, SPA_PARAM_EnumFormat,
+			SPA_FORMAT_mediaType,		SPA_POD_Id(SPA_MEDIA_TYPE_video),
+			SPA_FORMAT_mediaSubtype,	SPA_POD_Id(SPA_MEDIA_SUBTYPE_mjpg));
+	spa_pod_builder_init(&b, rbuffer, sizeof(rbuffer));
+	spa_assert(spa_pod_filter(&b, &result, pod, filter) == -EINVAL);
+}
+
+static void test_latency(void)
+{
+	uint8_t buffer[1024];
+	struct spa_pod_builder b;
+	struct spa_pod *pod;
+	struct spa_latency_info info, res;
+
+	info = SPA_LATENCY_INFO(SPA_DIRECTION_OUTPUT,
+			.min_quantum = 0.5f, .max_quantum = 2.0f,
+			.min_rate = 64, .max_rate = 256,
+			.min_ns = 1000, .max_ns = 20000000000ULL);
+
+	spa_pod_builder_init(&b, buffer, sizeof(buffer));
+	pod = spa_latency_build(&b, SPA_PARAM_Latency, &info);
+	spa_assert(pod != NULL);
+	spa_assert(spa_pod_is_object_type(pod, SPA_TYPE_OBJECT_ParamLatency));
+	spa_assert(SPA_POD_OBJECT_ID(pod) == SPA_PARAM_Latency);
+
+	spa_assert(spa_latency_parse(pod, &res) == 0);
+	spa_assert(res.direction == SPA_DIRECTION_OUTPUT);
+	spa_assert(spa_latency_info_compare(&info, &res) == 0);
+	spa_assert(memcmp(&info, &res, sizeof(info)) == 0);
+
+	/* only the direction is required, the rest defaults to 0 */
+	spa_pod_builder_init(&b, buffer, sizeof(buffer));
+	pod = spa_pod_builder_add_object(&b,
+			SPA_TYPE_OBJECT_ParamLatency, SPA_PARAM_Latency,
+			SPA_PARAM_LATENCY_direction,	SPA_POD_Id(SPA_DIRECTION_INPUT),
+			SPA_PARAM_LATENCY_maxRate,	SPA_POD_Int(128));
+	spa_assert(spa_latency_parse(pod, &res) == 0);
+	spa_assert(res.direction == SPA_DIRECTION_INPUT);
+	info = SPA_LATENCY_INFO(SPA_DIRECTION_INPUT, .max_rate = 128);
+	spa_assert(spa_latency_info_compare(&info, &res) == 0);
+
+	spa_pod_builder_init(&b, buffer, sizeof(buffer));
+	pod = spa_pod_builder_add_object(&b,
+			SPA_TYPE_OBJECT_ParamLatency, SPA_PARAM_Latency,
+			SPA_PARAM_LATENCY_minRate,	SPA_POD_Int(128));
+	spa_assert(spa_latency_parse(pod, &res) < 0);
+
+	/* a too small builder fails to build */
+	spa_pod_builder_init(&b, buffer, 32);
+	spa_assert(spa_latency_build(&b, SPA_PARAM_Latency, &info) == NULL);
+}
+
+static void test_sequence(void)
+{
+	uint8_t buffer[1024], buffer2[1024];
+	struct spa_pod_builder b;
+	struct spa_pod_frame f;
+	struct spa_pod_sequence *seq[2];
+	struct spa_pod_control *ctrl[2], *c;
+	static const uint8_t note_on[] = { 0x90, 0x3c, 0x7f };
+	static const uint8_t sysex[] = { 0xf0, 0x7e, 0x7f, 0x06, 0x01, 0xf7 };
+	static const uint32_t offsets[] = { 0, 4, 4, 8, 8 };
+	static const uint32_t sizes[] = { 6, 3, 6, 3, 6 };
+	uint8_t *data;
+	uint32_t i;
+
+	/* controls with bytes written in place, the padding is zeroed */
+	memset(buffer, 0xff, sizeof(buffer));
+	spa_pod_builder_init(&b, buffer, sizeof(buffer));
+	spa_assert(spa_pod_builder_push_sequence(&b, &f, 0) == 0);
+	data = spa_pod_builder_control_bytes(&b, 4, SPA_CONTROL_Midi, sizeof(note_on));
+	spa_assert(data != NULL);
+	memcpy(data, note_on, sizeof(note_on));
+	data = spa_pod_builder_control_bytes(&b, 8, SPA_CONTROL_Midi, sizeof(note_on));
+	spa_assert(data != NULL);
+	memcpy(data, note_on, sizeof(note_on));
+	seq[0] = spa_pod_builder_pop(&b, &f);
+	spa_assert(seq[0] != NULL);
+	spa_assert(SPA_POD_BODY_SIZE(seq[0]) == sizeof(struct spa_pod_sequence_body) +
+			2 * (sizeof(struct spa_pod_control) + 8));
+
+	spa_pod_builder_init(&b, buffer2, sizeof(buffer2));
+	spa_assert(spa_pod_builder_push_sequence(&b, &f, 0) == 0);
+	for (i = 0; i < 3; i++) {
+		spa_assert(spa_pod_builder_control(&b, i * 4, SPA_CONTROL_Midi) == 0);
+		spa_assert(spa_pod_builder_bytes(&b, sysex, sizeof(sysex)) == 0);
+	}
+	seq[1] = spa_pod_builder_pop(&b, &f);
+	spa_assert(seq[1] != NULL);
+
+	i = 0;
+	SPA_POD_SEQUENCE_FOREACH(seq[0], c) {
+		spa_assert(c->offset == (i + 1) * 4);
+		spa_assert(c->type == SPA_CONTROL_Midi);
+		spa_assert(spa_pod_is_bytes(&c->value));
+		spa_assert(SPA_POD_BODY_SIZE(&c->value) == sizeof(note_on));
+		spa_assert(memcmp(SPA_POD_BODY(&c->value), note_on, sizeof(note_on)) == 0);
+		data = SPA_POD_BODY(&c->value);
+		spa_assert(data[3] == 0 && data[7] == 0);
+		i++;
+	}
+	spa_assert(i == 2);
+
+	/* merge in time order, equal offsets in the order of the sequences */
+	for (i = 0; i < 2; i++)
+		ctrl[i] = spa_pod_control_first(&seq[i]->body);
+	i = 0;
+	while ((c = spa_pod_sequence_merge_next(seq, ctrl, 2)) != NULL) {
+		spa_assert(i < SPA_N_ELEMENTS(offsets));
+		spa_assert(c->offset == offsets[i]);
+		spa_assert(SPA_POD_BODY_SIZE(&c->value) == sizes[i]);
+		i++;
+	}
+	spa_assert(i == SPA_N_ELEMENTS(offsets));
+
+	/* no space */
+	spa_pod_builder_init(&b, buffer, sizeof(struct spa_pod_control) + 4);
+	spa_assert(spa_pod_builder_control_bytes(&b, 0, SPA_CONTROL_Midi, 3) == NULL);
+}
+
 int main(int argc, char *argv[])
 {
 	test_abi();
@@ -1535,5 +1848,9 @@ int main(int argc, char *argv[])
 	test_parser2();
 	test_static();
 	test_overflow();
+	test_schema();
+	test_filter();
+	test_latency();
+	test_sequence();
 	return 0;
 }
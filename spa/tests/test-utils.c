@@ -123,7 +123,8 @@ static void test_abi(void)
 	spa_assert(SPA_TYPE_OBJECT_ParamProfile == 0x40007);
 	spa_assert(SPA_TYPE_OBJECT_ParamPortConfig == 0x40008);
 	spa_assert(SPA_TYPE_OBJECT_ParamRoute == 0x40009);
-	spa_assert(SPA_TYPE_OBJECT_LAST == 0x4000a);
+	spa_assert(SPA_TYPE_OBJECT_ParamLatency == 0x4000a);
+	spa_assert(SPA_TYPE_OBJECT_LAST == 0x4000b);
 
 	spa_assert(SPA_TYPE_VENDOR_PipeWire == 0x02000000);
 	spa_assert(SPA_TYPE_VENDOR_Other == 0x7f000000);
@@ -170,6 +171,33 @@ static void test_dict(void)
     spa_assert(i == 5);
 }
 
+static void test_dict_hash(void)
+{
+    struct spa_dict_item items[5] = {
+        SPA_DICT_ITEM_INIT("key", "value"),
+        SPA_DICT_ITEM_INIT("pipe", "wire"),
+        SPA_DICT_ITEM_INIT("test", "Works!"),
+        SPA_DICT_ITEM_INIT("123", ""),
+        SPA_DICT_ITEM_INIT("SPA", "Simple Plugin API"),
+    };
+    struct spa_dict dict = SPA_DICT_INIT_ARRAY (items);
+    uint32_t slots[16], hashes[5];
+    struct spa_dict_hash hash = { 16, slots, hashes };
+
+    spa_dict_hash_index(&dict, &hash);
+
+    spa_assert(!strcmp(spa_dict_hash_lookup_item(&dict, &hash, "pipe")->value, "wire"));
+    spa_assert(!strcmp(spa_dict_hash_lookup_item(&dict, &hash, "SPA")->value, "Simple Plugin API"));
+    spa_assert(spa_dict_hash_lookup_item(&dict, &hash, "123") == &items[3]);
+    spa_assert(spa_dict_hash_lookup_item(&dict, &hash, "key") == &items[0]);
+    spa_assert(spa_dict_hash_lookup_item(&dict, &hash, "nonexistent") == NULL);
+
+    /* only the indexed items are looked at */
+    dict.n_items = 3;
+    spa_assert(spa_dict_hash_lookup_item(&dict, &hash, "test") == &items[2]);
+    spa_assert(spa_dict_hash_lookup_item(&dict, &hash, "SPA") == NULL);
+}
+
 struct string_list {
     char string[20];
     struct spa_list node;
@@ -405,6 +433,7 @@ int main(int argc, char *argv[])
     test_abi();
     test_macros();
     test_dict();
+    test_dict_hash();
     test_list();
     test_hook();
     test_ringbuffer();
@@ -0,0 +1,118 @@
+/* PipeWire
+ *
+ * Copyright © 2020 Wim Taymans
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the next
+ * paragraph) shall be included in all copies or substantial portions of the
+ * Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+#ifndef PIPEWIRE_EXT_PROFILER_H
+#define PIPEWIRE_EXT_PROFILER_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <errno.h>
+#include <string.h>
+
+#include <spa/utils/defs.h>
+
+/** \page page_profiler Profiler
+ *
+ * When the context is created with the \ref PW_KEY_CONTEXT_PROFILER property,
+ * the timing of every node in every graph cycle is appended to a ring of
+ * records in shared memory named after the core, see
+ * \ref PW_PROFILER_SHM_FORMAT.
+ *
+ * The ring has one writer, the data thread, that never waits for readers.
+ * Records are overwritten when a reader falls behind. Each record carries
+ * its sequence number so that a reader can detect a record that was
+ * overwritten while it was being read.
+ */
+
+#define PW_PROFILER_SHM_FORMAT		"/%s.profiler"	/**< shm_open name, with the core name */
+
+#define PW_PROFILER_MAGIC		0x50575046	/* "PWPF" */
+#define PW_VERSION_PROFILER		0
+
+/** the timing of a node in one cycle */
+struct pw_profiler_record {
+	uint64_t seq;			/**< index of the record + 1, 0 while written */
+	uint32_t id;			/**< node id */
+	uint32_t driver_id;		/**< id of the driver of the node */
+	uint64_t position;		/**< clock position of the cycle, in samples */
+	uint32_t quantum;		/**< duration of the cycle, in samples */
+	uint32_t rate;			/**< sample rate of the cycle */
+	uint64_t signal_time;		/**< node was triggered */
+	uint64_t awake_time;		/**< node started processing */
+	uint64_t finish_time;		/**< node finished processing */
+#define PW_PROFILER_RECORD_FLAG_DRIVER		(1<<0)	/**< the node is the driver */
+#define PW_PROFILER_RECORD_FLAG_INCOMPLETE	(1<<1)	/**< the node did not finish in time */
+	uint32_t flags;
+	uint32_t xrun_count;		/**< number of xruns of the node */
+};
+
+/** the shared memory layout, followed by n_records records */
+struct pw_profiler_header {
+	uint32_t magic;			/**< PW_PROFILER_MAGIC */
+	uint32_t version;		/**< PW_VERSION_PROFILER */
+	uint32_t record_size;		/**< sizeof(struct pw_profiler_record) */
+	uint32_t n_records;		/**< number of records, a power of 2 */
+	uint64_t write_index;		/**< number of records written */
+	uint32_t padding[10];
+};
+
+static inline struct pw_profiler_record *
+pw_profiler_get_record(struct pw_profiler_header *h, uint64_t index)
+{
+	return SPA_MEMBER(h, sizeof(*h) + (index & (h->n_records - 1)) * h->record_size,
+			struct pw_profiler_record);
+}
+
+/** Read record \a index from the ring.
+ *
+ * \return 1 when the record was read, 0 when it is not completely written
+ *   yet and -ESTALE when it was overwritten
+ */
+static inline int pw_profiler_read_record(struct pw_profiler_header *h, uint64_t index,
+		struct pw_profiler_record *record)
+{
+	struct pw_profiler_record *r = pw_profiler_get_record(h, index);
+	uint64_t seq;
+
+	if (index >= __atomic_load_n(&h->write_index, __ATOMIC_ACQUIRE))
+		return 0;
+
+	seq = __atomic_load_n(&r->seq, __ATOMIC_ACQUIRE);
+	memcpy(record, r, sizeof(*record));
+	__atomic_thread_fence(__ATOMIC_ACQUIRE);
+
+	if (seq == index + 1 && __atomic_load_n(&r->seq, __ATOMIC_RELAXED) == seq)
+		return 1;
+	if (__atomic_load_n(&h->write_index, __ATOMIC_ACQUIRE) > index + h->n_records)
+		return -ESTALE;
+	return 0;
+}
+
+#ifdef __cplusplus
+}  /* extern "C" */
+#endif
+
+#endif /* PIPEWIRE_EXT_PROFILER_H */
@@ -777,7 +777,7 @@ do_port_use_buffers(struct impl *impl,
 
 		mb[i].buffer = &b->buffer;
 		mb[i].mem_id = m->id;
-		mb[i].offset = SPA_PTRDIFF(baseptr, SPA_MEMBER(mem->map->ptr, 0, void));
+		mb[i].offset = SPA_PTRDIFF(baseptr, mem->map->ptr) + mem->map->offset;
 		mb[i].size = data_size;
 		spa_log_debug(this->log, NAME" %p: buffer %d %d %d %d", this, i, mb[i].mem_id,
 				mb[i].offset, mb[i].size);
@@ -871,7 +871,8 @@ static int impl_node_process(void *object)
 	n->rt.activation->status = PW_NODE_ACTIVATION_TRIGGERED;
 	n->rt.activation->signal_time = SPA_TIMESPEC_TO_NSEC(&ts);
 
-	if (spa_system_eventfd_write(this->data_system, this->writefd, 1) < 0)
+	if (pw_node_activation_wakeup(n->rt.activation) &&
+	    spa_system_eventfd_write(this->data_system, this->writefd, 1) < 0)
 		spa_log_warn(this->log, NAME" %p: error %m", this);
 
 	return SPA_STATUS_OK;
@@ -1212,7 +1213,7 @@ void pw_impl_client_node_registered(struct pw_impl_client_node *this, struct pw_
 					  impl->other_fds[0],
 					  impl->other_fds[1],
 					  m->id,
-					  0,
+					  node->activation->map->offset,
 					  sizeof(struct pw_node_activation));
 
 	if (impl->bind_node_id) {
@@ -1245,7 +1246,8 @@ static void node_initialized(void *data)
 	impl->io_areas = pw_mempool_alloc(impl->context->pool,
 			PW_MEMBLOCK_FLAG_READWRITE |
 			PW_MEMBLOCK_FLAG_MAP |
-			PW_MEMBLOCK_FLAG_SEAL,
+			PW_MEMBLOCK_FLAG_SEAL |
+			PW_MEMBLOCK_FLAG_ARENA,
 			SPA_DATA_MemFd, size);
 	if (impl->io_areas == NULL)
                 return;
@@ -1519,7 +1521,7 @@ static void node_peer_added(void *data, struct pw_impl_node *peer)
 					  peer->info.id,
 					  peer->source.fd,
 					  m->id,
-					  0,
+					  peer->activation->map->offset,
 					  sizeof(struct pw_node_activation));
 }
 
@@ -1660,6 +1662,9 @@ struct pw_impl_client_node *pw_impl_client_node_new(struct pw_resource *resource
 
 	this->node->rt.target.signal = process_node;
 	this->node->rt.target.data = impl;
+	/* the client wakes up the targets, it sets the flag again when
+	 * it knows how to do that without the eventfd */
+	SPA_FLAG_CLEAR(this->node->rt.activation->flags, PW_NODE_ACTIVATION_FLAG_WAKEUP);
 
 	pw_resource_add_listener(this->resource,
 				&impl->resource_listener,
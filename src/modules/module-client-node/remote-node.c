@@ -66,6 +66,7 @@ struct link {
 	struct pw_memmap *map;
 	struct pw_node_target target;
 	int signalfd;
+	unsigned int wakeup:1;
 };
 
 struct node_data {
@@ -253,6 +254,8 @@ static int client_node_transport(void *object,
 	}
 
 	data->node->rt.activation = data->activation->ptr;
+	if (size >= sizeof(struct pw_node_activation))
+		SPA_FLAG_SET(data->node->rt.activation->flags, PW_NODE_ACTIVATION_FLAG_WAKEUP);
 
 	pw_log_debug("remote-node %p: fds:%d %d node:%u activation:%p",
 		proxy, readfd, writefd, data->remote_id, data->activation->ptr);
@@ -789,7 +792,8 @@ static int link_signal_func(void *user_data)
 	link->target.activation->status = PW_NODE_ACTIVATION_TRIGGERED;
 	link->target.activation->signal_time = SPA_TIMESPEC_TO_NSEC(&ts);
 
-	if (write(link->signalfd, &cmd, sizeof(cmd)) != sizeof(cmd))
+	if ((!link->wakeup || pw_node_activation_wakeup(link->target.activation)) &&
+	    write(link->signalfd, &cmd, sizeof(cmd)) != sizeof(cmd))
 		pw_log_warn("link %p: write failed %m", link);
 
 	return 0;
@@ -844,6 +848,7 @@ client_node_set_activation(void *object,
 		link->map = mm;
 		link->target.activation = ptr;
 		link->signalfd = signalfd;
+		link->wakeup = size >= sizeof(struct pw_node_activation);
 		link->target.signal = link_signal_func;
 		link->target.data = link;
 		link->target.node = NULL;
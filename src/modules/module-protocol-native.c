@@ -68,6 +68,16 @@ static bool debug_messages = 0;
 #define LOCK_SUFFIX     ".lock"
 #define LOCK_SUFFIXLEN  5
 
+static size_t get_oob_size(const struct spa_dict *props)
+{
+	const char *str;
+
+	if (props == NULL ||
+	    (str = spa_dict_lookup(props, PW_KEY_PROTOCOL_OOB_SIZE)) == NULL)
+		return 0;
+	return SPA_MAX(atoi(str), 0);
+}
+
 void pw_protocol_native_init(struct pw_protocol *protocol);
 void pw_protocol_native0_init(struct pw_protocol *protocol);
 
@@ -88,9 +98,13 @@ struct client {
 	struct pw_protocol_native_connection *connection;
 	struct spa_hook conn_listener;
 
+	size_t oob_size;
+	struct spa_hook core_listener;
+
 	unsigned int disconnecting:1;
 	unsigned int flushing:1;
 	unsigned int paused:1;
+	unsigned int have_core_listener:1;
 };
 
 struct server {
@@ -307,9 +321,31 @@ static void client_free(void *data)
 	pw_map_clear(&this->compat_v2.types);
 }
 
+/* the client puts the oob-size of its context in its properties when it
+ * can receive out of band messages. Only then they are used, in both
+ * directions. */
+static void client_info_changed(void *data, const struct pw_client_info *info)
+{
+	struct client_data *this = data;
+	struct pw_context *context = this->client->context;
+	size_t size;
+
+	if (!SPA_FLAG_IS_SET(info->change_mask, PW_CLIENT_CHANGE_MASK_PROPS))
+		return;
+
+	size = get_oob_size(&pw_context_get_properties(context)->dict);
+	if (get_oob_size(info->props) == 0)
+		size = 0;
+
+	pw_log_debug(NAME" %p: client %p oob-size %zd", context, this->client, size);
+	pw_protocol_native_connection_set_oob_size(this->connection, size);
+	pw_protocol_native_connection_set_oob_accept(this->connection, size > 0);
+}
+
 static const struct pw_impl_client_events client_events = {
 	PW_VERSION_IMPL_CLIENT_EVENTS,
 	.free = client_free,
+	.info_changed = client_info_changed,
 	.busy_changed = client_busy_changed,
 };
 
@@ -730,6 +766,28 @@ static const struct pw_protocol_native_connection_events client_conn_events = {
 	.need_flush = on_need_flush,
 };
 
+/* the core info of the server has its oob-size when it accepts out of
+ * band messages from us */
+static void on_core_info(void *data, const struct pw_core_info *info)
+{
+	struct client *impl = data;
+	size_t size = impl->oob_size;
+
+	if (!SPA_FLAG_IS_SET(info->change_mask, PW_CORE_CHANGE_MASK_PROPS))
+		return;
+
+	if (get_oob_size(info->props) == 0)
+		size = 0;
+
+	pw_log_debug(NAME" %p: oob-size %zd", impl, size);
+	pw_protocol_native_connection_set_oob_size(impl->connection, size);
+}
+
+static const struct pw_core_events client_core_events = {
+	PW_VERSION_CORE_EVENTS,
+	.info = on_core_info,
+};
+
 static int impl_connect_fd(struct pw_protocol_client *client, int fd, bool do_close)
 {
 	struct client *impl = SPA_CONTAINER_OF(client, struct client, this);
@@ -737,6 +795,12 @@ static int impl_connect_fd(struct pw_protocol_client *client, int fd, bool do_cl
 
 	impl->disconnecting = false;
 
+	if (impl->oob_size > 0 && !impl->have_core_listener) {
+		pw_core_add_listener(client->core, &impl->core_listener,
+				&client_core_events, impl);
+		impl->have_core_listener = true;
+	}
+
 	pw_protocol_native_connection_set_fd(impl->connection, fd);
 	impl->flushing = true;
 	impl->source = pw_loop_add_io(impl->context->main_loop,
@@ -783,6 +847,9 @@ static void impl_destroy(struct pw_protocol_client *client)
 
 	impl_disconnect(client);
 
+	if (impl->have_core_listener)
+		spa_hook_remove(&impl->core_listener);
+
 	spa_list_remove(&client->link);
 	free(impl);
 }
@@ -874,6 +941,10 @@ impl_new_client(struct pw_protocol *protocol,
 		res = -errno;
 		goto error_free;
 	}
+	/* our properties, with the oob-size, are sent to the server. It only
+	 * sends out of band messages when it also has an oob-size. */
+	impl->oob_size = get_oob_size(&pw_context_get_properties(impl->context)->dict);
+	pw_protocol_native_connection_set_oob_accept(impl->connection, impl->oob_size > 0);
 
 	if (props) {
 		str = spa_dict_lookup(props, PW_KEY_REMOTE_INTENTION);
@@ -984,10 +1055,18 @@ create_server(struct pw_protocol *protocol,
 	struct pw_protocol_server *this;
 	struct pw_context *context = protocol->context;
 	struct server *s;
+	const char *str;
 
 	if ((s = calloc(1, sizeof(struct server))) == NULL)
 		return NULL;
 
+	/* announce in the core info that we accept out of band messages */
+	if ((str = pw_properties_get(pw_context_get_properties(context),
+					PW_KEY_PROTOCOL_OOB_SIZE)) != NULL) {
+		struct spa_dict_item item = SPA_DICT_ITEM_INIT(PW_KEY_PROTOCOL_OOB_SIZE, str);
+		pw_impl_core_update_properties(core, &SPA_DICT_INIT(&item, 1));
+	}
+
 	s->fd_lock = -1;
 
 	this = &s->this;
@@ -0,0 +1,143 @@
+/* PipeWire
+ *
+ * Copyright © 2020 Wim Taymans
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the next
+ * paragraph) shall be included in all copies or substantial portions of the
+ * Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+#include <unistd.h>
+#include <time.h>
+#include <sys/socket.h>
+
+#include <spa/pod/builder.h>
+#include <spa/pod/parser.h>
+#include <spa/utils/result.h>
+
+#include <pipewire/pipewire.h>
+
+#include "connection.h"
+
+#define MAX_BYTES	(256u * 1024u * 1024u)
+#define BATCH_BYTES	(256u * 1024u)
+
+static uint64_t get_time(void)
+{
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return SPA_TIMESPEC_TO_NSEC(&ts);
+}
+
+static void write_message(struct pw_protocol_native_connection *conn,
+		const void *data, uint32_t size)
+{
+	struct spa_pod_builder *b;
+
+	b = pw_protocol_native_connection_begin(conn, 1, 5, NULL);
+	spa_pod_builder_add_struct(b,
+			SPA_POD_Int(42),
+			SPA_POD_Bytes(data, size));
+	pw_protocol_native_connection_end(conn, b);
+}
+
+static uint32_t read_messages(struct pw_protocol_native_connection *conn)
+{
+	const struct pw_protocol_native_message *msg;
+	uint32_t count = 0;
+
+	while (pw_protocol_native_connection_get_next(conn, &msg) == 1)
+		count++;
+	return count;
+}
+
+static void run(struct pw_protocol_native_connection *in,
+		struct pw_protocol_native_connection *out,
+		uint32_t size, size_t oob_size)
+{
+	uint32_t i, n_msgs, batch, sent = 0, received = 0;
+	uint64_t t1, t2;
+	void *data;
+
+	data = calloc(1, size);
+	spa_assert(data != NULL);
+
+	pw_protocol_native_connection_set_oob_size(out, oob_size);
+	pw_protocol_native_connection_set_oob_accept(in, oob_size > 0);
+
+	n_msgs = SPA_MAX(MAX_BYTES / size, 1u);
+	batch = SPA_MAX(BATCH_BYTES / size, 1u);
+
+	t1 = get_time();
+	while (received < n_msgs) {
+		for (i = 0; i < batch && sent < n_msgs; i++, sent++)
+			write_message(out, data, size);
+
+		/* the socket is not big enough for a batch, read in between */
+		while (pw_protocol_native_connection_flush(out) == -EAGAIN)
+			received += read_messages(in);
+		received += read_messages(in);
+	}
+	t2 = get_time();
+
+	fprintf(stderr, "size %u%s: %u messages elapsed %"PRIu64" = %"PRIu64" msgs/sec %f MB/sec\n",
+			size, oob_size ? " oob" : "", n_msgs, t2 - t1,
+			n_msgs * (uint64_t)SPA_NSEC_PER_SEC / (t2 - t1),
+			(double)n_msgs * size * SPA_NSEC_PER_SEC / (t2 - t1) / (1024 * 1024));
+
+	pw_protocol_native_connection_set_oob_size(out, 0);
+	free(data);
+}
+
+int main(int argc, char *argv[])
+{
+	struct pw_main_loop *loop;
+	struct pw_context *context;
+	struct pw_protocol_native_connection *in, *out;
+	int fds[2];
+
+	pw_init(&argc, &argv);
+
+	loop = pw_main_loop_new(NULL);
+	context = pw_context_new(pw_main_loop_get_loop(loop), NULL, 0);
+
+	if (socketpair(AF_UNIX, SOCK_STREAM, 0, fds) < 0) {
+		spa_assert_not_reached();
+		return -1;
+	}
+
+	in = pw_protocol_native_connection_new(context, fds[0]);
+	spa_assert(in != NULL);
+	out = pw_protocol_native_connection_new(context, fds[1]);
+	spa_assert(out != NULL);
+
+	run(in, out, 64, 0);
+	run(in, out, 1024, 0);
+	run(in, out, 16 * 1024, 0);
+	run(in, out, 256 * 1024, 0);
+	run(in, out, 256 * 1024, 64 * 1024);
+	run(in, out, 4 * 1024 * 1024, 0);
+	run(in, out, 4 * 1024 * 1024, 64 * 1024);
+
+	pw_protocol_native_connection_destroy(in);
+	pw_protocol_native_connection_destroy(out);
+	pw_context_destroy(context);
+	pw_main_loop_destroy(loop);
+
+	return 0;
+}
@@ -22,13 +22,20 @@
  * DEALINGS IN THE SOFTWARE.
  */
 
+#include "config.h"
+
 #include <stdint.h>
 #include <stddef.h>
 #include <stdio.h>
 #include <string.h>
 #include <errno.h>
+#include <fcntl.h>
 #include <unistd.h>
+#include <sys/mman.h>
 #include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/syscall.h>
+#include <sys/uio.h>
 
 #include <spa/debug/pod.h>
 #include <spa/utils/result.h>
@@ -38,14 +45,70 @@
 
 #include "connection.h"
 
+#ifndef __FreeBSD__
+#define USE_MEMFD
+#endif
+
+#if defined(USE_MEMFD) && !defined(HAVE_MEMFD_CREATE)
+static inline int memfd_create(const char *name, unsigned int flags)
+{
+	return syscall(SYS_memfd_create, name, flags);
+}
+#endif
+
+#ifndef MFD_CLOEXEC
+#define MFD_CLOEXEC       0x0001U
+#endif
+
+#ifndef MFD_ALLOW_SEALING
+#define MFD_ALLOW_SEALING 0x0002U
+#endif
+
+#ifndef F_LINUX_SPECIFIC_BASE
+#define F_LINUX_SPECIFIC_BASE 1024
+#endif
+
+#ifndef F_ADD_SEALS
+#define F_ADD_SEALS (F_LINUX_SPECIFIC_BASE + 9)
+#define F_GET_SEALS (F_LINUX_SPECIFIC_BASE + 10)
+
+#define F_SEAL_SEAL     0x0001	/* prevent further seals from being set */
+#define F_SEAL_SHRINK   0x0002	/* prevent file from shrinking */
+#define F_SEAL_GROW     0x0004	/* prevent file from growing */
+#define F_SEAL_WRITE    0x0008	/* prevent writes */
+#endif
+
 #define MAX_BUFFER_SIZE (1024 * 32)
 #define MAX_FDS 1024
 #define MAX_FDS_MSG 28
+#define MAX_IOV 64
+#define MAX_FREE_CHUNKS 64
 
 #define HDR_SIZE	16
 
+/* set in the n_fds field of the header when the payload is in a memfd,
+ * passed as the last fd of the message */
+#define HDR_FDS_OOB	(1u << 31)
+#define OOB_SEALS	(F_SEAL_SHRINK | F_SEAL_GROW | F_SEAL_WRITE | F_SEAL_SEAL)
+
 static bool debug_messages = 0;
 
+/** a piece of the output stream */
+struct chunk {
+	struct spa_list link;
+	size_t offset;		/**< bytes sent */
+	size_t size;		/**< bytes of complete messages */
+	size_t maxsize;
+	uint8_t data[0];
+};
+
+/** position in the output stream from where all fds of a message
+ * need to be sent */
+struct fd_mark {
+	uint64_t pos;
+	uint64_t fds;
+};
+
 struct buffer {
 	uint8_t *buffer_data;
 	size_t buffer_size;
@@ -71,6 +134,31 @@ struct impl {
 
 	uint32_t version;
 	size_t hdr_size;
+
+	struct spa_list chunks;		/**< queued output */
+	struct spa_list free_chunks;
+	uint32_t n_free_chunks;
+	uint64_t write_pos;		/**< bytes queued in total */
+	uint64_t read_pos;		/**< bytes sent in total */
+	uint64_t fds_sent;		/**< fds sent in total */
+	struct fd_mark marks[MAX_FDS];
+	uint32_t marks_head;
+	uint32_t marks_tail;
+
+	size_t oob_size;		/**< min payload size to send in a memfd */
+	bool oob_accept;		/**< accept payloads in a memfd */
+	struct {
+		int fd;
+		void *data;
+		size_t maxsize;
+	} oob_out;			/**< memfd of the message being built */
+	int oob_fds[MAX_FDS];		/**< memfds to close when sent */
+	uint32_t n_oob_fds;
+	struct {
+		int fd;
+		void *data;
+		size_t size;
+	} oob_in;			/**< memfd of the last received message */
 };
 
 /** \endcond */
@@ -154,6 +242,157 @@ static void *connection_ensure_size(struct pw_protocol_native_connection *conn,
 	return (uint8_t *) buf->buffer_data + buf->buffer_size;
 }
 
+static struct chunk *chunk_new(struct impl *impl, size_t size)
+{
+	struct chunk *c;
+
+	if (size <= MAX_BUFFER_SIZE && !spa_list_is_empty(&impl->free_chunks)) {
+		c = spa_list_first(&impl->free_chunks, struct chunk, link);
+		spa_list_remove(&c->link);
+		impl->n_free_chunks--;
+	} else {
+		size = SPA_ROUND_UP_N(size, MAX_BUFFER_SIZE);
+		if ((c = malloc(sizeof(struct chunk) + size)) == NULL)
+			return NULL;
+		c->maxsize = size;
+	}
+	c->offset = 0;
+	c->size = 0;
+	return c;
+}
+
+static void chunk_free(struct impl *impl, struct chunk *c)
+{
+	if (c->maxsize == MAX_BUFFER_SIZE && impl->n_free_chunks < MAX_FREE_CHUNKS) {
+		spa_list_append(&impl->free_chunks, &c->link);
+		impl->n_free_chunks++;
+	} else {
+		free(c);
+	}
+}
+
+/* bytes of the message that is being built, after the queued messages */
+static size_t out_pending(struct impl *impl)
+{
+	struct spa_pod_builder *b = &impl->builder;
+	if (b->data == NULL || impl->oob_out.fd != -1)
+		return 0;
+	return impl->hdr_size + SPA_MIN(b->state.offset, b->size);
+}
+
+static void *out_add_chunk(struct impl *impl, struct chunk *c, size_t size)
+{
+	struct pw_protocol_native_connection *conn = &impl->this;
+	struct chunk *nc;
+	int res;
+
+	if ((nc = chunk_new(impl, size)) == NULL) {
+		res = -errno;
+		spa_hook_list_call(&conn->listener_list,
+				struct pw_protocol_native_connection_events,
+				error, 0, -res);
+		errno = -res;
+		return NULL;
+	}
+	if (c != NULL) {
+		memcpy(nc->data, c->data + c->size, out_pending(impl));
+		if (c->offset == c->size) {
+			spa_list_remove(&c->link);
+			chunk_free(impl, c);
+		}
+	}
+	spa_list_append(&impl->chunks, &nc->link);
+
+	if (size > MAX_BUFFER_SIZE)
+		pw_log_debug("connection %p: large chunk of %zd bytes", conn, nc->maxsize);
+
+	return nc->data;
+}
+
+/* Make room for size bytes after the queued messages. Complete messages
+ * are never moved, only the partial message is copied to a new chunk when
+ * it does not fit in the last one. */
+static inline void *out_ensure_size(struct impl *impl, size_t size)
+{
+	struct chunk *c = NULL;
+
+	if (SPA_LIKELY(!spa_list_is_empty(&impl->chunks))) {
+		c = spa_list_last(&impl->chunks, struct chunk, link);
+		if (SPA_LIKELY(c->size + size <= c->maxsize))
+			return c->data + c->size;
+	}
+	return out_add_chunk(impl, c, size);
+}
+
+static void release_oob_in(struct impl *impl)
+{
+	if (impl->oob_in.data != NULL)
+		munmap(impl->oob_in.data, impl->oob_in.size);
+	if (impl->oob_in.fd != -1)
+		close(impl->oob_in.fd);
+	impl->oob_in.fd = -1;
+	impl->oob_in.data = NULL;
+	impl->oob_in.size = 0;
+}
+
+static void release_oob_out(struct impl *impl)
+{
+	if (impl->oob_out.data != NULL)
+		munmap(impl->oob_out.data, impl->oob_out.maxsize);
+	if (impl->oob_out.fd != -1)
+		close(impl->oob_out.fd);
+	impl->oob_out.fd = -1;
+	impl->oob_out.data = NULL;
+	impl->oob_out.maxsize = 0;
+}
+
+/* close the memfds that have been sent, they are in the order of the fds */
+static void release_oob_fds(struct impl *impl, uint32_t n_fds)
+{
+	struct buffer *buf = &impl->out;
+	uint32_t i, j, n_sent = 0;
+
+	for (i = 0; i < impl->n_oob_fds; i++) {
+		for (j = 0; j < n_fds; j++)
+			if (buf->fds[j] == impl->oob_fds[i])
+				break;
+		if (j < n_fds)
+			break;
+		close(impl->oob_fds[i]);
+		n_sent++;
+	}
+	if (n_sent == 0)
+		return;
+	impl->n_oob_fds -= n_sent;
+	memmove(impl->oob_fds, &impl->oob_fds[n_sent], impl->n_oob_fds * sizeof(int));
+}
+
+static int map_oob_in(struct impl *impl, int fd, size_t size)
+{
+	struct stat st;
+	void *data;
+	int seals;
+
+	/* the sender can't change the payload while we parse it */
+	if ((seals = fcntl(fd, F_GET_SEALS)) < 0)
+		return -errno;
+	if ((seals & (F_SEAL_SHRINK | F_SEAL_WRITE)) != (F_SEAL_SHRINK | F_SEAL_WRITE))
+		return -EPERM;
+	if (fstat(fd, &st) < 0)
+		return -errno;
+	if ((size_t)st.st_size < size)
+		return -EINVAL;
+
+	data = mmap(NULL, size, PROT_READ, MAP_PRIVATE, fd, 0);
+	if (data == MAP_FAILED)
+		return -errno;
+
+	impl->oob_in.fd = fd;
+	impl->oob_in.data = data;
+	impl->oob_in.size = size;
+	return 0;
+}
+
 static int refill_buffer(struct pw_protocol_native_connection *conn, struct buffer *buf)
 {
 	ssize_t len;
@@ -248,25 +487,73 @@ struct pw_protocol_native_connection *pw_protocol_native_connection_new(struct p
 	impl->hdr_size = HDR_SIZE;
 	impl->version = 3;
 
-	impl->out.buffer_data = calloc(1, MAX_BUFFER_SIZE);
-	impl->out.buffer_maxsize = MAX_BUFFER_SIZE;
+	spa_list_init(&impl->chunks);
+	spa_list_init(&impl->free_chunks);
+	impl->oob_out.fd = -1;
+	impl->oob_in.fd = -1;
+
 	impl->in.buffer_data = calloc(1, MAX_BUFFER_SIZE);
 	impl->in.buffer_maxsize = MAX_BUFFER_SIZE;
 	impl->in.update = true;
 	impl->in.first = true;
 
-	if (impl->out.buffer_data == NULL || impl->in.buffer_data == NULL)
+	if (impl->in.buffer_data == NULL)
 		goto no_mem;
 
 	return this;
 
 no_mem:
-	free(impl->out.buffer_data);
-	free(impl->in.buffer_data);
 	free(impl);
 	return NULL;
 }
 
+/** Send large messages out of band
+ *
+ * \param conn the connection
+ * \param size the minimum payload size to send out of band, 0 disables
+ * \return 0 on success
+ *
+ * Messages with a payload larger than \a size are built in a sealed memfd
+ * that is passed to the peer instead of being copied through the socket.
+ * Only enable this when the peer knows how to receive these messages.
+ *
+ * \memberof pw_protocol_native_connection
+ */
+int pw_protocol_native_connection_set_oob_size(struct pw_protocol_native_connection *conn,
+		size_t size)
+{
+	struct impl *impl = SPA_CONTAINER_OF(conn, struct impl, this);
+#ifdef USE_MEMFD
+	impl->oob_size = size;
+	return 0;
+#else
+	return size == 0 ? 0 : -ENOTSUP;
+#endif
+}
+
+/** Receive large messages out of band
+ *
+ * \param conn the connection
+ * \param accept if messages with the payload in a memfd are accepted
+ * \return 0 on success
+ *
+ * Out of band messages are rejected with -EPROTO unless this is enabled.
+ * Only enable this for peers that announced that they send these messages.
+ *
+ * \memberof pw_protocol_native_connection
+ */
+int pw_protocol_native_connection_set_oob_accept(struct pw_protocol_native_connection *conn,
+		bool accept)
+{
+	struct impl *impl = SPA_CONTAINER_OF(conn, struct impl, this);
+#ifdef USE_MEMFD
+	impl->oob_accept = accept;
+	return 0;
+#else
+	return accept ? -ENOTSUP : 0;
+#endif
+}
+
 int pw_protocol_native_connection_set_fd(struct pw_protocol_native_connection *conn, int fd)
 {
 	conn->fd = fd;
@@ -282,12 +569,17 @@ int pw_protocol_native_connection_set_fd(struct pw_protocol_native_connection *c
 void pw_protocol_native_connection_destroy(struct pw_protocol_native_connection *conn)
 {
 	struct impl *impl = SPA_CONTAINER_OF(conn, struct impl, this);
+	struct chunk *c;
 
 	pw_log_debug("connection %p: destroy", conn);
 
 	spa_hook_list_call(&conn->listener_list, struct pw_protocol_native_connection_events, destroy, 0);
 
-	free(impl->out.buffer_data);
+	pw_protocol_native_connection_clear(conn);
+	spa_list_consume(c, &impl->free_chunks, link) {
+		spa_list_remove(&c->link);
+		free(c);
+	}
 	free(impl->in.buffer_data);
 	free(impl);
 }
@@ -298,6 +590,8 @@ static int prepare_packet(struct pw_protocol_native_connection *conn, struct buf
 	uint8_t *data;
 	size_t size, len;
 	uint32_t *p;
+	bool oob = false;
+	int res;
 
 	data = buf->buffer_data + buf->offset;
 	size = buf->buffer_size - buf->offset;
@@ -328,7 +622,8 @@ static int prepare_packet(struct pw_protocol_native_connection *conn, struct buf
 
 	if (impl->version >= 3) {
 		buf->msg.seq = p[2];
-		buf->msg.n_fds = p[3];
+		buf->msg.n_fds = p[3] & ~HDR_FDS_OOB;
+		oob = SPA_FLAG_IS_SET(p[3], HDR_FDS_OOB);
 	} else {
 		buf->msg.seq = 0;
 		buf->msg.n_fds = 0;
@@ -346,6 +641,26 @@ static int prepare_packet(struct pw_protocol_native_connection *conn, struct buf
 	buf->offset += impl->hdr_size + len;
 	buf->fds_offset += buf->msg.n_fds;
 
+	if (SPA_UNLIKELY(oob)) {
+		if (!impl->oob_accept) {
+			pw_log_error("connection %p: unexpected out of band message", conn);
+			if (buf->msg.n_fds > 0)
+				close(buf->msg.fds[buf->msg.n_fds - 1]);
+			return -EPROTO;
+		}
+		/* the payload size is inline, the payload in the last fd */
+		if (len < sizeof(uint32_t) || buf->msg.n_fds == 0)
+			return -EPROTO;
+		buf->msg.n_fds--;
+		if ((res = map_oob_in(impl, buf->msg.fds[buf->msg.n_fds], *(uint32_t*)data)) < 0) {
+			pw_log_error("connection %p: can't map payload: %s", conn, spa_strerror(res));
+			close(buf->msg.fds[buf->msg.n_fds]);
+			return res;
+		}
+		buf->msg.data = impl->oob_in.data;
+		buf->msg.size = impl->oob_in.size;
+	}
+
 	if (buf->offset >= buf->buffer_size)
 		clear_buffer(buf);
 
@@ -376,6 +691,9 @@ pw_protocol_native_connection_get_next(struct pw_protocol_native_connection *con
 
 	buf = &impl->in;
 
+	if (SPA_UNLIKELY(impl->oob_in.fd != -1))
+		release_oob_in(impl);
+
 	while (1) {
 		len = prepare_packet(conn, buf);
 		if (len < 0)
@@ -396,22 +714,98 @@ static inline void *begin_write(struct pw_protocol_native_connection *conn, uint
 {
 	struct impl *impl = SPA_CONTAINER_OF(conn, struct impl, this);
 	uint32_t *p;
-	struct buffer *buf = &impl->out;
 	/* header and size for payload */
-	if ((p = connection_ensure_size(conn, buf, impl->hdr_size + size)) == NULL)
+	if ((p = out_ensure_size(impl, impl->hdr_size + size)) == NULL)
 		return NULL;
 
 	return SPA_MEMBER(p, impl->hdr_size, void);
 }
 
+static void *begin_write_oob(struct impl *impl, uint32_t size)
+{
+	struct spa_pod_builder *b = &impl->builder;
+	void *data;
+	int res;
+
+	if (impl->oob_out.fd == -1) {
+#ifdef USE_MEMFD
+		impl->oob_out.fd = memfd_create("pipewire-message", MFD_CLOEXEC | MFD_ALLOW_SEALING);
+#else
+		errno = ENOTSUP;
+#endif
+		if (impl->oob_out.fd < 0)
+			goto error;
+	}
+	if (ftruncate(impl->oob_out.fd, size) < 0)
+		goto error;
+
+	data = mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_SHARED, impl->oob_out.fd, 0);
+	if (data == MAP_FAILED)
+		goto error;
+
+	if (impl->oob_out.data != NULL)
+		munmap(impl->oob_out.data, impl->oob_out.maxsize);
+	else if (b->data != NULL)
+		memcpy(data, b->data, SPA_MIN(b->state.offset, b->size));
+
+	impl->oob_out.data = data;
+	impl->oob_out.maxsize = size;
+	return data;
+
+error:
+	res = -errno;
+	pw_log_error("connection %p: can't make memfd: %m", impl);
+	release_oob_out(impl);
+	errno = -res;
+	return NULL;
+}
+
+static int end_write_oob(struct impl *impl, uint32_t size)
+{
+	int res, fd = impl->oob_out.fd;
+
+	munmap(impl->oob_out.data, impl->oob_out.maxsize);
+	impl->oob_out.data = NULL;
+	impl->oob_out.fd = -1;
+	/* the payload is in the memfd, nothing is pending in the chunks */
+	impl->builder.data = NULL;
+	impl->builder.size = 0;
+
+	if (ftruncate(fd, size) < 0 ||
+	    fcntl(fd, F_ADD_SEALS, OOB_SEALS) < 0) {
+		res = -errno;
+		goto error;
+	}
+	if (pw_protocol_native_connection_add_fd(&impl->this, fd) == SPA_IDX_INVALID) {
+		res = -ENOSPC;
+		goto error;
+	}
+	impl->oob_fds[impl->n_oob_fds++] = fd;
+	return 0;
+
+error:
+	close(fd);
+	return res;
+}
+
 static int builder_overflow(void *data, uint32_t size)
 {
 	struct impl *impl = data;
 	struct spa_pod_builder *b = &impl->builder;
+	uint32_t new_size = SPA_ROUND_UP_N(size, 4096);
+	void *d;
+
+	if (SPA_UNLIKELY(impl->oob_out.fd != -1 ||
+	    (impl->oob_size > 0 && size > impl->oob_size && impl->version >= 3)))
+		d = begin_write_oob(impl, new_size);
+	else
+		d = begin_write(&impl->this, new_size);
 
-	b->size = SPA_ROUND_UP_N(size, 4096);
-	if ((b->data = begin_write(&impl->this, b->size)) == NULL)
+	if (d == NULL)
 		return -errno;
+
+	b->data = d;
+	b->size = new_size;
         return 0;
 }
 
@@ -428,6 +822,10 @@ pw_protocol_native_connection_begin(struct pw_protocol_native_connection *conn,
 	struct impl *impl = SPA_CONTAINER_OF(conn, struct impl, this);
 	struct buffer *buf = &impl->out;
 
+	/* a previous message was not ended */
+	if (SPA_UNLIKELY(impl->oob_out.fd != -1))
+		release_oob_out(impl);
+
 	buf->msg.id = id;
 	buf->msg.opcode = opcode;
 	impl->builder = SPA_POD_BUILDER_INIT(NULL, 0);
@@ -451,31 +849,54 @@ pw_protocol_native_connection_end(struct pw_protocol_native_connection *conn,
 				  struct spa_pod_builder *builder)
 {
 	struct impl *impl = SPA_CONTAINER_OF(conn, struct impl, this);
-	uint32_t *p, size = builder->state.offset;
+	uint32_t *p, size = builder->state.offset, psize = size;
 	struct buffer *buf = &impl->out;
+	struct chunk *c;
+	bool oob = impl->oob_out.fd != -1;
 	int res;
 
-	if ((p = connection_ensure_size(conn, buf, impl->hdr_size + size)) == NULL)
+	if (debug_messages) {
+		fprintf(stderr, ">>>>>>>>> out: id:%d op:%d size:%d seq:%d%s\n",
+				buf->msg.id, buf->msg.opcode, size, buf->msg.seq,
+				oob ? " oob" : "");
+		if (builder->data)
+		        spa_debug_pod(0, NULL, builder->data);
+	}
+
+	if (SPA_UNLIKELY(oob)) {
+		if ((res = end_write_oob(impl, size)) < 0)
+			return res;
+		psize = 2 * sizeof(uint32_t);
+	}
+
+	if ((p = out_ensure_size(impl, impl->hdr_size + psize)) == NULL)
 		return -errno;
 
 	p[0] = buf->msg.id;
-	p[1] = (buf->msg.opcode << 24) | (size & 0xffffff);
+	p[1] = (buf->msg.opcode << 24) | (psize & 0xffffff);
 	if (impl->version >= 3) {
 		p[2] = buf->msg.seq;
-		p[3] = buf->msg.n_fds;
+		p[3] = buf->msg.n_fds | (oob ? HDR_FDS_OOB : 0);
 	}
+	if (oob) {
+		p[impl->hdr_size / 4] = size;
+		p[impl->hdr_size / 4 + 1] = 0;
+	}
+
+	c = spa_list_last(&impl->chunks, struct chunk, link);
+	c->size += impl->hdr_size + psize;
 
-	buf->buffer_size += impl->hdr_size + size;
-	if (impl->version >= 3)
+	if (impl->version >= 3) {
 		buf->n_fds += buf->msg.n_fds;
-	else
+		if (buf->msg.n_fds > 0) {
+			struct fd_mark *m = &impl->marks[impl->marks_tail++ & (MAX_FDS - 1)];
+			m->pos = impl->write_pos;
+			m->fds = impl->fds_sent + buf->n_fds;
+		}
+	} else {
 		buf->n_fds = buf->msg.n_fds;
-
-	if (debug_messages) {
-		fprintf(stderr, ">>>>>>>>> out: id:%d op:%d size:%d seq:%d\n",
-				buf->msg.id, buf->msg.opcode, size, buf->msg.seq);
-	        spa_debug_pod(0, NULL, SPA_MEMBER(p, impl->hdr_size, struct spa_pod));
 	}
+	impl->write_pos += impl->hdr_size + psize;
 
 	buf->seq = (buf->seq + 1) & SPA_ASYNC_SEQ_MASK;
 	res = SPA_RESULT_RETURN_ASYNC(buf->msg.seq);
@@ -486,6 +907,23 @@ pw_protocol_native_connection_end(struct pw_protocol_native_connection *conn,
 	return res;
 }
 
+/* Find how much can be sent along with the fds up to n_fds. A message can
+ * only be sent completely when all of its fds have been sent. */
+static uint64_t get_send_limit(struct impl *impl, uint64_t n_fds)
+{
+	uint64_t limit = impl->read_pos + SPA_MIN(impl->write_pos - impl->read_pos, sizeof(uint32_t));
+
+	if (impl->version >= 3) {
+		uint32_t i;
+		for (i = impl->marks_head; i != impl->marks_tail; i++) {
+			struct fd_mark *m = &impl->marks[i & (MAX_FDS - 1)];
+			if (m->fds > n_fds)
+				return SPA_MAX(m->pos, limit);
+		}
+	}
+	return limit;
+}
+
 /** Flush the connection object
  *
  * \param conn the connection object
@@ -498,39 +936,47 @@ pw_protocol_native_connection_end(struct pw_protocol_native_connection *conn,
 int pw_protocol_native_connection_flush(struct pw_protocol_native_connection *conn)
 {
 	struct impl *impl = SPA_CONTAINER_OF(conn, struct impl, this);
-	ssize_t sent, outsize;
+	ssize_t sent;
 	struct msghdr msg = { 0 };
-	struct iovec iov[1];
+	struct iovec iov[MAX_IOV];
 	struct cmsghdr *cmsg;
 	char cmsgbuf[CMSG_SPACE(MAX_FDS_MSG * sizeof(int))];
 	int res = 0, *fds;
-	uint32_t fds_len, n_fds, outfds;
+	uint32_t fds_len, n_fds, outfds, n_iov;
 	struct buffer *buf;
-	void *data;
-	size_t size;
+	struct chunk *c, *t;
+	uint64_t pos, limit;
 
 	buf = &impl->out;
-	data = buf->buffer_data;
-	size = buf->buffer_size;
 	fds = buf->fds;
 	n_fds = buf->n_fds;
 
-	while (size > 0) {
+	while (impl->read_pos < impl->write_pos) {
 		if (n_fds > MAX_FDS_MSG) {
 			outfds = MAX_FDS_MSG;
-			outsize = SPA_MIN(sizeof(uint32_t), size);
+			limit = get_send_limit(impl, impl->fds_sent + outfds);
 		} else {
 			outfds = n_fds;
-			outsize = size;
+			limit = impl->write_pos;
 		}
 
-		fds_len = outfds * sizeof(int);
-
-		iov[0].iov_base = data;
-		iov[0].iov_len = outsize;
+		/* gather the queued chunks */
+		n_iov = 0;
+		pos = impl->read_pos;
+		spa_list_for_each(c, &impl->chunks, link) {
+			size_t len = SPA_MIN(c->size - c->offset, limit - pos);
+			if (len == 0)
+				continue;
+			iov[n_iov].iov_base = c->data + c->offset;
+			iov[n_iov].iov_len = len;
+			pos += len;
+			if (++n_iov == MAX_IOV || pos == limit)
+				break;
+		}
 		msg.msg_iov = iov;
-		msg.msg_iovlen = 1;
+		msg.msg_iovlen = n_iov;
 
+		fds_len = outfds * sizeof(int);
 		if (outfds > 0) {
 			msg.msg_control = cmsgbuf;
 			msg.msg_controllen = CMSG_SPACE(fds_len);
@@ -557,24 +1003,37 @@ int pw_protocol_native_connection_flush(struct pw_protocol_native_connection *co
 			}
 			break;
 		}
-		pw_log_trace("connection %p: %d written %zd bytes and %u fds", conn, conn->fd, sent,
-			     outfds);
+		pw_log_trace("connection %p: %d written %zd bytes in %u chunks and %u fds",
+				conn, conn->fd, sent, n_iov, outfds);
 
-		size -= sent;
-		data = SPA_MEMBER(data, sent, void);
+		impl->read_pos += sent;
+		impl->fds_sent += outfds;
 		n_fds -= outfds;
 		fds += outfds;
+
+		while (impl->marks_head != impl->marks_tail &&
+		    impl->marks[impl->marks_head & (MAX_FDS - 1)].fds <= impl->fds_sent)
+			impl->marks_head++;
+
+		/* recycle the chunks that were sent */
+		spa_list_for_each_safe(c, t, &impl->chunks, link) {
+			size_t len = SPA_MIN(c->size - c->offset, (size_t)sent);
+			c->offset += len;
+			sent -= len;
+			if (c->offset < c->size)
+				break;
+			spa_list_remove(&c->link);
+			chunk_free(impl, c);
+		}
 	}
 
 	res = 0;
 
 exit:
-	if (size > 0)
-		memmove(buf->buffer_data, data, size);
-	buf->buffer_size = size;
 	if (n_fds > 0)
 		memmove(buf->fds, fds, n_fds * sizeof(int));
 	buf->n_fds = n_fds;
+	release_oob_fds(impl, n_fds);
 	return res;
 }
 
@@ -590,10 +1049,23 @@ exit:
 int pw_protocol_native_connection_clear(struct pw_protocol_native_connection *conn)
 {
 	struct impl *impl = SPA_CONTAINER_OF(conn, struct impl, this);
+	struct chunk *c;
+
+	spa_list_consume(c, &impl->chunks, link) {
+		spa_list_remove(&c->link);
+		chunk_free(impl, c);
+	}
+	impl->write_pos = impl->read_pos = 0;
+	impl->fds_sent = 0;
+	impl->marks_head = impl->marks_tail = 0;
 
 	clear_buffer(&impl->out);
+	release_oob_fds(impl, 0);
+	release_oob_out(impl);
+
 	clear_buffer(&impl->in);
 	impl->in.update = true;
+	release_oob_in(impl);
 
 	return 0;
 }
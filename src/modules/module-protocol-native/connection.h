@@ -99,6 +99,14 @@ pw_protocol_native_connection_flush(struct pw_protocol_native_connection *conn);
 int
 pw_protocol_native_connection_clear(struct pw_protocol_native_connection *conn);
 
+int
+pw_protocol_native_connection_set_oob_size(struct pw_protocol_native_connection *conn,
+		size_t size);
+
+int
+pw_protocol_native_connection_set_oob_accept(struct pw_protocol_native_connection *conn,
+		bool accept);
+
 #ifdef __cplusplus
 }  /* extern "C" */
 #endif
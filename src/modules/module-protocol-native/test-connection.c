@@ -22,6 +22,7 @@
  * DEALINGS IN THE SOFTWARE.
  */
 
+#include <unistd.h>
 #include <sys/socket.h>
 
 #include <spa/pod/builder.h>
@@ -120,6 +121,167 @@ static void test_read_write(struct pw_protocol_native_connection *in,
 	spa_assert(read_message(in) == -1);
 }
 
+static void write_large_message(struct pw_protocol_native_connection *conn,
+		const void *data, uint32_t size)
+{
+	struct spa_pod_builder *b;
+
+	b = pw_protocol_native_connection_begin(conn, 2, 6, NULL);
+	spa_assert(b != NULL);
+	spa_pod_builder_add_struct(b,
+			SPA_POD_Int(size),
+			SPA_POD_Bytes(data, size));
+	spa_assert(pw_protocol_native_connection_end(conn, b) >= 0);
+}
+
+static void read_large_message(struct pw_protocol_native_connection *conn,
+		const void *data, uint32_t size)
+{
+        struct spa_pod_parser prs;
+	const struct pw_protocol_native_message *msg;
+	const void *bytes;
+	uint32_t len, v_int;
+
+	spa_assert(pw_protocol_native_connection_get_next(conn, &msg) == 1);
+	spa_assert(msg->opcode == 6);
+	spa_assert(msg->id == 2);
+	spa_assert(msg->n_fds == 0);
+
+	spa_pod_parser_init(&prs, msg->data, msg->size);
+	if (spa_pod_parser_get_struct(&prs,
+                        SPA_POD_Int(&v_int),
+                        SPA_POD_Bytes(&bytes, &len)) < 0)
+                spa_assert_not_reached();
+	spa_assert(v_int == size);
+	spa_assert(len == size);
+	spa_assert(memcmp(bytes, data, size) == 0);
+}
+
+static void test_large(struct pw_protocol_native_connection *in,
+		struct pw_protocol_native_connection *out)
+{
+	uint8_t *data;
+	uint32_t i, size = 100000;
+
+	data = malloc(size);
+	spa_assert(data != NULL);
+	for (i = 0; i < size; i++)
+		data[i] = i * 7;
+
+	/* messages spanning more than one chunk */
+	write_message(out, 1);
+	write_large_message(out, data, size);
+	write_message(out, 2);
+	spa_assert(pw_protocol_native_connection_flush(out) == 0);
+	spa_assert(read_message(in) == 0);
+	read_large_message(in, data, size);
+	spa_assert(read_message(in) == 0);
+	spa_assert(read_message(in) == -1);
+
+	/* payload passed in a memfd */
+	spa_assert(pw_protocol_native_connection_set_oob_size(out, 4096) == 0);
+	spa_assert(pw_protocol_native_connection_set_oob_accept(in, true) == 0);
+	write_message(out, 1);
+	write_large_message(out, data, size);
+	write_message(out, 2);
+	spa_assert(pw_protocol_native_connection_flush(out) == 0);
+	spa_assert(read_message(in) == 0);
+	read_large_message(in, data, size);
+	spa_assert(read_message(in) == 0);
+	spa_assert(read_message(in) == -1);
+	spa_assert(pw_protocol_native_connection_set_oob_size(out, 0) == 0);
+	spa_assert(pw_protocol_native_connection_set_oob_accept(in, false) == 0);
+
+	free(data);
+}
+
+static void test_oob_reject(struct pw_protocol_native_connection *in,
+		struct pw_protocol_native_connection *out)
+{
+	const struct pw_protocol_native_message *msg;
+	uint32_t size = 64 * 1024;
+	uint8_t *data;
+
+	data = calloc(1, size);
+	spa_assert(data != NULL);
+
+	/* the receiver did not enable out of band messages */
+	spa_assert(pw_protocol_native_connection_set_oob_size(out, 4096) == 0);
+	write_large_message(out, data, size);
+	spa_assert(pw_protocol_native_connection_flush(out) == 0);
+	spa_assert(pw_protocol_native_connection_get_next(in, &msg) == -EPROTO);
+	spa_assert(pw_protocol_native_connection_set_oob_size(out, 0) == 0);
+
+	free(data);
+}
+
+static void test_oob_full_chunk(struct pw_protocol_native_connection *in,
+		struct pw_protocol_native_connection *out)
+{
+	const struct pw_protocol_native_message *msg;
+	struct spa_pod_builder *b;
+	struct spa_pod_parser prs;
+	struct spa_pod *pod;
+	const void *bytes;
+	uint32_t len, size = 64 * 1024;
+	uint8_t *data;
+
+	pod = calloc(1, sizeof(struct spa_pod) + size);
+	spa_assert(pod != NULL);
+	*pod = SPA_POD_INIT(size, SPA_TYPE_Bytes);
+	data = SPA_POD_BODY(pod);
+
+	/* fill a new chunk of 32768 bytes up to 32752 bytes, which leaves
+	 * less room than the header and body of an out of band message */
+	write_large_message(out, data, 4016);
+	write_large_message(out, data, 28640);
+
+	/* the pod is added with one write that goes to the memfd right away */
+	spa_assert(pw_protocol_native_connection_set_oob_size(out, 4096) == 0);
+	spa_assert(pw_protocol_native_connection_set_oob_accept(in, true) == 0);
+	b = pw_protocol_native_connection_begin(out, 2, 7, NULL);
+	spa_assert(b != NULL);
+	spa_assert(spa_pod_builder_primitive(b, pod) == 0);
+	spa_assert(pw_protocol_native_connection_end(out, b) >= 0);
+	spa_assert(pw_protocol_native_connection_flush(out) == 0);
+
+	read_large_message(in, data, 4016);
+	read_large_message(in, data, 28640);
+	spa_assert(pw_protocol_native_connection_get_next(in, &msg) == 1);
+	spa_assert(msg->opcode == 7);
+	spa_pod_parser_init(&prs, msg->data, msg->size);
+	spa_assert(spa_pod_parser_get_bytes(&prs, &bytes, &len) == 0);
+	spa_assert(len == size);
+	spa_assert(memcmp(bytes, data, size) == 0);
+	spa_assert(read_message(in) == -1);
+
+	spa_assert(pw_protocol_native_connection_set_oob_size(out, 0) == 0);
+	spa_assert(pw_protocol_native_connection_set_oob_accept(in, false) == 0);
+
+	free(pod);
+}
+
+static void test_many_fds(struct pw_protocol_native_connection *in,
+		struct pw_protocol_native_connection *out)
+{
+	int i, fds[100];
+
+	/* more fds than can be sent in one message */
+	for (i = 0; i < 100; i++) {
+		fds[i] = dup(1);
+		spa_assert(fds[i] >= 0);
+		write_message(out, fds[i]);
+	}
+	spa_assert(pw_protocol_native_connection_flush(out) == 0);
+
+	for (i = 0; i < 100; i++)
+		spa_assert(read_message(in) == 0);
+	spa_assert(read_message(in) == -1);
+
+	for (i = 0; i < 100; i++)
+		close(fds[i]);
+}
+
 int main(int argc, char *argv[])
 {
 	struct pw_main_loop *loop;
@@ -145,6 +307,10 @@ int main(int argc, char *argv[])
 	test_create(in);
 	test_create(out);
 	test_read_write(in, out);
+	test_large(in, out);
+	test_oob_full_chunk(in, out);
+	test_many_fds(in, out);
+	test_oob_reject(in, out);
 
 	return 0;
 }
@@ -25,6 +25,7 @@
 #include <spa/node/utils.h>
 #include <spa/pod/parser.h>
 #include <spa/param/param.h>
+#include <spa/param/buffers-utils.h>
 #include <spa/buffer/alloc.h>
 
 #include <spa/debug/node.h>
@@ -40,6 +41,7 @@
 
 #define MAX_ALIGN	32
 #define MAX_BUFFERS	64
+#define MAX_BLOCKS	64u
 
 struct port {
 	struct spa_node *node;
@@ -125,7 +127,8 @@ static int alloc_buffers(struct pw_mempool *pool,
 		m = pw_mempool_alloc(pool,
 				PW_MEMBLOCK_FLAG_READWRITE |
 				PW_MEMBLOCK_FLAG_SEAL |
-				PW_MEMBLOCK_FLAG_MAP,
+				PW_MEMBLOCK_FLAG_MAP |
+				PW_MEMBLOCK_FLAG_ARENA,
 				SPA_DATA_MemFd,
 				n_buffers * info.mem_size);
 		if (m == NULL)
@@ -137,9 +140,18 @@ static int alloc_buffers(struct pw_mempool *pool,
 		data = NULL;
 	}
 
-	pw_log_debug(NAME" %p: layout buffers skel:%p data:%p", allocation, skel, data);
+	pw_log_debug(NAME" %p: layout buffers skel:%p data:%p n_datas:%d",
+			allocation, skel, data, n_datas);
 	spa_buffer_alloc_layout_array(&info, n_buffers, buffers, skel, data);
 
+	for (i = 0; i < n_buffers; i++) {
+		struct spa_buffer *b = buffers[i];
+		uint32_t j;
+
+		for (j = 0; j < b->n_datas; j++)
+			b->datas[j].chunk->stride = data_strides[j];
+	}
+
 	allocation->mem = m;
 	allocation->n_buffers = n_buffers;
 	allocation->buffers = buffers;
@@ -218,11 +230,11 @@ int pw_buffers_negotiate(struct pw_context *context, uint32_t flags,
 	uint8_t buffer[4096];
 	struct spa_pod_builder b = SPA_POD_BUILDER_INIT(buffer, sizeof(buffer));
 	uint32_t i, offset, n_params;
-	uint32_t max_buffers;
+	uint32_t max_buffers, blocks;
 	size_t minsize, stride, align;
-	uint32_t data_sizes[1];
-	int32_t data_strides[1];
-	uint32_t data_aligns[1];
+	uint32_t *data_sizes;
+	int32_t *data_strides;
+	uint32_t *data_aligns;
 	struct port output = { outnode, SPA_DIRECTION_OUTPUT, out_port_id };
 	struct port input = { innode, SPA_DIRECTION_INPUT, in_port_id };
 	const char *str;
@@ -252,28 +264,34 @@ int pw_buffers_negotiate(struct pw_context *context, uint32_t flags,
 		align = MAX_ALIGN;
 
 	minsize = stride = 0;
+	blocks = 1;
 	param = find_param(params, n_params, SPA_TYPE_OBJECT_ParamBuffers);
 	if (param) {
-		uint32_t qmax_buffers = max_buffers,
-		    qminsize = minsize, qstride = stride, qalign = align;
-
-		spa_pod_parse_object(param,
-			SPA_TYPE_OBJECT_ParamBuffers, NULL,
-			SPA_PARAM_BUFFERS_buffers, SPA_POD_Int(&qmax_buffers),
-			SPA_PARAM_BUFFERS_size,    SPA_POD_Int(&qminsize),
-			SPA_PARAM_BUFFERS_stride,  SPA_POD_Int(&qstride),
-			SPA_PARAM_BUFFERS_align,   SPA_POD_Int(&qalign));
+		struct spa_buffers_info q = {
+			.buffers = max_buffers,
+			.blocks = blocks,
+			.size = minsize,
+			.stride = stride,
+			.align = align,
+		};
+
+		if ((res = spa_buffers_parse(param, &q)) < 0) {
+			pw_log_error(NAME" %p: invalid buffers param: %s", result,
+					spa_strerror(res));
+			return res;
+		}
 
 		max_buffers =
-		    qmax_buffers == 0 ? max_buffers : SPA_MIN(qmax_buffers,
+		    q.buffers == 0 ? max_buffers : SPA_MIN(q.buffers,
 						      max_buffers);
-		minsize = SPA_MAX(minsize, qminsize);
-		stride = SPA_MAX(stride, qstride);
-		align = SPA_MAX(align, qalign);
-
-		pw_log_debug(NAME" %p: %d %d %d %d -> %zd %zd %d %zd", result,
-				qminsize, qstride, qmax_buffers, qalign,
-				minsize, stride, max_buffers, align);
+		blocks = SPA_CLAMP(q.blocks, 1u, MAX_BLOCKS);
+		minsize = SPA_MAX(minsize, q.size);
+		stride = SPA_MAX(stride, q.stride);
+		align = SPA_MAX(align, q.align);
+
+		pw_log_debug(NAME" %p: %d %d %d %d %d -> %zd %zd %d %d %zd", result,
+				q.size, q.stride, q.buffers, q.blocks, q.align,
+				minsize, stride, max_buffers, blocks, align);
 	} else {
 		pw_log_warn(NAME" %p: no buffers param", result);
 		minsize = 8192;
@@ -283,15 +301,22 @@ int pw_buffers_negotiate(struct pw_context *context, uint32_t flags,
 	if (SPA_FLAG_IS_SET(flags, PW_BUFFERS_FLAG_NO_MEM))
 		minsize = 0;
 
-	data_sizes[0] = minsize;
-	data_strides[0] = stride;
-	data_aligns[0] = align;
+	/* every block is a separate data plane in the same memory */
+	data_sizes = alloca(sizeof(uint32_t) * blocks);
+	data_strides = alloca(sizeof(int32_t) * blocks);
+	data_aligns = alloca(sizeof(uint32_t) * blocks);
+
+	for (i = 0; i < blocks; i++) {
+		data_sizes[i] = minsize;
+		data_strides[i] = stride;
+		data_aligns[i] = align;
+	}
 
 	if ((res = alloc_buffers(context->pool,
 				 max_buffers,
 				 n_params,
 				 params,
-				 1,
+				 blocks,
 				 data_sizes, data_strides,
 				 data_aligns,
 				 flags,
@@ -53,6 +53,8 @@
 #define DEFAULT_VIDEO_RATE_NUM		25u
 #define DEFAULT_VIDEO_RATE_DENOM	1u
 
+#define MAX_PARAM_CACHE			64u
+
 /** \cond */
 struct impl {
 	struct pw_context this;
@@ -70,6 +72,16 @@ struct factory_entry {
 	char *lib;
 };
 
+/* the params negotiated between two ports with the given param sets */
+struct param_cache {
+	uint32_t id;
+	uint64_t ihash;
+	uint64_t ohash;
+	uint32_t n_params;
+	uint32_t size;
+	void *data;
+};
+
 static int load_module_profile(struct pw_context *this, const char *profile)
 {
 	pw_log_debug(NAME" %p: module profile %s", this, profile);
@@ -163,7 +175,7 @@ struct pw_context *pw_context_new(struct pw_loop *main_loop,
 	uint32_t n_support;
 	struct pw_properties *pr;
 	struct spa_cpu *cpu;
-	int res = 0;
+	int n_threads, n_records, res = 0;
 
 	impl = calloc(1, sizeof(struct impl) + user_data_size);
 	if (impl == NULL) {
@@ -200,7 +212,12 @@ struct pw_context *pw_context_new(struct pw_loop *main_loop,
 		goto error_free;
 	}
 
-	this->pool = pw_mempool_new(NULL);
+	if ((str = pw_properties_get(properties, PW_KEY_MEM_ARENA_SIZE)) != NULL)
+		pr = pw_properties_new(PW_KEY_MEM_ARENA_SIZE, str, NULL);
+	else
+		pr = NULL;
+
+	this->pool = pw_mempool_new(pr);
 	if (this->pool == NULL) {
 		res = -errno;
 		goto error_free_loop;
@@ -239,6 +256,7 @@ struct pw_context *pw_context_new(struct pw_loop *main_loop,
 
 	pw_array_init(&this->factory_lib, 32);
 	pw_array_init(&this->objects, 32);
+	pw_array_init(&this->param_cache, 16 * sizeof(struct param_cache));
 	pw_map_init(&this->globals, 128, 32);
 
 	spa_list_init(&this->core_impl_list);
@@ -256,6 +274,7 @@ struct pw_context *pw_context_new(struct pw_loop *main_loop,
 	spa_list_init(&this->control_list[1]);
 	spa_list_init(&this->export_list);
 	spa_list_init(&this->driver_list);
+	spa_list_init(&this->graph_list);
 	spa_hook_list_init(&this->listener_list);
 
 	this->core = pw_context_create_core(this, pw_properties_copy(properties), 0);
@@ -270,6 +289,28 @@ struct pw_context *pw_context_new(struct pw_loop *main_loop,
 	if ((res = pw_data_loop_start(this->data_loop_impl)) < 0)
 		goto error_free_loop;
 
+	if ((str = pw_properties_get(properties, PW_KEY_CONTEXT_DATA_THREADS)) != NULL &&
+	    (n_threads = pw_properties_parse_int(str)) > 0) {
+		int cpu = -1, rt_prio = 0;
+
+		if ((str = pw_properties_get(properties, PW_KEY_CONTEXT_DATA_THREADS_CPU)) != NULL)
+			cpu = pw_properties_parse_int(str);
+		if ((str = pw_properties_get(properties, PW_KEY_CONTEXT_DATA_THREADS_RT_PRIO)) != NULL)
+			rt_prio = pw_properties_parse_int(str);
+
+		this->data_pool = pw_data_pool_new(this, n_threads, cpu, rt_prio);
+		if (this->data_pool == NULL)
+			pw_log_warn(NAME" %p: can't create data pool: %m", this);
+	}
+
+	if ((str = pw_properties_get(properties, PW_KEY_CONTEXT_PROFILER)) != NULL &&
+	    (n_records = pw_properties_parse_int(str)) > 0) {
+		this->profiler = pw_profiler_new(this,
+				pw_properties_get(properties, PW_KEY_CORE_NAME), n_records);
+		if (this->profiler == NULL)
+			pw_log_warn(NAME" %p: can't create profiler: %m", this);
+	}
+
 	this->sc_pagesize = sysconf(_SC_PAGESIZE);
 
 	if ((str = pw_properties_get(properties, PW_KEY_CONTEXT_PROFILE_MODULES)) == NULL)
@@ -310,6 +351,7 @@ void pw_context_destroy(struct pw_context *context)
 	struct pw_impl_node *node;
 	struct factory_entry *entry;
 	struct pw_impl_core *core_impl;
+	struct param_cache *pc;
 
 	pw_log_debug(NAME" %p: destroy", context);
 	pw_context_emit_destroy(context);
@@ -342,6 +384,12 @@ void pw_context_destroy(struct pw_context *context)
 
 	pw_data_loop_destroy(context->data_loop_impl);
 
+	if (context->data_pool)
+		pw_data_pool_destroy(context->data_pool);
+
+	if (context->profiler)
+		pw_profiler_destroy(context->profiler);
+
 	pw_properties_free(context->properties);
 
 	if (impl->dbus_handle)
@@ -355,6 +403,10 @@ void pw_context_destroy(struct pw_context *context)
 
 	pw_array_clear(&context->objects);
 
+	pw_array_for_each(pc, &context->param_cache)
+		free(pc->data);
+	pw_array_clear(&context->param_cache);
+
 	pw_map_clear(&context->globals);
 
 	free(context);
@@ -546,6 +598,127 @@ struct pw_impl_port *pw_context_find_port(struct pw_context *context,
 	return best;
 }
 
+static inline uint64_t hash_bytes(uint64_t hash, const void *data, size_t size)
+{
+	const uint8_t *p = data;
+	size_t i;
+
+	/* FNV-1a */
+	for (i = 0; i < size; i++) {
+		hash ^= p[i];
+		hash *= 0x100000001b3ULL;
+	}
+	return hash;
+}
+
+/** Hash all params with \a id of a port. Ports with the same params negotiate
+ * the same way so the hash is used as the key in the param cache. */
+int pw_context_hash_params(struct pw_context *context, struct spa_node *node,
+		enum spa_direction direction, uint32_t port_id, uint32_t id,
+		uint64_t *hash)
+{
+	uint8_t buffer[4096];
+	struct spa_pod_builder b = { 0 };
+	struct spa_pod *param;
+	uint32_t index = 0, n_params = 0;
+	uint64_t h = 0xcbf29ce484222325ULL;
+	int res;
+
+	while (true) {
+		spa_pod_builder_init(&b, buffer, sizeof(buffer));
+		if ((res = spa_node_port_enum_params_sync(node, direction, port_id,
+					id, &index, NULL, &param, &b)) != 1)
+			break;
+		h = hash_bytes(h, param, SPA_POD_SIZE(param));
+		n_params++;
+	}
+	if (res < 0 && res != -ENOENT)
+		return res;
+
+	*hash = hash_bytes(h, &n_params, sizeof(n_params));
+	return 0;
+}
+
+static struct param_cache *find_cache(struct pw_context *context, uint32_t id,
+		uint64_t ihash, uint64_t ohash)
+{
+	struct param_cache *pc;
+
+	pw_array_for_each(pc, &context->param_cache) {
+		if (pc->id == id && pc->ihash == ihash && pc->ohash == ohash)
+			return pc;
+	}
+	return NULL;
+}
+
+/** Add the params negotiated between ports with param sets \a ihash and \a ohash
+ * to the cache. \a params are \a n_params pods, padded to 8 bytes. */
+int pw_context_cache_params(struct pw_context *context, uint32_t id,
+		uint64_t ihash, uint64_t ohash,
+		const void *params, uint32_t size, uint32_t n_params)
+{
+	struct param_cache *pc;
+	void *data;
+
+	if ((data = malloc(size)) == NULL)
+		return -errno;
+	memcpy(data, params, size);
+
+	if ((pc = find_cache(context, id, ihash, ohash)) == NULL) {
+		if (pw_array_get_len(&context->param_cache, struct param_cache) >= MAX_PARAM_CACHE) {
+			/* drop the oldest entry */
+			pc = pw_array_first(&context->param_cache);
+			free(pc->data);
+			memmove(pc, pc + 1, context->param_cache.size - sizeof(*pc));
+			context->param_cache.size -= sizeof(*pc);
+		}
+		if ((pc = pw_array_add(&context->param_cache, sizeof(*pc))) == NULL) {
+			free(data);
+			return -errno;
+		}
+	} else {
+		free(pc->data);
+	}
+	pc->id = id;
+	pc->ihash = ihash;
+	pc->ohash = ohash;
+	pc->n_params = n_params;
+	pc->size = size;
+	pc->data = data;
+
+	pw_log_debug(NAME" %p: cache %d params id:%d %016"PRIx64" %016"PRIx64,
+			context, n_params, id, ihash, ohash);
+	return 0;
+}
+
+/** Add the cached params for ports with param sets \a ihash and \a ohash
+ * to \a builder.
+ * \return the number of params or 0 when nothing was cached */
+int pw_context_lookup_params(struct pw_context *context, uint32_t id,
+		uint64_t ihash, uint64_t ohash, struct spa_pod_builder *builder)
+{
+	struct param_cache *pc;
+
+	if ((pc = find_cache(context, id, ihash, ohash)) == NULL)
+		return 0;
+
+	if (spa_pod_builder_raw(builder, pc->data, pc->size) < 0)
+		return 0;
+
+	pw_log_debug(NAME" %p: found %d cached params id:%d", context, pc->n_params, id);
+	return pc->n_params;
+}
+
+static uint64_t port_format_hash(struct pw_context *context, struct pw_impl_port *port)
+{
+	/* reset when the port params change */
+	if (port->enum_format_hash == 0 &&
+	    pw_context_hash_params(context, port->node->node, port->direction,
+		    port->port_id, SPA_PARAM_EnumFormat, &port->enum_format_hash) < 0)
+		port->enum_format_hash = 0;
+	return port->enum_format_hash;
+}
+
 /** Find a common format between two ports
  *
  * \param context a context object
@@ -562,6 +735,7 @@ struct pw_impl_port *pw_context_find_port(struct pw_context *context,
  *
  * \memberof pw_context
  */
+SPA_EXPORT
 int pw_context_find_format(struct pw_context *context,
 			struct pw_impl_port *output,
 			struct pw_impl_port *input,
@@ -647,6 +821,19 @@ int pw_context_find_format(struct pw_context *context,
 			goto error;
 		}
 	} else if (in_state == PW_IMPL_PORT_STATE_CONFIGURE && out_state == PW_IMPL_PORT_STATE_CONFIGURE) {
+		uint64_t ihash, ohash;
+		uint32_t offset = builder->state.offset;
+
+		/* the same ports are linked over and over again, try the formats
+		 * that we found for them before */
+		ihash = port_format_hash(context, input);
+		ohash = port_format_hash(context, output);
+		if (ihash != 0 && ohash != 0 &&
+		    pw_context_lookup_params(context, SPA_PARAM_EnumFormat,
+				    ihash, ohash, builder) == 1) {
+			*format = spa_pod_builder_deref(builder, offset);
+			return 1;
+		}
 	      again:
 		/* both ports need a format */
 		pw_log_debug(NAME" %p: do enum input %d", context, iidx);
@@ -684,6 +871,10 @@ int pw_context_find_format(struct pw_context *context,
 		pw_log_debug(NAME" %p: Got filtered:", context);
 		if (pw_log_level_enabled(SPA_LOG_LEVEL_DEBUG))
 			spa_debug_format(2, NULL, *format);
+
+		if (ihash != 0 && ohash != 0)
+			pw_context_cache_params(context, SPA_PARAM_EnumFormat, ihash, ohash,
+					*format, SPA_POD_SIZE(*format), 1);
 	} else {
 		res = -EBADF;
 		asprintf(error, "error bad node state");
@@ -699,13 +890,16 @@ error:
 
 static int collect_nodes(struct pw_impl_node *driver)
 {
+	struct pw_context *context = driver->context;
 	struct spa_list queue;
 	struct pw_impl_node *n, *t;
 	struct pw_impl_port *p;
 	struct pw_impl_link *l;
 	uint32_t max_quantum = 0;
 	uint32_t min_quantum = 0;
-	uint32_t quantum;
+	uint32_t lim_quantum = 0;
+	uint32_t quantum, limit;
+	bool power_save = true;
 
 	spa_list_consume(t, &driver->slave_list, slave_link) {
 		spa_list_remove(&t->slave_link);
@@ -728,6 +922,13 @@ static int collect_nodes(struct pw_impl_node *driver)
 			if (n->quantum_size > max_quantum)
 				max_quantum = n->quantum_size;
 		}
+		/* the driver only limits how far we can go */
+		if (n != driver) {
+			if (n->max_quantum_size == 0)
+				power_save = false;
+			else if (lim_quantum == 0 || n->max_quantum_size < lim_quantum)
+				lim_quantum = n->max_quantum_size;
+		}
 
 		spa_list_for_each(p, &n->input_ports, link) {
 			spa_list_for_each(l, &p->links, input_link) {
@@ -749,86 +950,199 @@ static int collect_nodes(struct pw_impl_node *driver)
 		}
 	}
 
-	quantum = min_quantum;
-	if (quantum == 0)
-		quantum = driver->context->defaults.clock_quantum;
-
-	/* for now, we try to limit the latency between min and default, We can
-	 * go to max but we should really only do this when in power save mode */
+	limit = context->defaults.clock_max_quantum;
+	if (driver->max_quantum_size > 0)
+		limit = SPA_MIN(limit, driver->max_quantum_size);
+	if (lim_quantum > 0)
+		limit = SPA_MIN(limit, lim_quantum);
+
+	if (power_save && lim_quantum > 0) {
+		/* all slaves can handle a higher latency, go as high as they
+		 * allow to save wakeups but not above an explicit latency */
+		quantum = limit;
+		if (min_quantum > 0)
+			quantum = SPA_MIN(quantum, min_quantum);
+	} else {
+		/* limit the latency between min and default */
+		quantum = min_quantum;
+		if (quantum == 0 || quantum > context->defaults.clock_quantum)
+			quantum = context->defaults.clock_quantum;
+		power_save = false;
+	}
 	driver->quantum_current = SPA_CLAMP(quantum,
-			driver->context->defaults.clock_min_quantum,
-			driver->context->defaults.clock_quantum);
+			context->defaults.clock_min_quantum, limit);
+
+	pw_log_info("driver %p: quantum:%u power-save:%d", driver,
+			driver->quantum_current, power_save);
 
 	return 0;
 }
 
+static inline void graph_add(struct spa_list *list, struct pw_impl_node *node)
+{
+	if (node->graph_changed)
+		return;
+	node->graph_changed = true;
+	spa_list_append(list, &node->graph_link);
+}
+
+/** Mark \a node as changed for the next pw_context_recalc_graph().
+ * Call this when the node was registered, (de)activated, linked, unlinked
+ * or when its quantum changed. */
+SPA_EXPORT
+void pw_context_graph_changed(struct pw_context *context, struct pw_impl_node *node)
+{
+	if (node->registered)
+		graph_add(&context->graph_list, node);
+}
+
+/* Extend the changed nodes with the group they were in and the group they
+ * are in now. Only these nodes can change driver, all other groups stay as
+ * they are. */
+static void collect_changed(struct pw_context *context, struct spa_list *changed)
+{
+	struct pw_impl_node *n, *t;
+	struct pw_impl_port *p;
+	struct pw_impl_link *l;
+
+	spa_list_init(changed);
+	spa_list_insert_list(changed, &context->graph_list);
+	spa_list_init(&context->graph_list);
+
+	spa_list_for_each(n, changed, graph_link) {
+		/* the old group, through our driver and our slaves */
+		graph_add(changed, n->driver_node);
+		spa_list_for_each(t, &n->slave_list, slave_link)
+			graph_add(changed, t);
+
+		/* the new group */
+		if (!n->active)
+			continue;
+
+		spa_list_for_each(p, &n->input_ports, link) {
+			spa_list_for_each(l, &p->links, input_link) {
+				t = l->output->node;
+				if (t->active)
+					graph_add(changed, t);
+			}
+		}
+		spa_list_for_each(p, &n->output_ports, link) {
+			spa_list_for_each(l, &p->links, output_link) {
+				t = l->input->node;
+				if (t->active)
+					graph_add(changed, t);
+			}
+		}
+	}
+}
+
+static void count_active_slaves(struct pw_context *context, struct pw_impl_node *n)
+{
+	struct pw_impl_node *s;
+
+	n->active_slaves = 0;
+	spa_list_for_each(s, &n->slave_list, slave_link) {
+		pw_log_info(NAME" %p: driver %p: slave %p %s: %d",
+				context, n, s, s->name, s->active);
+		if (s != n && s->active)
+			n->active_slaves++;
+	}
+	pw_log_info(NAME" %p: driver %p active slaves %d",
+			context, n, n->active_slaves);
+}
+
+SPA_EXPORT
 int pw_context_recalc_graph(struct pw_context *context)
 {
+	struct spa_list changed;
 	struct pw_impl_node *n, *s, *target;
+	bool full = false;
+
+	if (spa_list_is_empty(&context->graph_list))
+		return 0;
 
-	/* start from all drivers and group all nodes that are linked
+	collect_changed(context, &changed);
+
+again:
+	/* start from all changed drivers and group all nodes that are linked
 	 * to it. Some nodes are not (yet) linked to anything and they
 	 * will end up 'unassigned' to a master. Other nodes are master
 	 * and if they have active slaves, we can use them to schedule
 	 * the unassigned nodes. */
 	target = NULL;
 	spa_list_for_each(n, &context->driver_list, driver_link) {
-		uint32_t active_slaves;
-
-		if (n->active && !n->visited)
-			collect_nodes(n);
-
-		/* from now on we are only interested in nodes that are
-		 * a master. We're going to count the number of slaves it
-		 * has. */
-		if (!n->master)
-			continue;
-
-		active_slaves = 0;
-		spa_list_for_each(s, &n->slave_list, slave_link) {
-			pw_log_info(NAME" %p: driver %p: slave %p %s: %d",
-					context, n, s, s->name, s->active);
-			if (s != n && s->active)
-				active_slaves++;
+		if (n->graph_changed) {
+			if (n->active && !n->visited)
+				collect_nodes(n);
+
+			/* from now on we are only interested in nodes that are
+			 * a master. We're going to count the number of slaves it
+			 * has. */
+			if (n->master)
+				count_active_slaves(context, n);
 		}
-		pw_log_info(NAME" %p: driver %p active slaves %d",
-				context, n, active_slaves);
-
 		/* if the master has active slaves, it is a target for our
-		 * unassigned nodes */
-		if (active_slaves > 0) {
+		 * unassigned nodes. The count of unchanged masters is
+		 * still valid. */
+		if (n->master && n->active_slaves > 0) {
 			if (target == NULL)
 				target = n;
 		}
 	}
 
-	/* now go through all available nodes. The ones we didn't visit
+	/* when the target changes, all unassigned nodes need to move to the
+	 * new target. We don't keep track of them so regroup everything. */
+	if (target != context->graph_target) {
+		context->graph_target = target;
+		if (!full) {
+			pw_log_debug(NAME" %p: new target %p, full recalc", context, target);
+			spa_list_for_each(n, &changed, graph_link)
+				n->visited = false;
+			spa_list_for_each(n, &context->node_list, link)
+				graph_add(&changed, n);
+			full = true;
+			goto again;
+		}
+	}
+
+	/* now go through all changed nodes. The ones we didn't visit
 	 * in collect_nodes() are not linked to any master. We assign them
 	 * to an active master */
-	spa_list_for_each(n, &context->node_list, link) {
-		if (!n->visited) {
+	spa_list_for_each(n, &changed, graph_link) {
+		if (n->visited)
+			continue;
 
-			pw_log_info(NAME" %p: unassigned node %p: '%s' %d %d", context,
-					n, n->name, n->active, n->want_driver);
+		pw_log_info(NAME" %p: unassigned node %p: '%s' %d %d", context,
+				n, n->name, n->active, n->want_driver);
 
-			if (!n->want_driver)
-				continue;
+		if (!n->want_driver) {
+			/* collect_nodes() could have removed us from the slave
+			 * list of our old driver, don't keep a reference to it */
+			pw_impl_node_set_driver(n, NULL);
+			continue;
+		}
 
-			if (target != NULL) {
-				if (n->quantum_size > 0 && n->quantum_size < target->quantum_current)
-					target->quantum_current =
-						SPA_MAX(context->defaults.clock_min_quantum, n->quantum_size);
-			}
-			pw_impl_node_set_driver(n, target);
-			pw_impl_node_set_state(n, target && n->active ?
-					PW_NODE_STATE_RUNNING : PW_NODE_STATE_IDLE);
+		if (target != NULL) {
+			uint32_t limit = n->max_quantum_size ?
+				n->max_quantum_size : context->defaults.clock_quantum;
+
+			if (n->quantum_size > 0 && n->quantum_size < target->quantum_current)
+				target->quantum_current =
+					SPA_MAX(context->defaults.clock_min_quantum, n->quantum_size);
+			/* active nodes that can't handle the latency stop
+			 * the power saving of the target */
+			if (n->active && limit < target->quantum_current)
+				target->quantum_current =
+					SPA_MAX(context->defaults.clock_min_quantum, limit);
 		}
-		n->visited = false;
+		pw_impl_node_set_driver(n, target);
+		pw_impl_node_set_state(n, target && n->active ?
+				PW_NODE_STATE_RUNNING : PW_NODE_STATE_IDLE);
 	}
 
 	/* assign final quantum and debug masters and slaves */
 	spa_list_for_each(n, &context->driver_list, driver_link) {
-		if (!n->master)
+		if (!n->master || !(n->graph_changed || n == target))
 			continue;
 
 		if (n->rt.position && n->quantum_current != n->rt.position->clock.duration)
@@ -841,6 +1155,12 @@ int pw_context_recalc_graph(struct pw_context *context)
 			pw_log_info(NAME" %p: slave %p: active:%d '%s'",
 					context, s, s->active, s->name);
 	}
+
+	spa_list_consume(n, &changed, graph_link) {
+		spa_list_remove(&n->graph_link);
+		n->graph_changed = false;
+		n->visited = false;
+	}
 	return 0;
 }
 
@@ -0,0 +1,449 @@
+/* PipeWire
+ *
+ * Copyright © 2020 Wim Taymans
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the next
+ * paragraph) shall be included in all copies or substantial portions of the
+ * Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+#include <errno.h>
+#include <pthread.h>
+#include <sched.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#ifdef __linux__
+#include <linux/futex.h>
+#include <sys/syscall.h>
+#endif
+
+#include <spa/utils/result.h>
+
+#include "pipewire/log.h"
+#include "pipewire/private.h"
+
+#define NAME "data-pool"
+
+#define DEQUE_SIZE	1024
+#define DEQUE_MASK	(DEQUE_SIZE - 1)
+
+#define SPIN_COUNT	2000
+
+/** \cond */
+
+/* Chase-Lev work-stealing deque. The owner pushes and pops at the bottom,
+ * other threads steal from the top. */
+struct deque {
+	int64_t top;
+	int64_t bottom;
+	struct pw_node_target *items[DEQUE_SIZE];
+};
+
+struct worker {
+	struct pw_data_pool *pool;
+	uint32_t id;
+	pthread_t thread;
+	unsigned int started:1;
+	struct deque deque;
+};
+
+/* Bounded multi producer, multi consumer queue for targets that are pushed
+ * from threads that are not workers, such as the data loop. */
+struct inject {
+	uint64_t head;
+	uint64_t tail;
+	struct {
+		uint64_t seq;
+		struct pw_node_target *item;
+	} cells[DEQUE_SIZE];
+};
+
+struct pw_data_pool {
+	struct pw_context *context;
+
+	uint32_t n_workers;
+	struct worker *workers;
+	struct inject inject;
+	int cpu_base;			/* first cpu to pin workers to or -1 */
+	int rt_prio;			/* rt priority of the workers or 0 */
+
+	uint32_t seq;			/* futex word, incremented when work is pushed */
+	uint32_t sleeping;		/* number of sleeping workers */
+	uint32_t busy;			/* number of queued and running targets */
+	uint32_t running;
+};
+/** \endcond */
+
+static __thread struct worker *current_worker;
+
+static inline bool deque_push(struct deque *d, struct pw_node_target *t)
+{
+	int64_t b = __atomic_load_n(&d->bottom, __ATOMIC_RELAXED);
+	int64_t top = __atomic_load_n(&d->top, __ATOMIC_ACQUIRE);
+
+	if (b - top >= DEQUE_SIZE)
+		return false;
+
+	__atomic_store_n(&d->items[b & DEQUE_MASK], t, __ATOMIC_RELAXED);
+	__atomic_thread_fence(__ATOMIC_RELEASE);
+	__atomic_store_n(&d->bottom, b + 1, __ATOMIC_RELAXED);
+	return true;
+}
+
+static inline struct pw_node_target *deque_pop(struct deque *d)
+{
+	int64_t b = __atomic_load_n(&d->bottom, __ATOMIC_RELAXED) - 1;
+	int64_t t;
+	struct pw_node_target *item = NULL;
+
+	__atomic_store_n(&d->bottom, b, __ATOMIC_RELAXED);
+	__atomic_thread_fence(__ATOMIC_SEQ_CST);
+	t = __atomic_load_n(&d->top, __ATOMIC_RELAXED);
+
+	if (t <= b) {
+		item = __atomic_load_n(&d->items[b & DEQUE_MASK], __ATOMIC_RELAXED);
+		if (t == b) {
+			/* last item, race against thieves */
+			if (!__atomic_compare_exchange_n(&d->top, &t, t + 1,
+						0, __ATOMIC_SEQ_CST, __ATOMIC_RELAXED))
+				item = NULL;
+			__atomic_store_n(&d->bottom, b + 1, __ATOMIC_RELAXED);
+		}
+	} else {
+		__atomic_store_n(&d->bottom, b + 1, __ATOMIC_RELAXED);
+	}
+	return item;
+}
+
+static inline struct pw_node_target *deque_steal(struct deque *d)
+{
+	int64_t t = __atomic_load_n(&d->top, __ATOMIC_ACQUIRE);
+	int64_t b;
+	struct pw_node_target *item;
+
+	__atomic_thread_fence(__ATOMIC_SEQ_CST);
+	b = __atomic_load_n(&d->bottom, __ATOMIC_ACQUIRE);
+
+	if (t >= b)
+		return NULL;
+
+	item = __atomic_load_n(&d->items[t & DEQUE_MASK], __ATOMIC_RELAXED);
+	if (!__atomic_compare_exchange_n(&d->top, &t, t + 1,
+				0, __ATOMIC_SEQ_CST, __ATOMIC_RELAXED))
+		return NULL;
+
+	return item;
+}
+
+static inline void inject_init(struct inject *q)
+{
+	uint32_t i;
+	for (i = 0; i < DEQUE_SIZE; i++)
+		q->cells[i].seq = i;
+}
+
+static inline bool inject_push(struct inject *q, struct pw_node_target *t)
+{
+	uint64_t pos = __atomic_load_n(&q->tail, __ATOMIC_RELAXED), seq;
+	int64_t diff;
+
+	while (true) {
+		seq = __atomic_load_n(&q->cells[pos & DEQUE_MASK].seq, __ATOMIC_ACQUIRE);
+		diff = (int64_t)(seq - pos);
+		if (diff == 0) {
+			if (__atomic_compare_exchange_n(&q->tail, &pos, pos + 1,
+						1, __ATOMIC_RELAXED, __ATOMIC_RELAXED))
+				break;
+		} else if (diff < 0) {
+			return false;
+		} else {
+			pos = __atomic_load_n(&q->tail, __ATOMIC_RELAXED);
+		}
+	}
+	q->cells[pos & DEQUE_MASK].item = t;
+	__atomic_store_n(&q->cells[pos & DEQUE_MASK].seq, pos + 1, __ATOMIC_RELEASE);
+	return true;
+}
+
+static inline struct pw_node_target *inject_pop(struct inject *q)
+{
+	uint64_t pos = __atomic_load_n(&q->head, __ATOMIC_RELAXED), seq;
+	struct pw_node_target *item;
+	int64_t diff;
+
+	while (true) {
+		seq = __atomic_load_n(&q->cells[pos & DEQUE_MASK].seq, __ATOMIC_ACQUIRE);
+		diff = (int64_t)(seq - (pos + 1));
+		if (diff == 0) {
+			if (__atomic_compare_exchange_n(&q->head, &pos, pos + 1,
+						1, __ATOMIC_RELAXED, __ATOMIC_RELAXED))
+				break;
+		} else if (diff < 0) {
+			return NULL;
+		} else {
+			pos = __atomic_load_n(&q->head, __ATOMIC_RELAXED);
+		}
+	}
+	item = q->cells[pos & DEQUE_MASK].item;
+	__atomic_store_n(&q->cells[pos & DEQUE_MASK].seq, pos + DEQUE_SIZE, __ATOMIC_RELEASE);
+	return item;
+}
+
+static inline void futex_wait(uint32_t *addr, uint32_t val)
+{
+#ifdef __linux__
+	syscall(SYS_futex, addr, FUTEX_WAIT_PRIVATE, val, NULL, NULL, 0);
+#else
+	sched_yield();
+#endif
+}
+
+static inline void futex_wake(uint32_t *addr, int n)
+{
+#ifdef __linux__
+	syscall(SYS_futex, addr, FUTEX_WAKE_PRIVATE, n, NULL, NULL, 0);
+#endif
+}
+
+static inline void run_target(struct pw_data_pool *pool, struct pw_node_target *t)
+{
+	t->signal(t->data);
+	ATOMIC_DEC(pool->busy);
+}
+
+static struct pw_node_target *find_work(struct pw_data_pool *pool, struct worker *w)
+{
+	struct pw_node_target *t;
+	uint32_t i, n = pool->n_workers;
+
+	if (w != NULL && (t = deque_pop(&w->deque)) != NULL)
+		return t;
+	if ((t = inject_pop(&pool->inject)) != NULL)
+		return t;
+
+	/* steal, starting from our right neighbour so that workers don't all
+	 * hammer the same deque */
+	for (i = 1; i <= n; i++) {
+		struct worker *o = &pool->workers[((w ? w->id : 0) + i) % n];
+		if (o == w)
+			continue;
+		if ((t = deque_steal(&o->deque)) != NULL)
+			return t;
+	}
+	return NULL;
+}
+
+static void setup_thread(struct pw_data_pool *pool, struct worker *w)
+{
+#ifdef __linux__
+	if (pool->cpu_base >= 0) {
+		cpu_set_t set;
+		long n_cpus = sysconf(_SC_NPROCESSORS_ONLN);
+		int res;
+
+		CPU_ZERO(&set);
+		CPU_SET((pool->cpu_base + w->id) % SPA_MAX(n_cpus, 1l), &set);
+		if ((res = pthread_setaffinity_np(pthread_self(), sizeof(set), &set)) != 0)
+			pw_log_warn(NAME" %p: worker %u: can't set affinity: %s",
+					pool, w->id, strerror(res));
+	}
+#endif
+	if (pool->rt_prio > 0) {
+		struct sched_param sp;
+		int res;
+
+		spa_zero(sp);
+		sp.sched_priority = pool->rt_prio;
+#ifdef SCHED_RESET_ON_FORK
+		res = pthread_setschedparam(pthread_self(), SCHED_FIFO | SCHED_RESET_ON_FORK, &sp);
+#else
+		res = pthread_setschedparam(pthread_self(), SCHED_FIFO, &sp);
+#endif
+		if (res != 0)
+			pw_log_info(NAME" %p: worker %u: can't set rt priority %d: %s",
+					pool, w->id, pool->rt_prio, strerror(res));
+	}
+}
+
+static void *do_worker(void *user_data)
+{
+	struct worker *w = user_data;
+	struct pw_data_pool *pool = w->pool;
+	struct pw_node_target *t;
+	uint32_t spin = 0, seq;
+
+	pw_log_debug(NAME" %p: worker %u: enter thread", pool, w->id);
+	current_worker = w;
+	setup_thread(pool, w);
+
+	while (ATOMIC_LOAD(pool->running)) {
+		if ((t = find_work(pool, w)) != NULL) {
+			run_target(pool, t);
+			spin = 0;
+			continue;
+		}
+		if (spin++ < SPIN_COUNT) {
+			sched_yield();
+			continue;
+		}
+		seq = ATOMIC_LOAD(pool->seq);
+		ATOMIC_INC(pool->sleeping);
+		/* check again, something might have been pushed before we
+		 * announced that we were going to sleep */
+		if ((t = find_work(pool, w)) != NULL) {
+			ATOMIC_DEC(pool->sleeping);
+			run_target(pool, t);
+			spin = 0;
+			continue;
+		}
+		if (ATOMIC_LOAD(pool->running))
+			futex_wait(&pool->seq, seq);
+		ATOMIC_DEC(pool->sleeping);
+		spin = 0;
+	}
+	current_worker = NULL;
+	pw_log_debug(NAME" %p: worker %u: leave thread", pool, w->id);
+	return NULL;
+}
+
+/** Queue a ready target for execution on one of the workers.
+ *
+ * When called from a worker, the target is pushed on the worker's own deque,
+ * otherwise it is pushed on a shared queue that is safe to use from any
+ * thread. The target is executed inline when the queue is full.
+ */
+SPA_EXPORT
+void pw_data_pool_push(struct pw_data_pool *pool, struct pw_node_target *t)
+{
+	struct worker *w = current_worker;
+	bool res;
+
+	ATOMIC_INC(pool->busy);
+	if (w != NULL && w->pool == pool)
+		res = deque_push(&w->deque, t);
+	else
+		res = inject_push(&pool->inject, t);
+
+	if (SPA_UNLIKELY(!res)) {
+		pw_log_warn(NAME" %p: queue full", pool);
+		run_target(pool, t);
+		return;
+	}
+	ATOMIC_INC(pool->seq);
+	if (ATOMIC_LOAD(pool->sleeping) > 0)
+		futex_wake(&pool->seq, 1);
+}
+
+/** Wait until all queued targets have completed.
+ *
+ * The calling thread helps executing queued targets. This must be called
+ * from the data loop before the target lists are modified.
+ */
+SPA_EXPORT
+void pw_data_pool_sync(struct pw_data_pool *pool)
+{
+	struct pw_node_target *t;
+
+	while (ATOMIC_LOAD(pool->busy) > 0) {
+		if ((t = find_work(pool, NULL)) != NULL)
+			run_target(pool, t);
+		else
+			sched_yield();
+	}
+}
+
+SPA_EXPORT
+uint32_t pw_data_pool_get_n_workers(struct pw_data_pool *pool)
+{
+	return pool->n_workers;
+}
+
+SPA_EXPORT
+struct pw_data_pool *pw_data_pool_new(struct pw_context *context, uint32_t n_workers,
+		int cpu_base, int rt_prio)
+{
+	struct pw_data_pool *pool;
+	uint32_t i;
+	int res;
+
+	pool = calloc(1, sizeof(struct pw_data_pool));
+	if (pool == NULL)
+		return NULL;
+
+	pool->workers = calloc(n_workers, sizeof(struct worker));
+	if (pool->workers == NULL) {
+		res = -errno;
+		goto error_free;
+	}
+	pool->context = context;
+	pool->n_workers = n_workers;
+	pool->cpu_base = cpu_base;
+	pool->rt_prio = rt_prio;
+	pool->running = true;
+	inject_init(&pool->inject);
+
+	pw_log_debug(NAME" %p: new workers:%u cpu:%d prio:%d", pool,
+			n_workers, cpu_base, rt_prio);
+
+	for (i = 0; i < n_workers; i++) {
+		pool->workers[i].pool = pool;
+		pool->workers[i].id = i;
+	}
+	for (i = 0; i < n_workers; i++) {
+		struct worker *w = &pool->workers[i];
+		int err;
+
+		if ((err = pthread_create(&w->thread, NULL, do_worker, w)) != 0) {
+			pw_log_error(NAME" %p: can't create worker %u: %s",
+					pool, i, strerror(err));
+			res = -err;
+			goto error_stop;
+		}
+		w->started = true;
+	}
+	return pool;
+
+error_stop:
+	pw_data_pool_destroy(pool);
+	errno = -res;
+	return NULL;
+error_free:
+	free(pool);
+	errno = -res;
+	return NULL;
+}
+
+SPA_EXPORT
+void pw_data_pool_destroy(struct pw_data_pool *pool)
+{
+	uint32_t i;
+
+	pw_log_debug(NAME" %p: destroy", pool);
+
+	ATOMIC_STORE(pool->running, false);
+	ATOMIC_INC(pool->seq);
+	futex_wake(&pool->seq, INT32_MAX);
+
+	for (i = 0; i < pool->n_workers; i++) {
+		if (pool->workers[i].started)
+			pthread_join(pool->workers[i].thread, NULL);
+	}
+	free(pool->workers);
+	free(pool);
+}
@@ -67,6 +67,8 @@ struct impl {
 	struct spa_io_buffers io;
 
 	struct pw_impl_node *inode, *onode;
+
+	uint64_t setup_time;		/* start of the negotiation */
 };
 
 /** \endcond */
@@ -103,8 +105,16 @@ static void info_changed(struct pw_impl_link *link)
 	link->info.change_mask = 0;
 }
 
+static uint64_t get_time_ns(void)
+{
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return SPA_TIMESPEC_TO_NSEC(&ts);
+}
+
 static void pw_impl_link_update_state(struct pw_impl_link *link, enum pw_link_state state, char *error)
 {
+	struct impl *impl = SPA_CONTAINER_OF(link, struct impl, this);
 	enum pw_link_state old = link->info.state;
 	struct pw_impl_node *in = link->input->node, *out = link->output->node;
 
@@ -125,6 +135,17 @@ static void pw_impl_link_update_state(struct pw_impl_link *link, enum pw_link_st
 
 	pw_impl_link_emit_state_changed(link, old, state, error);
 
+	if (state == PW_LINK_STATE_NEGOTIATING) {
+		impl->setup_time = get_time_ns();
+	} else if (state == PW_LINK_STATE_PAUSED && impl->setup_time != 0) {
+		uint64_t usec = (get_time_ns() - impl->setup_time) / SPA_NSEC_PER_USEC;
+
+		pw_log_debug(NAME" %p: setup time %"PRIu64"us", link, usec);
+		pw_properties_setf(link->properties, PW_KEY_LINK_SETUP_TIME, "%"PRIu64, usec);
+		link->info.change_mask |= PW_LINK_CHANGE_MASK_PROPS;
+		impl->setup_time = 0;
+	}
+
 	link->info.change_mask |= PW_LINK_CHANGE_MASK_STATE;
 	info_changed(link);
 
@@ -510,6 +531,9 @@ do_activate_link(struct spa_loop *loop,
 
 	pw_log_trace(NAME" %p: activate", this);
 
+	if (this->context->data_pool)
+		pw_data_pool_sync(this->context->data_pool);
+
 	spa_list_append(&this->output->rt.mix_list, &this->rt.out_mix.rt_link);
 	spa_list_append(&this->input->rt.mix_list, &this->rt.in_mix.rt_link);
 
@@ -519,6 +543,9 @@ do_activate_link(struct spa_loop *loop,
 		this->rt.target.activation = impl->inode->rt.activation;
 		spa_list_append(&impl->onode->rt.target_list, &this->rt.target.link);
 		required = ++this->rt.target.activation->state[0].required;
+		this->rt.target.legacy_peer =
+			pw_node_activation_add_peer(this->rt.target.activation,
+					impl->onode->rt.activation);
 		pw_log_trace(NAME" %p: node:%p required:%d", this,
 				impl->inode, required);
 	}
@@ -630,6 +657,7 @@ static void input_remove(struct pw_impl_link *this, struct pw_impl_port *port)
 
 	spa_list_remove(&this->input_link);
 	pw_impl_port_emit_link_removed(this->input, this);
+	pw_impl_port_recalc_latency(port);
 
 	if ((res = pw_impl_port_use_buffers(port, mix, 0, NULL, 0)) < 0) {
 		pw_log_warn(NAME" %p: port %p clear error %s", this, port, spa_strerror(res));
@@ -649,7 +677,10 @@ static void output_remove(struct pw_impl_link *this, struct pw_impl_port *port)
 	spa_hook_remove(&impl->output_global_listener);
 
 	spa_list_remove(&this->output_link);
+	if (!this->feedback)
+		this->context->reach_version++;
 	pw_impl_port_emit_link_removed(this->output, this);
+	pw_impl_port_recalc_latency(port);
 
 	/* we don't clear output buffers when the link goes away. They will get
 	 * cleared when the node goes to suspend */
@@ -716,6 +747,9 @@ do_deactivate_link(struct spa_loop *loop,
 
 	pw_log_trace(NAME" %p: disable %p and %p", this, &this->rt.in_mix, &this->rt.out_mix);
 
+	if (this->context->data_pool)
+		pw_data_pool_sync(this->context->data_pool);
+
 	spa_list_remove(&this->rt.out_mix.rt_link);
 	spa_list_remove(&this->rt.in_mix.rt_link);
 
@@ -724,6 +758,8 @@ do_deactivate_link(struct spa_loop *loop,
 
 		spa_list_remove(&this->rt.target.link);
 		required = --this->rt.target.activation->state[0].required;
+		pw_node_activation_remove_peer(this->rt.target.activation,
+				this->rt.target.legacy_peer);
 		pw_log_trace(NAME" %p: node:%p required:%d", this,
 				impl->inode, required);
 	}
@@ -889,30 +925,79 @@ static const struct pw_impl_node_events output_node_events = {
 	.result = output_node_result,
 };
 
+static bool nodes_linked(struct pw_impl_node *output, struct pw_impl_node *input)
+{
+	struct pw_impl_port *p;
+	struct pw_impl_link *l;
+
+	spa_list_for_each(p, &output->output_ports, link) {
+		spa_list_for_each(l, &p->links, output_link) {
+			if (!l->feedback && l->input->node == input)
+				return true;
+		}
+	}
+	return false;
+}
+
+/* Breadth first walk over the non-feedback links. Every node is visited at
+ * most once so that diamond shaped graphs don't make this exponential.
+ *
+ * The result is cached in output until the reach_version of the context
+ * changes. When many ports of the same nodes are linked, only the first
+ * link walks the graph. */
 static bool pw_impl_node_can_reach(struct pw_impl_node *output, struct pw_impl_node *input)
 {
+	struct pw_context *context = output->context;
+	struct spa_list queue;
+	struct pw_impl_node *n;
 	struct pw_impl_port *p;
+	struct pw_impl_link *l;
+	uint32_t serial;
+	bool found = false;
 
 	if (output == input)
 		return true;
 
-	spa_list_for_each(p, &output->output_ports, link) {
-		struct pw_impl_link *l;
+	if (output->reach_cache.target == input &&
+	    output->reach_cache.version == context->reach_version)
+		return output->reach_cache.result;
 
-		spa_list_for_each(l, &p->links, output_link) {
-			if (l->feedback)
-				continue;
-			if (l->input->node == input)
-				return true;
-		}
-		spa_list_for_each(l, &p->links, output_link) {
-			if (l->feedback)
-				continue;
-			if (pw_impl_node_can_reach(l->input->node, input))
-				return true;
+	serial = ++context->reach_serial;
+	if (serial == 0) {
+		/* wrapped around, forget old marks */
+		spa_list_for_each(n, &context->node_list, link)
+			n->reach_serial = 0;
+		serial = ++context->reach_serial;
+	}
+
+	spa_list_init(&queue);
+	spa_list_append(&queue, &output->sort_link);
+	output->reach_serial = serial;
+
+	spa_list_consume(n, &queue, sort_link) {
+		spa_list_remove(&n->sort_link);
+		if (found)
+			continue;
+
+		spa_list_for_each(p, &n->output_ports, link) {
+			spa_list_for_each(l, &p->links, output_link) {
+				struct pw_impl_node *t = l->input->node;
+
+				if (l->feedback || t->reach_serial == serial)
+					continue;
+				if (t == input) {
+					found = true;
+					break;
+				}
+				t->reach_serial = serial;
+				spa_list_append(&queue, &t->sort_link);
+			}
 		}
 	}
-	return false;
+	output->reach_cache.version = context->reach_version;
+	output->reach_cache.target = input;
+	output->reach_cache.result = found;
+	return found;
 }
 
 static void try_link_controls(struct impl *impl, struct pw_impl_port *output, struct pw_impl_port *input)
@@ -1087,6 +1172,11 @@ struct pw_impl_link *pw_context_create_link(struct pw_context *context,
 	pw_log_debug(NAME" %p: output node %p live %d, passive %d, feedback %d",
 			this, output_node, output_node->live, impl->passive, this->feedback);
 
+	/* a link between nodes that are linked already or a feedback link
+	 * doesn't change what nodes can reach each other */
+	if (!this->feedback && !nodes_linked(output_node, input_node))
+		context->reach_version++;
+
 	spa_list_append(&output->links, &this->output_link);
 	spa_list_append(&input->links, &this->input_link);
 
@@ -1121,10 +1211,15 @@ struct pw_impl_link *pw_context_create_link(struct pw_context *context,
 	pw_impl_port_emit_link_added(output, this);
 	pw_impl_port_emit_link_added(input, this);
 
+	pw_impl_port_recalc_latency(output);
+	pw_impl_port_recalc_latency(input);
+
 	try_link_controls(impl, output, input);
 
 	pw_impl_node_emit_peer_added(output_node, input_node);
 
+	pw_context_graph_changed(context, output_node);
+	pw_context_graph_changed(context, input_node);
 	pw_context_recalc_graph(context);
 
 	return this;
@@ -1260,6 +1355,9 @@ void pw_impl_link_destroy(struct pw_impl_link *link)
 
 	pw_impl_node_emit_peer_removed(link->output->node, link->input->node);
 
+	pw_context_graph_changed(link->context, link->output->node);
+	pw_context_graph_changed(link->context, link->input->node);
+
 	try_unlink_controls(impl, link->output, link->input);
 
 	output_remove(link, link->output);
@@ -102,9 +102,13 @@ static void add_node(struct pw_impl_node *this, struct pw_impl_node *driver)
 	this->rt.driver_target.data = driver;
 	spa_list_append(&this->rt.target_list, &this->rt.driver_target.link);
 	rdriver = ++this->rt.driver_target.activation->state[0].required;
+	this->rt.driver_target.legacy_peer =
+		pw_node_activation_add_peer(driver->rt.activation, this->rt.activation);
 
 	spa_list_append(&driver->rt.target_list, &this->rt.target.link);
 	rnode = ++this->rt.activation->state[0].required;
+	this->rt.target.legacy_peer =
+		pw_node_activation_add_peer(this->rt.activation, driver->rt.activation);
 
 	pw_log_trace(NAME" %p: required driver:%d node:%d", this, rdriver, rnode);
 }
@@ -122,9 +126,12 @@ static void remove_node(struct pw_impl_node *this)
 
 	spa_list_remove(&this->rt.driver_target.link);
 	rdriver = --this->rt.driver_target.activation->state[0].required;
+	pw_node_activation_remove_peer(this->rt.driver_target.activation,
+			this->rt.driver_target.legacy_peer);
 
 	spa_list_remove(&this->rt.target.link);
 	rnode = --this->rt.activation->state[0].required;
+	pw_node_activation_remove_peer(this->rt.activation, this->rt.target.legacy_peer);
 
 	pw_log_trace(NAME" %p: required driver:%d node:%d", this, rdriver, rnode);
 }
@@ -135,6 +142,8 @@ do_node_remove(struct spa_loop *loop,
 {
 	struct pw_impl_node *this = user_data;
 	if (this->source.loop != NULL) {
+		if (this->context->data_pool)
+			pw_data_pool_sync(this->context->data_pool);
 		spa_loop_remove_source(loop, &this->source);
 		remove_node(this);
 	}
@@ -172,6 +181,8 @@ do_node_add(struct spa_loop *loop,
 	struct pw_impl_node *driver = this->driver_node;
 
 	if (this->source.loop == NULL) {
+		if (this->context->data_pool)
+			pw_data_pool_sync(this->context->data_pool);
 		spa_loop_add_source(loop, &this->source);
 		add_node(this, driver);
 	}
@@ -603,6 +614,7 @@ int pw_impl_node_register(struct pw_impl_node *this,
 	spa_list_for_each(port, &this->output_ports, link)
 		pw_impl_port_register(port, NULL);
 
+	pw_context_graph_changed(context, this);
 	pw_context_recalc_graph(context);
 
 	return 0;
@@ -697,11 +709,27 @@ static uint32_t flp2(uint32_t x)
 	return x - (x >> 1);
 }
 
+static uint32_t parse_latency(struct pw_impl_node *node, const char *str)
+{
+	uint32_t num, denom, quantum_size = 0;
+	uint64_t quantum;
+
+	if (sscanf(str, "%u/%u", &num, &denom) == 2 && denom != 0) {
+		quantum = (uint64_t)num * 48000 / denom;
+		quantum = SPA_MIN(quantum, (uint64_t)node->context->defaults.clock_max_quantum);
+		quantum_size = flp2(quantum);
+	}
+
+	pw_log_info(NAME" %p: latency '%s' quantum %u", node, str, quantum_size);
+	return quantum_size;
+}
+
 static void check_properties(struct pw_impl_node *node)
 {
 	struct impl *impl = SPA_CONTAINER_OF(node, struct impl, this);
 	const char *str;
 	bool driver, do_recalc = false;
+	uint32_t max_quantum_size;
 
 	if ((str = pw_properties_get(node->properties, PW_KEY_PRIORITY_MASTER))) {
 		node->priority_master = pw_properties_parse_int(str);
@@ -737,28 +765,33 @@ static void check_properties(struct pw_impl_node *node)
 				insert_driver(node->context, node);
 			else
 				spa_list_remove(&node->driver_link);
+			pw_context_graph_changed(node->context, node);
 		}
 	}
 
 	if ((str = pw_properties_get(node->properties, PW_KEY_NODE_LATENCY))) {
-		uint32_t num, denom;
-		pw_log_info(NAME" %p: latency '%s'", node, str);
-                if (sscanf(str, "%u/%u", &num, &denom) == 2 && denom != 0) {
-			uint32_t quantum_size;
+		uint32_t quantum_size = parse_latency(node, str);
 
-			quantum_size = flp2((num * 48000 / denom));
-			pw_log_info(NAME" %p: quantum %d", node, quantum_size);
-
-			if (quantum_size != node->quantum_size) {
-				node->quantum_size = quantum_size;
-				do_recalc |= node->active;
-			}
+		if (quantum_size > 0 && quantum_size != node->quantum_size) {
+			node->quantum_size = quantum_size;
+			do_recalc |= node->active;
 		}
 	}
+	if ((str = pw_properties_get(node->properties, PW_KEY_NODE_MAX_LATENCY)))
+		max_quantum_size = parse_latency(node, str);
+	else
+		max_quantum_size = 0;
+
+	if (max_quantum_size != node->max_quantum_size) {
+		node->max_quantum_size = max_quantum_size;
+		do_recalc |= node->active;
+	}
 	pw_log_debug(NAME" %p: driver:%d recalc:%d", node, node->driver, do_recalc);
 
-	if (do_recalc)
+	if (do_recalc) {
+		pw_context_graph_changed(node->context, node);
 		pw_context_recalc_graph(node->context);
+	}
 }
 
 static void dump_states(struct pw_impl_node *driver)
@@ -782,12 +815,15 @@ static void dump_states(struct pw_impl_node *driver)
 	}
 }
 
+static inline int process_node(void *data);
+
 static inline int resume_node(struct pw_impl_node *this, int status)
 {
-	struct pw_node_target *t;
+	struct pw_node_target *t, *run = NULL;
 	struct timespec ts;
 	struct pw_node_activation *activation = this->rt.activation;
 	struct spa_system *data_system = this->context->data_system;
+	struct pw_data_pool *pool = this->context->data_pool;
 	uint64_t nsec;
 
 	spa_system_clock_gettime(data_system, CLOCK_MONOTONIC, &ts);
@@ -808,9 +844,27 @@ static inline int resume_node(struct pw_impl_node *this, int status)
 		if (pw_node_activation_state_dec(state, 1)) {
 			t->activation->status = PW_NODE_ACTIVATION_TRIGGERED;
 			t->activation->signal_time = nsec;
-			t->signal(t->data);
+
+			if (pool == NULL || t->signal != process_node) {
+				t->signal(t->data);
+			} else if (t->node == t->node->driver_node) {
+				/* the driver always completes the cycle in the data loop */
+				if (pw_node_activation_wakeup(t->activation) &&
+				    SPA_UNLIKELY(spa_system_eventfd_write(data_system,
+								t->node->source.fd, 1) < 0))
+					pw_log_warn(NAME" %p: write failed %m", t->node);
+			} else {
+				/* keep one ready target for ourselves and hand the
+				 * others to the workers */
+				if (run != NULL)
+					pw_data_pool_push(pool, run);
+				run = t;
+			}
 		}
 	}
+	if (run != NULL)
+		run->signal(run->data);
+
 	return 0;
 }
 
@@ -974,7 +1028,8 @@ struct pw_impl_node *pw_context_create_node(struct pw_context *context,
 	this->activation = pw_mempool_alloc(this->context->pool,
 			PW_MEMBLOCK_FLAG_READWRITE |
 			PW_MEMBLOCK_FLAG_SEAL |
-			PW_MEMBLOCK_FLAG_MAP,
+			PW_MEMBLOCK_FLAG_MAP |
+			PW_MEMBLOCK_FLAG_ARENA,
 			SPA_DATA_MemFd, size);
 	if (this->activation == NULL) {
 		res = -errno;
@@ -1016,6 +1071,9 @@ struct pw_impl_node *pw_context_create_node(struct pw_context *context,
 	reset_position(this, &this->rt.activation->position);
 	this->rt.activation->sync_timeout = 5 * SPA_NSEC_PER_SEC;
 	this->rt.activation->sync_left = 0;
+	/* we wake up our targets with pw_node_activation_wakeup(), client-node
+	 * clears this for nodes that are scheduled by the client */
+	this->rt.activation->flags = PW_NODE_ACTIVATION_FLAG_WAKEUP;
 
 	check_properties(this);
 
@@ -1113,6 +1171,9 @@ static void node_info(void *data, const struct spa_node_info *info)
 	if (info->change_mask & SPA_NODE_CHANGE_MASK_PARAMS) {
 		uint32_t i;
 
+		/* the port formats could have changed */
+		pw_impl_node_reset_format_hash(node);
+
 		node->info.change_mask |= PW_NODE_CHANGE_MASK_PARAMS;
 		node->info.n_params = SPA_MIN(info->n_params, SPA_N_ELEMENTS(node->params));
 
@@ -1308,12 +1369,25 @@ static int node_ready(void *data, int status)
 		int sync_type, all_ready, update_sync, target_sync;
 		uint32_t owner[2], reposition_owner;
 
+		if (SPA_UNLIKELY(node->context->profiler != NULL)) {
+			struct spa_io_clock *clock = &a->position.clock;
+			pw_profiler_add_cycle(node->context->profiler, node);
+			node->rt.profile.position = clock->position;
+			node->rt.profile.quantum = clock->duration;
+			node->rt.profile.rate = clock->rate.denom;
+		}
+
 		if (a->state[0].pending != 0) {
 			pw_log_warn(NAME" %p: graph not finished", node);
 			dump_states(node);
 			node->rt.target.signal(node->rt.target.data);
 		}
 
+		/* workers can still be running nodes of the previous cycle,
+		 * let them finish before the pending counters are reset */
+		if (node->context->data_pool)
+			pw_data_pool_sync(node->context->data_pool);
+
 		sync_type = check_updates(node, &reposition_owner);
 		owner[0] = ATOMIC_LOAD(a->segment_owner[0]);
 		owner[1] = ATOMIC_LOAD(a->segment_owner[1]);
@@ -1486,13 +1560,21 @@ void pw_impl_node_destroy(struct pw_impl_node *node)
 	spa_list_consume(slave, &node->slave_list, slave_link) {
 		pw_log_debug(NAME" %p: reslave %p", impl, slave);
 		pw_impl_node_set_driver(slave, NULL);
+		pw_context_graph_changed(node->context, slave);
 	}
 
 	if (node->registered) {
 		spa_list_remove(&node->link);
 		if (node->driver)
 			spa_list_remove(&node->driver_link);
+		node->registered = false;
+	}
+	if (node->graph_changed) {
+		spa_list_remove(&node->graph_link);
+		node->graph_changed = false;
 	}
+	if (node->context->graph_target == node)
+		node->context->graph_target = NULL;
 
 	if (node->node) {
 		spa_hook_remove(&node->listener);
@@ -1622,9 +1704,23 @@ int pw_impl_node_set_param(struct pw_impl_node *node,
 {
 	pw_log_debug(NAME" %p: set_param %s flags:%08x param:%p", node,
 			spa_debug_type_find_name(spa_type_param, id), flags, param);
+	pw_impl_node_reset_format_hash(node);
 	return spa_node_set_param(node->node, id, flags, param);
 }
 
+/** Forget the EnumFormat hashes of all ports of \a node. The formats of a port
+ * often depend on the format or params of the other ports, so a change on
+ * one port invalidates them all. */
+void pw_impl_node_reset_format_hash(struct pw_impl_node *node)
+{
+	struct pw_impl_port *p;
+
+	spa_list_for_each(p, &node->input_ports, link)
+		p->enum_format_hash = 0;
+	spa_list_for_each(p, &node->output_ports, link)
+		p->enum_format_hash = 0;
+}
+
 SPA_EXPORT
 struct pw_impl_port *
 pw_impl_node_find_port(struct pw_impl_node *node, enum pw_direction direction, uint32_t port_id)
@@ -1814,8 +1910,10 @@ int pw_impl_node_set_active(struct pw_impl_node *node, bool active)
 		if (active)
 			node_activate(node);
 
-		if (node->registered)
+		if (node->registered) {
+			pw_context_graph_changed(node->context, node);
 			pw_context_recalc_graph(node->context);
+		}
 	}
 	return 0;
 }
@@ -27,6 +27,7 @@
 #include <errno.h>
 
 #include <spa/pod/parser.h>
+#include <spa/pod/filter.h>
 #include <spa/param/audio/format-utils.h>
 #include <spa/node/utils.h>
 #include <spa/utils/names.h>
@@ -289,7 +290,7 @@ static int notify_param(void *data, int seq, uint32_t id,
 		pw_log_debug(NAME" %p: resource %p notify param %d", port, resource, id);
 		pw_port_resource_param(resource, seq, id, index, next, param);
 	}
-	return 0;
+	return 1;
 }
 
 static void emit_params(struct pw_impl_port *port, uint32_t *changed_ids, uint32_t n_changed_ids)
@@ -321,6 +322,184 @@ static void emit_params(struct pw_impl_port *port, uint32_t *changed_ids, uint32
 	}
 }
 
+static void add_latency_param(struct pw_impl_port *port)
+{
+	uint32_t i;
+
+	for (i = 0; i < port->info.n_params; i++) {
+		if (port->info.params[i].id == SPA_PARAM_Latency)
+			return;
+	}
+	if (port->info.n_params < SPA_N_ELEMENTS(port->params)) {
+		port->params[port->info.n_params++] =
+			SPA_PARAM_INFO(SPA_PARAM_Latency, SPA_PARAM_INFO_READ);
+		port->info.change_mask |= PW_PORT_CHANGE_MASK_PARAMS;
+	}
+}
+
+static void emit_latency_changed(struct pw_impl_port *port)
+{
+	uint32_t i, id = SPA_PARAM_Latency;
+
+	for (i = 0; i < port->info.n_params; i++) {
+		if (port->info.params[i].id != SPA_PARAM_Latency)
+			continue;
+		port->info.params[i].flags ^= SPA_PARAM_INFO_SERIAL;
+		port->info.change_mask |= PW_PORT_CHANGE_MASK_PARAMS;
+	}
+	emit_params(port, &id, 1);
+	emit_info_changed(port);
+}
+
+static bool set_latency(struct pw_impl_port *port, const struct spa_latency_info *info)
+{
+	struct pw_impl_node *node = port->node;
+	uint8_t buffer[1024];
+	struct spa_pod_builder b = SPA_POD_BUILDER_INIT(buffer, sizeof(buffer));
+	struct spa_pod *param;
+
+	if (spa_latency_info_compare(&port->latency[info->direction], info) == 0)
+		return false;
+
+	port->latency[info->direction] = *info;
+
+	pw_log_debug(NAME" %p: %s latency %f-%f %u-%u %"PRIu64"-%"PRIu64, port,
+			info->direction == SPA_DIRECTION_INPUT ? "capture" : "playback",
+			info->min_quantum, info->max_quantum,
+			info->min_rate, info->max_rate,
+			info->min_ns, info->max_ns);
+
+	/* tell the node, the latency from the links is what it can use to
+	 * report its own latency, the other direction is what the graph
+	 * computed for the port when the node doesn't report it */
+	if (node != NULL) {
+		param = spa_latency_build(&b, SPA_PARAM_Latency, info);
+		spa_node_port_set_param(node->node,
+				port->direction, port->port_id,
+				SPA_PARAM_Latency, 0, param);
+	}
+	emit_latency_changed(port);
+
+	return true;
+}
+
+static bool recalc_latency(struct pw_impl_port *port, enum pw_direction direction);
+
+/* Tell the ports that use the latency of port in direction that it changed.
+ * The latency in the direction of the port goes to the ports on the other
+ * side of the node, the other direction goes to the peers of the links. */
+static void propagate_latency(struct pw_impl_port *port, enum pw_direction direction)
+{
+	struct pw_impl_node *node = port->node;
+	struct pw_impl_link *l;
+	struct pw_impl_port *p;
+
+	if (direction == port->direction) {
+		if (node == NULL)
+			return;
+		if (port->direction == PW_DIRECTION_INPUT) {
+			spa_list_for_each(p, &node->output_ports, link)
+				recalc_latency(p, direction);
+		} else {
+			spa_list_for_each(p, &node->input_ports, link)
+				recalc_latency(p, direction);
+		}
+	} else {
+		if (port->direction == PW_DIRECTION_INPUT) {
+			spa_list_for_each(l, &port->links, input_link)
+				recalc_latency(l->output, direction);
+		} else {
+			spa_list_for_each(l, &port->links, output_link)
+				recalc_latency(l->input, direction);
+		}
+	}
+}
+
+/* The latency in the direction of the port is combined from the peers of
+ * the links. The other direction is reported by the node or, when it
+ * doesn't, combined from the linked ports on the other side of the node.
+ * Only ports that changed propagate to their neighbours so a change
+ * only visits the part of the graph it affects. */
+static bool recalc_latency(struct pw_impl_port *port, enum pw_direction direction)
+{
+	struct pw_impl_node *node = port->node;
+	struct spa_latency_info info;
+	struct spa_list *ports;
+	struct pw_impl_link *l;
+	struct pw_impl_port *p;
+
+	spa_latency_info_combine_start(&info, (enum spa_direction) direction);
+
+	if (direction == port->direction) {
+		if (port->direction == PW_DIRECTION_INPUT) {
+			spa_list_for_each(l, &port->links, input_link)
+				spa_latency_info_combine(&info, &l->output->latency[direction]);
+		} else {
+			spa_list_for_each(l, &port->links, output_link)
+				spa_latency_info_combine(&info, &l->input->latency[direction]);
+		}
+	} else {
+		if (node == NULL || SPA_FLAG_IS_SET(port->node_latency, 1u << direction))
+			return false;
+
+		ports = direction == PW_DIRECTION_INPUT ?
+			&node->input_ports : &node->output_ports;
+		spa_list_for_each(p, ports, link) {
+			if (!spa_list_is_empty(&p->links))
+				spa_latency_info_combine(&info, &p->latency[direction]);
+		}
+	}
+	spa_latency_info_combine_finish(&info);
+
+	if (!set_latency(port, &info))
+		return false;
+
+	propagate_latency(port, direction);
+	return true;
+}
+
+/* read the latency the node reports for the port, this is the latency
+ * in the other direction of the port, the direction of the port comes
+ * from the links */
+static void update_node_latency(struct pw_impl_port *port)
+{
+	enum pw_direction direction = pw_direction_reverse(port->direction);
+	uint32_t mask = 1u << direction;
+	struct spa_latency_info info;
+	struct spa_pod *param;
+	uint8_t buffer[1024];
+	struct spa_pod_builder b;
+	uint32_t index = 0;
+	bool found = false;
+
+	while (!found) {
+		spa_pod_builder_init(&b, buffer, sizeof(buffer));
+		if (spa_node_port_enum_params_sync(port->node->node,
+				port->direction, port->port_id,
+				SPA_PARAM_Latency, &index, NULL, &param, &b) != 1)
+			break;
+		found = spa_latency_parse(param, &info) >= 0 &&
+			info.direction == (enum spa_direction) direction;
+	}
+
+	if (found) {
+		SPA_FLAG_SET(port->node_latency, mask);
+		if (set_latency(port, &info))
+			propagate_latency(port, direction);
+	} else if (SPA_FLAG_IS_SET(port->node_latency, mask)) {
+		SPA_FLAG_CLEAR(port->node_latency, mask);
+		recalc_latency(port, direction);
+	}
+}
+
+void pw_impl_port_recalc_latency(struct pw_impl_port *port)
+{
+	/* the linked state of the port could have changed, the other side of
+	 * the node needs an update even when our latency stays the same */
+	if (!recalc_latency(port, port->direction))
+		propagate_latency(port, port->direction);
+}
+
 static void update_info(struct pw_impl_port *port, const struct spa_port_info *info)
 {
 	uint32_t changed_ids[MAX_PARAMS], n_changed_ids = 0;
@@ -334,11 +513,26 @@ static void update_info(struct pw_impl_port *port, const struct spa_port_info *i
 	if (info->change_mask & SPA_PORT_CHANGE_MASK_PARAMS) {
 		uint32_t i;
 
+		/* the formats could have changed */
+		if (port->node != NULL)
+			pw_impl_node_reset_format_hash(port->node);
+		else
+			port->enum_format_hash = 0;
+
 		port->info.change_mask |= PW_PORT_CHANGE_MASK_PARAMS;
 		port->info.n_params = SPA_MIN(info->n_params, SPA_N_ELEMENTS(port->params));
 
 		for (i = 0; i < port->info.n_params; i++) {
-			if (port->info.params[i].flags == info->params[i].flags)
+			/* the latency is the one of the graph, we keep our own
+			 * param info for it and reread the node latency below */
+			if (info->params[i].id == SPA_PARAM_Latency) {
+				if (port->info.params[i].id != SPA_PARAM_Latency)
+					port->info.params[i] = SPA_PARAM_INFO(SPA_PARAM_Latency,
+							SPA_PARAM_INFO_READ);
+				continue;
+			}
+			if (port->info.params[i].id == info->params[i].id &&
+			    port->info.params[i].flags == info->params[i].flags)
 				continue;
 
 			if (info->params[i].flags & SPA_PARAM_INFO_READ)
@@ -346,6 +540,10 @@ static void update_info(struct pw_impl_port *port, const struct spa_port_info *i
 
 			port->info.params[i] = info->params[i];
 		}
+		add_latency_param(port);
+
+		if (port->node != NULL)
+			update_node_latency(port);
 	}
 
 	if (info->change_mask & SPA_NODE_CHANGE_MASK_PARAMS)
@@ -406,6 +604,9 @@ struct pw_impl_port *pw_context_create_port(
 	this->info.change_mask = PW_PORT_CHANGE_MASK_PROPS;
 	this->info.props = &this->properties->dict;
 
+	this->latency[SPA_DIRECTION_INPUT] = SPA_LATENCY_INFO(SPA_DIRECTION_INPUT);
+	this->latency[SPA_DIRECTION_OUTPUT] = SPA_LATENCY_INFO(SPA_DIRECTION_OUTPUT);
+
 	spa_list_init(&this->links);
 	spa_list_init(&this->mix_list);
 	spa_list_init(&this->rt.mix_list);
@@ -432,6 +633,7 @@ struct pw_impl_port *pw_context_create_port(
 
 	if (info)
 		update_info(this, info);
+	add_latency_param(this);
 
 	return this;
 
@@ -616,6 +818,9 @@ static int do_add_port(struct spa_loop *loop,
 {
         struct pw_impl_port *this = user_data;
 
+	if (this->node->context->data_pool)
+		pw_data_pool_sync(this->node->context->data_pool);
+
 	if (this->direction == PW_DIRECTION_INPUT)
 		spa_list_append(&this->node->rt.input_mix, &this->rt.node_link);
 	else
@@ -663,7 +868,7 @@ static int reply_param(void *data, int seq, uint32_t id,
 	pw_log_debug(NAME" %p: resource %p reply param %u %u %u", d->port,
 			resource, id, index, next);
 	pw_port_resource_param(resource, seq, id, index, next, param);
-	return 0;
+	return 1;
 }
 
 static int port_enum_params(void *object, int seq, uint32_t id, uint32_t index, uint32_t num,
@@ -899,6 +1104,10 @@ int pw_impl_port_add(struct pw_impl_port *port, struct pw_impl_node *node)
 		pw_impl_port_update_state(port, PW_IMPL_PORT_STATE_CONFIGURE, NULL);
 
 	pw_impl_node_emit_port_added(node, port);
+
+	update_node_latency(port);
+	recalc_latency(port, pw_direction_reverse(port->direction));
+
 	emit_info_changed(port);
 
 	return 0;
@@ -920,6 +1129,9 @@ static int do_remove_port(struct spa_loop *loop,
 {
         struct pw_impl_port *this = user_data;
 
+	if (this->node->context->data_pool)
+		pw_data_pool_sync(this->node->context->data_pool);
+
 	spa_list_remove(&this->rt.node_link);
 
 	return 0;
@@ -1017,6 +1229,33 @@ static void result_port_params(void *data, int seq, int res, uint32_t type, cons
 	}
 }
 
+static int port_enum_latency(struct pw_impl_port *port,
+			   int seq, uint32_t index, uint32_t max,
+			   const struct spa_pod *filter,
+			   int (*callback) (void *data, int seq,
+					    uint32_t id, uint32_t index, uint32_t next,
+					    struct spa_pod *param),
+			   void *data)
+{
+	uint8_t buffer[1024];
+	struct spa_pod_builder b;
+	struct spa_pod *param;
+	uint32_t count = 0;
+	int res;
+
+	for (; index < SPA_N_ELEMENTS(port->latency) && count < max; index++) {
+		spa_pod_builder_init(&b, buffer, sizeof(buffer));
+		param = spa_latency_build(&b, SPA_PARAM_Latency, &port->latency[index]);
+		if (spa_pod_filter(&b, &param, param, filter) < 0)
+			continue;
+
+		if ((res = callback(data, seq, SPA_PARAM_Latency, index, index + 1, param)) <= 0)
+			return res;
+		count++;
+	}
+	return 0;
+}
+
 int pw_impl_port_for_each_param(struct pw_impl_port *port,
 			   int seq,
 			   uint32_t param_id,
@@ -1043,6 +1282,10 @@ int pw_impl_port_for_each_param(struct pw_impl_port *port,
 			spa_debug_type_find_name(spa_type_param, param_id),
 			index, max);
 
+	/* the latency is the one of the graph, not only the node */
+	if (param_id == SPA_PARAM_Latency)
+		return port_enum_latency(port, seq, index, max, filter, callback, data);
+
 	spa_zero(listener);
 	spa_node_add_listener(node->node, &listener, &node_events, &user_data);
 	res = spa_node_port_enum_params(node->node, seq,
@@ -1140,6 +1383,9 @@ int pw_impl_port_set_param(struct pw_impl_port *port, uint32_t id, uint32_t flag
 			port->direction, port->port_id,
 			spa_debug_type_find_name(spa_type_param, id), res, spa_strerror(res));
 
+	/* the formats of the other ports of the node can depend on this param */
+	pw_impl_node_reset_format_hash(node);
+
 	/* set the parameters on all ports of the mixer node if possible */
 	if (res >= 0) {
 		struct pw_impl_port_mix *mix;
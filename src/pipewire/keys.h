@@ -52,6 +52,9 @@ extern "C" {
  * string describing the protocol used by the client to access
  * PipeWire */
 #define PW_KEY_PROTOCOL			"pipewire.protocol"
+#define PW_KEY_PROTOCOL_OOB_SIZE	"pipewire.protocol.oob-size"	/**< minimum payload size of messages
+								  *  that are passed in a memfd, 0 or
+								  *  unset disables */
 #define PW_KEY_ACCESS			"pipewire.access"	/**< how the client access is controlled */
 
 /** Various keys related to the identity of a client process and its security.
@@ -71,6 +74,24 @@ extern "C" {
 
 /* context */
 #define PW_KEY_CONTEXT_PROFILE_MODULES	"context.profile.modules"	/**< a context profile for modules */
+#define PW_KEY_CONTEXT_DATA_THREADS	"context.data-threads"		/**< number of extra worker threads
+								  *  to run graph nodes in parallel,
+								  *  default 0 (disabled) */
+#define PW_KEY_CONTEXT_DATA_THREADS_CPU	"context.data-threads.cpu"	/**< pin the worker threads to
+								  *  consecutive cpus, starting
+								  *  from this one */
+#define PW_KEY_CONTEXT_DATA_THREADS_RT_PRIO "context.data-threads.rt-prio" /**< realtime priority of
+								  *  the worker threads */
+#define PW_KEY_CONTEXT_PROFILER		"context.profiler"		/**< number of node timing records
+								  *  to keep in shared memory for
+								  *  profilers, default 0 (disabled) */
+
+/* mem */
+#define PW_KEY_MEM_ARENA_SIZE		"mem.arena-size"		/**< size of the shared fds that small
+								  *  memory blocks are allocated from.
+								  *  All blocks in an fd are accessible
+								  *  to clients that get one of them,
+								  *  default 0 (disabled) */
 
 /* core */
 #define PW_KEY_CORE_ID			"core.id"		/**< the core id */
@@ -137,6 +158,11 @@ extern "C" {
 								  *  node/session */
 #define PW_KEY_NODE_LATENCY		"node.latency"		/**< the requested latency of the node as
 								  *  a fraction. Ex: 128/48000 */
+#define PW_KEY_NODE_MAX_LATENCY		"node.max-latency"	/**< the maximum latency the node can
+								  *  handle as a fraction. When all nodes
+								  *  of a graph can handle a higher latency,
+								  *  the quantum grows to save power.
+								  *  Ex: 8192/48000 */
 #define PW_KEY_NODE_DONT_RECONNECT	"node.dont-reconnect"	/**< don't reconnect this node */
 #define PW_KEY_NODE_ALWAYS_PROCESS	"node.always-process"	/**< process even when unlinked */
 #define PW_KEY_NODE_PAUSE_ON_IDLE	"node.pause-on-idle"	/**< pause the node when idle */
@@ -163,6 +189,8 @@ extern "C" {
 #define PW_KEY_LINK_PASSIVE		"link.passive"		/**< indicate that a link is passive and
 								  *  does not cause the graph to be
 								  *  runnable. */
+#define PW_KEY_LINK_SETUP_TIME		"link.setup-time"	/**< time in microseconds it took to
+								  *  negotiate the format and buffers */
 /** device properties */
 #define PW_KEY_DEVICE_ID		"device.id"		/**< device id */
 #define PW_KEY_DEVICE_NAME		"device.name"		/**< device name */
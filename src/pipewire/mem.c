@@ -37,6 +37,8 @@
 #include <spa/utils/list.h>
 #include <spa/buffer/buffer.h>
 
+#include <pipewire/array.h>
+#include <pipewire/keys.h>
 #include <pipewire/log.h>
 #include <pipewire/map.h>
 #include <pipewire/mem.h>
@@ -105,6 +107,29 @@ struct mempool {
 	struct pw_map map;
 	struct spa_list blocks;
 	uint32_t pagesize;
+
+	uint32_t arena_size;
+	struct spa_list arenas;
+
+	/* sorted arrays for the lookups */
+	struct pw_array ptr_index;	/* struct mapping *, on ptr */
+	struct pw_array fd_index;	/* struct memblock *, on fd */
+	struct pw_array tag_index;	/* struct memmap *, on tag */
+};
+
+#define ARENA_CLASSES	8
+
+/* A large sealed memfd that small blocks are carved out of. Blocks have a
+ * size of pagesize << class. The bookkeeping is not in the shared memory
+ * because clients can write to it. */
+struct arena {
+	struct spa_list link;
+	int fd;
+	void *ptr;
+	uint32_t size;
+	uint32_t used;
+	uint32_t n_blocks;
+	struct pw_array free[ARENA_CLASSES];	/* free offsets */
 };
 
 struct memblock {
@@ -112,6 +137,9 @@ struct memblock {
 	struct spa_list link;
 	struct spa_list mappings;
 	struct spa_list maps;
+	struct arena *arena;
+	uint32_t arena_offset;
+	uint32_t arena_class;
 };
 
 struct mapping {
@@ -120,6 +148,7 @@ struct mapping {
 	uint32_t offset;
 	uint32_t size;
 	unsigned int do_unmap:1;
+	unsigned int twice:1;
 	struct spa_list link;
 	void *ptr;
 };
@@ -130,10 +159,312 @@ struct memmap {
 	struct spa_list link;
 };
 
+typedef int (*index_cmp_func_t) (const void *item, const void *key, size_t size);
+
+/* first position with an item >= key */
+static size_t index_lower(struct pw_array *idx, index_cmp_func_t cmp,
+		const void *key, size_t size)
+{
+	void **items = idx->data;
+	size_t lo = 0, hi = pw_array_get_len(idx, void *);
+
+	while (lo < hi) {
+		size_t mid = (lo + hi) / 2;
+		if (cmp(items[mid], key, size) < 0)
+			lo = mid + 1;
+		else
+			hi = mid;
+	}
+	return lo;
+}
+
+static int index_insert(struct pw_array *idx, index_cmp_func_t cmp,
+		void *item, const void *key, size_t size)
+{
+	size_t pos = index_lower(idx, cmp, key, size);
+	size_t len = pw_array_get_len(idx, void *);
+	void **items;
+
+	if (pw_array_add(idx, sizeof(void *)) == NULL)
+		return -errno;
+
+	items = idx->data;
+	memmove(&items[pos + 1], &items[pos], (len - pos) * sizeof(void *));
+	items[pos] = item;
+	return 0;
+}
+
+static void index_remove(struct pw_array *idx, index_cmp_func_t cmp,
+		void *item, const void *key, size_t size)
+{
+	size_t pos = index_lower(idx, cmp, key, size);
+	size_t len = pw_array_get_len(idx, void *);
+	void **items = idx->data;
+
+	while (pos < len && items[pos] != item)
+		pos++;
+	if (pos == len)
+		return;
+
+	memmove(&items[pos], &items[pos + 1], (len - pos - 1) * sizeof(void *));
+	idx->size -= sizeof(void *);
+}
+
+static int mapping_cmp(const void *item, const void *key, size_t size)
+{
+	const struct mapping *m = item;
+	return m->ptr < key ? -1 : m->ptr > key ? 1 : 0;
+}
+
+static int block_cmp(const void *item, const void *key, size_t size)
+{
+	const struct memblock *b = item;
+	int fd = *(const int*)key;
+	return b->this.fd < fd ? -1 : b->this.fd > fd ? 1 : 0;
+}
+
+static int memmap_cmp(const void *item, const void *key, size_t size)
+{
+	const struct memmap *mm = item;
+	return memcmp(mm->this.tag, key, size);
+}
+
+static int mapping_insert(struct memblock *b, struct mapping *m)
+{
+	struct mempool *p = SPA_CONTAINER_OF(b->this.pool, struct mempool, this);
+	int res;
+
+	if ((res = index_insert(&p->ptr_index, mapping_cmp, m, m->ptr, 0)) < 0)
+		return res;
+	spa_list_append(&b->mappings, &m->link);
+	return 0;
+}
+
+static int block_insert(struct mempool *p, struct memblock *b)
+{
+	int res;
+
+	if (b->this.fd >= 0 &&
+	    (res = index_insert(&p->fd_index, block_cmp, b, &b->this.fd, 0)) < 0)
+		return res;
+
+	b->this.id = pw_map_insert_new(&p->map, b);
+	if (b->this.id == SPA_ID_INVALID) {
+		res = -errno;
+		if (b->this.fd >= 0)
+			index_remove(&p->fd_index, block_cmp, b, &b->this.fd, 0);
+		return res;
+	}
+	spa_list_append(&p->blocks, &b->link);
+	return 0;
+}
+
+static void block_remove(struct mempool *p, struct memblock *b)
+{
+	pw_map_remove(&p->map, b->this.id);
+	spa_list_remove(&b->link);
+	if (b->this.fd >= 0)
+		index_remove(&p->fd_index, block_cmp, b, &b->this.fd, 0);
+}
+
+static int create_fd(struct mempool *pool, size_t size, bool seal)
+{
+	int fd, res;
+
+#ifdef USE_MEMFD
+	fd = memfd_create("pipewire-memfd", MFD_CLOEXEC | MFD_ALLOW_SEALING);
+	if (fd == -1) {
+		res = -errno;
+		pw_log_error(NAME" %p: Failed to create memfd: %m", pool);
+		return res;
+	}
+#else
+	char filename[] = "/dev/shm/pipewire-tmpfile.XXXXXX";
+	fd = mkostemp(filename, O_CLOEXEC);
+	if (fd == -1) {
+		res = -errno;
+		pw_log_error(NAME" %p: Failed to create temporary file: %m", pool);
+		return res;
+	}
+	unlink(filename);
+#endif
+
+	if (ftruncate(fd, size) < 0) {
+		res = -errno;
+		pw_log_warn(NAME" %p: Failed to truncate temporary file: %m", pool);
+		close(fd);
+		return res;
+	}
+#ifdef USE_MEMFD
+	if (seal) {
+		unsigned int seals = F_SEAL_GROW | F_SEAL_SHRINK | F_SEAL_SEAL;
+		if (fcntl(fd, F_ADD_SEALS, seals) == -1) {
+			pw_log_warn(NAME" %p: Failed to add seals: %m", pool);
+		}
+	}
+#endif
+	return fd;
+}
+
+static struct arena *arena_new(struct mempool *impl)
+{
+	struct arena *a;
+	uint32_t i;
+	int res;
+
+	a = calloc(1, sizeof(struct arena));
+	if (a == NULL)
+		return NULL;
+
+	a->size = impl->arena_size;
+	if ((a->fd = create_fd(impl, a->size, true)) < 0) {
+		res = a->fd;
+		goto error_free;
+	}
+	a->ptr = mmap(NULL, a->size, PROT_READ | PROT_WRITE, MAP_SHARED, a->fd, 0);
+	if (a->ptr == MAP_FAILED) {
+		res = -errno;
+		pw_log_error(NAME" %p: Failed to mmap arena fd:%d size:%u: %m",
+				impl, a->fd, a->size);
+		close(a->fd);
+		goto error_free;
+	}
+	for (i = 0; i < ARENA_CLASSES; i++)
+		pw_array_init(&a->free[i], 16 * sizeof(uint32_t));
+
+	spa_list_append(&impl->arenas, &a->link);
+
+	pw_log_debug(NAME" %p: new arena %p fd:%d size:%u", impl, a, a->fd, a->size);
+
+	return a;
+
+error_free:
+	free(a);
+	errno = -res;
+	return NULL;
+}
+
+static void arena_destroy(struct mempool *impl, struct arena *a)
+{
+	uint32_t i;
+
+	pw_log_debug(NAME" %p: destroy arena %p fd:%d", impl, a, a->fd);
+
+	spa_list_remove(&a->link);
+	munmap(a->ptr, a->size);
+	close(a->fd);
+	for (i = 0; i < ARENA_CLASSES; i++)
+		pw_array_clear(&a->free[i]);
+	free(a);
+}
+
+/* size class for a block or SPA_ID_INVALID when it does not fit in an arena */
+static uint32_t arena_class(struct mempool *impl, size_t size)
+{
+	uint32_t class = 0;
+
+	while (((size_t)impl->pagesize << class) < size)
+		class++;
+
+	if (class >= ARENA_CLASSES || (impl->pagesize << class) > impl->arena_size / 4)
+		return SPA_ID_INVALID;
+
+	return class;
+}
+
+static int arena_alloc(struct mempool *impl, struct memblock *b, uint32_t class)
+{
+	uint32_t size = impl->pagesize << class, offset, n, *o;
+	struct arena *a;
+	struct mapping *m;
+	int res;
+
+	/* take a free block of the class first, then new space */
+	spa_list_for_each(a, &impl->arenas, link) {
+		if ((n = pw_array_get_len(&a->free[class], uint32_t)) > 0) {
+			offset = *pw_array_get_unchecked(&a->free[class], n - 1, uint32_t);
+			a->free[class].size -= sizeof(uint32_t);
+			goto found;
+		}
+	}
+	spa_list_for_each(a, &impl->arenas, link) {
+		if (a->size - a->used >= size)
+			goto allocate;
+	}
+	if ((a = arena_new(impl)) == NULL)
+		return -errno;
+allocate:
+	offset = a->used;
+	a->used += size;
+found:
+	m = calloc(1, sizeof(struct mapping));
+	if (m == NULL) {
+		res = -errno;
+		goto error_free_offset;
+	}
+	/* the block is mapped as part of the arena */
+	m->ptr = SPA_MEMBER(a->ptr, offset, void);
+	m->block = b;
+	m->offset = offset;
+	m->size = size;
+	if ((res = mapping_insert(b, m)) < 0) {
+		free(m);
+		goto error_free_offset;
+	}
+
+	/* freed blocks and the space of a rewound arena contain old data,
+	 * hand out cleared memory like a new memfd */
+	memset(m->ptr, 0, size);
+
+	a->n_blocks++;
+
+	b->arena = a;
+	b->arena_offset = offset;
+	b->arena_class = class;
+	b->this.fd = a->fd;
+	b->this.flags |= PW_MEMBLOCK_FLAG_DONT_CLOSE;
+	b->this.ref++;
+
+	pw_log_debug(NAME" %p: arena %p fd:%d offset:%u size:%u blocks:%u", impl,
+			a, a->fd, offset, size, a->n_blocks);
+
+	return 0;
+
+error_free_offset:
+	if ((o = pw_array_add(&a->free[class], sizeof(uint32_t))) != NULL)
+		*o = offset;
+	return res;
+}
+
+static void arena_free(struct mempool *impl, struct memblock *b)
+{
+	struct arena *a = b->arena;
+	uint32_t *o, i;
+
+	pw_log_debug(NAME" %p: arena %p free offset:%u blocks:%u", impl,
+			a, b->arena_offset, a->n_blocks);
+
+	if (--a->n_blocks == 0) {
+		/* keep one arena around */
+		if (a->link.next != &impl->arenas || a->link.prev != &impl->arenas) {
+			arena_destroy(impl, a);
+			return;
+		}
+		a->used = 0;
+		for (i = 0; i < ARENA_CLASSES; i++)
+			pw_array_reset(&a->free[i]);
+		return;
+	}
+	if ((o = pw_array_add(&a->free[b->arena_class], sizeof(uint32_t))) != NULL)
+		*o = b->arena_offset;
+}
+
+SPA_EXPORT
 struct pw_mempool *pw_mempool_new(struct pw_properties *props)
 {
 	struct mempool *impl;
 	struct pw_mempool *this;
+	const char *str;
 
 	impl = calloc(1, sizeof(struct mempool));
 	if (impl == NULL)
@@ -144,11 +475,18 @@ struct pw_mempool *pw_mempool_new(struct pw_properties *props)
 
 	impl->pagesize = sysconf(_SC_PAGESIZE);
 
-	pw_log_debug(NAME" %p: new", this);
+	if (props && (str = pw_properties_get(props, PW_KEY_MEM_ARENA_SIZE)) != NULL)
+		impl->arena_size = SPA_ROUND_UP_N(pw_properties_parse_int(str), impl->pagesize);
+
+	pw_log_debug(NAME" %p: new arena-size:%u", this, impl->arena_size);
 
 	spa_hook_list_init(&impl->listener_list);
 	pw_map_init(&impl->map, 64, 64);
 	spa_list_init(&impl->blocks);
+	spa_list_init(&impl->arenas);
+	pw_array_init(&impl->ptr_index, 64);
+	pw_array_init(&impl->fd_index, 64);
+	pw_array_init(&impl->tag_index, 64);
 
 	spa_list_append(&_mempools, &impl->link);
 
@@ -164,9 +502,11 @@ void pw_mempool_clear(struct pw_mempool *pool)
 		pw_memblock_free(&b->this);
 }
 
+SPA_EXPORT
 void pw_mempool_destroy(struct pw_mempool *pool)
 {
 	struct mempool *impl = SPA_CONTAINER_OF(pool, struct mempool, this);
+	struct arena *a;
 
 	pw_log_debug(NAME" %p: destroy", pool);
 
@@ -176,6 +516,12 @@ void pw_mempool_destroy(struct pw_mempool *pool)
 
 	spa_list_remove(&impl->link);
 
+	spa_list_consume(a, &impl->arenas, link)
+		arena_destroy(impl, a);
+
+	pw_array_clear(&impl->ptr_index);
+	pw_array_clear(&impl->fd_index);
+	pw_array_clear(&impl->tag_index);
 	pw_map_clear(&impl->map);
 	if (pool->props)
 		pw_properties_free(pool->props);
@@ -192,67 +538,6 @@ void pw_mempool_add_listener(struct pw_mempool *pool,
 	spa_hook_list_append(&impl->listener_list, listener, events, data);
 }
 
-#if 0
-/** Map a memblock
- * \param mem a memblock
- * \return 0 on success, < 0 on error
- * \memberof pw_memblock
- */
-SPA_EXPORT
-int pw_memblock_map_old(struct pw_memblock *mem)
-{
-	if (mem->ptr != NULL)
-		return 0;
-
-	if (mem->flags & PW_MEMBLOCK_FLAG_MAP_READWRITE) {
-		int prot = 0;
-
-		if (mem->flags & PW_MEMBLOCK_FLAG_MAP_READ)
-			prot |= PROT_READ;
-		if (mem->flags & PW_MEMBLOCK_FLAG_MAP_WRITE)
-			prot |= PROT_WRITE;
-
-		if (mem->flags & PW_MEMBLOCK_FLAG_MAP_TWICE) {
-			void *ptr, *wrap;
-
-			mem->ptr =
-			    mmap(NULL, mem->size << 1, PROT_NONE, MAP_ANONYMOUS | MAP_PRIVATE, -1,
-				 0);
-			if (mem->ptr == MAP_FAILED)
-				return -errno;
-
-			ptr =
-			    mmap(mem->ptr, mem->size, prot, MAP_FIXED | MAP_SHARED, mem->fd,
-				 mem->offset);
-			if (ptr != mem->ptr) {
-				munmap(mem->ptr, mem->size << 1);
-				return -ENOMEM;
-			}
-
-			wrap = SPA_MEMBER(mem->ptr, mem->size, void);
-
-			ptr =
-			    mmap(wrap, mem->size, prot, MAP_FIXED | MAP_SHARED,
-				 mem->fd, mem->offset);
-			if (ptr != wrap) {
-				munmap(mem->ptr, mem->size << 1);
-				return -ENOMEM;
-			}
-		} else {
-			mem->ptr = mmap(NULL, mem->size, prot, MAP_SHARED, mem->fd, 0);
-			if (mem->ptr == MAP_FAILED)
-				return -errno;
-		}
-	} else {
-		mem->ptr = NULL;
-	}
-
-	pw_log_debug(NAME" %p: map to %p", mem, mem->ptr);
-
-	return 0;
-}
-#endif
-
 static struct mapping * memblock_find_mapping(struct memblock *b,
 		uint32_t flags, uint32_t offset, uint32_t size)
 {
@@ -260,6 +545,9 @@ static struct mapping * memblock_find_mapping(struct memblock *b,
 	struct pw_mempool *pool = b->this.pool;
 
 	spa_list_for_each(m, &b->mappings, link) {
+		if ((flags & PW_MEMMAP_FLAG_TWICE) &&
+		    (!m->twice || m->offset != offset || m->size != size))
+			continue;
 		if (m->offset <= offset && (m->offset + m->size) >= (offset + size)) {
 			pw_log_debug(NAME" %p: found %p id:%d fd:%d offs:%d size:%d ref:%d",
 					pool, &b->this, b->this.id, b->this.fd,
@@ -270,12 +558,40 @@ static struct mapping * memblock_find_mapping(struct memblock *b,
 	return NULL;
 }
 
+/* Reserve twice the size of address space and map the area in both halves
+ * so that accesses running past the end continue at the start. */
+static void *mmap_twice(int fd, int prot, int fl, uint32_t offset, uint32_t size)
+{
+	void *base, *ptr;
+	int res;
+
+	base = mmap(NULL, (size_t)size << 1, PROT_NONE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+	if (base == MAP_FAILED)
+		return MAP_FAILED;
+
+	ptr = mmap(base, size, prot, fl | MAP_FIXED, fd, offset);
+	if (ptr == MAP_FAILED)
+		goto error;
+
+	ptr = mmap(SPA_MEMBER(base, size, void), size, prot, fl | MAP_FIXED, fd, offset);
+	if (ptr == MAP_FAILED)
+		goto error;
+
+	return base;
+error:
+	res = errno;
+	munmap(base, (size_t)size << 1);
+	errno = res;
+	return MAP_FAILED;
+}
+
 static struct mapping * memblock_map(struct memblock *b,
 		enum pw_memmap_flags flags, uint32_t offset, uint32_t size)
 {
 	struct mempool *p = SPA_CONTAINER_OF(b->this.pool, struct mempool, this);
 	struct mapping *m;
 	void *ptr;
+	int res;
 	int prot = 0, fl = 0;
 
 	if (flags & PW_MEMMAP_FLAG_READ)
@@ -288,14 +604,11 @@ static struct mapping * memblock_map(struct memblock *b,
 	else
 		fl |= MAP_SHARED;
 
-	if (flags & PW_MEMMAP_FLAG_TWICE) {
-		pw_log_error(NAME" %p: implement me PW_MEMMAP_FLAG_TWICE", p);
-		errno = ENOTSUP;
-		return NULL;
-	}
-
+	if (flags & PW_MEMMAP_FLAG_TWICE)
+		ptr = mmap_twice(b->this.fd, prot, fl, offset, size);
+	else
+		ptr = mmap(NULL, size, prot, fl, b->this.fd, offset);
 
-	ptr = mmap(NULL, size, prot, fl, b->this.fd, offset);
 	if (ptr == MAP_FAILED) {
 		pw_log_error(NAME" %p: Failed to mmap memory fd:%d offset:%u size:%u: %m",
 				p, b->this.fd, offset, size);
@@ -304,21 +617,30 @@ static struct mapping * memblock_map(struct memblock *b,
 
 	m = calloc(1, sizeof(struct mapping));
 	if (m == NULL) {
-		munmap(ptr, size);
-		return NULL;
+		res = -errno;
+		goto error_unmap;
 	}
 	m->ptr = ptr;
 	m->do_unmap = true;
+	m->twice = !!(flags & PW_MEMMAP_FLAG_TWICE);
 	m->block = b;
 	m->offset = offset;
 	m->size = size;
+	if ((res = mapping_insert(b, m)) < 0) {
+		free(m);
+		goto error_unmap;
+	}
 	b->this.ref++;
-	spa_list_append(&b->mappings, &m->link);
 
         pw_log_debug(NAME" %p: fd:%d map:%p ptr:%p (%d %d)", p,
 			b->this.fd, m, m->ptr, offset, size);
 
 	return m;
+
+error_unmap:
+	munmap(ptr, flags & PW_MEMMAP_FLAG_TWICE ? (size_t)size << 1 : size);
+	errno = -res;
+	return NULL;
 }
 
 static void mapping_unmap(struct mapping *m)
@@ -330,7 +652,8 @@ static void mapping_unmap(struct mapping *m)
 			p, m, b->this.fd, m->ptr, m->size, b->this.ref);
 
 	if (m->do_unmap)
-		munmap(m->ptr, m->size);
+		munmap(m->ptr, m->twice ? (size_t)m->size << 1 : m->size);
+	index_remove(&p->ptr_index, mapping_cmp, m, m->ptr, 0);
 	spa_list_remove(&m->link);
 	free(m);
 
@@ -346,9 +669,21 @@ struct pw_memmap * pw_memblock_map(struct pw_memblock *block,
 	struct mapping *m;
 	struct memmap *mm;
 	struct pw_map_range range;
+	int res;
 
 	pw_map_range_init(&range, offset, size, p->pagesize);
 
+	if (flags & PW_MEMMAP_FLAG_TWICE) {
+		/* the second copy must start right after the requested area */
+		if (range.start != 0 || range.size != size ||
+		    (flags & PW_MEMMAP_FLAG_PRIVATE)) {
+			pw_log_error(NAME" %p: can't map fd:%d offset:%u size:%u twice",
+					p, block->fd, offset, size);
+			errno = EINVAL;
+			return NULL;
+		}
+	}
+
 	m = memblock_find_mapping(b, flags, range.offset, range.size);
 	if (m == NULL)
 		m = memblock_map(b, flags, range.offset, range.size);
@@ -368,10 +703,18 @@ struct pw_memmap * pw_memblock_map(struct pw_memblock *block,
 	mm->this.flags = flags;
 	mm->this.offset = offset;
 	mm->this.size = size;
-	mm->this.ptr = SPA_MEMBER(m->ptr, range.start, void);
+	mm->this.ptr = SPA_MEMBER(m->ptr, range.offset - m->offset + range.start, void);
 	if (tag)
 		memcpy(mm->this.tag, tag, sizeof(mm->this.tag));
 
+	if ((res = index_insert(&p->tag_index, memmap_cmp, mm,
+					mm->this.tag, sizeof(mm->this.tag))) < 0) {
+		free(mm);
+		if (--m->ref == 0)
+			mapping_unmap(m);
+		errno = -res;
+		return NULL;
+	}
 	spa_list_append(&b->maps, &mm->link);
 
         pw_log_debug(NAME" %p: map:%p fd:%d ptr:%p (%d %d) mapping:%p ref:%d", p,
@@ -406,6 +749,7 @@ int pw_memmap_free(struct pw_memmap *map)
         pw_log_debug(NAME" %p: map:%p fd:%d ptr:%p mapping:%p ref:%d", p,
 			&mm->this, b->this.fd, mm->this.ptr, m, m->ref);
 
+	index_remove(&p->tag_index, memmap_cmp, mm, mm->this.tag, sizeof(mm->this.tag));
 	spa_list_remove(&mm->link);
 
 	if (--m->ref == 0)
@@ -442,6 +786,8 @@ struct pw_memblock * pw_mempool_alloc(struct pw_mempool *pool, enum pw_memblock_
 {
 	struct mempool *impl = SPA_CONTAINER_OF(pool, struct mempool, this);
 	struct memblock *b;
+	struct mapping *m;
+	uint32_t class = SPA_ID_INVALID;
 	int res;
 
 	b = calloc(1, sizeof(struct memblock));
@@ -456,57 +802,56 @@ struct pw_memblock * pw_mempool_alloc(struct pw_mempool *pool, enum pw_memblock_
 	spa_list_init(&b->mappings);
 	spa_list_init(&b->maps);
 
-#ifdef USE_MEMFD
-	b->this.fd = memfd_create("pipewire-memfd", MFD_CLOEXEC | MFD_ALLOW_SEALING);
-	if (b->this.fd == -1) {
-		res = -errno;
-		pw_log_error(NAME" %p: Failed to create memfd: %m", pool);
-		goto error_free;
-	}
-#else
-	char filename[] = "/dev/shm/pipewire-tmpfile.XXXXXX";
-	b->this.fd = mkostemp(filename, O_CLOEXEC);
-	if (b->this.fd == -1) {
-		res = -errno;
-		pw_log_error(NAME" %p: Failed to create temporary file: %m", pool);
-		goto error_free;
-	}
-	unlink(filename);
-#endif
+	if ((flags & PW_MEMBLOCK_FLAG_ARENA) && impl->arena_size > 0 &&
+	    (flags & PW_MEMBLOCK_FLAG_MAP) &&
+	    (flags & PW_MEMBLOCK_FLAG_READWRITE) == PW_MEMBLOCK_FLAG_READWRITE &&
+	    type == SPA_DATA_MemFd && size > 0)
+		class = arena_class(impl, size);
 
-	if (ftruncate(b->this.fd, size) < 0) {
-		res = -errno;
-		pw_log_warn(NAME" %p: Failed to truncate temporary file: %m", pool);
-		goto error_close;
-	}
-#ifdef USE_MEMFD
-	if (flags & PW_MEMBLOCK_FLAG_SEAL) {
-		unsigned int seals = F_SEAL_GROW | F_SEAL_SHRINK | F_SEAL_SEAL;
-		if (fcntl(b->this.fd, F_ADD_SEALS, seals) == -1) {
-			pw_log_warn(NAME" %p: Failed to add seals: %m", pool);
+	if (class != SPA_ID_INVALID) {
+		if ((res = arena_alloc(impl, b, class)) < 0)
+			goto error_free;
+	} else {
+		b->this.flags &= ~PW_MEMBLOCK_FLAG_ARENA;
+
+		b->this.fd = create_fd(impl, size, flags & PW_MEMBLOCK_FLAG_SEAL);
+		if (b->this.fd < 0) {
+			res = b->this.fd;
+			goto error_free;
 		}
 	}
-#endif
+
+	if ((res = block_insert(impl, b)) < 0)
+		goto error_release;
+
 	if (flags & PW_MEMBLOCK_FLAG_MAP && size > 0) {
 		b->this.map = pw_memblock_map(&b->this,
-				block_flags_to_mem(flags), 0, size, NULL);
+				block_flags_to_mem(flags), b->arena_offset, size, NULL);
 		if (b->this.map == NULL) {
 			res = -errno;
 			pw_log_warn(NAME" %p: Failed to map: %m", pool);
-			goto error_close;
+			block_remove(impl, b);
+			goto error_release;
 		}
 		b->this.ref--;
 	}
 
-	b->this.id = pw_map_insert_new(&impl->map, b);
-	spa_list_append(&impl->blocks, &b->link);
 	pw_log_debug(NAME" %p: mem %p alloc id:%d type:%u", pool, &b->this, b->this.id, type);
 
 	pw_mempool_emit_added(impl, &b->this);
 
 	return &b->this;
 
-error_close:
+error_release:
+	if (b->arena) {
+		spa_list_consume(m, &b->mappings, link) {
+			index_remove(&impl->ptr_index, mapping_cmp, m, m->ptr, 0);
+			spa_list_remove(&m->link);
+			free(m);
+		}
+		arena_free(impl, b);
+		goto error_free;
+	}
 	close(b->this.fd);
 error_free:
 	free(b);
@@ -518,15 +863,19 @@ static struct memblock * mempool_find_fd(struct pw_mempool *pool, int fd)
 {
 	struct mempool *impl = SPA_CONTAINER_OF(pool, struct mempool, this);
 	struct memblock *b;
+	size_t pos;
 
-	spa_list_for_each(b, &impl->blocks, link) {
-		if (fd == b->this.fd) {
-			pw_log_debug(NAME" %p: found %p id:%d fd:%d ref:%d",
-					pool, &b->this, b->this.id, fd, b->this.ref);
-			return b;
-		}
-	}
-	return NULL;
+	pos = index_lower(&impl->fd_index, block_cmp, &fd, 0);
+	if (pos == pw_array_get_len(&impl->fd_index, struct memblock *))
+		return NULL;
+
+	b = *pw_array_get_unchecked(&impl->fd_index, pos, struct memblock *);
+	if (b->this.fd != fd)
+		return NULL;
+
+	pw_log_debug(NAME" %p: found %p id:%d fd:%d ref:%d",
+			pool, &b->this, b->this.id, fd, b->this.ref);
+	return b;
 }
 
 SPA_EXPORT
@@ -535,6 +884,7 @@ struct pw_memblock * pw_mempool_import(struct pw_mempool *pool,
 {
 	struct mempool *impl = SPA_CONTAINER_OF(pool, struct mempool, this);
 	struct memblock *b;
+	int res;
 
 	b = mempool_find_fd(pool, fd);
 	if (b != NULL) {
@@ -554,8 +904,11 @@ struct pw_memblock * pw_mempool_import(struct pw_mempool *pool,
 	b->this.type = type;
 	b->this.fd = fd;
 	b->this.flags = flags;
-	b->this.id = pw_map_insert_new(&impl->map, b);
-	spa_list_append(&impl->blocks, &b->link);
+	if ((res = block_insert(impl, b)) < 0) {
+		free(b);
+		errno = -res;
+		return NULL;
+	}
 
 	pw_log_debug(NAME" %p: import %p id:%u flags:%08x type:%u fd:%d",
 			pool, b, b->this.id, flags, type, fd);
@@ -581,37 +934,46 @@ struct pw_memmap * pw_mempool_import_map(struct pw_mempool *pool,
 	struct pw_memblock *old, *block;
 	struct memblock *b;
 	struct pw_memmap *map;
-	struct mapping *m;
+	struct mapping *m, *om;
 	uint32_t offset;
+	int res;
 
 	old = pw_mempool_find_ptr(other, data);
 	if (old == NULL || old->map == NULL) {
 		errno = EFAULT;
 		return NULL;
 	}
+	om = (SPA_CONTAINER_OF(old->map, struct memmap, this))->mapping;
 
 	block = pw_mempool_import_block(pool, old);
 	if (block == NULL)
 		return NULL;
 
-	if (block->ref == 1) {
-		b = SPA_CONTAINER_OF(block, struct memblock, this);
+	b = SPA_CONTAINER_OF(block, struct memblock, this);
 
+	/* reuse the mapping of the other pool, blocks from an arena share
+	 * the imported block but have their own mapping */
+	if (memblock_find_mapping(b, 0, om->offset, om->size) == NULL) {
 		m = calloc(1, sizeof(struct mapping));
 		if (m == NULL) {
 			pw_memblock_unref(block);
 			return NULL;
 		}
-		m->ptr = old->map->ptr;
+		m->ptr = om->ptr;
 		m->block = b;
-		m->offset = old->map->offset;
-		m->size = old->map->size;
-		spa_list_append(&b->mappings, &m->link);
+		m->offset = om->offset;
+		m->size = om->size;
+		if ((res = mapping_insert(b, m)) < 0) {
+			free(m);
+			pw_memblock_unref(block);
+			errno = -res;
+			return NULL;
+		}
 	} else {
 		block->ref--;
 	}
 
-	offset = SPA_PTRDIFF(data, old->map->ptr);
+	offset = old->map->offset + SPA_PTRDIFF(data, old->map->ptr);
 
 	map = pw_memblock_map(block,
 			block_flags_to_mem(block->flags), offset, size, tag);
@@ -656,14 +1018,16 @@ void pw_memblock_free(struct pw_memblock *block)
 	if (block->map)
 		block->ref++;
 
-	pw_map_remove(&impl->map, block->id);
-	spa_list_remove(&b->link);
+	block_remove(impl, b);
 
 	pw_mempool_emit_removed(impl, block);
 
 	spa_list_consume(mm, &b->maps, link)
 		pw_memmap_free(&mm->this);
 
+	if (b->arena)
+		arena_free(impl, b);
+
 	if (block->fd != -1 && !(block->flags & PW_MEMBLOCK_FLAG_DONT_CLOSE)) {
 		pw_log_debug(NAME" %p: close fd:%d", pool, block->fd);
 		close(block->fd);
@@ -675,19 +1039,21 @@ SPA_EXPORT
 struct pw_memblock * pw_mempool_find_ptr(struct pw_mempool *pool, const void *ptr)
 {
 	struct mempool *impl = SPA_CONTAINER_OF(pool, struct mempool, this);
-	struct memblock *b;
 	struct mapping *m;
+	size_t pos;
 
-	spa_list_for_each(b, &impl->blocks, link) {
-		spa_list_for_each(m, &b->mappings, link) {
-			if (ptr >= m->ptr && ptr < SPA_MEMBER(m->ptr, m->size, void)) {
-				pw_log_debug(NAME" %p: found %p id:%d for %p", pool,
-						m->block, b->this.id, ptr);
-				return &b->this;
-			}
-		}
-	}
-	return NULL;
+	/* the last mapping that starts at or before ptr */
+	pos = index_lower(&impl->ptr_index, mapping_cmp, SPA_MEMBER(ptr, 1, void), 0);
+	if (pos == 0)
+		return NULL;
+
+	m = *pw_array_get_unchecked(&impl->ptr_index, pos - 1, struct mapping *);
+	if (ptr >= SPA_MEMBER(m->ptr, m->size, void))
+		return NULL;
+
+	pw_log_debug(NAME" %p: found %p id:%d for %p", pool,
+			m->block, m->block->this.id, ptr);
+	return &m->block->this;
 }
 
 SPA_EXPORT
@@ -720,18 +1086,19 @@ SPA_EXPORT
 struct pw_memmap * pw_mempool_find_tag(struct pw_mempool *pool, uint32_t tag[5], size_t size)
 {
 	struct mempool *impl = SPA_CONTAINER_OF(pool, struct mempool, this);
-	struct memblock *b;
 	struct memmap *mm;
+	size_t pos;
 
 	pw_log_debug(NAME" %p: find tag %zd", pool, size);
 
-	spa_list_for_each(b, &impl->blocks, link) {
-		spa_list_for_each(mm, &b->maps, link) {
-			if (memcmp(tag, mm->this.tag, size) == 0) {
-				pw_log_debug(NAME" %p: found %p", pool, mm);
-				return &mm->this;
-			}
-		}
-	}
-	return NULL;
+	pos = index_lower(&impl->tag_index, memmap_cmp, tag, size);
+	if (pos == pw_array_get_len(&impl->tag_index, struct memmap *))
+		return NULL;
+
+	mm = *pw_array_get_unchecked(&impl->tag_index, pos, struct memmap *);
+	if (memcmp(tag, mm->this.tag, size) != 0)
+		return NULL;
+
+	pw_log_debug(NAME" %p: found %p", pool, mm);
+	return &mm->this;
 }
@@ -39,6 +39,9 @@ enum pw_memblock_flags {
 	PW_MEMBLOCK_FLAG_SEAL = (1 << 2),
 	PW_MEMBLOCK_FLAG_MAP = (1 << 3),
 	PW_MEMBLOCK_FLAG_DONT_CLOSE = (1 << 4),
+	PW_MEMBLOCK_FLAG_ARENA = (1 << 5),	/**< the block can be allocated from a shared
+						  *  fd of the pool, it then starts at
+						  *  map->offset in the fd */
 
 	PW_MEMBLOCK_FLAG_READWRITE = PW_MEMBLOCK_FLAG_READABLE | PW_MEMBLOCK_FLAG_WRITABLE,
 };
@@ -47,8 +50,9 @@ enum pw_memmap_flags {
 	PW_MEMMAP_FLAG_NONE = 0,
 	PW_MEMMAP_FLAG_READ = (1 << 0),		/**< map in read mode */
 	PW_MEMMAP_FLAG_WRITE = (1 << 1),	/**< map in write mode */
-	PW_MEMMAP_FLAG_TWICE = (1 << 2),	/**< map the same area twice afer eachother,
-						  *  creating a circular ringbuffer */
+	PW_MEMMAP_FLAG_TWICE = (1 << 2),	/**< map the same area twice after each other,
+						  *  creating a circular ringbuffer. offset
+						  *  and size must be page aligned */
 	PW_MEMMAP_FLAG_PRIVATE = (1 << 3),	/**< writes will be private */
 	PW_MEMMAP_FLAG_READWRITE = PW_MEMMAP_FLAG_READ | PW_MEMMAP_FLAG_WRITE,
 };
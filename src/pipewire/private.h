@@ -31,6 +31,11 @@ extern "C" {
 
 #include <sys/socket.h>
 #include <sys/types.h> /* for pthread_t */
+#ifdef __linux__
+#include <linux/futex.h>
+#include <sys/syscall.h>
+#endif
+#include <unistd.h>
 
 #include "pipewire/impl.h"
 
@@ -38,6 +43,7 @@ extern "C" {
 #include <spa/pod/builder.h>
 #include <spa/utils/result.h>
 #include <spa/utils/type-info.h>
+#include <spa/param/latency-utils.h>
 
 #ifdef __FreeBSD__
 struct ucred {
@@ -253,6 +259,13 @@ struct pw_context {
 	struct spa_list control_list[2];	/**< list of controls, indexed by direction */
 	struct spa_list export_list;		/**< list of export types */
 	struct spa_list driver_list;		/**< list of driver nodes */
+	struct spa_list graph_list;		/**< nodes that changed since the last
+						  *  graph recalc */
+	struct pw_impl_node *graph_target;	/**< master of the unassigned nodes */
+	uint32_t reach_serial;			/**< serial for graph walks */
+	uint32_t reach_version;			/**< changes when the nodes that can reach
+						  *  each other change */
+	struct pw_array param_cache;		/**< params negotiated between ports */
 
 	struct spa_hook_list listener_list;
 
@@ -260,6 +273,8 @@ struct pw_context {
 	struct pw_loop *data_loop;	/**< data loop for data passing */
         struct pw_data_loop *data_loop_impl;
 	struct spa_system *data_system;	/**< data system for data passing */
+	struct pw_data_pool *data_pool;	/**< optional worker pool for graph execution */
+	struct pw_profiler *profiler;	/**< optional profiler */
 
 	struct spa_support support[16];	/**< support for spa plugins */
 	uint32_t n_support;		/**< number of support items */
@@ -368,6 +383,8 @@ struct pw_node_target {
 	struct pw_node_activation *activation;
 	int (*signal) (void *data);
 	void *data;
+	unsigned int legacy_peer:1;	/**< the peer that signals the target was
+					  *  counted in legacy_peers */
 };
 
 struct pw_node_activation {
@@ -420,6 +437,21 @@ struct pw_node_activation {
 	uint32_t command;				/* next command */
 	uint32_t reposition_owner;			/* owner id with new reposition info, last one
 							 * to update wins */
+
+	/* wakeup, only valid when the activation is at least this large */
+#define PW_NODE_ACTIVATION_WAKEUP_NONE		0	/* node sleeps on its eventfd */
+#define PW_NODE_ACTIVATION_WAKEUP_SPIN		1	/* node is spinning on wakeup_state */
+#define PW_NODE_ACTIVATION_WAKEUP_FUTEX		2	/* node sleeps on the wakeup_state futex */
+#define PW_NODE_ACTIVATION_WAKEUP_WOKEN		3	/* node was woken without eventfd */
+#define PW_NODE_ACTIVATION_WAKEUP_KICK		4	/* node must go back to its eventfd */
+	uint32_t wakeup_state;				/* futex word, one of PW_NODE_ACTIVATION_WAKEUP_ */
+	uint32_t wakeup_seq;				/* incremented for each wakeup */
+#define PW_NODE_ACTIVATION_FLAG_WAKEUP		(1<<0)	/* the node wakes up its targets with
+							 * pw_node_activation_wakeup() */
+	uint32_t flags;
+	uint32_t legacy_peers;				/* number of peers that wake up this node
+							 * with the eventfd only. The node can only
+							 * sleep on the futex when this is 0 */
 };
 
 #define ATOMIC_CAS(v,ov,nv)						\
@@ -441,6 +473,153 @@ struct pw_node_activation {
 #define SEQ_READ(s)			ATOMIC_LOAD(s)
 #define SEQ_READ_SUCCESS(s1,s2)		((s1) == (s2) && ((s2) & 1) == 0)
 
+#define PW_NODE_ACTIVATION_SPIN_MIN	16
+#define PW_NODE_ACTIVATION_SPIN_MAX	(16 * 1024)
+
+static inline void pw_node_activation_futex_wait(uint32_t *addr, uint32_t val)
+{
+#ifdef __linux__
+	/* not private, the activation is shared between processes */
+	syscall(SYS_futex, addr, FUTEX_WAIT, val, NULL, NULL, 0);
+#endif
+}
+
+static inline void pw_node_activation_futex_wake(uint32_t *addr)
+{
+#ifdef __linux__
+	syscall(SYS_futex, addr, FUTEX_WAKE, 1, NULL, NULL, 0);
+#endif
+}
+
+/** Wake up the node of \a a.
+ *
+ * When the node is spinning or sleeping on the futex, it is woken up
+ * without touching the eventfd.
+ *
+ * \return true when the eventfd of the node still needs to be written
+ */
+static inline bool pw_node_activation_wakeup(struct pw_node_activation *a)
+{
+	uint32_t state;
+
+	ATOMIC_INC(a->wakeup_seq);
+	while (true) {
+		state = ATOMIC_LOAD(a->wakeup_state);
+		if (state != PW_NODE_ACTIVATION_WAKEUP_SPIN &&
+		    state != PW_NODE_ACTIVATION_WAKEUP_FUTEX)
+			return true;
+		if (ATOMIC_CAS(a->wakeup_state, state, PW_NODE_ACTIVATION_WAKEUP_WOKEN))
+			break;
+	}
+	if (state == PW_NODE_ACTIVATION_WAKEUP_FUTEX)
+		pw_node_activation_futex_wake(&a->wakeup_state);
+	return false;
+}
+
+/** Make the node of \a a go back to its eventfd. This interrupts the
+ * current wait or, when the node is not waiting, the next one. */
+static inline void pw_node_activation_kick(struct pw_node_activation *a)
+{
+	uint32_t state;
+
+	while (true) {
+		state = ATOMIC_LOAD(a->wakeup_state);
+		if (state == PW_NODE_ACTIVATION_WAKEUP_WOKEN ||
+		    state == PW_NODE_ACTIVATION_WAKEUP_KICK)
+			return;
+		if (ATOMIC_CAS(a->wakeup_state, state, PW_NODE_ACTIVATION_WAKEUP_KICK))
+			break;
+	}
+	if (state == PW_NODE_ACTIVATION_WAKEUP_FUTEX)
+		pw_node_activation_futex_wake(&a->wakeup_state);
+}
+
+/** Wait for a wakeup of the node of \a a.
+ *
+ * Spins on the wakeup state for at most \a spin iterations and then sleeps
+ * on the futex when \a futex is true and all peers can wake us up that way.
+ * \a spin is adapted: it grows when the wakeup arrived while spinning and
+ * shrinks when it did not. Use 0 to never spin, on a single CPU the peer
+ * can't run while we spin.
+ *
+ * \return 1 when woken up, 0 when the caller needs to wait on its
+ *    eventfd instead.
+ */
+static inline int pw_node_activation_wait(struct pw_node_activation *a,
+		uint32_t *seq, uint32_t *spin, bool futex)
+{
+	uint32_t i, state;
+
+	if (!ATOMIC_CAS(a->wakeup_state, PW_NODE_ACTIVATION_WAKEUP_NONE,
+				PW_NODE_ACTIVATION_WAKEUP_SPIN))
+		goto done;
+
+	/* woken up with the eventfd before we started to spin */
+	if (ATOMIC_LOAD(a->wakeup_seq) != *seq)
+		goto cancel;
+
+	for (i = 0; i < *spin; i++) {
+		if (ATOMIC_LOAD(a->wakeup_state) != PW_NODE_ACTIVATION_WAKEUP_SPIN) {
+			*spin = SPA_MIN(*spin * 2, (uint32_t)PW_NODE_ACTIVATION_SPIN_MAX);
+			goto done;
+		}
+#if defined(__i386__) || defined(__x86_64__)
+		__builtin_ia32_pause();
+#endif
+	}
+	if (*spin > 0)
+		*spin = SPA_MAX(*spin / 2, (uint32_t)PW_NODE_ACTIVATION_SPIN_MIN);
+
+	if (!futex)
+		goto cancel;
+	if (!ATOMIC_CAS(a->wakeup_state, PW_NODE_ACTIVATION_WAKEUP_SPIN,
+				PW_NODE_ACTIVATION_WAKEUP_FUTEX))
+		goto done;
+	/* a peer that can only use the eventfd might have been added */
+	if (ATOMIC_LOAD(a->legacy_peers) > 0) {
+		if (ATOMIC_CAS(a->wakeup_state, PW_NODE_ACTIVATION_WAKEUP_FUTEX,
+				PW_NODE_ACTIVATION_WAKEUP_NONE))
+			return 0;
+		goto done;
+	}
+	while (ATOMIC_LOAD(a->wakeup_state) == PW_NODE_ACTIVATION_WAKEUP_FUTEX)
+		pw_node_activation_futex_wait(&a->wakeup_state,
+				PW_NODE_ACTIVATION_WAKEUP_FUTEX);
+	goto done;
+
+cancel:
+	if (ATOMIC_CAS(a->wakeup_state, PW_NODE_ACTIVATION_WAKEUP_SPIN,
+				PW_NODE_ACTIVATION_WAKEUP_NONE))
+		return 0;
+done:
+	state = ATOMIC_XCHG(a->wakeup_state, PW_NODE_ACTIVATION_WAKEUP_NONE);
+	if (state != PW_NODE_ACTIVATION_WAKEUP_WOKEN)
+		return 0;
+	*seq = ATOMIC_LOAD(a->wakeup_seq);
+	return 1;
+}
+
+/** Account for \a peer waking up the node of \a a. Must be called
+ * before the peer can wake up the node. Returns true when the peer was
+ * counted as a legacy peer, pass this to pw_node_activation_remove_peer()
+ * because the flags of the peer can change in the meantime. */
+static inline bool pw_node_activation_add_peer(struct pw_node_activation *a,
+		struct pw_node_activation *peer)
+{
+	if (SPA_FLAG_IS_SET(peer->flags, PW_NODE_ACTIVATION_FLAG_WAKEUP))
+		return false;
+	ATOMIC_INC(a->legacy_peers);
+	pw_node_activation_kick(a);
+	return true;
+}
+
+static inline void pw_node_activation_remove_peer(struct pw_node_activation *a,
+		bool legacy)
+{
+	if (legacy)
+		ATOMIC_DEC(a->legacy_peers);
+}
+
 #define pw_impl_node_emit(o,m,v,...) spa_hook_list_call(&o->listener_list, struct pw_impl_node_events, m, v, ##__VA_ARGS__)
 #define pw_impl_node_emit_destroy(n)			pw_impl_node_emit(n, destroy, 0)
 #define pw_impl_node_emit_free(n)			pw_impl_node_emit(n, free, 0)
@@ -486,6 +665,7 @@ struct pw_impl_node {
 					  *  is selected to drive the graph */
 	unsigned int visited:1;		/**< for sorting */
 	unsigned int want_driver:1;	/**< this node wants to be assigned to a driver */
+	unsigned int graph_changed:1;	/**< node is queued for graph recalc */
 
 	uint32_t port_user_data_size;	/**< extra size for port user data */
 
@@ -495,6 +675,14 @@ struct pw_impl_node {
 	struct spa_list slave_link;
 
 	struct spa_list sort_link;	/**< link used to sort nodes */
+	struct spa_list graph_link;	/**< link in context graph_list */
+	uint32_t active_slaves;		/**< active slaves at the last recalc */
+	uint32_t reach_serial;		/**< serial of the last walk that visited us */
+	struct {
+		uint32_t version;	/**< reach_version of the context for result */
+		struct pw_impl_node *target;
+		bool result;
+	} reach_cache;			/**< last walk from this node */
 
 	struct spa_node *node;		/**< SPA node implementation */
 	struct spa_hook listener;
@@ -517,6 +705,8 @@ struct pw_impl_node {
 	struct pw_loop *data_loop;		/**< the data loop for this node */
 
 	uint32_t quantum_size;			/**< desired quantum */
+	uint32_t max_quantum_size;		/**< max quantum we can handle, 0 when
+						  *  latency sensitive */
 	uint32_t quantum_current;		/**< current quantum for driver */
 	struct spa_source source;		/**< source to remotely trigger this node */
 	struct pw_memblock *activation;
@@ -534,6 +724,12 @@ struct pw_impl_node {
 		struct pw_node_target target;		/* our target that is signaled by the
 							   driver */
 		struct spa_list driver_link;		/* our link in driver */
+
+		struct {
+			uint64_t position;		/* clock of the last cycle of the */
+			uint32_t quantum;		/* driver, for the profiler */
+			uint32_t rate;
+		} profile;
 	} rt;
 
         void *user_data;                /**< extra user data */
@@ -610,6 +806,13 @@ struct pw_impl_port {
 	struct pw_properties *properties;	/**< properties of the port */
 	struct pw_port_info info;
 	struct spa_param_info params[MAX_PARAMS];
+	uint64_t enum_format_hash;	/**< hash of the EnumFormat params, 0 when
+					  *  not known. Reset on any format or param
+					  *  change of the node */
+
+	struct spa_latency_info latency[2];	/**< capture latency indexed by SPA_DIRECTION_INPUT,
+						  *  playback latency by SPA_DIRECTION_OUTPUT */
+	uint32_t node_latency;		/**< mask of latency directions reported by the node */
 
 	struct pw_buffers buffers;	/**< buffers managed by this port, only on
 					  *  output ports, shared with all links */
@@ -931,8 +1134,35 @@ void pw_proxy_remove(struct pw_proxy *proxy);
 
 void pw_resource_remove(struct pw_resource *resource);
 
+void pw_context_graph_changed(struct pw_context *context, struct pw_impl_node *node);
+
+int pw_context_hash_params(struct pw_context *context, struct spa_node *node,
+		enum spa_direction direction, uint32_t port_id, uint32_t id,
+		uint64_t *hash);
+int pw_context_cache_params(struct pw_context *context, uint32_t id,
+		uint64_t ihash, uint64_t ohash,
+		const void *params, uint32_t size, uint32_t n_params);
+int pw_context_lookup_params(struct pw_context *context, uint32_t id,
+		uint64_t ihash, uint64_t ohash, struct spa_pod_builder *builder);
 int pw_context_recalc_graph(struct pw_context *context);
 
+/** A pool of realtime worker threads that execute ready nodes of a graph cycle
+ * in parallel. Workers push ready targets on their own work-stealing deque,
+ * other threads use a shared queue. */
+struct pw_data_pool *pw_data_pool_new(struct pw_context *context, uint32_t n_workers,
+		int cpu_base, int rt_prio);
+void pw_data_pool_destroy(struct pw_data_pool *pool);
+uint32_t pw_data_pool_get_n_workers(struct pw_data_pool *pool);
+void pw_data_pool_push(struct pw_data_pool *pool, struct pw_node_target *t);
+void pw_data_pool_sync(struct pw_data_pool *pool);
+
+/** Writes the timing of all nodes in each cycle to a ring in shared memory,
+ * see extensions/profiler.h */
+struct pw_profiler *pw_profiler_new(struct pw_context *context, const char *name,
+		uint32_t n_records);
+void pw_profiler_destroy(struct pw_profiler *profiler);
+void pw_profiler_add_cycle(struct pw_profiler *profiler, struct pw_impl_node *driver);
+
 void pw_impl_port_update_info(struct pw_impl_port *port, const struct spa_port_info *info);
 
 int pw_impl_port_register(struct pw_impl_port *port,
@@ -954,6 +1184,10 @@ void pw_impl_port_unlink(struct pw_impl_port *port);
 /** Destroy a port \memberof pw_impl_port */
 void pw_impl_port_destroy(struct pw_impl_port *port);
 
+/** Recalculate the latency of a port after its links changed, the changes
+ * are propagated to the peers and the other ports of the node */
+void pw_impl_port_recalc_latency(struct pw_impl_port *port);
+
 /** Iterate the params of the given port. The callback should return
  * 1 to fetch the next item, 0 to stop iteration or <0 on error.
  * The function returns 0 on success or the error returned by the callback. */
@@ -1002,6 +1236,8 @@ int pw_impl_node_set_param(struct pw_impl_node *node,
 
 int pw_impl_node_update_ports(struct pw_impl_node *node);
 
+void pw_impl_node_reset_format_hash(struct pw_impl_node *node);
+
 int pw_impl_node_set_driver(struct pw_impl_node *node, struct pw_impl_node *driver);
 
 /** Prepare a link \memberof pw_impl_link
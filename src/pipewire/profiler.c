@@ -0,0 +1,154 @@
+/* PipeWire
+ *
+ * Copyright © 2020 Wim Taymans
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the next
+ * paragraph) shall be included in all copies or substantial portions of the
+ * Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+#include <errno.h>
+#include <fcntl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include <sys/mman.h>
+
+#include <spa/utils/result.h>
+
+#include <extensions/profiler.h>
+
+#include "pipewire/log.h"
+#include "pipewire/private.h"
+
+#define NAME "profiler"
+
+/** \cond */
+struct pw_profiler {
+	struct pw_context *context;
+	char name[256];
+	struct pw_profiler_header *header;
+	size_t size;
+};
+/** \endcond */
+
+struct pw_profiler *pw_profiler_new(struct pw_context *context, const char *name,
+		uint32_t n_records)
+{
+	struct pw_profiler *this;
+	struct pw_profiler_header *h;
+	int res, fd;
+
+	this = calloc(1, sizeof(*this));
+	if (this == NULL)
+		return NULL;
+
+	this->context = context;
+	snprintf(this->name, sizeof(this->name), PW_PROFILER_SHM_FORMAT, name);
+
+	n_records = SPA_MAX(n_records, 64u);
+	while (n_records & (n_records - 1))
+		n_records &= n_records - 1;
+	this->size = sizeof(struct pw_profiler_header) +
+		n_records * sizeof(struct pw_profiler_record);
+
+	fd = shm_open(this->name, O_CREAT | O_RDWR | O_TRUNC | O_CLOEXEC, 0600);
+	if (fd < 0) {
+		res = -errno;
+		pw_log_error(NAME" %p: can't open %s: %m", this, this->name);
+		goto error_free;
+	}
+	if (ftruncate(fd, this->size) < 0) {
+		res = -errno;
+		goto error_unlink;
+	}
+	h = mmap(NULL, this->size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+	if (h == MAP_FAILED) {
+		res = -errno;
+		goto error_unlink;
+	}
+	close(fd);
+
+	h->version = PW_VERSION_PROFILER;
+	h->record_size = sizeof(struct pw_profiler_record);
+	h->n_records = n_records;
+	h->write_index = 0;
+	__atomic_store_n(&h->magic, PW_PROFILER_MAGIC, __ATOMIC_RELEASE);
+	this->header = h;
+
+	pw_log_info(NAME" %p: writing %u records to %s", this, n_records, this->name);
+
+	return this;
+
+error_unlink:
+	pw_log_error(NAME" %p: can't map %s: %s", this, this->name, spa_strerror(res));
+	close(fd);
+	shm_unlink(this->name);
+error_free:
+	free(this);
+	errno = -res;
+	return NULL;
+}
+
+void pw_profiler_destroy(struct pw_profiler *profiler)
+{
+	pw_log_debug(NAME" %p: destroy", profiler);
+	munmap(profiler->header, profiler->size);
+	shm_unlink(profiler->name);
+	free(profiler);
+}
+
+/* called from the data thread when the driver starts a new cycle, the
+ * activations of the targets still contain the times of the last cycle */
+void pw_profiler_add_cycle(struct pw_profiler *profiler, struct pw_impl_node *driver)
+{
+	struct pw_profiler_header *h = profiler->header;
+	struct pw_node_target *t;
+
+	spa_list_for_each(t, &driver->rt.target_list, link) {
+		struct pw_node_activation *a = t->activation;
+		struct pw_profiler_record *r;
+		uint64_t index;
+
+		if (t->node == NULL)
+			continue;
+
+		index = __atomic_fetch_add(&h->write_index, 1, __ATOMIC_RELAXED);
+		r = pw_profiler_get_record(h, index);
+
+		__atomic_store_n(&r->seq, 0, __ATOMIC_RELAXED);
+		__atomic_thread_fence(__ATOMIC_RELEASE);
+
+		r->id = t->node->info.id;
+		r->driver_id = driver->info.id;
+		r->position = driver->rt.profile.position;
+		r->quantum = driver->rt.profile.quantum;
+		r->rate = driver->rt.profile.rate;
+		r->signal_time = a->signal_time;
+		r->awake_time = a->awake_time;
+		r->finish_time = a->finish_time;
+		r->flags = 0;
+		if (t->node == driver)
+			r->flags |= PW_PROFILER_RECORD_FLAG_DRIVER;
+		if (a->status != PW_NODE_ACTIVATION_FINISHED)
+			r->flags |= PW_PROFILER_RECORD_FLAG_INCOMPLETE;
+		r->xrun_count = a->xrun_count;
+
+		__atomic_store_n(&r->seq, index + 1, __ATOMIC_RELEASE);
+	}
+}
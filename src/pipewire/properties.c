@@ -34,13 +34,72 @@ struct properties {
 	struct pw_properties this;
 
 	struct pw_array items;
+	struct spa_dict_hash hash;
 };
 /** \endcond */
 
+#define HASH_MIN_SIZE	32
+
+static int hash_resize(struct properties *impl, uint32_t n_items)
+{
+	uint32_t size, *slots;
+
+	for (size = HASH_MIN_SIZE; size < n_items * 2; size <<= 1);
+	if (size <= impl->hash.size)
+		return 0;
+
+	/* slots followed by the hashes of at most size / 2 items */
+	slots = calloc(size + size / 2, sizeof(uint32_t));
+	if (slots == NULL)
+		return -errno;
+
+	free(impl->hash.slots);
+	impl->hash.size = size;
+	impl->hash.slots = slots;
+	impl->hash.hashes = slots + size;
+	spa_dict_hash_index(&impl->this.dict, &impl->hash);
+	return 0;
+}
+
+static uint32_t hash_find_slot(struct spa_dict_hash *hash, uint32_t index)
+{
+	uint32_t i, mask = hash->size - 1;
+	for (i = hash->hashes[index] & mask; hash->slots[i] != index + 1; i = (i + 1) & mask);
+	return i;
+}
+
+static void hash_remove(struct spa_dict_hash *hash, uint32_t index)
+{
+	uint32_t i, j, k, mask = hash->size - 1;
+
+	i = hash_find_slot(hash, index);
+
+	/* shift back the following items of the cluster that can't be
+	 * reached anymore from their home slot */
+	for (j = (i + 1) & mask; hash->slots[j] != 0; j = (j + 1) & mask) {
+		k = hash->hashes[hash->slots[j] - 1] & mask;
+		if (i < j ? (k <= i || k > j) : (k <= i && k > j)) {
+			hash->slots[i] = hash->slots[j];
+			i = j;
+		}
+	}
+	hash->slots[i] = 0;
+}
+
+static void hash_move(struct spa_dict_hash *hash, uint32_t from, uint32_t to)
+{
+	hash->slots[hash_find_slot(hash, from)] = to + 1;
+	hash->hashes[to] = hash->hashes[from];
+}
+
 static int add_func(struct pw_properties *this, char *key, char *value)
 {
 	struct spa_dict_item *item;
 	struct properties *impl = SPA_CONTAINER_OF(this, struct properties, this);
+	int res;
+
+	if ((res = hash_resize(impl, this->dict.n_items + 1)) < 0)
+		return res;
 
 	item = pw_array_add(&impl->items, sizeof(struct spa_dict_item));
 	if (item == NULL)
@@ -50,6 +109,7 @@ static int add_func(struct pw_properties *this, char *key, char *value)
 	item->value = value;
 
 	this->dict.items = impl->items.data;
+	spa_dict_hash_insert(&impl->hash, this->dict.n_items, spa_dict_hash_key(key));
 	this->dict.n_items++;
 	return 0;
 }
@@ -62,8 +122,9 @@ static void clear_item(struct spa_dict_item *item)
 
 static int find_index(const struct pw_properties *this, const char *key)
 {
+	const struct properties *impl = SPA_CONTAINER_OF(this, struct properties, this);
 	const struct spa_dict_item *item;
-	item = spa_dict_lookup_item(&this->dict, key);
+	item = spa_dict_hash_lookup_item(&this->dict, &impl->hash, key);
 	if (item == NULL)
 		return -1;
 	return item - this->dict.items;
@@ -80,6 +141,11 @@ static struct properties *properties_new(int prealloc)
 	pw_array_init(&impl->items, 16);
 	pw_array_ensure_size(&impl->items, sizeof(struct spa_dict_item) * prealloc);
 
+	if (hash_resize(impl, prealloc) < 0) {
+		pw_array_clear(&impl->items);
+		free(impl);
+		return NULL;
+	}
 	return impl;
 }
 
@@ -241,6 +307,7 @@ void pw_properties_clear(struct pw_properties *properties)
 		clear_item(item);
 	pw_array_reset(&impl->items);
 	properties->dict.n_items = 0;
+	memset(impl->hash.slots, 0, impl->hash.size * sizeof(uint32_t));
 }
 
 /** Update properties
@@ -332,6 +399,7 @@ void pw_properties_free(struct pw_properties *properties)
 	struct properties *impl = SPA_CONTAINER_OF(properties, struct properties, this);
 	pw_properties_clear(properties);
 	pw_array_clear(&impl->items);
+	free(impl->hash.slots);
 	free(impl);
 }
 
@@ -360,9 +428,12 @@ static int do_replace(struct pw_properties *properties, const char *key, char *v
 		}
 
 		if (value == NULL) {
+			uint32_t last_index = pw_array_get_len(&impl->items, struct spa_dict_item) - 1;
 			struct spa_dict_item *last = pw_array_get_unchecked(&impl->items,
-						     pw_array_get_len(&impl->items, struct spa_dict_item) - 1,
-						     struct spa_dict_item);
+						     last_index, struct spa_dict_item);
+			hash_remove(&impl->hash, index);
+			if ((uint32_t)index != last_index)
+				hash_move(&impl->hash, last_index, index);
 			clear_item(item);
 			item->key = last->key;
 			item->value = last->value;
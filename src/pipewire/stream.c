@@ -30,6 +30,7 @@
 
 #include <spa/buffer/alloc.h>
 #include <spa/param/props.h>
+#include <spa/param/latency-utils.h>
 #include <spa/node/io.h>
 #include <spa/node/utils.h>
 #include <spa/utils/ringbuffer.h>
@@ -123,6 +124,8 @@ struct stream {
 	uintptr_t seq;
 	struct pw_time time;
 
+	struct spa_latency_info latency;	/**< latency of the graph to the device */
+
 	unsigned int disconnecting:1;
 	unsigned int free_proxy:1;
 	unsigned int draining:1;
@@ -506,6 +509,15 @@ static int impl_port_enum_params(void *object, int seq,
 	return 0;
 }
 
+static int
+do_set_latency(struct spa_loop *loop,
+                 bool async, uint32_t seq, const void *data, size_t size, void *user_data)
+{
+	struct stream *impl = user_data;
+	impl->latency = *(const struct spa_latency_info *) data;
+	return 0;
+}
+
 static int impl_port_set_param(void *object,
 			       enum spa_direction direction, uint32_t port_id,
 			       uint32_t id, uint32_t flags,
@@ -525,6 +537,15 @@ static int impl_port_set_param(void *object,
 	if ((res = update_params(impl, id, &param, param ? 1 : 0)) < 0)
 		return res;
 
+	if (id == SPA_PARAM_Latency && param != NULL) {
+		struct spa_latency_info info;
+		/* copy_position() uses the latency in the data thread */
+		if (spa_latency_parse(param, &info) >= 0 &&
+		    info.direction == impl->direction)
+			pw_loop_invoke(impl->context->data_loop,
+					do_set_latency, 1, &info, sizeof(info), false, impl);
+	}
+
 	pw_stream_emit_param_changed(stream, id, param);
 
 	if (stream->state == PW_STREAM_STATE_ERROR)
@@ -681,7 +702,9 @@ static inline void copy_position(struct stream *impl, int64_t queued)
 		impl->time.now = p->clock.nsec;
 		impl->time.rate = p->clock.rate;
 		impl->time.ticks = p->clock.position;
-		impl->time.delay = p->clock.delay;
+		impl->time.delay = p->clock.delay +
+			spa_latency_info_min_frames(&impl->latency,
+					p->clock.duration, p->clock.rate.denom);
 		impl->time.queued = queued;
 		SEQ_WRITE(impl->seq);
 	}
@@ -1330,6 +1353,7 @@ pw_stream_connect(struct pw_stream *stream,
 	impl->direction =
 	    direction == PW_DIRECTION_INPUT ? SPA_DIRECTION_INPUT : SPA_DIRECTION_OUTPUT;
 	impl->flags = flags;
+	impl->latency = SPA_LATENCY_INFO(impl->direction);
 	impl->node_methods = impl_node;
 
 	if (impl->direction == SPA_DIRECTION_INPUT)
@@ -190,7 +190,9 @@ struct pw_time {
 					  *  the remote end is reading/writing. */
 	int64_t delay;			/**< delay to device, add to ticks to get the time of the
 					  *  device. Positive for INPUT streams and
-					  *  negative for OUTPUT streams. */
+					  *  negative for OUTPUT streams. This includes the
+					  *  latency of the graph between the stream and
+					  *  the device. */
 	uint64_t queued;		/**< data queued in the stream, this is the sum
 					  *  of the size fields in the pw_buffer that are
 					  *  currently queued */
@@ -0,0 +1,203 @@
+/* PipeWire
+ *
+ * Copyright © 2020 Wim Taymans
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the next
+ * paragraph) shall be included in all copies or substantial portions of the
+ * Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+#include <time.h>
+
+#include <spa/node/node.h>
+#include <spa/node/utils.h>
+#include <spa/utils/hook.h>
+
+#include <pipewire/pipewire.h>
+#include <pipewire/impl.h>
+
+#define N_GROUPS	64
+#define N_CHAIN		16
+#define N_CHURN		4096
+#define N_LAYERS	16
+
+struct node {
+	struct spa_node node;
+	struct spa_hook_list hooks;
+	struct pw_impl_node *impl;
+	struct pw_impl_port *in, *out;
+};
+
+static uint64_t get_time(void)
+{
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return SPA_TIMESPEC_TO_NSEC(&ts);
+}
+
+static int node_add_listener(void *object, struct spa_hook *listener,
+		const struct spa_node_events *events, void *data)
+{
+	struct node *n = object;
+	struct spa_hook_list save;
+	struct spa_port_info info = SPA_PORT_INFO_INIT();
+
+	spa_hook_list_isolate(&n->hooks, &save, listener, events, data);
+	spa_node_emit_port_info(&n->hooks, SPA_DIRECTION_INPUT, 0, &info);
+	spa_node_emit_port_info(&n->hooks, SPA_DIRECTION_OUTPUT, 0, &info);
+	spa_hook_list_join(&n->hooks, &save);
+	return 0;
+}
+
+static int node_set_io(void *object, uint32_t id, void *data, size_t size)
+{
+	return 0;
+}
+
+static int node_send_command(void *object, const struct spa_command *command)
+{
+	return 0;
+}
+
+static const struct spa_node_methods node_methods = {
+	SPA_VERSION_NODE_METHODS,
+	.add_listener = node_add_listener,
+	.set_io = node_set_io,
+	.send_command = node_send_command,
+};
+
+static void node_init(struct node *n, struct pw_context *context, bool driver)
+{
+	n->node.iface = SPA_INTERFACE_INIT(SPA_TYPE_INTERFACE_Node,
+			SPA_VERSION_NODE, &node_methods, n);
+	spa_hook_list_init(&n->hooks);
+
+	n->impl = pw_context_create_node(context,
+			pw_properties_new(
+				PW_KEY_NODE_DRIVER, driver ? "true" : "false",
+				NULL), 0);
+	spa_assert(n->impl != NULL);
+	pw_impl_node_set_implementation(n->impl, &n->node);
+	pw_impl_node_register(n->impl, NULL);
+	pw_impl_node_set_active(n->impl, true);
+
+	n->in = pw_impl_node_find_port(n->impl, PW_DIRECTION_INPUT, 0);
+	n->out = pw_impl_node_find_port(n->impl, PW_DIRECTION_OUTPUT, 0);
+	spa_assert(n->in != NULL && n->out != NULL);
+}
+
+static struct pw_impl_link *link_nodes(struct pw_context *context,
+		struct node *out, struct node *in)
+{
+	struct pw_impl_link *l;
+
+	l = pw_context_create_link(context, out->out, in->in, NULL, NULL, 0);
+	spa_assert(l != NULL);
+	return l;
+}
+
+/* many independent groups of a driver and a chain of nodes. We keep
+ * linking and unlinking the tail of one group. Only that group needs to
+ * be regrouped, no matter how many other groups there are. */
+static void test_churn(struct pw_context *context)
+{
+	struct node *nodes;
+	struct pw_impl_link *l;
+	uint32_t i, j, n_nodes = N_GROUPS * N_CHAIN;
+	uint64_t t1, t2;
+
+	nodes = calloc(n_nodes, sizeof(struct node));
+	spa_assert(nodes != NULL);
+
+	for (i = 0; i < N_GROUPS; i++) {
+		struct node *g = &nodes[i * N_CHAIN];
+
+		node_init(&g[0], context, true);
+		for (j = 1; j < N_CHAIN; j++) {
+			node_init(&g[j], context, false);
+			if (j < N_CHAIN - 1)
+				link_nodes(context, &g[j - 1], &g[j]);
+		}
+	}
+
+	t1 = get_time();
+	for (i = 0; i < N_CHURN; i++) {
+		struct node *g = &nodes[(i % N_GROUPS) * N_CHAIN];
+
+		l = link_nodes(context, &g[N_CHAIN - 2], &g[N_CHAIN - 1]);
+		pw_impl_link_destroy(l);
+	}
+	t2 = get_time();
+
+	fprintf(stderr, "churn %u nodes: %u link/unlink elapsed %"PRIu64" = %"PRIu64" ns/op\n",
+			n_nodes, N_CHURN, t2 - t1, (t2 - t1) / N_CHURN);
+
+	for (i = 0; i < n_nodes; i++)
+		pw_impl_node_destroy(nodes[i].impl);
+	free(nodes);
+}
+
+/* layers of two nodes, each linked to both nodes of the next layer. Linking
+ * a new node to the top needs to check that the top can't reach it, which
+ * walks all paths to the bottom when nodes are not visited only once. */
+static void test_diamond(struct pw_context *context)
+{
+	struct node nodes[2 * N_LAYERS + 1];
+	struct pw_impl_link *l;
+	uint32_t i, n_nodes = SPA_N_ELEMENTS(nodes);
+	uint64_t t1, t2;
+
+	spa_zero(nodes);
+	for (i = 0; i < n_nodes; i++)
+		node_init(&nodes[i], context, i == 0);
+
+	for (i = 2; i < 2 * N_LAYERS; i++) {
+		link_nodes(context, &nodes[(i & ~1) - 2], &nodes[i]);
+		link_nodes(context, &nodes[(i & ~1) - 1], &nodes[i]);
+	}
+
+	t1 = get_time();
+	l = link_nodes(context, &nodes[2 * N_LAYERS], &nodes[0]);
+	t2 = get_time();
+	pw_impl_link_destroy(l);
+
+	fprintf(stderr, "diamond %u layers: link elapsed %"PRIu64" ns\n",
+			N_LAYERS, t2 - t1);
+
+	for (i = 0; i < n_nodes; i++)
+		pw_impl_node_destroy(nodes[i].impl);
+}
+
+int main(int argc, char *argv[])
+{
+	struct pw_main_loop *loop;
+	struct pw_context *context;
+
+	pw_init(&argc, &argv);
+
+	loop = pw_main_loop_new(NULL);
+	context = pw_context_new(pw_main_loop_get_loop(loop), NULL, 0);
+
+	test_churn(context);
+	test_diamond(context);
+
+	pw_context_destroy(context);
+	pw_main_loop_destroy(loop);
+
+	return 0;
+}
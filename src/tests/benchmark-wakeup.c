@@ -0,0 +1,181 @@
+/* PipeWire
+ *
+ * Copyright © 2020 Wim Taymans
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the next
+ * paragraph) shall be included in all copies or substantial portions of the
+ * Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+#include <time.h>
+#include <poll.h>
+#include <signal.h>
+#include <sys/eventfd.h>
+#include <sys/mman.h>
+#include <sys/wait.h>
+
+#include <pipewire/pipewire.h>
+#include <pipewire/private.h>
+
+#define MAX_NODES	64
+#define N_CYCLES	2000
+
+enum mode {
+	MODE_EVENTFD,
+	MODE_SPIN,
+	MODE_FUTEX,
+};
+
+static const char *mode_names[] = { "eventfd", "spin", "futex" };
+
+/* a ring of a driver and N client nodes, each in its own process, that
+ * wake each other up like nodes in a chain do */
+struct shared {
+	uint32_t stop;
+	struct pw_node_activation activation[MAX_NODES + 1];
+};
+
+struct node {
+	struct shared *shared;
+	enum mode mode;
+	uint32_t id;
+	int fd;
+	int next_fd;
+	uint32_t seq;
+	uint32_t spin;
+};
+
+static uint64_t get_time(void)
+{
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return SPA_TIMESPEC_TO_NSEC(&ts);
+}
+
+static void node_signal(struct node *n, struct pw_node_activation *next)
+{
+	uint64_t cmd = 1;
+
+	if ((n->mode == MODE_EVENTFD || pw_node_activation_wakeup(next)) &&
+	    write(n->next_fd, &cmd, sizeof(cmd)) != sizeof(cmd))
+		fprintf(stderr, "write failed: %m\n");
+}
+
+static void node_wait(struct node *n)
+{
+	struct pw_node_activation *a = &n->shared->activation[n->id];
+	struct pollfd pfd;
+	uint64_t cmd;
+
+	if (n->mode != MODE_EVENTFD &&
+	    pw_node_activation_wait(a, &n->seq, &n->spin, n->mode == MODE_FUTEX))
+		return;
+
+	/* what the data loop does */
+	pfd.fd = n->fd;
+	pfd.events = POLLIN;
+	if (poll(&pfd, 1, -1) < 0 ||
+	    read(n->fd, &cmd, sizeof(cmd)) != sizeof(cmd))
+		fprintf(stderr, "wait failed: %m\n");
+	n->seq = ATOMIC_LOAD(a->wakeup_seq);
+}
+
+static void run_node(struct node *n, struct pw_node_activation *next)
+{
+	while (true) {
+		node_wait(n);
+		if (ATOMIC_LOAD(n->shared->stop))
+			break;
+		node_signal(n, next);
+	}
+	/* pass on the stop */
+	node_signal(n, next);
+}
+
+static void run_test(struct shared *shared, uint32_t n_nodes, enum mode mode)
+{
+	struct node nodes[MAX_NODES + 1];
+	int fds[MAX_NODES + 1];
+	pid_t pids[MAX_NODES];
+	uint32_t i;
+	uint64_t t1, t2;
+
+	memset(shared, 0, sizeof(*shared));
+	for (i = 0; i <= n_nodes; i++) {
+		fds[i] = eventfd(0, EFD_CLOEXEC);
+		spa_assert(fds[i] >= 0);
+		if (mode != MODE_EVENTFD)
+			shared->activation[i].flags = PW_NODE_ACTIVATION_FLAG_WAKEUP;
+	}
+	for (i = 0; i <= n_nodes; i++) {
+		nodes[i].shared = shared;
+		nodes[i].mode = mode;
+		nodes[i].id = i;
+		nodes[i].fd = fds[i];
+		nodes[i].next_fd = fds[(i + 1) % (n_nodes + 1)];
+		nodes[i].seq = 0;
+		nodes[i].spin = sysconf(_SC_NPROCESSORS_ONLN) > 1 ?
+			PW_NODE_ACTIVATION_SPIN_MIN : 0;
+	}
+
+	/* node 0 is the driver, the others are the clients */
+	for (i = 1; i <= n_nodes; i++) {
+		pids[i - 1] = fork();
+		spa_assert(pids[i - 1] >= 0);
+		if (pids[i - 1] == 0) {
+			run_node(&nodes[i], &shared->activation[(i + 1) % (n_nodes + 1)]);
+			_exit(0);
+		}
+	}
+
+	t1 = get_time();
+	for (i = 0; i < N_CYCLES; i++) {
+		node_signal(&nodes[0], &shared->activation[1]);
+		node_wait(&nodes[0]);
+	}
+	t2 = get_time();
+
+	ATOMIC_STORE(shared->stop, 1);
+	node_signal(&nodes[0], &shared->activation[1]);
+	for (i = 0; i < n_nodes; i++)
+		waitpid(pids[i], NULL, 0);
+	for (i = 0; i <= n_nodes; i++)
+		close(fds[i]);
+
+	fprintf(stderr, "%-8s %2u clients: %u cycles elapsed %"PRIu64" = %"PRIu64" ns/cycle "
+			"%"PRIu64" ns/hop\n", mode_names[mode], n_nodes, N_CYCLES, t2 - t1,
+			(t2 - t1) / N_CYCLES, (t2 - t1) / N_CYCLES / (n_nodes + 1));
+}
+
+int main(int argc, char *argv[])
+{
+	static const uint32_t n_nodes[] = { 1, 4, 16, 40 };
+	struct shared *shared;
+	uint32_t i, j;
+
+	shared = mmap(NULL, sizeof(*shared), PROT_READ | PROT_WRITE,
+			MAP_SHARED | MAP_ANONYMOUS, -1, 0);
+	spa_assert(shared != MAP_FAILED);
+
+	for (i = 0; i < SPA_N_ELEMENTS(n_nodes); i++)
+		for (j = 0; j < SPA_N_ELEMENTS(mode_names); j++)
+			run_test(shared, n_nodes[i], j);
+
+	munmap(shared, sizeof(*shared));
+	return 0;
+}
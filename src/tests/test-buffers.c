@@ -0,0 +1,182 @@
+/* PipeWire
+ *
+ * Copyright © 2020 Wim Taymans
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the next
+ * paragraph) shall be included in all copies or substantial portions of the
+ * Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+#include <spa/node/node.h>
+#include <spa/node/utils.h>
+#include <spa/param/buffers-utils.h>
+#include <spa/pod/filter.h>
+#include <spa/utils/hook.h>
+
+#include <pipewire/pipewire.h>
+
+/* a node with one port on each side that only has a Buffers param */
+struct node {
+	struct spa_node node;
+	struct spa_hook_list hooks;
+	const struct spa_pod *buffers;
+};
+
+static int node_add_listener(void *object, struct spa_hook *listener,
+		const struct spa_node_events *events, void *data)
+{
+	struct node *n = object;
+	spa_hook_list_append(&n->hooks, listener, events, data);
+	return 0;
+}
+
+static int node_port_enum_params(void *object, int seq,
+		enum spa_direction direction, uint32_t port_id,
+		uint32_t id, uint32_t start, uint32_t num,
+		const struct spa_pod *filter)
+{
+	struct node *n = object;
+	uint8_t buffer[1024];
+	struct spa_pod_builder b = SPA_POD_BUILDER_INIT(buffer, sizeof(buffer));
+	struct spa_result_node_params result;
+
+	if (id != SPA_PARAM_Buffers || start > 0 || n->buffers == NULL)
+		return 0;
+
+	result.id = id;
+	result.index = 0;
+	result.next = 1;
+	if (spa_pod_filter(&b, &result.param, n->buffers, filter) < 0)
+		return 0;
+	spa_node_emit_result(&n->hooks, seq, 0, SPA_RESULT_TYPE_NODE_PARAMS, &result);
+	return 0;
+}
+
+static const struct spa_node_methods node_methods = {
+	SPA_VERSION_NODE_METHODS,
+	.add_listener = node_add_listener,
+	.port_enum_params = node_port_enum_params,
+};
+
+static void node_init(struct node *n, const struct spa_pod *buffers)
+{
+	spa_zero(*n);
+	n->node.iface = SPA_INTERFACE_INIT(SPA_TYPE_INTERFACE_Node,
+			SPA_VERSION_NODE, &node_methods, n);
+	spa_hook_list_init(&n->hooks);
+	n->buffers = buffers;
+}
+
+/* every block is a separate data plane with the negotiated size,
+ * stride and alignment */
+static void test_blocks(struct pw_context *context)
+{
+	uint8_t buffer[1024];
+	struct spa_pod_builder b = SPA_POD_BUILDER_INIT(buffer, sizeof(buffer));
+	struct spa_pod *out_param, *in_param;
+	struct node out, in;
+	struct pw_buffers result;
+	uint32_t i, j;
+
+	out_param = spa_pod_builder_add_object(&b,
+			SPA_TYPE_OBJECT_ParamBuffers, SPA_PARAM_Buffers,
+			SPA_PARAM_BUFFERS_buffers, SPA_POD_CHOICE_RANGE_Int(4, 2, 16),
+			SPA_PARAM_BUFFERS_blocks,  SPA_POD_Int(3),
+			SPA_PARAM_BUFFERS_size,    SPA_POD_CHOICE_RANGE_Int(4096, 2048, 8192),
+			SPA_PARAM_BUFFERS_stride,  SPA_POD_Int(8),
+			SPA_PARAM_BUFFERS_align,   SPA_POD_Int(64));
+	in_param = spa_pod_builder_add_object(&b,
+			SPA_TYPE_OBJECT_ParamBuffers, SPA_PARAM_Buffers,
+			SPA_PARAM_BUFFERS_buffers, SPA_POD_CHOICE_RANGE_Int(4, 1, 32),
+			SPA_PARAM_BUFFERS_blocks,  SPA_POD_Int(3),
+			SPA_PARAM_BUFFERS_size,    SPA_POD_CHOICE_RANGE_Int(4096, 1024, INT32_MAX),
+			SPA_PARAM_BUFFERS_stride,  SPA_POD_Int(8),
+			SPA_PARAM_BUFFERS_align,   SPA_POD_Int(64));
+
+	node_init(&out, out_param);
+	node_init(&in, in_param);
+
+	spa_zero(result);
+	spa_assert(pw_buffers_negotiate(context, 0, &out.node, 0, &in.node, 0, &result) == 0);
+	spa_assert(result.n_buffers == 4);
+
+	for (i = 0; i < result.n_buffers; i++) {
+		struct spa_buffer *buf = result.buffers[i];
+
+		spa_assert(buf->n_datas == 3);
+		for (j = 0; j < buf->n_datas; j++) {
+			struct spa_data *d = &buf->datas[j];
+
+			spa_assert(d->type == SPA_DATA_MemPtr);
+			spa_assert(d->maxsize == 4096);
+			spa_assert(d->data != NULL);
+			spa_assert(SPA_IS_ALIGNED(d->data, 64));
+			spa_assert(d->chunk->stride == 8);
+			if (j > 0)
+				spa_assert(SPA_PTRDIFF(d->data, buf->datas[j-1].data) >=
+						(ptrdiff_t)buf->datas[j-1].maxsize);
+			/* the planes don't overlap */
+			memset(d->data, j, d->maxsize);
+		}
+		for (j = 0; j < buf->n_datas; j++) {
+			uint8_t *p = buf->datas[j].data;
+			spa_assert(p[0] == j && p[buf->datas[j].maxsize - 1] == j);
+		}
+	}
+	pw_buffers_clear(&result);
+}
+
+/* a Buffers param without the required fields fails the negotiation */
+static void test_invalid(struct pw_context *context)
+{
+	uint8_t buffer[1024];
+	struct spa_pod_builder b = SPA_POD_BUILDER_INIT(buffer, sizeof(buffer));
+	struct spa_pod *param;
+	struct node out, in;
+	struct pw_buffers result;
+
+	param = spa_pod_builder_add_object(&b,
+			SPA_TYPE_OBJECT_ParamBuffers, SPA_PARAM_Buffers,
+			SPA_PARAM_BUFFERS_blocks,  SPA_POD_Int(2));
+
+	node_init(&out, param);
+	node_init(&in, NULL);
+
+	spa_zero(result);
+	spa_assert(pw_buffers_negotiate(context, 0, &out.node, 0, &in.node, 0, &result) < 0);
+	spa_assert(result.buffers == NULL);
+}
+
+int main(int argc, char *argv[])
+{
+	struct pw_main_loop *loop;
+	struct pw_context *context;
+
+	pw_init(&argc, &argv);
+
+	loop = pw_main_loop_new(NULL);
+	context = pw_context_new(pw_main_loop_get_loop(loop), NULL, 0);
+
+	test_blocks(context);
+	test_invalid(context);
+
+	pw_context_destroy(context);
+	pw_main_loop_destroy(loop);
+
+	return 0;
+}
@@ -0,0 +1,252 @@
+/* PipeWire
+ *
+ * Copyright © 2020 Wim Taymans
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the next
+ * paragraph) shall be included in all copies or substantial portions of the
+ * Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+#include <pthread.h>
+#include <sched.h>
+
+#include <pipewire/pipewire.h>
+
+#include "pipewire/private.h"
+
+/* a target that fans out to more targets from the worker it runs on */
+#define N_FANOUT	8
+#define N_CYCLES	1000
+
+struct pool_test;
+
+struct root {
+	struct pw_node_target target;
+	struct pool_test *test;
+	uint32_t idx;
+};
+
+struct pool_test {
+	struct pw_data_pool *pool;
+	struct root root[N_FANOUT];
+	struct pw_node_target leaf[N_FANOUT][N_FANOUT];
+	uint32_t n_run;
+};
+
+static int leaf_signal(void *data)
+{
+	struct pool_test *p = data;
+	ATOMIC_INC(p->n_run);
+	return 0;
+}
+
+static int root_signal(void *data)
+{
+	struct root *r = data;
+	struct pool_test *p = r->test;
+	uint32_t i;
+
+	ATOMIC_INC(p->n_run);
+	for (i = 0; i < N_FANOUT; i++)
+		pw_data_pool_push(p->pool, &p->leaf[r->idx][i]);
+	return 0;
+}
+
+static void test_pool(void)
+{
+	struct pool_test *p;
+	uint32_t i, j, c;
+
+	p = calloc(1, sizeof(*p));
+	spa_assert(p != NULL);
+
+	p->pool = pw_data_pool_new(NULL, 4, -1, 0);
+	spa_assert(p->pool != NULL);
+	spa_assert(pw_data_pool_get_n_workers(p->pool) == 4);
+
+	for (i = 0; i < N_FANOUT; i++) {
+		p->root[i].target.signal = root_signal;
+		p->root[i].target.data = &p->root[i];
+		p->root[i].test = p;
+		p->root[i].idx = i;
+		for (j = 0; j < N_FANOUT; j++) {
+			p->leaf[i][j].signal = leaf_signal;
+			p->leaf[i][j].data = p;
+		}
+	}
+
+	for (c = 0; c < N_CYCLES; c++) {
+		ATOMIC_STORE(p->n_run, 0);
+		for (i = 0; i < N_FANOUT; i++)
+			pw_data_pool_push(p->pool, &p->root[i].target);
+		/* everything ran, also the targets pushed from the workers */
+		pw_data_pool_sync(p->pool);
+		spa_assert(ATOMIC_LOAD(p->n_run) == N_FANOUT + N_FANOUT * N_FANOUT);
+	}
+
+	pw_data_pool_destroy(p->pool);
+	free(p);
+}
+
+/* targets pushed from threads that are not workers, while the workers
+ * fan out to their own deques */
+#define N_PUSHERS	4
+
+static void *do_push(void *user_data)
+{
+	struct pool_test *p = user_data;
+	uint32_t i, c;
+
+	for (c = 0; c < N_CYCLES; c++) {
+		for (i = 0; i < N_FANOUT; i++)
+			pw_data_pool_push(p->pool, &p->leaf[i][c % N_FANOUT]);
+		sched_yield();
+	}
+	return NULL;
+}
+
+static void test_push_threads(void)
+{
+	struct pool_test *p;
+	pthread_t pushers[N_PUSHERS];
+	uint32_t i, j;
+
+	p = calloc(1, sizeof(*p));
+	spa_assert(p != NULL);
+
+	p->pool = pw_data_pool_new(NULL, 3, -1, 0);
+	spa_assert(p->pool != NULL);
+
+	for (i = 0; i < N_FANOUT; i++) {
+		p->root[i].target.signal = root_signal;
+		p->root[i].target.data = &p->root[i];
+		p->root[i].test = p;
+		p->root[i].idx = i;
+		for (j = 0; j < N_FANOUT; j++) {
+			p->leaf[i][j].signal = leaf_signal;
+			p->leaf[i][j].data = p;
+		}
+	}
+
+	for (i = 0; i < N_PUSHERS; i++)
+		spa_assert(pthread_create(&pushers[i], NULL, do_push, p) == 0);
+	for (i = 0; i < N_CYCLES; i++) {
+		for (j = 0; j < N_FANOUT; j++)
+			pw_data_pool_push(p->pool, &p->root[j].target);
+		pw_data_pool_sync(p->pool);
+	}
+	for (i = 0; i < N_PUSHERS; i++)
+		pthread_join(pushers[i], NULL);
+
+	pw_data_pool_sync(p->pool);
+	spa_assert(ATOMIC_LOAD(p->n_run) ==
+			N_PUSHERS * N_CYCLES * N_FANOUT +
+			N_CYCLES * (N_FANOUT + N_FANOUT * N_FANOUT));
+
+	pw_data_pool_destroy(p->pool);
+	free(p);
+}
+
+/* a node whose peers are linked and unlinked while the workers walk its
+ * target list, like resume_node() does. The data loop syncs the pool
+ * before changing the list, like the link and port invoke callbacks. */
+#define N_LINKS		16
+
+struct link_test {
+	struct pw_data_pool *pool;
+	struct pw_node_target root[N_FANOUT];
+	struct spa_list target_list;
+	struct pw_node_target link[N_LINKS];
+	bool linked[N_LINKS];
+	uint32_t n_run;
+};
+
+static int peer_signal(void *data)
+{
+	return 0;
+}
+
+static int walk_signal(void *data)
+{
+	struct link_test *p = data;
+	struct pw_node_target *t;
+
+	spa_list_for_each(t, &p->target_list, link) {
+		spa_assert(p->linked[t - p->link]);
+		ATOMIC_INC(p->n_run);
+	}
+	return 0;
+}
+
+static void test_link_while_running(void)
+{
+	struct link_test *p;
+	uint32_t i, c, idx, n_linked = 0, expected = 0;
+
+	p = calloc(1, sizeof(*p));
+	spa_assert(p != NULL);
+
+	p->pool = pw_data_pool_new(NULL, 4, -1, 0);
+	spa_assert(p->pool != NULL);
+
+	spa_list_init(&p->target_list);
+	for (i = 0; i < N_FANOUT; i++) {
+		p->root[i].signal = walk_signal;
+		p->root[i].data = p;
+	}
+	for (i = 0; i < N_LINKS; i++) {
+		p->link[i].signal = peer_signal;
+		p->link[i].data = p;
+	}
+
+	srand(1234);
+	for (c = 0; c < N_CYCLES * 10; c++) {
+		for (i = 0; i < N_FANOUT; i++)
+			pw_data_pool_push(p->pool, &p->root[i]);
+		expected += N_FANOUT * n_linked;
+
+		/* link or unlink a peer while the cycle is running */
+		idx = rand() % N_LINKS;
+		pw_data_pool_sync(p->pool);
+		if (p->linked[idx]) {
+			p->linked[idx] = false;
+			spa_list_remove(&p->link[idx].link);
+			n_linked--;
+		} else {
+			spa_list_append(&p->target_list, &p->link[idx].link);
+			p->linked[idx] = true;
+			n_linked++;
+		}
+	}
+	pw_data_pool_sync(p->pool);
+	spa_assert(ATOMIC_LOAD(p->n_run) == expected);
+
+	pw_data_pool_destroy(p->pool);
+	free(p);
+}
+
+int main(int argc, char *argv[])
+{
+	pw_init(&argc, &argv);
+
+	test_pool();
+	test_push_threads();
+	test_link_while_running();
+
+	return 0;
+}
@@ -0,0 +1,248 @@
+/* PipeWire
+ *
+ * Copyright © 2020 Wim Taymans
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the next
+ * paragraph) shall be included in all copies or substantial portions of the
+ * Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+#include <spa/node/node.h>
+#include <spa/node/utils.h>
+#include <spa/param/audio/format-utils.h>
+#include <spa/pod/filter.h>
+#include <spa/utils/hook.h>
+
+#include <pipewire/pipewire.h>
+#include <pipewire/impl.h>
+
+#include "pipewire/private.h"
+
+static const uint32_t rates[] = { 44100, 48000 };
+
+/* a node with an input and optionally an output port. Like a converter, the
+ * output port can only do the rate of the input once the input has a format. */
+struct node {
+	struct spa_node node;
+	struct spa_hook_list hooks;
+	struct pw_impl_node *impl;
+	struct pw_impl_port *in, *out;
+	bool has_output;
+
+	uint32_t in_rate;		/* 0 when the input has no format */
+	uint32_t n_enum[2];		/* EnumFormat enumerations, indexed by direction */
+};
+
+static int node_add_listener(void *object, struct spa_hook *listener,
+		const struct spa_node_events *events, void *data)
+{
+	struct node *n = object;
+	struct spa_hook_list save;
+	struct spa_port_info info = SPA_PORT_INFO_INIT();
+
+	spa_hook_list_isolate(&n->hooks, &save, listener, events, data);
+	spa_node_emit_port_info(&n->hooks, SPA_DIRECTION_INPUT, 0, &info);
+	if (n->has_output)
+		spa_node_emit_port_info(&n->hooks, SPA_DIRECTION_OUTPUT, 0, &info);
+	spa_hook_list_join(&n->hooks, &save);
+	return 0;
+}
+
+static int node_set_io(void *object, uint32_t id, void *data, size_t size)
+{
+	return 0;
+}
+
+static int node_send_command(void *object, const struct spa_command *command)
+{
+	return 0;
+}
+
+static struct spa_pod *build_format(struct spa_pod_builder *b, uint32_t id, uint32_t rate)
+{
+	struct spa_audio_info_raw info = SPA_AUDIO_INFO_RAW_INIT(
+			.format = SPA_AUDIO_FORMAT_F32,
+			.rate = rate,
+			.channels = 1);
+	return spa_format_audio_raw_build(b, id, &info);
+}
+
+static int node_port_enum_params(void *object, int seq,
+		enum spa_direction direction, uint32_t port_id,
+		uint32_t id, uint32_t start, uint32_t num,
+		const struct spa_pod *filter)
+{
+	struct node *n = object;
+	uint8_t buffer[1024];
+	struct spa_pod_builder b;
+	struct spa_result_node_params result;
+	struct spa_pod *param;
+	uint32_t count = 0;
+
+	if (id != SPA_PARAM_EnumFormat)
+		return 0;
+
+	n->n_enum[direction]++;
+
+	result.id = id;
+	for (result.index = start; count < num; result.index++) {
+		spa_pod_builder_init(&b, buffer, sizeof(buffer));
+
+		if (direction == SPA_DIRECTION_OUTPUT && n->in_rate != 0) {
+			if (result.index > 0)
+				break;
+			param = build_format(&b, id, n->in_rate);
+		} else {
+			if (result.index >= SPA_N_ELEMENTS(rates))
+				break;
+			param = build_format(&b, id, rates[result.index]);
+		}
+		if (spa_pod_filter(&b, &result.param, param, filter) < 0)
+			continue;
+
+		result.next = result.index + 1;
+		spa_node_emit_result(&n->hooks, seq, 0, SPA_RESULT_TYPE_NODE_PARAMS, &result);
+		count++;
+	}
+	return 0;
+}
+
+static int node_port_set_param(void *object,
+		enum spa_direction direction, uint32_t port_id,
+		uint32_t id, uint32_t flags,
+		const struct spa_pod *param)
+{
+	struct node *n = object;
+	struct spa_audio_info_raw info = { 0 };
+	int res;
+
+	if (id != SPA_PARAM_Format || direction != SPA_DIRECTION_INPUT)
+		return 0;
+
+	/* the output formats change but, like most nodes, we don't tell */
+	if (param == NULL) {
+		n->in_rate = 0;
+		return 0;
+	}
+	if ((res = spa_format_audio_raw_parse(param, &info)) < 0)
+		return res;
+	n->in_rate = info.rate;
+	return 0;
+}
+
+static const struct spa_node_methods node_methods = {
+	SPA_VERSION_NODE_METHODS,
+	.add_listener = node_add_listener,
+	.set_io = node_set_io,
+	.send_command = node_send_command,
+	.port_enum_params = node_port_enum_params,
+	.port_set_param = node_port_set_param,
+};
+
+static void node_init(struct node *n, struct pw_context *context, bool has_output)
+{
+	n->node.iface = SPA_INTERFACE_INIT(SPA_TYPE_INTERFACE_Node,
+			SPA_VERSION_NODE, &node_methods, n);
+	spa_hook_list_init(&n->hooks);
+	n->has_output = has_output;
+
+	n->impl = pw_context_create_node(context, NULL, 0);
+	spa_assert(n->impl != NULL);
+	pw_impl_node_set_implementation(n->impl, &n->node);
+	pw_impl_node_register(n->impl, NULL);
+
+	n->in = pw_impl_node_find_port(n->impl, PW_DIRECTION_INPUT, 0);
+	spa_assert(n->in != NULL);
+	if (has_output) {
+		n->out = pw_impl_node_find_port(n->impl, PW_DIRECTION_OUTPUT, 0);
+		spa_assert(n->out != NULL);
+	}
+}
+
+static uint32_t find_rate(struct pw_context *context, struct node *out, struct node *in)
+{
+	uint8_t buffer[1024];
+	struct spa_pod_builder b = SPA_POD_BUILDER_INIT(buffer, sizeof(buffer));
+	struct spa_pod *format = NULL;
+	struct spa_audio_info_raw info = { 0 };
+	char *error = NULL;
+	int res;
+
+	res = pw_context_find_format(context, out->out, in->in, NULL, 0, NULL,
+			&format, &b, &error);
+	spa_assert(res >= 0);
+	spa_assert(format != NULL);
+	spa_assert(error == NULL);
+	spa_assert(spa_format_audio_raw_parse(format, &info) >= 0);
+	return info.rate;
+}
+
+/* conv -> sink. The negotiated format is cached and must be forgotten when the
+ * output formats of conv change because its input port got a format. */
+static void test_cache(struct pw_context *context)
+{
+	struct node conv, sink;
+	uint8_t buffer[1024];
+	struct spa_pod_builder b = SPA_POD_BUILDER_INIT(buffer, sizeof(buffer));
+	struct spa_pod *format;
+
+	spa_zero(conv);
+	spa_zero(sink);
+	node_init(&conv, context, true);
+	node_init(&sink, context, false);
+
+	spa_assert(find_rate(context, &conv, &sink) == 44100);
+
+	/* nothing changed, the second time the result comes from the cache */
+	conv.n_enum[SPA_DIRECTION_OUTPUT] = sink.n_enum[SPA_DIRECTION_INPUT] = 0;
+	spa_assert(find_rate(context, &conv, &sink) == 44100);
+	spa_assert(conv.n_enum[SPA_DIRECTION_OUTPUT] == 0);
+	spa_assert(sink.n_enum[SPA_DIRECTION_INPUT] == 0);
+
+	/* a format on the input port changes the formats of the output port */
+	format = build_format(&b, SPA_PARAM_Format, 48000);
+	spa_assert(pw_impl_port_set_param(conv.in, SPA_PARAM_Format, 0, format) >= 0);
+	spa_assert(conv.in_rate == 48000);
+	spa_assert(find_rate(context, &conv, &sink) == 48000);
+
+	/* and clearing it changes them back */
+	spa_assert(pw_impl_port_set_param(conv.in, SPA_PARAM_Format, 0, NULL) >= 0);
+	spa_assert(conv.in_rate == 0);
+	spa_assert(find_rate(context, &conv, &sink) == 44100);
+
+	pw_impl_node_destroy(sink.impl);
+	pw_impl_node_destroy(conv.impl);
+}
+
+int main(int argc, char *argv[])
+{
+	struct pw_main_loop *loop;
+	struct pw_context *context;
+
+	pw_init(&argc, &argv);
+
+	loop = pw_main_loop_new(NULL);
+	context = pw_context_new(pw_main_loop_get_loop(loop), NULL, 0);
+
+	test_cache(context);
+
+	pw_context_destroy(context);
+	pw_main_loop_destroy(loop);
+
+	return 0;
+}
@@ -0,0 +1,304 @@
+/* PipeWire
+ *
+ * Copyright © 2020 Wim Taymans
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the next
+ * paragraph) shall be included in all copies or substantial portions of the
+ * Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+#include <stdlib.h>
+
+#include <spa/node/node.h>
+#include <spa/node/utils.h>
+#include <spa/utils/hook.h>
+
+#include <pipewire/pipewire.h>
+#include <pipewire/impl.h>
+
+#include "pipewire/private.h"
+
+#define N_DRIVERS	4
+#define N_NODES		32
+#define N_OPS		2000
+
+struct node {
+	struct spa_node node;
+	struct spa_hook_list hooks;
+	struct pw_impl_node *impl;
+	struct pw_impl_port *in, *out;
+};
+
+struct state {
+	struct pw_impl_node *driver;
+	uint32_t quantum;
+	bool master;
+};
+
+static int node_add_listener(void *object, struct spa_hook *listener,
+		const struct spa_node_events *events, void *data)
+{
+	struct node *n = object;
+	struct spa_hook_list save;
+	struct spa_port_info info = SPA_PORT_INFO_INIT();
+
+	spa_hook_list_isolate(&n->hooks, &save, listener, events, data);
+	spa_node_emit_port_info(&n->hooks, SPA_DIRECTION_INPUT, 0, &info);
+	spa_node_emit_port_info(&n->hooks, SPA_DIRECTION_OUTPUT, 0, &info);
+	spa_hook_list_join(&n->hooks, &save);
+	return 0;
+}
+
+static int node_set_io(void *object, uint32_t id, void *data, size_t size)
+{
+	return 0;
+}
+
+static int node_send_command(void *object, const struct spa_command *command)
+{
+	return 0;
+}
+
+static const struct spa_node_methods node_methods = {
+	SPA_VERSION_NODE_METHODS,
+	.add_listener = node_add_listener,
+	.set_io = node_set_io,
+	.send_command = node_send_command,
+};
+
+static void node_init(struct node *n, struct pw_context *context, bool driver)
+{
+	n->node.iface = SPA_INTERFACE_INIT(SPA_TYPE_INTERFACE_Node,
+			SPA_VERSION_NODE, &node_methods, n);
+	spa_hook_list_init(&n->hooks);
+
+	n->impl = pw_context_create_node(context,
+			pw_properties_new(
+				PW_KEY_NODE_DRIVER, driver ? "true" : "false",
+				NULL), 0);
+	spa_assert(n->impl != NULL);
+	pw_impl_node_set_implementation(n->impl, &n->node);
+	pw_impl_node_register(n->impl, NULL);
+	pw_impl_node_set_active(n->impl, true);
+
+	n->in = pw_impl_node_find_port(n->impl, PW_DIRECTION_INPUT, 0);
+	n->out = pw_impl_node_find_port(n->impl, PW_DIRECTION_OUTPUT, 0);
+	spa_assert(n->in != NULL && n->out != NULL);
+}
+
+static void get_state(struct node *nodes, struct state *state)
+{
+	uint32_t i;
+
+	for (i = 0; i < N_NODES; i++) {
+		struct pw_impl_node *n = nodes[i].impl;
+		state[i].driver = n->driver_node;
+		state[i].master = n->master;
+		state[i].quantum = n->master ? n->quantum_current : 0;
+	}
+}
+
+/* regroup all nodes like the graph was never seen before */
+static void full_recalc(struct pw_context *context, struct node *nodes)
+{
+	uint32_t i;
+
+	for (i = 0; i < N_NODES; i++)
+		pw_context_graph_changed(context, nodes[i].impl);
+	pw_context_recalc_graph(context);
+}
+
+static void check_state(struct pw_context *context, struct node *nodes, uint32_t op)
+{
+	struct state incremental[N_NODES], full[N_NODES];
+	uint32_t i;
+
+	get_state(nodes, incremental);
+	full_recalc(context, nodes);
+	get_state(nodes, full);
+
+	for (i = 0; i < N_NODES; i++) {
+		if (incremental[i].driver != full[i].driver ||
+		    incremental[i].master != full[i].master ||
+		    incremental[i].quantum != full[i].quantum) {
+			fprintf(stderr, "op %u node %u: driver %p/%p master %d/%d quantum %u/%u\n",
+					op, i, incremental[i].driver, full[i].driver,
+					incremental[i].master, full[i].master,
+					incremental[i].quantum, full[i].quantum);
+			spa_assert_not_reached();
+		}
+	}
+}
+
+/* walk the non-feedback links like the link does when it's created */
+static bool can_reach(struct pw_impl_link *links[N_NODES][N_NODES], uint32_t from, uint32_t to)
+{
+	bool seen[N_NODES] = { false, };
+	uint32_t queue[N_NODES], head = 0, tail = 0, i;
+
+	queue[tail++] = from;
+	seen[from] = true;
+	while (head < tail) {
+		uint32_t n = queue[head++];
+		if (n == to)
+			return true;
+		for (i = 0; i < N_NODES; i++) {
+			if (links[n][i] == NULL || links[n][i]->feedback || seen[i])
+				continue;
+			seen[i] = true;
+			queue[tail++] = i;
+		}
+	}
+	return false;
+}
+
+/* link, unlink, activate and deactivate random nodes and check that the
+ * incremental recalc gives the same drivers as regrouping everything and
+ * that the cached walks find the same feedback links */
+static void test_incremental(struct pw_context *context)
+{
+	struct node nodes[N_NODES];
+	struct pw_impl_link *links[N_NODES][N_NODES];
+	uint32_t i, a, b;
+
+	spa_zero(nodes);
+	spa_zero(links);
+	srand(1234);
+
+	for (i = 0; i < N_NODES; i++)
+		node_init(&nodes[i], context, i < N_DRIVERS);
+	check_state(context, nodes, 0);
+
+	for (i = 0; i < N_OPS; i++) {
+		a = rand() % N_NODES;
+		b = rand() % N_NODES;
+
+		switch (rand() % 8) {
+		case 0:
+			pw_impl_node_set_active(nodes[a].impl, !nodes[a].impl->active);
+			break;
+		default:
+			if (a == b)
+				break;
+			if (links[a][b] != NULL) {
+				pw_impl_link_destroy(links[a][b]);
+				links[a][b] = NULL;
+			} else {
+				bool feedback = can_reach(links, b, a);
+				links[a][b] = pw_context_create_link(context,
+						nodes[a].out, nodes[b].in, NULL, NULL, 0);
+				spa_assert(links[a][b]->feedback == feedback);
+			}
+			break;
+		}
+		check_state(context, nodes, i + 1);
+	}
+
+	for (a = 0; a < N_NODES; a++) {
+		for (b = 0; b < N_NODES; b++) {
+			if (links[a][b] != NULL)
+				pw_impl_link_destroy(links[a][b]);
+		}
+	}
+	for (i = 0; i < N_NODES; i++)
+		pw_impl_node_destroy(nodes[i].impl);
+}
+
+/* the cached walk must see the links that are removed and added */
+static void test_feedback(struct pw_context *context)
+{
+	struct node nodes[3];
+	struct pw_impl_link *ab, *bc, *ca;
+	uint32_t i;
+
+	spa_zero(nodes);
+	for (i = 0; i < 3; i++)
+		node_init(&nodes[i], context, false);
+
+	ab = pw_context_create_link(context, nodes[0].out, nodes[1].in, NULL, NULL, 0);
+	bc = pw_context_create_link(context, nodes[1].out, nodes[2].in, NULL, NULL, 0);
+	ca = pw_context_create_link(context, nodes[2].out, nodes[0].in, NULL, NULL, 0);
+	spa_assert(!ab->feedback && !bc->feedback && ca->feedback);
+
+	/* the same walk as the last one, without the path */
+	pw_impl_link_destroy(ca);
+	pw_impl_link_destroy(bc);
+	ca = pw_context_create_link(context, nodes[2].out, nodes[0].in, NULL, NULL, 0);
+	spa_assert(!ca->feedback);
+
+	/* the new link closes the loop again */
+	bc = pw_context_create_link(context, nodes[1].out, nodes[2].in, NULL, NULL, 0);
+	spa_assert(bc->feedback);
+
+	pw_impl_link_destroy(ab);
+	pw_impl_link_destroy(bc);
+	pw_impl_link_destroy(ca);
+	for (i = 0; i < 3; i++)
+		pw_impl_node_destroy(nodes[i].impl);
+}
+
+/* latencies are converted to a power of two quantum and clamped to the
+ * max quantum, large values must not wrap around */
+static void test_latency(struct pw_context *context)
+{
+	struct node node;
+	struct spa_dict_item items[2];
+	uint32_t max_quantum = context->defaults.clock_max_quantum;
+
+	spa_zero(node);
+	node_init(&node, context, false);
+
+	items[0] = SPA_DICT_ITEM_INIT(PW_KEY_NODE_LATENCY, "1000/48000");
+	items[1] = SPA_DICT_ITEM_INIT(PW_KEY_NODE_MAX_LATENCY, "4096/48000");
+	pw_impl_node_update_properties(node.impl, &SPA_DICT_INIT(items, 2));
+	spa_assert(node.impl->quantum_size == 512);
+	spa_assert(node.impl->max_quantum_size == 4096);
+
+	/* ALSA publishes half its buffer, which can be large */
+	items[0] = SPA_DICT_ITEM_INIT(PW_KEY_NODE_LATENCY, "256/44100");
+	items[1] = SPA_DICT_ITEM_INIT(PW_KEY_NODE_MAX_LATENCY, "131072/48000");
+	pw_impl_node_update_properties(node.impl, &SPA_DICT_INIT(items, 2));
+	spa_assert(node.impl->quantum_size == 256);
+	spa_assert(node.impl->max_quantum_size == max_quantum);
+
+	items[1] = SPA_DICT_ITEM_INIT(PW_KEY_NODE_MAX_LATENCY, "4000000000/48000");
+	pw_impl_node_update_properties(node.impl, &SPA_DICT_INIT(items, 2));
+	spa_assert(node.impl->max_quantum_size == max_quantum);
+
+	pw_impl_node_destroy(node.impl);
+}
+
+int main(int argc, char *argv[])
+{
+	struct pw_main_loop *loop;
+	struct pw_context *context;
+
+	pw_init(&argc, &argv);
+
+	loop = pw_main_loop_new(NULL);
+	context = pw_context_new(pw_main_loop_get_loop(loop), NULL, 0);
+
+	test_incremental(context);
+	test_feedback(context);
+	test_latency(context);
+
+	pw_context_destroy(context);
+	pw_main_loop_destroy(loop);
+
+	return 0;
+}
@@ -0,0 +1,260 @@
+/* PipeWire
+ *
+ * Copyright © 2020 Wim Taymans
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the next
+ * paragraph) shall be included in all copies or substantial portions of the
+ * Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+#include <spa/node/node.h>
+#include <spa/node/utils.h>
+#include <spa/param/latency-utils.h>
+#include <spa/utils/hook.h>
+
+#include <pipewire/pipewire.h>
+#include <pipewire/impl.h>
+
+/* a node with one input and one output port that can report a latency
+ * on its ports and remembers the latency the graph gives it */
+struct node {
+	struct spa_node node;
+	struct spa_hook_list hooks;
+	struct pw_impl_node *impl;
+	struct pw_impl_port *in, *out;
+
+	bool report[2];				/* indexed by port direction */
+	struct spa_latency_info reported[2];
+	struct spa_latency_info latency[2][2];	/* port direction, latency direction */
+};
+
+static int node_add_listener(void *object, struct spa_hook *listener,
+		const struct spa_node_events *events, void *data)
+{
+	struct node *n = object;
+	struct spa_hook_list save;
+	struct spa_port_info info = SPA_PORT_INFO_INIT();
+
+	spa_hook_list_isolate(&n->hooks, &save, listener, events, data);
+	spa_node_emit_port_info(&n->hooks, SPA_DIRECTION_INPUT, 0, &info);
+	spa_node_emit_port_info(&n->hooks, SPA_DIRECTION_OUTPUT, 0, &info);
+	spa_hook_list_join(&n->hooks, &save);
+	return 0;
+}
+
+static int node_set_io(void *object, uint32_t id, void *data, size_t size)
+{
+	return 0;
+}
+
+static int node_send_command(void *object, const struct spa_command *command)
+{
+	return 0;
+}
+
+static int node_port_enum_params(void *object, int seq,
+		enum spa_direction direction, uint32_t port_id,
+		uint32_t id, uint32_t start, uint32_t num,
+		const struct spa_pod *filter)
+{
+	struct node *n = object;
+	uint8_t buffer[1024];
+	struct spa_pod_builder b = SPA_POD_BUILDER_INIT(buffer, sizeof(buffer));
+	struct spa_result_node_params result;
+
+	if (id != SPA_PARAM_Latency || start > 0 || !n->report[direction])
+		return 0;
+
+	result.id = id;
+	result.index = 0;
+	result.next = 1;
+	result.param = spa_latency_build(&b, id, &n->reported[direction]);
+	spa_node_emit_result(&n->hooks, seq, 0, SPA_RESULT_TYPE_NODE_PARAMS, &result);
+	return 0;
+}
+
+static int node_port_set_param(void *object,
+		enum spa_direction direction, uint32_t port_id,
+		uint32_t id, uint32_t flags,
+		const struct spa_pod *param)
+{
+	struct node *n = object;
+	struct spa_latency_info info;
+	int res;
+
+	if (id != SPA_PARAM_Latency || param == NULL)
+		return 0;
+	if ((res = spa_latency_parse(param, &info)) < 0)
+		return res;
+	n->latency[direction][info.direction] = info;
+	return 0;
+}
+
+static const struct spa_node_methods node_methods = {
+	SPA_VERSION_NODE_METHODS,
+	.add_listener = node_add_listener,
+	.set_io = node_set_io,
+	.send_command = node_send_command,
+	.port_enum_params = node_port_enum_params,
+	.port_set_param = node_port_set_param,
+};
+
+static void node_init(struct node *n, struct pw_context *context, bool driver)
+{
+	n->node.iface = SPA_INTERFACE_INIT(SPA_TYPE_INTERFACE_Node,
+			SPA_VERSION_NODE, &node_methods, n);
+	spa_hook_list_init(&n->hooks);
+
+	n->impl = pw_context_create_node(context,
+			pw_properties_new(
+				PW_KEY_NODE_DRIVER, driver ? "true" : "false",
+				NULL), 0);
+	spa_assert(n->impl != NULL);
+	pw_impl_node_set_implementation(n->impl, &n->node);
+	pw_impl_node_register(n->impl, NULL);
+	pw_impl_node_set_active(n->impl, true);
+
+	n->in = pw_impl_node_find_port(n->impl, PW_DIRECTION_INPUT, 0);
+	n->out = pw_impl_node_find_port(n->impl, PW_DIRECTION_OUTPUT, 0);
+	spa_assert(n->in != NULL && n->out != NULL);
+}
+
+static struct pw_impl_link *link_nodes(struct pw_context *context,
+		struct node *out, struct node *in)
+{
+	struct pw_impl_link *l;
+
+	l = pw_context_create_link(context, out->out, in->in, NULL, NULL, 0);
+	spa_assert(l != NULL);
+	return l;
+}
+
+static bool latency_equal(const struct spa_latency_info *a, const struct spa_latency_info *b)
+{
+	return a->direction == b->direction && spa_latency_info_compare(a, b) == 0;
+}
+
+/* src -> mid -> sink. The capture latency of the source goes downstream,
+ * the playback latency of the sink goes upstream. */
+static void test_chain(struct pw_context *context)
+{
+	struct node src, mid, sink;
+	struct pw_impl_link *l;
+	struct spa_latency_info capture, playback, none;
+
+	capture = SPA_LATENCY_INFO(SPA_DIRECTION_INPUT,
+			.min_quantum = 1.0f, .max_quantum = 1.0f,
+			.min_ns = 1000, .max_ns = 2000);
+	playback = SPA_LATENCY_INFO(SPA_DIRECTION_OUTPUT,
+			.min_rate = 256, .max_rate = 512);
+
+	spa_zero(src);
+	spa_zero(mid);
+	spa_zero(sink);
+	src.report[SPA_DIRECTION_OUTPUT] = true;
+	src.reported[SPA_DIRECTION_OUTPUT] = capture;
+	sink.report[SPA_DIRECTION_INPUT] = true;
+	sink.reported[SPA_DIRECTION_INPUT] = playback;
+
+	node_init(&src, context, true);
+	node_init(&mid, context, false);
+	node_init(&sink, context, false);
+
+	link_nodes(context, &src, &mid);
+	l = link_nodes(context, &mid, &sink);
+
+	/* downstream */
+	spa_assert(latency_equal(&mid.latency[SPA_DIRECTION_INPUT][SPA_DIRECTION_INPUT], &capture));
+	spa_assert(latency_equal(&mid.latency[SPA_DIRECTION_OUTPUT][SPA_DIRECTION_INPUT], &capture));
+	spa_assert(latency_equal(&sink.latency[SPA_DIRECTION_INPUT][SPA_DIRECTION_INPUT], &capture));
+	/* upstream */
+	spa_assert(latency_equal(&mid.latency[SPA_DIRECTION_OUTPUT][SPA_DIRECTION_OUTPUT], &playback));
+	spa_assert(latency_equal(&mid.latency[SPA_DIRECTION_INPUT][SPA_DIRECTION_OUTPUT], &playback));
+	spa_assert(latency_equal(&src.latency[SPA_DIRECTION_OUTPUT][SPA_DIRECTION_OUTPUT], &playback));
+
+	/* unlinking the sink resets the latency on both sides of the link */
+	pw_impl_link_destroy(l);
+
+	none = SPA_LATENCY_INFO(SPA_DIRECTION_INPUT);
+	spa_assert(latency_equal(&sink.latency[SPA_DIRECTION_INPUT][SPA_DIRECTION_INPUT], &none));
+	spa_assert(latency_equal(&mid.latency[SPA_DIRECTION_OUTPUT][SPA_DIRECTION_INPUT], &capture));
+	none = SPA_LATENCY_INFO(SPA_DIRECTION_OUTPUT);
+	spa_assert(latency_equal(&mid.latency[SPA_DIRECTION_OUTPUT][SPA_DIRECTION_OUTPUT], &none));
+	spa_assert(latency_equal(&mid.latency[SPA_DIRECTION_INPUT][SPA_DIRECTION_OUTPUT], &none));
+	spa_assert(latency_equal(&src.latency[SPA_DIRECTION_OUTPUT][SPA_DIRECTION_OUTPUT], &none));
+
+	pw_impl_node_destroy(sink.impl);
+	pw_impl_node_destroy(mid.impl);
+	pw_impl_node_destroy(src.impl);
+}
+
+/* two sources into one sink, the sink gets the combined range */
+static void test_combine(struct pw_context *context)
+{
+	struct node src1, src2, sink;
+	struct pw_impl_link *l;
+	struct spa_latency_info expect;
+
+	spa_zero(src1);
+	spa_zero(src2);
+	spa_zero(sink);
+	src1.report[SPA_DIRECTION_OUTPUT] = true;
+	src1.reported[SPA_DIRECTION_OUTPUT] = SPA_LATENCY_INFO(SPA_DIRECTION_INPUT,
+			.min_quantum = 1.0f, .max_quantum = 2.0f, .min_ns = 500, .max_ns = 500);
+	src2.report[SPA_DIRECTION_OUTPUT] = true;
+	src2.reported[SPA_DIRECTION_OUTPUT] = SPA_LATENCY_INFO(SPA_DIRECTION_INPUT,
+			.min_quantum = 0.5f, .max_quantum = 1.0f, .min_ns = 1000, .max_ns = 3000);
+
+	node_init(&src1, context, true);
+	node_init(&src2, context, false);
+	node_init(&sink, context, false);
+
+	link_nodes(context, &src1, &sink);
+	l = link_nodes(context, &src2, &sink);
+
+	expect = SPA_LATENCY_INFO(SPA_DIRECTION_INPUT,
+			.min_quantum = 0.5f, .max_quantum = 2.0f, .min_ns = 500, .max_ns = 3000);
+	spa_assert(latency_equal(&sink.latency[SPA_DIRECTION_INPUT][SPA_DIRECTION_INPUT], &expect));
+
+	pw_impl_link_destroy(l);
+	spa_assert(latency_equal(&sink.latency[SPA_DIRECTION_INPUT][SPA_DIRECTION_INPUT],
+				&src1.reported[SPA_DIRECTION_OUTPUT]));
+
+	pw_impl_node_destroy(sink.impl);
+	pw_impl_node_destroy(src2.impl);
+	pw_impl_node_destroy(src1.impl);
+}
+
+int main(int argc, char *argv[])
+{
+	struct pw_main_loop *loop;
+	struct pw_context *context;
+
+	pw_init(&argc, &argv);
+
+	loop = pw_main_loop_new(NULL);
+	context = pw_context_new(pw_main_loop_get_loop(loop), NULL, 0);
+
+	test_chain(context);
+	test_combine(context);
+
+	pw_context_destroy(context);
+	pw_main_loop_destroy(loop);
+
+	return 0;
+}
@@ -0,0 +1,284 @@
+/* PipeWire
+ *
+ * Copyright © 2020 Wim Taymans
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the next
+ * paragraph) shall be included in all copies or substantial portions of the
+ * Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+#include <errno.h>
+#include <string.h>
+#include <unistd.h>
+
+#include <spa/buffer/buffer.h>
+
+#include <pipewire/pipewire.h>
+#include <pipewire/mem.h>
+
+#define ARENA_FLAGS	(PW_MEMBLOCK_FLAG_READWRITE |	\
+			 PW_MEMBLOCK_FLAG_SEAL |	\
+			 PW_MEMBLOCK_FLAG_MAP |		\
+			 PW_MEMBLOCK_FLAG_ARENA)
+
+static struct pw_mempool *arena_pool_new(void)
+{
+	return pw_mempool_new(pw_properties_new(
+				PW_KEY_MEM_ARENA_SIZE, "1048576",
+				NULL));
+}
+
+static void test_arena(void)
+{
+	struct pw_mempool *pool;
+	struct pw_memblock *b1, *b2, *b3, *big;
+	uint32_t offset, page_size = sysconf(_SC_PAGESIZE);
+
+	pool = arena_pool_new();
+	spa_assert(pool != NULL);
+
+	/* small blocks share the fd of the arena */
+	b1 = pw_mempool_alloc(pool, ARENA_FLAGS, SPA_DATA_MemFd, 100);
+	spa_assert(b1 != NULL);
+	spa_assert(b1->flags & PW_MEMBLOCK_FLAG_ARENA);
+	spa_assert(b1->map != NULL);
+	spa_assert(b1->map->size == 100);
+	b2 = pw_mempool_alloc(pool, ARENA_FLAGS, SPA_DATA_MemFd, 100);
+	spa_assert(b2 != NULL);
+	spa_assert(b2->fd == b1->fd);
+	spa_assert(b2->id != b1->id);
+	spa_assert(b2->map->offset != b1->map->offset);
+	spa_assert(b1->map->offset % page_size == 0);
+	spa_assert(b2->map->offset % page_size == 0);
+	spa_assert(SPA_PTRDIFF(b2->map->ptr, b1->map->ptr) ==
+			(int32_t)(b2->map->offset - b1->map->offset));
+
+	/* large blocks and blocks without the flag get their own fd */
+	big = pw_mempool_alloc(pool, ARENA_FLAGS, SPA_DATA_MemFd, 1024 * 1024);
+	spa_assert(big != NULL);
+	spa_assert(!(big->flags & PW_MEMBLOCK_FLAG_ARENA));
+	spa_assert(big->fd != b1->fd);
+	spa_assert(big->map->offset == 0);
+	b3 = pw_mempool_alloc(pool, ARENA_FLAGS & ~PW_MEMBLOCK_FLAG_ARENA,
+			SPA_DATA_MemFd, 100);
+	spa_assert(b3 != NULL);
+	spa_assert(b3->fd != b1->fd);
+	pw_memblock_unref(b3);
+
+	/* freed blocks are reused and cleared */
+	memset(b1->map->ptr, 0xff, 100);
+	offset = b1->map->offset;
+	pw_memblock_unref(b1);
+	b1 = pw_mempool_alloc(pool, ARENA_FLAGS, SPA_DATA_MemFd, 100);
+	spa_assert(b1 != NULL);
+	spa_assert(b1->fd == b2->fd);
+	spa_assert(b1->map->offset == offset);
+	spa_assert(((uint8_t*)b1->map->ptr)[0] == 0);
+	spa_assert(((uint8_t*)b1->map->ptr)[99] == 0);
+
+	/* the arena stays usable when all its blocks are freed */
+	pw_memblock_unref(b1);
+	pw_memblock_unref(b2);
+	b1 = pw_mempool_alloc(pool, ARENA_FLAGS, SPA_DATA_MemFd, 100);
+	spa_assert(b1 != NULL);
+	spa_assert(b1->flags & PW_MEMBLOCK_FLAG_ARENA);
+	pw_memblock_unref(b1);
+
+	pw_memblock_unref(big);
+	pw_mempool_destroy(pool);
+}
+
+static void test_find(void)
+{
+	struct pw_mempool *pool;
+	struct pw_memblock *b[8], *f;
+	uint32_t i;
+
+	pool = arena_pool_new();
+	spa_assert(pool != NULL);
+
+	for (i = 0; i < 8; i++) {
+		/* mix arena blocks and blocks with their own fd */
+		b[i] = pw_mempool_alloc(pool,
+				i & 1 ? ARENA_FLAGS : ARENA_FLAGS & ~PW_MEMBLOCK_FLAG_ARENA,
+				SPA_DATA_MemFd, 4096 + i);
+		spa_assert(b[i] != NULL);
+	}
+	for (i = 0; i < 8; i++) {
+		spa_assert(pw_mempool_find_id(pool, b[i]->id) == b[i]);
+
+		spa_assert(pw_mempool_find_ptr(pool, b[i]->map->ptr) == b[i]);
+		spa_assert(pw_mempool_find_ptr(pool,
+					SPA_MEMBER(b[i]->map->ptr, 4095 + i, void)) == b[i]);
+
+		f = pw_mempool_find_fd(pool, b[i]->fd);
+		spa_assert(f != NULL);
+		spa_assert(f->fd == b[i]->fd);
+		if (!(b[i]->flags & PW_MEMBLOCK_FLAG_ARENA))
+			spa_assert(f == b[i]);
+	}
+	spa_assert(pw_mempool_find_id(pool, 1000) == NULL);
+	spa_assert(pw_mempool_find_fd(pool, -1) == NULL);
+	spa_assert(pw_mempool_find_ptr(pool, &i) == NULL);
+
+	/* the indexes are updated when blocks are removed */
+	pw_memblock_unref(b[2]);
+	pw_memblock_unref(b[3]);
+	spa_assert(pw_mempool_find_id(pool, b[4]->id) == b[4]);
+	spa_assert(pw_mempool_find_ptr(pool, b[4]->map->ptr) == b[4]);
+	spa_assert(pw_mempool_find_fd(pool, b[4]->fd) == b[4]);
+	spa_assert(pw_mempool_find_ptr(pool, b[5]->map->ptr) == b[5]);
+
+	for (i = 0; i < 8; i++) {
+		if (i != 2 && i != 3)
+			pw_memblock_unref(b[i]);
+	}
+	pw_mempool_destroy(pool);
+}
+
+static void test_import(void)
+{
+	struct pw_mempool *pool, *other;
+	struct pw_memblock *b1, *b2, *i1, *i2;
+	struct pw_memmap *m1, *m2;
+	uint32_t tag1[5] = { 1, 2, 3, 4, 5 }, tag2[5] = { 1, 2, 3, 4, 6 };
+
+	pool = arena_pool_new();
+	spa_assert(pool != NULL);
+	other = pw_mempool_new(NULL);
+	spa_assert(other != NULL);
+
+	b1 = pw_mempool_alloc(pool, ARENA_FLAGS, SPA_DATA_MemFd, 256);
+	b2 = pw_mempool_alloc(pool, ARENA_FLAGS, SPA_DATA_MemFd, 256);
+	spa_assert(b1 != NULL && b2 != NULL);
+	spa_assert(b1->fd == b2->fd);
+	memset(b1->map->ptr, 1, 256);
+	memset(b2->map->ptr, 2, 256);
+
+	/* the fd of the arena is imported once */
+	i1 = pw_mempool_import_block(other, b1);
+	spa_assert(i1 != NULL);
+	i2 = pw_mempool_import_block(other, b2);
+	spa_assert(i2 == i1);
+	spa_assert(i1->ref == 2);
+	spa_assert(pw_mempool_find_fd(other, b1->fd) == i1);
+	pw_memblock_unref(i2);
+	pw_memblock_unref(i1);
+	spa_assert(pw_mempool_find_fd(other, b1->fd) == NULL);
+
+	/* a map of an arena block starts at the offset of the block */
+	m1 = pw_mempool_import_map(other, pool,
+			SPA_MEMBER(b1->map->ptr, 16, void), 32, tag1);
+	spa_assert(m1 != NULL);
+	spa_assert(m1->offset == b1->map->offset + 16);
+	spa_assert(m1->size == 32);
+	spa_assert(((uint8_t*)m1->ptr)[0] == 1);
+	spa_assert(((uint8_t*)m1->ptr)[31] == 1);
+
+	m2 = pw_mempool_import_map(other, pool, b2->map->ptr, 256, tag2);
+	spa_assert(m2 != NULL);
+	spa_assert(m2->block == m1->block);
+	spa_assert(m2->offset == b2->map->offset);
+	spa_assert(((uint8_t*)m2->ptr)[0] == 2);
+	spa_assert(((uint8_t*)m2->ptr)[255] == 2);
+
+	/* both maps are found by their tag */
+	spa_assert(pw_mempool_find_tag(other, tag1, sizeof(tag1)) == m1);
+	spa_assert(pw_mempool_find_tag(other, tag2, sizeof(tag2)) == m2);
+
+	/* writes are seen by the other pool */
+	((uint8_t*)m2->ptr)[0] = 3;
+	spa_assert(((uint8_t*)b2->map->ptr)[0] == 3);
+
+	pw_memmap_free(m1);
+	spa_assert(pw_mempool_find_tag(other, tag1, sizeof(tag1)) == NULL);
+	pw_memmap_free(m2);
+
+	pw_mempool_destroy(other);
+	pw_memblock_unref(b1);
+	pw_memblock_unref(b2);
+	pw_mempool_destroy(pool);
+}
+
+static void test_twice(void)
+{
+	struct pw_mempool *pool;
+	struct pw_memblock *b;
+	struct pw_memmap *m1, *m2, *plain;
+	uint32_t page_size = sysconf(_SC_PAGESIZE);
+	uint8_t *p;
+
+	pool = pw_mempool_new(NULL);
+	spa_assert(pool != NULL);
+
+	b = pw_mempool_alloc(pool, PW_MEMBLOCK_FLAG_READWRITE |
+			PW_MEMBLOCK_FLAG_SEAL, SPA_DATA_MemFd, 2 * page_size);
+	spa_assert(b != NULL);
+
+	/* a plain mapping of the block is not used for a twice mapping */
+	plain = pw_mempool_map_id(pool, b->id, PW_MEMMAP_FLAG_READWRITE,
+			0, 2 * page_size, NULL);
+	spa_assert(plain != NULL);
+
+	m1 = pw_mempool_map_id(pool, b->id,
+			PW_MEMMAP_FLAG_READWRITE | PW_MEMMAP_FLAG_TWICE,
+			0, 2 * page_size, NULL);
+	spa_assert(m1 != NULL);
+	spa_assert(m1->ptr != plain->ptr);
+	spa_assert(m1->size == 2 * page_size);
+
+	/* a write past the end shows up at the start and the other way around */
+	p = m1->ptr;
+	p[2 * page_size + 10] = 0x42;
+	spa_assert(p[10] == 0x42);
+	p[page_size - 1] = 0x43;
+	spa_assert(p[3 * page_size - 1] == 0x43);
+	spa_assert(((uint8_t*)plain->ptr)[10] == 0x42);
+
+	/* the same area is mapped twice only once */
+	m2 = pw_mempool_map_id(pool, b->id,
+			PW_MEMMAP_FLAG_READWRITE | PW_MEMMAP_FLAG_TWICE,
+			0, 2 * page_size, NULL);
+	spa_assert(m2 != NULL);
+	spa_assert(m2->ptr == m1->ptr);
+	pw_memmap_free(m2);
+
+	/* the area must be page aligned */
+	errno = 0;
+	spa_assert(pw_mempool_map_id(pool, b->id,
+			PW_MEMMAP_FLAG_READWRITE | PW_MEMMAP_FLAG_TWICE,
+			16, page_size, NULL) == NULL);
+	spa_assert(errno == EINVAL);
+
+	pw_memmap_free(m1);
+	pw_memmap_free(plain);
+	pw_memblock_unref(b);
+	pw_mempool_destroy(pool);
+}
+
+int main(int argc, char *argv[])
+{
+	pw_init(&argc, &argv);
+
+	test_arena();
+	test_find();
+	test_import();
+	test_twice();
+
+	return 0;
+}
@@ -0,0 +1,576 @@
+/* PipeWire
+ *
+ * Copyright © 2020 Collabora Ltd.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the next
+ * paragraph) shall be included in all copies or substantial portions of the
+ * Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+#include <stdio.h>
+#include <signal.h>
+#include <getopt.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#include <spa/utils/result.h>
+
+#include <pipewire/pipewire.h>
+#include <extensions/profiler.h>
+
+#define DEFAULT_REMOTE		"pipewire-0"
+#define MAX_BUCKETS		32
+#define MAX_CYCLE_NODES		256
+#define MAX_PATH		32
+#define MAX_PATHS		16
+
+/* log2 histogram of microseconds */
+struct histogram {
+	uint64_t count;
+	uint64_t sum;
+	uint64_t max;
+	uint64_t buckets[MAX_BUCKETS];
+};
+
+struct node {
+	struct spa_list link;
+	uint32_t id;
+	char name[128];
+
+	uint64_t count;
+	uint64_t incomplete;
+	uint64_t critical;		/* times on the critical path */
+	uint32_t xrun_count;
+	uint32_t xruns;
+	struct histogram wait;
+	struct histogram run;
+	struct histogram busy;
+};
+
+/* a cycle of a driver that is being collected */
+struct driver {
+	struct spa_list link;
+	uint32_t id;
+	uint64_t position;
+	uint32_t quantum;
+	uint32_t rate;
+	uint64_t cycles;
+	uint64_t last_cycles;		/* cycles at the last print */
+	uint32_t n_records;
+	struct pw_profiler_record records[MAX_CYCLE_NODES];
+};
+
+struct path {
+	uint32_t n_ids;
+	uint32_t ids[MAX_PATH];
+	uint64_t count;
+};
+
+struct data {
+	struct pw_main_loop *loop;
+	struct pw_context *context;
+
+	struct pw_core *core;
+	struct spa_hook core_listener;
+
+	struct pw_registry *registry;
+	struct spa_hook registry_listener;
+
+	struct pw_profiler_header *header;
+	size_t size;
+	uint64_t read_index;
+	uint64_t lost;
+
+	struct spa_list nodes;
+	struct spa_list drivers;
+
+	uint64_t cycles;
+	struct path paths[MAX_PATHS];
+	uint32_t n_paths;
+
+	struct spa_source *timer;
+	uint32_t interval;
+	uint32_t ticks;
+};
+
+static struct node *find_node(struct data *d, uint32_t id, bool create)
+{
+	struct node *n;
+
+	spa_list_for_each(n, &d->nodes, link)
+		if (n->id == id)
+			return n;
+	if (!create || (n = calloc(1, sizeof(*n))) == NULL)
+		return NULL;
+	n->id = id;
+	snprintf(n->name, sizeof(n->name), "%u", id);
+	spa_list_append(&d->nodes, &n->link);
+	return n;
+}
+
+static void histogram_add(struct histogram *h, uint64_t nsec)
+{
+	uint64_t usec = nsec / 1000;
+	uint32_t b = usec < 2 ? 0 : 63 - __builtin_clzll(usec);
+
+	h->buckets[SPA_MIN(b, MAX_BUCKETS - 1u)]++;
+	h->count++;
+	h->sum += usec;
+	h->max = SPA_MAX(h->max, usec);
+}
+
+/* upper bound of the bucket with percentile p, in microseconds */
+static uint64_t histogram_percentile(const struct histogram *h, double p)
+{
+	uint64_t target = (uint64_t)(h->count * p), total = 0;
+	uint32_t i;
+
+	for (i = 0; i < MAX_BUCKETS; i++) {
+		total += h->buckets[i];
+		if (total > target)
+			return SPA_MIN(2ull << i, h->max);
+	}
+	return h->max;
+}
+
+static uint64_t histogram_avg(const struct histogram *h)
+{
+	return h->count ? h->sum / h->count : 0;
+}
+
+static void add_path(struct data *d, const uint32_t *ids, uint32_t n_ids)
+{
+	struct path *p;
+	uint32_t i;
+
+	for (i = 0; i < d->n_paths; i++) {
+		p = &d->paths[i];
+		if (p->n_ids == n_ids && memcmp(p->ids, ids, n_ids * sizeof(uint32_t)) == 0) {
+			p->count++;
+			return;
+		}
+	}
+	if (d->n_paths == MAX_PATHS) {
+		/* replace the least common path */
+		p = &d->paths[0];
+		for (i = 1; i < d->n_paths; i++)
+			if (d->paths[i].count < p->count)
+				p = &d->paths[i];
+	} else {
+		p = &d->paths[d->n_paths++];
+	}
+	p->n_ids = n_ids;
+	memcpy(p->ids, ids, n_ids * sizeof(uint32_t));
+	p->count = 1;
+}
+
+/* A node is triggered at the exact time its last dependency finished, so the
+ * critical path is found by walking back from the node that finished last. */
+static void analyze_cycle(struct data *d, struct driver *dr)
+{
+	struct pw_profiler_record *last = NULL, *r;
+	uint32_t i, j, n_ids = 0, ids[MAX_PATH];
+	struct node *n;
+
+	for (i = 0; i < dr->n_records; i++) {
+		r = &dr->records[i];
+		if ((n = find_node(d, r->id, true)) == NULL)
+			continue;
+
+		n->count++;
+		if (n->count > 1 && r->xrun_count != n->xrun_count)
+			n->xruns++;
+		n->xrun_count = r->xrun_count;
+
+		if ((r->flags & PW_PROFILER_RECORD_FLAG_INCOMPLETE) ||
+		    r->awake_time < r->signal_time || r->finish_time < r->awake_time) {
+			n->incomplete++;
+			continue;
+		}
+		if (r->flags & PW_PROFILER_RECORD_FLAG_DRIVER)
+			continue;
+
+		histogram_add(&n->wait, r->awake_time - r->signal_time);
+		histogram_add(&n->run, r->finish_time - r->awake_time);
+		histogram_add(&n->busy, r->finish_time - r->signal_time);
+
+		if (last == NULL || r->finish_time > last->finish_time)
+			last = r;
+	}
+	d->cycles++;
+
+	for (r = last; r != NULL && n_ids < MAX_PATH; ) {
+		struct pw_profiler_record *prev = NULL;
+
+		ids[n_ids++] = r->id;
+		if ((n = find_node(d, r->id, false)) != NULL)
+			n->critical++;
+
+		for (j = 0; j < dr->n_records; j++) {
+			struct pw_profiler_record *p = &dr->records[j];
+			if (p != r && !(p->flags & PW_PROFILER_RECORD_FLAG_DRIVER) &&
+			    p->finish_time == r->signal_time) {
+				prev = p;
+				break;
+			}
+		}
+		r = prev;
+	}
+	if (n_ids > 0)
+		add_path(d, ids, n_ids);
+}
+
+static void add_record(struct data *d, const struct pw_profiler_record *r)
+{
+	struct driver *dr;
+
+	spa_list_for_each(dr, &d->drivers, link)
+		if (dr->id == r->driver_id)
+			break;
+
+	if (&dr->link == &d->drivers) {
+		if ((dr = calloc(1, sizeof(*dr))) == NULL)
+			return;
+		dr->id = r->driver_id;
+		dr->position = r->position;
+		spa_list_append(&d->drivers, &dr->link);
+	}
+	if (dr->position != r->position) {
+		analyze_cycle(d, dr);
+		dr->cycles++;
+		dr->n_records = 0;
+		dr->position = r->position;
+	}
+	dr->quantum = r->quantum;
+	dr->rate = r->rate;
+	if (dr->n_records < MAX_CYCLE_NODES)
+		dr->records[dr->n_records++] = *r;
+}
+
+static void read_records(struct data *d)
+{
+	struct pw_profiler_header *h = d->header;
+	struct pw_profiler_record r;
+	uint64_t write_index = __atomic_load_n(&h->write_index, __ATOMIC_ACQUIRE);
+	int res;
+
+	if (write_index - d->read_index > h->n_records) {
+		d->lost += write_index - h->n_records - d->read_index;
+		d->read_index = write_index - h->n_records;
+	}
+	while (d->read_index < write_index) {
+		res = pw_profiler_read_record(h, d->read_index, &r);
+		if (res == 0)
+			break;
+		if (res > 0)
+			add_record(d, &r);
+		else
+			d->lost++;
+		d->read_index++;
+	}
+}
+
+static void print_stats(struct data *d)
+{
+	struct driver *dr;
+	struct node *n;
+	uint32_t i, j;
+
+	fprintf(stdout, "\ncycles:%"PRIu64" lost records:%"PRIu64"\n", d->cycles, d->lost);
+	spa_list_for_each(dr, &d->drivers, link) {
+		n = find_node(d, dr->id, false);
+		fprintf(stdout, "driver %u (%s): quantum %u rate %u budget %"PRIu64"us wakeups %.1f/s\n",
+				dr->id, n ? n->name : "", dr->quantum, dr->rate,
+				dr->rate ? dr->quantum * (uint64_t)SPA_USEC_PER_SEC / dr->rate : 0,
+				(double)(dr->cycles - dr->last_cycles) / d->interval);
+		dr->last_cycles = dr->cycles;
+	}
+
+	fprintf(stdout, "%5s %-32s %8s %6s %6s | %-20s | %-20s | %-20s | %5s\n",
+			"id", "name", "count", "incmpl", "xruns",
+			"wait avg/p50/p99/max", "run avg/p50/p99/max", "busy avg/p50/p99/max",
+			"crit%");
+	spa_list_for_each(n, &d->nodes, link) {
+		const struct histogram *h[3] = { &n->wait, &n->run, &n->busy };
+
+		fprintf(stdout, "%5u %-32.32s %8"PRIu64" %6"PRIu64" %6u |",
+				n->id, n->name, n->count, n->incomplete, n->xruns);
+		for (i = 0; i < 3; i++)
+			fprintf(stdout, " %4"PRIu64"/%4"PRIu64"/%4"PRIu64"/%5"PRIu64" |",
+					histogram_avg(h[i]),
+					histogram_percentile(h[i], 0.5),
+					histogram_percentile(h[i], 0.99),
+					h[i]->max);
+		fprintf(stdout, " %5.1f\n", d->cycles ? 100.0 * n->critical / d->cycles : 0.0);
+	}
+
+	fprintf(stdout, "critical paths:\n");
+	for (i = 0; i < d->n_paths; i++) {
+		struct path *p = &d->paths[i];
+
+		fprintf(stdout, "  %5.1f%% ", d->cycles ? 100.0 * p->count / d->cycles : 0.0);
+		for (j = p->n_ids; j > 0; j--) {
+			n = find_node(d, p->ids[j-1], false);
+			fprintf(stdout, "%s%s", n ? n->name : "?", j > 1 ? " -> " : "\n");
+		}
+	}
+}
+
+static void print_histograms(struct data *d)
+{
+	struct node *n;
+	uint32_t i;
+
+	spa_list_for_each(n, &d->nodes, link) {
+		if (n->busy.count == 0)
+			continue;
+		fprintf(stdout, "\nnode %u (%s) busy time:\n", n->id, n->name);
+		for (i = 0; i < MAX_BUCKETS; i++) {
+			if (n->busy.buckets[i] == 0)
+				continue;
+			fprintf(stdout, "  < %8uus %10"PRIu64" %5.1f%%\n", 2u << i,
+					n->busy.buckets[i],
+					100.0 * n->busy.buckets[i] / n->busy.count);
+		}
+	}
+}
+
+static void on_timeout(void *data, uint64_t expirations)
+{
+	struct data *d = data;
+
+	read_records(d);
+
+	d->ticks += expirations;
+	if (d->ticks >= d->interval * 100) {
+		print_stats(d);
+		d->ticks = 0;
+	}
+}
+
+static int open_ring(struct data *d, const char *remote_name)
+{
+	struct pw_profiler_header *h;
+	char name[256];
+	struct stat st;
+	int fd, res = 0;
+
+	snprintf(name, sizeof(name), PW_PROFILER_SHM_FORMAT, remote_name);
+	if ((fd = shm_open(name, O_RDONLY | O_CLOEXEC, 0)) < 0) {
+		fprintf(stderr, "can't open %s: %m, is %s set?\n", name, PW_KEY_CONTEXT_PROFILER);
+		return -errno;
+	}
+	if (fstat(fd, &st) < 0 || (size_t)st.st_size < sizeof(*h)) {
+		res = -EINVAL;
+		goto exit;
+	}
+	/* the ring is only read, the writer is never disturbed */
+	h = mmap(NULL, st.st_size, PROT_READ, MAP_SHARED, fd, 0);
+	if (h == MAP_FAILED) {
+		res = -errno;
+		goto exit;
+	}
+	if (h->magic != PW_PROFILER_MAGIC || h->version != PW_VERSION_PROFILER ||
+	    h->record_size != sizeof(struct pw_profiler_record) ||
+	    sizeof(*h) + (size_t)h->n_records * h->record_size > (size_t)st.st_size) {
+		munmap(h, st.st_size);
+		res = -EINVAL;
+		goto exit;
+	}
+	d->header = h;
+	d->size = st.st_size;
+	d->read_index = __atomic_load_n(&h->write_index, __ATOMIC_ACQUIRE);
+exit:
+	if (res < 0)
+		fprintf(stderr, "invalid profiler ring %s: %s\n", name, spa_strerror(res));
+	close(fd);
+	return res;
+}
+
+static void registry_event_global(void *data, uint32_t id, uint32_t permissions,
+				  const char *type, uint32_t version,
+				  const struct spa_dict *props)
+{
+	struct data *d = data;
+	struct node *n;
+	const char *str;
+
+	if (strcmp(type, PW_TYPE_INTERFACE_Node) != 0 || props == NULL)
+		return;
+	if ((str = spa_dict_lookup(props, PW_KEY_NODE_NAME)) == NULL)
+		return;
+	if ((n = find_node(d, id, true)) != NULL)
+		snprintf(n->name, sizeof(n->name), "%s", str);
+}
+
+static const struct pw_registry_events registry_events = {
+	PW_VERSION_REGISTRY_EVENTS,
+	.global = registry_event_global,
+};
+
+static void on_core_error(void *data, uint32_t id, int seq, int res, const char *message)
+{
+	struct data *d = data;
+
+	pw_log_error("error id:%u seq:%d res:%d (%s): %s",
+			id, seq, res, spa_strerror(res), message);
+
+	if (id == 0) {
+		pw_main_loop_quit(d->loop);
+	}
+}
+
+static const struct pw_core_events core_events = {
+	PW_VERSION_CORE_EVENTS,
+	.error = on_core_error,
+};
+
+static void do_quit(void *data, int signal_number)
+{
+	struct data *d = data;
+	pw_main_loop_quit(d->loop);
+}
+
+static void show_help(const char *name)
+{
+        fprintf(stdout, "%s [options]\n"
+             "  -h, --help                            Show this help\n"
+             "  -v, --version                         Show version\n"
+             "  -r, --remote                          Remote daemon name (Default %s)\n"
+             "  -i, --interval                        Seconds between reports (Default 1)\n"
+             "  -H, --histogram                       Show histograms on exit\n",
+             name,
+             DEFAULT_REMOTE);
+}
+
+int main(int argc, char *argv[])
+{
+	struct data data = { 0 };
+	struct pw_loop *l;
+	struct pw_properties *props = NULL;
+	const char *remote_name = NULL;
+	bool show_histograms = false;
+	struct timespec value, interval;
+	struct node *n;
+	struct driver *dr;
+	static const struct option long_options[] = {
+		{"help",	0, NULL, 'h'},
+		{"version",	0, NULL, 'v'},
+		{"remote",	1, NULL, 'r'},
+		{"interval",	1, NULL, 'i'},
+		{"histogram",	0, NULL, 'H'},
+		{NULL,		0, NULL, 0}
+	};
+	int c;
+
+	pw_init(&argc, &argv);
+
+	data.interval = 1;
+
+	while ((c = getopt_long(argc, argv, "hvr:i:H", long_options, NULL)) != -1) {
+		switch (c) {
+		case 'h' :
+			show_help(argv[0]);
+			return 0;
+		case 'v' :
+			fprintf(stdout, "%s\n"
+				"Compiled with libpipewire %s\n"
+				"Linked with libpipewire %s\n",
+				argv[0],
+				pw_get_headers_version(),
+				pw_get_library_version());
+			return 0;
+		case 'r' :
+			remote_name = optarg;
+			break;
+		case 'i' :
+			data.interval = SPA_MAX(atoi(optarg), 1);
+			break;
+		case 'H' :
+			show_histograms = true;
+			break;
+		default:
+			return -1;
+		}
+	}
+
+	spa_list_init(&data.nodes);
+	spa_list_init(&data.drivers);
+
+	if (open_ring(&data, remote_name ? remote_name : DEFAULT_REMOTE) < 0)
+		return -1;
+
+	data.loop = pw_main_loop_new(NULL);
+	if (data.loop == NULL)
+		return -1;
+
+	l = pw_main_loop_get_loop(data.loop);
+	pw_loop_add_signal(l, SIGINT, do_quit, &data);
+	pw_loop_add_signal(l, SIGTERM, do_quit, &data);
+
+	data.context = pw_context_new(l, NULL, 0);
+	if (data.context == NULL)
+		return -1;
+
+	if (remote_name)
+		props = pw_properties_new(PW_KEY_REMOTE_NAME, remote_name, NULL);
+
+	/* only used for the node names */
+	data.core = pw_context_connect(data.context, props, 0);
+	if (data.core != NULL) {
+		pw_core_add_listener(data.core,
+					   &data.core_listener,
+					   &core_events, &data);
+		data.registry = pw_core_get_registry(data.core,
+						  PW_VERSION_REGISTRY, 0);
+		pw_registry_add_listener(data.registry,
+					       &data.registry_listener,
+					       &registry_events, &data);
+	} else {
+		fprintf(stderr, "can't connect: %m, node names are not available\n");
+	}
+
+	data.timer = pw_loop_add_timer(l, on_timeout, &data);
+	value.tv_sec = 0;
+	value.tv_nsec = 10 * SPA_NSEC_PER_MSEC;
+	interval = value;
+	pw_loop_update_timer(l, data.timer, &value, &interval, false);
+
+	pw_main_loop_run(data.loop);
+
+	read_records(&data);
+	print_stats(&data);
+	if (show_histograms)
+		print_histograms(&data);
+
+	spa_list_consume(dr, &data.drivers, link) {
+		spa_list_remove(&dr->link);
+		free(dr);
+	}
+	spa_list_consume(n, &data.nodes, link) {
+		spa_list_remove(&n->link);
+		free(n);
+	}
+	munmap(data.header, data.size);
+	pw_context_destroy(data.context);
+	pw_main_loop_destroy(data.loop);
+
+	return 0;
+}